@@ -7,9 +7,43 @@
 
 # NCE library source files.
 set( NCE_SOURCES
-     "${CMAKE_CURRENT_LIST_DIR}/source/nce_iot_c_sdk.c" )
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_iot_c_sdk.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_metrics.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_log_tokenized.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_trace.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_uplink_queue.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_spsc_queue.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_scheduler.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_endpoint_cache.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_coap_option.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_chunk_size.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_retry.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_rto.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_deadline.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_oscore.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_aggregate.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_memfault.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_downlink.c"
+     "${CMAKE_CURRENT_LIST_DIR}/source/nce_telemetry.c" )
 
 # NCE library Public Include directories.
 set( NCE_INCLUDE_PUBLIC_DIRS
      "${CMAKE_CURRENT_LIST_DIR}/source/include"
-     "${CMAKE_CURRENT_LIST_DIR}/source/interface" )
\ No newline at end of file
+     "${CMAKE_CURRENT_LIST_DIR}/source/interface" )
+# Linux port source files (POSIX sockets, batched epoll/sendmmsg backend, clock,
+# Chrome trace sink, memory-mapped storage).
+set( NCE_LINUX_PORT_SOURCES
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/clock_linux.c"
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/trace_chrome_linux.c"
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/network_interface_linux.c"
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/network_batch_linux.c"
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/preconnect_linux.c"
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/storage_linux.c" )
+
+# Linux port crypto (OSCORE), needs OpenSSL libcrypto.
+set( NCE_LINUX_PORT_CRYPTO_SOURCES
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/crypto_linux.c" )
+
+# Linux port include directories.
+set( NCE_LINUX_PORT_INCLUDE_DIRS
+     "${CMAKE_CURRENT_LIST_DIR}/ports/linux/include" )
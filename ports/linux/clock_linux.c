@@ -0,0 +1,39 @@
+/**
+ * @file clock_linux.c
+ * @brief Implements the clock interface for Linux hosts with CLOCK_MONOTONIC.
+ */
+
+#ifndef _POSIX_C_SOURCE
+    #define _POSIX_C_SOURCE    200809L
+#endif
+
+#include <errno.h>
+#include <time.h>
+#include "clock_linux.h"
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    /* Wraps every ~71 minutes, differences stay valid in unsigned arithmetic. */
+    return ( uint32_t ) ts.tv_sec * 1000000u + ( uint32_t ) ( ts.tv_nsec / 1000 );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_os_delay_ms( uint32_t ms )
+{
+    struct timespec ts;
+
+    ts.tv_sec = ( time_t ) ( ms / 1000u );
+    ts.tv_nsec = ( long ) ( ms % 1000u ) * 1000000L;
+
+    /* Restart after signals until the whole wait has passed. */
+    while( ( nanosleep( &ts, &ts ) != 0 ) && ( errno == EINTR ) )
+    {
+    }
+}
@@ -0,0 +1,133 @@
+/**
+ * @file crypto_linux.c
+ * @brief Implements the crypto interface for Linux hosts with OpenSSL
+ * libcrypto.
+ */
+
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include "crypto_interface.h"
+
+/*-----------------------------------------------------------*/
+
+int nce_os_hkdf_sha256( const uint8_t * salt,
+                        size_t saltLength,
+                        const uint8_t * ikm,
+                        size_t ikmLength,
+                        const uint8_t * info,
+                        size_t infoLength,
+                        uint8_t * okm,
+                        size_t okmLength )
+{
+    static const uint8_t empty[ 1 ] = { 0 };
+    EVP_PKEY_CTX * ctx = EVP_PKEY_CTX_new_id( EVP_PKEY_HKDF, NULL );
+    size_t length = okmLength;
+    int ok;
+
+    /* OpenSSL refuses NULL for empty salt and info. */
+    ok = ( ctx != NULL ) &&
+         ( EVP_PKEY_derive_init( ctx ) > 0 ) &&
+         ( EVP_PKEY_CTX_set_hkdf_md( ctx, EVP_sha256() ) > 0 ) &&
+         ( EVP_PKEY_CTX_set1_hkdf_salt( ctx, ( saltLength > 0u ) ? salt : empty, ( int ) saltLength ) > 0 ) &&
+         ( EVP_PKEY_CTX_set1_hkdf_key( ctx, ikm, ( int ) ikmLength ) > 0 ) &&
+         ( EVP_PKEY_CTX_add1_hkdf_info( ctx, ( infoLength > 0u ) ? info : empty, ( int ) infoLength ) > 0 ) &&
+         ( EVP_PKEY_derive( ctx, okm, &length ) > 0 ) &&
+         ( length == okmLength );
+
+    EVP_PKEY_CTX_free( ctx );
+
+    return ok ? 0 : -1;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Set up AES-128-CCM with an 8-byte tag and a 13-byte nonce, and feed
+ * the message length and the additional data.
+ *
+ * @param ctx Cipher context.
+ * @param encrypt 1 to encrypt, 0 to decrypt.
+ * @param key AES key.
+ * @param nonce CCM nonce.
+ * @param tag Expected tag when decrypting, NULL when encrypting.
+ * @param aad Additional authenticated data.
+ * @param aadLength Length of the additional data.
+ * @param length Length of the plaintext.
+ * @return 1 on success, 0 on error.
+ */
+static int prv_ccm_begin( EVP_CIPHER_CTX * ctx,
+                          int encrypt,
+                          const uint8_t * key,
+                          const uint8_t * nonce,
+                          const uint8_t * tag,
+                          const uint8_t * aad,
+                          size_t aadLength,
+                          size_t length )
+{
+    int out;
+
+    return ( EVP_CipherInit_ex( ctx, EVP_aes_128_ccm(), NULL, NULL, NULL, encrypt ) > 0 ) &&
+           ( EVP_CIPHER_CTX_ctrl( ctx, EVP_CTRL_AEAD_SET_IVLEN, NCE_CRYPTO_CCM_NONCE_LENGTH, NULL ) > 0 ) &&
+           ( EVP_CIPHER_CTX_ctrl( ctx, EVP_CTRL_AEAD_SET_TAG, NCE_CRYPTO_CCM_TAG_LENGTH, ( void * ) tag ) > 0 ) &&
+           ( EVP_CipherInit_ex( ctx, NULL, NULL, key, nonce, encrypt ) > 0 ) &&
+           ( EVP_CipherUpdate( ctx, NULL, &out, NULL, ( int ) length ) > 0 ) &&
+           ( ( aadLength == 0u ) || ( EVP_CipherUpdate( ctx, NULL, &out, aad, ( int ) aadLength ) > 0 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_aes_ccm_encrypt( const uint8_t * key,
+                            const uint8_t * nonce,
+                            const uint8_t * aad,
+                            size_t aadLength,
+                            const uint8_t * plaintext,
+                            size_t length,
+                            uint8_t * ciphertext )
+{
+    EVP_CIPHER_CTX * ctx = EVP_CIPHER_CTX_new();
+    int out;
+    int ok;
+
+    ok = ( ctx != NULL ) &&
+         prv_ccm_begin( ctx, 1, key, nonce, NULL, aad, aadLength, length ) &&
+         ( EVP_CipherUpdate( ctx, ciphertext, &out, plaintext, ( int ) length ) > 0 ) &&
+         ( EVP_CipherFinal_ex( ctx, ciphertext + length, &out ) > 0 ) &&
+         ( EVP_CIPHER_CTX_ctrl( ctx, EVP_CTRL_AEAD_GET_TAG, NCE_CRYPTO_CCM_TAG_LENGTH, ciphertext + length ) > 0 );
+
+    EVP_CIPHER_CTX_free( ctx );
+
+    return ok ? 0 : -1;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_aes_ccm_decrypt( const uint8_t * key,
+                            const uint8_t * nonce,
+                            const uint8_t * aad,
+                            size_t aadLength,
+                            const uint8_t * ciphertext,
+                            size_t length,
+                            uint8_t * plaintext )
+{
+    EVP_CIPHER_CTX * ctx;
+    size_t plainLength;
+    int out;
+    int ok;
+
+    if( length < NCE_CRYPTO_CCM_TAG_LENGTH )
+    {
+        return -1;
+    }
+
+    plainLength = length - NCE_CRYPTO_CCM_TAG_LENGTH;
+    ctx = EVP_CIPHER_CTX_new();
+
+    /* CCM verifies the tag in the update: there is no final step. */
+    ok = ( ctx != NULL ) &&
+         prv_ccm_begin( ctx, 0, key, nonce, ciphertext + plainLength, aad, aadLength, plainLength ) &&
+         ( EVP_CipherUpdate( ctx, plaintext, &out, ciphertext, ( int ) plainLength ) > 0 );
+
+    EVP_CIPHER_CTX_free( ctx );
+
+    return ok ? 0 : -1;
+}
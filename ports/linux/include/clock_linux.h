@@ -0,0 +1,19 @@
+/**
+ * @file clock_linux.h
+ * @brief Monotonic clock of the Linux port, backing NceOSClockUs(), and the
+ * sleep to set as nce_context_t::delayMs.
+ */
+
+#ifndef CLOCK_LINUX_H_
+#define CLOCK_LINUX_H_
+
+#include "clock_interface.h"
+
+/**
+ * @brief Sleep of the calling thread, for nce_context_t::delayMs.
+ *
+ * @param[in] ms Milliseconds to sleep.
+ */
+void nce_os_delay_ms( uint32_t ms );
+
+#endif /* ifndef CLOCK_LINUX_H_ */
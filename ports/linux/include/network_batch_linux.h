@@ -0,0 +1,130 @@
+/**
+ * @file network_batch_linux.h
+ * @brief Batched network interface for Linux hosts driving many connections:
+ * an epoll reactor moving datagrams with sendmmsg/recvmmsg, and optionally
+ * submitting sends through io_uring.
+ */
+
+#ifndef NETWORK_BATCH_LINUX_H_
+#define NETWORK_BATCH_LINUX_H_
+
+/* struct mmsghdr is a GNU extension, the build must define _GNU_SOURCE. */
+#ifndef _GNU_SOURCE
+    #error "network_batch_linux.h requires _GNU_SOURCE to be defined by the build."
+#endif
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include "udp_interface.h"
+#include "network_interface_linux.h"
+
+/**
+ * @brief Maximum number of datagrams moved by one system call.
+ */
+#ifndef NCE_SDK_BATCH_SIZE
+    #define NCE_SDK_BATCH_SIZE    64
+#endif
+
+/**
+ * @brief io_uring submission state (only used when NCE_SDK_LINUX_IO_URING is defined).
+ */
+struct nce_uring
+{
+    int fd;                      /**< io_uring file descriptor, -1 when unused. */
+    unsigned * sqHead;           /**< Submission queue head. */
+    unsigned * sqTail;           /**< Submission queue tail. */
+    unsigned * sqMask;           /**< Submission queue index mask. */
+    unsigned * sqArray;          /**< Submission queue index array. */
+    void * sqes;                 /**< Submission queue entries. */
+    unsigned * cqHead;           /**< Completion queue head. */
+    unsigned * cqTail;           /**< Completion queue tail. */
+    unsigned * cqMask;           /**< Completion queue index mask. */
+    void * cqes;                 /**< Completion queue entries. */
+    void * sqRing;               /**< Mapping of the submission ring. */
+    size_t sqRingSize;           /**< Size of sqRing. */
+    void * cqRing;               /**< Mapping of the completion ring. */
+    size_t cqRingSize;           /**< Size of cqRing. */
+    size_t sqesSize;             /**< Size of the sqes mapping. */
+};
+
+/**
+ * @typedef OSNetworkBatch_t
+ */
+struct OSNetworkBatch
+{
+    int epoll_fd;                                       /**< epoll instance watching attached sockets. */
+    struct nce_uring uring;                             /**< io_uring used for sends when available. */
+    struct mmsghdr msgs[ NCE_SDK_BATCH_SIZE ];          /**< sendmmsg/recvmmsg headers. */
+    struct iovec iovecs[ NCE_SDK_BATCH_SIZE ];          /**< One buffer per datagram. */
+    struct epoll_event events[ NCE_SDK_BATCH_SIZE ];    /**< Ready connections. */
+    unsigned long syscalls;                             /**< I/O system calls issued, for benchmarks. */
+};
+
+/**
+ * @brief Create the event loop.
+ *
+ * When built with NCE_SDK_LINUX_IO_URING, sends go through io_uring if the
+ * kernel allows it, and fall back to sendmmsg otherwise.
+ *
+ * @param osbatch Event loop to initialize.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int nce_os_batch_init( OSNetworkBatch_t osbatch );
+
+/**
+ * @brief Release the event loop (attached sockets stay open).
+ *
+ * @param osbatch Event loop to release.
+ */
+void nce_os_batch_deinit( OSNetworkBatch_t osbatch );
+
+/**
+ * @brief Add a connected socket to the event loop.
+ *
+ * @param osbatch Event loop.
+ * @param osnetwork Connection opened with nce_os_connect().
+ * @return int 0 on success, negative error code otherwise.
+ */
+int nce_os_attach( OSNetworkBatch_t osbatch,
+                   OSNetwork_t osnetwork );
+
+/**
+ * @brief Remove a connection from the event loop.
+ *
+ * @param osbatch Event loop.
+ * @param osnetwork Attached connection.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int nce_os_detach( OSNetworkBatch_t osbatch,
+                   OSNetwork_t osnetwork );
+
+/**
+ * @brief Send datagrams, grouping consecutive datagrams of one connection
+ * into a single sendmmsg call (or all of them into one io_uring submission).
+ *
+ * @param osbatch Event loop.
+ * @param pDatagrams Datagrams to send, results are stored in each datagram.
+ * @param count Number of datagrams.
+ * @return int Number of datagrams sent, negative error code otherwise.
+ */
+int nce_os_send_batch( OSNetworkBatch_t osbatch,
+                       os_datagram_t * pDatagrams,
+                       size_t count );
+
+/**
+ * @brief Wait for readable connections and drain each with recvmmsg.
+ *
+ * @param osbatch Event loop.
+ * @param pDatagrams Receive buffers, tagged with their connection on return.
+ * @param count Number of receive buffers.
+ * @param timeoutMs Maximum time to wait for the first datagram.
+ * @return int Number of datagrams received (0 on timeout), negative error code otherwise.
+ */
+int nce_os_recv_batch( OSNetworkBatch_t osbatch,
+                       os_datagram_t * pDatagrams,
+                       size_t count,
+                       int timeoutMs );
+
+#endif /* ifndef NETWORK_BATCH_LINUX_H_ */
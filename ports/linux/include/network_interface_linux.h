@@ -0,0 +1,149 @@
+/**
+ * @file network_interface_linux.h
+ * @brief Network interface definitions to send and receive data over the
+ * network via UDP on Linux (POSIX sockets).
+ */
+
+#ifndef NETWORK_INTERFACE_LINUX_H_
+#define NETWORK_INTERFACE_LINUX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "udp_interface.h"
+
+/**
+ * @brief Network send timeout (seconds).
+ */
+#ifndef NCE_SDK_SEND_TIMEOUT_SECONDS
+    #define NCE_SDK_SEND_TIMEOUT_SECONDS    10
+#endif
+
+/**
+ * @brief Network receive timeout (seconds).
+ */
+#ifndef NCE_SDK_RECV_TIMEOUT_SECONDS
+    #define NCE_SDK_RECV_TIMEOUT_SECONDS    10
+#endif
+
+/**
+ * @brief Most addresses a connect tries, over all hosts of the endpoint.
+ */
+#ifndef NCE_SDK_CONNECT_MAX_ADDRESSES
+    #define NCE_SDK_CONNECT_MAX_ADDRESSES    8
+#endif
+
+/**
+ * @brief Endpoints whose last working address is remembered, 0 to disable.
+ */
+#ifndef NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE
+    #define NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE    4
+#endif
+
+/**
+ * @brief Delay before the next address is tried while the previous attempts
+ * are still unanswered (RFC 8305 Connection Attempt Delay).
+ */
+#ifndef NCE_SDK_CONNECT_ATTEMPT_DELAY_MS
+    #define NCE_SDK_CONNECT_ATTEMPT_DELAY_MS    250
+#endif
+
+/**
+ * @brief Time the attempts of a connect have to be answered. Without any
+ * answer, the first attempt not refused is used.
+ */
+#ifndef NCE_SDK_CONNECT_TIMEOUT_MS
+    #define NCE_SDK_CONNECT_TIMEOUT_MS    2000
+#endif
+
+/**
+ * @brief Endpoints on this port are probed with a CoAP ping, which any CoAP
+ * server answers, to race their addresses. 0 probes every endpoint, -1 none.
+ * Endpoints not probed try their addresses one after the other and only skip
+ * those failing locally.
+ */
+#ifndef NCE_SDK_CONNECT_PROBE_PORT
+    #define NCE_SDK_CONNECT_PROBE_PORT    5683
+#endif
+
+/**
+ * @typedef OSNetwork_t
+ */
+struct OSNetwork
+{
+    int os_socket;
+    int probe_id; /**< Message ID of the CoAP ping still unanswered on os_socket, -1 if none. Set by nce_os_connect(). */
+};
+
+/**
+ * @brief Establishes a Network connection to a specified endpoint.
+ *
+ * The host may list several names or address literals separated by commas.
+ * All IPv6 and IPv4 addresses they resolve to are tried, alternating the
+ * families, the last address that answered for this endpoint first. Probed
+ * endpoints (NCE_SDK_CONNECT_PROBE_PORT) start a new attempt every
+ * NCE_SDK_CONNECT_ATTEMPT_DELAY_MS, or as soon as one is refused, and keep
+ * the first address that answers.
+ *
+ * @param osnetwork        The network interface instance to use.
+ * @param endpoint         The endpoint structure representing the target server.
+ * @return int             0 on success, error code otherwise.
+ */
+int nce_os_connect( OSNetwork_t osnetwork,
+                    OSEndPoint_t endpoint );
+
+/**
+ * @brief Establishes a Network connection, the endpoint passed by pointer
+ * (os_network_ops_v2_t::nce_os_udp_connect_v2).
+ *
+ * @param osnetwork        The network interface instance to use.
+ * @param endpoint         The endpoint structure representing the target server.
+ * @return int             0 on success, error code otherwise.
+ */
+int nce_os_connect_v2( OSNetwork_t osnetwork,
+                       const OSEndPoint_t * endpoint );
+
+/**
+ * @brief Sends data over an established Network connection.
+ *
+ * @param osnetwork        The network interface instance to use.
+ * @param pBuffer          Pointer to the data buffer to send.
+ * @param bytesToSend      Number of bytes to send from the buffer.
+ * @return int             Number of bytes successfully sent, or error code on failure.
+ */
+int nce_os_send( OSNetwork_t osnetwork,
+                 void * pBuffer,
+                 size_t bytesToSend );
+
+/**
+ * @brief Receives data over an established Network connection.
+ *
+ * @param osnetwork        The network interface instance to use.
+ * @param pBuffer          Pointer to the buffer where received data will be stored.
+ * @param bytesToRecv      Number of bytes to receive into the buffer.
+ * @return int             Number of bytes received, 0 on timeout, error code on failure.
+ */
+int nce_os_recv( OSNetwork_t osnetwork,
+                 void * pBuffer,
+                 size_t bytesToRecv );
+
+/**
+ * @brief Sets the receive timeout of an established Network connection,
+ * replacing NCE_SDK_RECV_TIMEOUT_SECONDS until the next connect. Used as the
+ * setRecvTimeout of an SDK context with NCE_SDK_RTO.
+ *
+ * @param osnetwork        The network interface instance to configure.
+ * @param ms               Timeout in milliseconds.
+ * @return int             0 on success, error code otherwise.
+ */
+int nce_os_set_recv_timeout( OSNetwork_t osnetwork,
+                             uint32_t ms );
+
+/**
+ * @brief Closes an active Network connection.
+ *
+ * @param osnetwork        The network interface instance to close.
+ * @return int             0 on successful disconnection, error code otherwise.
+ */
+int nce_os_disconnect( OSNetwork_t osnetwork );
+
+#endif /* ifndef NETWORK_INTERFACE_LINUX_H_ */
@@ -0,0 +1,91 @@
+/**
+ * @file preconnect_linux.h
+ * @brief Speculative pre-connect of the Linux port: resolve and connect (and
+ * on DTLS ports handshake) in a background thread as soon as the link is up,
+ * so the first request finds an established session.
+ *
+ * One session is prepared at a time, for the network object of the operations
+ * given to nce_os_preconnect_start(). Hand the SDK operations whose connect is
+ * nce_os_preconnect_connect(): a connect on that network object and endpoint
+ * adopts the prepared session, waiting for the handshake if it is still
+ * running, instead of starting a second one. The session is prepared on a
+ * network object of its own and only moved into the SDK's on adoption, so
+ * starting a prepare while the SDK has a session open leaves it alone. A
+ * session nobody adopts is disconnected after the idle timeout.
+ */
+
+#ifndef PRECONNECT_LINUX_H_
+#define PRECONNECT_LINUX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "udp_interface.h"
+
+/**
+ * @brief Return codes of nce_os_preconnect_start().
+ */
+enum
+{
+    NCE_PRECONNECT_SUCCESS = 0, /**< The background connect was started. */
+    NCE_PRECONNECT_BUSY = -1,   /**< A session is already being prepared or waiting to be adopted. */
+    NCE_PRECONNECT_ERROR = -2   /**< The background thread could not be started. */
+};
+
+/**
+ * @brief Counters of the pre-connect.
+ */
+typedef struct nce_os_preconnect_stats
+{
+    unsigned long prepared;  /**< Sessions established in the background. */
+    unsigned long failed;    /**< Background connects that failed. */
+    unsigned long adopted;   /**< Connects served by a prepared session. */
+    unsigned long waited;    /**< Adoptions that waited for the handshake to finish. */
+    unsigned long expired;   /**< Sessions disconnected after the idle timeout. */
+    unsigned long discarded; /**< Sessions dropped by a cancel or a connect to another endpoint. */
+} nce_os_preconnect_stats_t;
+
+/**
+ * @brief Start preparing a session in the background, e.g. when the link
+ * comes up.
+ *
+ * @param[in] ops: Network operations running the real connect, copied. The
+ * session is prepared for ops->os_socket, which is not touched until a
+ * connect on it adopts the session. Their connect must not be nce_os_preconnect_connect().
+ * @param[in] endpoint: Endpoint to connect to.
+ * @param[in] idleTimeoutMs: Time a prepared session waits to be adopted.
+ *
+ * @return One of the NCE_PRECONNECT_* codes.
+ */
+int nce_os_preconnect_start( const os_network_ops_t * ops,
+                             OSEndPoint_t endpoint,
+                             uint32_t idleTimeoutMs );
+
+/**
+ * @brief Connect adopting the prepared session, drop-in for
+ * os_network_ops_t::nce_os_udp_connect.
+ *
+ * Other network objects, and connects when nothing was prepared, use the
+ * connect given to nce_os_preconnect_start(), or nce_os_connect() before
+ * the first start.
+ *
+ * @param[in] osnetwork: Network object to connect.
+ * @param[in] endpoint: Endpoint to connect to.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+int nce_os_preconnect_connect( OSNetwork_t osnetwork,
+                               OSEndPoint_t endpoint );
+
+/**
+ * @brief Drop the prepared session, waiting for a running handshake.
+ */
+void nce_os_preconnect_cancel( void );
+
+/**
+ * @brief Copy the counters.
+ *
+ * @param[out] stats: Copy of the counters.
+ */
+void nce_os_preconnect_get_stats( nce_os_preconnect_stats_t * stats );
+
+#endif /* ifndef PRECONNECT_LINUX_H_ */
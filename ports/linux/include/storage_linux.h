@@ -0,0 +1,53 @@
+/**
+ * @file storage_linux.h
+ * @brief Storage of the Linux port: a memory-mapped file emulating NOR flash,
+ * e.g. to back the uplink queue (nce_uplink_queue.h) on a gateway.
+ */
+
+#ifndef STORAGE_LINUX_H_
+#define STORAGE_LINUX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "storage_interface.h"
+
+/**
+ * @typedef OSStorage_t
+ */
+struct OSStorage
+{
+    int fd;            /**< Open storage file. */
+    uint8_t * base;    /**< Shared mapping of the file. */
+    size_t size;       /**< Size of the mapping. */
+    size_t sectorSize; /**< Size of a sector. */
+};
+
+/**
+ * @brief Map a storage file, creating it erased if needed.
+ *
+ * Writes clear bits only and erases set a sector to 0xFF, as flash does.
+ * Writes reach the file through the shared mapping, so they survive the
+ * process being killed; sync flushes them to the disk.
+ *
+ * @param[out] osstorage: Storage object, owned by the caller.
+ * @param[in] path: File to map.
+ * @param[in] size: Size of the area, a multiple of sectorSize.
+ * @param[in] sectorSize: Size of a sector.
+ * @param[out] ops: Storage operations on the file.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int nce_storage_linux_open( OSStorage_t osstorage,
+                            const char * path,
+                            size_t size,
+                            size_t sectorSize,
+                            os_storage_ops_t * ops );
+
+/**
+ * @brief Unmap a storage file opened with nce_storage_linux_open().
+ *
+ * @param[in] ops: Storage operations on the file.
+ */
+void nce_storage_linux_close( os_storage_ops_t * ops );
+
+#endif /* ifndef STORAGE_LINUX_H_ */
@@ -0,0 +1,31 @@
+/**
+ * @file trace_chrome_linux.h
+ * @brief Trace sink of the Linux port writing the Chrome trace event format,
+ * to inspect SDK spans (nce_trace.h) in chrome://tracing or Perfetto.
+ */
+
+#ifndef TRACE_CHROME_LINUX_H_
+#define TRACE_CHROME_LINUX_H_
+
+#include "nce_trace.h"
+
+/**
+ * @brief Create a trace file and install the sink.
+ *
+ * Events of all threads go to the same file, one timeline row per thread.
+ * Time stamps are NceOSClockUs() extended to 64 bits.
+ *
+ * @param[in] path: File to write, truncated if it exists.
+ *
+ * @return 0 on success, -1 if the file cannot be created.
+ */
+int nce_trace_chrome_open( const char * path );
+
+/**
+ * @brief Remove the sink and complete the trace file.
+ *
+ * @return Number of events written, -1 if writing failed.
+ */
+long nce_trace_chrome_close( void );
+
+#endif /* ifndef TRACE_CHROME_LINUX_H_ */
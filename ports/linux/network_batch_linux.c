@@ -0,0 +1,415 @@
+/**
+ * @file network_batch_linux.c
+ * @brief Implements the batched network interface for Linux hosts.
+ *
+ * Receiving uses an epoll reactor: every ready connection is drained with a
+ * single recvmmsg call. Sending groups consecutive datagrams of a connection
+ * into one sendmmsg call. When built with NCE_SDK_LINUX_IO_URING, all sends
+ * of a batch, across any number of connections, are submitted with a single
+ * io_uring_enter call instead.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_PORT
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "log_interface.h"
+#include "network_batch_linux.h"
+
+#ifdef NCE_SDK_LINUX_IO_URING
+    #include <stdint.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <linux/io_uring.h>
+#endif
+
+/*-----------------------------------------------------------*/
+
+#ifdef NCE_SDK_LINUX_IO_URING
+
+/**
+ * @brief Map the submission and completion rings of a new io_uring.
+ *
+ * @param uring Ring to set up, fd is -1 if io_uring is not available.
+ */
+    static void prv_uring_setup( struct nce_uring * uring )
+    {
+        struct io_uring_params params;
+        char * sq;
+        char * cq;
+
+        memset( &params, 0, sizeof( params ) );
+        uring->fd = ( int ) syscall( __NR_io_uring_setup, NCE_SDK_BATCH_SIZE, &params );
+
+        if( uring->fd < 0 )
+        {
+            NceOSLogWarn( "[WRN] io_uring unavailable, using sendmmsg, errno %d\n", errno );
+            uring->fd = -1;
+            return;
+        }
+
+        uring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+        uring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+        uring->sqesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+        uring->sqRing = mmap( NULL, uring->sqRingSize, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING );
+        uring->cqRing = mmap( NULL, uring->cqRingSize, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING );
+        uring->sqes = mmap( NULL, uring->sqesSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES );
+
+        if( ( uring->sqRing == MAP_FAILED ) || ( uring->cqRing == MAP_FAILED ) || ( uring->sqes == MAP_FAILED ) )
+        {
+            NceOSLogWarn( "[WRN] io_uring mapping failed, using sendmmsg\n" );
+            close( uring->fd );
+            uring->fd = -1;
+            return;
+        }
+
+        sq = ( char * ) uring->sqRing;
+        cq = ( char * ) uring->cqRing;
+        uring->sqHead = ( unsigned * ) ( sq + params.sq_off.head );
+        uring->sqTail = ( unsigned * ) ( sq + params.sq_off.tail );
+        uring->sqMask = ( unsigned * ) ( sq + params.sq_off.ring_mask );
+        uring->sqArray = ( unsigned * ) ( sq + params.sq_off.array );
+        uring->cqHead = ( unsigned * ) ( cq + params.cq_off.head );
+        uring->cqTail = ( unsigned * ) ( cq + params.cq_off.tail );
+        uring->cqMask = ( unsigned * ) ( cq + params.cq_off.ring_mask );
+        uring->cqes = cq + params.cq_off.cqes;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Submit up to NCE_SDK_BATCH_SIZE sends and wait for their completion.
+ *
+ * @param osbatch Event loop owning the ring.
+ * @param pDatagrams Datagrams to send.
+ * @param count Number of datagrams (at most NCE_SDK_BATCH_SIZE).
+ * @return int Number of datagrams sent, negative error code otherwise.
+ */
+    static int prv_uring_send( OSNetworkBatch_t osbatch,
+                               os_datagram_t * pDatagrams,
+                               size_t count )
+    {
+        struct nce_uring * uring = &osbatch->uring;
+        struct io_uring_sqe * sqes = ( struct io_uring_sqe * ) uring->sqes;
+        struct io_uring_cqe * cqes = ( struct io_uring_cqe * ) uring->cqes;
+        unsigned tail = *uring->sqTail;
+        unsigned head;
+        size_t completed = 0;
+        int sent = 0;
+        size_t i;
+
+        for( i = 0; i < count; i++ )
+        {
+            unsigned index = tail & *uring->sqMask;
+            struct io_uring_sqe * sqe = &sqes[ index ];
+
+            memset( sqe, 0, sizeof( *sqe ) );
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = pDatagrams[ i ].osnetwork->os_socket;
+            sqe->addr = ( uint64_t ) ( uintptr_t ) pDatagrams[ i ].pBuffer;
+            sqe->len = ( uint32_t ) pDatagrams[ i ].length;
+            sqe->msg_flags = MSG_DONTWAIT;
+            sqe->user_data = i;
+            uring->sqArray[ index ] = index;
+            pDatagrams[ i ].result = -EAGAIN;
+            tail++;
+        }
+
+        __atomic_store_n( uring->sqTail, tail, __ATOMIC_RELEASE );
+
+        if( syscall( __NR_io_uring_enter, uring->fd, ( unsigned ) count, ( unsigned ) count,
+                     IORING_ENTER_GETEVENTS, NULL, 0 ) < 0 )
+        {
+            return -errno;
+        }
+
+        osbatch->syscalls++;
+        head = *uring->cqHead;
+
+        while( completed < count )
+        {
+            struct io_uring_cqe * cqe;
+
+            if( head == __atomic_load_n( uring->cqTail, __ATOMIC_ACQUIRE ) )
+            {
+                /* Completions are posted before io_uring_enter returns with GETEVENTS. */
+                break;
+            }
+
+            cqe = &cqes[ head & *uring->cqMask ];
+            pDatagrams[ cqe->user_data ].result = cqe->res;
+            sent += ( cqe->res >= 0 ) ? 1 : 0;
+            completed++;
+            head++;
+        }
+
+        __atomic_store_n( uring->cqHead, head, __ATOMIC_RELEASE );
+
+        return sent;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Unmap and close the io_uring.
+ *
+ * @param uring Ring to release.
+ */
+    static void prv_uring_teardown( struct nce_uring * uring )
+    {
+        if( uring->fd >= 0 )
+        {
+            munmap( uring->sqes, uring->sqesSize );
+            munmap( uring->cqRing, uring->cqRingSize );
+            munmap( uring->sqRing, uring->sqRingSize );
+            close( uring->fd );
+            uring->fd = -1;
+        }
+    }
+
+#endif /* ifdef NCE_SDK_LINUX_IO_URING */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send consecutive datagrams of one connection with a single sendmmsg.
+ *
+ * @param osbatch Event loop owning the message headers.
+ * @param pDatagrams Datagrams sharing the same connection.
+ * @param count Number of datagrams (at most NCE_SDK_BATCH_SIZE).
+ * @return int Number of datagrams sent, negative error code otherwise.
+ */
+static int prv_send_group( OSNetworkBatch_t osbatch,
+                           os_datagram_t * pDatagrams,
+                           size_t count )
+{
+    int sent;
+    size_t i;
+
+    for( i = 0; i < count; i++ )
+    {
+        osbatch->iovecs[ i ].iov_base = pDatagrams[ i ].pBuffer;
+        osbatch->iovecs[ i ].iov_len = pDatagrams[ i ].length;
+        memset( &osbatch->msgs[ i ], 0, sizeof( osbatch->msgs[ i ] ) );
+        osbatch->msgs[ i ].msg_hdr.msg_iov = &osbatch->iovecs[ i ];
+        osbatch->msgs[ i ].msg_hdr.msg_iovlen = 1;
+        pDatagrams[ i ].result = -EAGAIN;
+    }
+
+    sent = sendmmsg( pDatagrams[ 0 ].osnetwork->os_socket, osbatch->msgs, ( unsigned int ) count, MSG_DONTWAIT );
+    osbatch->syscalls++;
+
+    if( sent < 0 )
+    {
+        NceOSLogDebug( "[DBG] sendmmsg failed, errno %d\n", errno );
+        return -errno;
+    }
+
+    for( i = 0; i < ( size_t ) sent; i++ )
+    {
+        pDatagrams[ i ].result = ( int ) osbatch->msgs[ i ].msg_len;
+    }
+
+    return sent;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drain one readable connection into the free receive buffers.
+ *
+ * @param osbatch Event loop owning the message headers.
+ * @param osnetwork Readable connection.
+ * @param pDatagrams Free receive buffers.
+ * @param count Number of free receive buffers (at most NCE_SDK_BATCH_SIZE).
+ * @return int Number of datagrams received.
+ */
+static int prv_recv_connection( OSNetworkBatch_t osbatch,
+                                OSNetwork_t osnetwork,
+                                os_datagram_t * pDatagrams,
+                                size_t count )
+{
+    int received;
+    int i;
+
+    for( i = 0; i < ( int ) count; i++ )
+    {
+        osbatch->iovecs[ i ].iov_base = pDatagrams[ i ].pBuffer;
+        osbatch->iovecs[ i ].iov_len = pDatagrams[ i ].length;
+        memset( &osbatch->msgs[ i ], 0, sizeof( osbatch->msgs[ i ] ) );
+        osbatch->msgs[ i ].msg_hdr.msg_iov = &osbatch->iovecs[ i ];
+        osbatch->msgs[ i ].msg_hdr.msg_iovlen = 1;
+    }
+
+    received = recvmmsg( osnetwork->os_socket, osbatch->msgs, ( unsigned int ) count, MSG_DONTWAIT, NULL );
+    osbatch->syscalls++;
+
+    if( received < 0 )
+    {
+        /* Spurious wake-up or ICMP error queued on the socket. */
+        NceOSLogDebug( "[DBG] recvmmsg failed, errno %d\n", errno );
+        return 0;
+    }
+
+    for( i = 0; i < received; i++ )
+    {
+        pDatagrams[ i ].osnetwork = osnetwork;
+        pDatagrams[ i ].result = ( int ) osbatch->msgs[ i ].msg_len;
+    }
+
+    return received;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_batch_init( OSNetworkBatch_t osbatch )
+{
+    memset( osbatch, 0, sizeof( *osbatch ) );
+    osbatch->uring.fd = -1;
+    osbatch->epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+
+    if( osbatch->epoll_fd < 0 )
+    {
+        NceOSLogError( "[ERR] Failed to create epoll instance, errno %d\n", errno );
+        return -errno;
+    }
+
+    #ifdef NCE_SDK_LINUX_IO_URING
+        prv_uring_setup( &osbatch->uring );
+    #endif
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_os_batch_deinit( OSNetworkBatch_t osbatch )
+{
+    #ifdef NCE_SDK_LINUX_IO_URING
+        prv_uring_teardown( &osbatch->uring );
+    #endif
+
+    close( osbatch->epoll_fd );
+    osbatch->epoll_fd = -1;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_attach( OSNetworkBatch_t osbatch,
+                   OSNetwork_t osnetwork )
+{
+    struct epoll_event event;
+
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = osnetwork;
+
+    if( epoll_ctl( osbatch->epoll_fd, EPOLL_CTL_ADD, osnetwork->os_socket, &event ) != 0 )
+    {
+        NceOSLogError( "[ERR] Failed to attach socket %d, errno %d\n", osnetwork->os_socket, errno );
+        return -errno;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_detach( OSNetworkBatch_t osbatch,
+                   OSNetwork_t osnetwork )
+{
+    if( epoll_ctl( osbatch->epoll_fd, EPOLL_CTL_DEL, osnetwork->os_socket, NULL ) != 0 )
+    {
+        return -errno;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_send_batch( OSNetworkBatch_t osbatch,
+                       os_datagram_t * pDatagrams,
+                       size_t count )
+{
+    size_t start = 0;
+    int sent = 0;
+
+    while( start < count )
+    {
+        size_t end = start + 1;
+        int ret;
+
+        #ifdef NCE_SDK_LINUX_IO_URING
+            if( osbatch->uring.fd >= 0 )
+            {
+                end = ( count - start > NCE_SDK_BATCH_SIZE ) ? start + NCE_SDK_BATCH_SIZE : count;
+                ret = prv_uring_send( osbatch, &pDatagrams[ start ], end - start );
+            }
+            else
+        #endif
+        {
+            while( ( end < count ) && ( end - start < NCE_SDK_BATCH_SIZE ) &&
+                   ( pDatagrams[ end ].osnetwork == pDatagrams[ start ].osnetwork ) )
+            {
+                end++;
+            }
+
+            ret = prv_send_group( osbatch, &pDatagrams[ start ], end - start );
+        }
+
+        if( ret < 0 )
+        {
+            return ( sent > 0 ) ? sent : ret;
+        }
+
+        sent += ret;
+        start = end;
+    }
+
+    return sent;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_recv_batch( OSNetworkBatch_t osbatch,
+                       os_datagram_t * pDatagrams,
+                       size_t count,
+                       int timeoutMs )
+{
+    int ready;
+    int i;
+    size_t filled = 0;
+    int maxEvents = ( count < NCE_SDK_BATCH_SIZE ) ? ( int ) count : NCE_SDK_BATCH_SIZE;
+
+    ready = epoll_wait( osbatch->epoll_fd, osbatch->events, maxEvents, timeoutMs );
+    osbatch->syscalls++;
+
+    if( ready < 0 )
+    {
+        return ( errno == EINTR ) ? 0 : -errno;
+    }
+
+    for( i = 0; ( i < ready ) && ( filled < count ); i++ )
+    {
+        size_t space = count - filled;
+
+        if( space > NCE_SDK_BATCH_SIZE )
+        {
+            space = NCE_SDK_BATCH_SIZE;
+        }
+
+        filled += ( size_t ) prv_recv_connection( osbatch, ( OSNetwork_t ) osbatch->events[ i ].data.ptr,
+                                                  &pDatagrams[ filled ], space );
+    }
+
+    return ( int ) filled;
+}
@@ -0,0 +1,662 @@
+/**
+ * @file network_interface_linux.c
+ * @brief Implements the network interface for Linux hosts using POSIX UDP sockets.
+ *
+ * This port mirrors the Zephyr network interface, so host builds (tests,
+ * benchmarks and gateways) can drive the SDK with real sockets.
+ */
+
+#ifndef _POSIX_C_SOURCE
+    #define _POSIX_C_SOURCE    200809L
+#endif
+
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_PORT
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include "nce_iot_c_sdk.h"
+#include "log_interface.h"
+#include "network_interface_linux.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Apply a send or receive timeout to the socket.
+ *
+ * @param socket_num Socket to configure.
+ * @param option SO_SNDTIMEO or SO_RCVTIMEO.
+ * @param seconds Timeout in seconds.
+ */
+static void prv_set_timeout( int socket_num,
+                             int option,
+                             int seconds )
+{
+    struct timeval timeo;
+
+    timeo.tv_sec = seconds;
+    timeo.tv_usec = 0;
+
+    if( setsockopt( socket_num, SOL_SOCKET, option, &timeo, sizeof( timeo ) ) != 0 )
+    {
+        NceOSLogWarn( "[WRN] Failed to set socket timeout, errno %d\n", errno );
+    }
+}
+
+/**
+ * @brief One resolved address of the endpoint.
+ */
+typedef struct prv_address
+{
+    struct sockaddr_storage addr; /**< Address and port. */
+    socklen_t length;             /**< Used bytes of addr. */
+} prv_address_t;
+
+#if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 )
+
+/**
+ * @brief Last address that answered for an endpoint.
+ */
+    typedef struct prv_cache_entry
+    {
+        OSEndPoint_t endpoint; /**< Endpoint, empty host if the entry is free. */
+        prv_address_t address; /**< Address that answered. */
+    } prv_cache_entry_t;
+
+    static pthread_mutex_t prv_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+    static prv_cache_entry_t prv_cache[ NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE ];
+    static size_t prv_cache_next;
+
+    static int prv_same_endpoint( const OSEndPoint_t * a,
+                                  const OSEndPoint_t * b )
+    {
+        return ( a->port == b->port ) && ( strncmp( a->host, b->host, sizeof( a->host ) ) == 0 );
+    }
+#endif
+
+/* Message ID of the last CoAP ping, shared by concurrent connects. */
+static uint16_t prv_probe_id;
+
+/*-----------------------------------------------------------*/
+
+static int64_t prv_now_ms( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ( int64_t ) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_same_address( const prv_address_t * a,
+                             const prv_address_t * b )
+{
+    return ( a->length == b->length ) && ( memcmp( &a->addr, &b->addr, a->length ) == 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Resolve every host of the comma-separated list, IPv6 and IPv4,
+ * dropping duplicates.
+ *
+ * @return Number of addresses stored in candidates.
+ */
+static size_t prv_resolve( const OSEndPoint_t * endpoint,
+                           prv_address_t * candidates )
+{
+    char name[ sizeof( endpoint->host ) ];
+    char port[ 8 ];
+    struct addrinfo hints;
+    struct addrinfo * addr;
+    struct addrinfo * it;
+    size_t count = 0;
+    size_t offset = 0;
+    size_t length;
+    size_t i;
+
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf( port, sizeof( port ), "%d", endpoint->port );
+
+    while( ( offset < sizeof( endpoint->host ) ) && ( endpoint->host[ offset ] != '\0' ) )
+    {
+        for( length = 0; ( offset + length < sizeof( endpoint->host ) ) &&
+             ( endpoint->host[ offset + length ] != '\0' ) &&
+             ( endpoint->host[ offset + length ] != ',' ); length++ )
+        {
+        }
+
+        memcpy( name, &endpoint->host[ offset ], length );
+        name[ length ] = '\0';
+        offset += length + ( ( ( offset + length < sizeof( endpoint->host ) ) &&
+                               ( endpoint->host[ offset + length ] == ',' ) ) ? 1 : 0 );
+
+        if( ( length == 0 ) || ( getaddrinfo( name, port, &hints, &addr ) != 0 ) )
+        {
+            NceOSLogWarn( "[WRN] Failed to resolve %s\n", name );
+            continue;
+        }
+
+        for( it = addr; ( it != NULL ) && ( count < NCE_SDK_CONNECT_MAX_ADDRESSES ); it = it->ai_next )
+        {
+            if( ( ( it->ai_family != AF_INET ) && ( it->ai_family != AF_INET6 ) ) ||
+                ( it->ai_addrlen > sizeof( candidates[ count ].addr ) ) )
+            {
+                continue;
+            }
+
+            memset( &candidates[ count ], 0, sizeof( candidates[ count ] ) );
+            memcpy( &candidates[ count ].addr, it->ai_addr, it->ai_addrlen );
+            candidates[ count ].length = it->ai_addrlen;
+
+            for( i = 0; ( i < count ) && !prv_same_address( &candidates[ i ], &candidates[ count ] ); i++ )
+            {
+            }
+
+            count += ( i == count ) ? 1 : 0;
+        }
+
+        freeaddrinfo( addr );
+    }
+
+    return count;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Alternate the address families, starting with the family of the
+ * first address (RFC 8305, section 4), keeping the order within a family.
+ */
+static void prv_interleave( prv_address_t * candidates,
+                            size_t count )
+{
+    prv_address_t moved;
+    size_t i;
+    size_t j;
+
+    for( i = 1; i < count; i++ )
+    {
+        if( candidates[ i ].addr.ss_family != candidates[ i - 1 ].addr.ss_family )
+        {
+            continue;
+        }
+
+        /* Pull the next address of the other family forward. */
+        for( j = i + 1; ( j < count ) && ( candidates[ j ].addr.ss_family == candidates[ i - 1 ].addr.ss_family ); j++ )
+        {
+        }
+
+        if( j == count )
+        {
+            break;
+        }
+
+        moved = candidates[ j ];
+        memmove( &candidates[ i + 1 ], &candidates[ i ], ( j - i ) * sizeof( candidates[ 0 ] ) );
+        candidates[ i ] = moved;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Move the last address that answered for endpoint to the front.
+ *
+ * @return 0 if it is among the candidates, -1 otherwise.
+ */
+static int prv_cache_lookup( const OSEndPoint_t * endpoint,
+                             prv_address_t * candidates,
+                             size_t count )
+{
+    int found = -1;
+
+    #if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 )
+        prv_address_t moved;
+        size_t i;
+        size_t j;
+
+        pthread_mutex_lock( &prv_cache_lock );
+
+        for( i = 0; ( i < NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE ) && ( found < 0 ); i++ )
+        {
+            if( !prv_same_endpoint( &prv_cache[ i ].endpoint, endpoint ) )
+            {
+                continue;
+            }
+
+            for( j = 0; ( j < count ) && ( found < 0 ); j++ )
+            {
+                if( prv_same_address( &candidates[ j ], &prv_cache[ i ].address ) )
+                {
+                    moved = candidates[ j ];
+                    memmove( &candidates[ 1 ], &candidates[ 0 ], j * sizeof( candidates[ 0 ] ) );
+                    candidates[ 0 ] = moved;
+                    found = 0;
+                }
+            }
+        }
+
+        pthread_mutex_unlock( &prv_cache_lock );
+    #else /* if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 ) */
+        ( void ) endpoint;
+        ( void ) candidates;
+        ( void ) count;
+    #endif /* if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 ) */
+
+    return found;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Remember the address that answered for endpoint.
+ */
+static void prv_cache_store( const OSEndPoint_t * endpoint,
+                             const prv_address_t * address )
+{
+    #if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 )
+        size_t i;
+
+        pthread_mutex_lock( &prv_cache_lock );
+
+        for( i = 0; ( i < NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE ) &&
+             !prv_same_endpoint( &prv_cache[ i ].endpoint, endpoint ); i++ )
+        {
+        }
+
+        if( i == NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE )
+        {
+            i = prv_cache_next;
+            prv_cache_next = ( prv_cache_next + 1 ) % NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE;
+        }
+
+        memcpy( &prv_cache[ i ].endpoint, endpoint, sizeof( *endpoint ) );
+        prv_cache[ i ].address = *address;
+        pthread_mutex_unlock( &prv_cache_lock );
+    #else /* if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 ) */
+        ( void ) endpoint;
+        ( void ) address;
+    #endif /* if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 ) */
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Forget the address socket_num is connected to, after it stopped
+ * answering: the next connect races all addresses again.
+ */
+static void prv_cache_forget( int socket_num )
+{
+    #if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 )
+        prv_address_t peer;
+        size_t i;
+
+        memset( &peer, 0, sizeof( peer ) );
+        peer.length = sizeof( peer.addr );
+
+        if( getpeername( socket_num, ( struct sockaddr * ) &peer.addr, &peer.length ) != 0 )
+        {
+            return;
+        }
+
+        pthread_mutex_lock( &prv_cache_lock );
+
+        for( i = 0; i < NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE; i++ )
+        {
+            if( prv_same_address( &prv_cache[ i ].address, &peer ) )
+            {
+                memset( &prv_cache[ i ], 0, sizeof( prv_cache[ i ] ) );
+            }
+        }
+
+        pthread_mutex_unlock( &prv_cache_lock );
+    #else /* if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 ) */
+        ( void ) socket_num;
+    #endif /* if ( NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 ) */
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Open a UDP socket connected to address, sending a CoAP ping (empty
+ * Confirmable message, RFC 7252 section 4.3) when probing.
+ *
+ * @param probeId Receives the message ID of the ping, NULL not to probe.
+ *
+ * @return The socket, -1 on a local failure.
+ */
+static int prv_open( const prv_address_t * address,
+                     uint16_t * probeId )
+{
+    uint8_t ping[ 4 ] = { 0x40, 0x00, 0x00, 0x00 };
+    int probe = ( probeId != NULL );
+    int socket_num;
+
+    socket_num = socket( address->addr.ss_family, SOCK_DGRAM | ( probe ? SOCK_NONBLOCK : 0 ), 0 );
+
+    if( socket_num < 0 )
+    {
+        NceOSLogWarn( "[WRN] Failed to create socket, err %d\n", errno );
+        return -1;
+    }
+
+    if( connect( socket_num, ( const struct sockaddr * ) &address->addr, address->length ) != 0 )
+    {
+        NceOSLogWarn( "[WRN] Address unreachable, err %d\n", errno );
+        close( socket_num );
+        return -1;
+    }
+
+    if( probe )
+    {
+        *probeId = __atomic_add_fetch( &prv_probe_id, 1, __ATOMIC_RELAXED );
+        ping[ 2 ] = ( uint8_t ) ( *probeId >> 8 );
+        ping[ 3 ] = ( uint8_t ) *probeId;
+
+        if( send( socket_num, ping, sizeof( ping ), 0 ) < 0 )
+        {
+            close( socket_num );
+            return -1;
+        }
+    }
+
+    return socket_num;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Race the candidates: start one probed attempt after the other,
+ * the next one after NCE_SDK_CONNECT_ATTEMPT_DELAY_MS or when an attempt is
+ * refused, and keep the first that answers.
+ *
+ * @param[out] answered Index of the candidate that answered, count if none did.
+ * @param[out] probeId Message ID of the ping still unanswered on the kept
+ * attempt, -1 if it answered.
+ *
+ * @return Blocking socket of the kept attempt, -1 if all failed.
+ */
+static int prv_race( const prv_address_t * candidates,
+                     size_t count,
+                     size_t * answered,
+                     int * probeId )
+{
+    struct pollfd fds[ NCE_SDK_CONNECT_MAX_ADDRESSES ];
+    size_t which[ NCE_SDK_CONNECT_MAX_ADDRESSES ];
+    uint16_t ids[ NCE_SDK_CONNECT_MAX_ADDRESSES ];
+    uint8_t reply[ 64 ];
+    size_t active = 0;
+    size_t started = 0;
+    size_t i;
+    int64_t now = prv_now_ms();
+    int64_t nextStart = now;
+    int64_t deadline = now + NCE_SDK_CONNECT_TIMEOUT_MS;
+    int64_t wait;
+    int kept = -1;
+    int fd;
+
+    *answered = count;
+    *probeId = -1;
+
+    while( ( *answered == count ) && ( now < deadline ) )
+    {
+        if( ( started < count ) && ( now >= nextStart ) )
+        {
+            fd = prv_open( &candidates[ started ], &ids[ active ] );
+
+            if( fd >= 0 )
+            {
+                fds[ active ].fd = fd;
+                fds[ active ].events = POLLIN;
+                which[ active++ ] = started;
+                nextStart = now + NCE_SDK_CONNECT_ATTEMPT_DELAY_MS;
+            }
+
+            started++;
+            continue;
+        }
+
+        if( ( active == 0 ) && ( started == count ) )
+        {
+            break;
+        }
+
+        wait = ( ( started < count ) && ( nextStart < deadline ) ) ? nextStart - now : deadline - now;
+        ( void ) poll( fds, active, ( int ) wait );
+
+        for( i = 0; ( i < active ) && ( *answered == count ); )
+        {
+            if( fds[ i ].revents == 0 )
+            {
+                i++;
+            }
+            else if( recv( fds[ i ].fd, reply, sizeof( reply ), 0 ) >= 0 )
+            {
+                *answered = which[ i ];
+                kept = fds[ i ].fd;
+            }
+            else if( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+            {
+                i++;
+            }
+            else
+            {
+                /* Refused: drop the attempt and start the next one now. */
+                close( fds[ i ].fd );
+                active--;
+                memmove( &fds[ i ], &fds[ i + 1 ], ( active - i ) * sizeof( fds[ 0 ] ) );
+                memmove( &which[ i ], &which[ i + 1 ], ( active - i ) * sizeof( which[ 0 ] ) );
+                memmove( &ids[ i ], &ids[ i + 1 ], ( active - i ) * sizeof( ids[ 0 ] ) );
+                nextStart = prv_now_ms();
+            }
+        }
+
+        now = prv_now_ms();
+    }
+
+    /* Without an answer, use the preferred attempt not refused. Its ping may
+     * still be answered and is filtered by nce_os_recv(). */
+    if( ( kept < 0 ) && ( active > 0 ) )
+    {
+        kept = fds[ 0 ].fd;
+        *probeId = ids[ 0 ];
+    }
+
+    for( i = 0; i < active; i++ )
+    {
+        if( fds[ i ].fd != kept )
+        {
+            close( fds[ i ].fd );
+        }
+    }
+
+    if( kept >= 0 )
+    {
+        ( void ) fcntl( kept, F_SETFL, fcntl( kept, F_GETFL ) & ~O_NONBLOCK );
+    }
+
+    return kept;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_connect( OSNetwork_t osnetwork,
+                    OSEndPoint_t endpoint )
+{
+    return nce_os_connect_v2( osnetwork, &endpoint );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_connect_v2( OSNetwork_t osnetwork,
+                       const OSEndPoint_t * endpoint )
+{
+    prv_address_t candidates[ NCE_SDK_CONNECT_MAX_ADDRESSES ];
+    size_t count;
+    size_t used;
+    int socket_num;
+    int probeId = -1;
+    int cached;
+
+    NCE_TRACE_BEGIN( NCE_TRACE_DNS );
+    count = prv_resolve( endpoint, candidates );
+    NCE_TRACE_END( NCE_TRACE_DNS, ( count == 0 ) ? -1 : 0 );
+
+    if( count == 0 )
+    {
+        NceOSLogError( "[ERR] Failed to resolve address\n" );
+        return NCE_SDK_CONNECT_ERROR;
+    }
+
+    prv_interleave( candidates, count );
+    cached = prv_cache_lookup( endpoint, candidates, count );
+
+    if( ( cached == 0 ) || ( count == 1 ) ||
+        ( ( NCE_SDK_CONNECT_PROBE_PORT != 0 ) && ( endpoint->port != NCE_SDK_CONNECT_PROBE_PORT ) ) )
+    {
+        /* One after the other: only local failures are detected. */
+        socket_num = -1;
+
+        for( used = 0; ( used < count ) && ( socket_num < 0 ); used++ )
+        {
+            socket_num = prv_open( &candidates[ used ], NULL );
+        }
+    }
+    else
+    {
+        socket_num = prv_race( candidates, count, &used, &probeId );
+
+        if( used < count )
+        {
+            prv_cache_store( endpoint, &candidates[ used ] );
+        }
+    }
+
+    if( socket_num < 0 )
+    {
+        NceOSLogError( "[ERR] Failed to Connect to 1NCE Endpoint\n" );
+        return NCE_SDK_CONNECT_ERROR;
+    }
+
+    prv_set_timeout( socket_num, SO_SNDTIMEO, NCE_SDK_SEND_TIMEOUT_SECONDS );
+    prv_set_timeout( socket_num, SO_RCVTIMEO, NCE_SDK_RECV_TIMEOUT_SECONDS );
+
+    osnetwork->os_socket = socket_num;
+    osnetwork->probe_id = probeId;
+    NceOSLogDebug( "[DBG] Socket Connect: %d\n", socket_num );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_send( OSNetwork_t osnetwork,
+                 void * pBuffer,
+                 size_t bytesToSend )
+{
+    int ret;
+
+    ret = ( int ) send( osnetwork->os_socket, pBuffer, bytesToSend, 0 );
+
+    NceOSLogDebug( "[DBG] Socket Send: %d\n", ret );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Check for the answer to the CoAP ping of a race nobody won in time:
+ * an empty ACK or RST (RFC 7252 section 4.2 and 4.3) with the message ID of
+ * the ping. It is not for the caller and is dropped.
+ *
+ * @return 1 if the datagram is the late answer.
+ */
+static int prv_late_probe_reply( OSNetwork_t osnetwork,
+                                 const uint8_t * datagram,
+                                 int length )
+{
+    if( ( osnetwork->probe_id < 0 ) || ( length != 4 ) ||
+        ( ( datagram[ 0 ] != 0x60u ) && ( datagram[ 0 ] != 0x70u ) ) || ( datagram[ 1 ] != 0x00u ) ||
+        ( ( ( datagram[ 2 ] << 8 ) | datagram[ 3 ] ) != osnetwork->probe_id ) )
+    {
+        return 0;
+    }
+
+    NceOSLogDebug( "[DBG] Late answer to the connect probe dropped\n" );
+    osnetwork->probe_id = -1;
+
+    return 1;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_recv( OSNetwork_t osnetwork,
+                 void * pBuffer,
+                 size_t bytesToRecv )
+{
+    int ret;
+
+    do
+    {
+        ret = ( int ) recv( osnetwork->os_socket, pBuffer, bytesToRecv, 0 );
+    } while( prv_late_probe_reply( osnetwork, pBuffer, ret ) );
+
+    if( ( ret < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+    {
+        /* The interface reports a timeout as zero bytes received. */
+        ret = 0;
+    }
+
+    if( ret <= 0 )
+    {
+        prv_cache_forget( osnetwork->os_socket );
+    }
+
+    NceOSLogDebug( "[DBG] Socket Receive: %d\n", ret );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_set_recv_timeout( OSNetwork_t osnetwork,
+                             uint32_t ms )
+{
+    struct timeval timeo;
+
+    timeo.tv_sec = ( time_t ) ( ms / 1000u );
+    timeo.tv_usec = ( suseconds_t ) ( ( ms % 1000u ) * 1000u );
+
+    return setsockopt( osnetwork->os_socket, SOL_SOCKET, SO_RCVTIMEO, &timeo, sizeof( timeo ) );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_disconnect( OSNetwork_t osnetwork )
+{
+    int err;
+
+    err = close( osnetwork->os_socket );
+    osnetwork->os_socket = -1;
+    osnetwork->probe_id = -1;
+
+    NceOSLogDebug( "[DBG] Socket Disconnect: %d\n", err );
+
+    return err;
+}
@@ -0,0 +1,277 @@
+/**
+ * @file preconnect_linux.c
+ * @brief Implements the speculative pre-connect of the Linux port.
+ *
+ * A background thread runs the real connect without holding the lock, then
+ * publishes the session and waits, with a timed condition wait, for it to be
+ * adopted. The session is prepared on a network object of its own and copied
+ * into the network object the SDK connects when it is adopted, so a socket
+ * the application has open on that object is never replaced or closed.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "network_interface_linux.h"
+#include "preconnect_linux.h"
+
+/**
+ * @brief Life cycle of the prepared session.
+ */
+typedef enum prv_preconnect_state
+{
+    PRV_PRECONNECT_IDLE = 0,   /**< Nothing prepared. */
+    PRV_PRECONNECT_CONNECTING, /**< Background connect running. */
+    PRV_PRECONNECT_READY       /**< Connected, waiting to be adopted. */
+} prv_preconnect_state_t;
+
+/**
+ * @brief The one prepared session.
+ */
+typedef struct prv_preconnect
+{
+    pthread_mutex_t lock;            /**< Protects the other fields. */
+    pthread_cond_t changed;          /**< Signaled on every state change. */
+    pthread_t thread;                /**< Background thread of the last start. */
+    int joinable;                    /**< Set while thread has not been joined. */
+    prv_preconnect_state_t state;    /**< Life cycle. */
+    os_network_ops_t ops;            /**< Real operations. */
+    OSNetwork_t target;              /**< Network object the session is prepared for. */
+    struct OSNetwork session;        /**< Network object holding the session until adopted. */
+    OSEndPoint_t endpoint;           /**< Endpoint of the session. */
+    uint32_t idleTimeoutMs;          /**< Time the session waits to be adopted. */
+    nce_os_preconnect_stats_t stats; /**< Counters. */
+} prv_preconnect_t;
+
+static prv_preconnect_t preconnect =
+{
+    .lock    = PTHREAD_MUTEX_INITIALIZER,
+    .changed = PTHREAD_COND_INITIALIZER
+};
+
+/*-----------------------------------------------------------*/
+
+static void prv_deadline( struct timespec * deadline,
+                          uint32_t ms )
+{
+    clock_gettime( CLOCK_REALTIME, deadline );
+    deadline->tv_sec += ( time_t ) ( ms / 1000u );
+    deadline->tv_nsec += ( long ) ( ms % 1000u ) * 1000000L;
+
+    if( deadline->tv_nsec >= 1000000000L )
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Disconnect a session nobody adopted. Called with the lock held.
+ */
+static void prv_drop( unsigned long * counter )
+{
+    preconnect.ops.nce_os_udp_disconnect( &preconnect.session );
+    preconnect.state = PRV_PRECONNECT_IDLE;
+    ( *counter )++;
+    pthread_cond_broadcast( &preconnect.changed );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prv_preconnect_run( void * arg )
+{
+    struct timespec deadline;
+    int err;
+
+    ( void ) arg;
+
+    /* DNS and handshake run unlocked, adopters wait on the state. */
+    err = preconnect.ops.nce_os_udp_connect( &preconnect.session, preconnect.endpoint );
+
+    pthread_mutex_lock( &preconnect.lock );
+    preconnect.state = ( err == 0 ) ? PRV_PRECONNECT_READY : PRV_PRECONNECT_IDLE;
+    preconnect.stats.prepared += ( err == 0 ) ? 1u : 0u;
+    preconnect.stats.failed += ( err == 0 ) ? 0u : 1u;
+    pthread_cond_broadcast( &preconnect.changed );
+    prv_deadline( &deadline, preconnect.idleTimeoutMs );
+
+    while( ( preconnect.state == PRV_PRECONNECT_READY ) &&
+           ( pthread_cond_timedwait( &preconnect.changed, &preconnect.lock, &deadline ) != ETIMEDOUT ) )
+    {
+    }
+
+    if( preconnect.state == PRV_PRECONNECT_READY )
+    {
+        prv_drop( &preconnect.stats.expired );
+    }
+
+    pthread_mutex_unlock( &preconnect.lock );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Adopt the session prepared for osnetwork, waiting for its handshake,
+ * and move it into osnetwork. Called with the lock held.
+ *
+ * @return 1 if the session was adopted.
+ */
+static int prv_adopt( OSNetwork_t osnetwork,
+                      const OSEndPoint_t * endpoint )
+{
+    int waited = 0;
+
+    if( osnetwork != preconnect.target )
+    {
+        return 0;
+    }
+
+    while( preconnect.state == PRV_PRECONNECT_CONNECTING )
+    {
+        waited = 1;
+        pthread_cond_wait( &preconnect.changed, &preconnect.lock );
+    }
+
+    if( preconnect.state != PRV_PRECONNECT_READY )
+    {
+        return 0;
+    }
+
+    if( ( endpoint->port != preconnect.endpoint.port ) ||
+        ( strncmp( endpoint->host, preconnect.endpoint.host, sizeof( endpoint->host ) ) != 0 ) )
+    {
+        /* Prepared for another endpoint: free the network object. */
+        prv_drop( &preconnect.stats.discarded );
+        return 0;
+    }
+
+    *osnetwork = preconnect.session;
+    preconnect.state = PRV_PRECONNECT_IDLE;
+    preconnect.stats.adopted++;
+    preconnect.stats.waited += ( unsigned long ) waited;
+    pthread_cond_broadcast( &preconnect.changed );
+
+    return 1;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_preconnect_start( const os_network_ops_t * ops,
+                             OSEndPoint_t endpoint,
+                             uint32_t idleTimeoutMs )
+{
+    pthread_t previous;
+    int joinable;
+    int started;
+
+    pthread_mutex_lock( &preconnect.lock );
+
+    if( preconnect.state != PRV_PRECONNECT_IDLE )
+    {
+        pthread_mutex_unlock( &preconnect.lock );
+        return NCE_PRECONNECT_BUSY;
+    }
+
+    preconnect.state = PRV_PRECONNECT_CONNECTING;
+    preconnect.ops = *ops;
+    preconnect.target = ops->os_socket;
+    memcpy( &preconnect.endpoint, &endpoint, sizeof( endpoint ) );
+    preconnect.idleTimeoutMs = idleTimeoutMs;
+    previous = preconnect.thread;
+    joinable = preconnect.joinable;
+    preconnect.joinable = 0;
+    pthread_mutex_unlock( &preconnect.lock );
+
+    /* The previous thread has seen its session adopted or dropped and exits. */
+    if( joinable )
+    {
+        pthread_join( previous, NULL );
+    }
+
+    pthread_mutex_lock( &preconnect.lock );
+    started = ( pthread_create( &preconnect.thread, NULL, prv_preconnect_run, NULL ) == 0 );
+    preconnect.joinable = started;
+
+    if( !started )
+    {
+        preconnect.state = PRV_PRECONNECT_IDLE;
+        pthread_cond_broadcast( &preconnect.changed );
+    }
+
+    pthread_mutex_unlock( &preconnect.lock );
+
+    return started ? NCE_PRECONNECT_SUCCESS : NCE_PRECONNECT_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_preconnect_connect( OSNetwork_t osnetwork,
+                               OSEndPoint_t endpoint )
+{
+    int ( * realConnect )( OSNetwork_t, OSEndPoint_t ) = nce_os_connect;
+
+    pthread_mutex_lock( &preconnect.lock );
+
+    if( prv_adopt( osnetwork, &endpoint ) )
+    {
+        pthread_mutex_unlock( &preconnect.lock );
+        return 0;
+    }
+
+    if( preconnect.ops.nce_os_udp_connect != NULL )
+    {
+        realConnect = preconnect.ops.nce_os_udp_connect;
+    }
+
+    pthread_mutex_unlock( &preconnect.lock );
+
+    return realConnect( osnetwork, endpoint );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_os_preconnect_cancel( void )
+{
+    pthread_t thread;
+    int joinable;
+
+    pthread_mutex_lock( &preconnect.lock );
+
+    while( preconnect.state == PRV_PRECONNECT_CONNECTING )
+    {
+        pthread_cond_wait( &preconnect.changed, &preconnect.lock );
+    }
+
+    if( preconnect.state == PRV_PRECONNECT_READY )
+    {
+        prv_drop( &preconnect.stats.discarded );
+    }
+
+    thread = preconnect.thread;
+    joinable = preconnect.joinable;
+    preconnect.joinable = 0;
+    pthread_mutex_unlock( &preconnect.lock );
+
+    if( joinable )
+    {
+        pthread_join( thread, NULL );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_os_preconnect_get_stats( nce_os_preconnect_stats_t * stats )
+{
+    pthread_mutex_lock( &preconnect.lock );
+    *stats = preconnect.stats;
+    pthread_mutex_unlock( &preconnect.lock );
+}
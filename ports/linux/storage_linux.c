@@ -0,0 +1,160 @@
+/**
+ * @file storage_linux.c
+ * @brief Implements the storage interface on a memory-mapped file.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "storage_linux.h"
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_in_range( OSStorage_t osstorage,
+                                 size_t offset,
+                                 size_t length )
+{
+    return ( offset <= osstorage->size ) && ( length <= osstorage->size - offset );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_read( OSStorage_t osstorage,
+                             size_t offset,
+                             void * pBuffer,
+                             size_t length )
+{
+    if( !prv_storage_in_range( osstorage, offset, length ) )
+    {
+        return -1;
+    }
+
+    memcpy( pBuffer, osstorage->base + offset, length );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_write( OSStorage_t osstorage,
+                              size_t offset,
+                              const void * pBuffer,
+                              size_t length )
+{
+    const uint8_t * bytes = ( const uint8_t * ) pBuffer;
+    size_t i;
+
+    if( !prv_storage_in_range( osstorage, offset, length ) || ( ( offset | length ) & 3u ) )
+    {
+        return -1;
+    }
+
+    /* Programming flash only clears bits. */
+    for( i = 0; i < length; i++ )
+    {
+        osstorage->base[ offset + i ] &= bytes[ i ];
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_erase( OSStorage_t osstorage,
+                              size_t offset )
+{
+    if( !prv_storage_in_range( osstorage, offset, osstorage->sectorSize ) || ( offset % osstorage->sectorSize ) )
+    {
+        return -1;
+    }
+
+    memset( osstorage->base + offset, 0xFF, osstorage->sectorSize );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_sync( OSStorage_t osstorage )
+{
+    return msync( osstorage->base, osstorage->size, MS_SYNC );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_storage_linux_open( OSStorage_t osstorage,
+                            const char * path,
+                            size_t size,
+                            size_t sectorSize,
+                            os_storage_ops_t * ops )
+{
+    struct stat st;
+    int fd = -1;
+    int status = -1;
+    int created = 0;
+
+    if( ( sectorSize > 0 ) && ( size > 0 ) && ( ( size % sectorSize ) == 0 ) )
+    {
+        fd = open( path, O_RDWR | O_CREAT | O_CLOEXEC, 0600 );
+    }
+
+    if( ( fd >= 0 ) && ( fstat( fd, &st ) == 0 ) )
+    {
+        /* A new or resized file starts erased. */
+        created = ( ( size_t ) st.st_size != size );
+        status = ( created && ( ftruncate( fd, ( off_t ) size ) != 0 ) ) ? -1 : 0;
+    }
+
+    if( status == 0 )
+    {
+        osstorage->base = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        status = ( osstorage->base == MAP_FAILED ) ? -1 : 0;
+    }
+
+    if( status == 0 )
+    {
+        if( created )
+        {
+            memset( osstorage->base, 0xFF, size );
+        }
+
+        osstorage->fd = fd;
+        osstorage->size = size;
+        osstorage->sectorSize = sectorSize;
+
+        ops->os_storage = osstorage;
+        ops->size = size;
+        ops->sectorSize = sectorSize;
+        ops->nce_os_storage_read = prv_storage_read;
+        ops->nce_os_storage_write = prv_storage_write;
+        ops->nce_os_storage_erase = prv_storage_erase;
+        ops->nce_os_storage_sync = prv_storage_sync;
+    }
+    else if( fd >= 0 )
+    {
+        close( fd );
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_storage_linux_close( os_storage_ops_t * ops )
+{
+    OSStorage_t osstorage = ops->os_storage;
+
+    if( osstorage != NULL )
+    {
+        munmap( osstorage->base, osstorage->size );
+        close( osstorage->fd );
+        ops->os_storage = NULL;
+    }
+}
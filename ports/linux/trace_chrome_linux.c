@@ -0,0 +1,115 @@
+/**
+ * @file trace_chrome_linux.c
+ * @brief Implements the Chrome trace event sink of the Linux port.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "trace_chrome_linux.h"
+
+#ifdef NCE_SDK_TRACE
+
+/**
+ * @brief State of the open trace file, shared by all threads.
+ */
+static struct
+{
+    FILE * file;
+    long events;
+    uint32_t lastUs;
+    uint64_t highUs;
+    pthread_mutex_t lock;
+} chromeTrace = { NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write one event, called by nce_trace.c.
+ */
+static void prv_chrome_sink( void * arg,
+                             const nce_trace_event_t * event )
+{
+    long tid = ( long ) syscall( SYS_gettid );
+
+    ( void ) arg;
+    pthread_mutex_lock( &chromeTrace.lock );
+
+    if( chromeTrace.file != NULL )
+    {
+        /* Extend the 32-bit clock, it wraps every ~71 minutes. */
+        if( event->timestampUs < chromeTrace.lastUs )
+        {
+            chromeTrace.highUs += ( uint64_t ) 1 << 32;
+        }
+
+        chromeTrace.lastUs = event->timestampUs;
+        fprintf( chromeTrace.file,
+                 "%s\n{\"name\":\"%s\",\"cat\":\"nce\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%ld,\"tid\":%ld,"
+                 "\"args\":{\"op\":%u,\"status\":%d}}",
+                 ( chromeTrace.events > 0 ) ? "," : "", event->name, event->phase,
+                 ( unsigned long long ) ( chromeTrace.highUs + event->timestampUs ), ( long ) getpid(), tid,
+                 ( unsigned int ) event->opId, event->status );
+        chromeTrace.events++;
+    }
+
+    pthread_mutex_unlock( &chromeTrace.lock );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_trace_chrome_open( const char * path )
+{
+    FILE * file = fopen( path, "w" );
+
+    if( file == NULL )
+    {
+        return -1;
+    }
+
+    fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file );
+    pthread_mutex_lock( &chromeTrace.lock );
+    chromeTrace.file = file;
+    chromeTrace.events = 0;
+    chromeTrace.lastUs = 0;
+    chromeTrace.highUs = 0;
+    pthread_mutex_unlock( &chromeTrace.lock );
+    nce_trace_set_sink( prv_chrome_sink, NULL );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+long nce_trace_chrome_close( void )
+{
+    FILE * file;
+    long events;
+    int failed;
+
+    nce_trace_set_sink( NULL, NULL );
+    pthread_mutex_lock( &chromeTrace.lock );
+    file = chromeTrace.file;
+    events = chromeTrace.events;
+    chromeTrace.file = NULL;
+    pthread_mutex_unlock( &chromeTrace.lock );
+
+    if( file == NULL )
+    {
+        return -1;
+    }
+
+    fputs( "\n]}\n", file );
+    failed = ferror( file );
+    failed |= fclose( file );
+
+    return failed ? -1 : events;
+}
+
+#endif /* ifdef NCE_SDK_TRACE */
@@ -4,6 +4,8 @@
  * @date 07 November 2024
  */
 
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_PORT
+
 #include <zephyr/kernel.h>
 #include <stdio.h>
 #include <modem/lte_lc.h>
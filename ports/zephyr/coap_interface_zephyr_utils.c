@@ -4,6 +4,8 @@
  * @date 07 November 2024
  */
 
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_PORT
+
 #include <zephyr/kernel.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -16,8 +18,10 @@
 #include <network_interface_zephyr.h>
 #include <coap_interface_zephyr.h>
 #include <coap_interface_zephyr_utils.h>
+#ifdef CONFIG_NCE_SDK_OSCORE
+    #include "nce_oscore.h"
+#endif
 
-#define MAX_COAP_MSG_LEN           1024
 #define COAP_CODE_CLASS_SIZE       32
 #define COAP_SUCCESS_CODE_CLASS    2
 
@@ -25,14 +29,20 @@ LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
 
 int nce_connect_to_coap_server( os_network_ops_t * osNetwork,
                                 OSEndPoint_t coap_server )
+{
+    return nce_connect_to_coap_server_v2( osNetwork, &coap_server );
+}
+
+int nce_connect_to_coap_server_v2( os_network_ops_t * osNetwork,
+                                   const OSEndPoint_t * coap_server )
 {
     int err = NCE_SDK_SUCCESS;
 
-    err = nce_os_connect( osNetwork->os_socket, coap_server );
+    err = osNetwork->nce_os_udp_connect( osNetwork->os_socket, *coap_server );
 
     if( err )
     {
-        NceOSLogError( "[ERR] Failed to Connect to CoAP server, Host: %s, Port: %d\n", coap_server.host, coap_server.port );
+        NceOSLogError( "[ERR] Failed to Connect to CoAP server, Host: %s, Port: %d\n", coap_server->host, coap_server->port );
         return err;
     }
 
@@ -40,6 +50,8 @@ int nce_connect_to_coap_server( os_network_ops_t * osNetwork,
 }
 
 int nce_coap_request( struct coap_packet * coap_packet,
+                      uint8_t * buffer,
+                      uint16_t buffer_len,
                       uint8_t coap_method,
                       const char * uriPath,
                       const char * uriQuery,
@@ -48,19 +60,13 @@ int nce_coap_request( struct coap_packet * coap_packet,
                       const char * payload,
                       uint16_t payload_len )
 {
-    uint8_t * data = ( uint8_t * ) k_malloc( MAX_COAP_MSG_LEN );
-
-    if( !data )
-    {
-        return -ENOMEM;
-    }
-
-    int r = nce_coap_init( coap_packet, data, MAX_COAP_MSG_LEN, COAP_VERSION_1, COAP_TYPE_CON, COAP_METHOD_POST );
+    /* The packet points into buffer, which must outlive the send. */
+    int r = nce_coap_init( coap_packet, buffer, buffer_len, COAP_VERSION_1, COAP_TYPE_CON, coap_method );
 
     if( r < 0 )
     {
         NceOSLogError( "[ERR] Failed to init CoAP message\n" );
-        goto end;
+        return r;
     }
 
     /* Append URI Path if provided */
@@ -71,7 +77,7 @@ int nce_coap_request( struct coap_packet * coap_packet,
         if( r < 0 )
         {
             NceOSLogError( "[ERR] Unable to add URI Path option (%s) to request\n", uriPath );
-            goto end;
+            return r;
         }
     }
 
@@ -81,7 +87,7 @@ int nce_coap_request( struct coap_packet * coap_packet,
     if( r < 0 )
     {
         NceOSLogError( "[ERR] Unable to add content Format option to request\n" );
-        goto end;
+        return r;
     }
 
     /* Append URI Query if provided */
@@ -92,7 +98,7 @@ int nce_coap_request( struct coap_packet * coap_packet,
         if( r < 0 )
         {
             NceOSLogError( "[ERR] Unable to add URI Query option (%s) to request\n", uriQuery );
-            goto end;
+            return r;
         }
     }
 
@@ -104,7 +110,7 @@ int nce_coap_request( struct coap_packet * coap_packet,
         if( r < 0 )
         {
             NceOSLogError( "[ERR] Unable to add Proxy URI option (%s) to request\n", proxyUri );
-            goto end;
+            return r;
         }
     }
 
@@ -115,12 +121,10 @@ int nce_coap_request( struct coap_packet * coap_packet,
         if( r < 0 )
         {
             NceOSLogError( "[ERR] Unable to append payload (length: %d)\n", payload_len );
-            goto end;
+            return r;
         }
     }
 
-end:
-    k_free( data );
     return r;
 }
 
@@ -159,3 +163,59 @@ void print_coap_header( struct coap_packet * packet )
     check_and_print_coap_response_code( packet );
     NceOSLogInfo( "[INF] Message ID: %u\n", coap_header_get_id( packet ) );
 }
+
+#ifdef CONFIG_NCE_SDK_OSCORE
+
+int nce_coap_oscore_exchange( os_network_ops_t * osNetwork,
+                              nce_oscore_context_t * oscore,
+                              const struct coap_packet * coap_packet,
+                              uint8_t * buffer,
+                              size_t buffer_len,
+                              uint8_t * response,
+                              size_t response_len )
+{
+    nce_oscore_request_t request;
+    int length;
+    int received;
+
+    length = nce_oscore_protect_request( oscore, coap_packet->data, coap_packet->offset, buffer, buffer_len, &request );
+
+    if( length < 0 )
+    {
+        NceOSLogError( "[ERR] Unable to protect CoAP request, err %d\n", length );
+        return length;
+    }
+
+    length = osNetwork->nce_os_udp_send( osNetwork->os_socket, buffer, ( size_t ) length );
+
+    if( length < 0 )
+    {
+        NceOSLogError( "[ERR] Unable to send OSCORE request, err %d\n", length );
+        return length;
+    }
+
+    if( coap_header_get_type( ( struct coap_packet * ) coap_packet ) != COAP_TYPE_CON )
+    {
+        return 0;
+    }
+
+    /* The protected request is no longer needed: receive into its buffer. */
+    received = osNetwork->nce_os_udp_recv( osNetwork->os_socket, buffer, buffer_len );
+
+    if( received <= 0 )
+    {
+        NceOSLogError( "[ERR] No OSCORE response, err %d\n", received );
+        return ( received < 0 ) ? received : NCE_SDK_RECEIVE_ERROR;
+    }
+
+    length = nce_oscore_unprotect_response( oscore, &request, buffer, ( size_t ) received, response, response_len );
+
+    if( length < 0 )
+    {
+        NceOSLogError( "[ERR] OSCORE response does not verify, err %d\n", length );
+    }
+
+    return length;
+}
+
+#endif /* ifdef CONFIG_NCE_SDK_OSCORE */
@@ -0,0 +1,87 @@
+/**
+ * @file crypto_zephyr.c
+ * @brief Implements the crypto interface on Zephyr with mbed TLS (HKDF and
+ * CCM modules).
+ */
+
+#include <mbedtls/ccm.h>
+#include <mbedtls/hkdf.h>
+#include <mbedtls/md.h>
+#include "crypto_interface.h"
+
+/*-----------------------------------------------------------*/
+
+int nce_os_hkdf_sha256( const uint8_t * salt,
+                        size_t saltLength,
+                        const uint8_t * ikm,
+                        size_t ikmLength,
+                        const uint8_t * info,
+                        size_t infoLength,
+                        uint8_t * okm,
+                        size_t okmLength )
+{
+    return ( mbedtls_hkdf( mbedtls_md_info_from_type( MBEDTLS_MD_SHA256 ), salt, saltLength, ikm, ikmLength,
+                           info, infoLength, okm, okmLength ) == 0 ) ? 0 : -1;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_aes_ccm_encrypt( const uint8_t * key,
+                            const uint8_t * nonce,
+                            const uint8_t * aad,
+                            size_t aadLength,
+                            const uint8_t * plaintext,
+                            size_t length,
+                            uint8_t * ciphertext )
+{
+    mbedtls_ccm_context ctx;
+    int err;
+
+    mbedtls_ccm_init( &ctx );
+    err = mbedtls_ccm_setkey( &ctx, MBEDTLS_CIPHER_ID_AES, key, NCE_CRYPTO_CCM_KEY_LENGTH * 8u );
+
+    /* mbed TLS encrypts in place when input and output are the same buffer. */
+    if( err == 0 )
+    {
+        err = mbedtls_ccm_encrypt_and_tag( &ctx, length, nonce, NCE_CRYPTO_CCM_NONCE_LENGTH, aad, aadLength,
+                                           plaintext, ciphertext, ciphertext + length, NCE_CRYPTO_CCM_TAG_LENGTH );
+    }
+
+    mbedtls_ccm_free( &ctx );
+
+    return ( err == 0 ) ? 0 : -1;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_aes_ccm_decrypt( const uint8_t * key,
+                            const uint8_t * nonce,
+                            const uint8_t * aad,
+                            size_t aadLength,
+                            const uint8_t * ciphertext,
+                            size_t length,
+                            uint8_t * plaintext )
+{
+    mbedtls_ccm_context ctx;
+    size_t plainLength;
+    int err;
+
+    if( length < NCE_CRYPTO_CCM_TAG_LENGTH )
+    {
+        return -1;
+    }
+
+    plainLength = length - NCE_CRYPTO_CCM_TAG_LENGTH;
+    mbedtls_ccm_init( &ctx );
+    err = mbedtls_ccm_setkey( &ctx, MBEDTLS_CIPHER_ID_AES, key, NCE_CRYPTO_CCM_KEY_LENGTH * 8u );
+
+    if( err == 0 )
+    {
+        err = mbedtls_ccm_auth_decrypt( &ctx, plainLength, nonce, NCE_CRYPTO_CCM_NONCE_LENGTH, aad, aadLength,
+                                        ciphertext, plaintext, ciphertext + plainLength, NCE_CRYPTO_CCM_TAG_LENGTH );
+    }
+
+    mbedtls_ccm_free( &ctx );
+
+    return ( err == 0 ) ? 0 : -1;
+}
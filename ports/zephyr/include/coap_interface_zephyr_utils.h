@@ -9,6 +9,10 @@
 
 #include "zephyr/net/coap.h"
 
+#ifdef CONFIG_NCE_SDK_OSCORE
+    #include "nce_oscore.h"
+#endif
+
 /**
  * @brief Establishes a connection to a specified CoAP server.
  *
@@ -20,9 +24,24 @@ int nce_connect_to_coap_server( os_network_ops_t * osNetwork,
                                 OSEndPoint_t coap_server );
 
 /**
- * @brief Creates a CoAP request.
+ * @brief Establishes a connection to a specified CoAP server, taking the
+ * endpoint by pointer instead of copying it.
+ *
+ * @param osNetwork        Pointer to the network interface.
+ * @param coap_server      Endpoint of the CoAP server.
+ * @return int             0 on successful connection, error code otherwise.
+ */
+int nce_connect_to_coap_server_v2( os_network_ops_t * osNetwork,
+                                   const OSEndPoint_t * coap_server );
+
+/**
+ * @brief Creates a confirmable CoAP request. Non-confirmable uplinks go
+ * through nce_telemetry.h.
  *
  * @param coap_packet      Pointer to the CoAP packet structure for the request.
+ * @param buffer           Buffer holding the encoded request, provided by the
+ *                         caller and used until the request has been sent.
+ * @param buffer_len       Size of the buffer.
  * @param coap_method      CoAP method (e.g., GET, POST) to use in the request.
  * @param uriPath          Optional URI path for the CoAP resource.
  * @param uriQuery         Optional URI query string.
@@ -33,6 +52,8 @@ int nce_connect_to_coap_server( os_network_ops_t * osNetwork,
  * @return int             0 on successful request, error code otherwise.
  */
 int nce_coap_request( struct coap_packet * coap_packet,
+                      uint8_t * buffer,
+                      uint16_t buffer_len,
                       uint8_t coap_method,
                       const char * uriPath,
                       const char * uriQuery,
@@ -62,3 +83,33 @@ void print_coap_header( struct coap_packet * packet );
  * @return bool           Returns `true` if the response code is in the success range (2.xx), or `false` otherwise.
  */
 bool check_and_print_coap_response_code( struct coap_packet * packet );
+
+#ifdef CONFIG_NCE_SDK_OSCORE
+
+/**
+ * @brief Sends a CoAP request protected with OSCORE and, for a confirmable
+ * request, verifies and decrypts its response. No DTLS session is needed:
+ * connect to the plain CoAP port of the server.
+ *
+ * @param osNetwork        Pointer to the connected network interface.
+ * @param oscore           Security context, see nce_oscore_init_from_key().
+ * @param coap_packet      Plain CoAP request.
+ * @param buffer           Buffer for the protected request, then the protected
+ *                         response; request length + NCE_OSCORE_OVERHEAD_MAX
+ *                         is enough.
+ * @param buffer_len       Size of the buffer.
+ * @param response         Buffer receiving the plain CoAP response, to parse
+ *                         with nce_coap_parse().
+ * @param response_len     Size of the response buffer.
+ * @return int             Length of the response, 0 for a non-confirmable
+ *                         request, negative value on error.
+ */
+int nce_coap_oscore_exchange( os_network_ops_t * osNetwork,
+                              nce_oscore_context_t * oscore,
+                              const struct coap_packet * coap_packet,
+                              uint8_t * buffer,
+                              size_t buffer_len,
+                              uint8_t * response,
+                              size_t response_len );
+
+#endif /* ifdef CONFIG_NCE_SDK_OSCORE */
@@ -6,21 +6,74 @@
  */
 
 
-#define PROXY_HOST             "coap.proxy.os.1nce.com"
+#define PROXY_HOST    NCE_MEMFAULT_PROXY_HOST
 
 #ifdef CONFIG_NCE_SDK_ENABLE_DTLS
-    #define PROXY_PORT         5684
+    #define PROXY_PORT    5684
 #else
-    #define PROXY_PORT         5683
+    #define PROXY_PORT    5683
 #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
 
-#define RECEIVE_BUFFER_SIZE    128
+#include "network_interface_zephyr.h"
+#include "nce_memfault.h"
+
+/**
+ * @brief State owned by one Memfault sender.
+ *
+ * The network object and the uploader (nce_memfault.h) with its buffers live
+ * here instead of in file-scope globals or on the stack, so the RAM of a
+ * sender is the size of its context.
+ */
+typedef struct nce_memfault_context
+{
+    struct OSNetwork network;           /**< Socket of this sender. */
+    os_network_ops_t osNetwork;         /**< Network operations bound to network. */
+    nce_memfault_uploader_t uploader;   /**< Upload engine fed by the Memfault packetizer. */
+} nce_memfault_context_t;
+
+/**
+ * @brief Initialize a Memfault sender context with the Zephyr network interface.
+ *
+ * @param ctx Context to initialize.
+ */
+void os_memfault_context_init( nce_memfault_context_t * ctx );
+
+/**
+ * @brief Send Memfault data with retries using the given context.
+ *
+ * @param ctx Sender context initialized with os_memfault_context_init().
+ *
+ * @return int 0 on success, negative error code on failure.
+ */
+int os_memfault_send_ctx( nce_memfault_context_t * ctx );
+
+#ifdef CONFIG_NCE_SDK_DEADLINE
+
+/**
+ * @brief Send Memfault data using the given context within a time budget,
+ * e.g. what is left of the PSM active time (nce_memfault_upload_deadline()).
+ * Chunks not sent in time stay in the packetizer for the next call.
+ *
+ * @param ctx Sender context initialized with os_memfault_context_init().
+ * @param budgetMs Time the upload may take.
+ * @param progress How far the upload got, NULL if not needed.
+ *
+ * @return int 0 on success, NCE_SDK_DEADLINE_EXCEEDED when the budget ran
+ * out first, other negative error code on failure.
+ */
+int os_memfault_send_deadline_ctx( nce_memfault_context_t * ctx,
+                                   uint32_t budgetMs,
+                                   nce_progress_t * progress );
+#endif
 
 /**
  * @brief Send Memfault data with retries.
  *
- * This function attempts to send Memfault data via the `prv_os_memfault_try_send` function.
- * If sending fails, it will retry for a maximum of `NCE_SDK_MEMFAULT_ATTEMPTS`.
+ * This function sends the chunks of the Memfault packetizer with
+ * nce_memfault_upload(), in up to `NCE_SDK_MEMFAULT_ATTEMPTS` attempts.
+ * A 4.xx response from the proxy ends the retries, a 5.03 delays the next
+ * attempt by its Max-Age (see nce_retry.h).
+ * Uses a default context shared by all callers of this function.
  *
  * @return int 0 on success, negative error code on failure.
  */
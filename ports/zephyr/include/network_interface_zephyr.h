@@ -4,7 +4,10 @@
  * network via UDP in ZEPHYR OS.
  */
 
+#ifndef NETWORK_INTERFACE_ZEPHYR_H_
+#define NETWORK_INTERFACE_ZEPHYR_H_
 
+#include <stdint.h>
 #include "udp_interface.h"
 
 /**
@@ -25,6 +28,17 @@ struct OSNetwork
 int nce_os_connect( OSNetwork_t osnetwork,
                     OSEndPoint_t nce_oboarding );
 
+/**
+ * @brief Establishes a Network connection, the endpoint passed by pointer
+ * (os_network_ops_v2_t::nce_os_udp_connect_v2).
+ *
+ * @param osnetwork        The network interface instance to use.
+ * @param endpoint         The endpoint structure representing the target server.
+ * @return int             0 on success, error code otherwise.
+ */
+int nce_os_connect_v2( OSNetwork_t osnetwork,
+                       const OSEndPoint_t * endpoint );
+
 /**
  * @brief Sends data over an established Network connection.
  *
@@ -43,13 +57,25 @@ int nce_os_send( OSNetwork_t osnetwork,
  * @param osnetwork        The network interface instance to use.
  * @param pBuffer          Pointer to the buffer where received data will be stored.
  * @param bytesToRecv      Number of bytes to receive into the buffer.
- * @return int             Number of bytes successfully received, or error code on failure.
+ * @return int             Number of bytes successfully received, 0 when the receive timed out, or error code on failure.
  */
 int nce_os_recv( OSNetwork_t osnetwork,
                  void * pBuffer,
                  size_t bytesToRecv );
 
 
+/**
+ * @brief Sets the receive timeout of an established Network connection,
+ * replacing CONFIG_NCE_SDK_RECV_TIMEOUT_SECONDS until the next connect. Used
+ * as the setRecvTimeout of an SDK context with CONFIG_NCE_SDK_RTO.
+ *
+ * @param osnetwork        The network interface instance to configure.
+ * @param ms               Timeout in milliseconds.
+ * @return int             0 on success, error code otherwise.
+ */
+int nce_os_set_recv_timeout( OSNetwork_t osnetwork,
+                             uint32_t ms );
+
 /**
  * @brief Closes an active Network connection.
  *
@@ -57,3 +83,5 @@ int nce_os_recv( OSNetwork_t osnetwork,
  * @return int             0 on successful disconnection, error code otherwise.
  */
 int nce_os_disconnect( OSNetwork_t osnetwork );
+
+#endif /* ifndef NETWORK_INTERFACE_ZEPHYR_H_ */
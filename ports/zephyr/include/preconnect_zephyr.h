@@ -0,0 +1,97 @@
+/**
+ * @file preconnect_zephyr.h
+ * @brief Speculative pre-connect for ZEPHYR OS: resolve the endpoint and run
+ * the DTLS handshake on a work queue as soon as the LTE link is up, so the
+ * first request finds an established session.
+ *
+ * One session is prepared at a time, for the network object of the operations
+ * given to nce_os_preconnect_start(). Hand the SDK operations whose connect is
+ * nce_os_preconnect_connect(): a connect on that network object and endpoint
+ * adopts the prepared session, waiting for the handshake if it is still
+ * running, instead of starting a second one. The session is prepared on a
+ * network object of its own and only moved into the SDK's on adoption, so a
+ * re-registration while the SDK has a session open leaves it alone. A session
+ * nobody adopts is closed after CONFIG_NCE_SDK_PRECONNECT_IDLE_TIMEOUT_SECONDS.
+ */
+
+#ifndef PRECONNECT_ZEPHYR_H_
+#define PRECONNECT_ZEPHYR_H_
+
+#include <stdint.h>
+#include "udp_interface.h"
+
+/**
+ * @brief Return codes of nce_os_preconnect_start().
+ */
+enum
+{
+    NCE_PRECONNECT_SUCCESS = 0, /**< The background connect was queued. */
+    NCE_PRECONNECT_BUSY = -1    /**< A session is already being prepared or waiting to be adopted. */
+};
+
+/**
+ * @brief Counters of the pre-connect.
+ */
+typedef struct nce_os_preconnect_stats
+{
+    uint32_t prepared;  /**< Sessions established in the background. */
+    uint32_t failed;    /**< Background connects that failed. */
+    uint32_t adopted;   /**< Connects served by a prepared session. */
+    uint32_t waited;    /**< Adoptions that waited for the handshake to finish. */
+    uint32_t expired;   /**< Sessions closed after the idle timeout. */
+    uint32_t discarded; /**< Sessions dropped by a cancel or a connect to another endpoint. */
+} nce_os_preconnect_stats_t;
+
+/**
+ * @brief Prepare a session every time the modem registers to the network
+ * (LTE_LC_EVT_NW_REG_STATUS, home or roaming).
+ *
+ * @param ops       Network operations running the real connect for
+ *                  ops->os_socket, kept by pointer. Their connect must not be
+ *                  nce_os_preconnect_connect().
+ * @param endpoint  Endpoint to connect to, kept by pointer.
+ * @return int      0 on success, error of lte_lc_register_handler() otherwise.
+ */
+int nce_os_preconnect_enable( const os_network_ops_t * ops,
+                              const OSEndPoint_t * endpoint );
+
+/**
+ * @brief Start preparing a session now.
+ *
+ * @param ops            Network operations running the real connect, copied.
+ * @param endpoint       Endpoint to connect to.
+ * @param idleTimeoutMs  Time a prepared session waits to be adopted.
+ * @return int           One of the NCE_PRECONNECT_* codes.
+ */
+int nce_os_preconnect_start( const os_network_ops_t * ops,
+                             OSEndPoint_t endpoint,
+                             uint32_t idleTimeoutMs );
+
+/**
+ * @brief Connect adopting the prepared session, drop-in for
+ * os_network_ops_t::nce_os_udp_connect.
+ *
+ * Other network objects, and connects when nothing was prepared, use the
+ * connect given to nce_os_preconnect_start(), or nce_os_connect() before
+ * the first start.
+ *
+ * @param osnetwork  Network object to connect.
+ * @param endpoint   Endpoint to connect to.
+ * @return int       0 on success, error code otherwise.
+ */
+int nce_os_preconnect_connect( OSNetwork_t osnetwork,
+                               OSEndPoint_t endpoint );
+
+/**
+ * @brief Drop the prepared session, waiting for a running handshake.
+ */
+void nce_os_preconnect_cancel( void );
+
+/**
+ * @brief Copy the counters.
+ *
+ * @param stats  Copy of the counters.
+ */
+void nce_os_preconnect_get_stats( nce_os_preconnect_stats_t * stats );
+
+#endif /* ifndef PRECONNECT_ZEPHYR_H_ */
@@ -0,0 +1,47 @@
+/**
+ * @file storage_interface_zephyr.h
+ * @brief Storage interface on a Zephyr flash area, e.g. to back the uplink
+ * queue (nce_uplink_queue.h) with a partition of the internal flash.
+ */
+
+#ifndef STORAGE_INTERFACE_ZEPHYR_H_
+#define STORAGE_INTERFACE_ZEPHYR_H_
+
+#include <stdint.h>
+#include <zephyr/storage/flash_map.h>
+#include "storage_interface.h"
+
+/**
+ * @typedef OSStorage_t
+ */
+struct OSStorage
+{
+    const struct flash_area * area;
+    size_t sectorSize;
+};
+
+/**
+ * @brief Open a flash area as storage.
+ *
+ * The flash must allow programming a word again to clear more of its bits
+ * (true for the nRF91 internal flash, with a 4-byte write block).
+ *
+ * @param osstorage        Storage object, owned by the caller.
+ * @param areaId           Flash area, e.g. FIXED_PARTITION_ID( nce_uplink_partition ).
+ * @param sectorSize       Erase unit, a multiple of the flash page size.
+ * @param ops              Storage operations on the area.
+ * @return int             0 on success, error code otherwise.
+ */
+int nce_storage_zephyr_open( OSStorage_t osstorage,
+                             uint8_t areaId,
+                             size_t sectorSize,
+                             os_storage_ops_t * ops );
+
+/**
+ * @brief Close a flash area opened with nce_storage_zephyr_open().
+ *
+ * @param ops              Storage operations on the area.
+ */
+void nce_storage_zephyr_close( os_storage_ops_t * ops );
+
+#endif /* ifndef STORAGE_INTERFACE_ZEPHYR_H_ */
@@ -5,159 +5,83 @@
  *
  */
 
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_MEMFAULT
+
 #include <zephyr/kernel.h>
 #include <stdio.h>
+#include <string.h>
 #include "log_interface.h"
 #include <stdbool.h>
-#include <modem/lte_lc.h>
-#include <zephyr/net/socket.h>
-#include <zephyr/net/coap.h>
 #include <network_interface_zephyr.h>
-#include <coap_interface_zephyr.h>
 #include "memfault/core/data_packetizer.h"
 #include "nce_iot_c_sdk.h"
 #include "memfault_interface_zephyr.h"
-#include "coap_interface_zephyr_utils.h"
 
 
 LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
 
+/* The Memfault packetizer is a single global, so only one sender may drain it at a time. */
 K_MUTEX_DEFINE( os_memfault_send_mutex );
 
-struct coap_packet proxy_response, proxy_request;
-
 static const OSEndPoint_t proxyEndpoint =
 {
     .host = PROXY_HOST,
     .port = PROXY_PORT
 };
 
-struct OSNetwork OSNetwork = { .os_socket = 0 };
-os_network_ops_t osNetwork =
-{
-    .os_socket             = &OSNetwork,
-    .nce_os_udp_connect    = nce_os_connect,
-    .nce_os_udp_send       = nce_os_send,
-    .nce_os_udp_recv       = nce_os_recv,
-    .nce_os_udp_disconnect = nce_os_disconnect
-};
+#ifdef CONFIG_NCE_SDK_RTO
+/* Receive timeout towards the proxy, estimated across uploads (guarded by the mutex). */
+static nce_rto_t proxyRto;
+#endif
+
+static nce_memfault_context_t defaultContext;
+static bool defaultContextReady;
 
 /**
- * @brief Try sending Memfault data chunks over CoAP.
- *
- * This function retrieves Memfault data chunks and sends them to
- * 1NCE CoAP proxy server. If no data is available, it returns early.
- *
- * @return NCE_SDK_SUCCESS (0) on success, negative error code on failure.
+ * @brief Chunk source of the uploader: the Memfault packetizer.
  */
-int prv_os_memfault_try_send( void )
+static bool prv_packetizer_get_chunk( void * arg,
+                                      uint8_t * buffer,
+                                      size_t * length )
 {
-    int err = NCE_SDK_SUCCESS;
-    bool data_available = true;
-    uint8_t memfault_buffer[ CONFIG_NCE_SDK_MEMFAULT_BUFFER_SIZE ];
-    size_t memfault_buffer_len = sizeof( memfault_buffer );
-    char receive_buffer[ RECEIVE_BUFFER_SIZE ];
-    size_t receive_buffer_len = sizeof( receive_buffer );
-
-    /* Check if data is available */
-    if( !memfault_packetizer_data_available() )
-    {
-        NceOSLogInfo( "[INF] There is no data to be sent\n" );
-        return NCE_SDK_SUCCESS;
-    }
+    ( void ) arg;
 
-    /* Connect to CoAP server */
-    err = nce_connect_to_coap_server( &osNetwork, proxyEndpoint );
+    return memfault_packetizer_get_chunk( buffer, length );
+}
 
-    if( err )
-    {
-        NceOSLogError( "[ERR] Failed to connect to CoAP server, err %d\n", err );
-        return err;
-    }
+static void prv_packetizer_abort( void * arg )
+{
+    ( void ) arg;
 
-    NceOSLogInfo( "[INF] Connected to CoAP server, Host: %s, Port: %d\n", proxyEndpoint.host, proxyEndpoint.port );
+    memfault_packetizer_abort();
+}
 
-    /* Prepare to send Memfault chunks over CoAP */
-    while( data_available )
-    {
-        /* Retrieve the next Memfault chunk */
-        memfault_buffer_len = sizeof( memfault_buffer );
-
-        data_available = memfault_packetizer_get_chunk( memfault_buffer, &memfault_buffer_len );
-
-        if( !data_available )
-        {
-            NceOSLogInfo( "[INF] No more chunks to send\n" );
-            goto end;
-        }
-
-        /* Create a CoAP Post request containing the chunk */
-        err = nce_coap_request( &proxy_request, COAP_METHOD_POST, NULL, NULL,
-                                CONFIG_NCE_SDK_MEMFAULT_PROXY_URI, COAP_CONTENT_FORMAT_APP_OCTET_STREAM,
-                                memfault_buffer, memfault_buffer_len );
-
-        if( err < 0 )
-        {
-            memfault_packetizer_abort();
-            NceOSLogError( "[ERR] Unable to create CoAP request \n" );
-            goto end;
-        }
-
-        /* Send the chunk over CoAP */
-        err = nce_os_send( osNetwork.os_socket, proxy_request.data, proxy_request.offset );
-
-        if( err < 0 )
-        {
-            memfault_packetizer_abort();
-            NceOSLogError( "[ERR] Unable to send CoAP packet\n" );
-            NceOSLogError( "[ERR] CoAP error code %d\n", err );
-            goto end;
-        }
-
-        NceOSLogInfo( "[INF] Sent %zu bytes\n", memfault_buffer_len );
-
-        /* Receive the CoAP response */
-        memset( receive_buffer, '\0', receive_buffer_len * sizeof( char ) );
-        int bytes_received = nce_os_recv( osNetwork.os_socket, receive_buffer, receive_buffer_len );
-
-        if( bytes_received < 0 )
-        {
-            NceOSLogError( "[ERR] Unable to get CoAP response\n" );
-            NceOSLogError( "[ERR] CoAP error code %d\n", bytes_received );
-            err = bytes_received;
-            goto end;
-        }
-
-        /* Parse and print the CoAP response */
-        err = nce_coap_parse( receive_buffer, &proxy_response, bytes_received );
-
-        if( err < 0 )
-        {
-            memfault_packetizer_abort();
-            NceOSLogError( "[ERR] Unable to parse CoAP response\n" );
-            NceOSLogError( "[ERR] CoAP error code %d\n", err );
-            goto end;
-        }
-
-        bool success = check_and_print_coap_response_code( &proxy_response );
-
-        if( !success )
-        {
-            memfault_packetizer_abort();
-            /* Show a warning if the response code is not in the success range (2.xx) */
-            NceOSLogError( "[ERR] Server did not accept the packet (non-success response).\n" );
-            err = NCE_SDK_SERVER_RESPONSE_ERROR;
-            goto end;
-        }
-    }
+static const nce_memfault_source_t packetizerSource =
+{
+    .getChunk = prv_packetizer_get_chunk,
+    .abort    = prv_packetizer_abort,
+    .arg      = NULL
+};
 
-end:
-    /* Close the Connection */
-    nce_os_disconnect( osNetwork.os_socket );
-    return err;
+void os_memfault_context_init( nce_memfault_context_t * ctx )
+{
+    memset( ctx, 0, sizeof( *ctx ) );
+    ctx->osNetwork.os_socket = &ctx->network;
+    ctx->osNetwork.nce_os_udp_connect = nce_os_connect;
+    ctx->osNetwork.nce_os_udp_send = nce_os_send;
+    ctx->osNetwork.nce_os_udp_recv = nce_os_recv;
+    ctx->osNetwork.nce_os_udp_disconnect = nce_os_disconnect;
+    nce_memfault_init( &ctx->uploader, &ctx->osNetwork, &proxyEndpoint, &packetizerSource );
+    ctx->uploader.proxyUri = CONFIG_NCE_SDK_MEMFAULT_PROXY_URI;
+    #ifdef CONFIG_NCE_SDK_RTO
+        ctx->uploader.rto = &proxyRto;
+    #endif
+    #if defined( CONFIG_NCE_SDK_RTO ) || defined( CONFIG_NCE_SDK_DEADLINE )
+        ctx->uploader.setRecvTimeout = nce_os_set_recv_timeout;
+    #endif
 }
 
-int os_memfault_send( void )
+int os_memfault_send_ctx( nce_memfault_context_t * ctx )
 {
     if( k_mutex_lock( &os_memfault_send_mutex, K_NO_WAIT ) != 0 )
     {
@@ -165,38 +89,61 @@ int os_memfault_send( void )
         return NCE_SDK_SUCCESS;
     }
 
+    /* Skip the connection when the packetizer has nothing to send. */
     int res = NCE_SDK_SUCCESS;
-    int retry_count = 0;
 
-    while( retry_count < CONFIG_NCE_SDK_MEMFAULT_ATTEMPTS )
+    if( memfault_packetizer_data_available() )
+    {
+        res = nce_memfault_upload( &ctx->uploader );
+    }
+    else
     {
-        res = prv_os_memfault_try_send();
+        NceOSLogInfo( "[INF] There is no data to be sent\n" );
+    }
 
-        if( res == NCE_SDK_SUCCESS )
-        {
-            goto end;
-        }
+    k_mutex_unlock( &os_memfault_send_mutex );
+    return res;
+}
 
-        NceOSLogError( "[ERR] Failed to send Memfault data, err %d\n", res );
+#ifdef CONFIG_NCE_SDK_DEADLINE
+int os_memfault_send_deadline_ctx( nce_memfault_context_t * ctx,
+                                   uint32_t budgetMs,
+                                   nce_progress_t * progress )
+{
+    int res;
 
-        if( res == NCE_SDK_SERVER_RESPONSE_ERROR )
-        {
-            NceOSLogError( "[ERR] Aborting transmission. Please make sure that Memfault Plugin is enabled in 1NCE OS\n" );
-            goto end;
-        }
+    if( k_mutex_lock( &os_memfault_send_mutex, K_NO_WAIT ) != 0 )
+    {
+        NceOSLogInfo( "[INFO] Another Memfault send request is in progress\n" );
+        return NCE_SDK_SUCCESS;
+    }
 
-        retry_count++;
-        /* Delay between attempts */
-        k_sleep( K_SECONDS( CONFIG_NCE_SDK_MEMFAULT_ATTEMPT_DELAY_SECONDS ) );
-        NceOSLogInfo( "[INF] Retrying ... (Attempt %d/%d)\n", retry_count, CONFIG_NCE_SDK_MEMFAULT_ATTEMPTS );
+    /* The uploader takes the first chunk before connecting, an empty packetizer costs no traffic. */
+    res = nce_memfault_upload_deadline( &ctx->uploader, budgetMs, progress );
+    k_mutex_unlock( &os_memfault_send_mutex );
+    return res;
+}
+#endif
+
+int os_memfault_send( void )
+{
+    int res;
+
+    /* Zephyr mutexes nest for their owner: the context is set up once under the lock. */
+    if( k_mutex_lock( &os_memfault_send_mutex, K_NO_WAIT ) != 0 )
+    {
+        NceOSLogInfo( "[INFO] Another Memfault send request is in progress\n" );
+        return NCE_SDK_SUCCESS;
     }
 
-    if( res != 0 )
+    if( !defaultContextReady )
     {
-        NceOSLogError( "[ERR] Failed to send Memfault data after %d attempts\n", retry_count );
+        os_memfault_context_init( &defaultContext );
+        defaultContextReady = true;
     }
 
-end:
+    res = os_memfault_send_ctx( &defaultContext );
     k_mutex_unlock( &os_memfault_send_mutex );
+
     return res;
 }
@@ -11,12 +11,16 @@
  * @date 07 November 2024
  */
 
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_PORT
+
 #ifndef NCE_SDK_H_
     #include <nce_iot_c_sdk.h>
 #endif
 
 #include <zephyr/kernel.h>
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <modem/lte_lc.h>
 #include <zephyr/posix/arpa/inet.h>
 #include <zephyr/posix/netdb.h>
@@ -35,15 +39,195 @@
         CONFIG_NCE_SDK_DTLS_SECURITY_TAG,
     };
     #define NCE_SDK_DTLS_PORT    5684
+    #if ( CONFIG_NCE_SDK_DTLS_SESSION_KEEP_SECONDS > 0 )
+        #define NCE_SDK_DTLS_KEEP_SESSION
+    #endif
 #endif /* ifdef NCE_SDK_ENABLE_DTLS */
 
+#if ( CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE > 0 )
+    #define NCE_SDK_CONNECT_ADDRESS_CACHE
+#endif
+
 LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
 
-/* Sample Network definition */
-struct OSNetwork xOSNetwork = { .os_socket = 0 };
+#ifdef NCE_SDK_DTLS_KEEP_SESSION
+
+/* The last DTLS session, kept open by nce_os_disconnect() for the next
+ * connect to the same endpoint. All below are guarded by prv_session_lock. */
+K_MUTEX_DEFINE( prv_session_lock );
+static int prv_session_socket = -1;
+static OSEndPoint_t prv_session_endpoint;
+static bool prv_session_kept;
+static bool prv_session_answered;
+static int64_t prv_session_kept_ms;
+
+/**
+ * @brief Close the kept session once it has been idle for
+ * CONFIG_NCE_SDK_DTLS_SESSION_KEEP_SECONDS, instead of holding the modem
+ * socket until the next connect.
+ */
+    static void prv_session_expire( struct k_work * work )
+    {
+        ARG_UNUSED( work );
+
+        k_mutex_lock( &prv_session_lock, K_FOREVER );
+
+        if( prv_session_kept )
+        {
+            ( void ) close( prv_session_socket );
+            prv_session_socket = -1;
+            prv_session_kept = false;
+        }
+
+        k_mutex_unlock( &prv_session_lock );
+    }
+
+static K_WORK_DELAYABLE_DEFINE( prv_session_expire_work, prv_session_expire );
+
+/**
+ * @brief Remember the DTLS socket just connected, closing a kept session.
+ */
+    static void prv_session_track( int fd,
+                                   const OSEndPoint_t * endpoint )
+    {
+        k_mutex_lock( &prv_session_lock, K_FOREVER );
+
+        if( prv_session_kept )
+        {
+            ( void ) close( prv_session_socket );
+            prv_session_kept = false;
+        }
+
+        prv_session_socket = fd;
+        prv_session_answered = false;
+        memcpy( &prv_session_endpoint, endpoint, sizeof( *endpoint ) );
+        k_mutex_unlock( &prv_session_lock );
+    }
+
+/**
+ * @brief Take the kept session if it was established with endpoint and has
+ * not been idle for longer than CONFIG_NCE_SDK_DTLS_SESSION_KEEP_SECONDS. The
+ * receive timeout is reset to CONFIG_NCE_SDK_RECV_TIMEOUT_SECONDS, undoing a
+ * nce_os_set_recv_timeout() of the previous user.
+ *
+ * @return int The socket, -1 if there is none to reuse.
+ */
+    static int prv_session_take( const OSEndPoint_t * endpoint )
+    {
+        struct timeval recv_timeo =
+        {
+            .tv_sec  = CONFIG_NCE_SDK_RECV_TIMEOUT_SECONDS,
+            .tv_usec = 0,
+        };
+        int fd = -1;
+
+        ( void ) k_work_cancel_delayable( &prv_session_expire_work );
+        k_mutex_lock( &prv_session_lock, K_FOREVER );
+
+        if( prv_session_kept )
+        {
+            prv_session_kept = false;
+
+            if( ( k_uptime_get() - prv_session_kept_ms < CONFIG_NCE_SDK_DTLS_SESSION_KEEP_SECONDS * 1000LL ) &&
+                ( endpoint->port == prv_session_endpoint.port ) &&
+                ( strncmp( endpoint->host, prv_session_endpoint.host, sizeof( endpoint->host ) ) == 0 ) )
+            {
+                fd = prv_session_socket;
+                prv_session_answered = false;
+            }
+            else
+            {
+                ( void ) close( prv_session_socket );
+                prv_session_socket = -1;
+            }
+        }
+
+        k_mutex_unlock( &prv_session_lock );
+
+        if( ( fd >= 0 ) &&
+            ( setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeo, sizeof( recv_timeo ) ) != 0 ) )
+        {
+            NceOSLogWarn( "[WRN] Failed to reset socket receive timeout, errno %d", errno );
+        }
+
+        return fd;
+    }
+
+/**
+ * @brief Note that the session of fd carried an answer.
+ */
+    static void prv_session_answer( int fd )
+    {
+        k_mutex_lock( &prv_session_lock, K_FOREVER );
+        prv_session_answered |= ( fd == prv_session_socket );
+        k_mutex_unlock( &prv_session_lock );
+    }
+
+/**
+ * @brief Keep the session of fd open instead of closing it. A session that
+ * got no answer since it was connected or reused is closed: the server may
+ * have dropped it, the next connect runs a new handshake.
+ *
+ * @return bool true if fd was kept.
+ */
+    static bool prv_session_keep( int fd )
+    {
+        bool kept = false;
+
+        k_mutex_lock( &prv_session_lock, K_FOREVER );
+
+        if( ( fd >= 0 ) && ( fd == prv_session_socket ) && prv_session_answered )
+        {
+            prv_session_kept = true;
+            prv_session_kept_ms = k_uptime_get();
+            ( void ) k_work_reschedule( &prv_session_expire_work,
+                                        K_SECONDS( CONFIG_NCE_SDK_DTLS_SESSION_KEEP_SECONDS ) );
+            kept = true;
+        }
+        else if( fd == prv_session_socket )
+        {
+            prv_session_socket = -1;
+        }
+
+        k_mutex_unlock( &prv_session_lock );
+
+        return kept;
+    }
+#endif /* ifdef NCE_SDK_DTLS_KEEP_SESSION */
 
 #ifdef CONFIG_NCE_SDK_ENABLE_DTLS
 
+/**
+ * @brief Request a DTLS Connection ID (RFC 9146) and enable the session
+ * cache, where the TLS backend supports them (offloaded modem or Zephyr
+ * mbedTLS). Failures are not fatal: the handshake proceeds without them.
+ */
+    static void prv_dtls_session_setup( int fd )
+    {
+        ARG_UNUSED( fd );
+
+        #if defined( CONFIG_NCE_SDK_DTLS_CID ) && defined( TLS_DTLS_CID )
+            /* Supported: the server gives a CID, so it still finds the session
+             * after the NAT assigned the device another address. */
+            int cid = TLS_DTLS_CID_SUPPORTED;
+
+            if( setsockopt( fd, SOL_TLS, TLS_DTLS_CID, &cid, sizeof( cid ) ) != 0 )
+            {
+                NceOSLogWarn( "[WRN] DTLS Connection ID not available, err %d\n", errno );
+            }
+        #endif
+
+        #if defined( CONFIG_NCE_SDK_DTLS_SESSION_CACHE ) && defined( TLS_SESSION_CACHE )
+            /* Reconnects to the same peer resume with an abbreviated handshake. */
+            int cache = TLS_SESSION_CACHE_ENABLED;
+
+            if( setsockopt( fd, SOL_TLS, TLS_SESSION_CACHE, &cache, sizeof( cache ) ) != 0 )
+            {
+                NceOSLogWarn( "[WRN] DTLS session cache not available, err %d\n", errno );
+            }
+        #endif
+    }
+
 /**
  * @brief Configure DTLS socket.
  *
@@ -111,36 +295,282 @@ struct OSNetwork xOSNetwork = { .os_socket = 0 };
             return err;
         }
 
+        prv_dtls_session_setup( fd );
+
         NceOSLogInfo( "[INF] DTLS Socket is configured successfully\n" );
         return err;
     }
 #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
 
-int nce_os_connect( OSNetwork_t osnetwork,
-                    OSEndPoint_t endpoint )
+/**
+ * @brief One resolved address of the endpoint.
+ */
+typedef struct prv_address
 {
-    int socket_num;
-    int err;
+    struct sockaddr_storage addr; /**< Address and port. */
+    socklen_t length;             /**< Used bytes of addr. */
+} prv_address_t;
+
+/**
+ * @brief Resolve every host of the comma-separated list, IPv6 and IPv4.
+ *
+ * @return size_t Number of addresses stored in candidates.
+ */
+static size_t prv_resolve( const OSEndPoint_t * endpoint,
+                           prv_address_t * candidates )
+{
+    char name[ sizeof( endpoint->host ) ];
+    char port[ 8 ];
     struct zsock_addrinfo * addr;
+    struct zsock_addrinfo * it;
     struct zsock_addrinfo hints =
     {
-        .ai_family   = AF_INET,
+        .ai_family   = AF_UNSPEC,
         .ai_socktype = SOCK_DGRAM
     };
+    size_t count = 0;
+    size_t offset = 0;
+    size_t length;
+    int err;
+
+    snprintf( port, sizeof( port ), "%d", endpoint->port );
+
+    while( ( offset < sizeof( endpoint->host ) ) && ( endpoint->host[ offset ] != '\0' ) )
+    {
+        for( length = 0; ( offset + length < sizeof( endpoint->host ) ) &&
+             ( endpoint->host[ offset + length ] != '\0' ) &&
+             ( endpoint->host[ offset + length ] != ',' ); length++ )
+        {
+        }
+
+        memcpy( name, &endpoint->host[ offset ], length );
+        name[ length ] = '\0';
+        offset += length + ( ( ( offset + length < sizeof( endpoint->host ) ) &&
+                               ( endpoint->host[ offset + length ] == ',' ) ) ? 1 : 0 );
+
+        err = ( length == 0 ) ? -1 : getaddrinfo( name, port, &hints, &addr );
+
+        if( err )
+        {
+            NceOSLogWarn( "[WRN] Failed to resolve %s, err %d\n", name, err );
+            continue;
+        }
+
+        for( it = addr; ( it != NULL ) && ( count < CONFIG_NCE_SDK_CONNECT_MAX_ADDRESSES ); it = it->ai_next )
+        {
+            if( ( ( it->ai_family == AF_INET ) || ( it->ai_family == AF_INET6 ) ) &&
+                ( it->ai_addrlen <= sizeof( candidates[ count ].addr ) ) )
+            {
+                memset( &candidates[ count ], 0, sizeof( candidates[ count ] ) );
+                memcpy( &candidates[ count ].addr, it->ai_addr, it->ai_addrlen );
+                candidates[ count ].length = it->ai_addrlen;
+                count++;
+            }
+        }
+
+        freeaddrinfo( addr );
+    }
+
+    return count;
+}
+
+/**
+ * @brief Alternate the address families, starting with the family of the
+ * first address (RFC 8305, section 4).
+ */
+static void prv_interleave( prv_address_t * candidates,
+                            size_t count )
+{
+    prv_address_t moved;
+    size_t i;
+    size_t j;
+
+    for( i = 1; i < count; i++ )
+    {
+        if( candidates[ i ].addr.ss_family != candidates[ i - 1 ].addr.ss_family )
+        {
+            continue;
+        }
+
+        for( j = i + 1; ( j < count ) && ( candidates[ j ].addr.ss_family == candidates[ i - 1 ].addr.ss_family ); j++ )
+        {
+        }
+
+        if( j == count )
+        {
+            break;
+        }
+
+        moved = candidates[ j ];
+        memmove( &candidates[ i + 1 ], &candidates[ i ], ( j - i ) * sizeof( candidates[ 0 ] ) );
+        candidates[ i ] = moved;
+    }
+}
+
+#ifdef NCE_SDK_CONNECT_ADDRESS_CACHE
+
+/* Last address that completed a handshake or answered a UDP exchange, per
+ * endpoint, and the UDP socket still waiting for its first answer. All below
+ * are guarded by prv_cache_lock. */
+K_MUTEX_DEFINE( prv_cache_lock );
+static OSEndPoint_t prv_cache_endpoint[ CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE ];
+static prv_address_t prv_cache_address[ CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE ];
+static size_t prv_cache_next;
+static int prv_cache_pending_socket = -1;
+static OSEndPoint_t prv_cache_pending_endpoint;
+static prv_address_t prv_cache_pending_address;
+
+    static bool prv_same_endpoint( const OSEndPoint_t * a,
+                                   const OSEndPoint_t * b )
+    {
+        return ( a->port == b->port ) && ( strncmp( a->host, b->host, sizeof( a->host ) ) == 0 );
+    }
+
+/**
+ * @brief Move the last address that worked for endpoint to the front.
+ */
+    static void prv_cache_lookup( const OSEndPoint_t * endpoint,
+                                  prv_address_t * candidates,
+                                  size_t count )
+    {
+        prv_address_t moved;
+        size_t i;
+        size_t j;
+
+        k_mutex_lock( &prv_cache_lock, K_FOREVER );
+
+        for( i = 0; i < CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE; i++ )
+        {
+            if( !prv_same_endpoint( &prv_cache_endpoint[ i ], endpoint ) )
+            {
+                continue;
+            }
+
+            for( j = 0; j < count; j++ )
+            {
+                if( ( candidates[ j ].length == prv_cache_address[ i ].length ) &&
+                    ( memcmp( &candidates[ j ].addr, &prv_cache_address[ i ].addr, candidates[ j ].length ) == 0 ) )
+                {
+                    moved = candidates[ j ];
+                    memmove( &candidates[ 1 ], &candidates[ 0 ], j * sizeof( candidates[ 0 ] ) );
+                    candidates[ 0 ] = moved;
+                    break;
+                }
+            }
+
+            break;
+        }
+
+        k_mutex_unlock( &prv_cache_lock );
+    }
+
+/**
+ * @brief Remember the address that worked for endpoint; prv_cache_lock held.
+ */
+    static void prv_cache_store_locked( const OSEndPoint_t * endpoint,
+                                        const prv_address_t * address )
+    {
+        size_t i;
+
+        for( i = 0; ( i < CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE ) &&
+             !prv_same_endpoint( &prv_cache_endpoint[ i ], endpoint ); i++ )
+        {
+        }
+
+        if( i == CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE )
+        {
+            i = prv_cache_next;
+            prv_cache_next = ( prv_cache_next + 1 ) % CONFIG_NCE_SDK_CONNECT_ADDRESS_CACHE_SIZE;
+        }
+
+        memcpy( &prv_cache_endpoint[ i ], endpoint, sizeof( *endpoint ) );
+        prv_cache_address[ i ] = *address;
+    }
 
     #ifdef CONFIG_NCE_SDK_ENABLE_DTLS
-        if( endpoint.port == NCE_SDK_DTLS_PORT )
+
+/**
+ * @brief Remember the address that worked for endpoint.
+ */
+        static void prv_cache_store( const OSEndPoint_t * endpoint,
+                                     const prv_address_t * address )
+        {
+            k_mutex_lock( &prv_cache_lock, K_FOREVER );
+            prv_cache_store_locked( endpoint, address );
+            k_mutex_unlock( &prv_cache_lock );
+        }
+    #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
+
+/**
+ * @brief Remember the address of a connected UDP socket until it is
+ * answered: connect() on UDP sends nothing, so it proves nothing.
+ */
+    static void prv_cache_pending( int fd,
+                                   const OSEndPoint_t * endpoint,
+                                   const prv_address_t * address )
+    {
+        k_mutex_lock( &prv_cache_lock, K_FOREVER );
+        prv_cache_pending_socket = fd;
+        memcpy( &prv_cache_pending_endpoint, endpoint, sizeof( *endpoint ) );
+        prv_cache_pending_address = *address;
+        k_mutex_unlock( &prv_cache_lock );
+    }
+
+/**
+ * @brief Note a datagram received on fd; the first one on the pending UDP
+ * socket stores its address.
+ */
+    static void prv_cache_answer( int fd )
+    {
+        k_mutex_lock( &prv_cache_lock, K_FOREVER );
+
+        if( ( fd >= 0 ) && ( fd == prv_cache_pending_socket ) )
         {
-            socket_num = socket( AF_INET, SOCK_DGRAM, IPPROTO_DTLS_1_2 );
+            prv_cache_store_locked( &prv_cache_pending_endpoint, &prv_cache_pending_address );
+            prv_cache_pending_socket = -1;
         }
-        else
+
+        k_mutex_unlock( &prv_cache_lock );
+    }
+
+/**
+ * @brief Forget the pending UDP socket when it is closed unanswered.
+ */
+    static void prv_cache_forget( int fd )
+    {
+        k_mutex_lock( &prv_cache_lock, K_FOREVER );
+
+        if( fd == prv_cache_pending_socket )
+        {
+            prv_cache_pending_socket = -1;
+        }
+
+        k_mutex_unlock( &prv_cache_lock );
+    }
+#endif /* ifdef NCE_SDK_CONNECT_ADDRESS_CACHE */
+
+/**
+ * @brief Open a socket to address and connect it; on DTLS sockets this runs
+ * the handshake.
+ *
+ * @return int The socket on success, negative error code otherwise.
+ */
+static int prv_open( const OSEndPoint_t * endpoint,
+                     const prv_address_t * address )
+{
+    int socket_num;
+    int protocol = IPPROTO_UDP;
+    int err;
+
+    #ifdef CONFIG_NCE_SDK_ENABLE_DTLS
+        if( endpoint->port == NCE_SDK_DTLS_PORT )
         {
-            socket_num = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+            protocol = IPPROTO_DTLS_1_2;
         }
-    #else /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
-        socket_num = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
     #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
 
+    socket_num = socket( address->addr.ss_family, SOCK_DGRAM, protocol );
+
     if( socket_num < 0 )
     {
         NceOSLogError( "[ERR] Failed to create socket, err %d\n", errno );
@@ -176,54 +606,122 @@ int nce_os_connect( OSNetwork_t osnetwork,
 
     #if defined( CONFIG_NCE_SDK_ENABLE_DTLS )
         /* Setup DTLS socket options */
-        if( endpoint.port == NCE_SDK_DTLS_PORT )
+        if( endpoint->port == NCE_SDK_DTLS_PORT )
         {
+            NCE_TRACE_BEGIN( NCE_TRACE_DTLS_SETUP );
             err = prv_dtls_setup( socket_num );
+            NCE_TRACE_END( NCE_TRACE_DTLS_SETUP, err );
 
             if( err )
             {
                 NceOSLogError( "[ERR] Failed to Configure DTLS!, err %d\n", err );
+                ( void ) close( socket_num );
                 return err;
             }
         }
     #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
 
-    err = getaddrinfo( endpoint.host,
-                       NULL, &hints, &addr );
+    /* On DTLS sockets connect() runs the handshake. */
+    NCE_TRACE_BEGIN( NCE_TRACE_HANDSHAKE );
+    err = connect( socket_num, ( const struct sockaddr * ) &address->addr, address->length );
+    NCE_TRACE_END( NCE_TRACE_HANDSHAKE, err );
 
     if( err )
     {
-        NceOSLogError( "[ERR] Failed to resolve address, err %d\n", err );
+        NceOSLogWarn( "[WRN] Failed to connect to address, errno %d\n", errno );
+        ( void ) close( socket_num );
+        #if defined( CONFIG_NCE_SDK_ENABLE_DTLS )
+            if( endpoint->port == NCE_SDK_DTLS_PORT )
+            {
+                err = NCE_SDK_DTLS_CONNECT_ERROR;
+            }
+        #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
         return err;
     }
 
-    NceOSLogDebug( "[DBG] getaddrinfo status: %d\n", err );
+    return socket_num;
+}
 
-    osnetwork->os_socket = socket_num;
+int nce_os_connect( OSNetwork_t osnetwork,
+                    OSEndPoint_t endpoint )
+{
+    return nce_os_connect_v2( osnetwork, &endpoint );
+}
+
+int nce_os_connect_v2( OSNetwork_t osnetwork,
+                       const OSEndPoint_t * endpoint )
+{
+    prv_address_t candidates[ CONFIG_NCE_SDK_CONNECT_MAX_ADDRESSES ];
+    size_t count;
+    size_t i;
+    int socket_num;
 
-    ( ( struct sockaddr_in * ) addr->ai_addr )->sin_port = htons( endpoint.port );
+    #ifdef NCE_SDK_DTLS_KEEP_SESSION
+        /* Reuse the kept session: no DNS, no handshake. */
+        socket_num = prv_session_take( endpoint );
 
-    size_t peer_addr_size = sizeof( struct sockaddr_in );
+        if( socket_num >= 0 )
+        {
+            osnetwork->os_socket = socket_num;
+            NceOSLogDebug( "[DBG] DTLS session reused\n" );
+            return 0;
+        }
+    #endif /* ifdef NCE_SDK_DTLS_KEEP_SESSION */
 
-    err = connect( socket_num, addr->ai_addr,
-                   peer_addr_size );
+    NCE_TRACE_BEGIN( NCE_TRACE_DNS );
+    count = prv_resolve( endpoint, candidates );
+    NCE_TRACE_END( NCE_TRACE_DNS, ( count == 0 ) ? -1 : 0 );
 
-    if( err )
+    if( count == 0 )
+    {
+        NceOSLogError( "[ERR] Failed to resolve address\n" );
+        return NCE_SDK_CONNECT_ERROR;
+    }
+
+    prv_interleave( candidates, count );
+
+    #ifdef NCE_SDK_CONNECT_ADDRESS_CACHE
+        prv_cache_lookup( endpoint, candidates, count );
+    #endif
+
+    /* One attempt after the other: parallel handshakes would need a modem
+     * socket each. The handshake timeout bounds a silent address. */
+    socket_num = NCE_SDK_CONNECT_ERROR;
+
+    for( i = 0; ( i < count ) && ( socket_num < 0 ); i++ )
+    {
+        socket_num = prv_open( endpoint, &candidates[ i ] );
+    }
+
+    if( socket_num < 0 )
     {
         NceOSLogError( "[ERR] Failed to Connect to 1NCE Endpoint\n" );
-        #if defined( CONFIG_NCE_SDK_ENABLE_DTLS )
-            if( endpoint.port == NCE_SDK_DTLS_PORT )
-            {
-                err = NCE_SDK_DTLS_CONNECT_ERROR;
-            }
-        #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
-        return err;
+        return socket_num;
     }
 
-    NceOSLogDebug( "[DBG] Socket Connect: %d\n", err );
+    osnetwork->os_socket = socket_num;
+    NceOSLogDebug( "[DBG] Socket Connect: address %u of %u\n", ( unsigned ) i, ( unsigned ) count );
 
-    freeaddrinfo( addr );
-    return err;
+    #ifdef CONFIG_NCE_SDK_ENABLE_DTLS
+        if( endpoint->port == NCE_SDK_DTLS_PORT )
+        {
+            #ifdef NCE_SDK_CONNECT_ADDRESS_CACHE
+                /* The handshake proved the address works. */
+                prv_cache_store( endpoint, &candidates[ i - 1 ] );
+            #endif
+            #ifdef NCE_SDK_DTLS_KEEP_SESSION
+                prv_session_track( socket_num, endpoint );
+            #endif
+            return 0;
+        }
+    #endif /* ifdef CONFIG_NCE_SDK_ENABLE_DTLS */
+
+    #ifdef NCE_SDK_CONNECT_ADDRESS_CACHE
+        /* Stored once the server answers, see nce_os_recv(). */
+        prv_cache_pending( socket_num, endpoint, &candidates[ i - 1 ] );
+    #endif
+
+    return 0;
 }
 
 int nce_os_send( OSNetwork_t osnetwork,
@@ -249,15 +747,59 @@ int nce_os_recv( OSNetwork_t osnetwork,
 
     ret = recv( osnetwork->os_socket, pBuffer, bytesToRecv, flags );
 
+    if( ( ret < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+    {
+        /* The interface reports a timeout as zero bytes received. */
+        ret = 0;
+    }
+
+    #ifdef NCE_SDK_DTLS_KEEP_SESSION
+        if( ret > 0 )
+        {
+            prv_session_answer( osnetwork->os_socket );
+        }
+    #endif
+
+    #ifdef NCE_SDK_CONNECT_ADDRESS_CACHE
+        if( ret > 0 )
+        {
+            prv_cache_answer( osnetwork->os_socket );
+        }
+    #endif
+
     NceOSLogDebug( "[DBG] Socket Receive: %d\n", ret );
 
     return ret;
 }
 
+int nce_os_set_recv_timeout( OSNetwork_t osnetwork,
+                             uint32_t ms )
+{
+    struct timeval recv_timeo =
+    {
+        .tv_sec  = ms / 1000u,
+        .tv_usec = ( ms % 1000u ) * 1000u,
+    };
+
+    return setsockopt( osnetwork->os_socket, SOL_SOCKET, SO_RCVTIMEO, &recv_timeo, sizeof( recv_timeo ) );
+}
+
 int nce_os_disconnect( OSNetwork_t osnetwork )
 {
     int err;
 
+    #ifdef NCE_SDK_DTLS_KEEP_SESSION
+        if( prv_session_keep( osnetwork->os_socket ) )
+        {
+            NceOSLogDebug( "[DBG] DTLS session kept\n" );
+            return 0;
+        }
+    #endif
+
+    #ifdef NCE_SDK_CONNECT_ADDRESS_CACHE
+        prv_cache_forget( osnetwork->os_socket );
+    #endif
+
     err = close( osnetwork->os_socket );
 
     NceOSLogDebug( "[DBG] Socket Disconnect: %d\n", err );
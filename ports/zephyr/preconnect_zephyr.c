@@ -0,0 +1,275 @@
+/**
+ * @file preconnect_zephyr.c
+ * @brief Implements the speculative pre-connect for ZEPHYR OS.
+ *
+ * The real connect (DNS, DTLS setup and handshake) runs on a dedicated work
+ * queue, so a handshake of several seconds does not hold up the system work
+ * queue. The session is prepared on a network object of its own and copied
+ * into the network object the SDK connects when it is adopted, so a
+ * re-registration while the application has a session open leaves its socket
+ * alone.
+ */
+
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_PORT
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <modem/lte_lc.h>
+#include "nce_iot_c_sdk.h"
+#include "log_interface.h"
+#include <network_interface_zephyr.h>
+#include <preconnect_zephyr.h>
+
+LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
+
+/**
+ * @brief Life cycle of the prepared session.
+ */
+typedef enum prv_preconnect_state
+{
+    PRV_PRECONNECT_IDLE = 0,   /**< Nothing prepared. */
+    PRV_PRECONNECT_CONNECTING, /**< Background connect queued or running. */
+    PRV_PRECONNECT_READY       /**< Connected, waiting to be adopted. */
+} prv_preconnect_state_t;
+
+K_MUTEX_DEFINE( prv_preconnect_lock );
+K_CONDVAR_DEFINE( prv_preconnect_changed );
+K_THREAD_STACK_DEFINE( prv_preconnect_stack, CONFIG_NCE_SDK_PRECONNECT_STACK_SIZE );
+
+static struct k_work_q prv_preconnect_queue;
+static struct k_work prv_connect_work;
+static struct k_work_delayable prv_expire_work;
+static bool prv_queue_started;
+
+/* All below are guarded by prv_preconnect_lock. */
+static prv_preconnect_state_t prv_state;
+static os_network_ops_t prv_ops;
+static OSNetwork_t prv_target;
+static struct OSNetwork prv_session;
+static OSEndPoint_t prv_endpoint;
+static uint32_t prv_idle_timeout_ms;
+static nce_os_preconnect_stats_t prv_stats;
+
+/* Set once by nce_os_preconnect_enable(). */
+static const os_network_ops_t * prv_lte_ops;
+static const OSEndPoint_t * prv_lte_endpoint;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Close a session nobody adopted. Called with the lock held.
+ */
+static void prv_drop( uint32_t * counter )
+{
+    prv_ops.nce_os_udp_disconnect( &prv_session );
+    prv_state = PRV_PRECONNECT_IDLE;
+    ( *counter )++;
+    k_condvar_broadcast( &prv_preconnect_changed );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prv_connect_handler( struct k_work * work )
+{
+    int err;
+
+    ARG_UNUSED( work );
+
+    /* DNS and handshake run unlocked, adopters wait on the state. */
+    err = prv_ops.nce_os_udp_connect( &prv_session, prv_endpoint );
+
+    k_mutex_lock( &prv_preconnect_lock, K_FOREVER );
+    prv_state = ( err == 0 ) ? PRV_PRECONNECT_READY : PRV_PRECONNECT_IDLE;
+
+    if( err == 0 )
+    {
+        prv_stats.prepared++;
+        k_work_reschedule_for_queue( &prv_preconnect_queue, &prv_expire_work, K_MSEC( prv_idle_timeout_ms ) );
+        NceOSLogInfo( "[INF] Session to %s prepared\n", prv_endpoint.host );
+    }
+    else
+    {
+        prv_stats.failed++;
+        NceOSLogWarn( "[WRN] Pre-connect failed, err %d\n", err );
+    }
+
+    k_condvar_broadcast( &prv_preconnect_changed );
+    k_mutex_unlock( &prv_preconnect_lock );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prv_expire_handler( struct k_work * work )
+{
+    ARG_UNUSED( work );
+
+    k_mutex_lock( &prv_preconnect_lock, K_FOREVER );
+
+    if( prv_state == PRV_PRECONNECT_READY )
+    {
+        prv_drop( &prv_stats.expired );
+        NceOSLogInfo( "[INF] Prepared session closed, idle\n" );
+    }
+
+    k_mutex_unlock( &prv_preconnect_lock );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prv_lte_handler( const struct lte_lc_evt * const evt )
+{
+    if( ( evt->type == LTE_LC_EVT_NW_REG_STATUS ) &&
+        ( ( evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_HOME ) ||
+          ( evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_ROAMING ) ) )
+    {
+        ( void ) nce_os_preconnect_start( prv_lte_ops, *prv_lte_endpoint,
+                                          CONFIG_NCE_SDK_PRECONNECT_IDLE_TIMEOUT_SECONDS * 1000u );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Adopt the session prepared for osnetwork, waiting for its handshake,
+ * and move it into osnetwork. Called with the lock held.
+ *
+ * @return true if the session was adopted.
+ */
+static bool prv_adopt( OSNetwork_t osnetwork,
+                       const OSEndPoint_t * endpoint )
+{
+    bool waited = false;
+
+    if( osnetwork != prv_target )
+    {
+        return false;
+    }
+
+    while( prv_state == PRV_PRECONNECT_CONNECTING )
+    {
+        waited = true;
+        k_condvar_wait( &prv_preconnect_changed, &prv_preconnect_lock, K_FOREVER );
+    }
+
+    if( prv_state != PRV_PRECONNECT_READY )
+    {
+        return false;
+    }
+
+    if( ( endpoint->port != prv_endpoint.port ) ||
+        ( strncmp( endpoint->host, prv_endpoint.host, sizeof( endpoint->host ) ) != 0 ) )
+    {
+        /* Prepared for another endpoint: free the network object. */
+        prv_drop( &prv_stats.discarded );
+        return false;
+    }
+
+    *osnetwork = prv_session;
+    prv_state = PRV_PRECONNECT_IDLE;
+    prv_stats.adopted++;
+    prv_stats.waited += waited ? 1u : 0u;
+    ( void ) k_work_cancel_delayable( &prv_expire_work );
+    k_condvar_broadcast( &prv_preconnect_changed );
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_preconnect_enable( const os_network_ops_t * ops,
+                              const OSEndPoint_t * endpoint )
+{
+    prv_lte_ops = ops;
+    prv_lte_endpoint = endpoint;
+
+    return lte_lc_register_handler( prv_lte_handler );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_preconnect_start( const os_network_ops_t * ops,
+                             OSEndPoint_t endpoint,
+                             uint32_t idleTimeoutMs )
+{
+    k_mutex_lock( &prv_preconnect_lock, K_FOREVER );
+
+    if( prv_state != PRV_PRECONNECT_IDLE )
+    {
+        k_mutex_unlock( &prv_preconnect_lock );
+        return NCE_PRECONNECT_BUSY;
+    }
+
+    if( !prv_queue_started )
+    {
+        k_work_queue_start( &prv_preconnect_queue, prv_preconnect_stack,
+                            K_THREAD_STACK_SIZEOF( prv_preconnect_stack ),
+                            CONFIG_NCE_SDK_PRECONNECT_PRIORITY, NULL );
+        k_work_init( &prv_connect_work, prv_connect_handler );
+        k_work_init_delayable( &prv_expire_work, prv_expire_handler );
+        prv_queue_started = true;
+    }
+
+    prv_state = PRV_PRECONNECT_CONNECTING;
+    prv_ops = *ops;
+    prv_target = ops->os_socket;
+    memcpy( &prv_endpoint, &endpoint, sizeof( endpoint ) );
+    prv_idle_timeout_ms = idleTimeoutMs;
+    ( void ) k_work_submit_to_queue( &prv_preconnect_queue, &prv_connect_work );
+    k_mutex_unlock( &prv_preconnect_lock );
+
+    return NCE_PRECONNECT_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_os_preconnect_connect( OSNetwork_t osnetwork,
+                               OSEndPoint_t endpoint )
+{
+    int ( * realConnect )( OSNetwork_t, OSEndPoint_t ) = nce_os_connect;
+
+    k_mutex_lock( &prv_preconnect_lock, K_FOREVER );
+
+    if( prv_adopt( osnetwork, &endpoint ) )
+    {
+        k_mutex_unlock( &prv_preconnect_lock );
+        return 0;
+    }
+
+    if( prv_ops.nce_os_udp_connect != NULL )
+    {
+        realConnect = prv_ops.nce_os_udp_connect;
+    }
+
+    k_mutex_unlock( &prv_preconnect_lock );
+
+    return realConnect( osnetwork, endpoint );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_os_preconnect_cancel( void )
+{
+    k_mutex_lock( &prv_preconnect_lock, K_FOREVER );
+
+    while( prv_state == PRV_PRECONNECT_CONNECTING )
+    {
+        k_condvar_wait( &prv_preconnect_changed, &prv_preconnect_lock, K_FOREVER );
+    }
+
+    if( prv_state == PRV_PRECONNECT_READY )
+    {
+        ( void ) k_work_cancel_delayable( &prv_expire_work );
+        prv_drop( &prv_stats.discarded );
+    }
+
+    k_mutex_unlock( &prv_preconnect_lock );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_os_preconnect_get_stats( nce_os_preconnect_stats_t * stats )
+{
+    k_mutex_lock( &prv_preconnect_lock, K_FOREVER );
+    *stats = prv_stats;
+    k_mutex_unlock( &prv_preconnect_lock );
+}
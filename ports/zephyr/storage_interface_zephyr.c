@@ -0,0 +1,85 @@
+/**
+ * @file storage_interface_zephyr.c
+ * @brief Implements the storage interface on a Zephyr flash area.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <storage_interface_zephyr.h>
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_read( OSStorage_t osstorage,
+                             size_t offset,
+                             void * pBuffer,
+                             size_t length )
+{
+    return flash_area_read( osstorage->area, ( off_t ) offset, pBuffer, length );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_write( OSStorage_t osstorage,
+                              size_t offset,
+                              const void * pBuffer,
+                              size_t length )
+{
+    return flash_area_write( osstorage->area, ( off_t ) offset, pBuffer, length );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_erase( OSStorage_t osstorage,
+                              size_t offset )
+{
+    return flash_area_erase( osstorage->area, ( off_t ) offset, osstorage->sectorSize );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_storage_sync( OSStorage_t osstorage )
+{
+    /* Flash writes complete before flash_area_write() returns. */
+    ( void ) osstorage;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_storage_zephyr_open( OSStorage_t osstorage,
+                             uint8_t areaId,
+                             size_t sectorSize,
+                             os_storage_ops_t * ops )
+{
+    int status = flash_area_open( areaId, &osstorage->area );
+
+    if( status != 0 )
+    {
+        return status;
+    }
+
+    osstorage->sectorSize = sectorSize;
+    ops->os_storage = osstorage;
+    ops->size = osstorage->area->fa_size - ( osstorage->area->fa_size % sectorSize );
+    ops->sectorSize = sectorSize;
+    ops->nce_os_storage_read = prv_storage_read;
+    ops->nce_os_storage_write = prv_storage_write;
+    ops->nce_os_storage_erase = prv_storage_erase;
+    ops->nce_os_storage_sync = prv_storage_sync;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_storage_zephyr_close( os_storage_ops_t * ops )
+{
+    OSStorage_t osstorage = ops->os_storage;
+
+    if( osstorage != NULL )
+    {
+        flash_area_close( osstorage->area );
+        ops->os_storage = NULL;
+    }
+}
@@ -0,0 +1,223 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_aggregate.h
+ * @brief Edge aggregation of sampled fields into Energy Saver records.
+ *
+ * Devices often sample far more often than they report. Instead of sending
+ * every sample, add them to an aggregator: each field keeps, for the current
+ * window, its minimum, maximum, mean, count, last value and a histogram of
+ * NCE_SDK_AGGREGATE_BUCKETS fixed buckets, in constant memory and constant
+ * time per sample. When the window closes, one Energy Saver record
+ * (os_energy_save_v2()) carries the statistics chosen by a layout of slots,
+ * matching the template defined in the 1NCE portal.
+ *
+ * Compiled with NCE_SDK_AGGREGATE and NCE_ENERGY_SAVER.
+ */
+
+#ifndef NCE_AGGREGATE_H_
+    #define NCE_AGGREGATE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+    #include "nce_iot_c_sdk.h"
+
+    #ifdef NCE_ENERGY_SAVER
+
+/**
+ * @brief Most fields of an aggregator.
+ */
+    #ifndef NCE_SDK_AGGREGATE_FIELDS
+        #define NCE_SDK_AGGREGATE_FIELDS     4
+    #endif
+
+/**
+ * @brief Histogram buckets of each field.
+ */
+    #ifndef NCE_SDK_AGGREGATE_BUCKETS
+        #define NCE_SDK_AGGREGATE_BUCKETS    8
+    #endif
+
+/**
+ * @brief Return codes of the aggregation functions, record lengths are
+ * returned as positive values.
+ */
+enum
+{
+    NCE_AGGREGATE_SUCCESS = 0,           /**< The operation was successful. */
+    NCE_AGGREGATE_DUE = 1,               /**< The sample was added and the window is due to be emitted. */
+    NCE_AGGREGATE_ARGUMENT_ERROR = -1,   /**< Unknown field or statistic, or unsupported type. */
+    NCE_AGGREGATE_EMPTY = -2,            /**< No sample in the window, nothing to emit. */
+    NCE_AGGREGATE_CONVERSION_ERROR = -3  /**< A value does not fit its template, or the record its buffer. */
+};
+
+/**
+ * @brief Statistics of a field. The histogram buckets follow
+ * NCE_AGGREGATE_BUCKET: NCE_AGGREGATE_BUCKET + i is the count of bucket i.
+ */
+typedef enum nce_aggregate_stat
+{
+    NCE_AGGREGATE_MIN = 0, /**< Smallest sample. */
+    NCE_AGGREGATE_MAX,     /**< Largest sample. */
+    NCE_AGGREGATE_MEAN,    /**< Mean of the samples. */
+    NCE_AGGREGATE_COUNT,   /**< Number of samples. */
+    NCE_AGGREGATE_LAST,    /**< Latest sample. */
+    NCE_AGGREGATE_BUCKET   /**< Count of the first histogram bucket. */
+} nce_aggregate_stat_t;
+
+/**
+ * @brief One element of the emitted record.
+ */
+typedef struct nce_aggregate_slot
+{
+    uint8_t field;        /**< Index of the field. */
+    uint8_t stat;         /**< nce_aggregate_stat_t, NCE_AGGREGATE_BUCKET + i for bucket i. */
+    enum E_Type type;     /**< E_INTEGER, E_FLOAT or E_CHAR. */
+    int template_length;  /**< Length of the element in the portal template. */
+    float scale;          /**< Factor applied before conversion, e.g. 10 for tenths in an integer; 0 for none. */
+} nce_aggregate_slot_t;
+
+/**
+ * @brief Window state of one field.
+ */
+typedef struct nce_aggregate_field
+{
+    double sum;                                      /**< Sum of the samples, for the mean. */
+    float min;                                       /**< Smallest sample. */
+    float max;                                       /**< Largest sample. */
+    float last;                                      /**< Latest sample. */
+    uint32_t count;                                  /**< Samples in the window. */
+    float low;                                       /**< Lower edge of the first bucket. */
+    float bucketsPerUnit;                            /**< Inverse of the bucket width, 0 without histogram. */
+    uint32_t buckets[ NCE_SDK_AGGREGATE_BUCKETS ];   /**< Samples per bucket, the outer ones include the values beyond. */
+} nce_aggregate_field_t;
+
+/**
+ * @brief Aggregator of up to NCE_SDK_AGGREGATE_FIELDS fields. Not locked: add
+ * samples and emit from one thread.
+ */
+typedef struct nce_aggregate
+{
+    nce_aggregate_field_t fields[ NCE_SDK_AGGREGATE_FIELDS ]; /**< Fields. */
+    uint8_t fieldCount;                                       /**< Fields used. */
+    uint8_t selector;                                         /**< Selector of the emitted records. */
+    const nce_aggregate_slot_t * slots;                       /**< Layout of the emitted records. */
+    size_t slotCount;                                         /**< Number of slots. */
+    uint32_t windowMs;                                        /**< Length of a window, 0 to close windows by hand. */
+    uint32_t elapsedMs;                                       /**< Time since the first sample of the window. */
+    uint32_t carryUs;                                         /**< Microseconds not yet counted in elapsedMs. */
+    uint32_t lastUs;                                          /**< Clock of the latest sample. */
+    uint32_t samples;                                         /**< Samples in the window, all fields. */
+} nce_aggregate_t;
+
+/**
+ * @brief Initialize an aggregator.
+ *
+ * @param[out] agg: Aggregator.
+ * @param[in] fields: Number of fields, at most NCE_SDK_AGGREGATE_FIELDS.
+ * @param[in] selector: Selector of the emitted records.
+ * @param[in] slots: Layout of the emitted records, kept by reference.
+ * @param[in] slotCount: Number of slots.
+ * @param[in] windowMs: Length of a window from its first sample, 0 to only
+ * close windows with nce_aggregate_emit().
+ *
+ * @return NCE_AGGREGATE_SUCCESS or NCE_AGGREGATE_ARGUMENT_ERROR.
+ */
+int nce_aggregate_init( nce_aggregate_t * agg,
+                        size_t fields,
+                        uint8_t selector,
+                        const nce_aggregate_slot_t * slots,
+                        size_t slotCount,
+                        uint32_t windowMs );
+
+/**
+ * @brief Set the histogram range of a field: NCE_SDK_AGGREGATE_BUCKETS
+ * buckets of equal width from low to high. Without it, every sample counts in
+ * the first bucket.
+ *
+ * @param[in] agg: Aggregator.
+ * @param[in] field: Index of the field.
+ * @param[in] low: Lower edge of the first bucket.
+ * @param[in] high: Upper edge of the last bucket, above low.
+ *
+ * @return NCE_AGGREGATE_SUCCESS or NCE_AGGREGATE_ARGUMENT_ERROR.
+ */
+int nce_aggregate_set_histogram( nce_aggregate_t * agg,
+                                 size_t field,
+                                 float low,
+                                 float high );
+
+/**
+ * @brief Add a sample.
+ *
+ * @param[in] agg: Aggregator.
+ * @param[in] field: Index of the field.
+ * @param[in] value: Sample.
+ * @param[in] nowUs: Current NceOSClockUs(), opens the window on its first
+ * sample. The clock wraps after 71 minutes: longer windows need a sample at
+ * least that often.
+ *
+ * @return NCE_AGGREGATE_SUCCESS, NCE_AGGREGATE_DUE once the window is older
+ * than its length, or NCE_AGGREGATE_ARGUMENT_ERROR.
+ */
+int nce_aggregate_add( nce_aggregate_t * agg,
+                       size_t field,
+                       float value,
+                       uint32_t nowUs );
+
+/**
+ * @brief Close the window: build its Energy Saver record and start a new
+ * window. Fields without sample report 0. On error the window is kept.
+ *
+ * @param[in] agg: Aggregator.
+ * @param[out] packet: Record, to send as the payload of an Energy Saver uplink.
+ * @param[in] packetSize: Size of the record buffer.
+ *
+ * @return Length of the record, NCE_AGGREGATE_EMPTY, NCE_AGGREGATE_ARGUMENT_ERROR
+ * or NCE_AGGREGATE_CONVERSION_ERROR.
+ */
+int nce_aggregate_emit( nce_aggregate_t * agg,
+                        uint8_t * packet,
+                        size_t packetSize );
+
+/**
+ * @brief Drop the samples of the current window, keeping the histogram ranges.
+ *
+ * @param[in] agg: Aggregator.
+ */
+void nce_aggregate_reset( nce_aggregate_t * agg );
+
+    #endif /* ifdef NCE_ENERGY_SAVER */
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_AGGREGATE_H_ */
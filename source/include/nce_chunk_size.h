@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_chunk_size.h
+ * @brief Per-endpoint payload limit adapted to the path MTU.
+ *
+ * A Memfault chunk or a batch of uplink frames that does not fit the path
+ * MTU once DTLS, CoAP, UDP and IP headers are added is fragmented, and some
+ * carriers lose or drop fragments. A chunk much smaller than the MTU wastes
+ * headers and round trips. The cache keeps, for each endpoint, the largest
+ * payload the sender should put into one datagram: it starts at an initial
+ * size, probes larger sizes after a run of delivered full-size chunks, and
+ * falls back to the last size confirmed on the path when full-size chunks are
+ * lost repeatedly. A size that failed is not probed again for a while.
+ */
+
+#ifndef NCE_CHUNK_SIZE_H_
+    #define NCE_CHUNK_SIZE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #ifdef ARDUINO
+        #include "interface/udp_interface.h"
+    #else
+        #include "udp_interface.h"
+    #endif /* ifdef ARDUINO */
+    #include "nce_endpoint_cache.h"
+
+/**
+ * @brief Endpoints remembered, the least recently used one is replaced.
+ */
+    #ifndef NCE_SDK_CHUNK_ENDPOINTS
+        #define NCE_SDK_CHUNK_ENDPOINTS      4
+    #endif
+
+/**
+ * @brief Bytes added to the payload limit by a probe.
+ */
+    #ifndef NCE_SDK_CHUNK_STEP
+        #define NCE_SDK_CHUNK_STEP           64
+    #endif
+
+/**
+ * @brief Consecutive full-size chunks delivered before probing a larger size.
+ */
+    #ifndef NCE_SDK_CHUNK_GROW_AFTER
+        #define NCE_SDK_CHUNK_GROW_AFTER     4
+    #endif
+
+/**
+ * @brief Consecutive full-size chunks lost before shrinking, a single loss is
+ * taken as ordinary packet loss.
+ */
+    #ifndef NCE_SDK_CHUNK_LOSS_LIMIT
+        #define NCE_SDK_CHUNK_LOSS_LIMIT     2
+    #endif
+
+/**
+ * @brief Chunks delivered before a size that failed may be probed again, in
+ * case the path changed.
+ */
+    #ifndef NCE_SDK_CHUNK_CEILING_RESET
+        #define NCE_SDK_CHUNK_CEILING_RESET  256
+    #endif
+
+/**
+ * @brief State of one endpoint.
+ */
+typedef struct nce_chunk_path
+{
+    nce_endpoint_entry_t entry; /**< Key and last use, first for nce_endpoint_cache_get(). */
+    uint16_t size;              /**< Current payload limit. */
+    uint16_t confirmed;         /**< Largest payload delivered below the ceiling. */
+    uint16_t ceiling;           /**< Smallest payload lost repeatedly, 0 for none. */
+    uint16_t sinceCeiling;      /**< Chunks delivered since ceiling was set. */
+    uint8_t delivered;          /**< Consecutive full-size chunks delivered. */
+    uint8_t lost;               /**< Consecutive full-size chunks lost. */
+    uint16_t grows;             /**< Probes of a larger size. */
+    uint16_t shrinks;           /**< Fall-backs to a smaller size. */
+} nce_chunk_path_t;
+
+/**
+ * @brief Payload limits of the endpoints a sender talks to. Not locked: use
+ * it from the thread sending the chunks.
+ */
+typedef struct nce_chunk_size
+{
+    nce_chunk_path_t paths[ NCE_SDK_CHUNK_ENDPOINTS ]; /**< Endpoints. */
+    uint32_t uses;                                     /**< Use counter. */
+    uint16_t minSize;                                  /**< Smallest payload limit. */
+    uint16_t maxSize;                                  /**< Largest payload limit, e.g. the chunk buffer size. */
+    uint16_t initialSize;                              /**< Payload limit of a new endpoint. */
+} nce_chunk_size_t;
+
+/**
+ * @brief Initialize an empty cache.
+ *
+ * @param[out] cache: Cache.
+ * @param[in] minSize: Smallest payload limit.
+ * @param[in] maxSize: Largest payload limit, at least minSize.
+ * @param[in] initialSize: Payload limit of a new endpoint, clamped to the
+ * bounds. nce_chunk_size_for_mtu() gives one from a known path MTU.
+ */
+void nce_chunk_size_init( nce_chunk_size_t * cache,
+                          size_t minSize,
+                          size_t maxSize,
+                          size_t initialSize );
+
+/**
+ * @brief Payload fitting a path MTU once the headers are added.
+ *
+ * @param[in] mtu: Path MTU, e.g. 1280 for IPv6 or the carrier's value.
+ * @param[in] overhead: IP, UDP, DTLS and CoAP header bytes of one datagram.
+ *
+ * @return Payload bytes, 0 if the headers alone exceed the MTU.
+ */
+size_t nce_chunk_size_for_mtu( size_t mtu,
+                               size_t overhead );
+
+/**
+ * @brief Payload limit to use for the next chunk to an endpoint.
+ *
+ * @param[in] cache: Cache.
+ * @param[in] endpoint: Endpoint, an unknown one starts at the initial size.
+ *
+ * @return Bytes between the bounds of the cache.
+ */
+size_t nce_chunk_size_get( nce_chunk_size_t * cache,
+                           const OSEndPoint_t * endpoint );
+
+/**
+ * @brief Report the outcome of a chunk.
+ *
+ * Only full-size chunks, at least the current limit, move the limit:
+ * a short last chunk says nothing about the path.
+ *
+ * @param[in] cache: Cache.
+ * @param[in] endpoint: Endpoint the chunk was sent to.
+ * @param[in] size: Payload bytes of the chunk.
+ * @param[in] delivered: Nonzero if the chunk was acknowledged, zero if it
+ * timed out.
+ */
+void nce_chunk_size_report( nce_chunk_size_t * cache,
+                            const OSEndPoint_t * endpoint,
+                            size_t size,
+                            int delivered );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_CHUNK_SIZE_H_ */
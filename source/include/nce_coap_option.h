@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_coap_option.h
+ * @brief CoAP option encoding and decoding (RFC 7252, 3.1) shared by the
+ * modules building messages by hand (nce_memfault.h, nce_telemetry.h,
+ * nce_oscore.h) and those reading them (nce_retry.h, nce_downlink.h).
+ *
+ * An option is written as a header byte holding the delta to the previous
+ * option number and the value length, each as a 4-bit nibble followed by 0
+ * to 2 extension bytes, then the value.
+ */
+
+#ifndef NCE_COAP_OPTION_H_
+    #define NCE_COAP_OPTION_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+/**
+ * @brief Largest option delta or value length that can be encoded.
+ */
+    #define NCE_COAP_OPTION_FIELD_MAX    65804u
+
+/**
+ * @brief Append an option to a message.
+ *
+ * @param[in,out] message: Message being built.
+ * @param[in] length: Length of the message so far.
+ * @param[in] size: Size of the message buffer.
+ * @param[in] delta: Option number minus the number of the previous option.
+ * @param[in] value: Value of the option.
+ * @param[in] valueLength: Length of the value.
+ *
+ * @return Length of the message with the option, 0 if it does not fit or
+ * delta or valueLength exceed NCE_COAP_OPTION_FIELD_MAX.
+ */
+size_t nce_coap_option_append( uint8_t * message,
+                               size_t length,
+                               size_t size,
+                               uint32_t delta,
+                               const void * value,
+                               size_t valueLength );
+
+/**
+ * @brief Read an option delta or length from its nibble and extension bytes.
+ *
+ * @param[in] message: Message being read.
+ * @param[in] length: Length of the message.
+ * @param[in,out] position: Position of the extension bytes, moved past them.
+ * @param[in] nibble: Nibble of the option header.
+ *
+ * @return The value, or -1 if malformed or truncated.
+ */
+long nce_coap_option_field( const uint8_t * message,
+                            size_t length,
+                            size_t * position,
+                            uint8_t nibble );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_COAP_OPTION_H_ */
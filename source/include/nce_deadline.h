@@ -0,0 +1,170 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_deadline.h
+ * @brief Time budget of a deadline-aware operation.
+ *
+ * A device in PSM only has its radio for the active timer window, so an
+ * operation must end by a point in time rather than after a number of
+ * attempts. The caller gives a budget, the operation checks it before each
+ * step (connect, request, retry wait) and shares what is left of it between
+ * the receive timeouts of the attempts still allowed, then stops cleanly and
+ * reports how far it got in an nce_progress_t.
+ *
+ * Time is read from the 32-bit microsecond clock, so budgets are limited to
+ * NCE_DEADLINE_MAX_MS (about 71 minutes).
+ */
+
+#ifndef NCE_DEADLINE_H_
+    #define NCE_DEADLINE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdbool.h>
+    #include <stdint.h>
+
+/**
+ * @brief Least budget left to start a step: a connect, a request or an
+ * attempt after a retry wait. Below it the operation stops.
+ */
+    #ifndef NCE_SDK_DEADLINE_MIN_MS
+        #define NCE_SDK_DEADLINE_MIN_MS         200u
+    #endif
+
+/**
+ * @brief Shortest receive timeout of an attempt when the budget is shared
+ * between the attempts left, so that a slow link still gets an answer in.
+ */
+    #ifndef NCE_SDK_DEADLINE_MIN_RECV_MS
+        #define NCE_SDK_DEADLINE_MIN_RECV_MS    1000u
+    #endif
+
+/**
+ * @brief Longest budget, longer ones are shortened to it.
+ */
+    #define NCE_DEADLINE_MAX_MS                 ( 0xFFFFFFFFu / 1000u )
+
+/**
+ * @brief Timeout of an attempt that is not known, e.g. without a round trip
+ * estimate.
+ */
+    #define NCE_DEADLINE_NO_TIMEOUT             0xFFFFFFFFu
+
+/**
+ * @brief Budget of an operation.
+ */
+typedef struct nce_deadline
+{
+    uint32_t startUs;  /**< Clock at the start of the operation. */
+    uint32_t budgetMs; /**< Time the operation may take. */
+} nce_deadline_t;
+
+/**
+ * @brief How far a deadline-aware operation got.
+ */
+typedef struct nce_progress
+{
+    int lastStatus;        /**< Status of the last step taken, e.g. the error that led to a retry, NCE_SDK_DEADLINE_EXCEEDED if none. */
+    bool connected;        /**< A connection was opened. */
+    unsigned int attempts; /**< Attempts started: onboarding requests, Memfault upload attempts. */
+    unsigned long chunks;  /**< Memfault chunks acknowledged by the proxy. */
+    unsigned long bytes;   /**< Memfault chunk bytes acknowledged by the proxy. */
+    uint32_t elapsedMs;    /**< Time the operation took. */
+} nce_progress_t;
+
+/**
+ * @brief Start the budget of an operation.
+ *
+ * @param[out] deadline: Budget.
+ * @param[in] budgetMs: Time the operation may take, at most NCE_DEADLINE_MAX_MS.
+ * @param[in] nowUs: Clock now.
+ */
+void nce_deadline_start( nce_deadline_t * deadline,
+                         uint32_t budgetMs,
+                         uint32_t nowUs );
+
+/**
+ * @brief Time spent since the start.
+ *
+ * @param[in] deadline: Budget.
+ * @param[in] nowUs: Clock now.
+ *
+ * @return Milliseconds since nce_deadline_start().
+ */
+uint32_t nce_deadline_elapsed_ms( const nce_deadline_t * deadline,
+                                  uint32_t nowUs );
+
+/**
+ * @brief Time left.
+ *
+ * @param[in] deadline: Budget.
+ * @param[in] nowUs: Clock now.
+ *
+ * @return Milliseconds left, 0 once the budget is spent.
+ */
+uint32_t nce_deadline_remaining_ms( const nce_deadline_t * deadline,
+                                    uint32_t nowUs );
+
+/**
+ * @brief Whether a step still fits: at least NCE_SDK_DEADLINE_MIN_MS plus
+ * the wait before it are left.
+ *
+ * @param[in] deadline: Budget.
+ * @param[in] waitMs: Wait before the step, 0 for none.
+ * @param[in] nowUs: Clock now.
+ *
+ * @return true if the step may start.
+ */
+bool nce_deadline_allows( const nce_deadline_t * deadline,
+                          uint32_t waitMs,
+                          uint32_t nowUs );
+
+/**
+ * @brief Receive timeout of the next attempt: an equal share of what is
+ * left for each attempt still allowed, at least NCE_SDK_DEADLINE_MIN_RECV_MS,
+ * and neither longer than the timeout the attempt would use without a
+ * deadline nor than what is left.
+ *
+ * @param[in] deadline: Budget.
+ * @param[in] timeoutMs: Timeout without a deadline, NCE_DEADLINE_NO_TIMEOUT
+ * if not known.
+ * @param[in] attemptsLeft: Attempts still allowed, this one included.
+ * @param[in] nowUs: Clock now.
+ *
+ * @return Timeout in milliseconds, 0 once the budget is spent.
+ */
+uint32_t nce_deadline_share_ms( const nce_deadline_t * deadline,
+                                uint32_t timeoutMs,
+                                unsigned int attemptsLeft,
+                                uint32_t nowUs );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_DEADLINE_H_ */
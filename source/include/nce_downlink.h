@@ -0,0 +1,339 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_downlink.h
+ * @brief Dispatcher of server-initiated CoAP requests.
+ *
+ * Without it the SDK only receives right after sending a request, and
+ * messages pushed by 1NCE OS (device-bound messages, configuration) must be
+ * read from the socket by the application. The dispatcher takes the
+ * datagrams arriving on a connected socket, answers CoAP pings, matches the
+ * acknowledgements and resets of its own notifications without parsing them,
+ * drops retransmitted requests seen within EXCHANGE_LIFETIME (answering them
+ * again with the cached response), and calls the handler registered for the
+ * Uri-Path of each new request. GET requests with an Observe option register
+ * the requester as an observer of the resource (RFC 7641), and
+ * nce_downlink_notify() sends it the new state when it changes.
+ *
+ * It is poll-driven and never blocks longer than the receive timeout of the
+ * port: call nce_downlink_poll() while the radio is on anyway, e.g. in the
+ * receive window after an uplink, or hand it datagrams received elsewhere
+ * with nce_downlink_process(). Receive and transmit buffers are part of
+ * nce_downlink_t, nothing is allocated.
+ *
+ * Compiled with NCE_SDK_DOWNLINK.
+ */
+
+#ifndef NCE_DOWNLINK_H_
+    #define NCE_DOWNLINK_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include "nce_iot_c_sdk.h"
+
+/**
+ * @brief Size of the receive and of the transmit buffer, the largest
+ * request and response handled.
+ */
+    #ifndef NCE_SDK_DOWNLINK_BUFFER_SIZE
+        #define NCE_SDK_DOWNLINK_BUFFER_SIZE          256
+    #endif
+
+/**
+ * @brief Size of the Uri-Path of a request joined with '/', terminator
+ * included.
+ */
+    #ifndef NCE_SDK_DOWNLINK_PATH_SIZE
+        #define NCE_SDK_DOWNLINK_PATH_SIZE            48
+    #endif
+
+/**
+ * @brief Size of the Uri-Query of a request joined with '&', terminator
+ * included.
+ */
+    #ifndef NCE_SDK_DOWNLINK_QUERY_SIZE
+        #define NCE_SDK_DOWNLINK_QUERY_SIZE           48
+    #endif
+
+/**
+ * @brief Message IDs remembered for deduplication, the oldest is replaced.
+ */
+    #ifndef NCE_SDK_DOWNLINK_DEDUP_ENTRIES
+        #define NCE_SDK_DOWNLINK_DEDUP_ENTRIES        8
+    #endif
+
+/**
+ * @brief Time a message ID is remembered (CoAP EXCHANGE_LIFETIME, RFC 7252,
+ * 4.8.2).
+ */
+    #ifndef NCE_SDK_DOWNLINK_EXCHANGE_LIFETIME_S
+        #define NCE_SDK_DOWNLINK_EXCHANGE_LIFETIME_S  247u
+    #endif
+
+/**
+ * @brief Observers registered at the same time, at least 1.
+ */
+    #ifndef NCE_SDK_DOWNLINK_OBSERVERS
+        #define NCE_SDK_DOWNLINK_OBSERVERS            2
+    #endif
+
+/**
+ * @brief Time to wait for the acknowledgement of a confirmable notification
+ * before its first retransmission, doubled after each one (CoAP ACK_TIMEOUT,
+ * RFC 7252, 4.8).
+ */
+    #ifndef NCE_SDK_DOWNLINK_ACK_TIMEOUT_MS
+        #define NCE_SDK_DOWNLINK_ACK_TIMEOUT_MS       2000u
+    #endif
+
+/**
+ * @brief Retransmissions of a confirmable notification before the observer
+ * is removed (CoAP MAX_RETRANSMIT).
+ */
+    #ifndef NCE_SDK_DOWNLINK_MAX_RETRANSMIT
+        #define NCE_SDK_DOWNLINK_MAX_RETRANSMIT       4u
+    #endif
+
+/**
+ * @brief Response codes (class << 5 | detail) a handler typically sets.
+ */
+    #define NCE_COAP_CREATED                          0x41u /* 2.01 */
+    #define NCE_COAP_DELETED                          0x42u /* 2.02 */
+    #define NCE_COAP_CHANGED                          0x44u /* 2.04 */
+    #define NCE_COAP_CONTENT                          0x45u /* 2.05 */
+    #define NCE_COAP_BAD_REQUEST                      0x80u /* 4.00 */
+    #define NCE_COAP_BAD_OPTION                       0x82u /* 4.02 */
+    #define NCE_COAP_NOT_FOUND                        0x84u /* 4.04 */
+    #define NCE_COAP_METHOD_NOT_ALLOWED               0x85u /* 4.05 */
+    #define NCE_COAP_INTERNAL_ERROR                   0xA0u /* 5.00 */
+
+/**
+ * @brief Request methods.
+ */
+    #define NCE_COAP_GET                              1u
+    #define NCE_COAP_POST                             2u
+    #define NCE_COAP_PUT                              3u
+    #define NCE_COAP_DELETE                           4u
+
+/**
+ * @brief Request handed to a handler.
+ */
+typedef struct nce_downlink_request
+{
+    uint8_t method;            /**< NCE_COAP_GET, NCE_COAP_POST, NCE_COAP_PUT or NCE_COAP_DELETE. */
+    bool confirmable;          /**< Request sent as a confirmable message. */
+    bool notification;         /**< Called by nce_downlink_notify() to build a notification. */
+    const char * path;         /**< Uri-Path options joined with '/', without a leading '/'. */
+    const char * query;        /**< Uri-Query options joined with '&', empty if none. */
+    int contentFormat;         /**< Content-Format of the payload, -1 if absent. */
+    const uint8_t * payload;   /**< Payload, in the receive buffer. */
+    size_t payloadLength;      /**< Length of the payload, 0 if none. */
+} nce_downlink_request_t;
+
+/**
+ * @brief Response filled by a handler.
+ */
+typedef struct nce_downlink_response
+{
+    uint8_t code;              /**< Response code, 2.05 Content for a GET and 2.04 Changed otherwise unless changed. */
+    int contentFormat;         /**< Content-Format of the payload, -1 (the default) for none. */
+    uint8_t * payload;         /**< Where to write the payload, in the transmit buffer. */
+    size_t payloadSize;        /**< Room for the payload. */
+    size_t payloadLength;      /**< Bytes written to payload, 0 by default. */
+} nce_downlink_response_t;
+
+/**
+ * @brief Handle a request to a resource.
+ *
+ * @param[in] arg: Argument of the resource.
+ * @param[in] request: Request, valid during the call.
+ * @param[in,out] response: Response to fill.
+ */
+typedef void (* nce_downlink_handler_t)( void * arg,
+                                         const nce_downlink_request_t * request,
+                                         nce_downlink_response_t * response );
+
+/**
+ * @brief Entry of the handler table.
+ */
+typedef struct nce_downlink_resource
+{
+    const char * path;              /**< Uri-Path handled, e.g. "config/interval", without a leading '/'. */
+    nce_downlink_handler_t handler; /**< Handler of its requests. */
+    void * arg;                     /**< Argument of the handler. */
+    bool observable;                /**< GET requests with Observe register an observer. */
+} nce_downlink_resource_t;
+
+/**
+ * @brief Message ID of a request received recently.
+ */
+typedef struct nce_downlink_seen
+{
+    uint32_t timeUs;           /**< Clock when it was received. */
+    uint16_t messageId;        /**< Message ID. */
+    uint8_t used;              /**< Nonzero for a valid entry. */
+} nce_downlink_seen_t;
+
+/**
+ * @brief Registration of an observer.
+ */
+typedef struct nce_downlink_observer
+{
+    const nce_downlink_resource_t * resource; /**< Resource observed, NULL for a free entry. */
+    uint8_t token[ 8 ];                       /**< Token of the registration, repeated in notifications. */
+    uint8_t tokenLength;                      /**< Length of the token. */
+    uint8_t pending;                          /**< A confirmable notification awaits its acknowledgement. */
+    uint8_t retransmissions;                  /**< Retransmissions of that notification so far. */
+    uint16_t lastId;                          /**< Message ID of the last notification. */
+    uint32_t sentUs;                          /**< Clock of its last transmission. */
+    uint32_t timeoutUs;                       /**< Time to wait for its acknowledgement from then on. */
+} nce_downlink_observer_t;
+
+/**
+ * @brief Counters of a dispatcher.
+ */
+typedef struct nce_downlink_stats
+{
+    unsigned long requests;        /**< Requests passed to a handler. */
+    unsigned long duplicates;      /**< Retransmitted requests dropped. */
+    unsigned long pings;           /**< Empty confirmable messages answered with a reset. */
+    unsigned long acks;            /**< Acknowledgements received. */
+    unsigned long resets;          /**< Resets received. */
+    unsigned long notFound;        /**< Requests to a path without handler. */
+    unsigned long rejected;        /**< Malformed or unexpected messages. */
+    unsigned long notifications;   /**< Notifications sent. */
+    unsigned long retransmissions; /**< Confirmable notifications sent again for a missing acknowledgement. */
+    unsigned long sendErrors;      /**< Responses and notifications the port failed to send. */
+} nce_downlink_stats_t;
+
+/**
+ * @brief State of a dispatcher. Not locked: poll, process and notify from
+ * one thread.
+ */
+typedef struct nce_downlink
+{
+    os_network_ops_t * osNetwork;                                  /**< Network operations, the socket is connected by the application. */
+    const nce_downlink_resource_t * resources;                     /**< Handler table. */
+    size_t resourceCount;                                          /**< Entries of the handler table. */
+    uint16_t messageId;                                            /**< Last message ID of a non-confirmable response or a notification. */
+    uint32_t observeSequence;                                      /**< Last Observe value sent. */
+    uint16_t responseId;                                           /**< Message ID of the request the transmit buffer answers. */
+    size_t responseLength;                                         /**< Length of that response, 0 if there is none to repeat. */
+    nce_downlink_seen_t seen[ NCE_SDK_DOWNLINK_DEDUP_ENTRIES ];    /**< Recent message IDs. */
+    nce_downlink_observer_t observers[ NCE_SDK_DOWNLINK_OBSERVERS ]; /**< Observers. */
+    nce_downlink_stats_t stats;                                    /**< Counters. */
+    char path[ NCE_SDK_DOWNLINK_PATH_SIZE ];                       /**< Uri-Path of the current request. */
+    char query[ NCE_SDK_DOWNLINK_QUERY_SIZE ];                     /**< Uri-Query of the current request. */
+    uint8_t rx[ NCE_SDK_DOWNLINK_BUFFER_SIZE ];                    /**< Receive buffer. */
+    uint8_t tx[ NCE_SDK_DOWNLINK_BUFFER_SIZE ];                    /**< Transmit buffer. */
+} nce_downlink_t;
+
+/**
+ * @brief Initialize a dispatcher.
+ *
+ * @param[out] downlink: Dispatcher.
+ * @param[in] osNetwork: Network operations, its socket is connected and
+ * disconnected by the application.
+ * @param[in] resources: Handler table, kept by reference.
+ * @param[in] resourceCount: Entries of the handler table.
+ */
+void nce_downlink_init( nce_downlink_t * downlink,
+                        os_network_ops_t * osNetwork,
+                        const nce_downlink_resource_t * resources,
+                        size_t resourceCount );
+
+/**
+ * @brief Receive and handle datagrams until a receive times out, then
+ * retransmit the notifications due with nce_downlink_tick().
+ *
+ * @param[in] downlink: Dispatcher.
+ * @param[in] maxDatagrams: Most datagrams handled by this call.
+ *
+ * @return Number of datagrams handled, NCE_SDK_RECEIVE_ERROR if the
+ * receive failed.
+ */
+int nce_downlink_poll( nce_downlink_t * downlink,
+                       unsigned int maxDatagrams );
+
+/**
+ * @brief Handle one datagram received by the application, e.g. one that is
+ * not the response to its own request.
+ *
+ * @param[in] downlink: Dispatcher.
+ * @param[in] datagram: Datagram, copied to the receive buffer if it is not
+ * already there.
+ * @param[in] length: Length of the datagram.
+ *
+ * @return NCE_SDK_SUCCESS, NCE_SDK_PARSING_ERROR for a malformed or
+ * unexpected message, NCE_SDK_SEND_ERROR if the answer was not sent.
+ */
+int nce_downlink_process( nce_downlink_t * downlink,
+                          const uint8_t * datagram,
+                          size_t length );
+
+/**
+ * @brief Notify the observers of a resource of its new state.
+ *
+ * The handler of the resource builds each notification. While a
+ * confirmable notification awaits its acknowledgement, the new one replaces
+ * it, confirmable and keeping its retransmission state (RFC 7641, 4.5.2). An
+ * observer that acknowledged none of its retransmissions is removed instead.
+ * A handler returning a code other than 2.xx ends the observations.
+ *
+ * @param[in] downlink: Dispatcher.
+ * @param[in] path: Uri-Path of the resource.
+ * @param[in] confirmable: Send confirmable notifications.
+ *
+ * @return Number of notifications sent, NCE_SDK_SEND_ERROR if one failed.
+ */
+int nce_downlink_notify( nce_downlink_t * downlink,
+                         const char * path,
+                         bool confirmable );
+
+/**
+ * @brief Retransmit the confirmable notifications whose acknowledgement
+ * timed out, with the same message ID and the current state of the
+ * resource, and remove the observers that left NCE_SDK_DOWNLINK_MAX_RETRANSMIT
+ * retransmissions unacknowledged. Called by nce_downlink_poll(); call it
+ * from time to time when processing datagrams received elsewhere.
+ *
+ * @param[in] downlink: Dispatcher.
+ *
+ * @return Number of notifications retransmitted, NCE_SDK_SEND_ERROR if one
+ * failed.
+ */
+int nce_downlink_tick( nce_downlink_t * downlink );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_DOWNLINK_H_ */
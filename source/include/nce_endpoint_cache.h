@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_endpoint_cache.h
+ * @brief Per-endpoint table shared by the estimators keeping state for each
+ * endpoint a device talks to (nce_rto.h, nce_chunk_size.h).
+ *
+ * An endpoint is identified by an FNV-1a hash of its host and port, so
+ * entries stay plain data an application may retain across sleep. A table
+ * holds entries of one type, each starting with an nce_endpoint_entry_t; a
+ * new endpoint replaces the least recently used entry.
+ */
+
+#ifndef NCE_ENDPOINT_CACHE_H_
+    #define NCE_ENDPOINT_CACHE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #ifdef ARDUINO
+        #include "interface/udp_interface.h"
+    #else
+        #include "udp_interface.h"
+    #endif /* ifdef ARDUINO */
+
+/**
+ * @brief Header of a table entry.
+ */
+typedef struct nce_endpoint_entry
+{
+    uint32_t key;     /**< Hash of host and port, 0 for a free entry. */
+    uint32_t lastUse; /**< Use counter of the table at the last access, for replacement. */
+} nce_endpoint_entry_t;
+
+/**
+ * @brief Key of an endpoint, never 0.
+ *
+ * @param[in] endpoint: Endpoint.
+ *
+ * @return FNV-1a hash of host and port.
+ */
+uint32_t nce_endpoint_key( const OSEndPoint_t * endpoint );
+
+/**
+ * @brief Entry of an endpoint. A new endpoint takes the least recently used
+ * entry, cleared except for its key.
+ *
+ * @param[in] entries: Table of count entries of entrySize bytes, each
+ * starting with an nce_endpoint_entry_t.
+ * @param[in] count: Entries in the table.
+ * @param[in] entrySize: Size of one entry.
+ * @param[in,out] uses: Use counter of the table.
+ * @param[in] endpoint: Endpoint.
+ * @param[out] created: Set if the entry was cleared for the endpoint.
+ *
+ * @return The entry.
+ */
+void * nce_endpoint_cache_get( void * entries,
+                               size_t count,
+                               size_t entrySize,
+                               uint32_t * uses,
+                               const OSEndPoint_t * endpoint,
+                               bool * created );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_ENDPOINT_CACHE_H_ */
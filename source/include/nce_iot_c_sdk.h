@@ -41,27 +41,18 @@ extern "C" {
     #include <string.h>
     #include <stdbool.h>
     #include <stdarg.h>
+    #include <stdint.h>
 
     #ifdef ARDUINO
         #include "interface/udp_interface.h"
     #else
         #include "udp_interface.h"
     #endif /* ifdef ARDUINO */
-
-/**
- * @brief definition of return codes.
- */
-enum
-{
-    NCE_SDK_SUCCESS = 0,               /**< The operation was successful. */
-    NCE_SDK_CONNECT_ERROR = -1,        /**< Generic Connection error. */
-    NCE_SDK_DTLS_CONNECT_ERROR = -2,   /**< DTLS Connection error. */
-    NCE_SDK_SEND_ERROR = -3,           /**< Packet sending error. */
-    NCE_SDK_RECEIVE_ERROR = -4,        /**< Packet reception error. */
-    NCE_SDK_PARSING_ERROR = -5,        /**< Response parsing error. */
-    NCE_SDK_BINARY_PAYLOAD_ERROR = -6, /**< Binary payload conversion error. */
-    NCE_SDK_SERVER_RESPONSE_ERROR = -7 /**< Server responded with an error (e.g., HTTP 404, 500). */
-};
+    #include "nce_status.h"
+    #include "nce_metrics.h"
+    #include "nce_trace.h"
+    #include "nce_rto.h"
+    #include "nce_deadline.h"
 
     #ifndef __ZEPHYR__
 
@@ -111,9 +102,173 @@ typedef struct DtlsKey
  */
 static const OSEndPoint_t NceOnboard = { "coap.os.1nce.com", 5683 };
 
+/**
+ * @brief Largest PSK stored by nce_dtls_key_t, at most 255.
+ */
+        #ifndef NCE_SDK_PSK_MAX_LENGTH
+            #define NCE_SDK_PSK_MAX_LENGTH             64
+        #endif
+
+/**
+ * @brief Largest PSK identity stored by nce_dtls_key_t, at most 255.
+ */
+        #ifndef NCE_SDK_PSK_IDENTITY_MAX_LENGTH
+            #define NCE_SDK_PSK_IDENTITY_MAX_LENGTH    32
+        #endif
+
+        #if ( NCE_SDK_PSK_MAX_LENGTH > 255 ) || ( NCE_SDK_PSK_IDENTITY_MAX_LENGTH > 255 )
+            #error "NCE_SDK_PSK_MAX_LENGTH and NCE_SDK_PSK_IDENTITY_MAX_LENGTH must not exceed 255."
+        #endif
+
+/**
+ * @brief Workspace size recommended for os_auth_v2(): the request, then the
+ * response carrying the identity and the PSK.
+ */
+        #ifndef NCE_SDK_AUTH_WORKSPACE_SIZE
+            #define NCE_SDK_AUTH_WORKSPACE_SIZE    150
+        #endif
+
+/**
+ * @brief Smallest workspace accepted by os_auth_v2(): the largest response
+ * (header, payload marker, identity, comma and PSK), a byte telling a cut
+ * response apart and a terminator.
+ */
+        #define NCE_SDK_AUTH_WORKSPACE_MIN    ( 4 + 1 + NCE_SDK_PSK_IDENTITY_MAX_LENGTH + 1 + NCE_SDK_PSK_MAX_LENGTH + 2 )
+
+        #if NCE_SDK_AUTH_WORKSPACE_SIZE < NCE_SDK_AUTH_WORKSPACE_MIN
+            #error "NCE_SDK_AUTH_WORKSPACE_SIZE must be at least NCE_SDK_AUTH_WORKSPACE_MIN."
+        #endif
+
+/**
+ * @brief DTLS credentials of the v2 API, stored as length-prefixed binary
+ * (not NUL-terminated).
+ */
+typedef struct nce_dtls_key
+{
+    uint8_t pskLength;                                     /**< Bytes used in psk. */
+    uint8_t psk[ NCE_SDK_PSK_MAX_LENGTH ];                 /**< Trusted secret key. */
+    uint8_t identityLength;                                /**< Bytes used in identity. */
+    uint8_t identity[ NCE_SDK_PSK_IDENTITY_MAX_LENGTH ];   /**< Identity indicated to the server (which key to use). */
+} nce_dtls_key_t;
+
+/**
+ * @brief Initial CoAP message ID of a freshly initialized context.
+ */
+        #define NCE_SDK_INITIAL_MESSAGE_ID    1000
+
+/**
+ * @brief SDK context holding the mutable state of one device.
+ *
+ * Every operation taking a context only touches the state stored in it (and
+ * in its network object), so independent devices can be served from different
+ * threads in parallel. A single context must not be used by two threads at
+ * the same time.
+ */
+typedef struct nce_context
+{
+    /**
+     * @brief UDP interface object used by the operations of this context.
+     */
+    os_network_ops_t * osNetwork;
+
+    /**
+     * @brief Connect taking the endpoint by pointer, set by os_context_init_v2().
+     * NULL for v1 contexts, which use osNetwork->nce_os_udp_connect.
+     */
+    int ( * connectV2 )( OSNetwork_t osnetwork,
+                         const OSEndPoint_t * endpoint );
+
+    /**
+     * @brief Endpoint the onboarding request is sent to (1NCE by default).
+     */
+    const OSEndPoint_t * onboardEndpoint;
+
+    /**
+     * @brief Last CoAP message ID used by this context.
+     */
+    uint16_t messageId;
+
+    /**
+     * @brief Waits between onboarding attempts as decided by nce_retry.h.
+     * os_context_init() sets NceOSDelayMs() where the OS provides one, NULL
+     * (retry at once) on generic platforms.
+     */
+    void ( * delayMs )( uint32_t ms );
+
+    #ifdef NCE_SDK_METRICS
+
+    /**
+     * @brief Metrics updated by this context, NULL for the shared default
+     * instance. Contexts used from different threads need their own.
+     */
+    nce_metrics_t * metrics;
+    #endif
+
+    #ifdef NCE_SDK_RTO
+
+    /**
+     * @brief Round trip estimates of this context (nce_rto.h), NULL to keep
+     * the fixed timeout and backoff. Not locked: contexts used from
+     * different threads need their own.
+     */
+    nce_rto_t * rto;
+    #endif
+
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+
+    /**
+     * @brief Applies the receive timeout to the socket before each
+     * onboarding attempt, e.g. nce_os_set_recv_timeout() of the port: the
+     * estimate with NCE_SDK_RTO, shortened to the share of the budget in
+     * os_auth_deadline(). NULL keeps the fixed timeout of the port, round
+     * trips are still estimated. With an estimator in rto, a timed out
+     * attempt is retried without the backoff wait: the timeout itself backs
+     * off.
+     */
+    int ( * setRecvTimeout )( OSNetwork_t osnetwork,
+                              uint32_t ms );
+    #endif
+
+    #ifdef NCE_SDK_DEADLINE
+
+    /**
+     * @brief Budget of the running os_auth_deadline(), NULL otherwise.
+     */
+    const nce_deadline_t * deadline;
+
+    /**
+     * @brief Progress reported by the running os_auth_deadline(), NULL otherwise.
+     */
+    nce_progress_t * progress;
+    #endif
+} nce_context_t;
+
+/**
+ * @brief Initialize an SDK context for one device.
+ *
+ * @param[out] ctx: Context to initialize.
+ * @param[in] osNetwork: UDP interface object owned by this device.
+ */
+void os_context_init( nce_context_t * ctx,
+                      os_network_ops_t * osNetwork );
 
 /**
  * @brief Communicate with 1NCE Device Authenticator to get DTLS credentials
+ * using the state of the given context.
+ *
+ * @param[in] ctx: SDK context of the device.
+ * @param[in] nceKey: new DTLS credential required.
+ *
+ * @return The status of the onboarding.
+ */
+int os_auth_ctx( nce_context_t * ctx,
+                 DtlsKey_t * nceKey );
+
+/**
+ * @brief Communicate with 1NCE Device Authenticator to get DTLS credentials
+ *
+ * @note Uses a default context shared by all callers of this function, use
+ * os_auth_ctx() when several devices are onboarded concurrently.
  *
  * @param[in] osNetwork: UDP interface object.
  * @param[in] nceKey: new DTLS credential required.
@@ -123,6 +278,66 @@ static const OSEndPoint_t NceOnboard = { "coap.os.1nce.com", 5683 };
 int os_auth( os_network_ops_t * osNetwork,
              DtlsKey_t * nceKey );
 
+/**
+ * @brief Initialize an SDK context for one device with v2 network operations.
+ *
+ * @param[out] ctx: Context to initialize.
+ * @param[in] osNetwork: UDP interface object owned by this device, kept by pointer.
+ */
+void os_context_init_v2( nce_context_t * ctx,
+                         os_network_ops_v2_t * osNetwork );
+
+/**
+ * @brief Get DTLS credentials from 1NCE Device Authenticator, building the
+ * request and receiving the response in a caller-provided workspace.
+ *
+ * Besides the workspace, the operation only uses a few dozen bytes of stack
+ * (see the RAM budget in the README).
+ *
+ * @param[in] ctx: SDK context of the device, v1 or v2.
+ * @param[out] nceKey: Credentials received.
+ * @param[in] workspace: Transient buffer of the operation.
+ * @param[in] workspaceSize: Size of the workspace, NCE_SDK_AUTH_WORKSPACE_SIZE
+ * recommended, at least NCE_SDK_AUTH_WORKSPACE_MIN.
+ *
+ * @return The status of the onboarding, NCE_SDK_WORKSPACE_ERROR if the
+ * workspace is too small, NCE_SDK_PARSING_ERROR if the identity or the PSK
+ * exceed their configured maxima.
+ */
+int os_auth_v2( nce_context_t * ctx,
+                nce_dtls_key_t * nceKey,
+                void * workspace,
+                size_t workspaceSize );
+
+        #ifdef NCE_SDK_DEADLINE
+
+/**
+ * @brief os_auth_v2() ending within a time budget, e.g. the active time of
+ * PSM. Each connect attempt and each request only starts while
+ * NCE_SDK_DEADLINE_MIN_MS of the budget are left, the receive timeouts share
+ * what is left between the requests still allowed (through
+ * ctx->setRecvTimeout) and a retry wait that would end past the budget stops
+ * the onboarding instead. Name resolution and connecting run in the port and
+ * are only checked between attempts.
+ *
+ * @param[in] ctx: SDK context of the device, v1 or v2.
+ * @param[out] nceKey: Credentials received.
+ * @param[in] workspace: Transient buffer of the operation.
+ * @param[in] workspaceSize: Size of the workspace, at least NCE_SDK_AUTH_WORKSPACE_MIN.
+ * @param[in] budgetMs: Time the onboarding may take.
+ * @param[out] progress: How far the onboarding got, NULL if not needed.
+ *
+ * @return The status of os_auth_v2(), or NCE_SDK_DEADLINE_EXCEEDED when the
+ * budget ran out before a usable response.
+ */
+int os_auth_deadline( nce_context_t * ctx,
+                      nce_dtls_key_t * nceKey,
+                      void * workspace,
+                      size_t workspaceSize,
+                      uint32_t budgetMs,
+                      nce_progress_t * progress );
+        #endif /* ifdef NCE_SDK_DEADLINE */
+
 
     #endif /* ifdef NCE_DEVICE_AUTHENTICATOR */
 
@@ -178,6 +393,10 @@ Element2byte_gen_t;
 /**
  * @brief Translation service feature: translates message to binary payload with a given template in 1NCE Portal.
  *
+ * @note An integer is refused unless it equals its first byte read as a char,
+ * whatever its template length. os_energy_save_v2() checks the signed range of
+ * the template length instead.
+ *
  * @param[in] packet: Packet to send to the endpoint
  * @param[in] selector: Select data used in control statement.
  * @param[in] num_args: Number of arguments in function.
@@ -189,6 +408,26 @@ int os_energy_save( char * packet,
                     int num_args,
                     ... );
 
+/**
+ * @brief Translation service feature of the v2 API: elements are passed by
+ * pointer instead of by value, the packet size is checked, and integers are
+ * checked against the signed range of their template length.
+ *
+ * @param[out] packet: Packet to send to the endpoint.
+ * @param[in] packetSize: Size of the packet buffer.
+ * @param[in] selector: Select data used in control statement.
+ * @param[in] elements: Values to translate.
+ * @param[in] count: Number of values.
+ *
+ * @return Length of the packet, NCE_SDK_BINARY_PAYLOAD_ERROR if a value does
+ * not fit its template length or the packet does not fit the buffer.
+ */
+int os_energy_save_v2( uint8_t * packet,
+                       size_t packetSize,
+                       uint8_t selector,
+                       const Element2byte_gen_t * elements,
+                       size_t count );
+
     #endif /* ifdef NCE_ENERGY_SAVER */
 
     #ifdef __cplusplus
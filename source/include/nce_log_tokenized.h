@@ -0,0 +1,238 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_log_tokenized.h
+ * @brief Deferred binary logging backend of log_interface.h.
+ *
+ * With NCE_SDK_LOG_TOKENIZED defined, a log call stores its format string in
+ * the nce_log_fmt section and only writes the address of that string (the
+ * token) and the raw arguments to a lock-free ring buffer. Nothing is
+ * formatted on the device. The application drains the ring with
+ * nce_log_drain() and forwards the records; tools/logdecode turns them back
+ * into text using the ELF file of the build.
+ *
+ * Place the section outside of the image in the linker script, e.g.
+ * `nce_log_fmt 0 (INFO) : { KEEP(*(nce_log_fmt)) }`, to keep the strings out
+ * of flash.
+ *
+ * Requires GCC or Clang (section attribute and type builtins). Producers may
+ * run on any thread, nce_log_drain() on a single one.
+ */
+
+#ifndef NCE_LOG_TOKENIZED_H_
+    #define NCE_LOG_TOKENIZED_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+/**
+ * @brief Size of the ring buffer in bytes, a power of two.
+ */
+    #ifndef NCE_SDK_LOG_BUFFER_SIZE
+        #define NCE_SDK_LOG_BUFFER_SIZE    1024
+    #endif
+
+/**
+ * @brief Largest record, longer argument lists are truncated.
+ */
+    #define NCE_LOG_MAX_RECORD             64
+
+/**
+ * @brief Level flag set in records whose arguments were truncated.
+ */
+    #define NCE_LOG_TRUNCATED              0x80
+
+/**
+ * @brief Longest string argument copied into a record.
+ */
+    #define NCE_LOG_MAX_STRING             32
+
+/**
+ * @brief Argument tags of the record format.
+ */
+    #define NCE_LOG_ARG_INT                1
+    #define NCE_LOG_ARG_DOUBLE             2
+    #define NCE_LOG_ARG_STRING             3
+    #define NCE_LOG_ARG_POINTER            4
+
+/**
+ * @brief Record being encoded on the stack of the logging thread.
+ *
+ * Layout: length (1 byte, also the commit marker), level (1 byte), token
+ * (unsigned LEB128), then per argument a tag and its value: zigzag LEB128
+ * integer, 8-byte double, length-prefixed string or LEB128 pointer.
+ */
+typedef struct nce_log_record
+{
+    uint8_t data[ NCE_LOG_MAX_RECORD ]; /**< Encoded record. */
+    size_t length;                      /**< Bytes used in data. */
+} nce_log_record_t;
+
+/**
+ * @brief Start a record.
+ *
+ * @param[out] record: Record to start.
+ * @param[in] level: Level of the message.
+ * @param[in] format: Format string in the nce_log_fmt section.
+ */
+void nce_log_begin( nce_log_record_t * record,
+                    int level,
+                    const char * format );
+
+/**
+ * @brief Append an integer argument.
+ *
+ * @param[in] record: Record being encoded.
+ * @param[in] value: Argument.
+ */
+void nce_log_put_int( nce_log_record_t * record,
+                      long value );
+
+/**
+ * @brief Append a floating point argument.
+ *
+ * @param[in] record: Record being encoded.
+ * @param[in] value: Argument.
+ */
+void nce_log_put_double( nce_log_record_t * record,
+                         double value );
+
+/**
+ * @brief Append a string argument (copied, at most NCE_LOG_MAX_STRING bytes).
+ *
+ * @param[in] record: Record being encoded.
+ * @param[in] value: Argument.
+ */
+void nce_log_put_string( nce_log_record_t * record,
+                         const char * value );
+
+/**
+ * @brief Append a pointer argument.
+ *
+ * @param[in] record: Record being encoded.
+ * @param[in] value: Argument.
+ */
+void nce_log_put_pointer( nce_log_record_t * record,
+                          const void * value );
+
+/**
+ * @brief Publish a record in the ring buffer, dropped if it does not fit.
+ *
+ * @param[in] record: Encoded record.
+ */
+void nce_log_commit( nce_log_record_t * record );
+
+/**
+ * @brief Move the published records out of the ring buffer.
+ *
+ * @param[out] buffer: Destination of the records.
+ * @param[in] size: Size of the destination.
+ *
+ * @return Bytes copied, always whole records.
+ */
+size_t nce_log_drain( uint8_t * buffer,
+                      size_t size );
+
+/**
+ * @brief Number of records dropped because the ring buffer was full.
+ */
+uint32_t nce_log_dropped( void );
+
+/**
+ * @brief Section holding the format strings.
+ */
+    #define NCE_LOG_SECTION    "nce_log_fmt"
+
+/**
+ * @brief Append one argument with the encoder matching its type.
+ */
+    #define NCE_LOG_ARG( record, x )                                                      \
+    __builtin_choose_expr( NCE_LOG_IS_STRING( x ), nce_log_put_string,                    \
+                           __builtin_choose_expr( NCE_LOG_IS_FLOAT( x ), nce_log_put_double, \
+                                                  __builtin_choose_expr( NCE_LOG_IS_POINTER( x ), nce_log_put_pointer, nce_log_put_int ) ) ) ( record, x )
+
+/**
+ * @brief Whether an argument is a character string.
+ */
+    #define NCE_LOG_IS_STRING( x )                                    \
+    ( __builtin_types_compatible_p( __typeof__( ( x ) + 0 ), char * ) || \
+      __builtin_types_compatible_p( __typeof__( ( x ) + 0 ), const char * ) )
+
+/**
+ * @brief Whether an argument is a floating point number.
+ */
+    #define NCE_LOG_IS_FLOAT( x )                                    \
+    ( __builtin_types_compatible_p( __typeof__( ( x ) + 0 ), double ) || \
+      __builtin_types_compatible_p( __typeof__( ( x ) + 0 ), float ) )
+
+/**
+ * @brief Whether an argument is a pointer (5 is pointer_type_class).
+ */
+    #define NCE_LOG_IS_POINTER( x )    ( __builtin_classify_type( x ) == 5 )
+
+/**
+ * @brief Number of arguments after the record (0 to 8).
+ */
+    #define NCE_LOG_COUNT( ... )                                  NCE_LOG_COUNT_( __VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0 )
+    #define NCE_LOG_COUNT_( r, a1, a2, a3, a4, a5, a6, a7, a8, n, ... )    n
+    #define NCE_LOG_CAT( a, b )                                   NCE_LOG_CAT_( a, b )
+    #define NCE_LOG_CAT_( a, b )                                  a ## b
+
+/**
+ * @brief Append every argument to the record.
+ */
+    #define NCE_LOG_ARGS( r, ... )                                NCE_LOG_CAT( NCE_LOG_ARGS_, NCE_LOG_COUNT( r, ## __VA_ARGS__ ) )( r, ## __VA_ARGS__ )
+    #define NCE_LOG_ARGS_0( r )
+    #define NCE_LOG_ARGS_1( r, a )                                NCE_LOG_ARG( r, a );
+    #define NCE_LOG_ARGS_2( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_1( r, __VA_ARGS__ )
+    #define NCE_LOG_ARGS_3( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_2( r, __VA_ARGS__ )
+    #define NCE_LOG_ARGS_4( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_3( r, __VA_ARGS__ )
+    #define NCE_LOG_ARGS_5( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_4( r, __VA_ARGS__ )
+    #define NCE_LOG_ARGS_6( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_5( r, __VA_ARGS__ )
+    #define NCE_LOG_ARGS_7( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_6( r, __VA_ARGS__ )
+    #define NCE_LOG_ARGS_8( r, a, ... )                           NCE_LOG_ARG( r, a ); NCE_LOG_ARGS_7( r, __VA_ARGS__ )
+
+/**
+ * @brief Emit a tokenized record: the format string only lives in the
+ * nce_log_fmt section, the call site encodes the token and the arguments.
+ */
+    #define NCE_LOG_TOKENIZED( level, format, ... )                                              \
+    do {                                                                                         \
+        static const char nceLogFormat[] __attribute__( ( section( NCE_LOG_SECTION ), used ) ) = format; \
+        nce_log_record_t nceLogRecord;                                                           \
+        nce_log_begin( &nceLogRecord, ( level ), nceLogFormat );                                 \
+        NCE_LOG_ARGS( &nceLogRecord, ## __VA_ARGS__ )                                            \
+        nce_log_commit( &nceLogRecord );                                                         \
+    } while( 0 )
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_LOG_TOKENIZED_H_ */
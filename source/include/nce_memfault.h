@@ -0,0 +1,251 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_memfault.h
+ * @brief Memfault chunk uploader through the 1NCE CoAP proxy.
+ *
+ * The upload engine only uses os_network_ops_t and a chunk source, so every
+ * port gets the same uploader: the Zephyr port feeds it from the Memfault
+ * packetizer, a host build from any buffer or file. Chunks are posted to the
+ * proxy one by one as confirmable CoAP requests carrying the Memfault URI in
+ * a Proxy-Uri option; their size follows the path MTU (nce_chunk_size.h) and
+ * failed uploads are retried as decided by nce_retry.h.
+ *
+ * All the state of an upload lives in its nce_memfault_uploader_t, so a
+ * gateway can relay the chunks of many devices with one uploader each.
+ *
+ * Compiled with NCE_SDK_MEMFAULT.
+ */
+
+#ifndef NCE_MEMFAULT_H_
+    #define NCE_MEMFAULT_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include "nce_iot_c_sdk.h"
+    #include "nce_chunk_size.h"
+    #include "nce_retry.h"
+
+/**
+ * @brief Host of the 1NCE CoAP proxy.
+ */
+    #define NCE_MEMFAULT_PROXY_HOST    "coap.proxy.os.1nce.com"
+
+/**
+ * @brief Largest chunk, the size of the chunk buffer.
+ */
+    #ifndef NCE_SDK_MEMFAULT_BUFFER_SIZE
+        #define NCE_SDK_MEMFAULT_BUFFER_SIZE          512
+    #endif
+
+/**
+ * @brief Smallest chunk the adaptive chunk size falls back to.
+ */
+    #ifndef NCE_SDK_MEMFAULT_CHUNK_MIN
+        #define NCE_SDK_MEMFAULT_CHUNK_MIN            128
+    #endif
+
+/**
+ * @brief Chunk size until the path towards the proxy has been probed.
+ */
+    #ifndef NCE_SDK_MEMFAULT_CHUNK_INITIAL
+        #define NCE_SDK_MEMFAULT_CHUNK_INITIAL        256
+    #endif
+
+/**
+ * @brief Upload attempts of nce_memfault_upload().
+ */
+    #ifndef NCE_SDK_MEMFAULT_ATTEMPTS
+        #define NCE_SDK_MEMFAULT_ATTEMPTS             3
+    #endif
+
+/**
+ * @brief Shortest wait between two upload attempts.
+ */
+    #ifndef NCE_SDK_MEMFAULT_ATTEMPT_DELAY_MS
+        #define NCE_SDK_MEMFAULT_ATTEMPT_DELAY_MS     5000u
+    #endif
+
+/**
+ * @brief Memfault URI forwarded by the proxy, which fills in the ICCID.
+ */
+    #ifndef NCE_SDK_MEMFAULT_PROXY_URI
+        #define NCE_SDK_MEMFAULT_PROXY_URI            "https://chunks.memfault.com/api/v0/chunks/:iccid:"
+    #endif
+
+/**
+ * @brief Room for the CoAP header, options and payload marker around a chunk.
+ */
+    #ifndef NCE_SDK_MEMFAULT_REQUEST_OVERHEAD
+        #define NCE_SDK_MEMFAULT_REQUEST_OVERHEAD     128
+    #endif
+
+/**
+ * @brief Size of the buffer receiving the responses of the proxy.
+ */
+    #ifndef NCE_SDK_MEMFAULT_RESPONSE_SIZE
+        #define NCE_SDK_MEMFAULT_RESPONSE_SIZE        128
+    #endif
+
+/**
+ * @brief Source of the chunks, e.g. the Memfault packetizer.
+ */
+typedef struct nce_memfault_source
+{
+    /**
+     * @brief Take the next chunk.
+     *
+     * @param[in] arg: Argument of the source.
+     * @param[out] buffer: Chunk.
+     * @param[in,out] length: Size of the buffer, then length of the chunk.
+     *
+     * @return true if a chunk was taken, false when there is no more data.
+     */
+    bool ( * getChunk )( void * arg,
+                         uint8_t * buffer,
+                         size_t * length );
+
+    /**
+     * @brief Called when an upload stops in the middle of a message, so its
+     * chunks are taken again from its start next time. NULL if not needed.
+     *
+     * @param[in] arg: Argument of the source.
+     */
+    void ( * abort )( void * arg );
+
+    /**
+     * @brief Argument of the callbacks.
+     */
+    void * arg;
+} nce_memfault_source_t;
+
+/**
+ * @brief State of one uploader. Not locked: a source must only be drained by
+ * one uploader at a time.
+ */
+typedef struct nce_memfault_uploader
+{
+    os_network_ops_t * osNetwork;                 /**< Network operations and socket towards the proxy. */
+    const OSEndPoint_t * proxy;                   /**< Endpoint of the proxy. */
+    const char * proxyUri;                        /**< Proxy-Uri of the requests, NCE_SDK_MEMFAULT_PROXY_URI by default. */
+    nce_memfault_source_t source;                 /**< Source of the chunks. */
+    void ( * delayMs )( uint32_t ms );            /**< Waits between attempts, NceOSDelayMs() where the OS provides one, NULL retries at once. */
+    nce_chunk_size_t chunkSizes;                  /**< Chunk size per endpoint, kept across uploads. */
+    nce_retry_decision_t retry;                   /**< Classification of the last failed attempt. */
+    uint16_t messageId;                           /**< Last CoAP message ID. */
+    unsigned long chunks;                         /**< Chunks acknowledged by the proxy. */
+    unsigned long bytes;                          /**< Chunk bytes acknowledged by the proxy. */
+    #ifdef NCE_SDK_METRICS
+    nce_metrics_t * metrics;                      /**< Metrics updated by this uploader, NULL for the shared default instance. Uploaders used from different threads need their own. */
+    #endif
+    #ifdef NCE_SDK_RTO
+    nce_rto_t * rto;                              /**< Round trip estimates of the proxy, NULL for none. */
+    #endif
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+    int ( * setRecvTimeout )( OSNetwork_t osnetwork,
+                              uint32_t ms );      /**< Applies the estimated timeout, or the share of the budget, to the socket, NULL keeps the port's. */
+    #endif
+    #ifdef NCE_SDK_DEADLINE
+    const nce_deadline_t * deadline;              /**< Budget of the running nce_memfault_upload_deadline(), NULL otherwise. */
+    nce_progress_t * progress;                    /**< Progress reported by the running nce_memfault_upload_deadline(), NULL otherwise. */
+    #endif
+    uint8_t chunk[ NCE_SDK_MEMFAULT_BUFFER_SIZE ];                                          /**< Chunk taken from the source. */
+    uint8_t request[ NCE_SDK_MEMFAULT_BUFFER_SIZE + NCE_SDK_MEMFAULT_REQUEST_OVERHEAD ];    /**< Encoded request. */
+    uint8_t response[ NCE_SDK_MEMFAULT_RESPONSE_SIZE ];                                     /**< Response of the proxy. */
+} nce_memfault_uploader_t;
+
+/**
+ * @brief Initialize an uploader.
+ *
+ * @param[out] uploader: Uploader.
+ * @param[in] osNetwork: Network operations, its socket is connected to the
+ * proxy for each attempt.
+ * @param[in] proxy: Endpoint of the proxy, kept by reference.
+ * @param[in] source: Source of the chunks, copied.
+ */
+void nce_memfault_init( nce_memfault_uploader_t * uploader,
+                        os_network_ops_t * osNetwork,
+                        const OSEndPoint_t * proxy,
+                        const nce_memfault_source_t * source );
+
+/**
+ * @brief One upload attempt: connect to the proxy, post chunks until the
+ * source is empty or a chunk fails, and disconnect. Nothing is sent when
+ * the source is empty. On failure the source is aborted and
+ * uploader->retry tells whether to try again.
+ *
+ * @param[in] uploader: Uploader.
+ * @param[in] attempt: Number of this attempt, from 1.
+ *
+ * @return NCE_SDK_SUCCESS, or the NCE_SDK_* error of the failed step.
+ */
+int nce_memfault_upload_attempt( nce_memfault_uploader_t * uploader,
+                                 unsigned int attempt );
+
+/**
+ * @brief Upload the chunks of the source in up to NCE_SDK_MEMFAULT_ATTEMPTS
+ * attempts. A 4.xx response from the proxy ends the attempts, a 5.03 delays
+ * the next one by its Max-Age, other failures by at least
+ * NCE_SDK_MEMFAULT_ATTEMPT_DELAY_MS.
+ *
+ * @param[in] uploader: Uploader.
+ *
+ * @return NCE_SDK_SUCCESS, or the error of the last attempt.
+ */
+int nce_memfault_upload( nce_memfault_uploader_t * uploader );
+
+    #ifdef NCE_SDK_DEADLINE
+
+/**
+ * @brief nce_memfault_upload() ending within a time budget. A connect and
+ * each chunk only start while NCE_SDK_DEADLINE_MIN_MS of the budget are
+ * left, the receive timeouts share what is left between the attempts still
+ * allowed, and a retry wait that would end past the budget stops the upload
+ * instead. Stopping between two chunks does not abort the source: the next
+ * upload carries on with the following chunk.
+ *
+ * @param[in] uploader: Uploader.
+ * @param[in] budgetMs: Time the upload may take.
+ * @param[out] progress: How far the upload got, NULL if not needed.
+ *
+ * @return NCE_SDK_SUCCESS once the source is empty, NCE_SDK_DEADLINE_EXCEEDED
+ * when the budget ran out first, or the error of the last attempt.
+ */
+int nce_memfault_upload_deadline( nce_memfault_uploader_t * uploader,
+                                  uint32_t budgetMs,
+                                  nce_progress_t * progress );
+    #endif /* ifdef NCE_SDK_DEADLINE */
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_MEMFAULT_H_ */
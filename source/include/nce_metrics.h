@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_metrics.h
+ * @brief Counters and latency histograms of the SDK operations.
+ *
+ * Metrics are compiled in by defining NCE_SDK_METRICS (CONFIG_NCE_SDK_METRICS
+ * on Zephyr). Without it the recording macros expand to nothing, so the SDK
+ * carries no code, data or clock reads for them.
+ */
+
+#ifndef NCE_METRICS_H_
+    #define NCE_METRICS_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+    #include "nce_status.h"
+
+/**
+ * @brief Number of failure counters: index -status for the SDK return codes
+ * (nce_status.h), index 0 for any other negative status.
+ */
+    #define NCE_METRICS_ERROR_CODES    NCE_SDK_STATUS_CODES
+
+/**
+ * @brief Number of latency buckets.
+ */
+    #define NCE_METRICS_BUCKETS        16
+
+/**
+ * @brief Upper bound (exclusive) of the first latency bucket in microseconds.
+ * Every following bucket doubles it, the last one also counts all longer
+ * operations.
+ */
+    #define NCE_METRICS_FIRST_BUCKET_US    1024u
+
+/**
+ * @brief Upper bound (exclusive) of a latency bucket in microseconds.
+ */
+    #define NCE_METRICS_BUCKET_LIMIT_US( bucket )    ( NCE_METRICS_FIRST_BUCKET_US << ( bucket ) )
+
+/**
+ * @brief Operations measured by the SDK.
+ */
+typedef enum nce_metric_op
+{
+    NCE_METRIC_ONBOARD = 0,      /**< Device Authenticator onboarding (os_auth). */
+    NCE_METRIC_MEMFAULT_UPLOAD,  /**< One attempt to upload the Memfault chunks. */
+    NCE_METRIC_NET_CONNECT,      /**< nce_os_udp_connect. */
+    NCE_METRIC_NET_SEND,         /**< nce_os_udp_send. */
+    NCE_METRIC_NET_RECV,         /**< nce_os_udp_recv, timeouts count as failures. */
+    NCE_METRIC_NET_DISCONNECT,   /**< nce_os_udp_disconnect. */
+    NCE_METRIC_OP_COUNT          /**< Number of operations. */
+} nce_metric_op_t;
+
+/**
+ * @brief Counters of one operation.
+ */
+typedef struct nce_metric
+{
+    uint32_t attempts;                             /**< Started operations. */
+    uint32_t successes;                            /**< Operations ending with a non-negative status. */
+    uint32_t failures[ NCE_METRICS_ERROR_CODES ];  /**< Failed operations by error code. */
+    uint32_t bytesSent;                            /**< Bytes sent by the operation. */
+    uint32_t bytesReceived;                        /**< Bytes received by the operation. */
+    uint32_t latency[ NCE_METRICS_BUCKETS ];       /**< Completed operations by duration. */
+    uint32_t maxLatencyUs;                         /**< Longest completed operation. */
+    uint32_t startUs;                              /**< Start time of the running operation. */
+} nce_metric_t;
+
+/**
+ * @brief Metrics of all operations, fixed size.
+ *
+ * Updates are not locked: an instance must only be updated by one thread at
+ * a time. Give each context used concurrently its own instance.
+ */
+typedef struct nce_metrics
+{
+    nce_metric_t op[ NCE_METRIC_OP_COUNT ]; /**< Counters by operation. */
+} nce_metrics_t;
+
+/**
+ * @brief Mark the start of an operation.
+ *
+ * @param[in] metrics: Metrics instance, NULL for the shared default one.
+ * @param[in] op: Operation started.
+ */
+void nce_metrics_begin( nce_metrics_t * metrics,
+                        nce_metric_op_t op );
+
+/**
+ * @brief Add traffic to an operation.
+ *
+ * @param[in] metrics: Metrics instance, NULL for the shared default one.
+ * @param[in] op: Operation the traffic belongs to.
+ * @param[in] sent: Bytes sent.
+ * @param[in] received: Bytes received.
+ */
+void nce_metrics_bytes( nce_metrics_t * metrics,
+                        nce_metric_op_t op,
+                        size_t sent,
+                        size_t received );
+
+/**
+ * @brief Mark the end of an operation started with nce_metrics_begin().
+ *
+ * @param[in] metrics: Metrics instance, NULL for the shared default one.
+ * @param[in] op: Operation finished.
+ * @param[in] status: Result of the operation, negative on failure.
+ */
+void nce_metrics_end( nce_metrics_t * metrics,
+                      nce_metric_op_t op,
+                      int status );
+
+/**
+ * @brief Copy the metrics, optionally resetting them, e.g. to forward them
+ * as Memfault heartbeat metrics.
+ *
+ * @param[in] metrics: Metrics instance, NULL for the shared default one.
+ * @param[out] snapshot: Copy of the metrics.
+ * @param[in] reset: Non-zero to clear the counters after the copy.
+ */
+void nce_metrics_snapshot( nce_metrics_t * metrics,
+                           nce_metrics_t * snapshot,
+                           int reset );
+
+/**
+ * @brief Clear all counters.
+ *
+ * @param[in] metrics: Metrics instance, NULL for the shared default one.
+ */
+void nce_metrics_reset( nce_metrics_t * metrics );
+
+    #ifdef NCE_SDK_METRICS
+
+/**
+ * @brief Record the start of an operation, nothing without NCE_SDK_METRICS.
+ */
+        #define NCE_METRICS_BEGIN( metrics, op )                    nce_metrics_begin( ( metrics ), ( op ) )
+
+/**
+ * @brief Record traffic of an operation, nothing without NCE_SDK_METRICS.
+ */
+        #define NCE_METRICS_BYTES( metrics, op, sent, received )    nce_metrics_bytes( ( metrics ), ( op ), ( sent ), ( received ) )
+
+/**
+ * @brief Record the end of an operation, nothing without NCE_SDK_METRICS.
+ */
+        #define NCE_METRICS_END( metrics, op, status )              nce_metrics_end( ( metrics ), ( op ), ( status ) )
+    #else
+        #define NCE_METRICS_BEGIN( metrics, op )
+        #define NCE_METRICS_BYTES( metrics, op, sent, received )
+        #define NCE_METRICS_END( metrics, op, status )
+    #endif /* ifdef NCE_SDK_METRICS */
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_METRICS_H_ */
@@ -0,0 +1,269 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_oscore.h
+ * @brief OSCORE (RFC 8613) protection of CoAP requests, an alternative to DTLS
+ * without handshake.
+ *
+ * A DTLS session costs a handshake of several round trips before the first
+ * uplink, and again whenever the session is lost, while OSCORE protects each
+ * CoAP message on its own: an uplink is a single datagram, only a few bytes
+ * longer than the plain CoAP message. Keys are derived from a Master Secret
+ * shared with the server, here the PSK and identity obtained by onboarding.
+ *
+ * The client side is implemented with the mandatory algorithms: AES-CCM-16-64-128
+ * and HKDF-SHA-256, provided by the port (crypto_interface.h). Requests are
+ * protected into a POST carrying the OSCORE option, the Uri-Host, Uri-Port
+ * and Proxy-Scheme options stay outside, every other option is encrypted.
+ * Proxy-Uri and Observe are not supported.
+ *
+ * The Sender Sequence Number must never repeat for a key. It is persisted by
+ * the application in steps of NCE_SDK_OSCORE_SEQUENCE_WINDOW: before the
+ * first number of a step is used, the end of the step is handed to a callback
+ * to store, and after a reset the context is initialized from the stored
+ * value. At most one step of numbers is skipped by a reset, and flash is
+ * written once per step instead of once per message.
+ */
+
+#ifndef NCE_OSCORE_H_
+    #define NCE_OSCORE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #ifdef ARDUINO
+        #include "interface/crypto_interface.h"
+    #else
+        #include "crypto_interface.h"
+    #endif /* ifdef ARDUINO */
+    #include "nce_iot_c_sdk.h"
+
+/**
+ * @brief Longest Sender and Recipient ID, set by the 13-byte nonce.
+ */
+    #define NCE_OSCORE_ID_MAX_LENGTH    7u
+
+/**
+ * @brief Longest ID Context kept by a context.
+ */
+    #ifndef NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH
+        #define NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH    32
+    #endif
+
+/**
+ * @brief Sender Sequence Numbers reserved by one write of the persist
+ * callback, also the most numbers a reset skips.
+ */
+    #ifndef NCE_SDK_OSCORE_SEQUENCE_WINDOW
+        #define NCE_SDK_OSCORE_SEQUENCE_WINDOW          64u
+    #endif
+
+/**
+ * @brief Most options of a protected or unprotected message.
+ */
+    #ifndef NCE_SDK_OSCORE_MAX_OPTIONS
+        #define NCE_SDK_OSCORE_MAX_OPTIONS              16
+    #endif
+
+/**
+ * @brief Bytes a protected request adds to the plain CoAP message, at most:
+ * the tag, the OSCORE option with a 4-byte Partial IV, the kid context and
+ * the kid, the payload marker, the code moved inside, and 6 bytes of longer
+ * option deltas once the options are split.
+ */
+    #define NCE_OSCORE_OVERHEAD_MAX                                         \
+    ( NCE_CRYPTO_CCM_TAG_LENGTH + 3u + 1u + 4u + 1u +                       \
+      NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH + NCE_OSCORE_ID_MAX_LENGTH + 1u + \
+      1u + 6u )
+
+/**
+ * @brief Return codes of the OSCORE functions, lengths are returned as
+ * positive values.
+ */
+enum
+{
+    NCE_OSCORE_SUCCESS = 0,            /**< The operation was successful. */
+    NCE_OSCORE_ARGUMENT_ERROR = -1,    /**< Missing argument, or ID or ID Context too long. */
+    NCE_OSCORE_BUFFER_ERROR = -2,      /**< The output buffer is too small. */
+    NCE_OSCORE_FORMAT_ERROR = -3,      /**< The message is not valid CoAP or OSCORE. */
+    NCE_OSCORE_UNSUPPORTED_ERROR = -4, /**< Proxy-Uri, Observe or too many options. */
+    NCE_OSCORE_CRYPTO_ERROR = -5,      /**< The crypto port failed. */
+    NCE_OSCORE_SEQUENCE_ERROR = -6,    /**< Sequence Numbers exhausted, or the persist callback failed. */
+    NCE_OSCORE_VERIFY_ERROR = -7       /**< The response does not verify. */
+};
+
+/**
+ * @brief Store the next Sender Sequence Number to start from after a reset.
+ *
+ * @param[in] arg: Argument given at initialization.
+ * @param[in] next: Value to pass to the next initialization.
+ *
+ * @return 0 once stored, nonzero on failure: the message is then not sent.
+ */
+typedef int ( * nce_oscore_persist_t )( void * arg,
+                                        uint32_t next );
+
+/**
+ * @brief Input of the key derivation (RFC 8613 section 3.2).
+ */
+typedef struct nce_oscore_params
+{
+    const uint8_t * masterSecret; /**< Master Secret. */
+    size_t masterSecretLength;    /**< Length of the Master Secret. */
+    const uint8_t * masterSalt;   /**< Master Salt, NULL for the default empty one. */
+    size_t masterSaltLength;      /**< Length of the Master Salt. */
+    const uint8_t * idContext;    /**< ID Context, NULL for none. It is sent in every request. */
+    size_t idContextLength;       /**< Length of the ID Context. */
+    const uint8_t * senderId;     /**< Sender ID of the device. */
+    size_t senderIdLength;        /**< Length of the Sender ID, may be 0. */
+    const uint8_t * recipientId;  /**< Recipient ID, the Sender ID of the server. */
+    size_t recipientIdLength;     /**< Length of the Recipient ID, may be 0. */
+} nce_oscore_params_t;
+
+/**
+ * @brief Security context of the device. Not locked: protect requests from one
+ * thread.
+ */
+typedef struct nce_oscore_context
+{
+    uint8_t senderKey[ NCE_CRYPTO_CCM_KEY_LENGTH ];             /**< Key of the requests. */
+    uint8_t recipientKey[ NCE_CRYPTO_CCM_KEY_LENGTH ];          /**< Key of the responses. */
+    uint8_t commonIv[ NCE_CRYPTO_CCM_NONCE_LENGTH ];            /**< Common IV. */
+    uint8_t senderId[ NCE_OSCORE_ID_MAX_LENGTH ];               /**< Sender ID, the kid of the requests. */
+    uint8_t senderIdLength;                                     /**< Length of the Sender ID. */
+    uint8_t recipientId[ NCE_OSCORE_ID_MAX_LENGTH ];            /**< Recipient ID. */
+    uint8_t recipientIdLength;                                  /**< Length of the Recipient ID. */
+    uint8_t idContext[ NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH ];  /**< ID Context, the kid context of the requests. */
+    uint8_t idContextLength;                                    /**< Length of the ID Context. */
+    uint8_t hasIdContext;                                       /**< Nonzero if an ID Context is used. */
+    uint32_t sequence;                                          /**< Next Sender Sequence Number. */
+    uint32_t sequenceLimit;                                     /**< First number not yet persisted. */
+    nce_oscore_persist_t persist;                               /**< Persist callback, NULL to not persist. */
+    void * persistArg;                                          /**< Argument of the persist callback. */
+} nce_oscore_context_t;
+
+/**
+ * @brief What a request leaves to verify its response.
+ */
+typedef struct nce_oscore_request
+{
+    uint8_t piv[ 5 ];  /**< Partial IV of the request. */
+    uint8_t pivLength; /**< Length of the Partial IV. */
+} nce_oscore_request_t;
+
+/**
+ * @brief Derive a security context.
+ *
+ * @param[out] ctx: Context.
+ * @param[in] params: Master Secret, Master Salt, IDs and ID Context.
+ * @param[in] sequence: Value last given to the persist callback, 0 for a new
+ * Master Secret.
+ * @param[in] persist: Persist callback, NULL when the context lives in memory
+ * only (then it must be derived again from a new Master Secret after a reset).
+ * @param[in] persistArg: Argument of the persist callback.
+ *
+ * @return NCE_OSCORE_SUCCESS, NCE_OSCORE_ARGUMENT_ERROR or NCE_OSCORE_CRYPTO_ERROR.
+ */
+int nce_oscore_init( nce_oscore_context_t * ctx,
+                     const nce_oscore_params_t * params,
+                     uint32_t sequence,
+                     nce_oscore_persist_t persist,
+                     void * persistArg );
+
+    #ifdef NCE_DEVICE_AUTHENTICATOR
+
+/**
+ * @brief Derive the security context of a device from its onboarding
+ * credentials: the PSK is the Master Secret, the PSK identity the ID Context,
+ * the Sender ID is empty and the Recipient ID is 0x01.
+ *
+ * @param[out] ctx: Context.
+ * @param[in] nceKey: Credentials returned by os_auth_v2().
+ * @param[in] sequence: Value last given to the persist callback, 0 after new
+ * credentials.
+ * @param[in] persist: Persist callback, NULL to not persist.
+ * @param[in] persistArg: Argument of the persist callback.
+ *
+ * @return As nce_oscore_init().
+ */
+int nce_oscore_init_from_key( nce_oscore_context_t * ctx,
+                              const nce_dtls_key_t * nceKey,
+                              uint32_t sequence,
+                              nce_oscore_persist_t persist,
+                              void * persistArg );
+    #endif /* ifdef NCE_DEVICE_AUTHENTICATOR */
+
+/**
+ * @brief Protect a CoAP request.
+ *
+ * @param[in] ctx: Context, its Sender Sequence Number is consumed.
+ * @param[in] message: CoAP request.
+ * @param[in] length: Length of the request.
+ * @param[out] protectedMessage: Protected request, may not overlap message.
+ * @param[in] size: Size of protectedMessage, length + NCE_OSCORE_OVERHEAD_MAX
+ * is always enough.
+ * @param[out] request: Data to verify the response with.
+ *
+ * @return Length of the protected request, or a negative NCE_OSCORE_* code.
+ */
+int nce_oscore_protect_request( nce_oscore_context_t * ctx,
+                                const uint8_t * message,
+                                size_t length,
+                                uint8_t * protectedMessage,
+                                size_t size,
+                                nce_oscore_request_t * request );
+
+/**
+ * @brief Verify and decrypt the response to a protected request.
+ *
+ * The result has the header, token and inner options of the response; the
+ * outer options other than OSCORE, only meant for proxies, are dropped.
+ *
+ * @param[in] ctx: Context the request was protected with.
+ * @param[in] request: Data left by nce_oscore_protect_request().
+ * @param[in] protectedMessage: Protected response.
+ * @param[in] length: Length of the protected response.
+ * @param[out] message: CoAP response, may not overlap protectedMessage.
+ * @param[in] size: Size of message, length is always enough.
+ *
+ * @return Length of the response, or a negative NCE_OSCORE_* code.
+ */
+int nce_oscore_unprotect_response( const nce_oscore_context_t * ctx,
+                                   const nce_oscore_request_t * request,
+                                   const uint8_t * protectedMessage,
+                                   size_t length,
+                                   uint8_t * message,
+                                   size_t size );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_OSCORE_H_ */
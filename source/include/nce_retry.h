@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_retry.h
+ * @brief Retry decision from a CoAP response code.
+ *
+ * Only some failures are worth another attempt. A 4.xx response means the
+ * request itself is wrong, and sending it again only spends airtime. A 5.03
+ * from an overloaded proxy says how long to stay away in its Max-Age option.
+ * 5.00, 5.02 and 5.04 responses and timeouts may be transient, so they are
+ * retried with an exponential backoff. The classifier turns a raw response
+ * into one of these decisions and a typed NCE_SDK_* error for the caller.
+ */
+
+#ifndef NCE_RETRY_H_
+    #define NCE_RETRY_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+/**
+ * @brief Wait before the second attempt after a timeout or a transient 5.xx,
+ * doubled for each further attempt.
+ */
+    #ifndef NCE_SDK_RETRY_BASE_MS
+        #define NCE_SDK_RETRY_BASE_MS          1000u
+    #endif
+
+/**
+ * @brief Longest backoff wait.
+ */
+    #ifndef NCE_SDK_RETRY_MAX_MS
+        #define NCE_SDK_RETRY_MAX_MS           60000u
+    #endif
+
+/**
+ * @brief Longest Max-Age of a 5.03 waited for before retrying. Longer waits
+ * end the operation with NCE_SDK_SERVICE_UNAVAILABLE, the caller should try
+ * again after nce_retry_decision_t::waitMs.
+ */
+    #ifndef NCE_SDK_RETRY_MAX_AGE_LIMIT_S
+        #define NCE_SDK_RETRY_MAX_AGE_LIMIT_S  120u
+    #endif
+
+/**
+ * @brief Max-Age of a 5.03 without the option (RFC 7252, 5.10.5).
+ */
+    #define NCE_COAP_DEFAULT_MAX_AGE_S         60u
+
+/**
+ * @brief What to do after a response.
+ */
+typedef enum nce_retry_action
+{
+    NCE_RETRY_DONE = 0, /**< Not an error response, go on with the payload. */
+    NCE_RETRY_WAIT,     /**< Retry after waitMs. */
+    NCE_RETRY_FAIL      /**< Do not retry, report status. */
+} nce_retry_action_t;
+
+/**
+ * @brief Outcome of nce_retry_classify().
+ */
+typedef struct nce_retry_decision
+{
+    nce_retry_action_t action; /**< What to do. */
+    int status;                /**< NCE_SDK_SUCCESS or the NCE_SDK_* error of the response. */
+    uint32_t waitMs;           /**< Wait before the next attempt, also set when a 5.03 asks for more than the limit. */
+    uint8_t code;              /**< CoAP code (class << 5 | detail), 0 for a timeout or a non-CoAP response. */
+} nce_retry_decision_t;
+
+/**
+ * @brief Classify the response to an attempt.
+ *
+ * Responses that are not CoAP 4.xx or 5.xx messages, e.g. the 2.05 of the
+ * Device Authenticator, give NCE_RETRY_DONE: their payload decides.
+ *
+ * @param[in] response: Datagram received.
+ * @param[in] length: Its length, 0 or negative for a timeout or a receive
+ * error.
+ * @param[in] attempt: Number of the attempt that got this response, from 1.
+ * @param[out] decision: Decision.
+ *
+ * @return decision->status.
+ */
+int nce_retry_classify( const void * response,
+                        int length,
+                        unsigned int attempt,
+                        nce_retry_decision_t * decision );
+
+/**
+ * @brief Backoff wait after a failed attempt.
+ *
+ * @param[in] attempt: Number of the failed attempt, from 1.
+ *
+ * @return NCE_SDK_RETRY_BASE_MS * 2^(attempt - 1), at most
+ * NCE_SDK_RETRY_MAX_MS.
+ */
+uint32_t nce_retry_backoff_ms( unsigned int attempt );
+
+/**
+ * @brief Max-Age option of a CoAP message.
+ *
+ * @param[in] message: CoAP message.
+ * @param[in] length: Length of the message.
+ * @param[out] maxAgeS: Max-Age in seconds, NCE_COAP_DEFAULT_MAX_AGE_S when
+ * the option is absent.
+ *
+ * @return 0, or -1 if the options are malformed.
+ */
+int nce_coap_max_age( const uint8_t * message,
+                      size_t length,
+                      uint32_t * maxAgeS );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_RETRY_H_ */
@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+/**
+ * @file nce_rto.h
+ * @brief Per-endpoint retransmission timeout estimated from round trips.
+ *
+ * A fixed receive timeout is either too long on a good LTE-M link, where a
+ * lost datagram then costs seconds of idle waiting, or too short on an
+ * NB-IoT link in coverage enhancement, where responses take several seconds
+ * and arrive after the request was already sent again. The estimator follows
+ * CoCoA (draft-ietf-core-cocoa): it keeps, for each endpoint, a strong
+ * estimate from exchanges answered on their first transmission and a weak
+ * estimate from exchanges answered after retransmissions, both with the
+ * smoothed round trip and its variation of RFC 6298, and blends them into
+ * the timeout used for the next exchange. Retransmissions back off by a
+ * factor depending on that timeout, and a timeout not updated for a while
+ * drifts back towards the initial one.
+ *
+ * The cache is plain data without pointers: an application may keep it in
+ * memory retained across sleep, or store and restore it, so a device does not
+ * learn its link again after every wake-up.
+ */
+
+#ifndef NCE_RTO_H_
+    #define NCE_RTO_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdint.h>
+
+    #ifdef ARDUINO
+        #include "interface/udp_interface.h"
+    #else
+        #include "udp_interface.h"
+    #endif /* ifdef ARDUINO */
+    #include "nce_endpoint_cache.h"
+
+/**
+ * @brief Endpoints remembered, the least recently used one is replaced.
+ */
+    #ifndef NCE_SDK_RTO_ENDPOINTS
+        #define NCE_SDK_RTO_ENDPOINTS       4
+    #endif
+
+/**
+ * @brief Timeout of an endpoint without round trip samples (CoAP ACK_TIMEOUT).
+ */
+    #ifndef NCE_SDK_RTO_INITIAL_MS
+        #define NCE_SDK_RTO_INITIAL_MS      2000u
+    #endif
+
+/**
+ * @brief Smallest timeout, covering the scheduling jitter of the device.
+ */
+    #ifndef NCE_SDK_RTO_MIN_MS
+        #define NCE_SDK_RTO_MIN_MS          200u
+    #endif
+
+/**
+ * @brief Largest timeout, also the cap of the backed off ones.
+ */
+    #ifndef NCE_SDK_RTO_MAX_MS
+        #define NCE_SDK_RTO_MAX_MS          60000u
+    #endif
+
+/**
+ * @brief Most transmissions of an exchange still giving a weak sample. Later
+ * responses cannot be told apart from responses to earlier copies.
+ */
+    #ifndef NCE_SDK_RTO_WEAK_LIMIT
+        #define NCE_SDK_RTO_WEAK_LIMIT      3u
+    #endif
+
+/**
+ * @brief Estimate of one kind (strong or weak) of round trip samples.
+ */
+typedef struct nce_rto_estimate
+{
+    uint32_t srttUs;    /**< Smoothed round trip. */
+    uint32_t rttvarUs;  /**< Smoothed round trip variation. */
+    uint8_t valid;      /**< Nonzero once a sample was taken. */
+} nce_rto_estimate_t;
+
+/**
+ * @brief State of one endpoint.
+ */
+typedef struct nce_rto_path
+{
+    nce_endpoint_entry_t entry; /**< Key and last use, first for nce_endpoint_cache_get(). */
+    uint32_t rtoUs;             /**< Overall timeout blended from both estimates. */
+    uint32_t updatedUs;         /**< Clock of the last sample or aging step. */
+    nce_rto_estimate_t strong;  /**< Exchanges answered on their first transmission. */
+    nce_rto_estimate_t weak;    /**< Exchanges answered after retransmissions. */
+    uint16_t samples;           /**< Samples taken, saturating. */
+} nce_rto_path_t;
+
+/**
+ * @brief Timeouts of the endpoints a device talks to. Not locked: use it from
+ * the thread running the exchanges. All zero is an empty cache.
+ */
+typedef struct nce_rto
+{
+    nce_rto_path_t paths[ NCE_SDK_RTO_ENDPOINTS ]; /**< Endpoints. */
+    uint32_t uses;                                 /**< Use counter. */
+} nce_rto_t;
+
+/**
+ * @brief Initialize an empty cache.
+ *
+ * @param[out] cache: Cache.
+ */
+void nce_rto_init( nce_rto_t * cache );
+
+/**
+ * @brief Receive timeout of one transmission of an exchange.
+ *
+ * The first transmission waits the overall timeout of the endpoint, each
+ * further one backs off by 3 if that timeout is below 1 s, by 1.5 if it is
+ * above 3 s and by 2 otherwise. A timeout below 1 s not updated for 16 times
+ * its value is doubled, one above 3 s not updated for 4 times its value moves
+ * halfway to the initial timeout. Idle time is measured on the 32-bit
+ * microsecond clock, which wraps every 71 minutes: an endpoint idle for 35
+ * minutes or more is reset to the initial timeout, and one idle for a whole
+ * number of wraps plus less than 35 minutes is aged by the remainder only.
+ *
+ * @param[in] cache: Cache.
+ * @param[in] endpoint: Endpoint, an unknown one starts at the initial timeout.
+ * @param[in] transmission: Transmission of the exchange, 1 for the first one.
+ * @param[in] nowUs: Current NceOSClockUs().
+ *
+ * @return Milliseconds between NCE_SDK_RTO_MIN_MS and NCE_SDK_RTO_MAX_MS.
+ */
+uint32_t nce_rto_timeout_ms( nce_rto_t * cache,
+                             const OSEndPoint_t * endpoint,
+                             unsigned int transmission,
+                             uint32_t nowUs );
+
+/**
+ * @brief Report the round trip of an answered exchange.
+ *
+ * An exchange answered on its first transmission gives a strong sample,
+ * one answered after up to NCE_SDK_RTO_WEAK_LIMIT transmissions a weak
+ * sample measured from the first transmission, later ones are ignored.
+ *
+ * @param[in] cache: Cache.
+ * @param[in] endpoint: Endpoint the exchange was sent to.
+ * @param[in] rttUs: Microseconds from the first transmission to the response.
+ * @param[in] transmissions: Transmissions of the exchange.
+ * @param[in] nowUs: Current NceOSClockUs().
+ */
+void nce_rto_report( nce_rto_t * cache,
+                     const OSEndPoint_t * endpoint,
+                     uint32_t rttUs,
+                     unsigned int transmissions,
+                     uint32_t nowUs );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_RTO_H_ */
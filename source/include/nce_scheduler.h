@@ -0,0 +1,222 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_scheduler.h
+ * @brief Radio-wake-aware scheduler coalescing SDK operations.
+ *
+ * Waking the modem is the largest energy cost on LTE-M and NB-IoT. Instead of
+ * calling os_auth(), Energy Saver uplinks or Memfault flushes as soon as the
+ * application has them, queue them here with the latest time they may start.
+ * The scheduler runs all queued operations back to back in one connection
+ * window, opened when the earliest deadline is reached, when an urgent
+ * operation is queued, or for free whenever the radio is already connected.
+ *
+ * Compiled with NCE_SDK_SCHEDULER, it reads the port clock (clock_interface.h).
+ */
+
+#ifndef NCE_SCHEDULER_H_
+    #define NCE_SCHEDULER_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+/**
+ * @brief Most operations queued at once.
+ */
+    #ifndef NCE_SDK_SCHED_JOBS
+        #define NCE_SDK_SCHED_JOBS    8
+    #endif
+
+/**
+ * @brief Returned by nce_sched_time_to_window() when nothing is queued.
+ */
+    #define NCE_SCHED_NO_WINDOW       0xFFFFFFFFu
+
+/**
+ * @brief Return codes of nce_sched_submit().
+ */
+enum
+{
+    NCE_SCHED_SUCCESS = 0, /**< The operation was queued. */
+    NCE_SCHED_FULL = -1    /**< NCE_SDK_SCHED_JOBS operations are already queued. */
+};
+
+/**
+ * @brief Priority of an operation: order inside a window, urgent operations
+ * open one immediately.
+ */
+typedef enum nce_sched_priority
+{
+    NCE_SCHED_PRIORITY_LOW = 0, /**< Telemetry, diagnostics. */
+    NCE_SCHED_PRIORITY_NORMAL,  /**< Regular uplinks. */
+    NCE_SCHED_PRIORITY_HIGH,    /**< Onboarding, run first in a window. */
+    NCE_SCHED_PRIORITY_URGENT   /**< Alarms, no coalescing delay. */
+} nce_sched_priority_t;
+
+/**
+ * @brief Radio state reported by the port.
+ */
+typedef enum nce_radio_state
+{
+    NCE_RADIO_OFFLINE = 0, /**< No network, windows are postponed. */
+    NCE_RADIO_IDLE,        /**< Registered but asleep (PSM, eDRX, RRC idle), a window wakes it. */
+    NCE_RADIO_CONNECTED    /**< Awake, a window costs no extra wake-up. */
+} nce_radio_state_t;
+
+/**
+ * @brief "Radio available" signal of the port, e.g. from the modem's RRC and
+ * registration notifications.
+ */
+typedef struct nce_sched_radio
+{
+    /**
+     * @brief Current radio state.
+     *
+     * @param[in] arg: Argument of the signal.
+     *
+     * @return One of nce_radio_state_t.
+     */
+    int (* state)( void * arg );
+
+    /**
+     * @brief Argument passed to state.
+     */
+    void * arg;
+} nce_sched_radio_t;
+
+/**
+ * @brief A queued SDK operation, returns a negative value on failure.
+ */
+typedef int (* nce_sched_job_fn_t)( void * arg );
+
+/**
+ * @brief One queued operation.
+ */
+typedef struct nce_sched_job
+{
+    nce_sched_job_fn_t run; /**< Operation. */
+    void * arg;             /**< Argument of the operation. */
+    uint32_t deadlineUs;    /**< Latest start, NceOSClockUs() time. */
+    uint32_t seq;           /**< Submission order, breaks ties. */
+    uint8_t priority;       /**< One of nce_sched_priority_t. */
+} nce_sched_job_t;
+
+/**
+ * @brief Counters of a scheduler.
+ */
+typedef struct nce_sched_stats
+{
+    uint32_t submitted;      /**< Operations queued. */
+    uint32_t rejected;       /**< Operations refused, the queue was full. */
+    uint32_t windows;        /**< Connection windows run. */
+    uint32_t wakeups;        /**< Windows opened with the radio asleep. */
+    uint32_t piggybacked;    /**< Windows opened because the radio was already connected. */
+    uint32_t jobsRun;        /**< Operations run. */
+    uint32_t jobsFailed;     /**< Operations returning a negative value. */
+    uint32_t wakeupsAvoided; /**< Operations that ran without a wake-up of their own. */
+    uint32_t deadlineMisses; /**< Operations started after their deadline, e.g. while offline. */
+} nce_sched_stats_t;
+
+/**
+ * @brief Scheduler state, fixed size. Not locked: submit and poll from the
+ * same thread.
+ */
+typedef struct nce_scheduler
+{
+    nce_sched_job_t jobs[ NCE_SDK_SCHED_JOBS ]; /**< Queued operations, unordered. */
+    size_t count;                               /**< Used entries of jobs. */
+    uint32_t nextSeq;                           /**< Sequence of the next submission. */
+    nce_sched_radio_t radio;                    /**< Radio signal. */
+    nce_sched_stats_t stats;                    /**< Counters. */
+} nce_scheduler_t;
+
+/**
+ * @brief Initialize an empty scheduler.
+ *
+ * @param[out] scheduler: Scheduler.
+ * @param[in] radio: Radio signal, copied. NULL for a radio always reported
+ * idle, windows then only open on deadlines.
+ */
+void nce_sched_init( nce_scheduler_t * scheduler,
+                     const nce_sched_radio_t * radio );
+
+/**
+ * @brief Queue an operation.
+ *
+ * @param[in] scheduler: Scheduler.
+ * @param[in] run: Operation, called from nce_sched_poll().
+ * @param[in] arg: Argument of the operation.
+ * @param[in] priority: One of nce_sched_priority_t.
+ * @param[in] maxDelayUs: Longest time the operation may wait for a window.
+ *
+ * @return NCE_SCHED_SUCCESS or NCE_SCHED_FULL.
+ */
+int nce_sched_submit( nce_scheduler_t * scheduler,
+                      nce_sched_job_fn_t run,
+                      void * arg,
+                      nce_sched_priority_t priority,
+                      uint32_t maxDelayUs );
+
+/**
+ * @brief Run a connection window if one is due: every queued operation runs,
+ * highest priority first, then earliest deadline, then in submission order.
+ *
+ * Call it from the thread owning the SDK when woken up after
+ * nce_sched_time_to_window(), and on radio state changes.
+ *
+ * @param[in] scheduler: Scheduler.
+ *
+ * @return Number of operations run.
+ */
+size_t nce_sched_poll( nce_scheduler_t * scheduler );
+
+/**
+ * @brief Time until the next window is due, for the caller to sleep.
+ *
+ * @param[in] scheduler: Scheduler.
+ *
+ * @return Microseconds, 0 if due now, NCE_SCHED_NO_WINDOW if nothing is
+ * queued.
+ */
+uint32_t nce_sched_time_to_window( const nce_scheduler_t * scheduler );
+
+/**
+ * @brief Copy the counters of a scheduler.
+ *
+ * @param[in] scheduler: Scheduler.
+ * @param[out] stats: Copy of the counters.
+ */
+void nce_sched_get_stats( const nce_scheduler_t * scheduler,
+                          nce_sched_stats_t * stats );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_SCHEDULER_H_ */
@@ -0,0 +1,203 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_spsc_queue.h
+ * @brief Wait-free single-producer/single-consumer queue of records.
+ *
+ * Hands records, e.g. Energy Saver packets built with os_energy_save(), from
+ * a sampling context (an ISR or a high priority thread) to the thread running
+ * the SDK. Pushing never blocks or loops: when the queue is full the record is
+ * rejected and counted as an overflow. The consumer drains records in batches
+ * and releases their slots with a single store per batch.
+ *
+ * At most one context may push and one other context may drain a queue.
+ */
+
+#ifndef NCE_SPSC_QUEUE_H_
+    #define NCE_SPSC_QUEUE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+/**
+ * @brief Number of slots of a queue, a power of two.
+ */
+    #ifndef NCE_SDK_SPSC_SLOTS
+        #define NCE_SDK_SPSC_SLOTS          16
+    #endif
+
+/**
+ * @brief Largest record of a queue in bytes.
+ */
+    #ifndef NCE_SDK_SPSC_RECORD_SIZE
+        #define NCE_SDK_SPSC_RECORD_SIZE    64
+    #endif
+
+/**
+ * @brief Bytes the producer and consumer indices are kept apart, so the two
+ * sides do not write to the same cache line. Set to 4 on cores without a
+ * data cache to save RAM.
+ */
+    #ifndef NCE_SDK_CACHE_LINE_SIZE
+        #define NCE_SDK_CACHE_LINE_SIZE     64
+    #endif
+
+/**
+ * @brief Aligns a queue to a cache line where the compiler supports it.
+ */
+    #ifndef NCE_SDK_CACHE_ALIGNED
+        #ifdef __GNUC__
+            #define NCE_SDK_CACHE_ALIGNED    __attribute__( ( aligned( NCE_SDK_CACHE_LINE_SIZE ) ) )
+        #else
+            #define NCE_SDK_CACHE_ALIGNED
+        #endif
+    #endif
+
+    #if ( NCE_SDK_SPSC_SLOTS & ( NCE_SDK_SPSC_SLOTS - 1 ) ) != 0
+        #error "NCE_SDK_SPSC_SLOTS must be a power of two"
+    #endif
+
+/**
+ * @brief Return codes of nce_spsc_queue_push().
+ */
+enum
+{
+    NCE_SPSC_QUEUE_SUCCESS = 0,          /**< The record was queued. */
+    NCE_SPSC_QUEUE_FULL = -1,            /**< No free slot, the record was counted as an overflow. */
+    NCE_SPSC_QUEUE_RECORD_SIZE_ERROR = -2 /**< The record is larger than NCE_SDK_SPSC_RECORD_SIZE. */
+};
+
+/**
+ * @brief One queued record.
+ */
+typedef struct nce_spsc_record
+{
+    uint16_t length;                            /**< Bytes used in data. */
+    uint8_t data[ NCE_SDK_SPSC_RECORD_SIZE ];   /**< Record bytes. */
+} nce_spsc_record_t;
+
+/**
+ * @brief State written by the producer, on its own cache line.
+ */
+typedef union nce_spsc_producer
+{
+    struct
+    {
+        uint32_t head;       /**< Index of the next slot to fill. */
+        uint32_t cachedTail; /**< Last tail seen, refreshed only when the queue looks full. */
+        uint32_t overflows;  /**< Records rejected because the queue was full. */
+    } state;                 /**< Producer indices and counter. */
+    uint8_t line[ NCE_SDK_CACHE_LINE_SIZE ]; /**< Padding to a cache line. */
+} nce_spsc_producer_t;
+
+/**
+ * @brief State written by the consumer, on its own cache line.
+ */
+typedef union nce_spsc_consumer
+{
+    struct
+    {
+        uint32_t tail;       /**< Index of the next slot to drain. */
+        uint32_t cachedHead; /**< Last head seen, refreshed when it covers less than a batch. */
+    } state;                 /**< Consumer indices. */
+    uint8_t line[ NCE_SDK_CACHE_LINE_SIZE ]; /**< Padding to a cache line. */
+} nce_spsc_consumer_t;
+
+/**
+ * @brief Bounded queue, fixed size, zeroed by nce_spsc_queue_init().
+ */
+typedef struct NCE_SDK_CACHE_ALIGNED nce_spsc_queue
+{
+    nce_spsc_producer_t producer;                   /**< Written by the producer only. */
+    nce_spsc_consumer_t consumer;                   /**< Written by the consumer only. */
+    nce_spsc_record_t slots[ NCE_SDK_SPSC_SLOTS ];  /**< Records. */
+} nce_spsc_queue_t;
+
+/**
+ * @brief Called by nce_spsc_queue_drain() for each record, in order.
+ *
+ * @param[in] arg: Argument given to nce_spsc_queue_drain().
+ * @param[in] record: Record bytes, only valid during the call.
+ * @param[in] length: Record length.
+ */
+typedef void (* nce_spsc_handler_t)( void * arg,
+                                     const uint8_t * record,
+                                     size_t length );
+
+/**
+ * @brief Initialize an empty queue, before the producer and consumer start.
+ *
+ * @param[out] queue: Queue to initialize.
+ */
+void nce_spsc_queue_init( nce_spsc_queue_t * queue );
+
+/**
+ * @brief Queue a copy of a record, producer side. Wait-free and lock-free,
+ * safe in an interrupt handler.
+ *
+ * @param[in] queue: Queue.
+ * @param[in] record: Record bytes.
+ * @param[in] length: Record length, at most NCE_SDK_SPSC_RECORD_SIZE.
+ *
+ * @return NCE_SPSC_QUEUE_SUCCESS, NCE_SPSC_QUEUE_FULL or
+ * NCE_SPSC_QUEUE_RECORD_SIZE_ERROR.
+ */
+int nce_spsc_queue_push( nce_spsc_queue_t * queue,
+                         const void * record,
+                         size_t length );
+
+/**
+ * @brief Hand the queued records to a handler, oldest first, consumer side.
+ *
+ * @param[in] queue: Queue.
+ * @param[in] handler: Called for each record.
+ * @param[in] arg: Passed to the handler.
+ * @param[in] maxRecords: Most records to drain, 0 for all queued.
+ *
+ * @return Number of records drained.
+ */
+size_t nce_spsc_queue_drain( nce_spsc_queue_t * queue,
+                             nce_spsc_handler_t handler,
+                             void * arg,
+                             size_t maxRecords );
+
+/**
+ * @brief Number of records rejected because the queue was full.
+ *
+ * @param[in] queue: Queue.
+ *
+ * @return Overflow count, wrapping at 2^32.
+ */
+uint32_t nce_spsc_queue_overflows( const nce_spsc_queue_t * queue );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_SPSC_QUEUE_H_ */
@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+/**
+ * @file nce_status.h
+ * @brief Return codes of the SDK, in a header of their own so that modules
+ * included by nce_iot_c_sdk.h, such as nce_metrics.h, can size tables by
+ * them.
+ */
+
+#ifndef NCE_STATUS_H_
+    #define NCE_STATUS_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+/**
+ * @brief definition of return codes.
+ */
+enum
+{
+    NCE_SDK_SUCCESS = 0,                /**< The operation was successful. */
+    NCE_SDK_CONNECT_ERROR = -1,         /**< Generic Connection error. */
+    NCE_SDK_DTLS_CONNECT_ERROR = -2,    /**< DTLS Connection error. */
+    NCE_SDK_SEND_ERROR = -3,            /**< Packet sending error. */
+    NCE_SDK_RECEIVE_ERROR = -4,         /**< Packet reception error. */
+    NCE_SDK_PARSING_ERROR = -5,         /**< Response parsing error. */
+    NCE_SDK_BINARY_PAYLOAD_ERROR = -6,  /**< Binary payload conversion error. */
+    NCE_SDK_SERVER_RESPONSE_ERROR = -7, /**< Server responded with an error (e.g., CoAP 5.00, 5.04). */
+    NCE_SDK_CLIENT_ERROR = -8,          /**< Server rejected the request (CoAP 4.xx), retrying cannot help. */
+    NCE_SDK_SERVICE_UNAVAILABLE = -9,   /**< Server overloaded (CoAP 5.03), retry after its Max-Age (nce_retry.h). */
+    NCE_SDK_WORKSPACE_ERROR = -10,      /**< Workspace given to a v2 operation missing or too small. */
+    NCE_SDK_DEADLINE_EXCEEDED = -11     /**< Time budget of a deadline-aware operation spent (nce_deadline.h). */
+};
+
+/**
+ * @brief Number of return codes, from NCE_SDK_SUCCESS down to the lowest
+ * error. Keep it on the last code of the enum.
+ */
+    #define NCE_SDK_STATUS_CODES    ( 1 - NCE_SDK_DEADLINE_EXCEEDED )
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_STATUS_H_ */
@@ -0,0 +1,215 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_telemetry.h
+ * @brief Application uplinks to the 1NCE Data Broker or CoAP proxy, each
+ * sent confirmable or non-confirmable.
+ *
+ * A confirmable (CON) message waits for its acknowledgement and is
+ * retransmitted as decided by nce_retry.h, with the receive timeout
+ * estimated by nce_rto.h under NCE_SDK_RTO. A non-confirmable (NON) message
+ * is one datagram sent without waiting for anything: the cheapest uplink
+ * when losing one reading now and then is fine. Both kinds go through the
+ * same sender, which keeps its connection (and the DTLS session of the
+ * port) open between messages and builds every request in its own buffer.
+ *
+ * A message may ask the server not to respond (No-Response option, RFC
+ * 7967), so a non-confirmable uplink costs no downlink datagram either and
+ * the device can sleep right after sending it. In the hybrid mode, every
+ * Nth non-confirmable message is sent confirmable instead, which tells
+ * whether the uplinks still get through.
+ *
+ * All the state lives in nce_telemetry_t, so a gateway can send for many
+ * devices with one sender each.
+ *
+ * Compiled with NCE_SDK_TELEMETRY.
+ */
+
+#ifndef NCE_TELEMETRY_H_
+    #define NCE_TELEMETRY_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include "nce_iot_c_sdk.h"
+    #include "nce_retry.h"
+
+/**
+ * @brief Size of the request buffer: header, options and payload.
+ */
+    #ifndef NCE_SDK_TELEMETRY_BUFFER_SIZE
+        #define NCE_SDK_TELEMETRY_BUFFER_SIZE      256
+    #endif
+
+/**
+ * @brief Size of the buffer receiving the responses, longer ones are cut.
+ */
+    #ifndef NCE_SDK_TELEMETRY_RESPONSE_SIZE
+        #define NCE_SDK_TELEMETRY_RESPONSE_SIZE    64
+    #endif
+
+/**
+ * @brief Transmissions of a confirmable message, the first one included.
+ */
+    #ifndef NCE_SDK_TELEMETRY_ATTEMPTS
+        #define NCE_SDK_TELEMETRY_ATTEMPTS         4
+    #endif
+
+/**
+ * @brief Default ackInterval of a sender: every Nth non-confirmable message
+ * is sent confirmable. 0 never does.
+ */
+    #ifndef NCE_SDK_TELEMETRY_ACK_INTERVAL
+        #define NCE_SDK_TELEMETRY_ACK_INTERVAL     0
+    #endif
+
+/**
+ * @brief CoAP methods of a message.
+ */
+    #define NCE_TELEMETRY_POST    0x02u
+    #define NCE_TELEMETRY_PUT     0x03u
+
+/**
+ * @brief No Content-Format option.
+ */
+    #define NCE_TELEMETRY_NO_FORMAT    ( -1 )
+
+/**
+ * @brief Response classes a message may suppress with the No-Response
+ * option, combined with |.
+ */
+    #define NCE_TELEMETRY_NO_RESPONSE_2XX    0x02u
+    #define NCE_TELEMETRY_NO_RESPONSE_4XX    0x08u
+    #define NCE_TELEMETRY_NO_RESPONSE_5XX    0x10u
+    #define NCE_TELEMETRY_NO_RESPONSE_ALL    0x1Au
+
+/**
+ * @brief One uplink.
+ */
+typedef struct nce_telemetry_message
+{
+    bool confirmable;      /**< Wait for the acknowledgement and retransmit (CON), or send once (NON). */
+    uint8_t method;        /**< NCE_TELEMETRY_POST or NCE_TELEMETRY_PUT, 0 for POST. */
+    const char * path;     /**< Uri-Path, segments separated by '/', NULL for none. */
+    const char * query;    /**< Uri-Query, arguments separated by '&', e.g. "t=sensors", NULL for none. */
+    const char * proxyUri; /**< Proxy-Uri forwarded by the CoAP proxy, NULL for none. */
+    int contentFormat;     /**< Content-Format, NCE_TELEMETRY_NO_FORMAT for none. */
+    const void * payload;  /**< Payload, NULL for none. */
+    size_t payloadLength;  /**< Length of the payload. */
+    uint8_t noResponse;    /**< NCE_TELEMETRY_NO_RESPONSE_* classes the server should not send, 0 for none. */
+} nce_telemetry_message_t;
+
+/**
+ * @brief Traffic of a sender.
+ */
+typedef struct nce_telemetry_stats
+{
+    unsigned long confirmable;     /**< Confirmable messages acknowledged. */
+    unsigned long nonConfirmable;  /**< Non-confirmable messages sent. */
+    unsigned long failed;          /**< Messages not delivered, or rejected by the server. */
+    unsigned long retransmissions; /**< Transmissions after the first of a confirmable message. */
+    unsigned long probes;          /**< Non-confirmable messages sent confirmable by the hybrid mode, also counted above. */
+    unsigned long probesFailed;    /**< Of those, the ones without any response. */
+    unsigned long connects;        /**< Connections opened. */
+    unsigned long datagramsSent;   /**< Datagrams sent. */
+    unsigned long bytesSent;       /**< Bytes sent. */
+} nce_telemetry_stats_t;
+
+/**
+ * @brief State of one sender.
+ */
+typedef struct nce_telemetry
+{
+    os_network_ops_t * osNetwork;      /**< Network operations and socket towards the endpoint. */
+    const OSEndPoint_t * endpoint;     /**< Data Broker or CoAP proxy. */
+    void ( * delayMs )( uint32_t ms ); /**< Waits between transmissions, NceOSDelayMs() where the OS provides one, NULL retries at once. */
+    bool connected;                    /**< The socket is connected to the endpoint. */
+    uint16_t messageId;                /**< Last CoAP message ID. */
+    uint8_t code;                      /**< CoAP code of the last response, 0 if none. */
+    nce_retry_decision_t retry;        /**< Classification of the last failed transmission. */
+    uint16_t ackInterval;              /**< Hybrid mode: every Nth non-confirmable message is sent confirmable, without No-Response, 0 never. */
+    uint16_t unacknowledged;           /**< Non-confirmable messages since the last acknowledgement. */
+    nce_telemetry_stats_t stats;       /**< Traffic counters. */
+    #ifdef NCE_SDK_RTO
+    nce_rto_t * rto;                   /**< Round trip estimates of the endpoint, NULL for none. */
+    int ( * setRecvTimeout )( OSNetwork_t osnetwork,
+                              uint32_t ms ); /**< Applies the estimated timeout to the socket, NULL keeps the port's. */
+    #endif
+    uint8_t request[ NCE_SDK_TELEMETRY_BUFFER_SIZE ];    /**< Encoded request. */
+    uint8_t response[ NCE_SDK_TELEMETRY_RESPONSE_SIZE ]; /**< Response of the endpoint. */
+} nce_telemetry_t;
+
+/**
+ * @brief Initialize a sender, not connected yet.
+ *
+ * @param[out] telemetry: Sender.
+ * @param[in] osNetwork: Network operations, its socket is connected on the
+ * first message.
+ * @param[in] endpoint: Data Broker or CoAP proxy, kept by reference.
+ */
+void nce_telemetry_init( nce_telemetry_t * telemetry,
+                         os_network_ops_t * osNetwork,
+                         const OSEndPoint_t * endpoint );
+
+/**
+ * @brief Send one message, connecting first if needed. A confirmable
+ * message is sent up to NCE_SDK_TELEMETRY_ATTEMPTS times until the server
+ * acknowledges it; a 4.xx response ends the attempts, a 5.03 delays the next
+ * one by its Max-Age. A non-confirmable message is sent once, unless the
+ * hybrid mode sends it confirmable: then it carries no No-Response option,
+ * and failing that way, the next non-confirmable message is sent
+ * confirmable again.
+ *
+ * A confirmable message that got no response at all closes the connection,
+ * the next message opens a new one.
+ *
+ * @param[in] telemetry: Sender.
+ * @param[in] message: Message.
+ *
+ * @return NCE_SDK_SUCCESS once a NON message is sent or a CON message is
+ * acknowledged (telemetry->code holds the response code, 0 for an empty
+ * acknowledgement), NCE_SDK_SEND_ERROR if it does not fit the request
+ * buffer, or the error of the last transmission.
+ */
+int nce_telemetry_send( nce_telemetry_t * telemetry,
+                        const nce_telemetry_message_t * message );
+
+/**
+ * @brief Close the connection of a sender, e.g. before the device sleeps.
+ *
+ * @param[in] telemetry: Sender.
+ */
+void nce_telemetry_close( nce_telemetry_t * telemetry );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_TELEMETRY_H_ */
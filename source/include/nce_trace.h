@@ -0,0 +1,171 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_trace.h
+ * @brief Begin/end spans around the phases of the SDK operations.
+ *
+ * Tracing is compiled in by defining NCE_SDK_TRACE (CONFIG_NCE_SDK_TRACE on
+ * Zephyr). An operation (onboarding, Memfault upload) gets a new ID, and
+ * every span opened on the same thread until the operation ends carries it,
+ * including the spans of the network port. Events are time stamped with
+ * NceOSClockUs() and handed to the sink set with nce_trace_set_sink(), e.g.
+ * the Chrome trace writer of the Linux port. Without the define the macros
+ * expand to nothing.
+ *
+ * The running operation is kept per thread on Linux and on Zephyr with
+ * CONFIG_THREAD_LOCAL_STORAGE, otherwise (or with
+ * NCE_SDK_TRACE_THREAD_LOCAL defined empty) it is shared: operations
+ * running at the same time on several threads then overwrite each other's
+ * ID, and their spans are attributed to the one started last.
+ */
+
+#ifndef NCE_TRACE_H_
+    #define NCE_TRACE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stdint.h>
+
+/**
+ * @brief Span phases, as in the Chrome trace event format.
+ */
+    #define NCE_TRACE_PHASE_BEGIN    'B'
+    #define NCE_TRACE_PHASE_END      'E'
+
+/**
+ * @brief Span names used by the SDK and its ports.
+ */
+    #define NCE_TRACE_ONBOARD           "onboard"
+    #define NCE_TRACE_MEMFAULT_UPLOAD   "memfault_upload"
+    #define NCE_TRACE_MEMFAULT_CHUNK    "memfault_chunk"
+    #define NCE_TRACE_CONNECT           "connect"
+    #define NCE_TRACE_DNS               "dns"
+    #define NCE_TRACE_DTLS_SETUP        "dtls_setup"
+    #define NCE_TRACE_HANDSHAKE         "handshake"
+    #define NCE_TRACE_BUILD             "build"
+    #define NCE_TRACE_SEND              "send"
+    #define NCE_TRACE_WAIT_RESPONSE     "wait_response"
+    #define NCE_TRACE_PARSE             "parse"
+    #define NCE_TRACE_DISCONNECT        "disconnect"
+
+/**
+ * @brief Trace event handed to the sink.
+ */
+typedef struct nce_trace_event
+{
+    const char * name;    /**< Span name, a string literal. */
+    uint32_t opId;        /**< Operation the span belongs to, 0 outside of one. */
+    uint32_t timestampUs; /**< NceOSClockUs() at the event. */
+    int status;           /**< Status of the phase on end events, 0 on begin. */
+    char phase;           /**< NCE_TRACE_PHASE_BEGIN or NCE_TRACE_PHASE_END. */
+} nce_trace_event_t;
+
+/**
+ * @brief Receiver of the trace events, called on the thread of the span.
+ *
+ * @param[in] arg: Argument given to nce_trace_set_sink().
+ * @param[in] event: The event.
+ */
+typedef void (* nce_trace_sink_t)( void * arg,
+                                   const nce_trace_event_t * event );
+
+/**
+ * @brief Set the receiver of the trace events.
+ *
+ * @param[in] sink: Receiver, NULL to stop tracing.
+ * @param[in] arg: Argument passed to the receiver.
+ */
+void nce_trace_set_sink( nce_trace_sink_t sink,
+                         void * arg );
+
+/**
+ * @brief Start an operation on the calling thread and open its span.
+ *
+ * @param[in] name: Operation name.
+ *
+ * @return The ID of the operation.
+ */
+uint32_t nce_trace_op_begin( const char * name );
+
+/**
+ * @brief Close the span of the running operation and end it.
+ *
+ * @param[in] name: Operation name.
+ * @param[in] status: Result of the operation.
+ */
+void nce_trace_op_end( const char * name,
+                       int status );
+
+/**
+ * @brief Open a span in the running operation.
+ *
+ * @param[in] name: Span name.
+ */
+void nce_trace_begin( const char * name );
+
+/**
+ * @brief Close a span of the running operation.
+ *
+ * @param[in] name: Span name.
+ * @param[in] status: Result of the phase.
+ */
+void nce_trace_end( const char * name,
+                    int status );
+
+    #ifdef NCE_SDK_TRACE
+
+/**
+ * @brief Start an operation, nothing without NCE_SDK_TRACE.
+ */
+        #define NCE_TRACE_OP_BEGIN( name )            ( void ) nce_trace_op_begin( name )
+
+/**
+ * @brief End the running operation, nothing without NCE_SDK_TRACE.
+ */
+        #define NCE_TRACE_OP_END( name, status )      nce_trace_op_end( ( name ), ( status ) )
+
+/**
+ * @brief Open a span, nothing without NCE_SDK_TRACE.
+ */
+        #define NCE_TRACE_BEGIN( name )               nce_trace_begin( name )
+
+/**
+ * @brief Close a span, nothing without NCE_SDK_TRACE.
+ */
+        #define NCE_TRACE_END( name, status )         nce_trace_end( ( name ), ( status ) )
+    #else
+        #define NCE_TRACE_OP_BEGIN( name )
+        #define NCE_TRACE_OP_END( name, status )
+        #define NCE_TRACE_BEGIN( name )
+        #define NCE_TRACE_END( name, status )
+    #endif /* ifdef NCE_SDK_TRACE */
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_TRACE_H_ */
@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_uplink_queue.h
+ * @brief Store-and-forward queue of uplink frames in persistent storage.
+ *
+ * Frames pushed while the device is offline are kept in a ring of flash
+ * sectors (storage_interface.h) and survive resets and power loss. When
+ * connectivity returns they are sent in order over a single UDP session.
+ * When the ring is full the oldest sector is erased, dropping its frames.
+ *
+ * A frame is only reported pending once completely written, a write torn by
+ * power loss is skipped on recovery. Delivery is at least once: a frame sent
+ * just before power loss may be sent again after the reset.
+ */
+
+#ifndef NCE_UPLINK_QUEUE_H_
+    #define NCE_UPLINK_QUEUE_H_
+
+    #ifdef __cplusplus
+extern "C" {
+    #endif
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #ifdef ARDUINO
+        #include "interface/storage_interface.h"
+        #include "interface/udp_interface.h"
+    #else
+        #include "storage_interface.h"
+        #include "udp_interface.h"
+    #endif /* ifdef ARDUINO */
+
+/**
+ * @brief Largest frame accepted by the queue, also the size of the buffer
+ * flushing uses on the stack.
+ */
+    #ifndef NCE_SDK_UPLINK_MAX_FRAME
+        #define NCE_SDK_UPLINK_MAX_FRAME    256
+    #endif
+
+/**
+ * @brief Return codes of the queue functions.
+ */
+enum
+{
+    NCE_UPLINK_QUEUE_SUCCESS = 0,           /**< The operation was successful. */
+    NCE_UPLINK_QUEUE_STORAGE_ERROR = -1,    /**< The storage failed or has an unusable geometry. */
+    NCE_UPLINK_QUEUE_FRAME_SIZE_ERROR = -2, /**< The frame is empty or larger than a sector can hold. */
+    NCE_UPLINK_QUEUE_CONNECT_ERROR = -3,    /**< Connecting for the flush failed. */
+    NCE_UPLINK_QUEUE_SEND_ERROR = -4        /**< Sending a frame failed, it stays queued. */
+};
+
+/**
+ * @brief Counters of a queue. Pending counts are rebuilt from storage on
+ * initialization, the other counters start at zero.
+ */
+typedef struct nce_uplink_queue_stats
+{
+    uint32_t enqueued;      /**< Frames pushed. */
+    uint32_t dropped;       /**< Pending frames erased to make room. */
+    uint32_t sent;          /**< Frames sent and marked consumed. */
+    uint32_t sendFailures;  /**< Sends that failed, ending a flush. */
+    uint32_t recovered;     /**< Pending frames found on initialization. */
+    uint32_t torn;          /**< Incomplete or corrupted frames skipped on initialization. */
+    uint32_t erases;        /**< Sectors erased. */
+    uint32_t pendingFrames; /**< Frames waiting to be sent. */
+    uint32_t pendingBytes;  /**< Payload bytes waiting to be sent. */
+} nce_uplink_queue_stats_t;
+
+/**
+ * @brief State of a queue, only valid after nce_uplink_queue_init().
+ *
+ * The sectors in use form a ring from headSector to tailSector with
+ * consecutive sequence numbers. A queue must not be used by two threads at
+ * the same time.
+ */
+typedef struct nce_uplink_queue
+{
+    const os_storage_ops_t * storage; /**< Storage holding the frames. */
+    uint32_t sectors;                 /**< Number of sectors of the storage. */
+    uint32_t usedSectors;             /**< Sectors between head and tail, 0 when none is written yet. */
+    uint32_t headSector;              /**< Oldest sector in use. */
+    uint32_t tailSector;              /**< Sector frames are appended to. */
+    uint32_t tailSeq;                 /**< Sequence number of the tail sector. */
+    size_t tailOffset;                /**< Next free byte of the tail sector. */
+    nce_uplink_queue_stats_t stats;   /**< Counters. */
+} nce_uplink_queue_t;
+
+/**
+ * @brief Initialize a queue on a storage area, recovering the frames it
+ * already holds.
+ *
+ * @param[out] queue: Queue to initialize.
+ * @param[in] storage: Storage with at least two sectors, kept by the queue.
+ *
+ * @return NCE_UPLINK_QUEUE_SUCCESS or NCE_UPLINK_QUEUE_STORAGE_ERROR.
+ */
+int nce_uplink_queue_init( nce_uplink_queue_t * queue,
+                           const os_storage_ops_t * storage );
+
+/**
+ * @brief Append a frame, durably, dropping the oldest sector if the ring is
+ * full.
+ *
+ * @param[in] queue: Queue.
+ * @param[in] frame: Bytes of the frame.
+ * @param[in] length: Length of the frame, at most NCE_SDK_UPLINK_MAX_FRAME.
+ *
+ * @return NCE_UPLINK_QUEUE_SUCCESS, NCE_UPLINK_QUEUE_FRAME_SIZE_ERROR or
+ * NCE_UPLINK_QUEUE_STORAGE_ERROR.
+ */
+int nce_uplink_queue_push( nce_uplink_queue_t * queue,
+                           const void * frame,
+                           size_t length );
+
+/**
+ * @brief Send pending frames, oldest first, over one UDP session.
+ *
+ * Nothing is connected when no frame is pending. Each frame sent is marked
+ * consumed, the flush stops at the first failed send and the frame stays
+ * queued. Sectors holding only consumed frames are erased afterwards.
+ *
+ * @param[in] queue: Queue.
+ * @param[in] osNetwork: UDP interface object.
+ * @param[in] endpoint: Endpoint receiving the frames.
+ * @param[in] maxFrames: Most frames to send, 0 for all.
+ * @param[out] sent: Frames sent, may be NULL.
+ *
+ * @return NCE_UPLINK_QUEUE_SUCCESS, NCE_UPLINK_QUEUE_CONNECT_ERROR,
+ * NCE_UPLINK_QUEUE_SEND_ERROR or NCE_UPLINK_QUEUE_STORAGE_ERROR.
+ */
+int nce_uplink_queue_flush( nce_uplink_queue_t * queue,
+                            os_network_ops_t * osNetwork,
+                            OSEndPoint_t endpoint,
+                            size_t maxFrames,
+                            size_t * sent );
+
+/**
+ * @brief Copy the counters of a queue.
+ *
+ * @param[in] queue: Queue.
+ * @param[out] stats: Copy of the counters.
+ */
+void nce_uplink_queue_get_stats( const nce_uplink_queue_t * queue,
+                                 nce_uplink_queue_stats_t * stats );
+
+    #ifdef __cplusplus
+}
+    #endif
+
+#endif /* ifndef NCE_UPLINK_QUEUE_H_ */
@@ -0,0 +1,59 @@
+#ifndef CLOCK_INTERFACE_H_
+#define CLOCK_INTERFACE_H_
+
+#include <stdint.h>
+
+/**
+ *  @brief Monotonic clock in microseconds for FreeRTOS (tick resolution).
+ */
+#ifdef FREERTOS
+    #include "FreeRTOS.h"
+    #include "task.h"
+
+    #define NceOSClockUs()    ( ( uint32_t ) xTaskGetTickCount() * ( uint32_t ) portTICK_PERIOD_MS * 1000u )
+
+/**
+ *  @brief Sleep of the calling task for FreeRTOS.
+ */
+    #define NceOSDelayMs( ms )    vTaskDelay( pdMS_TO_TICKS( ms ) )
+
+#elif defined( __ZEPHYR__ )
+    #include <zephyr/kernel.h>
+
+/**
+ *  @brief Monotonic clock in microseconds for ZEPHYR OS (tick resolution).
+ */
+    #define NceOSClockUs()    ( ( uint32_t ) k_ticks_to_us_floor64( k_uptime_ticks() ) )
+
+/**
+ *  @brief Sleep of the calling thread for ZEPHYR OS.
+ */
+    #define NceOSDelayMs( ms )    k_msleep( ( int32_t ) ( ms ) )
+
+#elif defined( ARDUINO )
+
+/**
+ *  @brief Monotonic clock in microseconds for Arduino.
+ */
+    #define NceOSClockUs()    ( ( uint32_t ) micros() )
+
+/**
+ *  @brief Blocking delay for Arduino.
+ */
+    #define NceOSDelayMs( ms )    delay( ms )
+
+#else /* ifdef FREERTOS */
+
+/**
+ *  @brief Monotonic clock in microseconds, provided by the port
+ *  (ports/linux/clock_linux.c on Linux).
+ */
+uint32_t nce_os_clock_us( void );
+
+    #define NceOSClockUs()    nce_os_clock_us()
+
+/* Generic platforms have no NceOSDelayMs(): waits between attempts go through
+ * nce_context_t::delayMs, set by the application (see ports/linux/clock_linux.h). */
+
+#endif /* ifdef FREERTOS */
+#endif /* ifndef CLOCK_INTERFACE_H_ */
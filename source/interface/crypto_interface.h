@@ -0,0 +1,90 @@
+#ifndef CRYPTO_INTERFACE_H_
+#define CRYPTO_INTERFACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Key, nonce and tag lengths of AES-CCM-16-64-128 (COSE algorithm 10),
+ * the AEAD algorithm of OSCORE.
+ */
+#define NCE_CRYPTO_CCM_KEY_LENGTH      16u
+#define NCE_CRYPTO_CCM_NONCE_LENGTH    13u
+#define NCE_CRYPTO_CCM_TAG_LENGTH      8u
+
+/**
+ * @brief Crypto primitives used by the OSCORE layer (nce_oscore.h), provided
+ * by the port: mbed TLS on Zephyr (ports/zephyr/crypto_zephyr.c), OpenSSL
+ * libcrypto on Linux (ports/linux/crypto_linux.c). Only needed with
+ * NCE_SDK_OSCORE.
+ */
+
+/**
+ * @brief HKDF with SHA-256 (RFC 5869), extract and expand.
+ *
+ * @param[in] salt Salt, may be empty.
+ * @param[in] saltLength Length of the salt.
+ * @param[in] ikm Input keying material.
+ * @param[in] ikmLength Length of the input keying material.
+ * @param[in] info Context information.
+ * @param[in] infoLength Length of the context information.
+ * @param[out] okm Output keying material.
+ * @param[in] okmLength Bytes to derive, at most 255 * 32.
+ *
+ * @return 0 on success, negative value on error.
+ */
+int nce_os_hkdf_sha256( const uint8_t * salt,
+                        size_t saltLength,
+                        const uint8_t * ikm,
+                        size_t ikmLength,
+                        const uint8_t * info,
+                        size_t infoLength,
+                        uint8_t * okm,
+                        size_t okmLength );
+
+/**
+ * @brief Encrypt and authenticate with AES-CCM-16-64-128.
+ *
+ * @param[in] key Key of NCE_CRYPTO_CCM_KEY_LENGTH bytes.
+ * @param[in] nonce Nonce of NCE_CRYPTO_CCM_NONCE_LENGTH bytes.
+ * @param[in] aad Additional authenticated data.
+ * @param[in] aadLength Length of the additional data.
+ * @param[in] plaintext Bytes to encrypt.
+ * @param[in] length Length of the plaintext.
+ * @param[out] ciphertext Encrypted bytes followed by the tag,
+ * length + NCE_CRYPTO_CCM_TAG_LENGTH bytes. May be the plaintext buffer
+ * (encryption in place), may not overlap it otherwise.
+ *
+ * @return 0 on success, negative value on error.
+ */
+int nce_os_aes_ccm_encrypt( const uint8_t * key,
+                            const uint8_t * nonce,
+                            const uint8_t * aad,
+                            size_t aadLength,
+                            const uint8_t * plaintext,
+                            size_t length,
+                            uint8_t * ciphertext );
+
+/**
+ * @brief Verify and decrypt with AES-CCM-16-64-128.
+ *
+ * @param[in] key Key of NCE_CRYPTO_CCM_KEY_LENGTH bytes.
+ * @param[in] nonce Nonce of NCE_CRYPTO_CCM_NONCE_LENGTH bytes.
+ * @param[in] aad Additional authenticated data.
+ * @param[in] aadLength Length of the additional data.
+ * @param[in] ciphertext Encrypted bytes followed by the tag.
+ * @param[in] length Length of the ciphertext, tag included.
+ * @param[out] plaintext Decrypted bytes, length - NCE_CRYPTO_CCM_TAG_LENGTH
+ * bytes. May be the ciphertext buffer, may not overlap it otherwise.
+ *
+ * @return 0 on success, negative value when the tag does not verify.
+ */
+int nce_os_aes_ccm_decrypt( const uint8_t * key,
+                            const uint8_t * nonce,
+                            const uint8_t * aad,
+                            size_t aadLength,
+                            const uint8_t * ciphertext,
+                            size_t length,
+                            uint8_t * plaintext );
+
+#endif /* ifndef CRYPTO_INTERFACE_H_ */
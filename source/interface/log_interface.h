@@ -1,18 +1,74 @@
 #ifndef LOG_INTERFACE_H_
 #define LOG_INTERFACE_H_
 
+/**
+ *  @brief Log levels, a message is kept when its level is at most the level
+ *  of its module.
+ */
+#define NCE_LOG_LEVEL_NONE     0
+#define NCE_LOG_LEVEL_ERROR    1
+#define NCE_LOG_LEVEL_WARN     2
+#define NCE_LOG_LEVEL_INFO     3
+#define NCE_LOG_LEVEL_DEBUG    4
+
+/**
+ *  @brief Default level of all modules. Zephyr keeps everything here and
+ *  filters with CONFIG_NCE_SDK_LOG_LEVEL.
+ */
+#ifndef NCE_SDK_LOG_LEVEL
+    #if defined( __ZEPHYR__ ) || ( defined( ARDUINO ) && defined( NCE_SDK_LOG_LEVEL_DEBUG ) )
+        #define NCE_SDK_LOG_LEVEL    NCE_LOG_LEVEL_DEBUG
+    #else
+        #define NCE_SDK_LOG_LEVEL    NCE_LOG_LEVEL_INFO
+    #endif
+#endif
+
+/**
+ *  @brief Compile-time level of each module: SDK core, network ports and
+ *  Memfault interface.
+ */
+#ifndef NCE_SDK_LOG_LEVEL_CORE
+    #define NCE_SDK_LOG_LEVEL_CORE        NCE_SDK_LOG_LEVEL
+#endif
+#ifndef NCE_SDK_LOG_LEVEL_PORT
+    #define NCE_SDK_LOG_LEVEL_PORT        NCE_SDK_LOG_LEVEL
+#endif
+#ifndef NCE_SDK_LOG_LEVEL_MEMFAULT
+    #define NCE_SDK_LOG_LEVEL_MEMFAULT    NCE_SDK_LOG_LEVEL
+#endif
+
+/**
+ *  @brief Level of the including file, define it (e.g. to
+ *  NCE_SDK_LOG_LEVEL_PORT) before including this header.
+ */
+#ifndef NCE_LOG_MODULE_LEVEL
+    #define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL
+#endif
+
+/**
+ *  @brief implementation of tokenized logging: format strings stay out of
+ *  the image, records are decoded on the host by tools/logdecode.
+ */
+#ifdef NCE_SDK_LOG_TOKENIZED
+    #include "nce_log_tokenized.h"
+
+    #define NceOSLogBackendInfo( ... )     NCE_LOG_TOKENIZED( NCE_LOG_LEVEL_INFO, __VA_ARGS__ )
+    #define NceOSLogBackendDebug( ... )    NCE_LOG_TOKENIZED( NCE_LOG_LEVEL_DEBUG, __VA_ARGS__ )
+    #define NceOSLogBackendError( ... )    NCE_LOG_TOKENIZED( NCE_LOG_LEVEL_ERROR, __VA_ARGS__ )
+    #define NceOSLogBackendWarn( ... )     NCE_LOG_TOKENIZED( NCE_LOG_LEVEL_WARN, __VA_ARGS__ )
+
 /**
  *  @brief implementation of logging macros for FreeRTOS.
  */
-#ifdef FREERTOS
+#elif defined( FREERTOS )
     #include "FreeRTOSConfig.h"
 void vLoggingPrintf( const char * pcFormat,
                      ... );
 
-    #define NceOSLogInfo( format, ... )     vLoggingPrintf( format, ## __VA_ARGS__ )
-    #define NceOSLogDebug( format, ... )    vLoggingPrintf( format, ## __VA_ARGS__ )
-    #define NceOSLogError( format, ... )    vLoggingPrintf( format, ## __VA_ARGS__ )
-    #define NceOSLogWarn( format, ... )     vLoggingPrintf( format, ## __VA_ARGS__ )
+    #define NceOSLogBackendInfo( ... )     vLoggingPrintf( __VA_ARGS__ )
+    #define NceOSLogBackendDebug( ... )    vLoggingPrintf( __VA_ARGS__ )
+    #define NceOSLogBackendError( ... )    vLoggingPrintf( __VA_ARGS__ )
+    #define NceOSLogBackendWarn( ... )     vLoggingPrintf( __VA_ARGS__ )
 
 #elif defined( __ZEPHYR__ )
     #include <zephyr/logging/log.h>
@@ -20,34 +76,59 @@ void vLoggingPrintf( const char * pcFormat,
 /**
  *  @brief implementation of logging macros for ZEPHYR OS.
  */
-    #define NceOSLogInfo( ... )     LOG_INF( __VA_ARGS__ )
-    #define NceOSLogDebug( ... )    LOG_DBG( __VA_ARGS__ )
-    #define NceOSLogError( ... )    LOG_ERR( __VA_ARGS__ )
-    #define NceOSLogWarn( ... )     LOG_WRN( __VA_ARGS__ )
+    #define NceOSLogBackendInfo( ... )     LOG_INF( __VA_ARGS__ )
+    #define NceOSLogBackendDebug( ... )    LOG_DBG( __VA_ARGS__ )
+    #define NceOSLogBackendError( ... )    LOG_ERR( __VA_ARGS__ )
+    #define NceOSLogBackendWarn( ... )     LOG_WRN( __VA_ARGS__ )
 
 #elif defined( ARDUINO )
 
 /**
  *  @brief implementation of logging macros for Arduino.
  */
-    #define NceOSLogInfo( ... )         printf( __VA_ARGS__ )
-    #define NceOSLogError( ... )        printf( __VA_ARGS__ )
-    #define NceOSLogWarn( ... )         printf( __VA_ARGS__ )
-    #ifdef NCE_SDK_LOG_LEVEL_DEBUG
-        #define NceOSLogDebug( ... )    printf( __VA_ARGS__ )
-    #else
-        #define NceOSLogDebug( format, ... )
-    #endif
+    #define NceOSLogBackendInfo( ... )     printf( __VA_ARGS__ )
+    #define NceOSLogBackendDebug( ... )    printf( __VA_ARGS__ )
+    #define NceOSLogBackendError( ... )    printf( __VA_ARGS__ )
+    #define NceOSLogBackendWarn( ... )     printf( __VA_ARGS__ )
 
-#else /* ifdef FREERTOS */
+#else /* ifdef NCE_SDK_LOG_TOKENIZED */
 
 /**
  *  @brief Define the abbreviated logging macros.
  */
-    #define NceOSLogInfo( format, ... )
-    #define NceOSLogDebug( format, ... )
-    #define NceOSLogError( format, ... )
-    #define NceOSLogWarn( format, ... )
+    #define NceOSLogBackendInfo( ... )
+    #define NceOSLogBackendDebug( ... )
+    #define NceOSLogBackendError( ... )
+    #define NceOSLogBackendWarn( ... )
+
+#endif /* ifdef NCE_SDK_LOG_TOKENIZED */
+
+/**
+ *  @brief Logging macros of the SDK, disabled levels leave no call and no
+ *  string behind.
+ */
+#if NCE_LOG_MODULE_LEVEL >= NCE_LOG_LEVEL_ERROR
+    #define NceOSLogError( ... )    NceOSLogBackendError( __VA_ARGS__ )
+#else
+    #define NceOSLogError( ... )
+#endif
+
+#if NCE_LOG_MODULE_LEVEL >= NCE_LOG_LEVEL_WARN
+    #define NceOSLogWarn( ... )     NceOSLogBackendWarn( __VA_ARGS__ )
+#else
+    #define NceOSLogWarn( ... )
+#endif
+
+#if NCE_LOG_MODULE_LEVEL >= NCE_LOG_LEVEL_INFO
+    #define NceOSLogInfo( ... )     NceOSLogBackendInfo( __VA_ARGS__ )
+#else
+    #define NceOSLogInfo( ... )
+#endif
+
+#if NCE_LOG_MODULE_LEVEL >= NCE_LOG_LEVEL_DEBUG
+    #define NceOSLogDebug( ... )    NceOSLogBackendDebug( __VA_ARGS__ )
+#else
+    #define NceOSLogDebug( ... )
+#endif
 
-#endif /* ifdef FREERTOS */
 #endif /* ifndef LOG_INTERFACE_H_ */
@@ -0,0 +1,93 @@
+#ifndef STORAGE_INTERFACE_H_
+#define STORAGE_INTERFACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @typedef OSStorage_t
+ * @brief The OSStorage is an incomplete type. An implementation of the
+ * storage interface defines struct OSStorage to hold the area it manages,
+ * for example a flash partition or a memory-mapped file.
+ */
+struct OSStorage;
+typedef struct OSStorage * OSStorage_t;
+
+/**
+ * @brief Persistent storage with flash semantics, used by the uplink queue.
+ *
+ * The area is divided in sectors. Erasing a sector sets all of its bytes to
+ * 0xFF, writing can only clear bits. A 32-bit word may be written twice
+ * between erases (to clear more of its bits), as NOR flash allows.
+ */
+struct os_storage_ops
+{
+    /**
+     * @brief Implementation-defined storage area.
+     */
+    OSStorage_t os_storage;
+
+    /**
+     * @brief Size of the area in bytes, a multiple of sectorSize.
+     */
+    size_t size;
+
+    /**
+     * @brief Size of an erasable sector in bytes, a multiple of 4.
+     */
+    size_t sectorSize;
+
+    /**
+     * @brief Read bytes of the area.
+     *
+     * @param[in] osstorage Implementation-defined storage area.
+     * @param[in] offset Offset of the first byte.
+     * @param[out] pBuffer Destination of the bytes.
+     * @param[in] length Number of bytes.
+     *
+     * @return 0 on success, negative value on error.
+     */
+    int (* nce_os_storage_read)( OSStorage_t osstorage,
+                                 size_t offset,
+                                 void * pBuffer,
+                                 size_t length );
+
+    /**
+     * @brief Program bytes of the area, offset and length are multiples of 4.
+     *
+     * @param[in] osstorage Implementation-defined storage area.
+     * @param[in] offset Offset of the first byte.
+     * @param[in] pBuffer Bytes to program.
+     * @param[in] length Number of bytes.
+     *
+     * @return 0 on success, negative value on error.
+     */
+    int (* nce_os_storage_write)( OSStorage_t osstorage,
+                                  size_t offset,
+                                  const void * pBuffer,
+                                  size_t length );
+
+    /**
+     * @brief Erase one sector.
+     *
+     * @param[in] osstorage Implementation-defined storage area.
+     * @param[in] offset Offset of the sector, a multiple of sectorSize.
+     *
+     * @return 0 on success, negative value on error.
+     */
+    int (* nce_os_storage_erase)( OSStorage_t osstorage,
+                                  size_t offset );
+
+    /**
+     * @brief Make the completed writes and erases durable.
+     *
+     * @param[in] osstorage Implementation-defined storage area.
+     *
+     * @return 0 on success, negative value on error.
+     */
+    int (* nce_os_storage_sync)( OSStorage_t osstorage );
+};
+
+typedef struct os_storage_ops os_storage_ops_t;
+
+#endif /* ifndef STORAGE_INTERFACE_H_ */
@@ -105,6 +105,143 @@ struct os_network_ops
 
 typedef struct os_network_ops os_network_ops_t;
 
+/**
+ * @brief os_network_ops_v2: Operations of the v2 API, connecting to an
+ * endpoint passed by const pointer instead of copying it on every call.
+ *
+ * The other operations are shared with os_network_ops, base.nce_os_udp_connect
+ * is not used and may be NULL.
+ */
+struct os_network_ops_v2
+{
+    /**
+     * @brief Socket, send, receive and disconnect operations.
+     */
+    os_network_ops_t base;
+
+    /**
+     * @brief UDP interface for connecting to 1NCE server.
+     *
+     * @param[in] osnetwork Implementation-defined network socket.
+     * @param[in] endpoint General network endpoint, only read during the call.
+     *
+     * @return The status of the connection.
+     */
+    int (* nce_os_udp_connect_v2)( OSNetwork_t osnetwork,
+                                   const OSEndPoint_t * endpoint );
+};
+
+typedef struct os_network_ops_v2 os_network_ops_v2_t;
+
+/**
+ * @typedef OSNetworkBatch_t
+ * @brief The OSNetworkBatch is an incomplete type. An implementation of the
+ * batched interface defines struct OSNetworkBatch to hold its event loop
+ * (for example an epoll instance) and the connections attached to it.
+ */
+struct OSNetworkBatch;
+typedef struct OSNetworkBatch * OSNetworkBatch_t;
+
+/**
+ * @brief One datagram moved by the batched interface.
+ */
+struct os_datagram
+{
+    /**
+     * @brief Connection the datagram is sent on, or was received on.
+     */
+    OSNetwork_t osnetwork;
+
+    /**
+     * @brief Datagram bytes.
+     */
+    void * pBuffer;
+
+    /**
+     * @brief Bytes to send, or capacity of pBuffer when receiving.
+     */
+    size_t length;
+
+    /**
+     * @brief Bytes sent or received, negative value on error.
+     */
+    int result;
+};
+
+typedef struct os_datagram os_datagram_t;
+
+/**
+ * @brief os_network_batch_ops: Optional extension of os_network_ops for hosts
+ * driving many connections, moving several datagrams per system call.
+ *
+ * Connections are opened with the regular os_network_ops and then attached
+ * to the batch object. The SDK core only relies on os_network_ops, so ports
+ * without a batched backend are not affected.
+ */
+struct os_network_batch_ops
+{
+    /**
+     * @brief Implementation-defined event loop.
+     */
+    OSNetworkBatch_t os_batch;
+
+    /**
+     * @brief Add a connected socket to the event loop.
+     *
+     * @param[in] osbatch Implementation-defined event loop.
+     * @param[in] osnetwork Connection to attach.
+     *
+     * @return 0 on success, negative value on error.
+     */
+    int (* nce_os_udp_attach)( OSNetworkBatch_t osbatch,
+                               OSNetwork_t osnetwork );
+
+    /**
+     * @brief Remove a connection from the event loop.
+     *
+     * @param[in] osbatch Implementation-defined event loop.
+     * @param[in] osnetwork Connection to detach.
+     *
+     * @return 0 on success, negative value on error.
+     */
+    int (* nce_os_udp_detach)( OSNetworkBatch_t osbatch,
+                               OSNetwork_t osnetwork );
+
+    /**
+     * @brief Send datagrams on any of the attached connections.
+     *
+     * The result of each datagram is stored in its result member.
+     *
+     * @param[in] osbatch Implementation-defined event loop.
+     * @param[in,out] pDatagrams Datagrams to send.
+     * @param[in] count Number of datagrams.
+     *
+     * @return Number of datagrams sent, negative value on error.
+     */
+    int (* nce_os_udp_send_batch)( OSNetworkBatch_t osbatch,
+                                   os_datagram_t * pDatagrams,
+                                   size_t count );
+
+    /**
+     * @brief Receive datagrams from any of the attached connections.
+     *
+     * Each filled datagram is tagged with the connection it arrived on.
+     *
+     * @param[in] osbatch Implementation-defined event loop.
+     * @param[in,out] pDatagrams Receive buffers.
+     * @param[in] count Number of receive buffers.
+     * @param[in] timeoutMs Maximum time to wait for the first datagram.
+     *
+     * @return Number of datagrams received (0 on timeout), negative value on error.
+     */
+    int (* nce_os_udp_recv_batch)( OSNetworkBatch_t osbatch,
+                                   os_datagram_t * pDatagrams,
+                                   size_t count,
+                                   int timeoutMs );
+};
+
+typedef struct os_network_batch_ops os_network_batch_ops_t;
+
 
 
 #endif /* ifndef UDP_INTERFACE_H_ */
@@ -0,0 +1,332 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_aggregate.c
+ * @brief Implements the edge aggregation in nce_aggregate.h.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "nce_aggregate.h"
+
+#if defined( NCE_SDK_AGGREGATE ) && defined( NCE_ENERGY_SAVER )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drop the samples of a field, keeping its histogram range.
+ */
+static void _clear_field( nce_aggregate_field_t * field )
+{
+    field->sum = 0.0;
+    field->min = 0.0f;
+    field->max = 0.0f;
+    field->last = 0.0f;
+    field->count = 0;
+    memset( field->buckets, 0, sizeof( field->buckets ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Value of the statistic of a slot, before scaling.
+ */
+static double _stat_value( const nce_aggregate_field_t * field,
+                           uint8_t stat )
+{
+    switch( stat )
+    {
+        case NCE_AGGREGATE_MIN:
+            return field->min;
+
+        case NCE_AGGREGATE_MAX:
+            return field->max;
+
+        case NCE_AGGREGATE_MEAN:
+            return ( field->count > 0u ) ? field->sum / field->count : 0.0;
+
+        case NCE_AGGREGATE_COUNT:
+            return field->count;
+
+        case NCE_AGGREGATE_LAST:
+            return field->last;
+
+        default:
+            return field->buckets[ stat - NCE_AGGREGATE_BUCKET ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Convert a statistic to the Energy Saver element of its slot.
+ */
+static int _to_element( const nce_aggregate_slot_t * slot,
+                        double value,
+                        Element2byte_gen_t * element )
+{
+    memset( element, 0, sizeof( *element ) );
+    element->type = slot->type;
+    element->template_length = slot->template_length;
+
+    if( slot->scale != 0.0f )
+    {
+        value *= slot->scale;
+    }
+
+    if( slot->type == E_FLOAT )
+    {
+        element->value.f = ( float ) value;
+
+        return NCE_AGGREGATE_SUCCESS;
+    }
+
+    /* Rounded to the nearest integer, NaN fails both comparisons. */
+    value += ( value < 0.0 ) ? -0.5 : 0.5;
+
+    if( slot->type == E_CHAR )
+    {
+        if( !( ( value > CHAR_MIN - 1.0 ) && ( value < CHAR_MAX + 1.0 ) ) )
+        {
+            return NCE_AGGREGATE_CONVERSION_ERROR;
+        }
+
+        element->value.c = ( char ) value;
+    }
+    else
+    {
+        if( !( ( value > INT_MIN - 1.0 ) && ( value < INT_MAX + 1.0 ) ) )
+        {
+            return NCE_AGGREGATE_CONVERSION_ERROR;
+        }
+
+        element->value.i = ( int ) value;
+    }
+
+    return NCE_AGGREGATE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_aggregate_init( nce_aggregate_t * agg,
+                        size_t fields,
+                        uint8_t selector,
+                        const nce_aggregate_slot_t * slots,
+                        size_t slotCount,
+                        uint32_t windowMs )
+{
+    size_t i;
+
+    if( ( agg == NULL ) || ( fields == 0u ) || ( fields > NCE_SDK_AGGREGATE_FIELDS ) ||
+        ( slots == NULL ) || ( slotCount == 0u ) )
+    {
+        return NCE_AGGREGATE_ARGUMENT_ERROR;
+    }
+
+    for( i = 0; i < slotCount; i++ )
+    {
+        if( ( slots[ i ].field >= fields ) || ( slots[ i ].stat >= NCE_AGGREGATE_BUCKET + NCE_SDK_AGGREGATE_BUCKETS ) ||
+            ( ( slots[ i ].type != E_INTEGER ) && ( slots[ i ].type != E_FLOAT ) && ( slots[ i ].type != E_CHAR ) ) )
+        {
+            return NCE_AGGREGATE_ARGUMENT_ERROR;
+        }
+    }
+
+    memset( agg, 0, sizeof( *agg ) );
+    agg->fieldCount = ( uint8_t ) fields;
+    agg->selector = selector;
+    agg->slots = slots;
+    agg->slotCount = slotCount;
+    agg->windowMs = windowMs;
+
+    return NCE_AGGREGATE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_aggregate_set_histogram( nce_aggregate_t * agg,
+                                 size_t field,
+                                 float low,
+                                 float high )
+{
+    if( ( agg == NULL ) || ( field >= agg->fieldCount ) || !( high > low ) )
+    {
+        return NCE_AGGREGATE_ARGUMENT_ERROR;
+    }
+
+    agg->fields[ field ].low = low;
+    agg->fields[ field ].bucketsPerUnit = ( float ) NCE_SDK_AGGREGATE_BUCKETS / ( high - low );
+
+    return NCE_AGGREGATE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_aggregate_add( nce_aggregate_t * agg,
+                       size_t field,
+                       float value,
+                       uint32_t nowUs )
+{
+    nce_aggregate_field_t * f;
+    uint32_t delta;
+    float position;
+    size_t bucket = 0;
+
+    if( ( agg == NULL ) || ( field >= agg->fieldCount ) )
+    {
+        return NCE_AGGREGATE_ARGUMENT_ERROR;
+    }
+
+    f = &agg->fields[ field ];
+
+    /* Window time is accumulated, the 32-bit clock wraps within an hour. */
+    if( agg->samples == 0u )
+    {
+        agg->elapsedMs = 0;
+        agg->carryUs = 0;
+    }
+    else
+    {
+        delta = nowUs - agg->lastUs;
+        agg->elapsedMs += delta / 1000u;
+        agg->carryUs += delta % 1000u;
+
+        if( agg->carryUs >= 1000u )
+        {
+            agg->elapsedMs++;
+            agg->carryUs -= 1000u;
+        }
+    }
+
+    agg->lastUs = nowUs;
+    agg->samples++;
+
+    if( ( f->count == 0u ) || ( value < f->min ) )
+    {
+        f->min = value;
+    }
+
+    if( ( f->count == 0u ) || ( value > f->max ) )
+    {
+        f->max = value;
+    }
+
+    f->last = value;
+    f->sum += value;
+    f->count++;
+
+    /* Values beyond the range count in the outer buckets. */
+    position = ( value - f->low ) * f->bucketsPerUnit;
+
+    if( position >= NCE_SDK_AGGREGATE_BUCKETS )
+    {
+        bucket = NCE_SDK_AGGREGATE_BUCKETS - 1;
+    }
+    else if( position > 0.0f )
+    {
+        bucket = ( size_t ) position;
+    }
+
+    f->buckets[ bucket ]++;
+
+    if( ( agg->windowMs > 0u ) && ( agg->elapsedMs >= agg->windowMs ) )
+    {
+        return NCE_AGGREGATE_DUE;
+    }
+
+    return NCE_AGGREGATE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_aggregate_emit( nce_aggregate_t * agg,
+                        uint8_t * packet,
+                        size_t packetSize )
+{
+    Element2byte_gen_t element;
+    uint8_t single[ 1 + NCE_SDK_MAX_STRING_SIZE ];
+    const nce_aggregate_slot_t * slot;
+    size_t location = 1;
+    size_t i;
+    int length;
+
+    if( ( agg == NULL ) || ( packet == NULL ) || ( packetSize < 1u ) )
+    {
+        return NCE_AGGREGATE_ARGUMENT_ERROR;
+    }
+
+    if( agg->samples == 0u )
+    {
+        return NCE_AGGREGATE_EMPTY;
+    }
+
+    packet[ 0 ] = agg->selector;
+
+    /* Each element goes through the Energy Saver alone, which checks it fits its template. */
+    for( i = 0; i < agg->slotCount; i++ )
+    {
+        slot = &agg->slots[ i ];
+
+        if( _to_element( slot, _stat_value( &agg->fields[ slot->field ], slot->stat ), &element ) != NCE_AGGREGATE_SUCCESS )
+        {
+            return NCE_AGGREGATE_CONVERSION_ERROR;
+        }
+
+        length = os_energy_save_v2( single, sizeof( single ), agg->selector, &element, 1 );
+
+        if( ( length < 1 ) || ( ( size_t ) length - 1u > packetSize - location ) )
+        {
+            return NCE_AGGREGATE_CONVERSION_ERROR;
+        }
+
+        memcpy( &packet[ location ], &single[ 1 ], ( size_t ) length - 1u );
+        location += ( size_t ) length - 1u;
+    }
+
+    nce_aggregate_reset( agg );
+
+    return ( int ) location;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_aggregate_reset( nce_aggregate_t * agg )
+{
+    size_t i;
+
+    for( i = 0; i < agg->fieldCount; i++ )
+    {
+        _clear_field( &agg->fields[ i ] );
+    }
+
+    agg->samples = 0;
+    agg->elapsedMs = 0;
+    agg->carryUs = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+#endif /* if defined( NCE_SDK_AGGREGATE ) && defined( NCE_ENERGY_SAVER ) */
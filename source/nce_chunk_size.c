@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_chunk_size.c
+ * @brief Implements the payload limit cache in nce_chunk_size.h.
+ */
+
+#include <string.h>
+#include "nce_chunk_size.h"
+
+/*-----------------------------------------------------------*/
+
+static uint16_t _clamp( const nce_chunk_size_t * cache,
+                        size_t size )
+{
+    if( size < cache->minSize )
+    {
+        size = cache->minSize;
+    }
+
+    return ( uint16_t ) ( ( size > cache->maxSize ) ? cache->maxSize : size );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry of an endpoint, a new one replaces the least recently used.
+ */
+static nce_chunk_path_t * _path( nce_chunk_size_t * cache,
+                                 const OSEndPoint_t * endpoint )
+{
+    bool created;
+    nce_chunk_path_t * path = nce_endpoint_cache_get( cache->paths, NCE_SDK_CHUNK_ENDPOINTS, sizeof( cache->paths[ 0 ] ),
+                                                      &cache->uses, endpoint, &created );
+
+    if( created )
+    {
+        path->size = cache->initialSize;
+    }
+
+    return path;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Probe a larger size, halfway to a size that failed if that is
+ * closer than one step.
+ */
+static void _grow( const nce_chunk_size_t * cache,
+                   nce_chunk_path_t * path )
+{
+    uint16_t next = _clamp( cache, ( size_t ) path->size + NCE_SDK_CHUNK_STEP );
+
+    if( ( path->ceiling != 0u ) && ( next >= path->ceiling ) )
+    {
+        next = ( uint16_t ) ( ( path->size + path->ceiling ) / 2u );
+    }
+
+    if( next > path->size )
+    {
+        path->size = next;
+        path->grows++;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fall back to the last size confirmed on the path, or to half the
+ * failing size when that one failed too.
+ */
+static void _shrink( const nce_chunk_size_t * cache,
+                     nce_chunk_path_t * path,
+                     size_t size )
+{
+    path->ceiling = ( uint16_t ) size;
+    path->sinceCeiling = 0;
+
+    if( path->confirmed >= size )
+    {
+        path->confirmed = 0;
+    }
+
+    path->size = _clamp( cache, ( path->confirmed != 0u ) ? path->confirmed : size / 2u );
+    path->shrinks++;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _delivered( const nce_chunk_size_t * cache,
+                        nce_chunk_path_t * path,
+                        size_t size )
+{
+    if( size > path->confirmed )
+    {
+        path->confirmed = ( uint16_t ) size;
+    }
+
+    if( ( path->ceiling != 0u ) && ( ++path->sinceCeiling >= NCE_SDK_CHUNK_CEILING_RESET ) )
+    {
+        path->ceiling = 0;
+    }
+
+    if( size >= path->size )
+    {
+        path->lost = 0;
+
+        if( ++path->delivered >= NCE_SDK_CHUNK_GROW_AFTER )
+        {
+            path->delivered = 0;
+            _grow( cache, path );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void _lost( const nce_chunk_size_t * cache,
+                   nce_chunk_path_t * path,
+                   size_t size )
+{
+    if( size >= path->size )
+    {
+        path->delivered = 0;
+
+        if( ++path->lost >= NCE_SDK_CHUNK_LOSS_LIMIT )
+        {
+            path->lost = 0;
+            _shrink( cache, path, size );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_chunk_size_init( nce_chunk_size_t * cache,
+                          size_t minSize,
+                          size_t maxSize,
+                          size_t initialSize )
+{
+    memset( cache, 0, sizeof( *cache ) );
+    cache->minSize = ( uint16_t ) minSize;
+    cache->maxSize = ( uint16_t ) ( ( maxSize > minSize ) ? maxSize : minSize );
+    cache->initialSize = _clamp( cache, initialSize );
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_chunk_size_for_mtu( size_t mtu,
+                               size_t overhead )
+{
+    return ( mtu > overhead ) ? mtu - overhead : 0u;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_chunk_size_get( nce_chunk_size_t * cache,
+                           const OSEndPoint_t * endpoint )
+{
+    return _path( cache, endpoint )->size;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_chunk_size_report( nce_chunk_size_t * cache,
+                            const OSEndPoint_t * endpoint,
+                            size_t size,
+                            int delivered )
+{
+    nce_chunk_path_t * path = _path( cache, endpoint );
+
+    if( size > cache->maxSize )
+    {
+        size = cache->maxSize;
+    }
+
+    if( delivered )
+    {
+        _delivered( cache, path, size );
+    }
+    else
+    {
+        _lost( cache, path, size );
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_coap_option.c
+ * @brief Implements the CoAP option encoding and decoding in nce_coap_option.h.
+ */
+
+#include <string.h>
+#include "nce_coap_option.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the nibble and extension bytes of an option delta or length.
+ *
+ * @param[in] value: Delta or length.
+ * @param[out] nibble: Nibble of the option header.
+ * @param[out] extension: Extension bytes, at most 2.
+ *
+ * @return Number of extension bytes.
+ */
+static size_t _option_field( size_t value,
+                             uint8_t * nibble,
+                             uint8_t * extension )
+{
+    if( value < 13u )
+    {
+        *nibble = ( uint8_t ) value;
+        return 0;
+    }
+
+    if( value < 269u )
+    {
+        *nibble = 13u;
+        extension[ 0 ] = ( uint8_t ) ( value - 13u );
+        return 1;
+    }
+
+    *nibble = 14u;
+    extension[ 0 ] = ( uint8_t ) ( ( value - 269u ) >> 8 );
+    extension[ 1 ] = ( uint8_t ) ( value - 269u );
+    return 2;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_coap_option_append( uint8_t * message,
+                               size_t length,
+                               size_t size,
+                               uint32_t delta,
+                               const void * value,
+                               size_t valueLength )
+{
+    uint8_t deltaNibble;
+    uint8_t lengthNibble;
+    uint8_t extension[ 4 ];
+    size_t extensionLength;
+
+    if( ( delta > NCE_COAP_OPTION_FIELD_MAX ) || ( valueLength > NCE_COAP_OPTION_FIELD_MAX ) || ( length > size ) )
+    {
+        return 0;
+    }
+
+    extensionLength = _option_field( delta, &deltaNibble, extension );
+    extensionLength += _option_field( valueLength, &lengthNibble, &extension[ extensionLength ] );
+
+    if( 1u + extensionLength + valueLength > size - length )
+    {
+        return 0;
+    }
+
+    message[ length++ ] = ( uint8_t ) ( ( deltaNibble << 4 ) | lengthNibble );
+    memcpy( &message[ length ], extension, extensionLength );
+    length += extensionLength;
+
+    if( valueLength > 0u )
+    {
+        memcpy( &message[ length ], value, valueLength );
+    }
+
+    return length + valueLength;
+}
+
+/*-----------------------------------------------------------*/
+
+long nce_coap_option_field( const uint8_t * message,
+                            size_t length,
+                            size_t * position,
+                            uint8_t nibble )
+{
+    long value = nibble;
+
+    if( nibble == 13u )
+    {
+        value = ( *position < length ) ? 13L + message[ ( *position )++ ] : -1L;
+    }
+    else if( nibble == 14u )
+    {
+        value = ( *position + 1u < length ) ? 269L + ( ( long ) message[ *position ] << 8 ) + message[ *position + 1u ] : -1L;
+        *position += 2u;
+    }
+    else if( nibble == 15u )
+    {
+        value = -1L;
+    }
+
+    return value;
+}
@@ -0,0 +1,92 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_deadline.c
+ * @brief Implements the time budget in nce_deadline.h.
+ */
+#include "nce_deadline.h"
+
+/*-----------------------------------------------------------*/
+
+void nce_deadline_start( nce_deadline_t * deadline,
+                         uint32_t budgetMs,
+                         uint32_t nowUs )
+{
+    deadline->startUs = nowUs;
+    deadline->budgetMs = ( budgetMs < NCE_DEADLINE_MAX_MS ) ? budgetMs : NCE_DEADLINE_MAX_MS;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_deadline_elapsed_ms( const nce_deadline_t * deadline,
+                                  uint32_t nowUs )
+{
+    return ( nowUs - deadline->startUs ) / 1000u;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_deadline_remaining_ms( const nce_deadline_t * deadline,
+                                    uint32_t nowUs )
+{
+    uint32_t elapsed = nce_deadline_elapsed_ms( deadline, nowUs );
+
+    return ( elapsed < deadline->budgetMs ) ? deadline->budgetMs - elapsed : 0u;
+}
+
+/*-----------------------------------------------------------*/
+
+bool nce_deadline_allows( const nce_deadline_t * deadline,
+                          uint32_t waitMs,
+                          uint32_t nowUs )
+{
+    uint32_t remaining = nce_deadline_remaining_ms( deadline, nowUs );
+
+    return ( remaining >= NCE_SDK_DEADLINE_MIN_MS ) && ( remaining - NCE_SDK_DEADLINE_MIN_MS >= waitMs );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_deadline_share_ms( const nce_deadline_t * deadline,
+                                uint32_t timeoutMs,
+                                unsigned int attemptsLeft,
+                                uint32_t nowUs )
+{
+    uint32_t remaining = nce_deadline_remaining_ms( deadline, nowUs );
+    uint32_t share = remaining / ( ( attemptsLeft > 0u ) ? attemptsLeft : 1u );
+
+    if( share < NCE_SDK_DEADLINE_MIN_RECV_MS )
+    {
+        share = NCE_SDK_DEADLINE_MIN_RECV_MS;
+    }
+
+    if( share > timeoutMs )
+    {
+        share = timeoutMs;
+    }
+
+    return ( share < remaining ) ? share : remaining;
+}
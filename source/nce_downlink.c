@@ -0,0 +1,958 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_downlink.c
+ * @brief Implements the dispatcher of server-initiated requests in
+ * nce_downlink.h.
+ */
+
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_CORE
+
+#include <string.h>
+#include "nce_downlink.h"
+#include "nce_coap_option.h"
+
+#ifdef ARDUINO
+    #include "interface/log_interface.h"
+    #include "interface/clock_interface.h"
+#else
+    #include "log_interface.h"
+    #include "clock_interface.h"
+#endif /* ifdef ARDUINO */
+
+#ifdef NCE_SDK_DOWNLINK
+
+    #ifdef __ZEPHYR__
+LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
+    #endif
+
+/**
+ * @brief CoAP message layout (RFC 7252, 3).
+ */
+    #define COAP_HEADER_SIZE              4u
+    #define COAP_VERSION                  1u
+    #define COAP_TYPE_CON                 0u
+    #define COAP_TYPE_NON                 1u
+    #define COAP_TYPE_ACK                 2u
+    #define COAP_TYPE_RST                 3u
+    #define COAP_TOKEN_MAX                8u
+    #define COAP_EMPTY                    0u
+    #define COAP_PAYLOAD_MARKER           0xFFu
+    #define COAP_CLASS( code )            ( ( uint8_t ) ( code ) >> 5 )
+
+/**
+ * @brief Options the dispatcher reads. Uri-Host, Uri-Port and Accept are
+ * critical but do not change the handling of a request on a connected
+ * socket, other unknown critical options are refused with 4.02.
+ */
+    #define COAP_OPTION_URI_HOST          3
+    #define COAP_OPTION_OBSERVE           6
+    #define COAP_OPTION_URI_PORT          7
+    #define COAP_OPTION_URI_PATH          11
+    #define COAP_OPTION_CONTENT_FORMAT    12
+    #define COAP_OPTION_URI_QUERY         15
+    #define COAP_OPTION_ACCEPT            17
+
+/**
+ * @brief Observe values of a registration and a deregistration (RFC 7641,
+ * 2), and the range of the sequence numbers.
+ */
+    #define OBSERVE_REGISTER              0L
+    #define OBSERVE_DEREGISTER            1L
+    #define OBSERVE_SEQUENCE_MASK         0xFFFFFFu
+
+/**
+ * @brief Room left in front of the payload written by a handler: header,
+ * token, Observe and Content-Format options, payload marker.
+ */
+    #define DOWNLINK_HEADROOM             ( COAP_HEADER_SIZE + COAP_TOKEN_MAX + 4u + 3u + 1u )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Unsigned integer option value (RFC 7252, 3.2).
+ */
+static long _uint_value( const uint8_t * value,
+                         long optionLength )
+{
+    long result = 0;
+    long i;
+
+    for( i = 0; i < optionLength; i++ )
+    {
+        result = ( result << 8 ) | value[ i ];
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append an option segment to a path or query string.
+ *
+ * @return false if the string would not fit.
+ */
+static bool _append_segment( char * text,
+                             size_t size,
+                             const uint8_t * value,
+                             size_t valueLength,
+                             char separator )
+{
+    size_t used = strlen( text );
+
+    if( used + ( ( used > 0u ) ? 1u : 0u ) + valueLength + 1u > size )
+    {
+        return false;
+    }
+
+    if( used > 0u )
+    {
+        text[ used++ ] = separator;
+    }
+
+    memcpy( &text[ used ], value, valueLength );
+    text[ used + valueLength ] = '\0';
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the options and payload of the request in the receive buffer.
+ *
+ * @param[in] downlink: Dispatcher.
+ * @param[in] length: Length of the request.
+ * @param[out] request: Path, query, Content-Format and payload.
+ * @param[out] observe: Observe value, -1 if absent.
+ *
+ * @return 0, a 4.xx code to answer with, or -1 for a malformed message.
+ */
+static int _parse_options( nce_downlink_t * downlink,
+                           size_t length,
+                           nce_downlink_request_t * request,
+                           long * observe )
+{
+    const uint8_t * message = downlink->rx;
+    size_t position = COAP_HEADER_SIZE + ( message[ 0 ] & 0x0Fu );
+    long number = 0;
+    long delta;
+    long optionLength;
+    uint8_t header;
+    int status = 0;
+
+    downlink->path[ 0 ] = '\0';
+    downlink->query[ 0 ] = '\0';
+    request->contentFormat = -1;
+    request->payload = NULL;
+    request->payloadLength = 0;
+    *observe = -1;
+
+    while( ( position < length ) && ( message[ position ] != COAP_PAYLOAD_MARKER ) )
+    {
+        header = message[ position++ ];
+        delta = nce_coap_option_field( message, length, &position, ( uint8_t ) ( header >> 4 ) );
+        optionLength = nce_coap_option_field( message, length, &position, ( uint8_t ) ( header & 0x0Fu ) );
+
+        if( ( delta < 0 ) || ( optionLength < 0 ) || ( position + ( size_t ) optionLength > length ) )
+        {
+            return -1;
+        }
+
+        number += delta;
+        position += ( size_t ) optionLength;
+
+        /* The rest of the options is still checked for the format. */
+        if( status != 0 )
+        {
+            continue;
+        }
+
+        switch( number )
+        {
+            case COAP_OPTION_URI_PATH:
+
+                if( !_append_segment( downlink->path, sizeof( downlink->path ), &message[ position - ( size_t ) optionLength ],
+                                      ( size_t ) optionLength, '/' ) )
+                {
+                    status = NCE_COAP_NOT_FOUND;
+                }
+
+                break;
+
+            case COAP_OPTION_URI_QUERY:
+
+                if( !_append_segment( downlink->query, sizeof( downlink->query ), &message[ position - ( size_t ) optionLength ],
+                                      ( size_t ) optionLength, '&' ) )
+                {
+                    status = NCE_COAP_BAD_REQUEST;
+                }
+
+                break;
+
+            case COAP_OPTION_CONTENT_FORMAT:
+
+                if( optionLength <= 2 )
+                {
+                    request->contentFormat = ( int ) _uint_value( &message[ position - ( size_t ) optionLength ], optionLength );
+                }
+
+                break;
+
+            case COAP_OPTION_OBSERVE:
+
+                if( optionLength <= 3 )
+                {
+                    *observe = _uint_value( &message[ position - ( size_t ) optionLength ], optionLength );
+                }
+
+                break;
+
+            case COAP_OPTION_URI_HOST:
+            case COAP_OPTION_URI_PORT:
+            case COAP_OPTION_ACCEPT:
+                break;
+
+            default:
+
+                /* Odd option numbers are critical (RFC 7252, 5.4.1). */
+                if( ( number & 1L ) != 0 )
+                {
+                    status = NCE_COAP_BAD_OPTION;
+                }
+
+                break;
+        }
+    }
+
+    if( position < length )
+    {
+        /* A payload marker must be followed by a payload. */
+        if( ++position == length )
+        {
+            return -1;
+        }
+
+        request->payload = &message[ position ];
+        request->payloadLength = length - position;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append an unsigned integer option with a delta below 13.
+ *
+ * @return Length of the message with the option.
+ */
+static size_t _append_uint_option( uint8_t * message,
+                                   size_t length,
+                                   unsigned int delta,
+                                   uint32_t value )
+{
+    size_t bytes = ( value == 0u ) ? 0u : ( value <= 0xFFu ) ? 1u : ( value <= 0xFFFFu ) ? 2u : 3u;
+
+    message[ length++ ] = ( uint8_t ) ( ( delta << 4 ) | bytes );
+
+    while( bytes-- > 0u )
+    {
+        message[ length++ ] = ( uint8_t ) ( value >> ( 8u * bytes ) );
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a response or notification to the transmit buffer, moving
+ * the payload of the handler after the options.
+ *
+ * @param[in] downlink: Dispatcher.
+ * @param[in] type: Message type.
+ * @param[in] messageId: Message ID.
+ * @param[in] token: Token, at most COAP_TOKEN_MAX bytes.
+ * @param[in] tokenLength: Length of the token.
+ * @param[in] observe: Observe value, -1 for none.
+ * @param[in] response: Response of the handler.
+ *
+ * @return Length of the message.
+ */
+static size_t _build_message( nce_downlink_t * downlink,
+                              uint8_t type,
+                              uint16_t messageId,
+                              const uint8_t * token,
+                              uint8_t tokenLength,
+                              long observe,
+                              const nce_downlink_response_t * response )
+{
+    uint8_t * message = downlink->tx;
+    size_t length = COAP_HEADER_SIZE + tokenLength;
+    unsigned int number = 0;
+
+    message[ 0 ] = ( uint8_t ) ( ( COAP_VERSION << 6 ) | ( ( unsigned int ) type << 4 ) | tokenLength );
+    message[ 1 ] = response->code;
+    message[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    message[ 3 ] = ( uint8_t ) messageId;
+    memcpy( &message[ COAP_HEADER_SIZE ], token, tokenLength );
+
+    if( observe >= 0 )
+    {
+        length = _append_uint_option( message, length, COAP_OPTION_OBSERVE, ( uint32_t ) observe );
+        number = COAP_OPTION_OBSERVE;
+    }
+
+    if( response->contentFormat >= 0 )
+    {
+        length = _append_uint_option( message, length, COAP_OPTION_CONTENT_FORMAT - number,
+                                      ( uint32_t ) response->contentFormat & 0xFFFFu );
+    }
+
+    if( response->payloadLength > 0u )
+    {
+        message[ length++ ] = COAP_PAYLOAD_MARKER;
+        memmove( &message[ length ], response->payload, response->payloadLength );
+        length += response->payloadLength;
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the first length bytes of the transmit buffer.
+ */
+static int _send( nce_downlink_t * downlink,
+                  size_t length )
+{
+    if( downlink->osNetwork->nce_os_udp_send( downlink->osNetwork->os_socket, downlink->tx, length ) != ( int ) length )
+    {
+        downlink->stats.sendErrors++;
+        NceOSLogError( "Downlink: send failed.\n" );
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send an empty reset. The transmit buffer is left alone, it may
+ * hold a response to repeat.
+ */
+static int _send_reset( nce_downlink_t * downlink,
+                        uint16_t messageId )
+{
+    uint8_t reset[ COAP_HEADER_SIZE ];
+
+    reset[ 0 ] = ( uint8_t ) ( ( COAP_VERSION << 6 ) | ( COAP_TYPE_RST << 4 ) );
+    reset[ 1 ] = COAP_EMPTY;
+    reset[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    reset[ 3 ] = ( uint8_t ) messageId;
+
+    if( downlink->osNetwork->nce_os_udp_send( downlink->osNetwork->os_socket, reset, sizeof( reset ) ) != ( int ) sizeof( reset ) )
+    {
+        downlink->stats.sendErrors++;
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Refuse a malformed or unexpected message, with a reset if it is
+ * confirmable.
+ */
+static int _reject( nce_downlink_t * downlink,
+                    uint8_t type,
+                    uint16_t messageId )
+{
+    downlink->stats.rejected++;
+
+    if( type == COAP_TYPE_CON )
+    {
+        ( void ) _send_reset( downlink, messageId );
+    }
+
+    return NCE_SDK_PARSING_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Check a request against the recent message IDs and remember it.
+ *
+ * @return true if the message ID was seen within EXCHANGE_LIFETIME.
+ */
+static bool _duplicate( nce_downlink_t * downlink,
+                        uint16_t messageId )
+{
+    uint32_t now = NceOSClockUs();
+    nce_downlink_seen_t * oldest = &downlink->seen[ 0 ];
+    size_t i;
+
+    for( i = 0; i < NCE_SDK_DOWNLINK_DEDUP_ENTRIES; i++ )
+    {
+        nce_downlink_seen_t * entry = &downlink->seen[ i ];
+
+        if( entry->used && ( now - entry->timeUs >= NCE_SDK_DOWNLINK_EXCHANGE_LIFETIME_S * 1000000u ) )
+        {
+            entry->used = 0;
+        }
+
+        if( entry->used && ( entry->messageId == messageId ) )
+        {
+            return true;
+        }
+
+        if( !entry->used || ( oldest->used && ( now - entry->timeUs > now - oldest->timeUs ) ) )
+        {
+            oldest = entry;
+        }
+    }
+
+    oldest->used = 1;
+    oldest->messageId = messageId;
+    oldest->timeUs = now;
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Acknowledgement or reset: settle the notification it answers. A
+ * reset cancels the observation (RFC 7641, 3.6).
+ */
+static int _handle_reply( nce_downlink_t * downlink,
+                          uint8_t type,
+                          uint16_t messageId )
+{
+    size_t i;
+
+    if( type == COAP_TYPE_ACK )
+    {
+        downlink->stats.acks++;
+    }
+    else
+    {
+        downlink->stats.resets++;
+    }
+
+    for( i = 0; i < NCE_SDK_DOWNLINK_OBSERVERS; i++ )
+    {
+        nce_downlink_observer_t * observer = &downlink->observers[ i ];
+
+        if( ( observer->resource != NULL ) && ( observer->lastId == messageId ) )
+        {
+            observer->pending = 0;
+
+            if( type == COAP_TYPE_RST )
+            {
+                observer->resource = NULL;
+            }
+        }
+    }
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Resource of a path, NULL if none.
+ */
+static const nce_downlink_resource_t * _find_resource( const nce_downlink_t * downlink,
+                                                       const char * path )
+{
+    size_t i;
+
+    for( i = 0; i < downlink->resourceCount; i++ )
+    {
+        if( strcmp( downlink->resources[ i ].path, path ) == 0 )
+        {
+            return &downlink->resources[ i ];
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Register or deregister the observer of a resource, a registration
+ * replacing the previous one of the same resource.
+ *
+ * @return true if the requester is an observer afterwards.
+ */
+static bool _update_observer( nce_downlink_t * downlink,
+                              const nce_downlink_resource_t * resource,
+                              const uint8_t * token,
+                              uint8_t tokenLength,
+                              bool observing )
+{
+    nce_downlink_observer_t * entry = NULL;
+    size_t i;
+
+    for( i = 0; i < NCE_SDK_DOWNLINK_OBSERVERS; i++ )
+    {
+        if( downlink->observers[ i ].resource == resource )
+        {
+            entry = &downlink->observers[ i ];
+            break;
+        }
+
+        if( ( entry == NULL ) && ( downlink->observers[ i ].resource == NULL ) )
+        {
+            entry = &downlink->observers[ i ];
+        }
+    }
+
+    if( !observing )
+    {
+        if( ( entry != NULL ) && ( entry->resource == resource ) && ( entry->tokenLength == tokenLength ) &&
+            ( memcmp( entry->token, token, tokenLength ) == 0 ) )
+        {
+            entry->resource = NULL;
+        }
+
+        return false;
+    }
+
+    if( entry == NULL )
+    {
+        NceOSLogWarn( "Downlink: no room for an observer of %s.\n", resource->path );
+        return false;
+    }
+
+    entry->resource = resource;
+    memcpy( entry->token, token, tokenLength );
+    entry->tokenLength = tokenLength;
+    entry->pending = 0;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Preset the response of a handler.
+ */
+static void _init_response( nce_downlink_t * downlink,
+                            uint8_t method,
+                            nce_downlink_response_t * response )
+{
+    response->code = ( method == NCE_COAP_GET ) ? NCE_COAP_CONTENT : NCE_COAP_CHANGED;
+    response->contentFormat = -1;
+    response->payload = &downlink->tx[ DOWNLINK_HEADROOM ];
+    response->payloadSize = sizeof( downlink->tx ) - DOWNLINK_HEADROOM;
+    response->payloadLength = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Call a handler, turning a payload overflowing the transmit buffer
+ * into a 5.00.
+ */
+static void _call_handler( const nce_downlink_resource_t * resource,
+                           const nce_downlink_request_t * request,
+                           nce_downlink_response_t * response )
+{
+    resource->handler( resource->arg, request, response );
+
+    if( response->payloadLength > response->payloadSize )
+    {
+        NceOSLogError( "Downlink: response of %s too large.\n", resource->path );
+        response->code = NCE_COAP_INTERNAL_ERROR;
+        response->contentFormat = -1;
+        response->payloadLength = 0;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Remove an observer whose last retransmission timed out too.
+ *
+ * @return true if the observer was removed.
+ */
+static bool _unacknowledged( nce_downlink_observer_t * observer,
+                             uint32_t now )
+{
+    if( ( observer->retransmissions < NCE_SDK_DOWNLINK_MAX_RETRANSMIT ) || ( now - observer->sentUs < observer->timeoutUs ) )
+    {
+        return false;
+    }
+
+    NceOSLogWarn( "Downlink: observer of %s stopped acknowledging.\n", observer->resource->path );
+    observer->resource = NULL;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Build a notification of the current state of the observed
+ * resource with its handler and send it. An error response ends the
+ * observation (RFC 7641, 4.2).
+ *
+ * @param[in] downlink: Dispatcher.
+ * @param[in] observer: Observer.
+ * @param[in] confirmable: Send it confirmable.
+ * @param[in] messageId: Message ID, the previous one for a retransmission.
+ *
+ * @return NCE_SDK_SUCCESS, or NCE_SDK_SEND_ERROR.
+ */
+static int _send_notification( nce_downlink_t * downlink,
+                               nce_downlink_observer_t * observer,
+                               bool confirmable,
+                               uint16_t messageId )
+{
+    nce_downlink_request_t request;
+    nce_downlink_response_t response;
+    size_t length;
+    long sequence = -1;
+
+    memset( &request, 0, sizeof( request ) );
+    request.method = NCE_COAP_GET;
+    request.notification = true;
+    request.path = observer->resource->path;
+    request.query = "";
+    request.contentFormat = -1;
+
+    _init_response( downlink, NCE_COAP_GET, &response );
+    _call_handler( observer->resource, &request, &response );
+
+    if( COAP_CLASS( response.code ) == 2u )
+    {
+        downlink->observeSequence = ( downlink->observeSequence + 1u ) & OBSERVE_SEQUENCE_MASK;
+        sequence = ( long ) downlink->observeSequence;
+    }
+
+    length = _build_message( downlink, confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, messageId,
+                             observer->token, observer->tokenLength, sequence, &response );
+    downlink->responseLength = 0;
+
+    if( _send( downlink, length ) != NCE_SDK_SUCCESS )
+    {
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    observer->lastId = messageId;
+    observer->pending = ( uint8_t ) ( confirmable && ( sequence >= 0 ) );
+
+    if( sequence < 0 )
+    {
+        observer->resource = NULL;
+    }
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Dispatch a new request in the receive buffer and answer it.
+ */
+static int _handle_request( nce_downlink_t * downlink,
+                            size_t length )
+{
+    const uint8_t * message = downlink->rx;
+    uint8_t type = ( uint8_t ) ( ( message[ 0 ] >> 4 ) & 0x03u );
+    uint8_t tokenLength = ( uint8_t ) ( message[ 0 ] & 0x0Fu );
+    uint16_t messageId = ( uint16_t ) ( ( message[ 2 ] << 8 ) | message[ 3 ] );
+    const nce_downlink_resource_t * resource = NULL;
+    nce_downlink_request_t request;
+    nce_downlink_response_t response;
+    long observe;
+    long sequence = -1;
+    int status;
+
+    request.method = message[ 1 ];
+    request.confirmable = ( type == COAP_TYPE_CON );
+    request.notification = false;
+    request.path = downlink->path;
+    request.query = downlink->query;
+    status = _parse_options( downlink, length, &request, &observe );
+
+    if( status < 0 )
+    {
+        return _reject( downlink, type, messageId );
+    }
+
+    _init_response( downlink, request.method, &response );
+
+    if( status == 0 )
+    {
+        resource = _find_resource( downlink, downlink->path );
+    }
+
+    if( status != 0 )
+    {
+        response.code = ( uint8_t ) status;
+    }
+    else if( resource == NULL )
+    {
+        downlink->stats.notFound++;
+        response.code = NCE_COAP_NOT_FOUND;
+    }
+    else
+    {
+        downlink->stats.requests++;
+        _call_handler( resource, &request, &response );
+
+        if( resource->observable && ( request.method == NCE_COAP_GET ) && ( observe >= 0 ) &&
+            _update_observer( downlink, resource, &message[ COAP_HEADER_SIZE ], tokenLength,
+                              ( observe == OBSERVE_REGISTER ) && ( COAP_CLASS( response.code ) == 2u ) ) )
+        {
+            downlink->observeSequence = ( downlink->observeSequence + 1u ) & OBSERVE_SEQUENCE_MASK;
+            sequence = ( long ) downlink->observeSequence;
+        }
+    }
+
+    if( type == COAP_TYPE_CON )
+    {
+        length = _build_message( downlink, COAP_TYPE_ACK, messageId, &message[ COAP_HEADER_SIZE ], tokenLength,
+                                 sequence, &response );
+        downlink->responseId = messageId;
+        downlink->responseLength = length;
+    }
+    else
+    {
+        length = _build_message( downlink, COAP_TYPE_NON, ++downlink->messageId, &message[ COAP_HEADER_SIZE ],
+                                 tokenLength, sequence, &response );
+        downlink->responseLength = 0;
+    }
+
+    return _send( downlink, length );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_downlink_init( nce_downlink_t * downlink,
+                        os_network_ops_t * osNetwork,
+                        const nce_downlink_resource_t * resources,
+                        size_t resourceCount )
+{
+    memset( downlink, 0, sizeof( *downlink ) );
+    downlink->osNetwork = osNetwork;
+    downlink->resources = resources;
+    downlink->resourceCount = resourceCount;
+    /* IDs of a previous run may still be remembered by the server. */
+    downlink->messageId = ( uint16_t ) NceOSClockUs();
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_downlink_process( nce_downlink_t * downlink,
+                          const uint8_t * datagram,
+                          size_t length )
+{
+    uint8_t type;
+    uint8_t tokenLength;
+    uint16_t messageId;
+
+    if( ( length < COAP_HEADER_SIZE ) || ( length > sizeof( downlink->rx ) ) || ( ( datagram[ 0 ] >> 6 ) != COAP_VERSION ) )
+    {
+        downlink->stats.rejected++;
+        return NCE_SDK_PARSING_ERROR;
+    }
+
+    type = ( uint8_t ) ( ( datagram[ 0 ] >> 4 ) & 0x03u );
+    tokenLength = ( uint8_t ) ( datagram[ 0 ] & 0x0Fu );
+    messageId = ( uint16_t ) ( ( datagram[ 2 ] << 8 ) | datagram[ 3 ] );
+
+    /* Fast path: acknowledgements and resets only carry a message ID. */
+    if( ( type == COAP_TYPE_ACK ) || ( type == COAP_TYPE_RST ) )
+    {
+        return _handle_reply( downlink, type, messageId );
+    }
+
+    if( ( tokenLength > COAP_TOKEN_MAX ) || ( length < COAP_HEADER_SIZE + tokenLength ) )
+    {
+        return _reject( downlink, type, messageId );
+    }
+
+    /* An empty confirmable message is a CoAP ping (RFC 7252, 4.3). */
+    if( ( datagram[ 1 ] == COAP_EMPTY ) && ( type == COAP_TYPE_CON ) )
+    {
+        downlink->stats.pings++;
+        return _send_reset( downlink, messageId );
+    }
+
+    /* Neither are empty non-confirmable messages and responses; separate
+     * responses belong to the application. */
+    if( ( datagram[ 1 ] == COAP_EMPTY ) || ( COAP_CLASS( datagram[ 1 ] ) != 0u ) )
+    {
+        return _reject( downlink, type, messageId );
+    }
+
+    if( _duplicate( downlink, messageId ) )
+    {
+        downlink->stats.duplicates++;
+
+        /* The response was lost: repeat it, the handler is not called again. */
+        if( ( type == COAP_TYPE_CON ) && ( downlink->responseLength > 0u ) && ( downlink->responseId == messageId ) )
+        {
+            return _send( downlink, downlink->responseLength );
+        }
+
+        return NCE_SDK_SUCCESS;
+    }
+
+    if( datagram != downlink->rx )
+    {
+        memcpy( downlink->rx, datagram, length );
+    }
+
+    return _handle_request( downlink, length );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_downlink_poll( nce_downlink_t * downlink,
+                       unsigned int maxDatagrams )
+{
+    unsigned int handled = 0;
+    int received;
+
+    while( handled < maxDatagrams )
+    {
+        received = downlink->osNetwork->nce_os_udp_recv( downlink->osNetwork->os_socket, downlink->rx,
+                                                         sizeof( downlink->rx ) );
+
+        if( received < 0 )
+        {
+            NceOSLogError( "Downlink: receive failed.\n" );
+            return NCE_SDK_RECEIVE_ERROR;
+        }
+
+        if( received == 0 )
+        {
+            break;
+        }
+
+        ( void ) nce_downlink_process( downlink, downlink->rx, ( size_t ) received );
+        handled++;
+    }
+
+    ( void ) nce_downlink_tick( downlink );
+
+    return ( int ) handled;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_downlink_notify( nce_downlink_t * downlink,
+                         const char * path,
+                         bool confirmable )
+{
+    uint32_t now = NceOSClockUs();
+    size_t i;
+    int sent = 0;
+
+    for( i = 0; i < NCE_SDK_DOWNLINK_OBSERVERS; i++ )
+    {
+        nce_downlink_observer_t * observer = &downlink->observers[ i ];
+
+        if( ( observer->resource == NULL ) || ( strcmp( observer->resource->path, path ) != 0 ) )
+        {
+            continue;
+        }
+
+        if( observer->pending && _unacknowledged( observer, now ) )
+        {
+            continue;
+        }
+
+        if( !observer->pending )
+        {
+            observer->retransmissions = 0;
+            observer->sentUs = now;
+            observer->timeoutUs = NCE_SDK_DOWNLINK_ACK_TIMEOUT_MS * 1000u;
+        }
+
+        /* A notification in flight is replaced, its retransmission state
+         * carries over (RFC 7641, 4.5.2). */
+        if( _send_notification( downlink, observer, confirmable || observer->pending,
+                                ++downlink->messageId ) != NCE_SDK_SUCCESS )
+        {
+            return NCE_SDK_SEND_ERROR;
+        }
+
+        downlink->stats.notifications++;
+        sent++;
+    }
+
+    return sent;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_downlink_tick( nce_downlink_t * downlink )
+{
+    uint32_t now = NceOSClockUs();
+    size_t i;
+    int sent = 0;
+
+    for( i = 0; i < NCE_SDK_DOWNLINK_OBSERVERS; i++ )
+    {
+        nce_downlink_observer_t * observer = &downlink->observers[ i ];
+
+        if( ( observer->resource == NULL ) || !observer->pending || ( now - observer->sentUs < observer->timeoutUs ) ||
+            _unacknowledged( observer, now ) )
+        {
+            continue;
+        }
+
+        /* Backed off before sending, so a failing port is not retried at once. */
+        observer->retransmissions++;
+        observer->sentUs = now;
+        observer->timeoutUs *= 2u;
+        downlink->stats.retransmissions++;
+
+        if( _send_notification( downlink, observer, true, observer->lastId ) != NCE_SDK_SUCCESS )
+        {
+            return NCE_SDK_SEND_ERROR;
+        }
+
+        sent++;
+    }
+
+    return sent;
+}
+
+#endif /* ifdef NCE_SDK_DOWNLINK */
@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_endpoint_cache.c
+ * @brief Implements the per-endpoint table in nce_endpoint_cache.h.
+ */
+
+#include <string.h>
+#include "nce_endpoint_cache.h"
+
+/**
+ * @brief FNV-1a parameters hashing endpoints.
+ */
+#define ENDPOINT_FNV_OFFSET    2166136261u
+#define ENDPOINT_FNV_PRIME     16777619u
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_endpoint_key( const OSEndPoint_t * endpoint )
+{
+    uint32_t hash = ENDPOINT_FNV_OFFSET;
+    size_t i;
+
+    for( i = 0; ( i < sizeof( endpoint->host ) ) && ( endpoint->host[ i ] != '\0' ); i++ )
+    {
+        hash = ( hash ^ ( uint8_t ) endpoint->host[ i ] ) * ENDPOINT_FNV_PRIME;
+    }
+
+    hash = ( hash ^ ( uint8_t ) endpoint->port ) * ENDPOINT_FNV_PRIME;
+    hash = ( hash ^ ( uint8_t ) ( endpoint->port >> 8 ) ) * ENDPOINT_FNV_PRIME;
+
+    /* 0 marks a free entry. */
+    return ( hash != 0u ) ? hash : 1u;
+}
+
+/*-----------------------------------------------------------*/
+
+void * nce_endpoint_cache_get( void * entries,
+                               size_t count,
+                               size_t entrySize,
+                               uint32_t * uses,
+                               const OSEndPoint_t * endpoint,
+                               bool * created )
+{
+    uint32_t key = nce_endpoint_key( endpoint );
+    uint8_t * table = ( uint8_t * ) entries;
+    nce_endpoint_entry_t * entry = ( nce_endpoint_entry_t * ) table;
+    nce_endpoint_entry_t * candidate;
+    size_t i;
+
+    for( i = 0; i < count; i++ )
+    {
+        candidate = ( nce_endpoint_entry_t * ) ( table + i * entrySize );
+
+        if( candidate->key == key )
+        {
+            entry = candidate;
+            break;
+        }
+
+        if( ( int32_t ) ( candidate->lastUse - entry->lastUse ) < 0 )
+        {
+            entry = candidate;
+        }
+    }
+
+    *created = ( entry->key != key );
+
+    if( *created )
+    {
+        memset( entry, 0, entrySize );
+        entry->key = key;
+    }
+
+    entry->lastUse = ++( *uses );
+
+    return entry;
+}
@@ -29,15 +29,20 @@
  * @date 01 Mar 2022
  */
 
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_CORE
+
 #include "nce_iot_c_sdk.h"
+#include "nce_retry.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 
 #ifdef ARDUINO
     #include "interface/log_interface.h"
+    #include "interface/clock_interface.h"
 #else
     #include "log_interface.h"
+    #include "clock_interface.h"
 #endif /* ifdef ARDUINO */
 
 #ifdef __ZEPHYR__
@@ -46,65 +51,196 @@ LOG_MODULE_REGISTER( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
 
 #ifdef NCE_DEVICE_AUTHENTICATOR
 
-static uint16_t message_id = 1000;
+#ifdef NceOSDelayMs
+
+/**
+ * @brief Wait of the OS between onboarding attempts.
+ *
+ * @param[in] ms: Milliseconds to wait.
+ */
+static void _os_delay_ms( uint32_t ms )
+{
+    NceOSDelayMs( ms );
+}
+
+    #define NCE_SDK_DEFAULT_DELAY    _os_delay_ms
+#else
+    #define NCE_SDK_DEFAULT_DELAY    NULL
+#endif /* ifdef NceOSDelayMs */
+
+/**
+ * @brief Context used by the legacy os_auth() entry point.
+ */
+static nce_context_t defaultContext =
+{
+    NULL, NULL, &NceOnboard, NCE_SDK_INITIAL_MESSAGE_ID, NCE_SDK_DEFAULT_DELAY
+    #ifdef NCE_SDK_METRICS
+    , NULL
+    #endif
+    #ifdef NCE_SDK_RTO
+    , NULL
+    #endif
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+    , NULL
+    #endif
+    #ifdef NCE_SDK_DEADLINE
+    , NULL, NULL
+    #endif
+};
 
 /**
  * @brief Create Incremental Message ID for CoAP onboarding
  *
+ * @param[in] ctx: SDK context owning the message ID.
  */
-static uint16_t _getNextMessageID()
+static uint16_t _getNextMessageID( nce_context_t * ctx )
 {
-    message_id++;
-    return message_id;
+    ctx->messageId++;
+    return ctx->messageId;
 }
 
 /**
- * @brief Process the DTLS credential to match the requirement
+ * @brief Copy the next comma separated field of the response, without
+ * terminating it.
  *
- * @param[in] packet: the target packet to be processed.
- * @param[in] nceKey: the new DTLS credential required.
+ * Unlike strtok, the parsing state is kept by the caller, so several devices
+ * can be onboarded from different threads.
  *
+ * @param[in] field: Start of the field (leading commas are skipped).
+ * @param[out] dest: Destination bytes.
+ * @param[in] destSize: Size of the destination.
+ * @param[out] length: Length of the field.
+ *
+ * @return Pointer past the copied field, NULL if the field is missing or too long.
  */
-static int _get_psk( char * packet,
-                     DtlsKey_t * nceKey )
+static char * _next_field( char * field,
+                           void * dest,
+                           size_t destSize,
+                           size_t * length )
 {
-    int status = NCE_SDK_PARSING_ERROR;
-    char * resp = strstr( packet, "89" );
+    while( *field == ',' )
+    {
+        field++;
+    }
 
-    if( resp == NULL )
+    *length = strcspn( field, "," );
+
+    if( ( *length == 0 ) || ( *length > destSize ) )
+    {
+        return NULL;
+    }
+
+    memcpy( dest, field, *length );
+
+    return field + *length;
+}
+
+/**
+ * @brief Credentials being parsed: destinations and lengths of both fields.
+ */
+typedef struct _credentials
+{
+    void * identity;
+    size_t identitySize;
+    size_t identityLength;
+    void * psk;
+    size_t pskSize;
+    size_t pskLength;
+} _credentials_t;
+
+/**
+ * @brief Split the response into the identity and the PSK.
+ *
+ * @param[in] packet: the NUL-terminated response.
+ * @param[in,out] credentials: destinations, receive the lengths.
+ *
+ * @return NCE_SDK_SUCCESS, or NCE_SDK_PARSING_ERROR if a field is missing or too long.
+ */
+static int _parse_credentials( char * packet,
+                               _credentials_t * credentials )
+{
+    char * p = strstr( packet, "89" );
+
+    if( p == NULL )
     {
         NceOSLogError( "ERROR: Packet can't be NULL\n" );
-        return status;
+        return NCE_SDK_PARSING_ERROR;
     }
-    else
+
+    p = _next_field( p, credentials->identity, credentials->identitySize, &credentials->identityLength );
+
+    if( p != NULL )
     {
-        char * p = strtok( resp, "," );
+        p = _next_field( p, credentials->psk, credentials->pskSize, &credentials->pskLength );
+    }
 
-        if( p == NULL )
-        {
-            NceOSLogError( "ERROR: Parsing Error\n" );
-            return status;
-        }
-        else
-        {
-            strcpy( nceKey->PskIdentity, p );
-        }
+    if( p == NULL )
+    {
+        NceOSLogError( "ERROR: Parsing Error\n" );
+        return NCE_SDK_PARSING_ERROR;
+    }
 
-        p = strtok( NULL, "," );
+    NceOSLogInfo( "DTLS Credentials Recieved.\n" );
+    return NCE_SDK_SUCCESS;
+}
 
-        if( p == NULL )
-        {
-            NceOSLogError( "ERROR: Parsing Error\n" );
-            return status;
-        }
-        else
-        {
-            strcpy( nceKey->Psk, p );
-        }
+/**
+ * @brief Process the DTLS credential to match the requirement
+ *
+ * @param[in] packet: the target packet to be processed.
+ * @param[out] key: the new DTLS credential required, a DtlsKey_t.
+ *
+ */
+static int _get_psk( char * packet,
+                     void * key )
+{
+    DtlsKey_t * nceKey = ( DtlsKey_t * ) key;
+    _credentials_t credentials;
+    int status;
+
+    /* One byte of each string is kept for its terminator. */
+    credentials.identity = nceKey->PskIdentity;
+    credentials.identitySize = sizeof( nceKey->PskIdentity ) - 1;
+    credentials.psk = nceKey->Psk;
+    credentials.pskSize = sizeof( nceKey->Psk ) - 1;
+    status = _parse_credentials( packet, &credentials );
+
+    if( status == NCE_SDK_SUCCESS )
+    {
+        nceKey->PskIdentity[ credentials.identityLength ] = '\0';
+        nceKey->Psk[ credentials.pskLength ] = '\0';
+    }
+
+    return status;
+}
 
-        NceOSLogInfo( "DTLS Credentials Recieved.\n" );
-        return NCE_SDK_SUCCESS;
+/**
+ * @brief Process the DTLS credential into length-prefixed binary.
+ *
+ * @param[in] packet: the target packet to be processed.
+ * @param[out] key: the new DTLS credential required, a nce_dtls_key_t.
+ *
+ */
+static int _get_psk_v2( char * packet,
+                        void * key )
+{
+    nce_dtls_key_t * nceKey = ( nce_dtls_key_t * ) key;
+    _credentials_t credentials;
+    int status;
+
+    credentials.identity = nceKey->identity;
+    credentials.identitySize = sizeof( nceKey->identity );
+    credentials.psk = nceKey->psk;
+    credentials.pskSize = sizeof( nceKey->psk );
+    status = _parse_credentials( packet, &credentials );
+
+    if( status == NCE_SDK_SUCCESS )
+    {
+        nceKey->identityLength = ( uint8_t ) credentials.identityLength;
+        nceKey->pskLength = ( uint8_t ) credentials.pskLength;
     }
+
+    return status;
 }
 
 /*-----------------------------------------------------------*/
@@ -115,14 +251,16 @@ static int _get_psk( char * packet,
  * If connection fails, retry is attempted after a timeout.
  * 1NCE endpoint require DTLS Connection
  *
- * @param[in] osNetwork: udp interface object.
+ * @param[in] ctx: SDK context of the device.
  *
- * @return The status of the final connection attempt.
+ * @return The status of the final connection attempt, NCE_SDK_DEADLINE_EXCEEDED
+ * if the budget of the operation ran out first.
  */
-static int _os_udp_connect( os_network_ops_t * osNetwork )
+static int _os_udp_connect( nce_context_t * ctx )
 {
     int status = NCE_SDK_CONNECT_ERROR;
     int attempts = 1;
+    os_network_ops_t * osNetwork = ctx->osNetwork;
 
     if( osNetwork == NULL )
     {
@@ -142,8 +280,32 @@ static int _os_udp_connect( os_network_ops_t * osNetwork )
 
             do
             {
+                #ifdef NCE_SDK_DEADLINE
+                if( ( ctx->deadline != NULL ) && !nce_deadline_allows( ctx->deadline, 0u, NceOSClockUs() ) )
+                {
+                    NceOSLogError( "No time left to connect.\n" );
+                    status = NCE_SDK_DEADLINE_EXCEEDED;
+                    break;
+                }
+                #endif
+
                 NceOSLogInfo( "connect to osNetwork" );
-                status = osNetwork->nce_os_udp_connect( osNetwork->os_socket, NceOnboard );
+                NCE_METRICS_BEGIN( ctx->metrics, NCE_METRIC_NET_CONNECT );
+                NCE_TRACE_BEGIN( NCE_TRACE_CONNECT );
+                status = ( ctx->connectV2 != NULL ) ?
+                         ctx->connectV2( osNetwork->os_socket, ctx->onboardEndpoint ) :
+                         osNetwork->nce_os_udp_connect( osNetwork->os_socket, *ctx->onboardEndpoint );
+                NCE_TRACE_END( NCE_TRACE_CONNECT, status );
+                NCE_METRICS_END( ctx->metrics, NCE_METRIC_NET_CONNECT, status );
+
+                #ifdef NCE_SDK_DEADLINE
+                if( ctx->progress != NULL )
+                {
+                    ctx->progress->connected = ( status == 0 );
+                    ctx->progress->lastStatus = ( status == 0 ) ? NCE_SDK_SUCCESS : NCE_SDK_CONNECT_ERROR;
+                }
+                #endif
+
                 attempts++;
             } while( status != 0 && attempts < NCE_SDK_ATTEMPTS );
         }
@@ -155,21 +317,18 @@ static int _os_udp_connect( os_network_ops_t * osNetwork )
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Send CoAP GET request to 1NCE.
+ * @brief Build the CoAP GET request of the Device Authenticator.
  *
+ * @param[in] ctx: SDK context of the device, provides the message ID.
+ * @param[out] pBuffer: Buffer receiving the request.
+ * @param[in] bufferSize: allocated size for the buffer.
  *
- * @param[in] osNetwork: udp interface object.
- * @param[in] pBuffer: Buffer to be used by the interface.
- * @param[in] bufferSize: allocated size for the interface buffer.
- *
- * @return The amount of bytes received.
+ * @return The length of the request.
  */
-static int _os_coap_onboard( os_network_ops_t * osNetwork,
-                             void * pBuffer,
-                             size_t bufferSize )
+static size_t _build_onboard_request( nce_context_t * ctx,
+                                      char * pBuffer,
+                                      size_t bufferSize )
 {
-    int status = NCE_SDK_SEND_ERROR;
-
     /*  0x50 : 01 -> CoAP Version
      *          01 -> Non-Confirmable CoAP message
      *          0000 -> 0 Token length
@@ -189,17 +348,48 @@ static int _os_coap_onboard( os_network_ops_t * osNetwork,
     static const unsigned char uri_path_option[] = { 0x89 };
 
     /* Create Message ID */
-    uint16_t message_id = _getNextMessageID();
+    uint16_t message_id = _getNextMessageID( ctx );
     char message_id_str[ 2 ];
 
     memcpy( message_id_str, &message_id, 2 );
 
-
-    NceOSLogInfo( "Start 1NCE device onboarding.\n" );
     memset( pBuffer, '\0', bufferSize * sizeof( char ) );
     sprintf( pBuffer, "%.2s%.2s%.2s%s%.1sbootstrap", coap_header, message_id_str, uri_host_option, NceOnboard.host, uri_path_option );
+
+    return strlen( pBuffer );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send CoAP GET request to 1NCE.
+ *
+ *
+ * @param[in] ctx: SDK context of the device.
+ * @param[in] pBuffer: Buffer to be used by the interface.
+ * @param[in] bufferSize: allocated size for the interface buffer.
+ *
+ * @return The amount of bytes received, NCE_SDK_PARSING_ERROR if the
+ * response fills the buffer.
+ */
+static int _os_coap_onboard( nce_context_t * ctx,
+                             void * pBuffer,
+                             size_t bufferSize )
+{
+    int status = NCE_SDK_SEND_ERROR;
+    os_network_ops_t * osNetwork = ctx->osNetwork;
+    size_t requestLength;
+
+    NceOSLogInfo( "Start 1NCE device onboarding.\n" );
+    requestLength = _build_onboard_request( ctx, pBuffer, bufferSize );
     NceOSLogInfo( "Send Device Authenticator request.\n" );
-    status = osNetwork->nce_os_udp_send( osNetwork->os_socket, pBuffer, strlen( pBuffer ) );
+    NCE_METRICS_BEGIN( ctx->metrics, NCE_METRIC_NET_SEND );
+    NCE_TRACE_BEGIN( NCE_TRACE_SEND );
+    status = osNetwork->nce_os_udp_send( osNetwork->os_socket, pBuffer, requestLength );
+    NCE_TRACE_END( NCE_TRACE_SEND, status );
+    NCE_METRICS_BYTES( ctx->metrics, NCE_METRIC_NET_SEND, ( status > 0 ) ? ( size_t ) status : 0u, 0u );
+    NCE_METRICS_BYTES( ctx->metrics, NCE_METRIC_ONBOARD, ( status > 0 ) ? ( size_t ) status : 0u, 0u );
+    NCE_METRICS_END( ctx->metrics, NCE_METRIC_NET_SEND, status );
 
     if( status < 0 )
     {
@@ -208,47 +398,247 @@ static int _os_coap_onboard( os_network_ops_t * osNetwork,
     }
     else
     {
+        /* The last byte stays a terminator for the parser. */
         memset( pBuffer, '\0', bufferSize * sizeof( char ) );
-        status = osNetwork->nce_os_udp_recv( osNetwork->os_socket, pBuffer, bufferSize );
+        NCE_METRICS_BEGIN( ctx->metrics, NCE_METRIC_NET_RECV );
+        NCE_TRACE_BEGIN( NCE_TRACE_WAIT_RESPONSE );
+        status = osNetwork->nce_os_udp_recv( osNetwork->os_socket, pBuffer, bufferSize - 1 );
+        NCE_TRACE_END( NCE_TRACE_WAIT_RESPONSE, status );
+        NCE_METRICS_BYTES( ctx->metrics, NCE_METRIC_NET_RECV, 0u, ( status > 0 ) ? ( size_t ) status : 0u );
+        NCE_METRICS_BYTES( ctx->metrics, NCE_METRIC_ONBOARD, 0u, ( status > 0 ) ? ( size_t ) status : 0u );
+        NCE_METRICS_END( ctx->metrics, NCE_METRIC_NET_RECV, ( status > 0 ) ? NCE_SDK_SUCCESS : NCE_SDK_RECEIVE_ERROR );
 
         if( status < 0 )
         {
             NceOSLogError( "Failed to receive Device credential.\n" );
             status = NCE_SDK_RECEIVE_ERROR;
         }
+        else if( ( size_t ) status >= bufferSize - 1 )
+        {
+            /* The datagram may have been cut, its PSK would be unusable. */
+            NceOSLogError( "Device credential response exceeds %u bytes.\n", ( unsigned int ) ( bufferSize - 2 ) );
+            status = NCE_SDK_PARSING_ERROR;
+        }
     }
 
     return status;
 }
 
+/**
+ * @brief Close the onboarding connection.
+ *
+ * @param[in] ctx: SDK context of the device.
+ *
+ * @return The status of the disconnection.
+ */
+static int _os_udp_disconnect( nce_context_t * ctx )
+{
+    int status;
+
+    NCE_METRICS_BEGIN( ctx->metrics, NCE_METRIC_NET_DISCONNECT );
+    NCE_TRACE_BEGIN( NCE_TRACE_DISCONNECT );
+    status = ctx->osNetwork->nce_os_udp_disconnect( ctx->osNetwork->os_socket );
+    NCE_TRACE_END( NCE_TRACE_DISCONNECT, status );
+    NCE_METRICS_END( ctx->metrics, NCE_METRIC_NET_DISCONNECT, status );
+
+    return status;
+}
+
 /*-----------------------------------------------------------*/
 
-int os_auth( os_network_ops_t * osNetwork,
-             DtlsKey_t * nceKey )
+/**
+ * @brief Request the credentials until a response other than a CoAP error
+ * arrives. 4.xx responses end the attempts at once, 5.03 waits for its
+ * Max-Age, timeouts and other 5.xx back off (nce_retry.h). With
+ * NCE_SDK_RTO and an estimator in ctx->rto, each attempt waits the timeout
+ * estimated for the endpoint (nce_rto.h) and each response updates the
+ * estimate. Within a budget
+ * (ctx->deadline), an attempt only starts while enough of it is left and
+ * waits at most its share of it.
+ *
+ * @param[in] ctx: SDK context of the device.
+ * @param[out] packet: Buffer receiving the response.
+ * @param[in] packetSize: Size of the buffer.
+ *
+ * @return The length of the response, or the error of the last attempt.
+ */
+static int _os_onboard_attempts( nce_context_t * ctx,
+                                 char * packet,
+                                 size_t packetSize )
+{
+    nce_retry_decision_t decision;
+    unsigned int attempt = 1;
+    int received;
+
+    #ifdef NCE_SDK_RTO
+    unsigned int transmissions = 0;
+    uint32_t firstUs = 0;
+    #endif
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+    uint32_t timeoutMs;
+    uint32_t nowUs;
+    #endif
+
+    for( ; ; )
+    {
+        #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+        nowUs = NceOSClockUs();
+        timeoutMs = NCE_DEADLINE_NO_TIMEOUT;
+        #endif
+
+        #ifdef NCE_SDK_DEADLINE
+        if( ctx->deadline != NULL )
+        {
+            if( !nce_deadline_allows( ctx->deadline, 0u, nowUs ) )
+            {
+                NceOSLogError( "No time left for onboarding attempt %u.\n", attempt );
+                return NCE_SDK_DEADLINE_EXCEEDED;
+            }
+
+            if( ctx->progress != NULL )
+            {
+                ctx->progress->attempts++;
+            }
+        }
+        #endif
+
+        #ifdef NCE_SDK_RTO
+        if( ctx->rto != NULL )
+        {
+            /* Requests sent since the last response form one exchange. */
+            if( transmissions++ == 0u )
+            {
+                firstUs = nowUs;
+            }
+
+            timeoutMs = nce_rto_timeout_ms( ctx->rto, ctx->onboardEndpoint, transmissions, nowUs );
+        }
+        #endif
+
+        #ifdef NCE_SDK_DEADLINE
+        if( ctx->deadline != NULL )
+        {
+            timeoutMs = nce_deadline_share_ms( ctx->deadline, timeoutMs, NCE_SDK_ATTEMPTS - attempt, nowUs );
+        }
+        #endif
+
+        #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+        if( ( ctx->setRecvTimeout != NULL ) && ( timeoutMs != NCE_DEADLINE_NO_TIMEOUT ) )
+        {
+            ( void ) ctx->setRecvTimeout( ctx->osNetwork->os_socket, timeoutMs );
+        }
+        #endif
+
+        received = _os_coap_onboard( ctx, packet, packetSize );
+
+        /* The same response would not fit on a retry either. */
+        if( received == NCE_SDK_PARSING_ERROR )
+        {
+            return received;
+        }
+
+        #ifdef NCE_SDK_RTO
+        if( ( received > 0 ) && ( ctx->rto != NULL ) )
+        {
+            nowUs = NceOSClockUs();
+            nce_rto_report( ctx->rto, ctx->onboardEndpoint, nowUs - firstUs, transmissions, nowUs );
+            transmissions = 0;
+        }
+        #endif
+
+        ( void ) nce_retry_classify( packet, received, attempt, &decision );
+
+        #ifdef NCE_SDK_DEADLINE
+        if( ctx->progress != NULL )
+        {
+            ctx->progress->lastStatus = decision.status;
+        }
+        #endif
+
+        if( decision.action == NCE_RETRY_DONE )
+        {
+            return received;
+        }
+
+        NceOSLogError( "Onboarding attempt %u failed: %d (CoAP %u.%02u).\n", attempt, decision.status,
+                       ( unsigned int ) ( decision.code >> 5 ), ( unsigned int ) ( decision.code & 0x1Fu ) );
+
+        if( ( decision.action == NCE_RETRY_FAIL ) || ( ++attempt >= NCE_SDK_ATTEMPTS ) )
+        {
+            break;
+        }
+
+        #ifdef NCE_SDK_RTO
+        /* A timeout has already waited the estimated timeout, errors back off.
+         * Ports reporting a timeout as an error are told apart by the wait. */
+        if( ( ctx->rto != NULL ) && ( ctx->setRecvTimeout != NULL ) &&
+            ( ( received == 0 ) || ( NceOSClockUs() - nowUs >= timeoutMs * 1000u ) ) )
+        {
+            continue;
+        }
+        #endif
+
+        #ifdef NCE_SDK_DEADLINE
+        /* A wait ending past the budget would only delay the failure. */
+        if( ( ctx->deadline != NULL ) && !nce_deadline_allows( ctx->deadline, decision.waitMs, NceOSClockUs() ) )
+        {
+            NceOSLogError( "No time left to wait %u ms for the next attempt.\n", ( unsigned int ) decision.waitMs );
+            return NCE_SDK_DEADLINE_EXCEEDED;
+        }
+        #endif
+
+        if( ctx->delayMs != NULL )
+        {
+            ctx->delayMs( decision.waitMs );
+        }
+    }
+
+    return ( received < 0 ) ? received : decision.status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Onboard the device of the context: connect, request the
+ * credentials until a response arrives, parse them and disconnect.
+ *
+ * @param[in] ctx: SDK context of the device.
+ * @param[in] packet: Buffer for the request and the response.
+ * @param[in] packetSize: Size of the buffer.
+ * @param[in] parse: Parser storing the credentials in nceKey.
+ * @param[in] nceKey: new DTLS credential required.
+ *
+ * @return The status of the onboarding.
+ */
+static int _os_auth( nce_context_t * ctx,
+                     char * packet,
+                     size_t packetSize,
+                     int ( * parse )( char * packet, void * key ),
+                     void * nceKey )
 {
     int status = NCE_SDK_CONNECT_ERROR;
-    int attempts = 1;
-    char packet[ 150 ];
 
-    status = _os_udp_connect( osNetwork );
+    status = _os_udp_connect( ctx );
 
     if( status < 0 )
     {
         NceOSLogError( "Failed to Connect to 1NCE Endpoint\n" );
         return status;
     }
-    else
+
+    status = _os_onboard_attempts( ctx, packet, packetSize );
+
+    if( status < 0 )
     {
-        do
-        {
-            status = _os_coap_onboard( osNetwork, packet, sizeof( packet ) );
-            attempts++;
-        } while( status <= 0 && attempts < NCE_SDK_ATTEMPTS );
+        NceOSLogError( "No usable response from 1NCE Endpoint.\n" );
+        _os_udp_disconnect( ctx );
+        return status;
     }
-
-    if( status > 0 )
+    else
     {
-        status = _get_psk( packet, nceKey );
+        NCE_TRACE_BEGIN( NCE_TRACE_PARSE );
+        status = parse( packet, nceKey );
+        NCE_TRACE_END( NCE_TRACE_PARSE, status );
 
         if( status < 0 )
         {
@@ -257,7 +647,7 @@ int os_auth( os_network_ops_t * osNetwork,
         }
     }
 
-    status = osNetwork->nce_os_udp_disconnect( osNetwork->os_socket );
+    status = _os_udp_disconnect( ctx );
 
     if( status < 0 )
     {
@@ -268,12 +658,172 @@ int os_auth( os_network_ops_t * osNetwork,
     return status;
 }
 
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Onboarding wrapped in its metric and trace span.
+ */
+static int _os_auth_op( nce_context_t * ctx,
+                        char * packet,
+                        size_t packetSize,
+                        int ( * parse )( char * packet, void * key ),
+                        void * nceKey )
+{
+    int status;
+
+    NCE_METRICS_BEGIN( ctx->metrics, NCE_METRIC_ONBOARD );
+    NCE_TRACE_OP_BEGIN( NCE_TRACE_ONBOARD );
+    status = _os_auth( ctx, packet, packetSize, parse, nceKey );
+    NCE_TRACE_OP_END( NCE_TRACE_ONBOARD, status );
+    NCE_METRICS_END( ctx->metrics, NCE_METRIC_ONBOARD, status );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void os_context_init( nce_context_t * ctx,
+                      os_network_ops_t * osNetwork )
+{
+    ctx->osNetwork = osNetwork;
+    ctx->connectV2 = NULL;
+    ctx->onboardEndpoint = &NceOnboard;
+    ctx->messageId = NCE_SDK_INITIAL_MESSAGE_ID;
+    ctx->delayMs = NCE_SDK_DEFAULT_DELAY;
+    #ifdef NCE_SDK_METRICS
+    ctx->metrics = NULL;
+    #endif
+    #ifdef NCE_SDK_RTO
+    ctx->rto = NULL;
+    #endif
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+    ctx->setRecvTimeout = NULL;
+    #endif
+    #ifdef NCE_SDK_DEADLINE
+    ctx->deadline = NULL;
+    ctx->progress = NULL;
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+void os_context_init_v2( nce_context_t * ctx,
+                         os_network_ops_v2_t * osNetwork )
+{
+    os_context_init( ctx, &osNetwork->base );
+    ctx->connectV2 = osNetwork->nce_os_udp_connect_v2;
+}
+
+/*-----------------------------------------------------------*/
+
+int os_auth_ctx( nce_context_t * ctx,
+                 DtlsKey_t * nceKey )
+{
+    char packet[ 150 ];
+
+    return _os_auth_op( ctx, packet, sizeof( packet ), _get_psk, nceKey );
+}
+
+/*-----------------------------------------------------------*/
+
+int os_auth_v2( nce_context_t * ctx,
+                nce_dtls_key_t * nceKey,
+                void * workspace,
+                size_t workspaceSize )
+{
+    if( ( workspace == NULL ) || ( workspaceSize < NCE_SDK_AUTH_WORKSPACE_MIN ) )
+    {
+        NceOSLogError( "Workspace of %u bytes, %u needed.\n", ( unsigned int ) workspaceSize,
+                       ( unsigned int ) NCE_SDK_AUTH_WORKSPACE_MIN );
+        return NCE_SDK_WORKSPACE_ERROR;
+    }
+
+    return _os_auth_op( ctx, ( char * ) workspace, workspaceSize, _get_psk_v2, nceKey );
+}
+
+/*-----------------------------------------------------------*/
+
+#ifdef NCE_SDK_DEADLINE
+
+int os_auth_deadline( nce_context_t * ctx,
+                      nce_dtls_key_t * nceKey,
+                      void * workspace,
+                      size_t workspaceSize,
+                      uint32_t budgetMs,
+                      nce_progress_t * progress )
+{
+    nce_deadline_t deadline;
+    int status;
+
+    nce_deadline_start( &deadline, budgetMs, NceOSClockUs() );
+
+    if( progress != NULL )
+    {
+        memset( progress, 0, sizeof( *progress ) );
+        progress->lastStatus = NCE_SDK_DEADLINE_EXCEEDED;
+    }
+
+    ctx->deadline = &deadline;
+    ctx->progress = progress;
+    status = os_auth_v2( ctx, nceKey, workspace, workspaceSize );
+    ctx->deadline = NULL;
+    ctx->progress = NULL;
+
+    if( progress != NULL )
+    {
+        progress->elapsedMs = nce_deadline_elapsed_ms( &deadline, NceOSClockUs() );
+    }
+
+    return status;
+}
+#endif /* ifdef NCE_SDK_DEADLINE */
+
+/*-----------------------------------------------------------*/
+
+int os_auth( os_network_ops_t * osNetwork,
+             DtlsKey_t * nceKey )
+{
+    defaultContext.osNetwork = osNetwork;
+
+    return os_auth_ctx( &defaultContext, nceKey );
+}
+
 #endif /* ifdef NCE_DEVICE_AUTHENTICATOR */
 
 /*-----------------------------------------------------------*/
 
 #ifdef NCE_ENERGY_SAVER
 
+/**
+ * @brief Check that a value fits the template length of its element, for
+ * os_energy_save_v2(): integers must fit the signed range of their template
+ * length. os_energy_save() keeps its original one-byte check.
+ *
+ * @param[in] e: Element to check.
+ *
+ * @return true if the value can be translated.
+ */
+static bool _energy_element_valid( const Element2byte_gen_t * e )
+{
+    long limit = 128;
+
+    if( ( e->type == E_INTEGER ) && ( e->template_length > 1 ) && ( e->template_length < ( int ) sizeof( e->value.i ) ) )
+    {
+        limit = 1L << ( 8 * e->template_length - 1 );
+    }
+
+    if( ( e->type == E_INTEGER ) && ( e->template_length < ( int ) sizeof( e->value.i ) ) &&
+        ( ( e->value.i < -limit ) || ( e->value.i >= limit ) ) )
+    {
+        NceOSLogError( "Conversion Error, Check template length.\n" );
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
 int os_energy_save( char * packet,
                     int selector,
                     int num_args,
@@ -294,6 +844,7 @@ int os_energy_save( char * packet,
         if( ( e.type == E_INTEGER ) && ( e.value.i != *( e.value.bytes ) ) )
         {
             NceOSLogError( "Conversion Error, Check template length.\n" );
+            va_end( ap );
             return NCE_SDK_BINARY_PAYLOAD_ERROR;
         }
 
@@ -313,4 +864,42 @@ int os_energy_save( char * packet,
     return location;
 }
 
+/*-----------------------------------------------------------*/
+
+int os_energy_save_v2( uint8_t * packet,
+                       size_t packetSize,
+                       uint8_t selector,
+                       const Element2byte_gen_t * elements,
+                       size_t count )
+{
+    size_t location = 1;
+    size_t length;
+    size_t i;
+
+    if( ( count == 0 ) || ( packetSize < 1 ) )
+    {
+        NceOSLogError( "Conversion Error.\n" );
+        return NCE_SDK_BINARY_PAYLOAD_ERROR;
+    }
+
+    packet[ 0 ] = selector;
+
+    for( i = 0; i < count; i++ )
+    {
+        length = ( size_t ) elements[ i ].template_length;
+
+        if( ( elements[ i ].template_length < 0 ) || ( length > sizeof( elements[ i ].value.bytes ) ) ||
+            ( length > packetSize - location ) || !_energy_element_valid( &elements[ i ] ) )
+        {
+            NceOSLogError( "Conversion Error, element %u does not fit.\n", ( unsigned int ) i );
+            return NCE_SDK_BINARY_PAYLOAD_ERROR;
+        }
+
+        memcpy( packet + location, elements[ i ].value.bytes, length );
+        location += length;
+    }
+
+    return ( int ) location;
+}
+
 #endif /* ifdef NCE_ENERGY_SAVER */
@@ -0,0 +1,244 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_log_tokenized.c
+ * @brief Implements the tokenized logging functions in nce_log_tokenized.h.
+ */
+
+#include <string.h>
+#include "nce_log_tokenized.h"
+
+#ifdef NCE_SDK_LOG_TOKENIZED
+
+/**
+ * @brief Ring of published records. A record starts with its length, which
+ * is written last: a zero length marks a record still being written.
+ * Consumed bytes are zeroed again before the tail moves.
+ */
+static uint8_t logRing[ NCE_SDK_LOG_BUFFER_SIZE ];
+
+/**
+ * @brief Free-running reserve index of the producers.
+ */
+static uint32_t logHead;
+
+/**
+ * @brief Free-running read index of the consumer.
+ */
+static uint32_t logTail;
+
+/**
+ * @brief Records dropped because the ring was full.
+ */
+static uint32_t logDropped;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append bytes to a record, flagging it as truncated if they do not fit.
+ *
+ * @param[in] record: Record being encoded.
+ * @param[in] bytes: Bytes to append.
+ * @param[in] length: Number of bytes.
+ */
+static void _put( nce_log_record_t * record,
+                  const uint8_t * bytes,
+                  size_t length )
+{
+    /* Once an argument is cut, the following ones are dropped too. */
+    if( ( ( record->data[ 1 ] & NCE_LOG_TRUNCATED ) != 0 ) ||
+        ( record->length + length > NCE_LOG_MAX_RECORD ) )
+    {
+        record->data[ 1 ] |= NCE_LOG_TRUNCATED;
+    }
+    else
+    {
+        memcpy( &record->data[ record->length ], bytes, length );
+        record->length += length;
+    }
+}
+
+/**
+ * @brief Append a tag and an unsigned LEB128 value.
+ *
+ * @param[in] record: Record being encoded.
+ * @param[in] tag: Argument tag, 0 for none.
+ * @param[in] value: Value to encode.
+ */
+static void _put_varint( nce_log_record_t * record,
+                         uint8_t tag,
+                         uintptr_t value )
+{
+    uint8_t bytes[ 1 + ( ( sizeof( value ) * 8 ) + 6 ) / 7 ];
+    size_t length = 0;
+
+    if( tag != 0 )
+    {
+        bytes[ length++ ] = tag;
+    }
+
+    while( value >= 0x80 )
+    {
+        bytes[ length++ ] = ( uint8_t ) ( value | 0x80 );
+        value >>= 7;
+    }
+
+    bytes[ length++ ] = ( uint8_t ) value;
+    _put( record, bytes, length );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_log_begin( nce_log_record_t * record,
+                    int level,
+                    const char * format )
+{
+    record->data[ 0 ] = 0;
+    record->data[ 1 ] = ( uint8_t ) level;
+    record->length = 2;
+    _put_varint( record, 0, ( uintptr_t ) format );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_log_put_int( nce_log_record_t * record,
+                      long value )
+{
+    /* Zigzag keeps small negative values short. */
+    unsigned long zigzag = ( ( unsigned long ) value << 1 ) ^ ( unsigned long ) ( value < 0 ? -1L : 0L );
+
+    _put_varint( record, NCE_LOG_ARG_INT, ( uintptr_t ) zigzag );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_log_put_double( nce_log_record_t * record,
+                         double value )
+{
+    uint8_t bytes[ 1 + sizeof( double ) ];
+
+    bytes[ 0 ] = NCE_LOG_ARG_DOUBLE;
+    memcpy( &bytes[ 1 ], &value, sizeof( double ) );
+    _put( record, bytes, sizeof( bytes ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_log_put_string( nce_log_record_t * record,
+                         const char * value )
+{
+    uint8_t bytes[ 2 + NCE_LOG_MAX_STRING ];
+    size_t length = 0;
+
+    if( value == NULL )
+    {
+        value = "(null)";
+    }
+
+    while( ( length < NCE_LOG_MAX_STRING ) && ( value[ length ] != '\0' ) )
+    {
+        length++;
+    }
+
+    bytes[ 0 ] = NCE_LOG_ARG_STRING;
+    bytes[ 1 ] = ( uint8_t ) length;
+    memcpy( &bytes[ 2 ], value, length );
+    _put( record, bytes, length + 2 );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_log_put_pointer( nce_log_record_t * record,
+                          const void * value )
+{
+    _put_varint( record, NCE_LOG_ARG_POINTER, ( uintptr_t ) value );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_log_commit( nce_log_record_t * record )
+{
+    uint32_t length = ( uint32_t ) record->length;
+    uint32_t head = __atomic_load_n( &logHead, __ATOMIC_RELAXED );
+    size_t i;
+
+    do
+    {
+        if( head + length - __atomic_load_n( &logTail, __ATOMIC_ACQUIRE ) > NCE_SDK_LOG_BUFFER_SIZE )
+        {
+            __atomic_fetch_add( &logDropped, 1, __ATOMIC_RELAXED );
+            return;
+        }
+    } while( !__atomic_compare_exchange_n( &logHead, &head, head + length, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) );
+
+    for( i = 1; i < length; i++ )
+    {
+        logRing[ ( head + i ) & ( NCE_SDK_LOG_BUFFER_SIZE - 1 ) ] = record->data[ i ];
+    }
+
+    /* Publishing the length hands the record over to the consumer. */
+    __atomic_store_n( &logRing[ head & ( NCE_SDK_LOG_BUFFER_SIZE - 1 ) ], ( uint8_t ) length, __ATOMIC_RELEASE );
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_log_drain( uint8_t * buffer,
+                      size_t size )
+{
+    uint32_t tail = __atomic_load_n( &logTail, __ATOMIC_RELAXED );
+    size_t copied = 0;
+    uint32_t i;
+    uint8_t length;
+
+    while( tail != __atomic_load_n( &logHead, __ATOMIC_ACQUIRE ) )
+    {
+        length = __atomic_load_n( &logRing[ tail & ( NCE_SDK_LOG_BUFFER_SIZE - 1 ) ], __ATOMIC_ACQUIRE );
+
+        if( ( length == 0 ) || ( copied + length > size ) )
+        {
+            break;
+        }
+
+        for( i = 0; i < length; i++ )
+        {
+            buffer[ copied++ ] = logRing[ ( tail + i ) & ( NCE_SDK_LOG_BUFFER_SIZE - 1 ) ];
+            logRing[ ( tail + i ) & ( NCE_SDK_LOG_BUFFER_SIZE - 1 ) ] = 0;
+        }
+
+        tail += length;
+        __atomic_store_n( &logTail, tail, __ATOMIC_RELEASE );
+    }
+
+    return copied;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_log_dropped( void )
+{
+    return __atomic_load_n( &logDropped, __ATOMIC_RELAXED );
+}
+
+#endif /* ifdef NCE_SDK_LOG_TOKENIZED */
@@ -0,0 +1,566 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_memfault.c
+ * @brief Implements the Memfault chunk uploader in nce_memfault.h.
+ */
+
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_MEMFAULT
+
+#include <string.h>
+#include "nce_memfault.h"
+#include "nce_coap_option.h"
+
+#ifdef ARDUINO
+    #include "interface/log_interface.h"
+    #include "interface/clock_interface.h"
+#else
+    #include "log_interface.h"
+    #include "clock_interface.h"
+#endif /* ifdef ARDUINO */
+
+#ifdef NCE_SDK_MEMFAULT
+
+    #ifdef __ZEPHYR__
+LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
+    #endif
+
+/**
+ * @brief CoAP header of a confirmable POST without token, and of its
+ * piggybacked response.
+ */
+    #define COAP_CON_NO_TOKEN              0x40u
+    #define COAP_ACK                       0x60u
+    #define COAP_TYPE_MASK                 0xF0u
+    #define COAP_TOKEN_LENGTH_MASK         0x0Fu
+    #define COAP_POST                      0x02u
+    #define COAP_SUCCESS_CLASS             2u
+    #define COAP_HEADER_SIZE               4u
+
+/**
+ * @brief Options of the requests: Content-Format application/octet-stream,
+ * then Proxy-Uri.
+ */
+    #define COAP_OPTION_CONTENT_FORMAT     12u
+    #define COAP_OPTION_PROXY_URI          35u
+    #define COAP_FORMAT_OCTET_STREAM       42u
+    #define COAP_PAYLOAD_MARKER            0xFFu
+
+/**
+ * @brief Datagrams of another exchange skipped while waiting for a response.
+ */
+    #define MEMFAULT_STALE_RESPONSES       4
+
+    #ifdef NceOSDelayMs
+
+/**
+ * @brief Wait of the OS between upload attempts.
+ *
+ * @param[in] ms: Milliseconds to wait.
+ */
+static void _os_delay_ms( uint32_t ms )
+{
+    NceOSDelayMs( ms );
+}
+
+        #define MEMFAULT_DEFAULT_DELAY    _os_delay_ms
+    #else
+        #define MEMFAULT_DEFAULT_DELAY    NULL
+    #endif /* ifdef NceOSDelayMs */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the header and options of the next request, up to the
+ * payload marker.
+ *
+ * @return Length written, 0 if the Proxy-Uri leaves no room for a payload.
+ */
+static size_t _build_request_head( nce_memfault_uploader_t * uploader )
+{
+    static const uint8_t format = COAP_FORMAT_OCTET_STREAM;
+    uint8_t * request = uploader->request;
+    size_t size = sizeof( uploader->request );
+    size_t length;
+
+    uploader->messageId++;
+    request[ 0 ] = COAP_CON_NO_TOKEN;
+    request[ 1 ] = COAP_POST;
+    request[ 2 ] = ( uint8_t ) ( uploader->messageId >> 8 );
+    request[ 3 ] = ( uint8_t ) uploader->messageId;
+
+    length = nce_coap_option_append( request, COAP_HEADER_SIZE, size, COAP_OPTION_CONTENT_FORMAT, &format, 1 );
+
+    if( length != 0u )
+    {
+        length = nce_coap_option_append( request, length, size, COAP_OPTION_PROXY_URI - COAP_OPTION_CONTENT_FORMAT,
+                                         uploader->proxyUri, strlen( uploader->proxyUri ) );
+    }
+
+    /* The marker and at least one byte of payload. */
+    if( ( length == 0u ) || ( length + 2u > size ) )
+    {
+        return 0;
+    }
+
+    request[ length ] = COAP_PAYLOAD_MARKER;
+
+    return length + 1u;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take the next chunk from the source, as large as the path to the
+ * proxy currently carries and the request buffer holds.
+ *
+ * @param[in] uploader: Uploader.
+ * @param[in] room: Room for the payload in the request buffer.
+ *
+ * @return Length of the chunk, 0 when the source is empty.
+ */
+static size_t _take_chunk( nce_memfault_uploader_t * uploader,
+                           size_t room )
+{
+    size_t length = nce_chunk_size_get( &uploader->chunkSizes, uploader->proxy );
+
+    length = ( length < room ) ? length : room;
+
+    if( !uploader->source.getChunk( uploader->source.arg, uploader->chunk, &length ) )
+    {
+        return 0;
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait for the response to the last request, skipping datagrams of
+ * other exchanges.
+ *
+ * @return Length of the response, 0 on timeout, negative on error.
+ */
+static int _receive_response( nce_memfault_uploader_t * uploader )
+{
+    os_network_ops_t * osNetwork = uploader->osNetwork;
+    const uint8_t * response = uploader->response;
+    int received;
+    int skipped;
+
+    for( skipped = 0; skipped < MEMFAULT_STALE_RESPONSES; skipped++ )
+    {
+        received = osNetwork->nce_os_udp_recv( osNetwork->os_socket, uploader->response, sizeof( uploader->response ) );
+
+        if( ( received <= 0 ) ||
+            ( ( received >= ( int ) COAP_HEADER_SIZE ) && ( ( response[ 0 ] & COAP_TYPE_MASK ) == COAP_ACK ) &&
+              ( response[ 2 ] == ( uint8_t ) ( uploader->messageId >> 8 ) ) &&
+              ( response[ 3 ] == ( uint8_t ) uploader->messageId ) ) )
+        {
+            return received;
+        }
+
+        NceOSLogDebug( "[DBG] Skipped a datagram of another exchange\n" );
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Post one chunk and wait for its response.
+ *
+ * @param[in] uploader: Uploader.
+ * @param[in] headLength: Length of the request up to the payload marker.
+ * @param[in] chunkLength: Length of the chunk.
+ * @param[in] attempt: Number of the upload attempt, from 1.
+ * @param[in] transmission: Transmissions of this chunk so far, including this one.
+ *
+ * @return NCE_SDK_SUCCESS once the proxy accepted the chunk, or the error.
+ */
+static int _post_chunk( nce_memfault_uploader_t * uploader,
+                        size_t headLength,
+                        size_t chunkLength,
+                        unsigned int attempt,
+                        unsigned int transmission )
+{
+    os_network_ops_t * osNetwork = uploader->osNetwork;
+    int status;
+    int received;
+
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+    uint32_t sentUs = NceOSClockUs();
+    uint32_t timeoutMs = NCE_DEADLINE_NO_TIMEOUT;
+    #endif
+    #ifdef NCE_SDK_RTO
+    uint32_t nowUs;
+
+    if( uploader->rto != NULL )
+    {
+        timeoutMs = nce_rto_timeout_ms( uploader->rto, uploader->proxy, transmission, sentUs );
+    }
+    #else
+    ( void ) transmission;
+    #endif
+
+    #ifdef NCE_SDK_DEADLINE
+    if( uploader->deadline != NULL )
+    {
+        timeoutMs = nce_deadline_share_ms( uploader->deadline, timeoutMs, NCE_SDK_MEMFAULT_ATTEMPTS + 1u - attempt, sentUs );
+    }
+    #endif
+
+    #if defined( NCE_SDK_RTO ) || defined( NCE_SDK_DEADLINE )
+    if( ( uploader->setRecvTimeout != NULL ) && ( timeoutMs != NCE_DEADLINE_NO_TIMEOUT ) )
+    {
+        ( void ) uploader->setRecvTimeout( osNetwork->os_socket, timeoutMs );
+    }
+    #endif
+
+    memcpy( &uploader->request[ headLength ], uploader->chunk, chunkLength );
+
+    NCE_TRACE_BEGIN( NCE_TRACE_SEND );
+    status = osNetwork->nce_os_udp_send( osNetwork->os_socket, uploader->request, headLength + chunkLength );
+    NCE_TRACE_END( NCE_TRACE_SEND, status );
+
+    if( status < 0 )
+    {
+        NceOSLogError( "[ERR] Unable to send CoAP packet, error %d\n", status );
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    NceOSLogInfo( "[INF] Sent %u bytes\n", ( unsigned int ) chunkLength );
+    NCE_METRICS_BYTES( uploader->metrics, NCE_METRIC_MEMFAULT_UPLOAD, headLength + chunkLength, 0 );
+
+    NCE_TRACE_BEGIN( NCE_TRACE_WAIT_RESPONSE );
+    received = _receive_response( uploader );
+    NCE_TRACE_END( NCE_TRACE_WAIT_RESPONSE, received );
+
+    if( received <= 0 )
+    {
+        nce_chunk_size_report( &uploader->chunkSizes, uploader->proxy, chunkLength, 0 );
+        NceOSLogError( "[ERR] Unable to get CoAP response, error %d\n", received );
+        return NCE_SDK_RECEIVE_ERROR;
+    }
+
+    NCE_METRICS_BYTES( uploader->metrics, NCE_METRIC_MEMFAULT_UPLOAD, 0, ( size_t ) received );
+
+    #ifdef NCE_SDK_RTO
+    if( uploader->rto != NULL )
+    {
+        nowUs = NceOSClockUs();
+        nce_rto_report( uploader->rto, uploader->proxy, nowUs - sentUs, 1u, nowUs );
+    }
+    #endif
+
+    NceOSLogInfo( "[INF] Response Code: %u.%02u\n", ( unsigned int ) ( uploader->response[ 1 ] >> 5 ),
+                  ( unsigned int ) ( uploader->response[ 1 ] & 0x1Fu ) );
+
+    if( ( uploader->response[ 1 ] >> 5 ) != COAP_SUCCESS_CLASS )
+    {
+        NceOSLogError( "[ERR] Server did not accept the packet (non-success response).\n" );
+        status = nce_retry_classify( uploader->response, received, attempt, &uploader->retry );
+
+        if( uploader->retry.action == NCE_RETRY_DONE )
+        {
+            /* Neither 2.xx nor an error class: not worth a retry. */
+            uploader->retry.action = NCE_RETRY_FAIL;
+            status = NCE_SDK_SERVER_RESPONSE_ERROR;
+        }
+
+        return status;
+    }
+
+    nce_chunk_size_report( &uploader->chunkSizes, uploader->proxy, chunkLength, 1 );
+    uploader->chunks++;
+    uploader->bytes += chunkLength;
+
+    #ifdef NCE_SDK_DEADLINE
+    if( uploader->progress != NULL )
+    {
+        uploader->progress->chunks++;
+        uploader->progress->bytes += chunkLength;
+    }
+    #endif
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_memfault_init( nce_memfault_uploader_t * uploader,
+                        os_network_ops_t * osNetwork,
+                        const OSEndPoint_t * proxy,
+                        const nce_memfault_source_t * source )
+{
+    memset( uploader, 0, sizeof( *uploader ) );
+    uploader->osNetwork = osNetwork;
+    uploader->proxy = proxy;
+    uploader->proxyUri = NCE_SDK_MEMFAULT_PROXY_URI;
+    uploader->source = *source;
+    uploader->delayMs = MEMFAULT_DEFAULT_DELAY;
+    /* Message IDs must not repeat those of an upload before a reset, which the proxy may still deduplicate. */
+    uploader->messageId = ( uint16_t ) NceOSClockUs();
+    #ifdef NCE_SDK_METRICS
+    uploader->metrics = NULL;
+    #endif
+    nce_chunk_size_init( &uploader->chunkSizes, NCE_SDK_MEMFAULT_CHUNK_MIN, NCE_SDK_MEMFAULT_BUFFER_SIZE,
+                         NCE_SDK_MEMFAULT_CHUNK_INITIAL );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_memfault_upload_attempt( nce_memfault_uploader_t * uploader,
+                                 unsigned int attempt )
+{
+    os_network_ops_t * osNetwork = uploader->osNetwork;
+    unsigned int transmission = attempt;
+    size_t headLength;
+    size_t chunkLength;
+    int status;
+
+    /* Failures without a proxy response are retried with the backoff. */
+    ( void ) nce_retry_classify( NULL, -1, attempt, &uploader->retry );
+
+    headLength = _build_request_head( uploader );
+
+    if( headLength == 0u )
+    {
+        NceOSLogError( "[ERR] Proxy URI too long for the request buffer\n" );
+        uploader->retry.action = NCE_RETRY_FAIL;
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    #ifdef NCE_SDK_DEADLINE
+    if( ( uploader->deadline != NULL ) && !nce_deadline_allows( uploader->deadline, 0u, NceOSClockUs() ) )
+    {
+        NceOSLogError( "[ERR] No time left for upload attempt %u\n", attempt );
+        return NCE_SDK_DEADLINE_EXCEEDED;
+    }
+    #endif
+
+    chunkLength = _take_chunk( uploader, sizeof( uploader->request ) - headLength );
+
+    if( chunkLength == 0u )
+    {
+        NceOSLogInfo( "[INF] There is no data to be sent\n" );
+        return NCE_SDK_SUCCESS;
+    }
+
+    #ifdef NCE_SDK_DEADLINE
+    if( uploader->progress != NULL )
+    {
+        uploader->progress->attempts++;
+    }
+    #endif
+
+    NCE_METRICS_BEGIN( uploader->metrics, NCE_METRIC_MEMFAULT_UPLOAD );
+    NCE_TRACE_OP_BEGIN( NCE_TRACE_MEMFAULT_UPLOAD );
+
+    NCE_TRACE_BEGIN( NCE_TRACE_CONNECT );
+    status = osNetwork->nce_os_udp_connect( osNetwork->os_socket, *uploader->proxy );
+    NCE_TRACE_END( NCE_TRACE_CONNECT, status );
+
+    if( status != 0 )
+    {
+        NceOSLogError( "[ERR] Failed to connect to CoAP server, Host: %s, Port: %d\n", uploader->proxy->host,
+                       uploader->proxy->port );
+    }
+    else
+    {
+        NceOSLogInfo( "[INF] Connected to CoAP server, Host: %s, Port: %d\n", uploader->proxy->host, uploader->proxy->port );
+
+        #ifdef NCE_SDK_DEADLINE
+        if( uploader->progress != NULL )
+        {
+            uploader->progress->connected = true;
+        }
+        #endif
+
+        for( ; ; )
+        {
+            /* One span per chunk. */
+            NCE_TRACE_BEGIN( NCE_TRACE_MEMFAULT_CHUNK );
+            status = _post_chunk( uploader, headLength, chunkLength, attempt, transmission );
+            NCE_TRACE_END( NCE_TRACE_MEMFAULT_CHUNK, status );
+
+            if( status != NCE_SDK_SUCCESS )
+            {
+                break;
+            }
+
+            transmission = 1u;
+
+            #ifdef NCE_SDK_DEADLINE
+            /* Between two chunks the source can stop and carry on next time. */
+            if( ( uploader->deadline != NULL ) && !nce_deadline_allows( uploader->deadline, 0u, NceOSClockUs() ) )
+            {
+                NceOSLogError( "[ERR] No time left for the next chunk\n" );
+                status = NCE_SDK_DEADLINE_EXCEEDED;
+                break;
+            }
+            #endif
+
+            headLength = _build_request_head( uploader );
+            chunkLength = _take_chunk( uploader, sizeof( uploader->request ) - headLength );
+
+            if( chunkLength == 0u )
+            {
+                NceOSLogInfo( "[INF] No more chunks to send\n" );
+                break;
+            }
+        }
+
+        NCE_TRACE_BEGIN( NCE_TRACE_DISCONNECT );
+        ( void ) osNetwork->nce_os_udp_disconnect( osNetwork->os_socket );
+        NCE_TRACE_END( NCE_TRACE_DISCONNECT, 0 );
+    }
+
+    /* A message must not reach Memfault with a chunk missing: start it over. */
+    if( ( status != NCE_SDK_SUCCESS ) && ( status != NCE_SDK_DEADLINE_EXCEEDED ) && ( uploader->source.abort != NULL ) )
+    {
+        uploader->source.abort( uploader->source.arg );
+    }
+
+    NCE_TRACE_OP_END( NCE_TRACE_MEMFAULT_UPLOAD, status );
+    NCE_METRICS_END( uploader->metrics, NCE_METRIC_MEMFAULT_UPLOAD, status );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_memfault_upload( nce_memfault_uploader_t * uploader )
+{
+    unsigned int attempt;
+    uint32_t delayMs;
+    int status = NCE_SDK_SUCCESS;
+
+    for( attempt = 1; attempt <= NCE_SDK_MEMFAULT_ATTEMPTS; attempt++ )
+    {
+        status = nce_memfault_upload_attempt( uploader, attempt );
+
+        #ifdef NCE_SDK_DEADLINE
+        if( ( uploader->progress != NULL ) && ( status != NCE_SDK_DEADLINE_EXCEEDED ) )
+        {
+            uploader->progress->lastStatus = status;
+        }
+        #endif
+
+        if( status == NCE_SDK_SUCCESS )
+        {
+            return status;
+        }
+
+        NceOSLogError( "[ERR] Failed to send Memfault data, err %d\n", status );
+
+        if( status == NCE_SDK_DEADLINE_EXCEEDED )
+        {
+            return status;
+        }
+
+        if( uploader->retry.action == NCE_RETRY_FAIL )
+        {
+            if( status == NCE_SDK_CLIENT_ERROR )
+            {
+                NceOSLogError( "[ERR] Aborting transmission. Please make sure that Memfault Plugin is enabled in 1NCE OS\n" );
+            }
+            else
+            {
+                NceOSLogError( "[ERR] Aborting transmission, this response is not retried\n" );
+            }
+
+            return status;
+        }
+
+        if( attempt < NCE_SDK_MEMFAULT_ATTEMPTS )
+        {
+            /* Longer on backoff or when a 5.03 asks for it. */
+            delayMs = ( uploader->retry.waitMs > NCE_SDK_MEMFAULT_ATTEMPT_DELAY_MS ) ?
+                      uploader->retry.waitMs : NCE_SDK_MEMFAULT_ATTEMPT_DELAY_MS;
+
+            #ifdef NCE_SDK_DEADLINE
+            /* A wait ending past the budget would only delay the failure. */
+            if( ( uploader->deadline != NULL ) && !nce_deadline_allows( uploader->deadline, delayMs, NceOSClockUs() ) )
+            {
+                NceOSLogError( "[ERR] No time left to wait %u ms for the next attempt\n", ( unsigned int ) delayMs );
+                return NCE_SDK_DEADLINE_EXCEEDED;
+            }
+            #endif
+
+            if( uploader->delayMs != NULL )
+            {
+                uploader->delayMs( delayMs );
+            }
+
+            NceOSLogInfo( "[INF] Retrying ... (Attempt %u/%u)\n", attempt + 1u, ( unsigned int ) NCE_SDK_MEMFAULT_ATTEMPTS );
+        }
+    }
+
+    NceOSLogError( "[ERR] Failed to send Memfault data after %u attempts\n", ( unsigned int ) NCE_SDK_MEMFAULT_ATTEMPTS );
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+    #ifdef NCE_SDK_DEADLINE
+
+int nce_memfault_upload_deadline( nce_memfault_uploader_t * uploader,
+                                  uint32_t budgetMs,
+                                  nce_progress_t * progress )
+{
+    nce_deadline_t deadline;
+    int status;
+
+    nce_deadline_start( &deadline, budgetMs, NceOSClockUs() );
+
+    if( progress != NULL )
+    {
+        memset( progress, 0, sizeof( *progress ) );
+        progress->lastStatus = NCE_SDK_DEADLINE_EXCEEDED;
+    }
+
+    uploader->deadline = &deadline;
+    uploader->progress = progress;
+    status = nce_memfault_upload( uploader );
+    uploader->deadline = NULL;
+    uploader->progress = NULL;
+
+    if( progress != NULL )
+    {
+        progress->elapsedMs = nce_deadline_elapsed_ms( &deadline, NceOSClockUs() );
+    }
+
+    return status;
+}
+    #endif /* ifdef NCE_SDK_DEADLINE */
+
+/*-----------------------------------------------------------*/
+
+#endif /* ifdef NCE_SDK_MEMFAULT */
@@ -0,0 +1,164 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_metrics.c
+ * @brief Implements the metrics functions in nce_metrics.h.
+ */
+
+#include <string.h>
+#include "nce_metrics.h"
+
+#ifdef ARDUINO
+    #include "interface/clock_interface.h"
+#else
+    #include "clock_interface.h"
+#endif /* ifdef ARDUINO */
+
+#ifdef NCE_SDK_METRICS
+
+/**
+ * @brief Metrics used when no instance is given.
+ */
+static nce_metrics_t defaultMetrics;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Counters of an operation.
+ *
+ * @param[in] metrics: Metrics instance, NULL for the shared default one.
+ * @param[in] op: Operation.
+ */
+static nce_metric_t * _metric( nce_metrics_t * metrics,
+                               nce_metric_op_t op )
+{
+    return ( metrics != NULL ) ? &metrics->op[ op ] : &defaultMetrics.op[ op ];
+}
+
+/**
+ * @brief Latency bucket of a duration.
+ *
+ * @param[in] durationUs: Duration in microseconds.
+ */
+static int _bucket( uint32_t durationUs )
+{
+    int bucket = 0;
+
+    while( ( bucket < NCE_METRICS_BUCKETS - 1 ) && ( durationUs >= NCE_METRICS_BUCKET_LIMIT_US( bucket ) ) )
+    {
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_metrics_begin( nce_metrics_t * metrics,
+                        nce_metric_op_t op )
+{
+    nce_metric_t * metric = _metric( metrics, op );
+
+    metric->attempts++;
+    metric->startUs = NceOSClockUs();
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_metrics_bytes( nce_metrics_t * metrics,
+                        nce_metric_op_t op,
+                        size_t sent,
+                        size_t received )
+{
+    nce_metric_t * metric = _metric( metrics, op );
+
+    metric->bytesSent += ( uint32_t ) sent;
+    metric->bytesReceived += ( uint32_t ) received;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_metrics_end( nce_metrics_t * metrics,
+                      nce_metric_op_t op,
+                      int status )
+{
+    nce_metric_t * metric = _metric( metrics, op );
+    uint32_t durationUs = NceOSClockUs() - metric->startUs;
+
+    if( status >= 0 )
+    {
+        metric->successes++;
+    }
+    else if( -status < NCE_METRICS_ERROR_CODES )
+    {
+        metric->failures[ -status ]++;
+    }
+    else
+    {
+        metric->failures[ 0 ]++;
+    }
+
+    metric->latency[ _bucket( durationUs ) ]++;
+
+    if( durationUs > metric->maxLatencyUs )
+    {
+        metric->maxLatencyUs = durationUs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_metrics_snapshot( nce_metrics_t * metrics,
+                           nce_metrics_t * snapshot,
+                           int reset )
+{
+    nce_metrics_t * source = ( metrics != NULL ) ? metrics : &defaultMetrics;
+
+    memcpy( snapshot, source, sizeof( *snapshot ) );
+
+    if( reset )
+    {
+        nce_metrics_reset( source );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_metrics_reset( nce_metrics_t * metrics )
+{
+    int op;
+
+    for( op = 0; op < NCE_METRIC_OP_COUNT; op++ )
+    {
+        nce_metric_t * metric = _metric( metrics, ( nce_metric_op_t ) op );
+        uint32_t startUs = metric->startUs;
+
+        /* Keep the start time, an operation may be running. */
+        memset( metric, 0, sizeof( *metric ) );
+        metric->startUs = startUs;
+    }
+}
+
+#endif /* ifdef NCE_SDK_METRICS */
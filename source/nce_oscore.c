@@ -0,0 +1,840 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_oscore.c
+ * @brief Implements the OSCORE functions in nce_oscore.h.
+ */
+
+#include <string.h>
+#include "nce_oscore.h"
+#include "nce_coap_option.h"
+
+#ifdef NCE_SDK_OSCORE
+
+/**
+ * @brief CoAP option numbers handled apart.
+ */
+    #define OPTION_URI_HOST        3u
+    #define OPTION_OBSERVE         6u
+    #define OPTION_URI_PORT        7u
+    #define OPTION_OSCORE          9u
+    #define OPTION_PROXY_URI       35u
+    #define OPTION_PROXY_SCHEME    39u
+
+/**
+ * @brief COSE algorithm AES-CCM-16-64-128.
+ */
+    #define COSE_AES_CCM_16_64_128    10u
+
+/**
+ * @brief Flags of the OSCORE option value.
+ */
+    #define FLAG_PIV_MASK           0x07u
+    #define FLAG_KID                0x08u
+    #define FLAG_KID_CONTEXT        0x10u
+    #define FLAG_RESERVED           0xE0u
+
+/**
+ * @brief Longest Partial IV (RFC 8613 section 6.1).
+ */
+    #define PIV_MAX_LENGTH          5u
+
+/**
+ * @brief Size of the buffers of the HKDF info and of the AAD.
+ */
+    #define INFO_SIZE               ( 16u + NCE_OSCORE_ID_MAX_LENGTH + NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH )
+    #define AAD_SIZE                32u
+
+/**
+ * @brief Option of a parsed message.
+ */
+typedef struct _option
+{
+    uint32_t number;       /**< Option number. */
+    const uint8_t * value; /**< Option value, inside the message. */
+    size_t length;         /**< Length of the value. */
+} _option_t;
+
+/**
+ * @brief Options and payload of a parsed message.
+ */
+typedef struct _parsed
+{
+    _option_t options[ NCE_SDK_OSCORE_MAX_OPTIONS ]; /**< Options in order. */
+    size_t count;                                    /**< Options used. */
+    const uint8_t * payload;                         /**< Payload, NULL if none. */
+    size_t payloadLength;                            /**< Length of the payload. */
+} _parsed_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the extended delta or length of an option.
+ *
+ * @param[in] nibble: 4-bit delta or length.
+ * @param[in] message: Message.
+ * @param[in] length: Length of the message.
+ * @param[in,out] offset: Offset of the extension, moved past it.
+ * @param[out] value: Delta or length.
+ *
+ * @return 0 on success, NCE_OSCORE_FORMAT_ERROR.
+ */
+static int _extended( uint8_t nibble,
+                      const uint8_t * message,
+                      size_t length,
+                      size_t * offset,
+                      uint32_t * value )
+{
+    if( nibble < 13u )
+    {
+        *value = nibble;
+    }
+    else if( ( nibble == 13u ) && ( *offset + 1u <= length ) )
+    {
+        *value = 13u + message[ *offset ];
+        *offset += 1u;
+    }
+    else if( ( nibble == 14u ) && ( *offset + 2u <= length ) )
+    {
+        *value = 269u + ( ( ( uint32_t ) message[ *offset ] << 8 ) | message[ *offset + 1u ] );
+        *offset += 2u;
+    }
+    else
+    {
+        return NCE_OSCORE_FORMAT_ERROR;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Split a CoAP message in options and payload.
+ *
+ * @param[in] message: Message.
+ * @param[in] length: Length of the message.
+ * @param[in] offset: Offset of the first option.
+ * @param[out] parsed: Options and payload.
+ *
+ * @return 0 on success, NCE_OSCORE_FORMAT_ERROR or NCE_OSCORE_UNSUPPORTED_ERROR.
+ */
+static int _parse( const uint8_t * message,
+                   size_t length,
+                   size_t offset,
+                   _parsed_t * parsed )
+{
+    uint32_t number = 0;
+    uint32_t delta;
+    uint32_t optionLength;
+    uint8_t byte;
+
+    parsed->count = 0;
+    parsed->payload = NULL;
+    parsed->payloadLength = 0;
+
+    while( offset < length )
+    {
+        byte = message[ offset++ ];
+
+        if( byte == 0xFFu )
+        {
+            /* A payload marker must be followed by a payload. */
+            if( offset == length )
+            {
+                return NCE_OSCORE_FORMAT_ERROR;
+            }
+
+            parsed->payload = &message[ offset ];
+            parsed->payloadLength = length - offset;
+            break;
+        }
+
+        if( ( _extended( ( uint8_t ) ( byte >> 4 ), message, length, &offset, &delta ) != 0 ) ||
+            ( _extended( ( uint8_t ) ( byte & 0x0Fu ), message, length, &offset, &optionLength ) != 0 ) ||
+            ( optionLength > length - offset ) )
+        {
+            return NCE_OSCORE_FORMAT_ERROR;
+        }
+
+        if( parsed->count == NCE_SDK_OSCORE_MAX_OPTIONS )
+        {
+            return NCE_OSCORE_UNSUPPORTED_ERROR;
+        }
+
+        number += delta;
+        parsed->options[ parsed->count ].number = number;
+        parsed->options[ parsed->count ].value = &message[ offset ];
+        parsed->options[ parsed->count ].length = optionLength;
+        parsed->count++;
+        offset += optionLength;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append an option.
+ *
+ * @param[out] out: Message being built.
+ * @param[in] size: Size of the message buffer.
+ * @param[in,out] offset: End of the message, moved past the option.
+ * @param[in,out] last: Number of the previous option, updated.
+ * @param[in] number: Option number, not below last.
+ * @param[in] value: Option value.
+ * @param[in] length: Length of the value.
+ *
+ * @return 0 on success, NCE_OSCORE_BUFFER_ERROR.
+ */
+static int _put_option( uint8_t * out,
+                        size_t size,
+                        size_t * offset,
+                        uint32_t * last,
+                        uint32_t number,
+                        const uint8_t * value,
+                        size_t length )
+{
+    size_t end = nce_coap_option_append( out, *offset, size, number - *last, value, length );
+
+    if( end == 0u )
+    {
+        return NCE_OSCORE_BUFFER_ERROR;
+    }
+
+    *offset = end;
+    *last = number;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Derive a key or the Common IV (RFC 8613 section 3.2.1).
+ *
+ * @param[in] params: Master Secret, Master Salt and ID Context.
+ * @param[in] id: Sender ID, Recipient ID, or empty for the Common IV.
+ * @param[in] idLength: Length of the ID.
+ * @param[in] iv: Nonzero for the Common IV, zero for a key.
+ * @param[out] out: Key or Common IV.
+ *
+ * @return 0 on success, NCE_OSCORE_CRYPTO_ERROR.
+ */
+static int _derive( const nce_oscore_params_t * params,
+                    const uint8_t * id,
+                    size_t idLength,
+                    int iv,
+                    uint8_t * out )
+{
+    uint8_t info[ INFO_SIZE ];
+    size_t length = 0;
+    size_t outLength = iv ? NCE_CRYPTO_CCM_NONCE_LENGTH : NCE_CRYPTO_CCM_KEY_LENGTH;
+
+    /* info = [ id, id_context, alg_aead, type, L ] */
+    info[ length++ ] = 0x85u;
+    info[ length++ ] = ( uint8_t ) ( 0x40u | idLength );
+
+    if( idLength > 0u )
+    {
+        memcpy( &info[ length ], id, idLength );
+        length += idLength;
+    }
+
+    if( params->idContext == NULL )
+    {
+        info[ length++ ] = 0xF6u;
+    }
+    else
+    {
+        if( params->idContextLength < 24u )
+        {
+            info[ length++ ] = ( uint8_t ) ( 0x40u | params->idContextLength );
+        }
+        else
+        {
+            info[ length++ ] = 0x58u;
+            info[ length++ ] = ( uint8_t ) params->idContextLength;
+        }
+
+        memcpy( &info[ length ], params->idContext, params->idContextLength );
+        length += params->idContextLength;
+    }
+
+    info[ length++ ] = COSE_AES_CCM_16_64_128;
+
+    if( iv )
+    {
+        info[ length++ ] = 0x62u;
+        info[ length++ ] = 'I';
+        info[ length++ ] = 'V';
+    }
+    else
+    {
+        info[ length++ ] = 0x63u;
+        info[ length++ ] = 'K';
+        info[ length++ ] = 'e';
+        info[ length++ ] = 'y';
+    }
+
+    info[ length++ ] = ( uint8_t ) outLength;
+
+    if( nce_os_hkdf_sha256( params->masterSalt, ( params->masterSalt != NULL ) ? params->masterSaltLength : 0u,
+                            params->masterSecret, params->masterSecretLength,
+                            info, length, out, outLength ) != 0 )
+    {
+        return NCE_OSCORE_CRYPTO_ERROR;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Build the AAD of a request and its response (RFC 8613 section 5.4).
+ *
+ * @param[out] aad: AAD, AAD_SIZE bytes.
+ * @param[in] kid: Sender ID of the request.
+ * @param[in] kidLength: Length of the Sender ID.
+ * @param[in] piv: Partial IV of the request.
+ * @param[in] pivLength: Length of the Partial IV.
+ *
+ * @return Length of the AAD.
+ */
+static size_t _aad( uint8_t * aad,
+                    const uint8_t * kid,
+                    size_t kidLength,
+                    const uint8_t * piv,
+                    size_t pivLength )
+{
+    static const uint8_t prefix[] = { 0x83u, 0x68u, 'E', 'n', 'c', 'r', 'y', 'p', 't', '0', 0x40u };
+    size_t length = sizeof( prefix );
+
+    memcpy( aad, prefix, sizeof( prefix ) );
+
+    /* external_aad = [ 1, [ alg_aead ], request_kid, request_piv, options ],
+     * wrapped in a byte string shorter than 24 bytes. */
+    aad[ length++ ] = ( uint8_t ) ( 0x40u | ( 7u + kidLength + pivLength ) );
+    aad[ length++ ] = 0x85u;
+    aad[ length++ ] = 0x01u;
+    aad[ length++ ] = 0x81u;
+    aad[ length++ ] = COSE_AES_CCM_16_64_128;
+    aad[ length++ ] = ( uint8_t ) ( 0x40u | kidLength );
+    memcpy( &aad[ length ], kid, kidLength );
+    length += kidLength;
+    aad[ length++ ] = ( uint8_t ) ( 0x40u | pivLength );
+    memcpy( &aad[ length ], piv, pivLength );
+    length += pivLength;
+    aad[ length++ ] = 0x40u;
+
+    return length;
+}
+
+/**
+ * @brief Build the AEAD nonce (RFC 8613 section 5.2).
+ *
+ * @param[out] nonce: Nonce.
+ * @param[in] commonIv: Common IV.
+ * @param[in] id: ID of the endpoint that generated the Partial IV.
+ * @param[in] idLength: Length of the ID.
+ * @param[in] piv: Partial IV.
+ * @param[in] pivLength: Length of the Partial IV.
+ */
+static void _nonce( uint8_t * nonce,
+                    const uint8_t * commonIv,
+                    const uint8_t * id,
+                    size_t idLength,
+                    const uint8_t * piv,
+                    size_t pivLength )
+{
+    size_t i;
+
+    memset( nonce, 0, NCE_CRYPTO_CCM_NONCE_LENGTH );
+    nonce[ 0 ] = ( uint8_t ) idLength;
+    memcpy( &nonce[ 1u + NCE_OSCORE_ID_MAX_LENGTH - idLength ], id, idLength );
+    memcpy( &nonce[ NCE_CRYPTO_CCM_NONCE_LENGTH - pivLength ], piv, pivLength );
+
+    for( i = 0; i < NCE_CRYPTO_CCM_NONCE_LENGTH; i++ )
+    {
+        nonce[ i ] ^= commonIv[ i ];
+    }
+}
+
+/**
+ * @brief Check the header of a CoAP message.
+ *
+ * @param[in] message: Message.
+ * @param[in] length: Length of the message.
+ *
+ * @return Offset of the first option, NCE_OSCORE_FORMAT_ERROR.
+ */
+static int _header( const uint8_t * message,
+                    size_t length )
+{
+    size_t tokenLength;
+
+    if( ( length < 4u ) || ( ( message[ 0 ] >> 6 ) != 1u ) )
+    {
+        return NCE_OSCORE_FORMAT_ERROR;
+    }
+
+    tokenLength = message[ 0 ] & 0x0Fu;
+
+    if( ( tokenLength > 8u ) || ( 4u + tokenLength > length ) )
+    {
+        return NCE_OSCORE_FORMAT_ERROR;
+    }
+
+    return ( int ) ( 4u + tokenLength );
+}
+
+/**
+ * @brief Take the next Sender Sequence Number, persisting a new window first
+ * when it is the first one of the window.
+ *
+ * @param[in] ctx: Context.
+ * @param[out] piv: Partial IV encoding the number.
+ * @param[out] pivLength: Length of the Partial IV.
+ *
+ * @return 0 on success, NCE_OSCORE_SEQUENCE_ERROR.
+ */
+static int _next_piv( nce_oscore_context_t * ctx,
+                      uint8_t * piv,
+                      uint8_t * pivLength )
+{
+    uint32_t sequence = ctx->sequence;
+    uint32_t next;
+    uint8_t length = 0;
+    int shift;
+
+    if( sequence == UINT32_MAX )
+    {
+        return NCE_OSCORE_SEQUENCE_ERROR;
+    }
+
+    if( ( ctx->persist != NULL ) && ( sequence >= ctx->sequenceLimit ) )
+    {
+        next = ( sequence > UINT32_MAX - NCE_SDK_OSCORE_SEQUENCE_WINDOW ) ?
+               UINT32_MAX : sequence + NCE_SDK_OSCORE_SEQUENCE_WINDOW;
+
+        if( ctx->persist( ctx->persistArg, next ) != 0 )
+        {
+            return NCE_OSCORE_SEQUENCE_ERROR;
+        }
+
+        ctx->sequenceLimit = next;
+    }
+
+    ctx->sequence = sequence + 1u;
+
+    /* Shortest big-endian encoding, a single zero byte for 0. */
+    for( shift = 24; shift > 0; shift -= 8 )
+    {
+        if( ( sequence >> shift ) != 0u )
+        {
+            break;
+        }
+    }
+
+    for( ; shift >= 0; shift -= 8 )
+    {
+        piv[ length++ ] = ( uint8_t ) ( sequence >> shift );
+    }
+
+    *pivLength = length;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_oscore_init( nce_oscore_context_t * ctx,
+                     const nce_oscore_params_t * params,
+                     uint32_t sequence,
+                     nce_oscore_persist_t persist,
+                     void * persistArg )
+{
+    if( ( ctx == NULL ) || ( params == NULL ) || ( params->masterSecret == NULL ) ||
+        ( params->senderIdLength > NCE_OSCORE_ID_MAX_LENGTH ) ||
+        ( params->recipientIdLength > NCE_OSCORE_ID_MAX_LENGTH ) ||
+        ( ( params->senderIdLength > 0u ) && ( params->senderId == NULL ) ) ||
+        ( ( params->recipientIdLength > 0u ) && ( params->recipientId == NULL ) ) ||
+        ( ( params->idContext != NULL ) && ( params->idContextLength > NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH ) ) )
+    {
+        return NCE_OSCORE_ARGUMENT_ERROR;
+    }
+
+    memset( ctx, 0, sizeof( *ctx ) );
+
+    if( ( _derive( params, params->senderId, params->senderIdLength, 0, ctx->senderKey ) != 0 ) ||
+        ( _derive( params, params->recipientId, params->recipientIdLength, 0, ctx->recipientKey ) != 0 ) ||
+        ( _derive( params, NULL, 0, 1, ctx->commonIv ) != 0 ) )
+    {
+        memset( ctx, 0, sizeof( *ctx ) );
+        return NCE_OSCORE_CRYPTO_ERROR;
+    }
+
+    if( params->senderIdLength > 0u )
+    {
+        memcpy( ctx->senderId, params->senderId, params->senderIdLength );
+    }
+
+    if( params->recipientIdLength > 0u )
+    {
+        memcpy( ctx->recipientId, params->recipientId, params->recipientIdLength );
+    }
+
+    ctx->senderIdLength = ( uint8_t ) params->senderIdLength;
+    ctx->recipientIdLength = ( uint8_t ) params->recipientIdLength;
+
+    if( params->idContext != NULL )
+    {
+        memcpy( ctx->idContext, params->idContext, params->idContextLength );
+        ctx->idContextLength = ( uint8_t ) params->idContextLength;
+        ctx->hasIdContext = 1;
+    }
+
+    /* The numbers from the stored value on were never used. */
+    ctx->sequence = sequence;
+    ctx->sequenceLimit = sequence;
+    ctx->persist = persist;
+    ctx->persistArg = persistArg;
+
+    return NCE_OSCORE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+    #ifdef NCE_DEVICE_AUTHENTICATOR
+
+int nce_oscore_init_from_key( nce_oscore_context_t * ctx,
+                              const nce_dtls_key_t * nceKey,
+                              uint32_t sequence,
+                              nce_oscore_persist_t persist,
+                              void * persistArg )
+{
+    static const uint8_t serverId[ 1 ] = { 0x01u };
+    nce_oscore_params_t params;
+
+    if( ( nceKey == NULL ) || ( nceKey->pskLength == 0u ) )
+    {
+        return NCE_OSCORE_ARGUMENT_ERROR;
+    }
+
+    memset( &params, 0, sizeof( params ) );
+    params.masterSecret = nceKey->psk;
+    params.masterSecretLength = nceKey->pskLength;
+    params.idContext = nceKey->identity;
+    params.idContextLength = nceKey->identityLength;
+    params.recipientId = serverId;
+    params.recipientIdLength = sizeof( serverId );
+
+    return nce_oscore_init( ctx, &params, sequence, persist, persistArg );
+}
+
+    #endif /* ifdef NCE_DEVICE_AUTHENTICATOR */
+
+/*-----------------------------------------------------------*/
+
+int nce_oscore_protect_request( nce_oscore_context_t * ctx,
+                                const uint8_t * message,
+                                size_t length,
+                                uint8_t * protectedMessage,
+                                size_t size,
+                                nce_oscore_request_t * request )
+{
+    _parsed_t parsed;
+    uint8_t value[ 3u + PIV_MAX_LENGTH + NCE_SDK_OSCORE_ID_CONTEXT_MAX_LENGTH + NCE_OSCORE_ID_MAX_LENGTH ];
+    uint8_t aad[ AAD_SIZE ];
+    uint8_t nonce[ NCE_CRYPTO_CCM_NONCE_LENGTH ];
+    size_t valueLength;
+    size_t aadLength;
+    size_t offset;
+    size_t plaintext;
+    uint32_t last = 0;
+    uint8_t oscoreDone = 0;
+    size_t i;
+    int status;
+
+    if( ( ctx == NULL ) || ( message == NULL ) || ( protectedMessage == NULL ) || ( request == NULL ) )
+    {
+        return NCE_OSCORE_ARGUMENT_ERROR;
+    }
+
+    status = _header( message, length );
+
+    /* Only requests: class 0 and not the empty message. */
+    if( ( status < 0 ) || ( message[ 1 ] == 0u ) || ( ( message[ 1 ] >> 5 ) != 0u ) )
+    {
+        return NCE_OSCORE_FORMAT_ERROR;
+    }
+
+    offset = ( size_t ) status;
+    status = _parse( message, length, offset, &parsed );
+
+    if( status != 0 )
+    {
+        return status;
+    }
+
+    for( i = 0; i < parsed.count; i++ )
+    {
+        if( ( parsed.options[ i ].number == OPTION_PROXY_URI ) || ( parsed.options[ i ].number == OPTION_OBSERVE ) )
+        {
+            return NCE_OSCORE_UNSUPPORTED_ERROR;
+        }
+
+        if( parsed.options[ i ].number == OPTION_OSCORE )
+        {
+            return NCE_OSCORE_FORMAT_ERROR;
+        }
+    }
+
+    if( size < offset )
+    {
+        return NCE_OSCORE_BUFFER_ERROR;
+    }
+
+    /* Consumed before anything is sent, even if protection fails below. */
+    status = _next_piv( ctx, request->piv, &request->pivLength );
+
+    if( status != 0 )
+    {
+        return status;
+    }
+
+    value[ 0 ] = ( uint8_t ) ( request->pivLength | FLAG_KID | ( ctx->hasIdContext ? FLAG_KID_CONTEXT : 0u ) );
+    memcpy( &value[ 1 ], request->piv, request->pivLength );
+    valueLength = 1u + request->pivLength;
+
+    if( ctx->hasIdContext )
+    {
+        value[ valueLength++ ] = ctx->idContextLength;
+        memcpy( &value[ valueLength ], ctx->idContext, ctx->idContextLength );
+        valueLength += ctx->idContextLength;
+    }
+
+    memcpy( &value[ valueLength ], ctx->senderId, ctx->senderIdLength );
+    valueLength += ctx->senderIdLength;
+
+    /* Outer message: same header and token, code POST, the Class U options
+     * and the OSCORE option in order. */
+    memcpy( protectedMessage, message, offset );
+    protectedMessage[ 1 ] = 0x02u;
+
+    for( i = 0; i <= parsed.count; i++ )
+    {
+        if( !oscoreDone && ( ( i == parsed.count ) || ( parsed.options[ i ].number > OPTION_OSCORE ) ) )
+        {
+            status = _put_option( protectedMessage, size, &offset, &last, OPTION_OSCORE, value, valueLength );
+            oscoreDone = 1;
+        }
+
+        if( ( status == 0 ) && ( i < parsed.count ) &&
+            ( ( parsed.options[ i ].number == OPTION_URI_HOST ) || ( parsed.options[ i ].number == OPTION_URI_PORT ) ||
+              ( parsed.options[ i ].number == OPTION_PROXY_SCHEME ) ) )
+        {
+            status = _put_option( protectedMessage, size, &offset, &last, parsed.options[ i ].number,
+                                  parsed.options[ i ].value, parsed.options[ i ].length );
+        }
+
+        if( status != 0 )
+        {
+            return status;
+        }
+    }
+
+    if( size - offset < 2u + NCE_CRYPTO_CCM_TAG_LENGTH )
+    {
+        return NCE_OSCORE_BUFFER_ERROR;
+    }
+
+    /* Plaintext, built where the ciphertext goes: code, inner options and
+     * payload. */
+    protectedMessage[ offset++ ] = 0xFFu;
+    plaintext = offset;
+    protectedMessage[ offset++ ] = message[ 1 ];
+    last = 0;
+
+    for( i = 0; i < parsed.count; i++ )
+    {
+        if( ( parsed.options[ i ].number != OPTION_URI_HOST ) && ( parsed.options[ i ].number != OPTION_URI_PORT ) &&
+            ( parsed.options[ i ].number != OPTION_PROXY_SCHEME ) )
+        {
+            status = _put_option( protectedMessage, size, &offset, &last, parsed.options[ i ].number,
+                                  parsed.options[ i ].value, parsed.options[ i ].length );
+
+            if( status != 0 )
+            {
+                return status;
+            }
+        }
+    }
+
+    if( parsed.payload != NULL )
+    {
+        if( 1u + parsed.payloadLength > size - offset )
+        {
+            return NCE_OSCORE_BUFFER_ERROR;
+        }
+
+        protectedMessage[ offset++ ] = 0xFFu;
+        memcpy( &protectedMessage[ offset ], parsed.payload, parsed.payloadLength );
+        offset += parsed.payloadLength;
+    }
+
+    if( size - offset < NCE_CRYPTO_CCM_TAG_LENGTH )
+    {
+        return NCE_OSCORE_BUFFER_ERROR;
+    }
+
+    aadLength = _aad( aad, ctx->senderId, ctx->senderIdLength, request->piv, request->pivLength );
+    _nonce( nonce, ctx->commonIv, ctx->senderId, ctx->senderIdLength, request->piv, request->pivLength );
+
+    if( nce_os_aes_ccm_encrypt( ctx->senderKey, nonce, aad, aadLength, &protectedMessage[ plaintext ],
+                                offset - plaintext, &protectedMessage[ plaintext ] ) != 0 )
+    {
+        return NCE_OSCORE_CRYPTO_ERROR;
+    }
+
+    return ( int ) ( offset + NCE_CRYPTO_CCM_TAG_LENGTH );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_oscore_unprotect_response( const nce_oscore_context_t * ctx,
+                                   const nce_oscore_request_t * request,
+                                   const uint8_t * protectedMessage,
+                                   size_t length,
+                                   uint8_t * message,
+                                   size_t size )
+{
+    _parsed_t parsed;
+    const _option_t * oscore = NULL;
+    const uint8_t * id;
+    const uint8_t * piv;
+    size_t idLength;
+    size_t pivLength;
+    uint8_t aad[ AAD_SIZE ];
+    uint8_t nonce[ NCE_CRYPTO_CCM_NONCE_LENGTH ];
+    size_t aadLength;
+    size_t offset;
+    size_t plainLength;
+    uint8_t code;
+    size_t i;
+    int status;
+
+    if( ( ctx == NULL ) || ( request == NULL ) || ( protectedMessage == NULL ) || ( message == NULL ) )
+    {
+        return NCE_OSCORE_ARGUMENT_ERROR;
+    }
+
+    status = _header( protectedMessage, length );
+
+    if( status < 0 )
+    {
+        return status;
+    }
+
+    offset = ( size_t ) status;
+    status = _parse( protectedMessage, length, offset, &parsed );
+
+    if( status != 0 )
+    {
+        return status;
+    }
+
+    for( i = 0; i < parsed.count; i++ )
+    {
+        if( parsed.options[ i ].number == OPTION_OSCORE )
+        {
+            if( oscore != NULL )
+            {
+                return NCE_OSCORE_FORMAT_ERROR;
+            }
+
+            oscore = &parsed.options[ i ];
+        }
+    }
+
+    /* The ciphertext holds at least the code and the tag. */
+    if( ( oscore == NULL ) || ( parsed.payloadLength < 1u + NCE_CRYPTO_CCM_TAG_LENGTH ) )
+    {
+        return NCE_OSCORE_FORMAT_ERROR;
+    }
+
+    id = ctx->senderId;
+    idLength = ctx->senderIdLength;
+    piv = request->piv;
+    pivLength = request->pivLength;
+
+    /* A response carrying its own Partial IV uses the nonce of the server. */
+    if( oscore->length > 0u )
+    {
+        pivLength = oscore->value[ 0 ] & FLAG_PIV_MASK;
+
+        if( ( ( oscore->value[ 0 ] & FLAG_RESERVED ) != 0u ) || ( pivLength > PIV_MAX_LENGTH ) ||
+            ( 1u + pivLength > oscore->length ) )
+        {
+            return NCE_OSCORE_FORMAT_ERROR;
+        }
+
+        if( pivLength > 0u )
+        {
+            piv = &oscore->value[ 1 ];
+            id = ctx->recipientId;
+            idLength = ctx->recipientIdLength;
+        }
+        else
+        {
+            pivLength = request->pivLength;
+        }
+    }
+
+    plainLength = parsed.payloadLength - NCE_CRYPTO_CCM_TAG_LENGTH;
+
+    if( offset - 1u + plainLength > size )
+    {
+        return NCE_OSCORE_BUFFER_ERROR;
+    }
+
+    aadLength = _aad( aad, ctx->senderId, ctx->senderIdLength, request->piv, request->pivLength );
+    _nonce( nonce, ctx->commonIv, id, idLength, piv, pivLength );
+
+    /* Decrypted so that the inner code lands just before the inner options,
+     * then the header and token are written over it. */
+    if( nce_os_aes_ccm_decrypt( ctx->recipientKey, nonce, aad, aadLength, parsed.payload,
+                                parsed.payloadLength, &message[ offset - 1u ] ) != 0 )
+    {
+        return NCE_OSCORE_VERIFY_ERROR;
+    }
+
+    code = message[ offset - 1u ];
+    memcpy( message, protectedMessage, offset );
+    message[ 1 ] = code;
+
+    return ( int ) ( offset - 1u + plainLength );
+}
+
+#endif /* ifdef NCE_SDK_OSCORE */
@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_retry.c
+ * @brief Implements the retry classifier in nce_retry.h.
+ */
+
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_retry.h"
+#include "nce_coap_option.h"
+
+/**
+ * @brief CoAP message layout (RFC 7252, 3).
+ */
+#define RETRY_COAP_HEADER_SIZE        4u
+#define RETRY_COAP_VERSION            1u
+#define RETRY_COAP_PAYLOAD_MARKER     0xFFu
+#define RETRY_COAP_OPTION_MAX_AGE     14u
+
+/**
+ * @brief CoAP codes the classifier tells apart (class << 5 | detail).
+ */
+#define RETRY_COAP_CLASS( code )      ( ( uint8_t ) ( code ) >> 5 )
+#define RETRY_COAP_TOO_MANY_REQUESTS  0x9Du /* 4.29, RFC 8516 */
+#define RETRY_COAP_NOT_IMPLEMENTED    0xA1u /* 5.01 */
+#define RETRY_COAP_UNAVAILABLE        0xA3u /* 5.03 */
+#define RETRY_COAP_PROXYING_NOT_SUPP  0xA5u /* 5.05 */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Unsigned integer option value (RFC 7252, 3.2).
+ */
+static uint32_t _uint_value( const uint8_t * value,
+                             long optionLength )
+{
+    uint32_t result = 0;
+    long i;
+
+    for( i = 0; i < optionLength; i++ )
+    {
+        result = ( result << 8 ) | value[ i ];
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_coap_max_age( const uint8_t * message,
+                      size_t length,
+                      uint32_t * maxAgeS )
+{
+    size_t position = RETRY_COAP_HEADER_SIZE + ( message[ 0 ] & 0x0Fu );
+    long number = 0;
+    long delta;
+    long optionLength;
+    uint8_t header;
+
+    *maxAgeS = NCE_COAP_DEFAULT_MAX_AGE_S;
+
+    /* Options are sorted: stop at Max-Age, a larger number or the payload. */
+    while( ( position < length ) && ( message[ position ] != RETRY_COAP_PAYLOAD_MARKER ) &&
+           ( number < ( long ) RETRY_COAP_OPTION_MAX_AGE ) )
+    {
+        header = message[ position++ ];
+        delta = nce_coap_option_field( message, length, &position, ( uint8_t ) ( header >> 4 ) );
+        optionLength = nce_coap_option_field( message, length, &position, ( uint8_t ) ( header & 0x0Fu ) );
+
+        if( ( delta < 0 ) || ( optionLength < 0 ) || ( position + ( size_t ) optionLength > length ) )
+        {
+            return -1;
+        }
+
+        number += delta;
+
+        if( ( number == ( long ) RETRY_COAP_OPTION_MAX_AGE ) && ( optionLength <= 4 ) )
+        {
+            *maxAgeS = _uint_value( &message[ position ], optionLength );
+        }
+
+        position += ( size_t ) optionLength;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_retry_backoff_ms( unsigned int attempt )
+{
+    uint32_t wait = NCE_SDK_RETRY_BASE_MS;
+
+    while( ( attempt-- > 1u ) && ( wait < NCE_SDK_RETRY_MAX_MS ) )
+    {
+        wait *= 2u;
+    }
+
+    return ( wait < NCE_SDK_RETRY_MAX_MS ) ? wait : NCE_SDK_RETRY_MAX_MS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Overloaded server (5.03, 4.29): wait Max-Age, or give up if that is
+ * longer than the limit.
+ */
+static void _classify_overload( const uint8_t * message,
+                                size_t length,
+                                nce_retry_decision_t * decision )
+{
+    uint32_t maxAgeS;
+
+    if( nce_coap_max_age( message, length, &maxAgeS ) != 0 )
+    {
+        maxAgeS = NCE_COAP_DEFAULT_MAX_AGE_S;
+    }
+
+    decision->status = NCE_SDK_SERVICE_UNAVAILABLE;
+    decision->waitMs = ( maxAgeS < 0xFFFFFFFFu / 1000u ) ? maxAgeS * 1000u : 0xFFFFFFFFu;
+    decision->action = ( maxAgeS <= NCE_SDK_RETRY_MAX_AGE_LIMIT_S ) ? NCE_RETRY_WAIT : NCE_RETRY_FAIL;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Error response: 4.xx and unsupported 5.xx fail, other 5.xx back off.
+ */
+static void _classify_error( const uint8_t * message,
+                             size_t length,
+                             unsigned int attempt,
+                             nce_retry_decision_t * decision )
+{
+    uint8_t code = message[ 1 ];
+
+    if( ( code == RETRY_COAP_UNAVAILABLE ) || ( code == RETRY_COAP_TOO_MANY_REQUESTS ) )
+    {
+        _classify_overload( message, length, decision );
+    }
+    else if( RETRY_COAP_CLASS( code ) == 4u )
+    {
+        decision->status = NCE_SDK_CLIENT_ERROR;
+        decision->action = NCE_RETRY_FAIL;
+    }
+    else if( ( code == RETRY_COAP_NOT_IMPLEMENTED ) || ( code == RETRY_COAP_PROXYING_NOT_SUPP ) )
+    {
+        decision->status = NCE_SDK_SERVER_RESPONSE_ERROR;
+        decision->action = NCE_RETRY_FAIL;
+    }
+    else
+    {
+        decision->status = NCE_SDK_SERVER_RESPONSE_ERROR;
+        decision->action = NCE_RETRY_WAIT;
+        decision->waitMs = nce_retry_backoff_ms( attempt );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_retry_classify( const void * response,
+                        int length,
+                        unsigned int attempt,
+                        nce_retry_decision_t * decision )
+{
+    const uint8_t * message = ( const uint8_t * ) response;
+
+    memset( decision, 0, sizeof( *decision ) );
+
+    if( length <= 0 )
+    {
+        decision->status = NCE_SDK_RECEIVE_ERROR;
+        decision->action = NCE_RETRY_WAIT;
+        decision->waitMs = nce_retry_backoff_ms( attempt );
+    }
+    else if( ( ( size_t ) length >= RETRY_COAP_HEADER_SIZE ) && ( ( message[ 0 ] >> 6 ) == RETRY_COAP_VERSION ) &&
+             ( RETRY_COAP_CLASS( message[ 1 ] ) >= 4u ) && ( RETRY_COAP_CLASS( message[ 1 ] ) <= 5u ) )
+    {
+        decision->code = message[ 1 ];
+        _classify_error( message, ( size_t ) length, attempt, decision );
+    }
+
+    return decision->status;
+}
@@ -0,0 +1,220 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+/**
+ * @file nce_rto.c
+ * @brief Implements the retransmission timeout estimator in nce_rto.h.
+ */
+#include <string.h>
+#include "nce_rto.h"
+
+/**
+ * @brief Bounds of the overall timeout in microseconds.
+ */
+#define RTO_MIN_US             ( NCE_SDK_RTO_MIN_MS * 1000u )
+#define RTO_MAX_US             ( NCE_SDK_RTO_MAX_MS * 1000u )
+#define RTO_INITIAL_US         ( NCE_SDK_RTO_INITIAL_MS * 1000u )
+
+/**
+ * @brief Timeouts below RTO_SHORT_US back off and age faster, timeouts above
+ * RTO_LONG_US slower.
+ */
+#define RTO_SHORT_US           1000000u
+#define RTO_LONG_US            3000000u
+
+/**
+ * @brief Longest idle time the 32-bit microsecond clock tells apart from a
+ * wrap, half its 71 minute period.
+ */
+#define RTO_IDLE_HORIZON_US    0x80000000u
+
+/*-----------------------------------------------------------*/
+
+static uint32_t _clamp( uint32_t us )
+{
+    if( us < RTO_MIN_US )
+    {
+        us = RTO_MIN_US;
+    }
+
+    return ( us > RTO_MAX_US ) ? RTO_MAX_US : us;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Entry of an endpoint, a new one replaces the least recently used.
+ */
+static nce_rto_path_t * _path( nce_rto_t * cache,
+                               const OSEndPoint_t * endpoint,
+                               uint32_t nowUs )
+{
+    bool created;
+    nce_rto_path_t * path = nce_endpoint_cache_get( cache->paths, NCE_SDK_RTO_ENDPOINTS, sizeof( cache->paths[ 0 ] ),
+                                                    &cache->uses, endpoint, &created );
+
+    if( created )
+    {
+        path->rtoUs = _clamp( RTO_INITIAL_US );
+        path->updatedUs = nowUs;
+    }
+
+    return path;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Move a timeout that was not updated for a while towards the
+ * initial one: short ones double, long ones move halfway. Past the idle
+ * horizon it is reset to the initial one, where aging leads anyway.
+ */
+static void _age( nce_rto_path_t * path,
+                  uint32_t nowUs )
+{
+    uint32_t idleUs = nowUs - path->updatedUs;
+
+    if( idleUs >= RTO_IDLE_HORIZON_US )
+    {
+        path->rtoUs = _clamp( RTO_INITIAL_US );
+        path->updatedUs = nowUs;
+    }
+    else if( ( path->rtoUs < RTO_SHORT_US ) && ( idleUs > 16u * path->rtoUs ) )
+    {
+        path->rtoUs = _clamp( 2u * path->rtoUs );
+        path->updatedUs = nowUs;
+    }
+    else if( ( path->rtoUs > RTO_LONG_US ) && ( idleUs > 4u * path->rtoUs ) )
+    {
+        path->rtoUs = _clamp( ( RTO_INITIAL_US + path->rtoUs ) / 2u );
+        path->updatedUs = nowUs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief RFC 6298 update of an estimate, returning SRTT + k * RTTVAR.
+ */
+static uint32_t _sample( nce_rto_estimate_t * estimate,
+                         uint32_t rttUs,
+                         uint32_t k )
+{
+    uint32_t delta;
+
+    if( estimate->valid == 0u )
+    {
+        estimate->srttUs = rttUs;
+        estimate->rttvarUs = rttUs / 2u;
+        estimate->valid = 1u;
+    }
+    else
+    {
+        delta = ( estimate->srttUs > rttUs ) ? estimate->srttUs - rttUs : rttUs - estimate->srttUs;
+        estimate->rttvarUs = estimate->rttvarUs - estimate->rttvarUs / 4u + delta / 4u;
+        estimate->srttUs = estimate->srttUs - estimate->srttUs / 8u + rttUs / 8u;
+    }
+
+    return _clamp( estimate->srttUs + k * estimate->rttvarUs );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_rto_init( nce_rto_t * cache )
+{
+    memset( cache, 0, sizeof( *cache ) );
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_rto_timeout_ms( nce_rto_t * cache,
+                             const OSEndPoint_t * endpoint,
+                             unsigned int transmission,
+                             uint32_t nowUs )
+{
+    nce_rto_path_t * path = _path( cache, endpoint, nowUs );
+    uint32_t timeoutUs;
+
+    _age( path, nowUs );
+    timeoutUs = path->rtoUs;
+
+    for( ; ( transmission > 1u ) && ( timeoutUs < RTO_MAX_US ); transmission-- )
+    {
+        if( path->rtoUs < RTO_SHORT_US )
+        {
+            timeoutUs *= 3u;
+        }
+        else if( path->rtoUs > RTO_LONG_US )
+        {
+            timeoutUs += timeoutUs / 2u;
+        }
+        else
+        {
+            timeoutUs *= 2u;
+        }
+    }
+
+    return ( _clamp( timeoutUs ) + 999u ) / 1000u;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_rto_report( nce_rto_t * cache,
+                     const OSEndPoint_t * endpoint,
+                     uint32_t rttUs,
+                     unsigned int transmissions,
+                     uint32_t nowUs )
+{
+    nce_rto_path_t * path = _path( cache, endpoint, nowUs );
+    uint32_t estimateUs;
+
+    if( rttUs > RTO_MAX_US )
+    {
+        rttUs = RTO_MAX_US;
+    }
+
+    if( transmissions == 1u )
+    {
+        estimateUs = _sample( &path->strong, rttUs, 4u );
+        path->rtoUs = _clamp( path->rtoUs / 2u + estimateUs / 2u );
+    }
+    else if( ( transmissions > 1u ) && ( transmissions <= NCE_SDK_RTO_WEAK_LIMIT ) )
+    {
+        estimateUs = _sample( &path->weak, rttUs, 1u );
+        path->rtoUs = _clamp( path->rtoUs - path->rtoUs / 4u + estimateUs / 4u );
+    }
+    else
+    {
+        return;
+    }
+
+    path->updatedUs = nowUs;
+
+    if( path->samples < UINT16_MAX )
+    {
+        path->samples++;
+    }
+}
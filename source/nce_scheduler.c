@@ -0,0 +1,252 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_scheduler.c
+ * @brief Implements the scheduler in nce_scheduler.h.
+ */
+
+#include <string.h>
+#include "nce_scheduler.h"
+
+#ifdef ARDUINO
+    #include "interface/clock_interface.h"
+#else
+    #include "clock_interface.h"
+#endif /* ifdef ARDUINO */
+
+#ifdef NCE_SDK_SCHEDULER
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Signed time from now to a deadline, valid across clock wraps for
+ * deadlines less than ~35 minutes in the past.
+ */
+static int32_t _until( uint32_t deadlineUs,
+                       uint32_t nowUs )
+{
+    return ( int32_t ) ( deadlineUs - nowUs );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether job a runs before job b in a window.
+ */
+static int _runs_before( const nce_sched_job_t * a,
+                         const nce_sched_job_t * b,
+                         uint32_t nowUs )
+{
+    int32_t untilA = _until( a->deadlineUs, nowUs );
+    int32_t untilB = _until( b->deadlineUs, nowUs );
+
+    if( a->priority != b->priority )
+    {
+        return a->priority > b->priority;
+    }
+
+    if( untilA != untilB )
+    {
+        return untilA < untilB;
+    }
+
+    return ( int32_t ) ( a->seq - b->seq ) < 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Remove and return the job to run next.
+ */
+static nce_sched_job_t _take_next( nce_scheduler_t * scheduler,
+                                   uint32_t nowUs )
+{
+    nce_sched_job_t job;
+    size_t best = 0;
+    size_t i;
+
+    for( i = 1; i < scheduler->count; i++ )
+    {
+        if( _runs_before( &scheduler->jobs[ i ], &scheduler->jobs[ best ], nowUs ) )
+        {
+            best = i;
+        }
+    }
+
+    job = scheduler->jobs[ best ];
+    scheduler->count--;
+    scheduler->jobs[ best ] = scheduler->jobs[ scheduler->count ];
+
+    return job;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Run the queued jobs in one window. Jobs queued by a running job
+ * join the window, up to the queue size.
+ */
+static size_t _run_window( nce_scheduler_t * scheduler )
+{
+    nce_sched_job_t job;
+    size_t ran = 0;
+    uint32_t nowUs;
+
+    while( ( scheduler->count > 0u ) && ( ran < NCE_SDK_SCHED_JOBS ) )
+    {
+        nowUs = NceOSClockUs();
+        job = _take_next( scheduler, nowUs );
+
+        if( _until( job.deadlineUs, nowUs ) < 0 )
+        {
+            scheduler->stats.deadlineMisses++;
+        }
+
+        if( job.run( job.arg ) < 0 )
+        {
+            scheduler->stats.jobsFailed++;
+        }
+
+        ran++;
+    }
+
+    scheduler->stats.jobsRun += ( uint32_t ) ran;
+
+    return ran;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_sched_init( nce_scheduler_t * scheduler,
+                     const nce_sched_radio_t * radio )
+{
+    memset( scheduler, 0, sizeof( *scheduler ) );
+
+    if( radio != NULL )
+    {
+        scheduler->radio = *radio;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_sched_submit( nce_scheduler_t * scheduler,
+                      nce_sched_job_fn_t run,
+                      void * arg,
+                      nce_sched_priority_t priority,
+                      uint32_t maxDelayUs )
+{
+    nce_sched_job_t * job;
+
+    if( scheduler->count == NCE_SDK_SCHED_JOBS )
+    {
+        scheduler->stats.rejected++;
+        return NCE_SCHED_FULL;
+    }
+
+    /* Keep deadlines within the signed range of _until(). */
+    maxDelayUs = ( maxDelayUs > 0x7FFFFFFFu ) ? 0x7FFFFFFFu : maxDelayUs;
+
+    job = &scheduler->jobs[ scheduler->count++ ];
+    job->run = run;
+    job->arg = arg;
+    job->deadlineUs = NceOSClockUs() + maxDelayUs;
+    job->seq = scheduler->nextSeq++;
+    job->priority = ( uint8_t ) priority;
+    scheduler->stats.submitted++;
+
+    return NCE_SCHED_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_sched_poll( nce_scheduler_t * scheduler )
+{
+    int state = NCE_RADIO_IDLE;
+    size_t ran = 0;
+
+    if( scheduler->radio.state != NULL )
+    {
+        state = scheduler->radio.state( scheduler->radio.arg );
+    }
+
+    if( ( scheduler->count > 0u ) && ( state != NCE_RADIO_OFFLINE ) &&
+        ( ( state == NCE_RADIO_CONNECTED ) || ( nce_sched_time_to_window( scheduler ) == 0u ) ) )
+    {
+        scheduler->stats.windows++;
+
+        if( state == NCE_RADIO_CONNECTED )
+        {
+            scheduler->stats.piggybacked++;
+        }
+        else
+        {
+            scheduler->stats.wakeups++;
+        }
+
+        ran = _run_window( scheduler );
+
+        /* Every job but the one waking the radio would have woken it alone. */
+        scheduler->stats.wakeupsAvoided += ( uint32_t ) ran - ( ( state == NCE_RADIO_CONNECTED ) ? 0u : 1u );
+    }
+
+    return ran;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_sched_time_to_window( const nce_scheduler_t * scheduler )
+{
+    uint32_t nowUs = NceOSClockUs();
+    uint32_t earliest = NCE_SCHED_NO_WINDOW;
+    int32_t until;
+    size_t i;
+
+    for( i = 0; i < scheduler->count; i++ )
+    {
+        until = _until( scheduler->jobs[ i ].deadlineUs, nowUs );
+
+        if( ( scheduler->jobs[ i ].priority >= NCE_SCHED_PRIORITY_URGENT ) || ( until <= 0 ) )
+        {
+            earliest = 0;
+        }
+        else if( ( uint32_t ) until < earliest )
+        {
+            earliest = ( uint32_t ) until;
+        }
+    }
+
+    return earliest;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_sched_get_stats( const nce_scheduler_t * scheduler,
+                          nce_sched_stats_t * stats )
+{
+    *stats = scheduler->stats;
+}
+
+#endif /* ifdef NCE_SDK_SCHEDULER */
@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_spsc_queue.c
+ * @brief Implements the single-producer/single-consumer queue in
+ * nce_spsc_queue.h.
+ *
+ * head and tail run freely and wrap at 2^32, head - tail is the number of
+ * queued records. The producer publishes a filled slot with a release store
+ * of head, the consumer frees slots with a release store of tail. Each side
+ * keeps a copy of the other index and only reads the shared one when its
+ * copy says the queue is full (producer) or holds less than a batch
+ * (consumer).
+ */
+
+#include <string.h>
+#include "nce_spsc_queue.h"
+
+/**
+ * @brief Index accesses ordering the slot contents. Without the GNU atomic
+ * built-ins, volatile accesses are used: enough between an interrupt and a
+ * thread of a single core, other targets must define these macros.
+ */
+#ifndef NCE_SPSC_LOAD_ACQUIRE
+    #ifdef __GNUC__
+        #define NCE_SPSC_LOAD_ACQUIRE( index )            __atomic_load_n( ( index ), __ATOMIC_ACQUIRE )
+        #define NCE_SPSC_STORE_RELEASE( index, value )    __atomic_store_n( ( index ), ( value ), __ATOMIC_RELEASE )
+        #define NCE_SPSC_LOAD_RELAXED( index )            __atomic_load_n( ( index ), __ATOMIC_RELAXED )
+        #define NCE_SPSC_STORE_RELAXED( index, value )    __atomic_store_n( ( index ), ( value ), __ATOMIC_RELAXED )
+    #else
+        #define NCE_SPSC_LOAD_ACQUIRE( index )            ( *( const volatile uint32_t * ) ( index ) )
+        #define NCE_SPSC_STORE_RELEASE( index, value )    ( *( volatile uint32_t * ) ( index ) = ( value ) )
+        #define NCE_SPSC_LOAD_RELAXED( index )            ( *( const volatile uint32_t * ) ( index ) )
+        #define NCE_SPSC_STORE_RELAXED( index, value )    ( *( volatile uint32_t * ) ( index ) = ( value ) )
+    #endif
+#endif /* ifndef NCE_SPSC_LOAD_ACQUIRE */
+
+/*-----------------------------------------------------------*/
+
+void nce_spsc_queue_init( nce_spsc_queue_t * queue )
+{
+    memset( queue, 0, sizeof( *queue ) );
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_spsc_queue_push( nce_spsc_queue_t * queue,
+                         const void * record,
+                         size_t length )
+{
+    uint32_t head = queue->producer.state.head;
+    nce_spsc_record_t * slot;
+
+    if( length > NCE_SDK_SPSC_RECORD_SIZE )
+    {
+        return NCE_SPSC_QUEUE_RECORD_SIZE_ERROR;
+    }
+
+    if( head - queue->producer.state.cachedTail == NCE_SDK_SPSC_SLOTS )
+    {
+        queue->producer.state.cachedTail = NCE_SPSC_LOAD_ACQUIRE( &queue->consumer.state.tail );
+
+        if( head - queue->producer.state.cachedTail == NCE_SDK_SPSC_SLOTS )
+        {
+            NCE_SPSC_STORE_RELAXED( &queue->producer.state.overflows, queue->producer.state.overflows + 1u );
+            return NCE_SPSC_QUEUE_FULL;
+        }
+    }
+
+    slot = &queue->slots[ head & ( NCE_SDK_SPSC_SLOTS - 1u ) ];
+    slot->length = ( uint16_t ) length;
+    memcpy( slot->data, record, length );
+    NCE_SPSC_STORE_RELEASE( &queue->producer.state.head, head + 1u );
+
+    return NCE_SPSC_QUEUE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_spsc_queue_drain( nce_spsc_queue_t * queue,
+                             nce_spsc_handler_t handler,
+                             void * arg,
+                             size_t maxRecords )
+{
+    uint32_t tail = queue->consumer.state.tail;
+    size_t drained = 0;
+    const nce_spsc_record_t * slot;
+
+    if( ( maxRecords == 0u ) || ( queue->consumer.state.cachedHead - tail < maxRecords ) )
+    {
+        queue->consumer.state.cachedHead = NCE_SPSC_LOAD_ACQUIRE( &queue->producer.state.head );
+    }
+
+    while( ( tail != queue->consumer.state.cachedHead ) && ( ( maxRecords == 0u ) || ( drained < maxRecords ) ) )
+    {
+        slot = &queue->slots[ tail & ( NCE_SDK_SPSC_SLOTS - 1u ) ];
+        handler( arg, slot->data, slot->length );
+        tail++;
+        drained++;
+    }
+
+    /* One store frees the whole batch. */
+    if( drained > 0u )
+    {
+        NCE_SPSC_STORE_RELEASE( &queue->consumer.state.tail, tail );
+    }
+
+    return drained;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_spsc_queue_overflows( const nce_spsc_queue_t * queue )
+{
+    return NCE_SPSC_LOAD_RELAXED( &queue->producer.state.overflows );
+}
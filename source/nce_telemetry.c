@@ -0,0 +1,573 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file nce_telemetry.c
+ * @brief Implements the confirmable and non-confirmable uplinks in
+ * nce_telemetry.h.
+ */
+
+#define NCE_LOG_MODULE_LEVEL    NCE_SDK_LOG_LEVEL_CORE
+
+#include <string.h>
+#include "nce_telemetry.h"
+#include "nce_coap_option.h"
+
+#ifdef ARDUINO
+    #include "interface/log_interface.h"
+    #include "interface/clock_interface.h"
+#else
+    #include "log_interface.h"
+    #include "clock_interface.h"
+#endif /* ifdef ARDUINO */
+
+#ifdef NCE_SDK_TELEMETRY
+
+    #ifdef __ZEPHYR__
+LOG_MODULE_DECLARE( NCE_SDK, CONFIG_NCE_SDK_LOG_LEVEL );
+    #endif
+
+/**
+ * @brief CoAP header of the requests, without token, and of the responses.
+ */
+    #define COAP_HEADER_SIZE               4u
+    #define COAP_CON_NO_TOKEN              0x40u
+    #define COAP_NON_NO_TOKEN              0x50u
+    #define COAP_ACK                       0x60u
+    #define COAP_RST                       0x70u
+    #define COAP_TYPE_MASK                 0xF0u
+    #define COAP_SUCCESS_CLASS             2u
+
+/**
+ * @brief Options of the requests, in the order they are written.
+ */
+    #define COAP_OPTION_URI_PATH           11u
+    #define COAP_OPTION_CONTENT_FORMAT     12u
+    #define COAP_OPTION_URI_QUERY          15u
+    #define COAP_OPTION_PROXY_URI          35u
+    #define COAP_OPTION_NO_RESPONSE        258u
+    #define COAP_PAYLOAD_MARKER            0xFFu
+
+/**
+ * @brief Datagrams of another exchange skipped while waiting for a response.
+ */
+    #define TELEMETRY_STALE_RESPONSES      4
+
+    #ifdef NceOSDelayMs
+
+/**
+ * @brief Wait of the OS between transmissions.
+ *
+ * @param[in] ms: Milliseconds to wait.
+ */
+static void _os_delay_ms( uint32_t ms )
+{
+    NceOSDelayMs( ms );
+}
+
+        #define TELEMETRY_DEFAULT_DELAY    _os_delay_ms
+    #else
+        #define TELEMETRY_DEFAULT_DELAY    NULL
+    #endif /* ifdef NceOSDelayMs */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append an option to the request.
+ *
+ * @param[in] telemetry: Sender, whose request buffer is written.
+ * @param[in] length: Length of the request so far, 0 after a failure.
+ * @param[in,out] number: Number of the previous option, updated.
+ * @param[in] option: Number of this option.
+ * @param[in] value: Value of the option.
+ * @param[in] valueLength: Length of the value.
+ *
+ * @return Length of the request with the option, 0 if it does not fit.
+ */
+static size_t _append_option( nce_telemetry_t * telemetry,
+                              size_t length,
+                              unsigned int * number,
+                              unsigned int option,
+                              const void * value,
+                              size_t valueLength )
+{
+    if( length == 0u )
+    {
+        return 0;
+    }
+
+    length = nce_coap_option_append( telemetry->request, length, sizeof( telemetry->request ), option - *number, value,
+                                     valueLength );
+    *number = option;
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append one option per segment of a path or query, skipping empty
+ * segments.
+ *
+ * @param[in] telemetry: Sender, whose request buffer is written.
+ * @param[in] length: Length of the request so far, 0 after a failure.
+ * @param[in,out] number: Number of the previous option, updated.
+ * @param[in] option: Number of the options.
+ * @param[in] text: Segments.
+ * @param[in] separator: Character between two segments.
+ *
+ * @return Length of the request with the options, 0 if they do not fit.
+ */
+static size_t _append_segments( nce_telemetry_t * telemetry,
+                                size_t length,
+                                unsigned int * number,
+                                unsigned int option,
+                                const char * text,
+                                char separator )
+{
+    const char * end;
+
+    while( ( length != 0u ) && ( *text != '\0' ) )
+    {
+        end = strchr( text, separator );
+
+        if( end == NULL )
+        {
+            end = text + strlen( text );
+        }
+
+        if( end > text )
+        {
+            length = _append_option( telemetry, length, number, option, text, ( size_t ) ( end - text ) );
+        }
+
+        text = ( *end == '\0' ) ? end : end + 1;
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a message to the request buffer with a new message ID.
+ *
+ * @param[in] telemetry: Sender.
+ * @param[in] message: Message.
+ * @param[in] confirmable: Send it confirmable, whatever the message says.
+ * @param[in] noResponse: Value of the No-Response option, 0 for none.
+ *
+ * @return Length of the request, 0 if it does not fit.
+ */
+static size_t _build_request( nce_telemetry_t * telemetry,
+                              const nce_telemetry_message_t * message,
+                              bool confirmable,
+                              uint8_t noResponse )
+{
+    uint8_t * request = telemetry->request;
+    uint8_t format[ 2 ];
+    unsigned int number = 0;
+    size_t length = COAP_HEADER_SIZE;
+
+    telemetry->messageId++;
+    request[ 0 ] = confirmable ? COAP_CON_NO_TOKEN : COAP_NON_NO_TOKEN;
+    request[ 1 ] = ( message->method != 0u ) ? message->method : NCE_TELEMETRY_POST;
+    request[ 2 ] = ( uint8_t ) ( telemetry->messageId >> 8 );
+    request[ 3 ] = ( uint8_t ) telemetry->messageId;
+
+    if( message->path != NULL )
+    {
+        length = _append_segments( telemetry, length, &number, COAP_OPTION_URI_PATH, message->path, '/' );
+    }
+
+    if( message->contentFormat >= 0 )
+    {
+        /* Unsigned integer in as few bytes as it takes, none for 0. */
+        format[ 0 ] = ( uint8_t ) ( ( unsigned int ) message->contentFormat >> 8 );
+        format[ 1 ] = ( uint8_t ) message->contentFormat;
+        length = ( message->contentFormat > 0xFF ) ?
+                 _append_option( telemetry, length, &number, COAP_OPTION_CONTENT_FORMAT, format, 2 ) :
+                 _append_option( telemetry, length, &number, COAP_OPTION_CONTENT_FORMAT, &format[ 1 ],
+                                 ( message->contentFormat > 0 ) ? 1u : 0u );
+    }
+
+    if( message->query != NULL )
+    {
+        length = _append_segments( telemetry, length, &number, COAP_OPTION_URI_QUERY, message->query, '&' );
+    }
+
+    if( message->proxyUri != NULL )
+    {
+        length = _append_option( telemetry, length, &number, COAP_OPTION_PROXY_URI, message->proxyUri,
+                                 strlen( message->proxyUri ) );
+    }
+
+    if( noResponse != 0u )
+    {
+        length = _append_option( telemetry, length, &number, COAP_OPTION_NO_RESPONSE, &noResponse, 1 );
+    }
+
+    if( ( length != 0u ) && ( message->payloadLength > 0u ) )
+    {
+        if( 1u + message->payloadLength > sizeof( telemetry->request ) - length )
+        {
+            return 0;
+        }
+
+        request[ length++ ] = COAP_PAYLOAD_MARKER;
+        memcpy( &request[ length ], message->payload, message->payloadLength );
+        length += message->payloadLength;
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect to the endpoint unless already connected.
+ *
+ * @return NCE_SDK_SUCCESS, or NCE_SDK_CONNECT_ERROR.
+ */
+static int _connect( nce_telemetry_t * telemetry )
+{
+    os_network_ops_t * osNetwork = telemetry->osNetwork;
+    int status;
+
+    if( telemetry->connected )
+    {
+        return NCE_SDK_SUCCESS;
+    }
+
+    NCE_TRACE_BEGIN( NCE_TRACE_CONNECT );
+    status = osNetwork->nce_os_udp_connect( osNetwork->os_socket, *telemetry->endpoint );
+    NCE_TRACE_END( NCE_TRACE_CONNECT, status );
+
+    if( status != 0 )
+    {
+        NceOSLogError( "Telemetry: failed to connect to %s:%d\n", telemetry->endpoint->host, telemetry->endpoint->port );
+        return NCE_SDK_CONNECT_ERROR;
+    }
+
+    telemetry->connected = true;
+    telemetry->stats.connects++;
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the first length bytes of the request buffer.
+ *
+ * @return NCE_SDK_SUCCESS, or NCE_SDK_SEND_ERROR.
+ */
+static int _send( nce_telemetry_t * telemetry,
+                  size_t length )
+{
+    os_network_ops_t * osNetwork = telemetry->osNetwork;
+    int status;
+
+    NCE_TRACE_BEGIN( NCE_TRACE_SEND );
+    status = osNetwork->nce_os_udp_send( osNetwork->os_socket, telemetry->request, length );
+    NCE_TRACE_END( NCE_TRACE_SEND, status );
+
+    if( status < 0 )
+    {
+        NceOSLogError( "Telemetry: send failed, error %d\n", status );
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    telemetry->stats.datagramsSent++;
+    telemetry->stats.bytesSent += length;
+
+    return NCE_SDK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait for the acknowledgement or reset of the last request,
+ * skipping datagrams of other exchanges.
+ *
+ * @return Length of the response, 0 on timeout, negative on error.
+ */
+static int _receive_response( nce_telemetry_t * telemetry )
+{
+    os_network_ops_t * osNetwork = telemetry->osNetwork;
+    const uint8_t * response = telemetry->response;
+    int received;
+    int skipped;
+
+    for( skipped = 0; skipped < TELEMETRY_STALE_RESPONSES; skipped++ )
+    {
+        NCE_TRACE_BEGIN( NCE_TRACE_WAIT_RESPONSE );
+        received = osNetwork->nce_os_udp_recv( osNetwork->os_socket, telemetry->response, sizeof( telemetry->response ) );
+        NCE_TRACE_END( NCE_TRACE_WAIT_RESPONSE, received );
+
+        if( ( received <= 0 ) ||
+            ( ( received >= ( int ) COAP_HEADER_SIZE ) &&
+              ( ( ( response[ 0 ] & COAP_TYPE_MASK ) == COAP_ACK ) || ( ( response[ 0 ] & COAP_TYPE_MASK ) == COAP_RST ) ) &&
+              ( response[ 2 ] == telemetry->request[ 2 ] ) && ( response[ 3 ] == telemetry->request[ 3 ] ) ) )
+        {
+            return received;
+        }
+
+        NceOSLogDebug( "Telemetry: skipped a datagram of another exchange\n" );
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Transmit the confirmable request until it is acknowledged. A
+ * timeout repeats the request with the same message ID, so the server can
+ * drop duplicates; after an error response the next transmission is a new
+ * request.
+ *
+ * @param[in] telemetry: Sender.
+ * @param[in] length: Length of the request.
+ *
+ * @return NCE_SDK_SUCCESS, or the error of the last transmission.
+ */
+static int _send_confirmable( nce_telemetry_t * telemetry,
+                              size_t length )
+{
+    unsigned int transmission;
+    int received = 0;
+    int status = NCE_SDK_RECEIVE_ERROR;
+    bool answered = false;
+
+    #ifdef NCE_SDK_RTO
+    unsigned int transmissions = 0;
+    uint32_t firstUs = 0;
+    uint32_t nowUs;
+    #endif
+
+    for( transmission = 1; transmission <= NCE_SDK_TELEMETRY_ATTEMPTS; transmission++ )
+    {
+        #ifdef NCE_SDK_RTO
+        nowUs = NceOSClockUs();
+
+        /* Transmissions since the last response form one exchange. */
+        if( transmissions++ == 0u )
+        {
+            firstUs = nowUs;
+        }
+
+        if( ( telemetry->rto != NULL ) && ( telemetry->setRecvTimeout != NULL ) )
+        {
+            ( void ) telemetry->setRecvTimeout( telemetry->osNetwork->os_socket,
+                                                nce_rto_timeout_ms( telemetry->rto, telemetry->endpoint, transmissions, nowUs ) );
+        }
+        #endif
+
+        if( transmission > 1u )
+        {
+            telemetry->stats.retransmissions++;
+        }
+
+        status = _send( telemetry, length );
+
+        if( status != NCE_SDK_SUCCESS )
+        {
+            return status;
+        }
+
+        received = _receive_response( telemetry );
+
+        if( received > 0 )
+        {
+            answered = true;
+            telemetry->code = telemetry->response[ 1 ];
+
+            #ifdef NCE_SDK_RTO
+            if( telemetry->rto != NULL )
+            {
+                nowUs = NceOSClockUs();
+                nce_rto_report( telemetry->rto, telemetry->endpoint, nowUs - firstUs, transmissions, nowUs );
+            }
+
+            transmissions = 0;
+            #endif
+        }
+
+        status = nce_retry_classify( telemetry->response, received, transmission, &telemetry->retry );
+
+        if( telemetry->retry.action == NCE_RETRY_DONE )
+        {
+            /* A reset, or neither an acknowledgement nor a 2.xx: not worth a retry. */
+            if( ( ( telemetry->response[ 0 ] & COAP_TYPE_MASK ) == COAP_RST ) ||
+                ( ( telemetry->code != 0u ) && ( ( telemetry->code >> 5 ) != COAP_SUCCESS_CLASS ) ) )
+            {
+                NceOSLogError( "Telemetry: message refused, type 0x%02x code %u.%02u\n", telemetry->response[ 0 ] & COAP_TYPE_MASK,
+                               ( unsigned int ) ( telemetry->code >> 5 ), ( unsigned int ) ( telemetry->code & 0x1Fu ) );
+                telemetry->retry.action = NCE_RETRY_FAIL;
+                return NCE_SDK_SERVER_RESPONSE_ERROR;
+            }
+
+            return NCE_SDK_SUCCESS;
+        }
+
+        NceOSLogError( "Telemetry: transmission %u failed: %d (CoAP %u.%02u)\n", transmission, status,
+                       ( unsigned int ) ( telemetry->retry.code >> 5 ), ( unsigned int ) ( telemetry->retry.code & 0x1Fu ) );
+
+        if( ( telemetry->retry.action == NCE_RETRY_FAIL ) || ( transmission == NCE_SDK_TELEMETRY_ATTEMPTS ) )
+        {
+            break;
+        }
+
+        if( received > 0 )
+        {
+            /* The server answered this request: the next one is new. */
+            telemetry->messageId++;
+            telemetry->request[ 2 ] = ( uint8_t ) ( telemetry->messageId >> 8 );
+            telemetry->request[ 3 ] = ( uint8_t ) telemetry->messageId;
+        }
+
+        #ifdef NCE_SDK_RTO
+        if( ( received <= 0 ) && ( telemetry->rto != NULL ) && ( telemetry->setRecvTimeout != NULL ) )
+        {
+            continue;
+        }
+        #endif
+
+        if( telemetry->delayMs != NULL )
+        {
+            telemetry->delayMs( telemetry->retry.waitMs );
+        }
+    }
+
+    /* Not a single response: the path or the session is likely gone. */
+    if( !answered )
+    {
+        nce_telemetry_close( telemetry );
+    }
+
+    return ( received < 0 ) ? NCE_SDK_RECEIVE_ERROR : status;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_telemetry_init( nce_telemetry_t * telemetry,
+                         os_network_ops_t * osNetwork,
+                         const OSEndPoint_t * endpoint )
+{
+    memset( telemetry, 0, sizeof( *telemetry ) );
+    telemetry->osNetwork = osNetwork;
+    telemetry->endpoint = endpoint;
+    telemetry->delayMs = TELEMETRY_DEFAULT_DELAY;
+    telemetry->ackInterval = NCE_SDK_TELEMETRY_ACK_INTERVAL;
+    /* Message IDs start from the clock, so the server does not drop messages of a restarted device as duplicates. */
+    telemetry->messageId = ( uint16_t ) NceOSClockUs();
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_telemetry_send( nce_telemetry_t * telemetry,
+                        const nce_telemetry_message_t * message )
+{
+    /* The hybrid mode asks for an acknowledgement every ackInterval messages. */
+    bool probe = !message->confirmable && ( telemetry->ackInterval != 0u ) &&
+                 ( telemetry->unacknowledged + 1u >= telemetry->ackInterval );
+    bool confirmable = message->confirmable || probe;
+    size_t length = _build_request( telemetry, message, confirmable, probe ? 0u : message->noResponse );
+    bool answered;
+    int status;
+
+    telemetry->code = 0;
+
+    if( length == 0u )
+    {
+        NceOSLogError( "Telemetry: message does not fit %u bytes\n", ( unsigned int ) sizeof( telemetry->request ) );
+        telemetry->stats.failed++;
+        return NCE_SDK_SEND_ERROR;
+    }
+
+    status = _connect( telemetry );
+
+    if( status == NCE_SDK_SUCCESS )
+    {
+        status = confirmable ? _send_confirmable( telemetry, length ) : _send( telemetry, length );
+    }
+
+    /* Even an error response shows the uplinks get through. */
+    answered = confirmable && ( ( status == NCE_SDK_SUCCESS ) || ( telemetry->code != 0u ) );
+
+    if( probe )
+    {
+        telemetry->stats.probes++;
+        telemetry->stats.probesFailed += answered ? 0u : 1u;
+    }
+
+    /* After a probe without response, the next message probes again. */
+    if( answered )
+    {
+        telemetry->unacknowledged = 0;
+    }
+    else if( !message->confirmable && ( telemetry->unacknowledged < 0xFFFFu ) )
+    {
+        telemetry->unacknowledged++;
+    }
+
+    if( status == NCE_SDK_SEND_ERROR )
+    {
+        nce_telemetry_close( telemetry );
+    }
+
+    if( status != NCE_SDK_SUCCESS )
+    {
+        telemetry->stats.failed++;
+    }
+    else if( confirmable )
+    {
+        telemetry->stats.confirmable++;
+    }
+    else
+    {
+        telemetry->stats.nonConfirmable++;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_telemetry_close( nce_telemetry_t * telemetry )
+{
+    if( telemetry->connected )
+    {
+        NCE_TRACE_BEGIN( NCE_TRACE_DISCONNECT );
+        ( void ) telemetry->osNetwork->nce_os_udp_disconnect( telemetry->osNetwork->os_socket );
+        NCE_TRACE_END( NCE_TRACE_DISCONNECT, 0 );
+        telemetry->connected = false;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+#endif /* ifdef NCE_SDK_TELEMETRY */
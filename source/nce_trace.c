@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_trace.c
+ * @brief Implements the tracing functions in nce_trace.h.
+ */
+
+#include <stddef.h>
+#include "nce_trace.h"
+
+#ifdef ARDUINO
+    #include "interface/clock_interface.h"
+#else
+    #include "clock_interface.h"
+#endif /* ifdef ARDUINO */
+
+#ifdef NCE_SDK_TRACE
+
+/**
+ * @brief Storage class of the running operation: one per thread where the
+ * compiler supports it, shared otherwise.
+ */
+    #ifndef NCE_SDK_TRACE_THREAD_LOCAL
+        #if defined( __GNUC__ ) && ( defined( __linux__ ) || defined( CONFIG_THREAD_LOCAL_STORAGE ) )
+            #define NCE_SDK_TRACE_THREAD_LOCAL    __thread
+        #else
+            #define NCE_SDK_TRACE_THREAD_LOCAL
+        #endif
+    #endif
+
+static nce_trace_sink_t traceSink;
+static void * traceSinkArg;
+static uint32_t lastOpId;
+static NCE_SDK_TRACE_THREAD_LOCAL uint32_t currentOpId;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Time stamp an event and hand it to the sink.
+ *
+ * @param[in] name: Span name.
+ * @param[in] phase: Begin or end.
+ * @param[in] status: Status of end events.
+ */
+static void _emit( const char * name,
+                   char phase,
+                   int status )
+{
+    nce_trace_event_t event;
+    nce_trace_sink_t sink = traceSink;
+
+    if( sink != NULL )
+    {
+        event.name = name;
+        event.opId = currentOpId;
+        event.timestampUs = NceOSClockUs();
+        event.status = status;
+        event.phase = phase;
+        sink( traceSinkArg, &event );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_trace_set_sink( nce_trace_sink_t sink,
+                         void * arg )
+{
+    traceSink = NULL;
+    traceSinkArg = arg;
+    traceSink = sink;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_trace_op_begin( const char * name )
+{
+    #ifdef __GNUC__
+        currentOpId = __atomic_add_fetch( &lastOpId, 1, __ATOMIC_RELAXED );
+    #else
+        currentOpId = ++lastOpId;
+    #endif
+
+    _emit( name, NCE_TRACE_PHASE_BEGIN, 0 );
+
+    return currentOpId;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_trace_op_end( const char * name,
+                       int status )
+{
+    _emit( name, NCE_TRACE_PHASE_END, status );
+    currentOpId = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_trace_begin( const char * name )
+{
+    _emit( name, NCE_TRACE_PHASE_BEGIN, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_trace_end( const char * name,
+                    int status )
+{
+    _emit( name, NCE_TRACE_PHASE_END, status );
+}
+
+#endif /* ifdef NCE_SDK_TRACE */
@@ -0,0 +1,832 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2022 1NCE
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file nce_uplink_queue.c
+ * @brief Implements the store-and-forward queue in nce_uplink_queue.h.
+ *
+ * Sector layout: a header { seq, magic } followed by records. The sequence
+ * number is programmed before the magic, so a valid magic implies a complete
+ * header. Record layout, all words in native byte order:
+ *
+ *   state   0xFFFFFFFF while written, 0xFFFF0000 committed, 0 consumed
+ *   length  payload length in the low half, its complement in the high half
+ *   crc     CRC-32 of the payload
+ *   payload padded with 0xFF to a multiple of 4 bytes
+ *
+ * The state is only committed after the payload is synced, so power loss
+ * leaves either a complete record or one that recovery skips as torn.
+ */
+
+#include <string.h>
+#include "nce_uplink_queue.h"
+
+/**
+ * @brief Magic of a sector in use ("NCQ1").
+ */
+#define UPLINK_SECTOR_MAGIC       0x4E435131u
+
+/**
+ * @brief Bytes of the sector header.
+ */
+#define UPLINK_SECTOR_HEADER      8u
+
+/**
+ * @brief Bytes of the record header.
+ */
+#define UPLINK_RECORD_HEADER      12u
+
+/**
+ * @brief Value of an erased word.
+ */
+#define UPLINK_ERASED             0xFFFFFFFFu
+
+/**
+ * @brief State of a completely written record.
+ */
+#define UPLINK_STATE_COMMITTED    0xFFFF0000u
+
+/**
+ * @brief State of a sent record.
+ */
+#define UPLINK_STATE_CONSUMED     0x00000000u
+
+/**
+ * @brief Bytes read at once to check the CRC of a payload.
+ */
+#define UPLINK_CRC_CHUNK          32u
+
+/**
+ * @brief Size of a payload padded to a multiple of 4 bytes.
+ */
+#define UPLINK_ALIGN( n )    ( ( ( n ) + 3u ) & ~( ( size_t ) 3u ) )
+
+/**
+ * @brief What a record slot holds.
+ */
+typedef enum uplink_record_kind
+{
+    UPLINK_RECORD_FREE,     /**< Erased, the sector continues here. */
+    UPLINK_RECORD_CLOSED,   /**< No usable space is left in the sector. */
+    UPLINK_RECORD_TORN,     /**< Never committed or corrupted, skipped. */
+    UPLINK_RECORD_PENDING,  /**< Committed and not sent yet. */
+    UPLINK_RECORD_CONSUMED  /**< Sent. */
+} uplink_record_kind_t;
+
+/**
+ * @brief One record found in a sector.
+ */
+typedef struct uplink_record
+{
+    uplink_record_kind_t kind; /**< What the slot holds. */
+    size_t address;            /**< Storage offset of the record. */
+    size_t length;             /**< Payload length. */
+    size_t next;               /**< Sector offset of the following record. */
+} uplink_record_t;
+
+/**
+ * @brief Called for every record of a sector, returns 0 to continue, a
+ * positive value to stop or a negative error code.
+ */
+typedef int (* uplink_visit_t)( nce_uplink_queue_t * queue,
+                                const uplink_record_t * record,
+                                void * arg );
+
+/**
+ * @brief State of a running flush.
+ */
+typedef struct uplink_flush
+{
+    os_network_ops_t * osNetwork; /**< Session the frames are sent on. */
+    size_t maxFrames;             /**< Most frames to send, 0 for all. */
+    size_t sent;                  /**< Frames sent so far. */
+} uplink_flush_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read bytes of the storage.
+ */
+static int _read( const nce_uplink_queue_t * queue,
+                  size_t address,
+                  void * pBuffer,
+                  size_t length )
+{
+    const os_storage_ops_t * storage = queue->storage;
+
+    return ( storage->nce_os_storage_read( storage->os_storage, address, pBuffer, length ) == 0 ) ?
+           NCE_UPLINK_QUEUE_SUCCESS : NCE_UPLINK_QUEUE_STORAGE_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Program bytes of the storage.
+ */
+static int _write( const nce_uplink_queue_t * queue,
+                   size_t address,
+                   const void * pBuffer,
+                   size_t length )
+{
+    const os_storage_ops_t * storage = queue->storage;
+
+    return ( storage->nce_os_storage_write( storage->os_storage, address, pBuffer, length ) == 0 ) ?
+           NCE_UPLINK_QUEUE_SUCCESS : NCE_UPLINK_QUEUE_STORAGE_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Make the previous writes durable.
+ */
+static int _sync( const nce_uplink_queue_t * queue )
+{
+    const os_storage_ops_t * storage = queue->storage;
+
+    return ( storage->nce_os_storage_sync( storage->os_storage ) == 0 ) ?
+           NCE_UPLINK_QUEUE_SUCCESS : NCE_UPLINK_QUEUE_STORAGE_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Erase one sector of the ring.
+ */
+static int _erase( nce_uplink_queue_t * queue,
+                   uint32_t sector )
+{
+    const os_storage_ops_t * storage = queue->storage;
+
+    queue->stats.erases++;
+
+    return ( storage->nce_os_storage_erase( storage->os_storage, sector * storage->sectorSize ) == 0 ) ?
+           NCE_UPLINK_QUEUE_SUCCESS : NCE_UPLINK_QUEUE_STORAGE_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Continue a CRC-32 (IEEE 802.3), bitwise to keep the code small.
+ */
+static uint32_t _crc32_update( uint32_t crc,
+                               const uint8_t * data,
+                               size_t length )
+{
+    size_t i;
+    int bit;
+
+    for( i = 0; i < length; i++ )
+    {
+        crc ^= data[ i ];
+
+        for( bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320u & ( 0u - ( crc & 1u ) ) );
+        }
+    }
+
+    return crc;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief CRC-32 of a payload in storage.
+ */
+static int _payload_crc( const nce_uplink_queue_t * queue,
+                         size_t address,
+                         size_t length,
+                         uint32_t * crc )
+{
+    uint8_t chunk[ UPLINK_CRC_CHUNK ];
+    size_t done = 0;
+    size_t part;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    *crc = UPLINK_ERASED;
+
+    while( ( done < length ) && ( status == NCE_UPLINK_QUEUE_SUCCESS ) )
+    {
+        part = ( length - done < sizeof( chunk ) ) ? length - done : sizeof( chunk );
+        status = _read( queue, address + done, chunk, part );
+        *crc = _crc32_update( *crc, chunk, part );
+        done += part;
+    }
+
+    *crc ^= UPLINK_ERASED;
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Classify a record from its header words.
+ */
+static uplink_record_kind_t _classify( const uint32_t * words,
+                                       size_t offset,
+                                       size_t sectorSize,
+                                       size_t * length )
+{
+    uplink_record_kind_t kind;
+
+    *length = words[ 1 ] & 0xFFFFu;
+
+    if( ( words[ 0 ] == UPLINK_ERASED ) && ( words[ 1 ] == UPLINK_ERASED ) && ( words[ 2 ] == UPLINK_ERASED ) )
+    {
+        kind = UPLINK_RECORD_FREE;
+    }
+    else if( ( ( ( words[ 1 ] >> 16 ) ^ *length ) != 0xFFFFu ) || ( *length == 0u ) ||
+             ( offset + UPLINK_RECORD_HEADER + UPLINK_ALIGN( *length ) > sectorSize ) )
+    {
+        /* The length is not trustworthy, neither is anything behind it. */
+        kind = UPLINK_RECORD_CLOSED;
+    }
+    else if( words[ 0 ] == UPLINK_ERASED )
+    {
+        kind = UPLINK_RECORD_TORN;
+    }
+    else if( ( words[ 0 ] >> 16 ) != 0xFFFFu )
+    {
+        /* Consuming clears the high half, a torn consume counts as sent. */
+        kind = UPLINK_RECORD_CONSUMED;
+    }
+    else
+    {
+        kind = UPLINK_RECORD_PENDING;
+    }
+
+    return kind;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the record at an offset of a sector.
+ */
+static int _read_record( const nce_uplink_queue_t * queue,
+                         uint32_t sector,
+                         size_t offset,
+                         uplink_record_t * record )
+{
+    size_t sectorSize = queue->storage->sectorSize;
+    uint32_t words[ 3 ];
+    uint32_t crc = 0;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    record->kind = UPLINK_RECORD_CLOSED;
+    record->address = sector * sectorSize + offset;
+    record->length = 0;
+
+    if( offset + UPLINK_RECORD_HEADER <= sectorSize )
+    {
+        status = _read( queue, record->address, words, sizeof( words ) );
+    }
+    else
+    {
+        words[ 0 ] = 0;
+        words[ 1 ] = 0;
+        words[ 2 ] = 0;
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        record->kind = _classify( words, offset, sectorSize, &record->length );
+        record->next = offset + UPLINK_RECORD_HEADER + UPLINK_ALIGN( record->length );
+    }
+
+    if( ( status == NCE_UPLINK_QUEUE_SUCCESS ) && ( record->kind == UPLINK_RECORD_PENDING ) )
+    {
+        status = _payload_crc( queue, record->address + UPLINK_RECORD_HEADER, record->length, &crc );
+        record->kind = ( crc == words[ 2 ] ) ? UPLINK_RECORD_PENDING : UPLINK_RECORD_TORN;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Visit the records of a sector in order.
+ *
+ * @param[in] queue: Queue.
+ * @param[in] sector: Sector to walk.
+ * @param[in] visit: Called for every record.
+ * @param[in] arg: Passed to visit.
+ * @param[out] end: Offset new records can be appended at, sectorSize if the
+ * sector is closed. Only set when the walk completes.
+ *
+ * @return 0 if the walk completed, the positive value returned by visit to
+ * stop it, or a negative error code.
+ */
+static int _scan_sector( nce_uplink_queue_t * queue,
+                         uint32_t sector,
+                         uplink_visit_t visit,
+                         void * arg,
+                         size_t * end )
+{
+    uplink_record_t record;
+    size_t offset = UPLINK_SECTOR_HEADER;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    record.kind = UPLINK_RECORD_PENDING;
+
+    while( ( status == NCE_UPLINK_QUEUE_SUCCESS ) && ( record.kind != UPLINK_RECORD_FREE ) &&
+           ( record.kind != UPLINK_RECORD_CLOSED ) )
+    {
+        status = _read_record( queue, sector, offset, &record );
+
+        if( status != NCE_UPLINK_QUEUE_SUCCESS )
+        {
+            /* Storage error, returned as is. */
+        }
+        else if( ( record.kind == UPLINK_RECORD_FREE ) || ( record.kind == UPLINK_RECORD_CLOSED ) )
+        {
+            *end = ( record.kind == UPLINK_RECORD_FREE ) ? offset : queue->storage->sectorSize;
+        }
+        else
+        {
+            status = visit( queue, &record, arg );
+            offset = record.next;
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Count the records found on initialization.
+ */
+static int _visit_recover( nce_uplink_queue_t * queue,
+                           const uplink_record_t * record,
+                           void * arg )
+{
+    ( void ) arg;
+
+    if( record->kind == UPLINK_RECORD_PENDING )
+    {
+        queue->stats.recovered++;
+        queue->stats.pendingFrames++;
+        queue->stats.pendingBytes += ( uint32_t ) record->length;
+    }
+    else if( record->kind == UPLINK_RECORD_TORN )
+    {
+        queue->stats.torn++;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Count the pending records of a sector about to be erased.
+ */
+static int _visit_drop( nce_uplink_queue_t * queue,
+                        const uplink_record_t * record,
+                        void * arg )
+{
+    ( void ) arg;
+
+    if( record->kind == UPLINK_RECORD_PENDING )
+    {
+        queue->stats.dropped++;
+        queue->stats.pendingFrames--;
+        queue->stats.pendingBytes -= ( uint32_t ) record->length;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stop at the first pending record, a sector without any can be
+ * erased.
+ */
+static int _visit_reclaim( nce_uplink_queue_t * queue,
+                           const uplink_record_t * record,
+                           void * arg )
+{
+    ( void ) queue;
+    ( void ) arg;
+
+    return ( record->kind == UPLINK_RECORD_PENDING ) ? 1 : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send a pending record and mark it consumed.
+ */
+static int _visit_send( nce_uplink_queue_t * queue,
+                        const uplink_record_t * record,
+                        void * arg )
+{
+    uplink_flush_t * flush = ( uplink_flush_t * ) arg;
+    os_network_ops_t * osNetwork = flush->osNetwork;
+    uint8_t frame[ NCE_SDK_UPLINK_MAX_FRAME ];
+    uint32_t state = UPLINK_STATE_CONSUMED;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    if( record->kind != UPLINK_RECORD_PENDING )
+    {
+        return 0;
+    }
+
+    if( ( flush->maxFrames != 0u ) && ( flush->sent == flush->maxFrames ) )
+    {
+        return 1;
+    }
+
+    if( record->length > sizeof( frame ) )
+    {
+        /* Queued by a build with a larger limit, it cannot be sent. */
+        queue->stats.dropped++;
+    }
+    else
+    {
+        status = _read( queue, record->address + UPLINK_RECORD_HEADER, frame, record->length );
+
+        if( ( status == NCE_UPLINK_QUEUE_SUCCESS ) &&
+            ( osNetwork->nce_os_udp_send( osNetwork->os_socket, frame, record->length ) != ( int ) record->length ) )
+        {
+            queue->stats.sendFailures++;
+            status = NCE_UPLINK_QUEUE_SEND_ERROR;
+        }
+        else if( status == NCE_UPLINK_QUEUE_SUCCESS )
+        {
+            queue->stats.sent++;
+            flush->sent++;
+        }
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _write( queue, record->address, &state, sizeof( state ) );
+        queue->stats.pendingFrames--;
+        queue->stats.pendingBytes -= ( uint32_t ) record->length;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the header of a sector.
+ *
+ * @return 1 if the sector is in use, 0 if not, or a negative error code.
+ */
+static int _read_header( const nce_uplink_queue_t * queue,
+                         uint32_t sector,
+                         uint32_t * seq )
+{
+    uint32_t header[ 2 ];
+    int status = _read( queue, sector * queue->storage->sectorSize, header, sizeof( header ) );
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        *seq = header[ 1 ];
+        status = ( header[ 0 ] == UPLINK_SECTOR_MAGIC ) ? 1 : 0;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the ring of sectors in use: the tail has the highest sequence
+ * number, the head is reached walking back through consecutive ones.
+ */
+static int _find_ring( nce_uplink_queue_t * queue )
+{
+    uint32_t seq = 0;
+    uint32_t previous;
+    uint32_t i;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+    int linked = 1;
+
+    for( i = 0; ( i < queue->sectors ) && ( status >= 0 ); i++ )
+    {
+        status = _read_header( queue, i, &seq );
+
+        if( ( status == 1 ) && ( ( queue->usedSectors == 0u ) || ( seq > queue->tailSeq ) ) )
+        {
+            queue->tailSector = i;
+            queue->tailSeq = seq;
+            queue->usedSectors = 1;
+        }
+    }
+
+    queue->headSector = queue->tailSector;
+
+    while( ( status >= 0 ) && linked && ( queue->usedSectors > 0u ) && ( queue->usedSectors < queue->sectors ) )
+    {
+        previous = ( queue->headSector + queue->sectors - 1u ) % queue->sectors;
+        status = _read_header( queue, previous, &seq );
+        linked = ( status == 1 ) && ( seq == queue->tailSeq - queue->usedSectors );
+
+        if( linked )
+        {
+            queue->headSector = previous;
+            queue->usedSectors++;
+        }
+    }
+
+    return ( status < 0 ) ? status : NCE_UPLINK_QUEUE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start a new tail sector, erasing the head sector first when the
+ * ring is full.
+ */
+static int _open_sector( nce_uplink_queue_t * queue )
+{
+    uint32_t next = ( queue->usedSectors == 0u ) ? queue->tailSector : ( queue->tailSector + 1u ) % queue->sectors;
+    uint32_t seq = queue->tailSeq + 1u;
+    uint32_t magic = UPLINK_SECTOR_MAGIC;
+    size_t address = next * queue->storage->sectorSize;
+    size_t end;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    if( queue->usedSectors == queue->sectors )
+    {
+        status = _scan_sector( queue, queue->headSector, _visit_drop, NULL, &end );
+        queue->headSector = ( queue->headSector + 1u ) % queue->sectors;
+        queue->usedSectors--;
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _erase( queue, next );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _write( queue, address + 4u, &seq, sizeof( seq ) );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _sync( queue );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _write( queue, address, &magic, sizeof( magic ) );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        queue->headSector = ( queue->usedSectors == 0u ) ? next : queue->headSector;
+        queue->tailSector = next;
+        queue->tailSeq = seq;
+        queue->tailOffset = UPLINK_SECTOR_HEADER;
+        queue->usedSectors++;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a record at the end of the tail sector and commit it.
+ */
+static int _append( nce_uplink_queue_t * queue,
+                    const uint8_t * frame,
+                    size_t length )
+{
+    size_t address = queue->tailSector * queue->storage->sectorSize + queue->tailOffset;
+    size_t body = length & ~( ( size_t ) 3u );
+    uint32_t state = UPLINK_STATE_COMMITTED;
+    uint32_t words[ 2 ];
+    uint8_t last[ 4 ];
+    int status;
+
+    words[ 0 ] = ( uint32_t ) length | ( ( ( uint32_t ) length ^ 0xFFFFu ) << 16 );
+    words[ 1 ] = _crc32_update( UPLINK_ERASED, frame, length ) ^ UPLINK_ERASED;
+    memset( last, 0xFF, sizeof( last ) );
+    memcpy( last, frame + body, length - body );
+
+    /* Space of a failed record is never reused, it is not erased. */
+    queue->tailOffset += UPLINK_RECORD_HEADER + UPLINK_ALIGN( length );
+
+    status = _write( queue, address + 4u, words, sizeof( words ) );
+
+    if( ( status == NCE_UPLINK_QUEUE_SUCCESS ) && ( body > 0u ) )
+    {
+        status = _write( queue, address + UPLINK_RECORD_HEADER, frame, body );
+    }
+
+    if( ( status == NCE_UPLINK_QUEUE_SUCCESS ) && ( body < length ) )
+    {
+        status = _write( queue, address + UPLINK_RECORD_HEADER + body, last, sizeof( last ) );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _sync( queue );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _write( queue, address, &state, sizeof( state ) );
+    }
+
+    return ( status == NCE_UPLINK_QUEUE_SUCCESS ) ? _sync( queue ) : status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Erase head sectors without pending records, the tail stays.
+ */
+static int _reclaim( nce_uplink_queue_t * queue )
+{
+    size_t end;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    while( ( status == NCE_UPLINK_QUEUE_SUCCESS ) && ( queue->usedSectors > 1u ) )
+    {
+        status = _scan_sector( queue, queue->headSector, _visit_reclaim, NULL, &end );
+
+        if( status == NCE_UPLINK_QUEUE_SUCCESS )
+        {
+            status = _erase( queue, queue->headSector );
+            queue->headSector = ( queue->headSector + 1u ) % queue->sectors;
+            queue->usedSectors--;
+        }
+    }
+
+    return ( status < 0 ) ? status : NCE_UPLINK_QUEUE_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the pending records of all sectors over a connected session.
+ */
+static int _send_pending( nce_uplink_queue_t * queue,
+                          uplink_flush_t * flush )
+{
+    size_t end;
+    uint32_t i;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    for( i = 0; ( i < queue->usedSectors ) && ( status == NCE_UPLINK_QUEUE_SUCCESS ); i++ )
+    {
+        status = _scan_sector( queue, ( queue->headSector + i ) % queue->sectors, _visit_send, flush, &end );
+    }
+
+    /* Consumed marks are synced once per flush, losing them resends frames. */
+    if( _sync( queue ) != NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = NCE_UPLINK_QUEUE_STORAGE_ERROR;
+    }
+
+    return ( status > 0 ) ? NCE_UPLINK_QUEUE_SUCCESS : status;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_uplink_queue_init( nce_uplink_queue_t * queue,
+                           const os_storage_ops_t * storage )
+{
+    size_t end = UPLINK_SECTOR_HEADER;
+    uint32_t i;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    memset( queue, 0, sizeof( *queue ) );
+    queue->storage = storage;
+
+    if( ( storage->sectorSize < UPLINK_SECTOR_HEADER + UPLINK_RECORD_HEADER + 4u ) ||
+        ( ( storage->sectorSize % 4u ) != 0u ) || ( storage->size / storage->sectorSize < 2u ) )
+    {
+        status = NCE_UPLINK_QUEUE_STORAGE_ERROR;
+    }
+    else
+    {
+        queue->sectors = ( uint32_t ) ( storage->size / storage->sectorSize );
+        status = _find_ring( queue );
+    }
+
+    for( i = 0; ( i < queue->usedSectors ) && ( status == NCE_UPLINK_QUEUE_SUCCESS ); i++ )
+    {
+        status = _scan_sector( queue, ( queue->headSector + i ) % queue->sectors, _visit_recover, NULL, &end );
+    }
+
+    /* The last sector walked is the tail. */
+    queue->tailOffset = end;
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_uplink_queue_push( nce_uplink_queue_t * queue,
+                           const void * frame,
+                           size_t length )
+{
+    size_t needed = UPLINK_RECORD_HEADER + UPLINK_ALIGN( length );
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+
+    if( ( length == 0u ) || ( length > NCE_SDK_UPLINK_MAX_FRAME ) ||
+        ( needed > queue->storage->sectorSize - UPLINK_SECTOR_HEADER ) )
+    {
+        status = NCE_UPLINK_QUEUE_FRAME_SIZE_ERROR;
+    }
+    else if( ( queue->usedSectors == 0u ) || ( queue->tailOffset + needed > queue->storage->sectorSize ) )
+    {
+        status = _open_sector( queue );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        status = _append( queue, ( const uint8_t * ) frame, length );
+    }
+
+    if( status == NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        queue->stats.enqueued++;
+        queue->stats.pendingFrames++;
+        queue->stats.pendingBytes += ( uint32_t ) length;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_uplink_queue_flush( nce_uplink_queue_t * queue,
+                            os_network_ops_t * osNetwork,
+                            OSEndPoint_t endpoint,
+                            size_t maxFrames,
+                            size_t * sent )
+{
+    uplink_flush_t flush;
+    int status = NCE_UPLINK_QUEUE_SUCCESS;
+    int reclaimed;
+
+    flush.osNetwork = osNetwork;
+    flush.maxFrames = maxFrames;
+    flush.sent = 0;
+
+    if( queue->stats.pendingFrames == 0u )
+    {
+        /* Nothing to send, the radio stays off. */
+    }
+    else if( osNetwork->nce_os_udp_connect( osNetwork->os_socket, endpoint ) != 0 )
+    {
+        status = NCE_UPLINK_QUEUE_CONNECT_ERROR;
+    }
+    else
+    {
+        status = _send_pending( queue, &flush );
+        ( void ) osNetwork->nce_os_udp_disconnect( osNetwork->os_socket );
+        reclaimed = _reclaim( queue );
+        status = ( status == NCE_UPLINK_QUEUE_SUCCESS ) ? reclaimed : status;
+    }
+
+    if( sent != NULL )
+    {
+        *sent = flush.sent;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_uplink_queue_get_stats( const nce_uplink_queue_t * queue,
+                                 nce_uplink_queue_stats_t * stats )
+{
+    *stats = queue->stats;
+}
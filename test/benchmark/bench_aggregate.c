@@ -0,0 +1,197 @@
+/**
+ * @file bench_aggregate.c
+ * @brief Cost of adding a sample to the edge aggregator (nce_aggregate.h),
+ * and the uplink of a day of samples sent raw, one Energy Saver record per
+ * sample, against one aggregated record per window.
+ *
+ * The device samples a temperature and a humidity. Raw, each sample period
+ * sends both as floats. Aggregated, each window sends the temperature
+ * minimum, maximum, mean and count, its histogram and the humidity mean.
+ * Datagram bytes include the IPv4 and UDP headers.
+ *
+ * Usage: bench_aggregate [timed samples] [sample period s] [window s]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_aggregate.h"
+
+/* IPv4 and UDP headers of a datagram */
+#define DATAGRAM_HEADERS    28u
+
+#define SECONDS_PER_DAY     86400u
+
+#define SELECTOR            1u
+
+static const nce_aggregate_slot_t slots[] =
+{
+    { 0, NCE_AGGREGATE_MIN,        E_INTEGER, 2, 10.0f },
+    { 0, NCE_AGGREGATE_MAX,        E_INTEGER, 2, 10.0f },
+    { 0, NCE_AGGREGATE_MEAN,       E_INTEGER, 2, 10.0f },
+    { 0, NCE_AGGREGATE_COUNT,      E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET,     E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 1, E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 2, E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 3, E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 4, E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 5, E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 6, E_INTEGER, 2, 0.0f  },
+    { 0, NCE_AGGREGATE_BUCKET + 7, E_INTEGER, 2, 0.0f  },
+    { 1, NCE_AGGREGATE_MEAN,       E_CHAR,    1, 0.0f  }
+};
+
+/*-----------------------------------------------------------*/
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000u + ( uint64_t ) ts.tv_nsec;
+}
+
+/**
+ * @brief Temperature of sample n, a daily cycle with some noise.
+ */
+static float temperature( uint32_t n )
+{
+    return 15.0f + ( float ) ( ( n / 60u ) % 24u ) * 0.5f + ( float ) ( n % 7u ) * 0.1f;
+}
+
+static void init( nce_aggregate_t * agg,
+                  uint32_t windowS )
+{
+    ( void ) nce_aggregate_init( agg, 2, SELECTOR, slots, sizeof( slots ) / sizeof( slots[ 0 ] ), windowS * 1000u );
+    ( void ) nce_aggregate_set_histogram( agg, 0, 10.0f, 34.0f );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Time nce_aggregate_add(), emitting when due as a device would.
+ */
+static double bench_add( long samples,
+                         uint32_t periodS,
+                         uint32_t windowS,
+                         unsigned long * records )
+{
+    static nce_aggregate_t agg;
+    uint8_t packet[ 64 ];
+    uint32_t nowUs = 0;
+    uint64_t start;
+    long n;
+
+    init( &agg, windowS );
+    *records = 0;
+    start = now_ns();
+
+    for( n = 0; n < samples; n++ )
+    {
+        if( nce_aggregate_add( &agg, ( size_t ) n & 1u, temperature( ( uint32_t ) n ), nowUs ) == NCE_AGGREGATE_DUE )
+        {
+            *records += ( nce_aggregate_emit( &agg, packet, sizeof( packet ) ) > 0 ) ? 1u : 0u;
+        }
+
+        nowUs += ( n & 1 ) ? periodS * 1000000u : 0u;
+    }
+
+    return ( double ) ( now_ns() - start ) / ( double ) samples;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Uplink of a day, raw and aggregated, as datagrams and bytes.
+ */
+static int run_day( uint32_t periodS,
+                    uint32_t windowS )
+{
+    static nce_aggregate_t agg;
+    Element2byte_gen_t raw[ 2 ] = { { E_FLOAT, { 0 }, 4 }, { E_FLOAT, { 0 }, 4 } };
+    uint8_t packet[ 64 ];
+    unsigned long rawDatagrams = 0;
+    unsigned long rawBytes = 0;
+    unsigned long datagrams = 0;
+    unsigned long bytes = 0;
+    uint32_t nowUs = 0;
+    uint32_t second;
+    int length;
+
+    init( &agg, windowS );
+
+    for( second = 0; second < SECONDS_PER_DAY; second += periodS )
+    {
+        raw[ 0 ].value.f = temperature( second / periodS );
+        raw[ 1 ].value.f = 55.0f;
+        length = os_energy_save_v2( packet, sizeof( packet ), SELECTOR, raw, 2 );
+
+        if( length < 0 )
+        {
+            return 1;
+        }
+
+        rawDatagrams++;
+        rawBytes += ( unsigned long ) length + DATAGRAM_HEADERS;
+
+        ( void ) nce_aggregate_add( &agg, 1, raw[ 1 ].value.f, nowUs );
+
+        if( nce_aggregate_add( &agg, 0, raw[ 0 ].value.f, nowUs ) == NCE_AGGREGATE_DUE )
+        {
+            length = nce_aggregate_emit( &agg, packet, sizeof( packet ) );
+
+            if( length < 0 )
+            {
+                return 1;
+            }
+
+            datagrams++;
+            bytes += ( unsigned long ) length + DATAGRAM_HEADERS;
+        }
+
+        nowUs += periodS * 1000000u;
+    }
+
+    length = nce_aggregate_emit( &agg, packet, sizeof( packet ) );
+
+    if( length > 0 )
+    {
+        datagrams++;
+        bytes += ( unsigned long ) length + DATAGRAM_HEADERS;
+    }
+
+    printf( "%-10s %10lu %12lu\n", "raw", rawDatagrams, rawBytes );
+    printf( "%-10s %10lu %12lu  (%.1fx fewer bytes)\n", "aggregated", datagrams, bytes,
+            ( double ) rawBytes / ( double ) bytes );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    long samples = ( argc > 1 ) ? atol( argv[ 1 ] ) : 10000000;
+    int periodS = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 1;
+    int windowS = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 3600;
+    unsigned long records;
+    double ns;
+
+    /* Sample periods longer than an hour would wrap the 32-bit clock. */
+    if( ( samples <= 0 ) || ( periodS <= 0 ) || ( periodS > 3600 ) || ( windowS < periodS ) || ( windowS > 86400 ) )
+    {
+        fprintf( stderr, "usage: %s [timed samples] [sample period s, at most 3600] [window s]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    ns = bench_add( samples, ( uint32_t ) periodS, ( uint32_t ) windowS, &records );
+    printf( "%ld samples, %d fields, %d buckets: %.1f ns/sample, %lu records\n", samples, 2,
+            NCE_SDK_AGGREGATE_BUCKETS, ns, records );
+    printf( "one day, a sample every %d s, %d s windows\n", periodS, windowS );
+    printf( "%-10s %10s %12s\n", "uplink", "datagrams", "bytes" );
+
+    return run_day( ( uint32_t ) periodS, ( uint32_t ) windowS );
+}
@@ -0,0 +1,207 @@
+/**
+ * @file bench_chunk_mtu.c
+ * @brief Upload of a Memfault-sized blob in CoAP chunks over simulated links
+ * with different MTUs, with fixed chunk sizes against the adaptive payload
+ * limit of nce_chunk_size.h, measured on the virtual time of the network
+ * simulator.
+ *
+ * Each chunk is one datagram of the payload plus the DTLS and CoAP overhead,
+ * acknowledged by the remote. A chunk that times out is sent again, from the
+ * same offset at the current limit, up to a number of attempts.
+ *
+ * Usage: bench_chunk_mtu [blob bytes] [loss %] [runs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nce_chunk_size.h"
+#include "nce_netsim.h"
+
+/* DTLS record (CCM_8) plus CoAP header, token, Uri options and content format */
+#define BENCH_OVERHEAD      96u
+
+/* Attempts of one chunk before the upload is abandoned */
+#define BENCH_ATTEMPTS      4
+
+/* Bounds of the adaptive limit */
+#define BENCH_MIN_CHUNK     64u
+#define BENCH_MAX_CHUNK     1024u
+#define BENCH_INIT_CHUNK    256u
+
+/**
+ * @brief A simulated path: largest datagram per IP packet, and the chance
+ * each extra fragment is lost.
+ */
+typedef struct bench_path
+{
+    const char * name;
+    uint32_t mtu;
+    unsigned int fragmentLossPercent;
+} bench_path_t;
+
+/**
+ * @brief Totals of the uploads of one strategy over one path.
+ */
+typedef struct bench_result
+{
+    unsigned long completed;
+    unsigned long datagrams;
+    unsigned long long bytes;
+    uint64_t timeUs;
+    unsigned long fragmented;
+} bench_result_t;
+
+static const bench_path_t paths[] =
+{
+    { "eth_1472",        1472u, 0u   },
+    { "lte_1000",        1000u, 10u  },
+    { "nbiot_480",       480u,  30u  },
+    { "nbiot_480_nofrag", 480u, 100u },
+};
+
+/* Chunk strategies: fixed sizes, 0 for adaptive */
+static const size_t strategies[] = { 128u, 512u, 0u };
+
+static const OSEndPoint_t proxy = { "coap.proxy.os.1nce.com", 5684 };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send one chunk and wait for its acknowledgement.
+ */
+static int send_chunk( os_network_ops_t * ops,
+                       uint8_t * datagram,
+                       size_t payload,
+                       uint16_t messageId )
+{
+    uint8_t response[ 16 ];
+
+    datagram[ 0 ] = 0x40; /* CON, no token */
+    datagram[ 1 ] = 0x02; /* POST */
+    datagram[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    datagram[ 3 ] = ( uint8_t ) messageId;
+
+    if( ops->nce_os_udp_send( ops->os_socket, datagram, BENCH_OVERHEAD + payload ) < 0 )
+    {
+        return 0;
+    }
+
+    return ops->nce_os_udp_recv( ops->os_socket, response, sizeof( response ) ) > 0;
+}
+
+/**
+ * @brief Upload a blob, returns 1 if all of it was acknowledged.
+ */
+static int upload( nce_netsim_t * sim,
+                   os_network_ops_t * ops,
+                   nce_chunk_size_t * cache,
+                   size_t fixed,
+                   size_t blob )
+{
+    static uint8_t datagram[ NCE_NETSIM_MAX_DATAGRAM ];
+    uint16_t messageId = 0;
+    size_t offset = 0;
+    size_t payload;
+    int attempts = 0;
+    int acked;
+
+    ( void ) sim;
+    ops->nce_os_udp_connect( ops->os_socket, proxy );
+
+    while( ( offset < blob ) && ( attempts < BENCH_ATTEMPTS ) )
+    {
+        payload = ( fixed != 0u ) ? fixed : nce_chunk_size_get( cache, &proxy );
+        payload = ( payload < blob - offset ) ? payload : blob - offset;
+        acked = send_chunk( ops, datagram, payload, ++messageId );
+
+        if( fixed == 0u )
+        {
+            nce_chunk_size_report( cache, &proxy, payload, acked );
+        }
+
+        offset += acked ? payload : 0u;
+        attempts = acked ? 0 : attempts + 1;
+    }
+
+    ops->nce_os_udp_disconnect( ops->os_socket );
+
+    return offset == blob;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int blob = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 16384;
+    int lossPercent = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 2;
+    int runs = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 200;
+    size_t p;
+    size_t s;
+    int r;
+
+    if( ( blob <= 0 ) || ( lossPercent < 0 ) || ( lossPercent > 100 ) || ( runs <= 0 ) )
+    {
+        fprintf( stderr, "usage: %s [blob bytes] [loss %%] [runs]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    printf( "%d runs of a %d byte blob, %u bytes overhead per chunk, %d%% loss, 300 ms latency, 2 s timeout\n",
+            runs, blob, BENCH_OVERHEAD, lossPercent );
+    printf( "%-17s %-9s %9s %10s %10s %12s %11s\n", "path", "chunk", "complete", "dgrams/run",
+            "frag/run", "bytes/run", "seconds/run" );
+
+    for( p = 0; p < sizeof( paths ) / sizeof( paths[ 0 ] ); p++ )
+    {
+        for( s = 0; s < sizeof( strategies ) / sizeof( strategies[ 0 ] ); s++ )
+        {
+            nce_netsim_config_t config;
+            nce_chunk_size_t cache;
+            bench_result_t result;
+            char name[ 16 ];
+
+            memset( &config, 0, sizeof( config ) );
+            memset( &result, 0, sizeof( result ) );
+            config.lossPercent = ( unsigned int ) lossPercent;
+            config.latencyUs = 300000u;
+            config.jitterUs = 60000u;
+            config.recvTimeoutUs = 2000000u;
+            config.mtu = paths[ p ].mtu;
+            config.fragmentLossPercent = paths[ p ].fragmentLossPercent;
+
+            /* The cache outlives the uploads, as in the Memfault sender. */
+            nce_chunk_size_init( &cache, BENCH_MIN_CHUNK, BENCH_MAX_CHUNK, BENCH_INIT_CHUNK );
+
+            for( r = 0; r < runs; r++ )
+            {
+                nce_netsim_t sim;
+                os_network_ops_t ops;
+
+                config.seed = ( uint32_t ) r + 1u;
+                nce_netsim_init( &sim, &config, nce_netsim_ack_responder, NULL, &ops );
+                result.completed += ( unsigned long ) upload( &sim, &ops, &cache, strategies[ s ], ( size_t ) blob );
+                result.datagrams += sim.stats.datagramsSent;
+                result.bytes += sim.stats.bytesSent;
+                result.fragmented += sim.stats.fragmented;
+                result.timeUs += sim.nowUs;
+            }
+
+            if( strategies[ s ] != 0u )
+            {
+                snprintf( name, sizeof( name ), "fixed_%lu", ( unsigned long ) strategies[ s ] );
+            }
+            else
+            {
+                snprintf( name, sizeof( name ), "adapt_%u", ( unsigned int ) nce_chunk_size_get( &cache, &proxy ) );
+            }
+
+            printf( "%-17s %-9s %8.1f%% %10.1f %10.1f %12.0f %11.1f\n", paths[ p ].name, name,
+                    100.0 * result.completed / runs, ( double ) result.datagrams / runs,
+                    ( double ) result.fragmented / runs, ( double ) result.bytes / runs,
+                    ( double ) result.timeUs / runs / 1e6 );
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file bench_downlink.c
+ * @brief Cost of dispatching a server-initiated datagram (nce_downlink.h)
+ * per path: new request, retransmitted request answered from the cache,
+ * acknowledgement of a notification and ping. Then the daily traffic of a
+ * device polling its configuration against the server pushing changes.
+ *
+ * Polling, the device sends a confirmable GET of its configuration every
+ * interval and gets a piggybacked 2.05. Pushing, the server sends a
+ * confirmable PUT per change and the dispatcher acknowledges it. Message
+ * sizes are those the dispatcher produces; datagram bytes include the IPv4
+ * and UDP headers.
+ *
+ * Usage: bench_downlink [timed datagrams] [poll interval s] [changes per day]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_downlink.h"
+
+/* IPv4 and UDP headers of a datagram */
+#define DATAGRAM_HEADERS    28u
+
+#define SECONDS_PER_DAY     86400u
+
+static size_t lastSent;
+
+static const char configuration[] = "{\"interval\":900,\"threshold\":25}";
+
+/*-----------------------------------------------------------*/
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000u + ( uint64_t ) ts.tv_nsec;
+}
+
+/**
+ * @brief Socket sending nowhere, recording the length of the last datagram.
+ */
+static int null_send( OSNetwork_t osnetwork,
+                      void * pBuffer,
+                      size_t bytesToSend )
+{
+    ( void ) osnetwork;
+    ( void ) pBuffer;
+    lastSent = bytesToSend;
+
+    return ( int ) bytesToSend;
+}
+
+static void config_handler( void * arg,
+                            const nce_downlink_request_t * request,
+                            nce_downlink_response_t * response )
+{
+    ( void ) arg;
+
+    if( request->method == NCE_COAP_GET )
+    {
+        response->contentFormat = 50; /* application/json */
+        response->payloadLength = sizeof( configuration ) - 1u;
+        memcpy( response->payload, configuration, response->payloadLength );
+    }
+}
+
+static const nce_downlink_resource_t resources[] =
+{
+    { "config", config_handler, NULL, true }
+};
+
+/**
+ * @brief Confirmable request to "config" with a 4-byte token.
+ *
+ * @return Length of the request.
+ */
+static size_t build_request( uint8_t * message,
+                             uint8_t method,
+                             uint16_t messageId,
+                             const char * payload )
+{
+    size_t length = 0;
+
+    message[ length++ ] = 0x44;
+    message[ length++ ] = method;
+    message[ length++ ] = ( uint8_t ) ( messageId >> 8 );
+    message[ length++ ] = ( uint8_t ) messageId;
+    memcpy( &message[ length ], "\x01\x02\x03\x04", 4 );
+    length += 4;
+    message[ length++ ] = 0xB6;
+    memcpy( &message[ length ], "config", 6 );
+    length += 6;
+
+    if( payload != NULL )
+    {
+        message[ length++ ] = 0xFF;
+        memcpy( &message[ length ], payload, strlen( payload ) );
+        length += strlen( payload );
+    }
+
+    return length;
+}
+
+/**
+ * @brief Time one path of the dispatcher.
+ */
+static void bench_path( nce_downlink_t * downlink,
+                        const char * name,
+                        const uint8_t * datagram,
+                        size_t length,
+                        int varyId,
+                        long iterations )
+{
+    uint8_t message[ NCE_SDK_DOWNLINK_BUFFER_SIZE ];
+    uint64_t start;
+    uint64_t elapsed;
+    long i;
+
+    memcpy( message, datagram, length );
+    start = now_ns();
+
+    for( i = 0; i < iterations; i++ )
+    {
+        if( varyId )
+        {
+            message[ 2 ] = ( uint8_t ) ( i >> 8 );
+            message[ 3 ] = ( uint8_t ) i;
+        }
+
+        ( void ) nce_downlink_process( downlink, message, length );
+    }
+
+    elapsed = now_ns() - start;
+    printf( "%-22s %8.1f ns/datagram\n", name, ( double ) elapsed / ( double ) iterations );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    long iterations = ( argc > 1 ) ? atol( argv[ 1 ] ) : 1000000L;
+    long interval = ( argc > 2 ) ? atol( argv[ 2 ] ) : 900L;
+    long changes = ( argc > 3 ) ? atol( argv[ 3 ] ) : 4L;
+    static nce_downlink_t downlink;
+    os_network_ops_t ops;
+    uint8_t message[ NCE_SDK_DOWNLINK_BUFFER_SIZE ];
+    uint8_t ack[ 4 ] = { 0x60, 0x00, 0x00, 0x00 };
+    uint8_t ping[ 4 ] = { 0x40, 0x00, 0x00, 0x00 };
+    size_t getLength;
+    size_t getResponse;
+    size_t putLength;
+    size_t putResponse;
+    unsigned long polls;
+    unsigned long pollBytes;
+    unsigned long pushBytes;
+
+    if( ( iterations <= 0 ) || ( interval <= 0 ) || ( changes < 0 ) )
+    {
+        fprintf( stderr, "usage: %s [timed datagrams] [poll interval s] [changes per day]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    memset( &ops, 0, sizeof( ops ) );
+    ops.nce_os_udp_send = null_send;
+    nce_downlink_init( &downlink, &ops, resources, sizeof( resources ) / sizeof( resources[ 0 ] ) );
+
+    /* Sizes of the exchanges. */
+    getLength = build_request( message, NCE_COAP_GET, 1, NULL );
+    ( void ) nce_downlink_process( &downlink, message, getLength );
+    getResponse = lastSent;
+    putLength = build_request( message, NCE_COAP_PUT, 2, configuration );
+    ( void ) nce_downlink_process( &downlink, message, putLength );
+    putResponse = lastSent;
+
+    printf( "dispatcher state: %u bytes\n", ( unsigned int ) sizeof( nce_downlink_t ) );
+    bench_path( &downlink, "new PUT request", message, putLength, 1, iterations );
+    bench_path( &downlink, "retransmitted request", message, putLength, 0, iterations );
+    bench_path( &downlink, "acknowledgement", ack, sizeof( ack ), 1, iterations );
+    bench_path( &downlink, "ping", ping, sizeof( ping ), 1, iterations );
+
+    polls = SECONDS_PER_DAY / ( unsigned long ) interval;
+    pollBytes = polls * ( getLength + getResponse + 2u * DATAGRAM_HEADERS );
+    pushBytes = ( unsigned long ) changes * ( putLength + putResponse + 2u * DATAGRAM_HEADERS );
+    printf( "per day, polling every %ld s: %lu exchanges, %lu datagrams, %lu bytes\n", interval, polls,
+            2u * polls, pollBytes );
+    printf( "per day, %ld pushed changes: %lu exchanges, %lu datagrams, %lu bytes\n", changes,
+            ( unsigned long ) changes, 2u * ( unsigned long ) changes, pushBytes );
+
+    return 0;
+}
@@ -0,0 +1,523 @@
+/**
+ * @file bench_dtls_model.c
+ * @brief Modelled handshake bytes and round trips of periodic uplinks over
+ * DTLS 1.2, with a full handshake per uplink, session resumption, and a
+ * session kept open with and without a Connection ID (RFC 9146), on the
+ * virtual time of the network simulator.
+ *
+ * No DTLS stack runs: both ends exchange placeholder flights sized for PSK
+ * with AES-128-CCM-8 (no certificates, no ServerKeyExchange), so the figures
+ * are a model of the handshake cost, not a measurement of mbed TLS. Between uplinks the device sleeps; a sleep longer than
+ * the NAT binding timeout gives the device a new source address. The server
+ * drops records of an established session arriving from another address
+ * unless the session negotiated a Connection ID. Sessions older than the
+ * server cache lifetime are forgotten.
+ *
+ * With PSK the full handshake is already small: resumption mostly saves a
+ * round trip, the session ID it carries twice costs about what the skipped
+ * ClientKeyExchange saves. Only a kept session skips the handshake.
+ *
+ * Built with NCE_SDK_OSCORE, the same uplinks are also protected with OSCORE
+ * (nce_oscore.h) and sent to the OSCORE stand-in (nce_oscore_server.h): real
+ * protected messages, one round trip each, bound to no session or address.
+ *
+ * Usage: bench_dtls_model [uplinks] [interval s] [nat timeout s] [loss %]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nce_netsim.h"
+
+#ifdef NCE_SDK_OSCORE
+    #include "nce_oscore.h"
+    #include "nce_oscore_server.h"
+#endif
+
+/* Flights, first byte of each datagram, answers echo it */
+#define FLIGHT_HELLO             1 /* ClientHello, HelloVerifyRequest */
+#define FLIGHT_HELLO_COOKIE      2 /* ClientHello with cookie, ServerHello..ServerHelloDone */
+#define FLIGHT_RESUME            3 /* ClientHello with session ID, HelloVerifyRequest */
+#define FLIGHT_RESUME_COOKIE     4 /* ClientHello with session ID and cookie, ServerHello CCS Finished */
+#define FLIGHT_FINISHED          5 /* ClientKeyExchange CCS Finished, CCS Finished */
+#define FLIGHT_APP               6 /* CoAP uplink, piggybacked ACK */
+#define FLIGHT_FINISHED_APP      7 /* CCS Finished with the uplink, ACK */
+
+/* Flight sizes in bytes, DTLS records included */
+#define SIZE_CLIENT_HELLO        80u
+#define SIZE_SESSION_ID          32u
+#define SIZE_COOKIE              32u
+#define SIZE_HELLO_VERIFY        60u
+#define SIZE_SERVER_HELLO_DONE   126u
+#define SIZE_CLIENT_FINISHED     113u
+#define SIZE_SERVER_FINISHED     67u
+#define SIZE_RESUMED_HELLO       181u
+#define SIZE_FINISHED            67u
+#define SIZE_CID                 8u  /* Connection ID carried by each record towards the server */
+
+/* CoAP uplink and ACK, with the DTLS record header, nonce and tag */
+#define SIZE_UPLINK              69u
+#define SIZE_ACK                 33u
+
+/* CoAP uplink alone: the DTLS record adds 13 bytes of header, 8 of nonce and 8 of tag */
+#define SIZE_COAP_UPLINK         ( SIZE_UPLINK - 29u )
+
+/* Sends of one flight before giving up, and uplink attempts on a kept session */
+#define BENCH_ATTEMPTS           4
+#define BENCH_KEPT_ATTEMPTS      2
+
+/* Server session cache lifetime */
+#define BENCH_SESSION_LIFETIME_S    ( 24u * 3600u )
+
+/**
+ * @brief How the device treats its session between uplinks.
+ */
+typedef enum bench_strategy
+{
+    BENCH_FULL = 0,    /**< Close after each uplink, full handshake each time. */
+    BENCH_RESUME,      /**< Close after each uplink, resume the cached session. */
+    BENCH_KEEP,        /**< Keep the socket open, no Connection ID. */
+    BENCH_KEEP_CID,    /**< Keep the socket open with a Connection ID. */
+#ifdef NCE_SDK_OSCORE
+    BENCH_OSCORE,      /**< No DTLS, each uplink protected with OSCORE. */
+#endif
+    BENCH_STRATEGIES
+} bench_strategy_t;
+
+static const char * const names[] = { "full", "resumption", "keep", "keep_cid", "oscore" };
+
+/**
+ * @brief The DTLS model server, and the address the device sends from.
+ */
+typedef struct bench_link
+{
+    nce_netsim_t sim;
+    os_network_ops_t ops;
+    uint8_t address;        /**< Source address of the device after NAT. */
+    int cid;                /**< The device negotiates a Connection ID. */
+    int cached;             /**< The device holds a session to resume. */
+    int established;        /**< The server holds a session. */
+    uint8_t boundAddress;   /**< Address the session is bound to. */
+    uint64_t sessionUs;     /**< Virtual time the session was established. */
+#ifdef NCE_SDK_OSCORE
+    nce_oscore_server_t oscoreServer;   /**< OSCORE stand-in, answering CoAP datagrams. */
+    nce_oscore_context_t oscore;        /**< Security context of the device. */
+    uint16_t messageId;                 /**< Message ID of the last uplink. */
+#endif
+} bench_link_t;
+
+/**
+ * @brief Totals of one strategy.
+ */
+typedef struct bench_result
+{
+    unsigned long delivered;
+    unsigned long fullHandshakes;
+    unsigned long resumedHandshakes;
+    unsigned long roundTrips;
+    unsigned long long handshakeBytes;
+    unsigned long long bytes;
+    uint64_t activeUs;
+} bench_result_t;
+
+static const OSEndPoint_t server = { "coap.os.1nce.com", 5684 };
+
+/*-----------------------------------------------------------*/
+
+static int session_alive( const bench_link_t * link )
+{
+    return link->established &&
+           ( link->sim.nowUs - link->sessionUs < ( uint64_t ) BENCH_SESSION_LIFETIME_S * 1000000u );
+}
+
+static void establish( bench_link_t * link,
+                       uint8_t address )
+{
+    link->established = 1;
+    link->boundAddress = address;
+    link->sessionUs = link->sim.nowUs;
+}
+
+/**
+ * @brief Answer of the model server to one flight: datagram[ 1 ] is the source
+ * address, datagram[ 2 ] a sequence number echoed with the flight.
+ */
+static size_t dtls_responder( void * arg,
+                              const uint8_t * request,
+                              size_t requestLength,
+                              uint8_t * response,
+                              size_t responseSize )
+{
+    bench_link_t * link = ( bench_link_t * ) arg;
+    size_t length = 0;
+
+    if( ( requestLength < 3u ) || ( responseSize < SIZE_RESUMED_HELLO ) )
+    {
+        return 0;
+    }
+
+#ifdef NCE_SDK_OSCORE
+    /* CoAP version 1, never the first byte of a flight. */
+    if( ( request[ 0 ] >> 6 ) == 1u )
+    {
+        return nce_oscore_server_responder( &link->oscoreServer, request, requestLength, response, responseSize );
+    }
+#endif
+
+    switch( request[ 0 ] )
+    {
+        case FLIGHT_HELLO:
+        case FLIGHT_RESUME:
+            length = SIZE_HELLO_VERIFY;
+            break;
+
+        case FLIGHT_HELLO_COOKIE:
+            length = SIZE_SERVER_HELLO_DONE;
+            break;
+
+        case FLIGHT_RESUME_COOKIE:
+            /* An unknown session ID falls back to a full handshake. */
+            length = session_alive( link ) ? SIZE_RESUMED_HELLO : SIZE_SERVER_HELLO_DONE;
+            break;
+
+        case FLIGHT_FINISHED:
+            establish( link, request[ 1 ] );
+            length = SIZE_SERVER_FINISHED;
+            break;
+
+        case FLIGHT_FINISHED_APP:
+            establish( link, request[ 1 ] );
+            length = SIZE_ACK;
+            break;
+
+        case FLIGHT_APP:
+
+            if( session_alive( link ) && ( ( request[ 1 ] == link->boundAddress ) || link->cid ) )
+            {
+                link->boundAddress = request[ 1 ];
+                length = SIZE_ACK;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
+    memset( response, 0, length );
+
+    if( length > 0u )
+    {
+        response[ 0 ] = request[ 0 ];
+        response[ 2 ] = request[ 2 ];
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send a flight until its answer arrives.
+ *
+ * @return Length of the answer, 0 when every attempt timed out.
+ */
+static size_t exchange( bench_link_t * link,
+                        uint8_t flight,
+                        size_t length,
+                        int attempts,
+                        bench_result_t * result,
+                        int handshake )
+{
+    static uint8_t datagram[ NCE_NETSIM_MAX_DATAGRAM ];
+    static uint8_t answer[ NCE_NETSIM_MAX_DATAGRAM ];
+    static uint8_t sequence;
+    int received;
+    int i;
+
+    datagram[ 0 ] = flight;
+    datagram[ 1 ] = link->address;
+    datagram[ 2 ] = ++sequence;
+
+    for( i = 0; i < attempts; i++ )
+    {
+        ( void ) link->ops.nce_os_udp_send( link->ops.os_socket, datagram, length );
+        result->handshakeBytes += handshake ? length : 0u;
+
+        /* Late answers to earlier flights are skipped. */
+        do
+        {
+            received = link->ops.nce_os_udp_recv( link->ops.os_socket, answer, sizeof( answer ) );
+        } while( ( received > 0 ) && ( ( answer[ 0 ] != flight ) || ( answer[ 2 ] != sequence ) ) );
+
+        if( received > 0 )
+        {
+            result->roundTrips += handshake ? 1u : 0u;
+            result->handshakeBytes += handshake ? ( unsigned long long ) received : 0u;
+            return ( size_t ) received;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Handshake, then the uplink. A resumption ends with the client
+ * Finished sent along with the uplink.
+ *
+ * @return 1 if the uplink was acknowledged.
+ */
+static int handshake_and_send( bench_link_t * link,
+                               int resume,
+                               bench_result_t * result )
+{
+    size_t cid = link->cid ? SIZE_CID : 0u;
+    size_t id = resume ? SIZE_SESSION_ID : 0u;
+    size_t answer;
+
+    if( exchange( link, resume ? FLIGHT_RESUME : FLIGHT_HELLO, SIZE_CLIENT_HELLO + id, BENCH_ATTEMPTS,
+                  result, 1 ) == 0u )
+    {
+        return 0;
+    }
+
+    answer = exchange( link, resume ? FLIGHT_RESUME_COOKIE : FLIGHT_HELLO_COOKIE,
+                       SIZE_CLIENT_HELLO + id + SIZE_COOKIE, BENCH_ATTEMPTS, result, 1 );
+
+    if( answer == SIZE_RESUMED_HELLO )
+    {
+        result->resumedHandshakes++;
+        result->handshakeBytes += SIZE_FINISHED + cid;
+        return exchange( link, FLIGHT_FINISHED_APP, SIZE_FINISHED + cid + SIZE_UPLINK + cid, BENCH_ATTEMPTS,
+                         result, 0 ) > 0u;
+    }
+
+    if( ( answer == 0u ) ||
+        ( exchange( link, FLIGHT_FINISHED, SIZE_CLIENT_FINISHED + cid, BENCH_ATTEMPTS, result, 1 ) == 0u ) )
+    {
+        return 0;
+    }
+
+    result->fullHandshakes++;
+
+    return exchange( link, FLIGHT_APP, SIZE_UPLINK + cid, BENCH_ATTEMPTS, result, 0 ) > 0u;
+}
+
+#ifdef NCE_SDK_OSCORE
+
+/**
+ * @brief One confirmable uplink protected with OSCORE, sent until its
+ * protected 2.04 verifies.
+ *
+ * @return 1 if the uplink was acknowledged.
+ */
+static int oscore_uplink( bench_link_t * link )
+{
+    uint8_t message[ SIZE_COAP_UPLINK ];
+    uint8_t datagram[ SIZE_COAP_UPLINK + NCE_OSCORE_OVERHEAD_MAX ];
+    uint8_t answer[ NCE_NETSIM_MAX_DATAGRAM ];
+    uint8_t response[ NCE_NETSIM_MAX_DATAGRAM ];
+    nce_oscore_request_t request;
+    int length;
+    int received;
+    int i;
+
+    /* CON POST, 2-byte token, Uri-Path "t", payload */
+    memset( message, 'x', sizeof( message ) );
+    link->messageId++;
+    message[ 0 ] = 0x42;
+    message[ 1 ] = 0x02;
+    message[ 2 ] = ( uint8_t ) ( link->messageId >> 8 );
+    message[ 3 ] = ( uint8_t ) link->messageId;
+    message[ 6 ] = 0xB1;
+    message[ 7 ] = 't';
+    message[ 8 ] = 0xFF;
+    length = nce_oscore_protect_request( &link->oscore, message, sizeof( message ), datagram, sizeof( datagram ),
+                                         &request );
+
+    for( i = 0; ( length > 0 ) && ( i < BENCH_ATTEMPTS ); i++ )
+    {
+        ( void ) link->ops.nce_os_udp_send( link->ops.os_socket, datagram, ( size_t ) length );
+
+        /* Late answers to earlier uplinks do not verify and are skipped. */
+        do
+        {
+            received = link->ops.nce_os_udp_recv( link->ops.os_socket, answer, sizeof( answer ) );
+        } while( ( received > 0 ) &&
+                 ( nce_oscore_unprotect_response( &link->oscore, &request, answer, ( size_t ) received, response,
+                                                  sizeof( response ) ) < 0 ) );
+
+        if( received > 0 )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#endif /* ifdef NCE_SDK_OSCORE */
+
+/**
+ * @brief One uplink: connect when needed, send, close unless kept.
+ */
+static int uplink( bench_link_t * link,
+                   bench_strategy_t strategy,
+                   int * open,
+                   bench_result_t * result )
+{
+    size_t cid = link->cid ? SIZE_CID : 0u;
+    int kept = ( strategy == BENCH_KEEP ) || ( strategy == BENCH_KEEP_CID );
+    int acked = 0;
+
+#ifdef NCE_SDK_OSCORE
+    if( strategy == BENCH_OSCORE )
+    {
+        if( !*open )
+        {
+            link->ops.nce_os_udp_connect( link->ops.os_socket, server );
+            *open = 1;
+        }
+
+        return oscore_uplink( link );
+    }
+#endif
+
+    if( *open )
+    {
+        acked = exchange( link, FLIGHT_APP, SIZE_UPLINK + cid, BENCH_KEPT_ATTEMPTS, result, 0 ) > 0u;
+
+        if( !acked )
+        {
+            /* The server lost the session: reconnect. */
+            link->ops.nce_os_udp_disconnect( link->ops.os_socket );
+            *open = 0;
+        }
+    }
+
+    if( !acked )
+    {
+        link->ops.nce_os_udp_connect( link->ops.os_socket, server );
+        *open = 1;
+        acked = handshake_and_send( link, ( strategy == BENCH_RESUME ) && link->cached, result );
+        link->cached |= acked;
+    }
+
+    if( !kept || !acked )
+    {
+        link->ops.nce_os_udp_disconnect( link->ops.os_socket );
+        *open = 0;
+    }
+
+    return acked;
+}
+
+/*-----------------------------------------------------------*/
+
+static void run( bench_strategy_t strategy,
+                 const nce_netsim_config_t * config,
+                 long uplinks,
+                 long intervalS,
+                 long natTimeoutS,
+                 bench_result_t * result )
+{
+    static bench_link_t link;
+    uint64_t start;
+    int open = 0;
+    long i;
+
+    memset( &link, 0, sizeof( link ) );
+    memset( result, 0, sizeof( *result ) );
+    nce_netsim_init( &link.sim, config, dtls_responder, &link, &link.ops );
+    link.cid = ( strategy == BENCH_KEEP_CID );
+
+#ifdef NCE_SDK_OSCORE
+    {
+        nce_dtls_key_t key;
+
+        /* Context derived from the credentials of onboarding. */
+        memset( &key, 0, sizeof( key ) );
+        key.pskLength = ( uint8_t ) strlen( NCE_NETSIM_PSK );
+        memcpy( key.psk, NCE_NETSIM_PSK, key.pskLength );
+        key.identityLength = ( uint8_t ) strlen( NCE_NETSIM_IDENTITY );
+        memcpy( key.identity, NCE_NETSIM_IDENTITY, key.identityLength );
+        nce_oscore_server_init( &link.oscoreServer, key.psk, key.pskLength, key.identity, key.identityLength );
+        ( void ) nce_oscore_init_from_key( &link.oscore, &key, 0, NULL, NULL );
+    }
+#endif
+
+    for( i = 0; i < uplinks; i++ )
+    {
+        start = link.sim.nowUs;
+        result->delivered += ( unsigned long ) uplink( &link, strategy, &open, result );
+        result->activeUs += link.sim.nowUs - start;
+
+        /* Sleep; the NAT forgets an idle binding. */
+        link.sim.nowUs += ( uint64_t ) intervalS * 1000000u;
+        link.address = ( uint8_t ) ( link.address + ( ( intervalS > natTimeoutS ) ? 1 : 0 ) );
+    }
+
+    result->bytes = link.sim.stats.bytesSent + link.sim.stats.bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    bench_result_t results[ BENCH_STRATEGIES ];
+    nce_netsim_config_t config;
+    long uplinks = ( argc > 1 ) ? atol( argv[ 1 ] ) : 48;
+    long intervalS = ( argc > 2 ) ? atol( argv[ 2 ] ) : 1800;
+    long natTimeoutS = ( argc > 3 ) ? atol( argv[ 3 ] ) : 300;
+    int lossPercent = ( argc > 4 ) ? atoi( argv[ 4 ] ) : 2;
+    const bench_result_t * full = &results[ BENCH_FULL ];
+    int failed = 0;
+    int s;
+
+    if( ( uplinks <= 0 ) || ( intervalS < 0 ) || ( natTimeoutS < 0 ) || ( lossPercent < 0 ) || ( lossPercent > 100 ) )
+    {
+        fprintf( stderr, "usage: %s [uplinks] [interval s] [nat timeout s] [loss %%]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 7u;
+    config.lossPercent = ( unsigned int ) lossPercent;
+    config.latencyUs = 150000u;
+    config.jitterUs = 50000u;
+    config.recvTimeoutUs = 2000000u;
+
+    printf( "DTLS model: flights of fixed size, no DTLS stack, not mbed TLS\n" );
+    printf( "%ld uplinks every %ld s, NAT timeout %ld s, %d%% loss, 150 ms latency\n", uplinks, intervalS,
+            natTimeoutS, lossPercent );
+    printf( "%-11s %9s %5s %7s %12s %12s %10s %11s %14s\n", "session", "delivered", "full", "resumed",
+            "hs_bytes/up", "hs_rtt/up", "bytes/up", "active_ms", "hs_bytes_saved" );
+
+    for( s = 0; s < BENCH_STRATEGIES; s++ )
+    {
+        const bench_result_t * r = &results[ s ];
+
+        run( ( bench_strategy_t ) s, &config, uplinks, intervalS, natTimeoutS, &results[ s ] );
+        failed |= ( r->delivered != ( unsigned long ) uplinks );
+
+        printf( "%-11s %9lu %5lu %7lu %12.1f %12.2f %10.1f %11.1f %13.1f%%\n", names[ s ], r->delivered,
+                r->fullHandshakes, r->resumedHandshakes, ( double ) r->handshakeBytes / uplinks,
+                ( double ) r->roundTrips / uplinks, ( double ) r->bytes / uplinks,
+                ( double ) r->activeUs / 1000.0 / uplinks,
+                100.0 * ( 1.0 - ( double ) r->handshakeBytes / ( double ) full->handshakeBytes ) );
+    }
+
+#ifdef NCE_SDK_OSCORE
+    failed |= ( results[ BENCH_OSCORE ].bytes >= results[ BENCH_KEEP_CID ].bytes );
+#endif
+
+    if( failed || ( results[ BENCH_KEEP_CID ].handshakeBytes >= full->handshakeBytes ) ||
+        ( results[ BENCH_RESUME ].roundTrips >= full->roundTrips ) )
+    {
+        fprintf( stderr, "uplink lost or no handshake saved\n" );
+        return 1;
+    }
+
+    return 0;
+}
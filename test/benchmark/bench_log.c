@@ -0,0 +1,106 @@
+/**
+ * @file bench_log.c
+ * @brief Cost of a tokenized log call against formatting the same message,
+ * then a sample dump for tools/logdecode.
+ *
+ * Usage: bench_log [calls] [dump file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "log_interface.h"
+
+static uint8_t drained[ NCE_SDK_LOG_BUFFER_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000u + ( uint64_t ) ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------*/
+
+static double bench_tokenized( long calls )
+{
+    uint64_t start = now_ns();
+    long i;
+
+    for( i = 0; i < calls; i++ )
+    {
+        NceOSLogInfo( "Onboarding attempt %ld to %s:%d\n", i, "coap.os.1nce.com", 5684 );
+
+        /* Drain like a logging thread would, outside of the hot path. */
+        if( ( i & 15 ) == 15 )
+        {
+            ( void ) nce_log_drain( drained, sizeof( drained ) );
+        }
+    }
+
+    return ( double ) ( now_ns() - start ) / ( double ) calls;
+}
+
+/*-----------------------------------------------------------*/
+
+static double bench_formatted( long calls )
+{
+    volatile size_t sink = 0;
+    char line[ 128 ];
+    uint64_t start = now_ns();
+    long i;
+
+    for( i = 0; i < calls; i++ )
+    {
+        sink += ( size_t ) snprintf( line, sizeof( line ), "Onboarding attempt %ld to %s:%d\n", i, "coap.os.1nce.com", 5684 );
+    }
+
+    ( void ) sink;
+    return ( double ) ( now_ns() - start ) / ( double ) calls;
+}
+
+/*-----------------------------------------------------------*/
+
+static int write_dump( const char * path )
+{
+    FILE * file;
+    size_t length;
+
+    ( void ) nce_log_drain( drained, sizeof( drained ) );
+    NceOSLogInfo( "Onboarding attempt %d to %s:%d\n", 3, "coap.os.1nce.com", 5684 );
+    NceOSLogError( "Receive failed: %d, next retry in %u ms (%.2f)\n", -4, 4000u, 1.5 );
+    length = nce_log_drain( drained, sizeof( drained ) );
+
+    file = fopen( path, "wb" );
+
+    if( ( file == NULL ) || ( fwrite( drained, 1, length, file ) != length ) )
+    {
+        return 1;
+    }
+
+    return fclose( file ) != 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    long calls = ( argc > 1 ) ? atol( argv[ 1 ] ) : 1000000;
+    const char * dump = ( argc > 2 ) ? argv[ 2 ] : "nce_log.bin";
+
+    if( calls <= 0 )
+    {
+        fprintf( stderr, "usage: %s [calls] [dump file]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    printf( "%ld calls\n", calls );
+    printf( "tokenized: %8.1f ns/call, %u dropped\n", bench_tokenized( calls ), nce_log_dropped() );
+    printf( "snprintf:  %8.1f ns/call\n", bench_formatted( calls ) );
+
+    return write_dump( dump );
+}
@@ -0,0 +1,241 @@
+/**
+ * @file bench_memfault.c
+ * @brief Throughput of the portable Memfault uploader (nce_memfault.h): host
+ * cost per chunk on a perfect link, then uploads of a Memfault message over
+ * simulated LTE-M and NB-IoT links with fixed and adaptive chunk sizes,
+ * measured on the virtual time of the network simulator.
+ *
+ * The message is one Memfault message: a failed attempt aborts it and the
+ * next attempt sends it again from its start, as the Memfault packetizer
+ * does. Each device has its own uploader, like devices behind a gateway.
+ *
+ * Usage: bench_memfault [message bytes] [loss %] [devices]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_memfault.h"
+#include "nce_netsim.h"
+
+/* Largest message */
+#define MESSAGE_MAX    65536
+
+/**
+ * @brief Simulated link.
+ */
+typedef struct link_profile
+{
+    const char * name;      /**< Label. */
+    uint32_t latencyUs;     /**< One-way latency. */
+    uint32_t bytesPerSecond;/**< Link rate. */
+    uint32_t mtu;           /**< Path MTU. */
+} link_profile_t;
+
+static const link_profile_t profiles[] =
+{
+    { "LTE-M",  50000u,  40000u, 1280u },
+    { "NB-IoT", 400000u, 3000u,  680u  }
+};
+
+/* Chunk strategies: fixed sizes, 0 for adaptive */
+static const size_t strategies[] = { 128u, 512u, 1024u, 0u };
+
+static const OSEndPoint_t proxy = { NCE_MEMFAULT_PROXY_HOST, 5683 };
+
+/* Link of the device being simulated, its clock is the SDK clock. */
+static nce_netsim_t * current;
+
+/* Message of the device being simulated */
+static uint8_t message[ MESSAGE_MAX ];
+static size_t messageLength;
+static size_t messageOffset;
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    return ( current != NULL ) ? ( uint32_t ) current->nowUs : 0u;
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    current->nowUs += ( uint64_t ) ms * 1000u;
+}
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000u + ( uint64_t ) ts.tv_nsec;
+}
+
+static bool message_get_chunk( void * arg,
+                               uint8_t * buffer,
+                               size_t * length )
+{
+    ( void ) arg;
+
+    if( messageOffset >= messageLength )
+    {
+        return false;
+    }
+
+    *length = ( *length < messageLength - messageOffset ) ? *length : messageLength - messageOffset;
+    memcpy( buffer, &message[ messageOffset ], *length );
+    messageOffset += *length;
+
+    return true;
+}
+
+static void message_abort( void * arg )
+{
+    ( void ) arg;
+    messageOffset = 0;
+}
+
+static const nce_memfault_source_t source = { message_get_chunk, message_abort, NULL };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Host cost of the uploader per chunk, on a link without latency.
+ */
+static void bench_host( size_t chunk )
+{
+    static nce_memfault_uploader_t uploader;
+    nce_netsim_config_t config;
+    nce_netsim_t sim;
+    os_network_ops_t ops;
+    uint64_t start;
+    uint64_t elapsed = 0;
+    int i;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1u;
+    nce_netsim_init( &sim, &config, nce_netsim_ack_responder, NULL, &ops );
+    current = &sim;
+    nce_memfault_init( &uploader, &ops, &proxy, &source );
+    nce_chunk_size_init( &uploader.chunkSizes, chunk, chunk, chunk );
+
+    for( i = 0; i < 100; i++ )
+    {
+        messageOffset = 0;
+        messageLength = MESSAGE_MAX;
+        start = now_ns();
+        ( void ) nce_memfault_upload( &uploader );
+        elapsed += now_ns() - start;
+    }
+
+    printf( "host, %4u byte chunks: %8.0f ns/chunk (simulator included), %lu chunks\n", ( unsigned int ) chunk,
+            ( double ) elapsed / ( double ) uploader.chunks, uploader.chunks );
+}
+
+/**
+ * @brief Upload the message of every device over one link and print a row.
+ */
+static void run( const link_profile_t * profile,
+                 size_t chunk,
+                 unsigned int lossPercent,
+                 int devices,
+                 size_t length )
+{
+    static nce_memfault_uploader_t uploader;
+    nce_netsim_config_t config;
+    nce_netsim_t sim;
+    os_network_ops_t ops;
+    uint64_t timeUs = 0;
+    unsigned long long bytes = 0;
+    unsigned long datagrams = 0;
+    int completed = 0;
+    char name[ 16 ];
+    int d;
+
+    memset( &config, 0, sizeof( config ) );
+    config.lossPercent = lossPercent;
+    config.latencyUs = profile->latencyUs;
+    config.jitterUs = profile->latencyUs / 5u;
+    config.bytesPerSecond = profile->bytesPerSecond;
+    config.mtu = profile->mtu;
+    config.fragmentLossPercent = 30u;
+    config.recvTimeoutUs = 4u * profile->latencyUs + 2000000u;
+
+    for( d = 0; d < devices; d++ )
+    {
+        config.seed = ( uint32_t ) d + 1u;
+        nce_netsim_init( &sim, &config, nce_netsim_ack_responder, NULL, &ops );
+        current = &sim;
+        nce_memfault_init( &uploader, &ops, &proxy, &source );
+        uploader.delayMs = virtual_delay;
+
+        if( chunk != 0u )
+        {
+            nce_chunk_size_init( &uploader.chunkSizes, chunk, chunk, chunk );
+        }
+
+        messageOffset = 0;
+        messageLength = length;
+        completed += ( nce_memfault_upload( &uploader ) == NCE_SDK_SUCCESS ) ? 1 : 0;
+        timeUs += sim.nowUs;
+        bytes += sim.stats.bytesSent;
+        datagrams += sim.stats.datagramsSent;
+    }
+
+    if( chunk != 0u )
+    {
+        snprintf( name, sizeof( name ), "fixed_%u", ( unsigned int ) chunk );
+    }
+    else
+    {
+        snprintf( name, sizeof( name ), "adaptive" );
+    }
+
+    printf( "%-7s %-10s %8.1f%% %10.2f %9.1f %11.0f %12.0f\n", profile->name, name, 100.0 * completed / devices,
+            ( double ) timeUs / devices / 1e6, ( double ) datagrams / devices, ( double ) bytes / devices,
+            ( timeUs > 0u ) ? ( double ) length * completed / ( ( double ) timeUs / 1e6 ) : 0.0 );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int length = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 4096;
+    int lossPercent = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 2;
+    int devices = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 200;
+    size_t i;
+    size_t p;
+    size_t s;
+
+    if( ( length <= 0 ) || ( length > MESSAGE_MAX ) || ( lossPercent < 0 ) || ( lossPercent > 100 ) || ( devices <= 0 ) )
+    {
+        fprintf( stderr, "usage: %s [message bytes, at most %d] [loss %%] [devices]\n", argv[ 0 ], MESSAGE_MAX );
+        return 1;
+    }
+
+    for( i = 0; i < sizeof( message ); i++ )
+    {
+        message[ i ] = ( uint8_t ) ( i * 31u );
+    }
+
+    printf( "uploader state: %u bytes per device\n", ( unsigned int ) sizeof( nce_memfault_uploader_t ) );
+    bench_host( 128u );
+    bench_host( 1024u );
+
+    printf( "%d devices, %d byte message, %d%% loss each way, 30%% loss of extra fragments\n", devices, length, lossPercent );
+    printf( "%-7s %-10s %9s %10s %9s %11s %12s\n", "link", "chunk", "complete", "seconds", "dgrams", "bytes_sent",
+            "goodput_B/s" );
+
+    for( p = 0; p < sizeof( profiles ) / sizeof( profiles[ 0 ] ); p++ )
+    {
+        for( s = 0; s < sizeof( strategies ) / sizeof( strategies[ 0 ] ); s++ )
+        {
+            run( &profiles[ p ], strategies[ s ], ( unsigned int ) lossPercent, devices, ( size_t ) length );
+        }
+    }
+
+    return 0;
+}
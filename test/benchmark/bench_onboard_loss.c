@@ -0,0 +1,99 @@
+/**
+ * @file bench_onboard_loss.c
+ * @brief Expected onboarding time and traffic over a lossy link, measured
+ * on the virtual time of the network simulator.
+ *
+ * Usage: bench_onboard_loss [devices] [receive timeout ms] [one-way latency ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_netsim.h"
+
+static const unsigned int lossPercents[] = { 0, 5, 20, 40 };
+
+/*-----------------------------------------------------------*/
+
+static int compare_u64( const void * a,
+                        const void * b )
+{
+    uint64_t x = *( const uint64_t * ) a;
+    uint64_t y = *( const uint64_t * ) b;
+
+    return ( x > y ) - ( x < y );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int devices = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 10000;
+    int timeoutMs = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 2000;
+    int latencyMs = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 400;
+    uint64_t * durations;
+    size_t l;
+    int i;
+
+    if( ( devices <= 0 ) || ( timeoutMs <= 0 ) || ( latencyMs < 0 ) )
+    {
+        fprintf( stderr, "usage: %s [devices] [receive timeout ms] [one-way latency ms]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    durations = malloc( ( size_t ) devices * sizeof( *durations ) );
+
+    if( durations == NULL )
+    {
+        return 1;
+    }
+
+    printf( "%d devices per loss rate, %d ms receive timeout, %d ms one-way latency, 20%% jitter\n",
+            devices, timeoutMs, latencyMs );
+    printf( "%6s %8s %10s %10s %10s %10s %12s %12s\n", "loss", "success", "mean_s", "p50_s", "p95_s",
+            "max_s", "bytes_tx/dev", "bytes_rx/dev" );
+
+    for( l = 0; l < sizeof( lossPercents ) / sizeof( lossPercents[ 0 ] ); l++ )
+    {
+        nce_netsim_config_t config;
+        nce_netsim_t sim;
+        os_network_ops_t ops;
+        nce_context_t ctx;
+        DtlsKey_t key;
+        unsigned long long bytesSent = 0;
+        unsigned long long bytesReceived = 0;
+        uint64_t total = 0;
+        int successes = 0;
+
+        memset( &config, 0, sizeof( config ) );
+        config.lossPercent = lossPercents[ l ];
+        config.latencyUs = ( uint32_t ) latencyMs * 1000u;
+        config.jitterUs = config.latencyUs / 5u;
+        config.recvTimeoutUs = ( uint32_t ) timeoutMs * 1000u;
+
+        for( i = 0; i < devices; i++ )
+        {
+            config.seed = ( uint32_t ) i + 1u;
+            nce_netsim_init( &sim, &config, nce_netsim_onboard_responder, NULL, &ops );
+            os_context_init( &ctx, &ops );
+            successes += ( os_auth_ctx( &ctx, &key ) == NCE_SDK_SUCCESS ) ? 1 : 0;
+            durations[ i ] = sim.nowUs;
+            total += sim.nowUs;
+            bytesSent += sim.stats.bytesSent;
+            bytesReceived += sim.stats.bytesReceived;
+        }
+
+        qsort( durations, ( size_t ) devices, sizeof( *durations ), compare_u64 );
+        printf( "%5u%% %7.1f%% %10.3f %10.3f %10.3f %10.3f %12.1f %12.1f\n", lossPercents[ l ],
+                100.0 * successes / devices, ( double ) total / devices / 1e6,
+                durations[ devices / 2 ] / 1e6, durations[ ( size_t ) devices * 95 / 100 ] / 1e6,
+                durations[ devices - 1 ] / 1e6,
+                ( double ) bytesSent / devices, ( double ) bytesReceived / devices );
+    }
+
+    free( durations );
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file bench_preconnect.c
+ * @brief Time from boot to the first acknowledged uplink, with the connect
+ * run in series after application startup against a speculative pre-connect
+ * started when the link comes up, on the loopback stand-in.
+ *
+ * The connect of the Linux port is preceded by a fixed delay standing for
+ * DNS, DTLS setup and the handshake, which are free on loopback. Application
+ * startup (sensors, first sample) is a sleep. The uplink is an Energy Saver
+ * packet in a confirmable CoAP POST, acknowledged by the stand-in.
+ *
+ * Usage: bench_preconnect [runs] [handshake ms] [startup ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nce_iot_c_sdk.h"
+#include "network_interface_linux.h"
+#include "preconnect_linux.h"
+#include "nce_standin.h"
+
+/* CoAP framing of the uplink */
+#define BENCH_COAP_CON_POST      0x40
+#define BENCH_COAP_POST          0x02
+#define BENCH_COAP_MARKER        0xFF
+
+/* Idle timeout of the prepared session */
+#define BENCH_IDLE_TIMEOUT_MS    30000u
+
+static nce_standin_t standin;
+static OSEndPoint_t endpoint = { "127.0.0.1", 0 };
+static struct OSNetwork network;
+static long handshakeMs;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t now_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000u + ( uint64_t ) ts.tv_nsec / 1000u;
+}
+
+static void sleep_ms( long ms )
+{
+    struct timespec ts = { ms / 1000, ( ms % 1000 ) * 1000000L };
+
+    nanosleep( &ts, NULL );
+}
+
+/**
+ * @brief Connect of the Linux port after the modelled DNS and handshake.
+ */
+static int handshake_connect( OSNetwork_t osnetwork,
+                              OSEndPoint_t server )
+{
+    sleep_ms( handshakeMs );
+
+    return nce_os_connect( osnetwork, server );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect, send one Energy Saver uplink and wait for its ACK.
+ *
+ * @return 1 if the uplink was acknowledged.
+ */
+static int first_uplink( const os_network_ops_t * ops,
+                         uint16_t messageId )
+{
+    Element2byte_gen_t battery = { E_INTEGER, { 0 }, 1 };
+    uint8_t request[ 64 ];
+    uint8_t response[ 64 ];
+    int length;
+    int received;
+    int acked = 0;
+
+    battery.value.i = 87;
+    request[ 0 ] = BENCH_COAP_CON_POST;
+    request[ 1 ] = BENCH_COAP_POST;
+    request[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    request[ 3 ] = ( uint8_t ) messageId;
+    request[ 4 ] = BENCH_COAP_MARKER;
+    length = 5 + os_energy_save( ( char * ) &request[ 5 ], 1, 1, battery );
+
+    if( ops->nce_os_udp_connect( ops->os_socket, endpoint ) != 0 )
+    {
+        return 0;
+    }
+
+    if( ops->nce_os_udp_send( ops->os_socket, request, ( size_t ) length ) == length )
+    {
+        received = ops->nce_os_udp_recv( ops->os_socket, response, sizeof( response ) );
+        acked = ( received >= 4 ) && ( response[ 1 ] >> 5 == 2 ) && ( response[ 2 ] == request[ 2 ] ) &&
+                ( response[ 3 ] == request[ 3 ] );
+    }
+
+    ops->nce_os_udp_disconnect( ops->os_socket );
+
+    return acked;
+}
+
+/**
+ * @brief One boot: link up at time 0, startup, then the first uplink.
+ *
+ * @return Microseconds from boot to the ACK, 0 if the uplink failed.
+ */
+static uint64_t boot( const os_network_ops_t * realOps,
+                      const os_network_ops_t * sdkOps,
+                      long startupMs,
+                      uint16_t messageId )
+{
+    uint64_t start = now_us();
+
+    if( sdkOps != realOps )
+    {
+        ( void ) nce_os_preconnect_start( realOps, endpoint, BENCH_IDLE_TIMEOUT_MS );
+    }
+
+    sleep_ms( startupMs );
+
+    return first_uplink( sdkOps, messageId ) ? now_us() - start : 0u;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    os_network_ops_t realOps = { &network, handshake_connect, nce_os_send, nce_os_recv, nce_os_disconnect };
+    os_network_ops_t sdkOps = realOps;
+    nce_os_preconnect_stats_t stats;
+    uint64_t serialUs = 0;
+    uint64_t preconnectUs = 0;
+    uint64_t us;
+    long runs = ( argc > 1 ) ? atol( argv[ 1 ] ) : 10;
+    long startupMs = ( argc > 3 ) ? atol( argv[ 3 ] ) : 300;
+    int failed = 0;
+    long i;
+
+    handshakeMs = ( argc > 2 ) ? atol( argv[ 2 ] ) : 400;
+    sdkOps.nce_os_udp_connect = nce_os_preconnect_connect;
+
+    if( ( runs <= 0 ) || ( handshakeMs < 0 ) || ( startupMs < 0 ) || ( nce_standin_start( &standin ) != 0 ) )
+    {
+        fprintf( stderr, "usage: %s [runs] [handshake ms] [startup ms]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    endpoint.port = standin.port;
+
+    for( i = 0; i < runs; i++ )
+    {
+        us = boot( &realOps, &realOps, startupMs, ( uint16_t ) ( 2 * i ) );
+        failed |= ( us == 0u );
+        serialUs += us;
+
+        us = boot( &realOps, &sdkOps, startupMs, ( uint16_t ) ( 2 * i + 1 ) );
+        failed |= ( us == 0u );
+        preconnectUs += us;
+    }
+
+    nce_os_preconnect_cancel();
+    nce_os_preconnect_get_stats( &stats );
+    nce_standin_stop( &standin );
+
+    printf( "%ld boots, handshake %ld ms, startup %ld ms\n", runs, handshakeMs, startupMs );
+    printf( "%-12s %22s\n", "connect", "boot_to_first_ack_ms" );
+    printf( "%-12s %22.1f\n", "serial", ( double ) serialUs / 1000.0 / ( double ) runs );
+    printf( "%-12s %22.1f\n", "preconnect", ( double ) preconnectUs / 1000.0 / ( double ) runs );
+    printf( "sessions prepared %lu, adopted %lu (waited %lu), expired %lu\n",
+            stats.prepared, stats.adopted, stats.waited, stats.expired );
+
+    if( failed || ( stats.adopted != ( unsigned long ) runs ) )
+    {
+        fprintf( stderr, "uplink not acknowledged or session not adopted\n" );
+        return 1;
+    }
+
+    return 0;
+}
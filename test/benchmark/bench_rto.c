@@ -0,0 +1,187 @@
+/**
+ * @file bench_rto.c
+ * @brief Time to recover from lost onboarding datagrams, the fixed receive
+ * timeout of the ports against the timeout estimated per endpoint
+ * (nce_rto.h), measured on the virtual time of the network simulator.
+ *
+ * Each device onboards repeatedly over the same link, as after every
+ * wake-up, so the estimator carries what it learned from one session to the
+ * next. The recovery time of an onboarding that lost a datagram is its
+ * duration minus the mean duration of the onboardings without loss.
+ *
+ * Usage: bench_rto [devices] [onboardings per device] [loss %]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_netsim.h"
+
+/* Fixed receive timeout of the Linux and Zephyr ports */
+#define FIXED_TIMEOUT_US    10000000u
+
+/* Time between two onboardings of a device */
+#define INTERVAL_US         300000000u
+
+/**
+ * @brief Simulated link.
+ */
+typedef struct link_profile
+{
+    const char * name;  /**< Label. */
+    uint32_t latencyUs; /**< One-way latency. */
+    uint32_t jitterUs;  /**< Uniform jitter added to the latency. */
+} link_profile_t;
+
+static const link_profile_t profiles[] =
+{
+    { "LTE-M",     50000u,   10000u   },
+    { "NB-IoT",    400000u,  200000u  },
+    { "NB-IoT CE", 3000000u, 1500000u }
+};
+
+/* Link of the device being simulated, its clock is the SDK clock. */
+static nce_netsim_t sim;
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+}
+
+static int compare_u64( const void * a,
+                        const void * b )
+{
+    uint64_t x = *( const uint64_t * ) a;
+    uint64_t y = *( const uint64_t * ) b;
+
+    return ( x > y ) - ( x < y );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Onboard every device repeatedly over one link and print a row.
+ */
+static void run( const link_profile_t * profile,
+                 int estimated,
+                 int devices,
+                 int onboardings,
+                 unsigned int lossPercent,
+                 uint64_t * durations )
+{
+    nce_netsim_config_t config;
+    os_network_ops_t ops;
+    nce_context_t ctx;
+    nce_rto_t rto;
+    DtlsKey_t key;
+    unsigned long timeouts;
+    unsigned long long datagrams = 0;
+    uint64_t start;
+    uint64_t clean = 0;
+    uint64_t lossy = 0;
+    uint64_t total = 0;
+    size_t count = 0;
+    int cleanCount = 0;
+    int lossyCount = 0;
+    int successes = 0;
+    int i;
+    int n;
+
+    memset( &config, 0, sizeof( config ) );
+    config.lossPercent = lossPercent;
+    config.latencyUs = profile->latencyUs;
+    config.jitterUs = profile->jitterUs;
+    config.recvTimeoutUs = FIXED_TIMEOUT_US;
+
+    for( i = 0; i < devices; i++ )
+    {
+        config.seed = ( uint32_t ) i + 1u;
+        nce_netsim_init( &sim, &config, nce_netsim_onboard_responder, NULL, &ops );
+        os_context_init( &ctx, &ops );
+        ctx.delayMs = virtual_delay;
+        nce_rto_init( &rto );
+        ctx.rto = &rto;
+        ctx.setRecvTimeout = estimated ? nce_netsim_set_recv_timeout : NULL;
+
+        for( n = 0; n < onboardings; n++ )
+        {
+            start = sim.nowUs;
+            timeouts = sim.stats.timeouts;
+            successes += ( os_auth_ctx( &ctx, &key ) == NCE_SDK_SUCCESS ) ? 1 : 0;
+            durations[ count ] = sim.nowUs - start;
+            total += durations[ count ];
+
+            if( sim.stats.timeouts == timeouts )
+            {
+                clean += durations[ count ];
+                cleanCount++;
+            }
+            else
+            {
+                lossy += durations[ count ];
+                lossyCount++;
+            }
+
+            count++;
+            sim.nowUs += INTERVAL_US;
+        }
+
+        datagrams += sim.stats.datagramsSent;
+    }
+
+    qsort( durations, count, sizeof( *durations ), compare_u64 );
+    printf( "%-10s %-9s %7.1f%% %8.3f %8.3f %8.3f %10.3f %8.2f\n", profile->name,
+            estimated ? "estimated" : "fixed", 100.0 * successes / ( double ) count,
+            ( double ) total / count / 1e6, durations[ count / 2 ] / 1e6,
+            durations[ count * 95 / 100 ] / 1e6,
+            ( lossyCount > 0 ) ? ( ( double ) lossy / lossyCount - ( ( cleanCount > 0 ) ? ( double ) clean / cleanCount : 0.0 ) ) / 1e6 : 0.0,
+            ( double ) datagrams / count );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int devices = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 1000;
+    int onboardings = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 20;
+    int lossPercent = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 10;
+    uint64_t * durations;
+    size_t p;
+
+    if( ( devices <= 0 ) || ( onboardings <= 0 ) || ( lossPercent < 0 ) || ( lossPercent > 100 ) )
+    {
+        fprintf( stderr, "usage: %s [devices] [onboardings per device] [loss %%]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    durations = malloc( ( size_t ) devices * ( size_t ) onboardings * sizeof( *durations ) );
+
+    if( durations == NULL )
+    {
+        return 1;
+    }
+
+    printf( "%d devices, %d onboardings each %u s apart, %d%% loss each way, fixed timeout %u s\n",
+            devices, onboardings, INTERVAL_US / 1000000u, lossPercent, FIXED_TIMEOUT_US / 1000000u );
+    printf( "%-10s %-9s %8s %8s %8s %8s %10s %8s\n", "link", "timeout", "success", "mean_s", "p50_s",
+            "p95_s", "recover_s", "tx/onb" );
+
+    for( p = 0; p < sizeof( profiles ) / sizeof( profiles[ 0 ] ); p++ )
+    {
+        run( &profiles[ p ], 0, devices, onboardings, ( unsigned int ) lossPercent, durations );
+        run( &profiles[ p ], 1, devices, onboardings, ( unsigned int ) lossPercent, durations );
+    }
+
+    free( durations );
+
+    return 0;
+}
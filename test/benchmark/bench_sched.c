@@ -0,0 +1,211 @@
+/**
+ * @file bench_sched.c
+ * @brief Modem wake-ups and radio-on time of a day of SDK traffic, sent as
+ * soon as it is produced against coalesced by the scheduler (nce_scheduler.h),
+ * on the virtual time of the simulated modem.
+ *
+ * Traffic: an Energy Saver uplink every 15 minutes, a Memfault upload every
+ * hour, one onboarding a day, a few alarms at random times, and the
+ * application's own heartbeat every 10 minutes which the SDK can ride along.
+ *
+ * Usage: bench_sched [days] [RRC inactivity s] [wake-up s]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nce_scheduler.h"
+#include "nce_modemsim.h"
+
+#define BENCH_DAY_S          86400u
+#define BENCH_SECOND_US      1000000u
+
+/* Time on air of one SDK operation or heartbeat */
+#define BENCH_TX_US          300000u
+
+/* Alarms per day, at random seconds */
+#define BENCH_ALARMS         4u
+
+/**
+ * @brief A kind of SDK operation of the workload.
+ */
+typedef struct bench_op
+{
+    uint32_t periodS;
+    uint32_t offsetS;
+    nce_sched_priority_t priority;
+    uint32_t maxDelayS;
+} bench_op_t;
+
+static const bench_op_t workload[] =
+{
+    { 900u,        0u,    NCE_SCHED_PRIORITY_NORMAL, 900u  }, /* Energy Saver */
+    { 3600u,       2000u, NCE_SCHED_PRIORITY_LOW,    3600u }, /* Memfault */
+    { BENCH_DAY_S, 100u,  NCE_SCHED_PRIORITY_HIGH,   600u  }, /* Onboarding */
+};
+
+/* The application's heartbeat, not deferrable */
+#define BENCH_HEARTBEAT_PERIOD_S    600u
+#define BENCH_HEARTBEAT_OFFSET_S    300u
+
+static nce_modemsim_t modem;
+static uint32_t rng = 7u;
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) modem.nowUs;
+}
+
+static uint32_t bench_random( void )
+{
+    /* xorshift32 */
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static int transmit_op( void * arg )
+{
+    ( void ) arg;
+    return nce_modemsim_transmit( &modem, BENCH_TX_US );
+}
+
+/**
+ * @brief An operation is produced: send it now, or queue it when a scheduler
+ * is given.
+ */
+static void produce( nce_scheduler_t * scheduler,
+                     nce_sched_priority_t priority,
+                     uint32_t maxDelayUs,
+                     unsigned long * ops )
+{
+    if( scheduler == NULL )
+    {
+        ( void ) transmit_op( NULL );
+        ( *ops )++;
+    }
+    else if( nce_sched_submit( scheduler, transmit_op, NULL, priority, maxDelayUs ) != NCE_SCHED_SUCCESS )
+    {
+        fprintf( stderr, "scheduler queue full\n" );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Simulate the given days, with or without the scheduler. Returns the
+ * operations run.
+ */
+static unsigned long simulate( uint32_t days,
+                               uint32_t inactivityS,
+                               uint32_t wakeS,
+                               int scheduled,
+                               nce_sched_stats_t * stats )
+{
+    nce_sched_radio_t radio = { nce_modemsim_radio_state, &modem };
+    nce_scheduler_t scheduler;
+    uint32_t alarms[ BENCH_ALARMS ];
+    unsigned long ops = 0;
+    uint64_t t;
+    size_t i;
+
+    nce_modemsim_init( &modem, inactivityS * BENCH_SECOND_US, wakeS * BENCH_SECOND_US );
+    nce_sched_init( &scheduler, &radio );
+    rng = 7u;
+
+    for( t = 0; t < ( uint64_t ) days * BENCH_DAY_S; t++ )
+    {
+        if( t % BENCH_DAY_S == 0u )
+        {
+            for( i = 0; i < BENCH_ALARMS; i++ )
+            {
+                alarms[ i ] = bench_random() % BENCH_DAY_S;
+            }
+        }
+
+        if( modem.nowUs < t * BENCH_SECOND_US )
+        {
+            nce_modemsim_advance( &modem, t * BENCH_SECOND_US - modem.nowUs );
+        }
+
+        if( t % BENCH_HEARTBEAT_PERIOD_S == BENCH_HEARTBEAT_OFFSET_S )
+        {
+            ( void ) nce_modemsim_transmit( &modem, BENCH_TX_US );
+        }
+
+        for( i = 0; i < sizeof( workload ) / sizeof( workload[ 0 ] ); i++ )
+        {
+            if( t % workload[ i ].periodS == workload[ i ].offsetS )
+            {
+                produce( scheduled ? &scheduler : NULL, workload[ i ].priority,
+                         workload[ i ].maxDelayS * BENCH_SECOND_US, &ops );
+            }
+        }
+
+        for( i = 0; i < BENCH_ALARMS; i++ )
+        {
+            if( t % BENCH_DAY_S == alarms[ i ] )
+            {
+                produce( scheduled ? &scheduler : NULL, NCE_SCHED_PRIORITY_URGENT, 0u, &ops );
+            }
+        }
+
+        if( scheduled )
+        {
+            ops += nce_sched_poll( &scheduler );
+        }
+    }
+
+    nce_modemsim_advance( &modem, ( uint64_t ) inactivityS * BENCH_SECOND_US );
+    nce_sched_get_stats( &scheduler, stats );
+
+    return ops;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int days = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 1;
+    int inactivityS = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 10;
+    int wakeS = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 2;
+    nce_sched_stats_t stats;
+    unsigned long naiveOps;
+    unsigned long naiveWakeups;
+    uint64_t naiveOnUs;
+    unsigned long ops;
+
+    if( ( days <= 0 ) || ( inactivityS < 0 ) || ( wakeS < 0 ) )
+    {
+        fprintf( stderr, "usage: %s [days] [RRC inactivity s] [wake-up s]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    naiveOps = simulate( ( uint32_t ) days, ( uint32_t ) inactivityS, ( uint32_t ) wakeS, 0, &stats );
+    naiveWakeups = modem.wakeups;
+    naiveOnUs = nce_modemsim_connected_us( &modem );
+    ops = simulate( ( uint32_t ) days, ( uint32_t ) inactivityS, ( uint32_t ) wakeS, 1, &stats );
+
+    printf( "%d day(s), %d s RRC inactivity, %d s wake-up, wake-ups include the application heartbeat\n",
+            days, inactivityS, wakeS );
+    printf( "%-10s %8s %10s %12s\n", "mode", "ops", "wake-ups", "radio_on_s" );
+    printf( "%-10s %8lu %10lu %12.1f\n", "immediate", naiveOps, naiveWakeups, naiveOnUs / 1e6 );
+    printf( "%-10s %8lu %10lu %12.1f\n", "scheduled", ops, modem.wakeups,
+            nce_modemsim_connected_us( &modem ) / 1e6 );
+    printf( "windows %lu (woke %lu, piggybacked %lu), wake-ups avoided %lu, deadline misses %lu\n",
+            ( unsigned long ) stats.windows, ( unsigned long ) stats.wakeups,
+            ( unsigned long ) stats.piggybacked, ( unsigned long ) stats.wakeupsAvoided,
+            ( unsigned long ) stats.deadlineMisses );
+
+    if( ( ops != naiveOps ) || ( modem.wakeups > naiveWakeups ) || ( stats.deadlineMisses != 0u ) )
+    {
+        fprintf( stderr, "scheduler lost operations, added wake-ups or missed deadlines\n" );
+        return 1;
+    }
+
+    return 0;
+}
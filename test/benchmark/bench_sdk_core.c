@@ -0,0 +1,255 @@
+/**
+ * @file bench_sdk_core.c
+ * @brief Time and stack cost of the hot paths of the SDK core: the Energy
+ * Saver encoder, the onboarding request builder and the credential parser.
+ *
+ * The SDK translation unit, with the retry classifier it calls, is included
+ * so its static functions can be driven directly. Stack use is reported
+ * twice: measured at run time on a painted thread stack (SDK and C library),
+ * and as the sum of the -fstack-usage frames of the SDK call chain.
+ *
+ * Usage: bench_sdk_core [iterations] [object file of this benchmark] [stack budget bytes]
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nce_iot_c_sdk.c"
+#include "nce_retry.c"
+#include "nce_coap_option.c"
+
+/* Stack given to the painted measurement thread */
+#define BENCH_STACK_SIZE       ( 256 * 1024 )
+
+/* Pattern of the unused stack */
+#define BENCH_STACK_PAINT      0xA5
+
+/* SDK functions of a call chain, deepest last */
+#define BENCH_MAX_CHAIN        3
+
+/**
+ * @brief One measured operation.
+ */
+typedef struct bench_case
+{
+    const char * name;
+    void ( * run )( void );
+    const char * chain[ BENCH_MAX_CHAIN ];
+} bench_case_t;
+
+static char response[] = "\x60\x45\x12\x34\xff" "89" "8988228066601234567,aPskOf16Bytes!";
+static nce_context_t benchContext;
+static volatile int sink;
+
+/*-----------------------------------------------------------*/
+
+static void run_energy_save( void )
+{
+    Element2byte_gen_t battery = { E_INTEGER, { 0 }, 1 };
+    Element2byte_gen_t signal = { E_INTEGER, { 0 }, 1 };
+    Element2byte_gen_t temperature = { E_INTEGER, { 0 }, 2 };
+    char packet[ NCE_SDK_MAX_STRING_SIZE ];
+
+    battery.value.i = 99;
+    signal.value.i = 84;
+    temperature.value.i = 21;
+    sink += os_energy_save( packet, 1, 3, battery, signal, temperature );
+}
+
+static void run_build_request( void )
+{
+    char packet[ 150 ];
+
+    sink += ( int ) _build_onboard_request( &benchContext, packet, sizeof( packet ) );
+}
+
+static void run_parse_credentials( void )
+{
+    DtlsKey_t key;
+
+    sink += _get_psk( response, &key );
+}
+
+static void run_nothing( void )
+{
+}
+
+static const bench_case_t cases[] =
+{
+    { "os_energy_save",      run_energy_save,       { "os_energy_save" }                          },
+    { "build_onboard_request", run_build_request,   { "_build_onboard_request", "_getNextMessageID" } },
+    { "parse_credentials",   run_parse_credentials, { "_get_psk", "_next_field" }                 },
+};
+
+/*-----------------------------------------------------------*/
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000u + ( uint64_t ) ts.tv_nsec;
+}
+
+static void * run_case( void * arg )
+{
+    ( ( void ( * )( void ) )( uintptr_t ) arg )();
+    return NULL;
+}
+
+/**
+ * @brief Run a case once on a painted stack and return the bytes it touched.
+ */
+static size_t painted_stack_use( void ( * run )( void ) )
+{
+    static unsigned char stack[ BENCH_STACK_SIZE ] __attribute__( ( aligned( 4096 ) ) );
+    pthread_attr_t attr;
+    pthread_t thread;
+    size_t untouched = 0;
+
+    memset( stack, BENCH_STACK_PAINT, sizeof( stack ) );
+    pthread_attr_init( &attr );
+    pthread_attr_setstack( &attr, stack, sizeof( stack ) );
+
+    if( pthread_create( &thread, &attr, run_case, ( void * ) ( uintptr_t ) run ) != 0 )
+    {
+        return 0;
+    }
+
+    pthread_join( thread, NULL );
+    pthread_attr_destroy( &attr );
+
+    /* The stack grows down, the thread control block sits at its top. */
+    while( ( untouched < sizeof( stack ) ) && ( stack[ untouched ] == BENCH_STACK_PAINT ) )
+    {
+        untouched++;
+    }
+
+    return sizeof( stack ) - untouched;
+}
+
+/**
+ * @brief Frame of a function in a -fstack-usage file, -1 if not listed.
+ */
+static long static_frame( const char * suPath,
+                          const char * function )
+{
+    char line[ 512 ];
+    long frame = -1;
+    FILE * file = fopen( suPath, "r" );
+
+    while( ( file != NULL ) && ( frame < 0 ) && ( fgets( line, sizeof( line ), file ) != NULL ) )
+    {
+        /* file:line:column:function<TAB>bytes<TAB>qualifier */
+        char * tab = strchr( line, '\t' );
+        char * name = tab;
+
+        while( ( name != NULL ) && ( name > line ) && ( name[ -1 ] != ':' ) )
+        {
+            name--;
+        }
+
+        if( ( tab != NULL ) && ( ( size_t ) ( tab - name ) == strlen( function ) ) &&
+            ( strncmp( name, function, strlen( function ) ) == 0 ) )
+        {
+            frame = strtol( tab + 1, NULL, 10 );
+        }
+    }
+
+    if( file != NULL )
+    {
+        fclose( file );
+    }
+
+    return frame;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    long iterations = ( argc > 1 ) ? atol( argv[ 1 ] ) : 1000000;
+    long budget = ( argc > 3 ) ? atol( argv[ 3 ] ) : 0;
+    char suPath[ 1024 ] = "";
+    size_t baseline;
+    size_t c;
+    int overBudget = 0;
+
+    if( iterations <= 0 )
+    {
+        fprintf( stderr, "usage: %s [iterations] [object file of this benchmark] [stack budget bytes]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    if( ( argc > 2 ) && ( strlen( argv[ 2 ] ) + 4 < sizeof( suPath ) ) )
+    {
+        /* GCC writes x.c.su next to x.c.o */
+        strcpy( suPath, argv[ 2 ] );
+
+        if( ( strlen( suPath ) > 2 ) && ( strcmp( suPath + strlen( suPath ) - 2, ".o" ) == 0 ) )
+        {
+            strcpy( suPath + strlen( suPath ) - 2, ".su" );
+        }
+    }
+
+    os_context_init( &benchContext, NULL );
+    baseline = painted_stack_use( run_nothing );
+    ( void ) baseline;
+
+    printf( "%ld iterations\n", iterations );
+    printf( "%-24s %10s %16s %16s\n", "operation", "ns/op", "stack_run_bytes", "stack_sdk_bytes" );
+
+    for( c = 0; c < sizeof( cases ) / sizeof( cases[ 0 ] ); c++ )
+    {
+        uint64_t start = now_ns();
+        long staticStack = 0;
+        long i;
+        int f;
+
+        for( i = 0; i < iterations; i++ )
+        {
+            cases[ c ].run();
+        }
+
+        start = now_ns() - start;
+
+        for( f = 0; ( f < BENCH_MAX_CHAIN ) && ( cases[ c ].chain[ f ] != NULL ) && ( staticStack >= 0 ); f++ )
+        {
+            long frame = ( suPath[ 0 ] != '\0' ) ? static_frame( suPath, cases[ c ].chain[ f ] ) : -1;
+
+            /* Callees inlined by the compiler have no entry of their own. */
+            staticStack = ( frame >= 0 ) ? staticStack + frame : ( ( f == 0 ) ? -1 : staticStack );
+        }
+
+        printf( "%-24s %10.1f ", cases[ c ].name, ( double ) start / ( double ) iterations );
+
+        #ifdef __SANITIZE_ADDRESS__
+            /* AddressSanitizer moves locals to its own fake stacks. */
+            printf( "%16s ", "n/a" );
+        #else
+            printf( "%16lu ", ( unsigned long ) ( painted_stack_use( cases[ c ].run ) - baseline ) );
+        #endif
+
+        if( staticStack >= 0 )
+        {
+            printf( "%16ld\n", staticStack );
+        }
+        else
+        {
+            printf( "%16s\n", "n/a" );
+        }
+
+        if( ( budget > 0 ) && ( staticStack > budget ) )
+        {
+            fprintf( stderr, "%s: SDK stack %ld bytes over the budget of %ld\n", cases[ c ].name, staticStack, budget );
+            overBudget = 1;
+        }
+    }
+
+    return overBudget;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file bench_spsc.c
+ * @brief Throughput of the SPSC record queue between a producer and a
+ * consumer thread, against the same ring protected by a mutex.
+ *
+ * The producer retries when the queue is full so every record is handed
+ * over, and counts how often it had to.
+ *
+ * Usage: bench_spsc [records] [consumer batch]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nce_spsc_queue.h"
+
+/* Bytes of a benchmark record, a typical Energy Saver packet */
+#define BENCH_RECORD_SIZE    12
+
+/**
+ * @brief Ring with the same layout as the SPSC queue, under a mutex.
+ */
+typedef struct locked_ring
+{
+    pthread_mutex_t lock;
+    uint32_t head;
+    uint32_t tail;
+    nce_spsc_record_t slots[ NCE_SDK_SPSC_SLOTS ];
+} locked_ring_t;
+
+/**
+ * @brief One benchmark run.
+ */
+typedef struct bench_run
+{
+    long records;
+    size_t batch;
+    long fullRetries;
+    uint64_t checksum;
+} bench_run_t;
+
+static nce_spsc_queue_t queue;
+static locked_ring_t ring = { PTHREAD_MUTEX_INITIALIZER, 0, 0, { { 0, { 0 } } } };
+
+/*-----------------------------------------------------------*/
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000u + ( uint64_t ) ts.tv_nsec;
+}
+
+static void sum_record( void * arg,
+                        const uint8_t * record,
+                        size_t length )
+{
+    uint32_t value;
+
+    ( void ) length;
+    memcpy( &value, record, sizeof( value ) );
+    *( uint64_t * ) arg += value;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * spsc_producer( void * arg )
+{
+    bench_run_t * run = ( bench_run_t * ) arg;
+    uint8_t record[ BENCH_RECORD_SIZE ] = { 0 };
+    uint32_t i;
+
+    for( i = 1; i <= ( uint32_t ) run->records; i++ )
+    {
+        memcpy( record, &i, sizeof( i ) );
+
+        while( nce_spsc_queue_push( &queue, record, sizeof( record ) ) == NCE_SPSC_QUEUE_FULL )
+        {
+            run->fullRetries++;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void spsc_consume( bench_run_t * run )
+{
+    long received = 0;
+    size_t drained;
+
+    while( received < run->records )
+    {
+        drained = nce_spsc_queue_drain( &queue, sum_record, &run->checksum, run->batch );
+        received += ( long ) drained;
+
+        if( drained == 0u )
+        {
+            sched_yield();
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int locked_push( const uint8_t * record,
+                        size_t length )
+{
+    int status = 0;
+
+    pthread_mutex_lock( &ring.lock );
+
+    if( ring.head - ring.tail == NCE_SDK_SPSC_SLOTS )
+    {
+        status = -1;
+    }
+    else
+    {
+        ring.slots[ ring.head & ( NCE_SDK_SPSC_SLOTS - 1u ) ].length = ( uint16_t ) length;
+        memcpy( ring.slots[ ring.head & ( NCE_SDK_SPSC_SLOTS - 1u ) ].data, record, length );
+        ring.head++;
+    }
+
+    pthread_mutex_unlock( &ring.lock );
+
+    return status;
+}
+
+static void * locked_producer( void * arg )
+{
+    bench_run_t * run = ( bench_run_t * ) arg;
+    uint8_t record[ BENCH_RECORD_SIZE ] = { 0 };
+    uint32_t i;
+
+    for( i = 1; i <= ( uint32_t ) run->records; i++ )
+    {
+        memcpy( record, &i, sizeof( i ) );
+
+        while( locked_push( record, sizeof( record ) ) != 0 )
+        {
+            run->fullRetries++;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void locked_consume( bench_run_t * run )
+{
+    long received = 0;
+    size_t drained;
+    nce_spsc_record_t * slot;
+
+    while( received < run->records )
+    {
+        drained = 0;
+        pthread_mutex_lock( &ring.lock );
+
+        while( ( ring.tail != ring.head ) && ( drained < run->batch ) )
+        {
+            slot = &ring.slots[ ring.tail & ( NCE_SDK_SPSC_SLOTS - 1u ) ];
+            sum_record( &run->checksum, slot->data, slot->length );
+            ring.tail++;
+            drained++;
+        }
+
+        pthread_mutex_unlock( &ring.lock );
+        received += ( long ) drained;
+
+        if( drained == 0u )
+        {
+            sched_yield();
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Time one producer/consumer pair, returns ns per record.
+ */
+static double bench( void * ( *produce )( void * ),
+                     void ( * consume )( bench_run_t * ),
+                     bench_run_t * run )
+{
+    pthread_t thread;
+    uint64_t start = now_ns();
+
+    if( pthread_create( &thread, NULL, produce, run ) != 0 )
+    {
+        return -1.0;
+    }
+
+    consume( run );
+    pthread_join( thread, NULL );
+
+    return ( double ) ( now_ns() - start ) / ( double ) run->records;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    bench_run_t spsc;
+    bench_run_t locked;
+    uint64_t expected;
+    double spscNs;
+    double lockedNs;
+
+    memset( &spsc, 0, sizeof( spsc ) );
+    spsc.records = ( argc > 1 ) ? atol( argv[ 1 ] ) : 1000000;
+    spsc.batch = ( argc > 2 ) ? ( size_t ) atol( argv[ 2 ] ) : 8u;
+
+    if( ( spsc.records <= 0 ) || ( spsc.batch == 0u ) )
+    {
+        fprintf( stderr, "usage: %s [records] [consumer batch]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    locked = spsc;
+    expected = ( uint64_t ) spsc.records * ( uint64_t ) ( spsc.records + 1 ) / 2u;
+    nce_spsc_queue_init( &queue );
+
+    spscNs = bench( spsc_producer, spsc_consume, &spsc );
+    lockedNs = bench( locked_producer, locked_consume, &locked );
+
+    printf( "%ld records of %d bytes, %u slots, consumer batch %lu\n", spsc.records, BENCH_RECORD_SIZE,
+            ( unsigned int ) NCE_SDK_SPSC_SLOTS, ( unsigned long ) spsc.batch );
+    printf( "%-10s %10s %14s %12s\n", "queue", "ns/record", "Mrecords/s", "full_retries" );
+    printf( "%-10s %10.1f %14.2f %12ld\n", "spsc", spscNs, 1000.0 / spscNs, spsc.fullRetries );
+    printf( "%-10s %10.1f %14.2f %12ld\n", "mutex", lockedNs, 1000.0 / lockedNs, locked.fullRetries );
+
+    if( ( spsc.checksum != expected ) || ( locked.checksum != expected ) )
+    {
+        fprintf( stderr, "records lost or corrupted\n" );
+        return 1;
+    }
+
+    return 0;
+}
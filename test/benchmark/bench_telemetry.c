@@ -0,0 +1,259 @@
+/**
+ * @file bench_telemetry.c
+ * @brief Cost and delivery of confirmable against non-confirmable uplinks
+ * (nce_telemetry.h), on the virtual time of the network simulator.
+ *
+ * Each device sends readings over one connection: confirmable (CON),
+ * non-confirmable (NON), which the server answers with a non-confirmable
+ * 2.04, non-confirmable with the No-Response option (NON+NR), and NON+NR
+ * with every HYBRID_INTERVAL-th reading confirmable (hybrid). The table
+ * shows the readings the server got, the datagrams each reading took each
+ * way, the bytes both ways, and the time the radio stays on per reading:
+ * until the last datagram of the reading arrived, a datagram from the
+ * device counted as on air for the one-way latency.
+ *
+ * Usage: bench_telemetry [devices] [readings per device] [loss %]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_telemetry.h"
+#include "nce_netsim.h"
+
+/* Fixed receive timeout of the Linux and Zephyr ports */
+#define FIXED_TIMEOUT_US    10000000u
+
+/* Readings per acknowledged one in the hybrid mode */
+#define HYBRID_INTERVAL     8u
+
+/* Kinds of uplink */
+#define KIND_CON            0
+#define KIND_NON            1
+#define KIND_NON_NR         2
+#define KIND_HYBRID         3
+
+/**
+ * @brief Simulated link.
+ */
+typedef struct link_profile
+{
+    const char * name;  /**< Label. */
+    uint32_t latencyUs; /**< One-way latency. */
+    uint32_t jitterUs;  /**< Uniform jitter added to the latency. */
+} link_profile_t;
+
+static const link_profile_t profiles[] =
+{
+    { "LTE-M",  50000u,  10000u  },
+    { "NB-IoT", 400000u, 200000u }
+};
+
+/* Link of the device being simulated, its clock is the SDK clock. */
+static nce_netsim_t sim;
+
+/* Readings the server got, retransmissions counted once. */
+static unsigned long delivered;
+static uint8_t lastId[ 2 ];
+
+static const char * const kinds[] = { "CON", "NON", "NON+NR", "hybrid" };
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+}
+
+/**
+ * @brief Value of the No-Response option of a request, 0 without one.
+ */
+static uint8_t no_response( const uint8_t * request,
+                            size_t length )
+{
+    unsigned int number = 0;
+    unsigned int field[ 2 ];
+    size_t i = 4;
+    int f;
+
+    while( ( i < length ) && ( request[ i ] != 0xFFu ) )
+    {
+        field[ 0 ] = request[ i ] >> 4;
+        field[ 1 ] = request[ i++ ] & 0x0Fu;
+
+        for( f = 0; f < 2; f++ )
+        {
+            if( field[ f ] == 13u )
+            {
+                field[ f ] = 13u + request[ i++ ];
+            }
+            else if( field[ f ] == 14u )
+            {
+                field[ f ] = 269u + ( ( unsigned int ) request[ i ] << 8 ) + request[ i + 1 ];
+                i += 2;
+            }
+        }
+
+        number += field[ 0 ];
+
+        if( ( number == 258u ) && ( field[ 1 ] == 1u ) )
+        {
+            return request[ i ];
+        }
+
+        i += field[ 1 ];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Data Broker: counts new readings, answers with a piggybacked 2.04
+ * or a non-confirmable one, unless No-Response suppresses 2.xx.
+ */
+static size_t counting_responder( void * arg,
+                                  const uint8_t * request,
+                                  size_t requestLength,
+                                  uint8_t * response,
+                                  size_t responseSize )
+{
+    size_t length;
+
+    if( ( request[ 2 ] != lastId[ 0 ] ) || ( request[ 3 ] != lastId[ 1 ] ) )
+    {
+        delivered++;
+        lastId[ 0 ] = request[ 2 ];
+        lastId[ 1 ] = request[ 3 ];
+    }
+
+    if( ( no_response( request, requestLength ) & NCE_TELEMETRY_NO_RESPONSE_2XX ) != 0u )
+    {
+        return 0;
+    }
+
+    length = nce_netsim_ack_responder( arg, request, requestLength, response, responseSize );
+
+    if( request[ 0 ] != 0x40u )
+    {
+        response[ 0 ] = 0x50;
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the readings of every device over one link and print a row.
+ */
+static void run( const link_profile_t * profile,
+                 int kind,
+                 int devices,
+                 int readings,
+                 unsigned int lossPercent )
+{
+    static const char reading[] = "{\"t\":21.5,\"h\":48}";
+    nce_netsim_config_t config;
+    os_network_ops_t ops;
+    nce_telemetry_t telemetry;
+    nce_telemetry_message_t message;
+    OSEndPoint_t endpoint = { "coap.os.1nce.com", 5683 };
+    uint8_t buffer[ 64 ];
+    unsigned long long up = 0;
+    unsigned long long down = 0;
+    unsigned long long bytes = 0;
+    uint64_t busyUs = 0;
+    uint64_t start;
+    unsigned long count = 0;
+    int i;
+    int n;
+
+    memset( &config, 0, sizeof( config ) );
+    config.lossPercent = lossPercent;
+    config.latencyUs = profile->latencyUs;
+    config.jitterUs = profile->jitterUs;
+    config.recvTimeoutUs = FIXED_TIMEOUT_US;
+
+    memset( &message, 0, sizeof( message ) );
+    message.confirmable = ( kind == KIND_CON );
+    message.noResponse = ( kind >= KIND_NON_NR ) ? NCE_TELEMETRY_NO_RESPONSE_ALL : 0u;
+    message.query = "t=sensors";
+    message.contentFormat = 50;
+    message.payload = reading;
+    message.payloadLength = sizeof( reading ) - 1u;
+
+    delivered = 0;
+
+    for( i = 0; i < devices; i++ )
+    {
+        config.seed = ( uint32_t ) i + 1u;
+        nce_netsim_init( &sim, &config, counting_responder, NULL, &ops );
+        nce_telemetry_init( &telemetry, &ops, &endpoint );
+        telemetry.delayMs = virtual_delay;
+        telemetry.ackInterval = ( kind == KIND_HYBRID ) ? HYBRID_INTERVAL : 0u;
+        lastId[ 0 ] = ( uint8_t ) ~telemetry.messageId;
+
+        for( n = 0; n < readings; n++ )
+        {
+            start = sim.nowUs;
+            ( void ) nce_telemetry_send( &telemetry, &message );
+
+            /* The radio stays on for a response the server sends anyway. */
+            while( sim.inflightCount > 0u )
+            {
+                ( void ) ops.nce_os_udp_recv( ops.os_socket, buffer, sizeof( buffer ) );
+            }
+
+            busyUs += ( sim.nowUs - start > profile->latencyUs ) ? sim.nowUs - start : profile->latencyUs;
+            count++;
+        }
+
+        nce_telemetry_close( &telemetry );
+        up += sim.stats.datagramsSent;
+        down += sim.stats.datagramsReceived;
+        bytes += sim.stats.bytesSent + sim.stats.bytesReceived;
+    }
+
+    printf( "%-7s %-7s %9.2f%% %8.2f %8.2f %9.1f %10.3f\n", profile->name, kinds[ kind ],
+            100.0 * delivered / ( double ) count, ( double ) up / count, ( double ) down / count,
+            ( double ) bytes / count, ( double ) busyUs / count / 1e6 );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int devices = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 200;
+    int readings = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 100;
+    int lossPercent = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 5;
+    size_t p;
+    int kind;
+
+    if( ( devices <= 0 ) || ( readings <= 0 ) || ( lossPercent < 0 ) || ( lossPercent > 100 ) )
+    {
+        fprintf( stderr, "usage: %s [devices] [readings per device] [loss %%]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    printf( "%d devices, %d readings each, %d%% loss each way, fixed timeout %u s\n",
+            devices, readings, lossPercent, FIXED_TIMEOUT_US / 1000000u );
+    printf( "%-7s %-7s %10s %8s %8s %9s %10s\n", "link", "kind", "delivered", "up/rd", "down/rd", "bytes/rd",
+            "radio_s/rd" );
+
+    for( p = 0; p < sizeof( profiles ) / sizeof( profiles[ 0 ] ); p++ )
+    {
+        for( kind = KIND_CON; kind <= KIND_HYBRID; kind++ )
+        {
+            run( &profiles[ p ], kind, devices, readings, ( unsigned int ) lossPercent );
+        }
+    }
+
+    return 0;
+}
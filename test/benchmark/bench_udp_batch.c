@@ -0,0 +1,334 @@
+/**
+ * @file bench_udp_batch.c
+ * @brief Compares one system call per datagram (nce_os_send/nce_os_recv)
+ * with the batched Linux backend, for many device connections talking to a
+ * loopback echo server.
+ *
+ * Usage: bench_udp_batch [devices] [rounds] [datagrams per device per round]
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "nce_iot_c_sdk.h"
+#include "network_interface_linux.h"
+#include "network_batch_linux.h"
+
+#define BENCH_DATAGRAM_SIZE        64
+#define BENCH_WINDOW_DATAGRAMS     128
+#define BENCH_RECV_TIMEOUT_MS      1000
+#define BENCH_ECHO_BATCH           64
+
+typedef struct bench_result
+{
+    double seconds;
+    double cpuSeconds;
+    unsigned long datagrams;
+    unsigned long syscalls;
+    unsigned long lost;
+} bench_result_t;
+
+static int echoSocket;
+static volatile int echoRunning = 1;
+static struct OSNetwork * devices;
+static unsigned char payload[ BENCH_DATAGRAM_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+static double now_seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( double ) ts.tv_sec + ( double ) ts.tv_nsec / 1e9;
+}
+
+static double thread_cpu_seconds( void )
+{
+    struct rusage usage;
+
+    getrusage( RUSAGE_THREAD, &usage );
+    return ( double ) ( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) +
+           ( double ) ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) / 1e6;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Echo server: returns every datagram to its sender, in batches. */
+static void * echo_thread( void * arg )
+{
+    static unsigned char buffers[ BENCH_ECHO_BATCH ][ BENCH_DATAGRAM_SIZE ];
+    static struct sockaddr_in peers[ BENCH_ECHO_BATCH ];
+    struct mmsghdr msgs[ BENCH_ECHO_BATCH ];
+    struct iovec iovecs[ BENCH_ECHO_BATCH ];
+    int received;
+    int i;
+
+    ( void ) arg;
+
+    while( echoRunning )
+    {
+        memset( msgs, 0, sizeof( msgs ) );
+
+        for( i = 0; i < BENCH_ECHO_BATCH; i++ )
+        {
+            iovecs[ i ].iov_base = buffers[ i ];
+            iovecs[ i ].iov_len = BENCH_DATAGRAM_SIZE;
+            msgs[ i ].msg_hdr.msg_iov = &iovecs[ i ];
+            msgs[ i ].msg_hdr.msg_iovlen = 1;
+            msgs[ i ].msg_hdr.msg_name = &peers[ i ];
+            msgs[ i ].msg_hdr.msg_namelen = sizeof( peers[ i ] );
+        }
+
+        received = recvmmsg( echoSocket, msgs, BENCH_ECHO_BATCH, MSG_WAITFORONE, NULL );
+
+        for( i = 0; i < received; i++ )
+        {
+            iovecs[ i ].iov_len = msgs[ i ].msg_len;
+        }
+
+        if( received > 0 )
+        {
+            sendmmsg( echoSocket, msgs, ( unsigned int ) received, 0 );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Baseline: one send and one blocking receive per datagram. */
+static void run_per_datagram( int deviceCount,
+                              int rounds,
+                              int perDevice,
+                              bench_result_t * result )
+{
+    unsigned char buffer[ BENCH_DATAGRAM_SIZE ];
+    int windowDevices = BENCH_WINDOW_DATAGRAMS / perDevice;
+    int round;
+    int first;
+    int device;
+    int k;
+
+    for( round = 0; round < rounds; round++ )
+    {
+        for( first = 0; first < deviceCount; first += windowDevices )
+        {
+            int last = ( first + windowDevices < deviceCount ) ? first + windowDevices : deviceCount;
+
+            for( device = first; device < last; device++ )
+            {
+                for( k = 0; k < perDevice; k++ )
+                {
+                    nce_os_send( &devices[ device ], payload, sizeof( payload ) );
+                    result->syscalls++;
+                }
+            }
+
+            for( device = first; device < last; device++ )
+            {
+                for( k = 0; k < perDevice; k++ )
+                {
+                    result->syscalls++;
+
+                    if( nce_os_recv( &devices[ device ], buffer, sizeof( buffer ) ) > 0 )
+                    {
+                        result->datagrams++;
+                    }
+                    else
+                    {
+                        result->lost++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Batched backend: sendmmsg (or io_uring) + epoll/recvmmsg. */
+static void run_batched( OSNetworkBatch_t osbatch,
+                         int deviceCount,
+                         int rounds,
+                         int perDevice,
+                         bench_result_t * result )
+{
+    static os_datagram_t out[ BENCH_WINDOW_DATAGRAMS ];
+    static os_datagram_t in[ BENCH_WINDOW_DATAGRAMS ];
+    static unsigned char buffers[ BENCH_WINDOW_DATAGRAMS ][ BENCH_DATAGRAM_SIZE ];
+    int windowDevices = BENCH_WINDOW_DATAGRAMS / perDevice;
+    int round;
+    int first;
+    int i;
+
+    for( round = 0; round < rounds; round++ )
+    {
+        for( first = 0; first < deviceCount; first += windowDevices )
+        {
+            int last = ( first + windowDevices < deviceCount ) ? first + windowDevices : deviceCount;
+            int expected = ( last - first ) * perDevice;
+            int received = 0;
+
+            for( i = 0; i < expected; i++ )
+            {
+                out[ i ].osnetwork = &devices[ first + i / perDevice ];
+                out[ i ].pBuffer = payload;
+                out[ i ].length = sizeof( payload );
+            }
+
+            nce_os_send_batch( osbatch, out, ( size_t ) expected );
+
+            while( received < expected )
+            {
+                int got;
+
+                for( i = 0; i < expected - received; i++ )
+                {
+                    in[ i ].pBuffer = buffers[ i ];
+                    in[ i ].length = BENCH_DATAGRAM_SIZE;
+                }
+
+                got = nce_os_recv_batch( osbatch, in, ( size_t ) ( expected - received ), BENCH_RECV_TIMEOUT_MS );
+
+                if( got <= 0 )
+                {
+                    break;
+                }
+
+                received += got;
+            }
+
+            result->datagrams += ( unsigned long ) received;
+            result->lost += ( unsigned long ) ( expected - received );
+        }
+    }
+
+    result->syscalls = osbatch->syscalls;
+}
+
+/*-----------------------------------------------------------*/
+
+static void report( const char * mode,
+                    int deviceCount,
+                    int rounds,
+                    const bench_result_t * result )
+{
+    double perThousand = 1000.0 / ( double ) deviceCount;
+
+    printf( "%-14s %12.0f %18.3f %16.2f %8lu\n", mode,
+            ( double ) result->datagrams / result->seconds,
+            result->cpuSeconds * 1e3 * perThousand / ( double ) rounds,
+            ( double ) result->syscalls / ( double ) ( result->datagrams + result->lost ),
+            result->lost );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int deviceCount = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 1000;
+    int rounds = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 20;
+    int perDevice = ( argc > 3 ) ? atoi( argv[ 3 ] ) : 4;
+    OSEndPoint_t endpoint = { "127.0.0.1", 0 };
+    struct sockaddr_in addr;
+    socklen_t addrLength = sizeof( addr );
+    struct timeval timeo = { BENCH_RECV_TIMEOUT_MS / 1000, ( BENCH_RECV_TIMEOUT_MS % 1000 ) * 1000 };
+    struct OSNetworkBatch batch;
+    pthread_t echo;
+    bench_result_t result;
+    double start;
+    double cpuStart;
+    int i;
+
+    if( ( deviceCount <= 0 ) || ( rounds <= 0 ) || ( perDevice <= 0 ) || ( perDevice > BENCH_WINDOW_DATAGRAMS ) )
+    {
+        fprintf( stderr, "usage: %s [devices] [rounds] [datagrams per device]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    echoSocket = socket( AF_INET, SOCK_DGRAM, 0 );
+
+    if( ( bind( echoSocket, ( struct sockaddr * ) &addr, sizeof( addr ) ) != 0 ) ||
+        ( getsockname( echoSocket, ( struct sockaddr * ) &addr, &addrLength ) != 0 ) )
+    {
+        perror( "echo socket" );
+        return 1;
+    }
+
+    setsockopt( echoSocket, SOL_SOCKET, SO_RCVTIMEO, &timeo, sizeof( timeo ) );
+    endpoint.port = ntohs( addr.sin_port );
+    pthread_create( &echo, NULL, echo_thread, NULL );
+
+    devices = calloc( ( size_t ) deviceCount, sizeof( *devices ) );
+
+    if( ( devices == NULL ) || ( nce_os_batch_init( &batch ) != 0 ) )
+    {
+        return 1;
+    }
+
+    for( i = 0; i < deviceCount; i++ )
+    {
+        if( nce_os_connect( &devices[ i ], endpoint ) != 0 )
+        {
+            fprintf( stderr, "connect failed for device %d (raise the open file limit?)\n", i );
+            return 1;
+        }
+
+        setsockopt( devices[ i ].os_socket, SOL_SOCKET, SO_RCVTIMEO, &timeo, sizeof( timeo ) );
+        nce_os_attach( &batch, &devices[ i ] );
+    }
+
+    printf( "%d devices, %d rounds, %d datagrams of %d bytes per device and round%s\n",
+            deviceCount, rounds, perDevice, BENCH_DATAGRAM_SIZE,
+            ( batch.uring.fd >= 0 ) ? ", sends via io_uring" : "" );
+    printf( "%-14s %12s %18s %16s %8s\n", "mode", "datagrams/s", "cpu ms/1k dev/rnd", "syscalls/dgram", "lost" );
+
+    memset( &result, 0, sizeof( result ) );
+    start = now_seconds();
+    cpuStart = thread_cpu_seconds();
+    run_per_datagram( deviceCount, rounds, perDevice, &result );
+    result.seconds = now_seconds() - start;
+    result.cpuSeconds = thread_cpu_seconds() - cpuStart;
+    report( "per-datagram", deviceCount, rounds, &result );
+
+    memset( &result, 0, sizeof( result ) );
+    start = now_seconds();
+    cpuStart = thread_cpu_seconds();
+    run_batched( &batch, deviceCount, rounds, perDevice, &result );
+    result.seconds = now_seconds() - start;
+    result.cpuSeconds = thread_cpu_seconds() - cpuStart;
+    report( "batched", deviceCount, rounds, &result );
+
+    echoRunning = 0;
+    pthread_join( echo, NULL );
+
+    for( i = 0; i < deviceCount; i++ )
+    {
+        nce_os_disconnect( &devices[ i ] );
+    }
+
+    nce_os_batch_deinit( &batch );
+    close( echoSocket );
+    free( devices );
+
+    return 0;
+}
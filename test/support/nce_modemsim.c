@@ -0,0 +1,91 @@
+/**
+ * @file nce_modemsim.c
+ * @brief Simulated cellular modem and clock for the scheduler tests.
+ */
+
+#include <string.h>
+#include "nce_modemsim.h"
+
+/*-----------------------------------------------------------*/
+
+/* Release the connection if the inactivity timer expired by now. */
+static void prv_update( nce_modemsim_t * modem )
+{
+    uint64_t releaseUs = modem->lastActivityUs + modem->inactivityUs;
+
+    if( modem->connected && ( modem->nowUs >= releaseUs ) )
+    {
+        modem->connectedUs += releaseUs - modem->connectedSinceUs;
+        modem->connected = 0;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_modemsim_init( nce_modemsim_t * modem,
+                        uint32_t inactivityUs,
+                        uint32_t wakeUs )
+{
+    memset( modem, 0, sizeof( *modem ) );
+    modem->inactivityUs = inactivityUs;
+    modem->wakeUs = wakeUs;
+    modem->coverage = 1;
+}
+
+void nce_modemsim_advance( nce_modemsim_t * modem,
+                           uint64_t us )
+{
+    modem->nowUs += us;
+    prv_update( modem );
+}
+
+int nce_modemsim_transmit( nce_modemsim_t * modem,
+                           uint32_t durationUs )
+{
+    prv_update( modem );
+
+    if( !modem->coverage )
+    {
+        return -1;
+    }
+
+    if( !modem->connected )
+    {
+        modem->wakeups++;
+        modem->connected = 1;
+        modem->connectedSinceUs = modem->nowUs;
+        modem->nowUs += modem->wakeUs;
+    }
+
+    modem->nowUs += durationUs;
+    modem->lastActivityUs = modem->nowUs;
+    modem->transmissions++;
+
+    return 0;
+}
+
+int nce_modemsim_radio_state( void * arg )
+{
+    nce_modemsim_t * modem = ( nce_modemsim_t * ) arg;
+
+    prv_update( modem );
+
+    if( !modem->coverage )
+    {
+        return NCE_RADIO_OFFLINE;
+    }
+
+    return modem->connected ? NCE_RADIO_CONNECTED : NCE_RADIO_IDLE;
+}
+
+uint64_t nce_modemsim_connected_us( const nce_modemsim_t * modem )
+{
+    uint64_t total = modem->connectedUs;
+
+    if( modem->connected )
+    {
+        total += modem->nowUs - modem->connectedSinceUs;
+    }
+
+    return total;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file nce_modemsim.h
+ * @brief Simulated cellular modem and clock for the scheduler tests.
+ *
+ * The modem sleeps until a transmission wakes it, stays in RRC connected
+ * while transmissions keep coming and goes back to sleep after the network's
+ * inactivity timer expires. Time is virtual and only moves through
+ * nce_modemsim_advance() and nce_modemsim_transmit().
+ */
+
+#ifndef NCE_MODEMSIM_H_
+#define NCE_MODEMSIM_H_
+
+#include <stdint.h>
+#include "nce_scheduler.h"
+
+/**
+ * @brief State of one simulated modem.
+ */
+typedef struct nce_modemsim
+{
+    uint64_t nowUs;              /**< Virtual time. */
+    uint32_t inactivityUs;       /**< RRC inactivity timer of the network. */
+    uint32_t wakeUs;             /**< Connection setup time of a wake-up. */
+    int coverage;                /**< Cleared to simulate an outage. */
+    int connected;               /**< Set while in RRC connected. */
+    uint64_t lastActivityUs;     /**< End of the last transmission. */
+    uint64_t connectedSinceUs;   /**< Start of the current connection. */
+    uint64_t connectedUs;        /**< Time spent connected in finished connections. */
+    unsigned long wakeups;       /**< Connections set up. */
+    unsigned long transmissions; /**< Calls to nce_modemsim_transmit(). */
+} nce_modemsim_t;
+
+/**
+ * @brief Initialize a sleeping modem in coverage at time 0.
+ *
+ * @param[out] modem Modem to initialize.
+ * @param[in] inactivityUs RRC inactivity timer.
+ * @param[in] wakeUs Connection setup time.
+ */
+void nce_modemsim_init( nce_modemsim_t * modem,
+                        uint32_t inactivityUs,
+                        uint32_t wakeUs );
+
+/**
+ * @brief Move the virtual time forward, releasing the connection when the
+ * inactivity timer expires.
+ *
+ * @param[in] modem Modem.
+ * @param[in] us Time to advance.
+ */
+void nce_modemsim_advance( nce_modemsim_t * modem,
+                           uint64_t us );
+
+/**
+ * @brief Transmit for some time, waking the modem first if it sleeps.
+ *
+ * @param[in] modem Modem.
+ * @param[in] durationUs Time on air.
+ * @return 0, or -1 without coverage.
+ */
+int nce_modemsim_transmit( nce_modemsim_t * modem,
+                           uint32_t durationUs );
+
+/**
+ * @brief Radio signal for the scheduler (nce_sched_radio_t::state).
+ *
+ * @param[in] arg The nce_modemsim_t.
+ * @return One of nce_radio_state_t.
+ */
+int nce_modemsim_radio_state( void * arg );
+
+/**
+ * @brief Time spent connected so far, the main energy cost.
+ *
+ * @param[in] modem Modem.
+ * @return Microseconds.
+ */
+uint64_t nce_modemsim_connected_us( const nce_modemsim_t * modem );
+
+#endif /* ifndef NCE_MODEMSIM_H_ */
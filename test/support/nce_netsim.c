@@ -0,0 +1,333 @@
+/**
+ * @file nce_netsim.c
+ * @brief Deterministic lossy network simulator implementing os_network_ops_t.
+ */
+
+#include <string.h>
+#include "nce_netsim.h"
+
+#define NETSIM_COAP_HEADER_SIZE      4
+#define NETSIM_COAP_NON_NO_TOKEN     0x50
+#define NETSIM_COAP_CODE_CONTENT     0x45
+#define NETSIM_COAP_ACK_NO_TOKEN     0x60
+#define NETSIM_COAP_CODE_CHANGED     0x44
+#define NETSIM_COAP_PAYLOAD_MARKER   0xFF
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prv_random( nce_netsim_t * sim )
+{
+    /* xorshift32 */
+    sim->rng ^= sim->rng << 13;
+    sim->rng ^= sim->rng >> 17;
+    sim->rng ^= sim->rng << 5;
+    return sim->rng;
+}
+
+static int prv_chance( nce_netsim_t * sim,
+                       unsigned int percent )
+{
+    return ( percent > 0 ) && ( ( prv_random( sim ) % 100u ) < percent );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Time a datagram of the given length reaches the other side of the link. */
+static uint64_t prv_transit( nce_netsim_t * sim,
+                             uint64_t * linkFreeUs,
+                             uint64_t sentUs,
+                             size_t length )
+{
+    uint64_t start = ( *linkFreeUs > sentUs ) ? *linkFreeUs : sentUs;
+    uint64_t arrival;
+
+    if( sim->config.bytesPerSecond > 0 )
+    {
+        start += ( uint64_t ) length * 1000000u / sim->config.bytesPerSecond;
+    }
+
+    *linkFreeUs = start;
+    arrival = start + sim->config.latencyUs;
+
+    if( sim->config.jitterUs > 0 )
+    {
+        arrival += prv_random( sim ) % sim->config.jitterUs;
+    }
+
+    if( prv_chance( sim, sim->config.reorderPercent ) )
+    {
+        sim->stats.reordered++;
+        arrival += sim->config.latencyUs + sim->config.jitterUs;
+    }
+
+    return arrival;
+}
+
+/* Whether a datagram over the MTU loses one of its extra fragments. */
+static int prv_fragment_lost( nce_netsim_t * sim,
+                              size_t length )
+{
+    size_t fragments;
+    int lost = 0;
+
+    if( ( sim->config.mtu == 0 ) || ( length <= sim->config.mtu ) )
+    {
+        return 0;
+    }
+
+    sim->stats.fragmented++;
+
+    for( fragments = ( length + sim->config.mtu - 1 ) / sim->config.mtu; fragments > 1; fragments-- )
+    {
+        lost |= prv_chance( sim, sim->config.fragmentLossPercent );
+    }
+
+    return lost;
+}
+
+/* Number of copies of a datagram that survive the link: 0, 1 or 2. */
+static int prv_copies( nce_netsim_t * sim,
+                       size_t length )
+{
+    if( prv_chance( sim, sim->config.lossPercent ) || prv_fragment_lost( sim, length ) )
+    {
+        sim->stats.dropped++;
+        return 0;
+    }
+
+    if( prv_chance( sim, sim->config.dupPercent ) )
+    {
+        sim->stats.duplicated++;
+        return 2;
+    }
+
+    return 1;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prv_deliver_to_device( nce_netsim_t * sim,
+                                   uint64_t sentUs,
+                                   const uint8_t * data,
+                                   size_t length )
+{
+    int copies = prv_copies( sim, length );
+
+    while( ( copies-- > 0 ) && ( sim->inflightCount < NCE_NETSIM_QUEUE_SIZE ) )
+    {
+        nce_netsim_datagram_t * datagram = &sim->inflight[ sim->inflightCount++ ];
+
+        datagram->arrivalUs = prv_transit( sim, &sim->downlinkFreeUs, sentUs, length );
+        datagram->length = length;
+        memcpy( datagram->data, data, length );
+    }
+}
+
+static void prv_deliver_to_remote( nce_netsim_t * sim,
+                                   const uint8_t * data,
+                                   size_t length )
+{
+    uint8_t response[ NCE_NETSIM_MAX_DATAGRAM ];
+    int copies = prv_copies( sim, length );
+
+    while( copies-- > 0 )
+    {
+        /* The remote answers as soon as the datagram arrives. */
+        uint64_t arrivalUs = prv_transit( sim, &sim->uplinkFreeUs, sim->nowUs, length );
+        size_t responseLength = sim->responder( sim->responderArg, data, length,
+                                                response, sizeof( response ) );
+
+        if( responseLength > 0 )
+        {
+            prv_deliver_to_device( sim, arrivalUs, response, responseLength );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_connect( OSNetwork_t osnetwork,
+                        OSEndPoint_t endpoint )
+{
+    nce_netsim_t * sim = ( nce_netsim_t * ) osnetwork;
+
+    ( void ) endpoint;
+    sim->connected = 1;
+    sim->stats.connects++;
+
+    return 0;
+}
+
+static int prv_send( OSNetwork_t osnetwork,
+                     void * pBuffer,
+                     size_t bytesToSend )
+{
+    nce_netsim_t * sim = ( nce_netsim_t * ) osnetwork;
+
+    if( !sim->connected || ( bytesToSend > NCE_NETSIM_MAX_DATAGRAM ) )
+    {
+        return -1;
+    }
+
+    sim->stats.datagramsSent++;
+    sim->stats.bytesSent += ( unsigned long ) bytesToSend;
+    prv_deliver_to_remote( sim, ( const uint8_t * ) pBuffer, bytesToSend );
+
+    return ( int ) bytesToSend;
+}
+
+static int prv_recv( OSNetwork_t osnetwork,
+                     void * pBuffer,
+                     size_t bytesToRecv )
+{
+    nce_netsim_t * sim = ( nce_netsim_t * ) osnetwork;
+    uint64_t deadline = sim->nowUs + sim->config.recvTimeoutUs;
+    size_t next = 0;
+    size_t length;
+    size_t i;
+
+    if( !sim->connected )
+    {
+        return -1;
+    }
+
+    for( i = 1; i < sim->inflightCount; i++ )
+    {
+        if( sim->inflight[ i ].arrivalUs < sim->inflight[ next ].arrivalUs )
+        {
+            next = i;
+        }
+    }
+
+    if( ( sim->inflightCount == 0 ) || ( sim->inflight[ next ].arrivalUs > deadline ) )
+    {
+        sim->nowUs = deadline;
+        sim->stats.timeouts++;
+        return 0;
+    }
+
+    if( sim->inflight[ next ].arrivalUs > sim->nowUs )
+    {
+        sim->nowUs = sim->inflight[ next ].arrivalUs;
+    }
+
+    length = ( sim->inflight[ next ].length < bytesToRecv ) ? sim->inflight[ next ].length : bytesToRecv;
+    memcpy( pBuffer, sim->inflight[ next ].data, length );
+    sim->inflight[ next ] = sim->inflight[ --sim->inflightCount ];
+    sim->stats.datagramsReceived++;
+    sim->stats.bytesReceived += ( unsigned long ) length;
+
+    return ( int ) length;
+}
+
+static int prv_disconnect( OSNetwork_t osnetwork )
+{
+    nce_netsim_t * sim = ( nce_netsim_t * ) osnetwork;
+
+    /* Datagrams still in flight are lost with the socket. */
+    sim->connected = 0;
+    sim->inflightCount = 0;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_netsim_init( nce_netsim_t * sim,
+                      const nce_netsim_config_t * config,
+                      nce_netsim_responder_t responder,
+                      void * responderArg,
+                      os_network_ops_t * ops )
+{
+    memset( sim, 0, sizeof( *sim ) );
+    sim->config = *config;
+    sim->responder = responder;
+    sim->responderArg = responderArg;
+    sim->rng = ( config->seed != 0 ) ? config->seed : 1;
+
+    ops->os_socket = ( OSNetwork_t ) sim;
+    ops->nce_os_udp_connect = prv_connect;
+    ops->nce_os_udp_send = prv_send;
+    ops->nce_os_udp_recv = prv_recv;
+    ops->nce_os_udp_disconnect = prv_disconnect;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_netsim_set_recv_timeout( OSNetwork_t osnetwork,
+                                 uint32_t ms )
+{
+    nce_netsim_t * sim = ( nce_netsim_t * ) osnetwork;
+
+    sim->config.recvTimeoutUs = ms * 1000u;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_netsim_push( nce_netsim_t * sim,
+                      const uint8_t * data,
+                      size_t length )
+{
+    prv_deliver_to_device( sim, sim->nowUs, data, length );
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_netsim_onboard_responder( void * arg,
+                                     const uint8_t * request,
+                                     size_t requestLength,
+                                     uint8_t * response,
+                                     size_t responseSize )
+{
+    static const char payload[] = NCE_NETSIM_IDENTITY "," NCE_NETSIM_PSK;
+    size_t length = NETSIM_COAP_HEADER_SIZE + 1 + sizeof( payload ) - 1;
+    size_t i;
+
+    ( void ) arg;
+
+    if( responseSize < length )
+    {
+        return 0;
+    }
+
+    for( i = 0; i + sizeof( "bootstrap" ) - 1 <= requestLength; i++ )
+    {
+        if( memcmp( &request[ i ], "bootstrap", sizeof( "bootstrap" ) - 1 ) == 0 )
+        {
+            /* 2.05 Content echoing the message ID, without token. */
+            response[ 0 ] = NETSIM_COAP_NON_NO_TOKEN;
+            response[ 1 ] = NETSIM_COAP_CODE_CONTENT;
+            response[ 2 ] = ( requestLength > 3 ) ? request[ 2 ] : 0;
+            response[ 3 ] = ( requestLength > 3 ) ? request[ 3 ] : 0;
+            response[ 4 ] = NETSIM_COAP_PAYLOAD_MARKER;
+            memcpy( &response[ 5 ], payload, sizeof( payload ) - 1 );
+            return length;
+        }
+    }
+
+    return 0;
+}
+
+size_t nce_netsim_ack_responder( void * arg,
+                                 const uint8_t * request,
+                                 size_t requestLength,
+                                 uint8_t * response,
+                                 size_t responseSize )
+{
+    ( void ) arg;
+
+    if( ( requestLength < NETSIM_COAP_HEADER_SIZE ) || ( responseSize < NETSIM_COAP_HEADER_SIZE ) )
+    {
+        return 0;
+    }
+
+    /* Piggybacked 2.04 Changed echoing the message ID, without token. */
+    response[ 0 ] = NETSIM_COAP_ACK_NO_TOKEN;
+    response[ 1 ] = NETSIM_COAP_CODE_CHANGED;
+    response[ 2 ] = request[ 2 ];
+    response[ 3 ] = request[ 3 ];
+
+    return NETSIM_COAP_HEADER_SIZE;
+}
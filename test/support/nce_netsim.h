@@ -0,0 +1,190 @@
+/**
+ * @file nce_netsim.h
+ * @brief Deterministic lossy network simulator implementing os_network_ops_t.
+ *
+ * The simulator runs on virtual time: a receive that finds no datagram in
+ * flight advances the clock by the receive timeout and reports a timeout
+ * (0 bytes) immediately, so retry and timeout behaviour can be measured
+ * without waiting. Loss, duplication, reordering, latency and bandwidth are
+ * drawn from a seeded generator, the same seed always gives the same run.
+ *
+ * The remote side is a responder callback invoked when a datagram reaches
+ * it; nce_netsim_onboard_responder() answers Device Authenticator requests.
+ */
+
+#ifndef NCE_NETSIM_H_
+#define NCE_NETSIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "udp_interface.h"
+
+/**
+ * @brief Largest datagram carried by the simulator.
+ */
+#define NCE_NETSIM_MAX_DATAGRAM    1280
+
+/**
+ * @brief Datagrams that can be in flight towards the device.
+ */
+#define NCE_NETSIM_QUEUE_SIZE      16
+
+/**
+ * @brief Identity issued by nce_netsim_onboard_responder().
+ */
+#define NCE_NETSIM_IDENTITY        "8988228066601234567"
+
+/**
+ * @brief PSK issued by nce_netsim_onboard_responder().
+ */
+#define NCE_NETSIM_PSK             "netsimpsk"
+
+/**
+ * @brief Remote endpoint: builds the answer to a datagram.
+ *
+ * @param[in] arg Argument given to nce_netsim_init().
+ * @param[in] request Datagram received by the remote endpoint.
+ * @param[in] requestLength Length of the datagram.
+ * @param[out] response Answer to send back.
+ * @param[in] responseSize Size of the answer buffer.
+ * @return Length of the answer, 0 to send nothing.
+ */
+typedef size_t (* nce_netsim_responder_t)( void * arg,
+                                           const uint8_t * request,
+                                           size_t requestLength,
+                                           uint8_t * response,
+                                           size_t responseSize );
+
+/**
+ * @brief Link impairments, applied independently in each direction.
+ */
+typedef struct nce_netsim_config
+{
+    uint32_t seed;                    /**< Seed of the generator, 0 is replaced by 1. */
+    unsigned int lossPercent;         /**< Chance a datagram is dropped. */
+    unsigned int dupPercent;          /**< Chance a datagram is delivered twice. */
+    unsigned int reorderPercent;      /**< Chance a datagram is held back by one extra latency. */
+    uint32_t latencyUs;               /**< One-way propagation delay. */
+    uint32_t jitterUs;                /**< Uniform random delay added to the latency. */
+    uint32_t bytesPerSecond;          /**< Link rate, 0 for unlimited. */
+    uint32_t recvTimeoutUs;           /**< Time a receive waits before reporting a timeout. */
+    uint32_t mtu;                     /**< Largest datagram carried in one IP packet, larger ones are fragmented. 0 for unlimited. */
+    unsigned int fragmentLossPercent; /**< Chance each fragment after the first is lost, 100 for a carrier dropping fragments. */
+} nce_netsim_config_t;
+
+/**
+ * @brief Traffic seen by the device.
+ */
+typedef struct nce_netsim_stats
+{
+    unsigned long connects;          /**< Calls to connect. */
+    unsigned long datagramsSent;     /**< Datagrams sent by the device. */
+    unsigned long bytesSent;         /**< Bytes sent by the device. */
+    unsigned long datagramsReceived; /**< Datagrams received by the device. */
+    unsigned long bytesReceived;     /**< Bytes received by the device. */
+    unsigned long dropped;           /**< Datagrams lost, both directions. */
+    unsigned long fragmented;        /**< Datagrams split over several IP packets, both directions. */
+    unsigned long duplicated;        /**< Extra copies delivered, both directions. */
+    unsigned long reordered;         /**< Datagrams held back, both directions. */
+    unsigned long timeouts;          /**< Receives that timed out. */
+} nce_netsim_stats_t;
+
+/**
+ * @brief Datagram in flight towards the device.
+ */
+typedef struct nce_netsim_datagram
+{
+    uint64_t arrivalUs;                      /**< Virtual time of delivery. */
+    size_t length;                           /**< Length of the datagram. */
+    uint8_t data[ NCE_NETSIM_MAX_DATAGRAM ]; /**< Content of the datagram. */
+} nce_netsim_datagram_t;
+
+/**
+ * @brief State of one simulated link, one per device.
+ */
+typedef struct nce_netsim
+{
+    nce_netsim_config_t config;                               /**< Impairments. */
+    nce_netsim_responder_t responder;                         /**< Remote endpoint. */
+    void * responderArg;                                      /**< Argument of the responder. */
+    uint32_t rng;                                             /**< Generator state. */
+    uint64_t nowUs;                                           /**< Virtual time. */
+    uint64_t uplinkFreeUs;                                    /**< Time the uplink finishes its last datagram. */
+    uint64_t downlinkFreeUs;                                  /**< Time the downlink finishes its last datagram. */
+    int connected;                                            /**< Set between connect and disconnect. */
+    size_t inflightCount;                                     /**< Used entries of inflight. */
+    nce_netsim_datagram_t inflight[ NCE_NETSIM_QUEUE_SIZE ];  /**< Datagrams towards the device. */
+    nce_netsim_stats_t stats;                                 /**< Traffic counters. */
+} nce_netsim_t;
+
+/**
+ * @brief Initialize a link and the network operations driving it.
+ *
+ * @param[out] sim Link to initialize.
+ * @param[in] config Impairments of the link.
+ * @param[in] responder Remote endpoint.
+ * @param[in] responderArg Argument passed to the responder.
+ * @param[out] ops Network operations to hand to the SDK.
+ */
+void nce_netsim_init( nce_netsim_t * sim,
+                      const nce_netsim_config_t * config,
+                      nce_netsim_responder_t responder,
+                      void * responderArg,
+                      os_network_ops_t * ops );
+
+/**
+ * @brief Set the receive timeout of a link, like a port applying SO_RCVTIMEO.
+ *
+ * @param[in] osnetwork Link, the os_socket of its network operations.
+ * @param[in] ms Timeout in milliseconds.
+ * @return 0.
+ */
+int nce_netsim_set_recv_timeout( OSNetwork_t osnetwork,
+                                 uint32_t ms );
+
+/**
+ * @brief Send a datagram from the remote endpoint to the device without a
+ * request, like a server-initiated CoAP message, over the impaired downlink.
+ * @param[in] sim Link.
+ * @param[in] data Datagram.
+ * @param[in] length Length of the datagram, at most NCE_NETSIM_MAX_DATAGRAM.
+ */
+void nce_netsim_push( nce_netsim_t * sim,
+                      const uint8_t * data,
+                      size_t length );
+
+/**
+ * @brief Responder answering Device Authenticator requests with a fixed
+ * identity and PSK, other requests are ignored.
+ *
+ * @param[in] arg Unused.
+ * @param[in] request Datagram received by the remote endpoint.
+ * @param[in] requestLength Length of the datagram.
+ * @param[out] response Answer to send back.
+ * @param[in] responseSize Size of the answer buffer.
+ * @return Length of the answer, 0 to send nothing.
+ */
+size_t nce_netsim_onboard_responder( void * arg,
+                                     const uint8_t * request,
+                                     size_t requestLength,
+                                     uint8_t * response,
+                                     size_t responseSize );
+
+/**
+ * @brief Responder acknowledging every CoAP request with 2.04 Changed, like
+ * the CoAP proxy receiving Memfault chunks.
+ *
+ * @param[in] arg Unused.
+ * @param[in] request Datagram received by the remote endpoint.
+ * @param[in] requestLength Length of the datagram.
+ * @param[out] response Answer to send back.
+ * @param[in] responseSize Size of the answer buffer.
+ * @return Length of the answer, 0 to send nothing.
+ */
+size_t nce_netsim_ack_responder( void * arg,
+                                 const uint8_t * request,
+                                 size_t requestLength,
+                                 uint8_t * response,
+                                 size_t responseSize );
+
+#endif /* ifndef NCE_NETSIM_H_ */
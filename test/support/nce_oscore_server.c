@@ -0,0 +1,340 @@
+/**
+ * @file nce_oscore_server.c
+ * @brief OSCORE server stand-in answering as a network simulator responder.
+ */
+
+#include <string.h>
+#include "crypto_interface.h"
+#include "nce_oscore_server.h"
+
+#define SERVER_COAP_OPTION_OSCORE    9u
+#define SERVER_COAP_CON              0u
+#define SERVER_COAP_ACK              0x60u
+#define SERVER_COAP_CODE_CHANGED     0x44u
+#define SERVER_REPLAY_WINDOW         32u
+
+/* Sender ID of the server, the device uses the empty one. */
+static const uint8_t serverId[ 1 ] = { 0x01 };
+
+/*-----------------------------------------------------------*/
+
+/* Key or Common IV of the device context (RFC 8613 section 3.2.1). */
+static int prv_derive( const nce_oscore_server_t * server,
+                       const uint8_t * id,
+                       size_t idLength,
+                       int iv,
+                       uint8_t * out )
+{
+    uint8_t info[ 64 ];
+    size_t length = 0;
+    size_t outLength = iv ? 13u : 16u;
+
+    info[ length++ ] = 0x85;
+    info[ length++ ] = ( uint8_t ) ( 0x40 | idLength );
+
+    if( idLength > 0u )
+    {
+        memcpy( &info[ length ], id, idLength );
+        length += idLength;
+    }
+
+    if( server->identityLength < 24u )
+    {
+        info[ length++ ] = ( uint8_t ) ( 0x40 | server->identityLength );
+    }
+    else
+    {
+        info[ length++ ] = 0x58;
+        info[ length++ ] = ( uint8_t ) server->identityLength;
+    }
+
+    memcpy( &info[ length ], server->identity, server->identityLength );
+    length += server->identityLength;
+    info[ length++ ] = 10;
+    memcpy( &info[ length ], iv ? "\x62IV" : "\x63Key", iv ? 3u : 4u );
+    length += iv ? 3u : 4u;
+    info[ length++ ] = ( uint8_t ) outLength;
+
+    return nce_os_hkdf_sha256( NULL, 0, server->psk, server->pskLength, info, length, out, outLength );
+}
+
+/* Value of a CoAP option delta or length, -1 if malformed. */
+static long prv_extended( unsigned int nibble,
+                          const uint8_t * message,
+                          size_t length,
+                          size_t * offset )
+{
+    long value = -1;
+
+    if( nibble < 13u )
+    {
+        value = ( long ) nibble;
+    }
+    else if( ( nibble == 13u ) && ( *offset < length ) )
+    {
+        value = 13 + message[ ( *offset )++ ];
+    }
+    else if( ( nibble == 14u ) && ( *offset + 1u < length ) )
+    {
+        value = 269 + ( ( long ) message[ *offset ] << 8 ) + message[ *offset + 1u ];
+        *offset += 2u;
+    }
+
+    return value;
+}
+
+/* Find the OSCORE option and the ciphertext of a request. */
+static int prv_parse( const uint8_t * message,
+                      size_t length,
+                      const uint8_t ** option,
+                      size_t * optionLength,
+                      const uint8_t ** payload,
+                      size_t * payloadLength )
+{
+    size_t offset = 4u + ( message[ 0 ] & 0x0Fu );
+    unsigned long number = 0;
+    long delta;
+    long valueLength;
+
+    *option = NULL;
+    *payload = NULL;
+
+    while( offset < length )
+    {
+        if( message[ offset ] == 0xFF )
+        {
+            *payload = &message[ offset + 1u ];
+            *payloadLength = length - offset - 1u;
+            break;
+        }
+
+        offset++;
+        delta = prv_extended( message[ offset - 1u ] >> 4, message, length, &offset );
+        valueLength = prv_extended( message[ offset - 1u ] & 0x0Fu, message, length, &offset );
+
+        if( ( delta < 0 ) || ( valueLength < 0 ) || ( ( size_t ) valueLength > length - offset ) )
+        {
+            return -1;
+        }
+
+        number += ( unsigned long ) delta;
+
+        if( number == SERVER_COAP_OPTION_OSCORE )
+        {
+            *option = &message[ offset ];
+            *optionLength = ( size_t ) valueLength;
+        }
+
+        offset += ( size_t ) valueLength;
+    }
+
+    return ( *option != NULL ) && ( *payload != NULL ) ? 0 : -1;
+}
+
+/* AAD of a request and its response, for the empty kid of the device. */
+static size_t prv_aad( uint8_t * aad,
+                       const uint8_t * piv,
+                       size_t pivLength )
+{
+    size_t length = 0;
+
+    memcpy( aad, "\x83\x68" "Encrypt0" "\x40", 11 );
+    length = 11;
+    aad[ length++ ] = ( uint8_t ) ( 0x40 | ( 7u + pivLength ) );
+    memcpy( &aad[ length ], "\x85\x01\x81\x0a\x40", 5 );
+    length += 5;
+    aad[ length++ ] = ( uint8_t ) ( 0x40 | pivLength );
+    memcpy( &aad[ length ], piv, pivLength );
+    length += pivLength;
+    aad[ length++ ] = 0x40;
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_oscore_server_init( nce_oscore_server_t * server,
+                             const uint8_t * psk,
+                             size_t pskLength,
+                             const uint8_t * identity,
+                             size_t identityLength )
+{
+    memset( server, 0, sizeof( *server ) );
+    memcpy( server->psk, psk, pskLength );
+    server->pskLength = pskLength;
+    memcpy( server->identity, identity, identityLength );
+    server->identityLength = identityLength;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t nce_oscore_server_responder( void * arg,
+                                    const uint8_t * request,
+                                    size_t requestLength,
+                                    uint8_t * response,
+                                    size_t responseSize )
+{
+    nce_oscore_server_t * server = arg;
+    const uint8_t * option;
+    const uint8_t * ciphertext;
+    size_t optionLength;
+    size_t ciphertextLength;
+    size_t pivLength;
+    size_t offset;
+    size_t aadLength;
+    size_t tokenLength;
+    uint8_t aad[ 32 ];
+    uint8_t nonce[ 13 ];
+    uint8_t code = SERVER_COAP_CODE_CHANGED;
+    uint64_t sequence = 0;
+    uint64_t age;
+    uint16_t messageId;
+    size_t i;
+
+    if( ( requestLength < 4u ) || ( ( request[ 0 ] & 0x0Fu ) > 8u ) ||
+        ( prv_parse( request, requestLength, &option, &optionLength, &ciphertext, &ciphertextLength ) != 0 ) ||
+        ( optionLength < 1u ) || ( ciphertextLength <= 8u ) || ( ciphertextLength - 8u > sizeof( server->lastPlaintext ) ) )
+    {
+        server->rejected++;
+        return 0;
+    }
+
+    messageId = ( uint16_t ) ( ( request[ 2 ] << 8 ) | request[ 3 ] );
+
+    if( ( server->lastAnswerLength > 0u ) && ( messageId == server->lastMessageId ) &&
+        ( server->lastAnswerLength <= responseSize ) )
+    {
+        server->duplicates++;
+        memcpy( response, server->lastAnswer, server->lastAnswerLength );
+        return server->lastAnswerLength;
+    }
+
+    /* flags | Partial IV | s | kid context | kid */
+    pivLength = option[ 0 ] & 0x07u;
+    offset = 1u + pivLength;
+
+    if( ( pivLength == 0u ) || ( pivLength > 5u ) || ( offset > optionLength ) )
+    {
+        server->rejected++;
+        return 0;
+    }
+
+    if( option[ 0 ] & 0x10u )
+    {
+        if( ( offset >= optionLength ) || ( option[ offset ] != server->identityLength ) ||
+            ( offset + 1u + server->identityLength > optionLength ) ||
+            ( memcmp( &option[ offset + 1u ], server->identity, server->identityLength ) != 0 ) )
+        {
+            server->rejected++;
+            return 0;
+        }
+
+        offset += 1u + server->identityLength;
+    }
+
+    /* Only the device with the empty Sender ID is known. */
+    if( ( ( option[ 0 ] & 0x08u ) == 0u ) || ( offset != optionLength ) )
+    {
+        server->rejected++;
+        return 0;
+    }
+
+    if( !server->derived )
+    {
+        if( ( ( option[ 0 ] & 0x10u ) == 0u ) ||
+            ( prv_derive( server, NULL, 0, 0, server->requestKey ) != 0 ) ||
+            ( prv_derive( server, serverId, sizeof( serverId ), 0, server->responseKey ) != 0 ) ||
+            ( prv_derive( server, NULL, 0, 1, server->commonIv ) != 0 ) )
+        {
+            server->rejected++;
+            return 0;
+        }
+
+        server->derived = 1;
+    }
+
+    for( i = 0; i < pivLength; i++ )
+    {
+        sequence = ( sequence << 8 ) | option[ 1u + i ];
+    }
+
+    if( server->seen && ( sequence <= server->highest ) )
+    {
+        age = server->highest - sequence;
+
+        if( ( age >= SERVER_REPLAY_WINDOW ) || ( server->window & ( 1u << age ) ) )
+        {
+            server->replays++;
+            return 0;
+        }
+    }
+
+    /* Nonce from the empty ID of the device and the Partial IV. */
+    memcpy( nonce, server->commonIv, sizeof( nonce ) );
+
+    for( i = 0; i < pivLength; i++ )
+    {
+        nonce[ 13u - pivLength + i ] ^= option[ 1u + i ];
+    }
+
+    aadLength = prv_aad( aad, &option[ 1 ], pivLength );
+
+    if( nce_os_aes_ccm_decrypt( server->requestKey, nonce, aad, aadLength, ciphertext, ciphertextLength,
+                                server->lastPlaintext ) != 0 )
+    {
+        server->rejected++;
+        return 0;
+    }
+
+    server->lastPlaintextLength = ciphertextLength - 8u;
+
+    if( !server->seen || ( sequence > server->highest ) )
+    {
+        age = server->seen ? sequence - server->highest : SERVER_REPLAY_WINDOW;
+        server->window = ( age >= SERVER_REPLAY_WINDOW ) ? 1u : ( ( server->window << age ) | 1u );
+        server->highest = sequence;
+        server->seen = 1;
+    }
+    else
+    {
+        server->window |= 1u << ( server->highest - sequence );
+    }
+
+    server->accepted++;
+    tokenLength = request[ 0 ] & 0x0Fu;
+
+    if( ( ( request[ 0 ] >> 4 ) & 0x03u ) != SERVER_COAP_CON )
+    {
+        return 0;
+    }
+
+    if( responseSize < 4u + tokenLength + 2u + 1u + 8u )
+    {
+        return 0;
+    }
+
+    /* Piggybacked ACK, 2.04 outside and inside, OSCORE option empty: the
+     * response reuses the nonce of the request. */
+    response[ 0 ] = ( uint8_t ) ( SERVER_COAP_ACK | tokenLength );
+    response[ 1 ] = SERVER_COAP_CODE_CHANGED;
+    memcpy( &response[ 2 ], &request[ 2 ], 2u + tokenLength );
+    offset = 4u + tokenLength;
+    response[ offset++ ] = 0x90;
+    response[ offset++ ] = 0xFF;
+
+    if( nce_os_aes_ccm_encrypt( server->responseKey, nonce, aad, aadLength, &code, 1, &response[ offset ] ) != 0 )
+    {
+        return 0;
+    }
+
+    offset += 1u + 8u;
+
+    if( offset <= sizeof( server->lastAnswer ) )
+    {
+        memcpy( server->lastAnswer, response, offset );
+        server->lastAnswerLength = offset;
+        server->lastMessageId = messageId;
+    }
+
+    return offset;
+}
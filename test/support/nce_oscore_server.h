@@ -0,0 +1,82 @@
+/**
+ * @file nce_oscore_server.h
+ * @brief OSCORE server stand-in for host tests and benchmarks, answering as a
+ * network simulator responder (nce_netsim.h).
+ *
+ * The server knows the credentials of one device. It derives the security
+ * context of the device from the PSK and the identity found as kid context of
+ * the first request, as the 1NCE OS would, checks each request against a
+ * replay window and answers confirmable requests with a protected 2.04
+ * (Changed). Non-confirmable requests are processed without answer. A
+ * retransmission of the last confirmable request, with the same Message ID,
+ * gets the cached answer again, as CoAP deduplication does below OSCORE.
+ *
+ * It is written apart from nce_oscore.c, sharing only the crypto port, so
+ * that the tests compare two implementations of RFC 8613.
+ */
+
+#ifndef NCE_OSCORE_SERVER_H_
+#define NCE_OSCORE_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief State of the server.
+ */
+typedef struct nce_oscore_server
+{
+    uint8_t psk[ 64 ];               /**< PSK of the device, the Master Secret. */
+    size_t pskLength;                /**< Length of the PSK. */
+    uint8_t identity[ 32 ];          /**< Identity of the device, the ID Context. */
+    size_t identityLength;           /**< Length of the identity. */
+    uint8_t requestKey[ 16 ];        /**< Sender Key of the device. */
+    uint8_t responseKey[ 16 ];       /**< Sender Key of the server. */
+    uint8_t commonIv[ 13 ];          /**< Common IV. */
+    int derived;                     /**< Nonzero once the keys are derived. */
+    uint64_t highest;                /**< Highest Partial IV accepted. */
+    uint32_t window;                 /**< Bit i set: highest - i was accepted. */
+    int seen;                        /**< Nonzero once a request was accepted. */
+    uint8_t lastPlaintext[ 256 ];    /**< Inner code, options and payload of the last request. */
+    size_t lastPlaintextLength;      /**< Length of lastPlaintext. */
+    uint8_t lastAnswer[ 32 ];        /**< Answer to the last confirmable request. */
+    size_t lastAnswerLength;         /**< Length of lastAnswer, 0 if none. */
+    uint16_t lastMessageId;          /**< Message ID of the last confirmable request. */
+    unsigned long accepted;          /**< Requests verified and processed. */
+    unsigned long duplicates;        /**< Retransmissions answered from the cache. */
+    unsigned long replays;           /**< Requests rejected by the replay window. */
+    unsigned long rejected;          /**< Requests malformed, of an unknown context or not verified. */
+} nce_oscore_server_t;
+
+/**
+ * @brief Set up a server for one device.
+ *
+ * @param[out] server Server.
+ * @param[in] psk PSK of the device.
+ * @param[in] pskLength Length of the PSK, at most 64.
+ * @param[in] identity Identity of the device.
+ * @param[in] identityLength Length of the identity, at most 32.
+ */
+void nce_oscore_server_init( nce_oscore_server_t * server,
+                             const uint8_t * psk,
+                             size_t pskLength,
+                             const uint8_t * identity,
+                             size_t identityLength );
+
+/**
+ * @brief Network simulator responder of the server.
+ *
+ * @param[in] arg The nce_oscore_server_t.
+ * @param[in] request Datagram received by the server.
+ * @param[in] requestLength Length of the datagram.
+ * @param[out] response Answer to send back.
+ * @param[in] responseSize Size of the answer buffer.
+ * @return Length of the answer, 0 to send nothing.
+ */
+size_t nce_oscore_server_responder( void * arg,
+                                    const uint8_t * request,
+                                    size_t requestLength,
+                                    uint8_t * response,
+                                    size_t responseSize );
+
+#endif /* ifndef NCE_OSCORE_SERVER_H_ */
@@ -0,0 +1,187 @@
+/**
+ * @file nce_standin.c
+ * @brief Loopback stand-in for the 1NCE OS CoAP endpoints used by host tests.
+ */
+
+#ifndef _POSIX_C_SOURCE
+    #define _POSIX_C_SOURCE    200809L
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "nce_standin.h"
+
+#define STANDIN_BUFFER_SIZE       1500
+#define COAP_TYPE_CON             0
+#define COAP_TYPE_NON             1
+#define COAP_TYPE_ACK             2
+#define COAP_CODE_GET             0x01
+#define COAP_CODE_CHANGED         0x44
+#define COAP_CODE_CONTENT         0x45
+#define COAP_HEADER_SIZE          4
+#define COAP_PAYLOAD_MARKER       0xFF
+
+/*-----------------------------------------------------------*/
+
+static int prv_contains( const unsigned char * data,
+                         size_t length,
+                         const char * needle )
+{
+    size_t needleLength = strlen( needle );
+    size_t i;
+
+    for( i = 0; i + needleLength <= length; i++ )
+    {
+        if( memcmp( data + i, needle, needleLength ) == 0 )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prv_build_response( nce_standin_t * standin,
+                                  const unsigned char * request,
+                                  size_t requestLength,
+                                  unsigned char * response )
+{
+    unsigned int type = ( request[ 0 ] >> 4 ) & 0x03;
+    unsigned int tokenLength = request[ 0 ] & 0x0F;
+    size_t length = COAP_HEADER_SIZE + tokenLength;
+    int bootstrap = ( request[ 1 ] == COAP_CODE_GET ) &&
+                    prv_contains( request, requestLength, "bootstrap" );
+
+    /* Piggybacked ACK for confirmable requests, NON otherwise. */
+    response[ 0 ] = ( unsigned char ) ( 0x40 | ( ( type == COAP_TYPE_CON ? COAP_TYPE_ACK : COAP_TYPE_NON ) << 4 ) | tokenLength );
+    response[ 1 ] = bootstrap ? COAP_CODE_CONTENT : COAP_CODE_CHANGED;
+    memcpy( &response[ 2 ], &request[ 2 ], 2 + tokenLength );
+
+    if( bootstrap )
+    {
+        standin->onboarded++;
+        response[ length++ ] = COAP_PAYLOAD_MARKER;
+        length += ( size_t ) sprintf( ( char * ) &response[ length ], "8988%015lu,psk%08lu",
+                                      standin->onboarded, standin->onboarded );
+    }
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prv_get_flag( nce_standin_t * standin,
+                         const int * flag )
+{
+    int value;
+
+    pthread_mutex_lock( &standin->lock );
+    value = *flag;
+    pthread_mutex_unlock( &standin->lock );
+
+    return value;
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prv_standin_thread( void * arg )
+{
+    nce_standin_t * standin = ( nce_standin_t * ) arg;
+    unsigned char request[ STANDIN_BUFFER_SIZE ];
+    unsigned char response[ STANDIN_BUFFER_SIZE ];
+    struct sockaddr_storage peer;
+    socklen_t peerLength;
+    ssize_t received;
+    size_t length;
+
+    while( prv_get_flag( standin, &standin->running ) )
+    {
+        peerLength = sizeof( peer );
+        received = recvfrom( standin->socket, request, sizeof( request ), 0,
+                             ( struct sockaddr * ) &peer, &peerLength );
+
+        if( ( received < COAP_HEADER_SIZE ) ||
+            ( ( size_t ) received < COAP_HEADER_SIZE + ( size_t ) ( request[ 0 ] & 0x0F ) ) )
+        {
+            continue;
+        }
+
+        if( prv_get_flag( standin, &standin->outage ) )
+        {
+            standin->dropped++;
+            continue;
+        }
+
+        length = prv_build_response( standin, request, ( size_t ) received, response );
+        standin->requests++;
+        sendto( standin->socket, response, length, 0, ( struct sockaddr * ) &peer, peerLength );
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+int nce_standin_start( nce_standin_t * standin )
+{
+    struct sockaddr_in addr;
+    socklen_t addrLength = sizeof( addr );
+    struct timeval timeo = { 0, 100000 };
+
+    memset( standin, 0, sizeof( *standin ) );
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    standin->socket = socket( AF_INET, SOCK_DGRAM, 0 );
+
+    if( ( standin->socket < 0 ) ||
+        ( bind( standin->socket, ( struct sockaddr * ) &addr, sizeof( addr ) ) != 0 ) ||
+        ( getsockname( standin->socket, ( struct sockaddr * ) &addr, &addrLength ) != 0 ) )
+    {
+        return -1;
+    }
+
+    /* Wake up periodically so the thread notices a stop request. */
+    setsockopt( standin->socket, SOL_SOCKET, SO_RCVTIMEO, &timeo, sizeof( timeo ) );
+    standin->port = ntohs( addr.sin_port );
+    standin->running = 1;
+    pthread_mutex_init( &standin->lock, NULL );
+
+    if( pthread_create( &standin->thread, NULL, prv_standin_thread, standin ) != 0 )
+    {
+        close( standin->socket );
+        return -1;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_standin_set_outage( nce_standin_t * standin,
+                             int outage )
+{
+    pthread_mutex_lock( &standin->lock );
+    standin->outage = outage;
+    pthread_mutex_unlock( &standin->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+void nce_standin_stop( nce_standin_t * standin )
+{
+    pthread_mutex_lock( &standin->lock );
+    standin->running = 0;
+    pthread_mutex_unlock( &standin->lock );
+    pthread_join( standin->thread, NULL );
+    pthread_mutex_destroy( &standin->lock );
+    close( standin->socket );
+}
@@ -0,0 +1,55 @@
+/**
+ * @file nce_standin.h
+ * @brief Loopback stand-in for the 1NCE OS CoAP endpoints used by host tests.
+ *
+ * The stand-in listens on 127.0.0.1 and answers Device Authenticator
+ * requests with unique credentials, and acknowledges any other CoAP request
+ * with 2.04 (Changed).
+ */
+
+#ifndef NCE_STANDIN_H_
+#define NCE_STANDIN_H_
+
+#include <pthread.h>
+
+/**
+ * @brief State of one stand-in server.
+ */
+typedef struct nce_standin
+{
+    int socket;                   /**< Bound UDP socket. */
+    int port;                     /**< Port the stand-in listens on. */
+    pthread_t thread;             /**< Server thread. */
+    pthread_mutex_t lock;         /**< Protects running and outage. */
+    int running;                  /**< Cleared to stop the server thread. */
+    int outage;                   /**< Set to silently drop every datagram. */
+    unsigned long requests;       /**< Datagrams answered. */
+    unsigned long onboarded;      /**< Credentials issued. */
+    unsigned long dropped;        /**< Datagrams dropped during an outage. */
+} nce_standin_t;
+
+/**
+ * @brief Start a stand-in on an ephemeral loopback port.
+ *
+ * @param[out] standin Stand-in to start.
+ * @return 0 on success, -1 on failure.
+ */
+int nce_standin_start( nce_standin_t * standin );
+
+/**
+ * @brief Simulate a network outage: while enabled, requests are dropped.
+ *
+ * @param[in] standin Running stand-in.
+ * @param[in] outage Non-zero to drop requests, zero to answer them again.
+ */
+void nce_standin_set_outage( nce_standin_t * standin,
+                             int outage );
+
+/**
+ * @brief Stop a stand-in and release its socket.
+ *
+ * @param[in] standin Stand-in to stop.
+ */
+void nce_standin_stop( nce_standin_t * standin );
+
+#endif /* ifndef NCE_STANDIN_H_ */
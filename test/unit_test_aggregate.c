@@ -0,0 +1,202 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_aggregate.h"
+
+/* Selector of the records */
+#define SELECTOR    7u
+
+static nce_aggregate_t agg;
+static uint8_t packet[ 64 ];
+
+/* Temperature in tenths of a degree and humidity of the tests */
+static const nce_aggregate_slot_t slots[] =
+{
+    { 0, NCE_AGGREGATE_MIN,   E_INTEGER, 2, 10.0f },
+    { 0, NCE_AGGREGATE_MAX,   E_INTEGER, 2, 10.0f },
+    { 0, NCE_AGGREGATE_MEAN,  E_FLOAT,   4, 0.0f  },
+    { 0, NCE_AGGREGATE_COUNT, E_INTEGER, 2, 0.0f  },
+    { 1, NCE_AGGREGATE_LAST,  E_CHAR,    1, 0.0f  }
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Integer of a record, in the host order of the Energy Saver.
+ */
+static int record_int( size_t offset,
+                       size_t length )
+{
+    int value = 0;
+
+    memcpy( &value, &packet[ offset ], length );
+
+    return value;
+}
+
+static float record_float( size_t offset )
+{
+    float value;
+
+    memcpy( &value, &packet[ offset ], sizeof( value ) );
+
+    return value;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    memset( packet, 0, sizeof( packet ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS,
+                       nce_aggregate_init( &agg, 2, SELECTOR, slots, sizeof( slots ) / sizeof( slots[ 0 ] ), 60000u ) );
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: A window is emitted as one record laid out by the slots,
+ * integers scaled and rounded.
+ */
+void test_aggregate_record_layout( void )
+{
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 21.04f, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, -3.5f, 1000 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 12.5f, 2000 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 1, 48.0f, 3000 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 1, 51.0f, 4000 ) );
+
+    TEST_ASSERT_EQUAL( 12, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+    TEST_ASSERT_EQUAL_HEX8( SELECTOR, packet[ 0 ] );
+    TEST_ASSERT_EQUAL( -35, ( int16_t ) record_int( 1, 2 ) );
+    TEST_ASSERT_EQUAL( 210, record_int( 3, 2 ) );
+    TEST_ASSERT_TRUE( ( record_float( 5 ) > 10.0123f ) && ( record_float( 5 ) < 10.0143f ) );
+    TEST_ASSERT_EQUAL( 3, record_int( 9, 2 ) );
+    TEST_ASSERT_EQUAL( 51, packet[ 11 ] );
+}
+
+/**
+ * @brief Test 2: Samples are counted in buckets of equal width, values
+ * beyond the range in the outer ones.
+ */
+void test_aggregate_histogram( void )
+{
+    static const float samples[] = { -5.0f, 0.0f, 9.9f, 10.0f, 45.0f, 79.9f, 80.0f, 1000.0f };
+    static const nce_aggregate_slot_t buckets[] =
+    {
+        { 0, NCE_AGGREGATE_BUCKET,                                 E_INTEGER, 1, 0.0f },
+        { 0, NCE_AGGREGATE_BUCKET + 1,                             E_INTEGER, 1, 0.0f },
+        { 0, NCE_AGGREGATE_BUCKET + 4,                             E_INTEGER, 1, 0.0f },
+        { 0, NCE_AGGREGATE_BUCKET + NCE_SDK_AGGREGATE_BUCKETS - 1, E_INTEGER, 1, 0.0f }
+    };
+    size_t i;
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_init( &agg, 1, SELECTOR, buckets, 4, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_ARGUMENT_ERROR, nce_aggregate_set_histogram( &agg, 0, 80.0f, 0.0f ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_set_histogram( &agg, 0, 0.0f, 80.0f ) );
+
+    for( i = 0; i < sizeof( samples ) / sizeof( samples[ 0 ] ); i++ )
+    {
+        TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, samples[ i ], 0 ) );
+    }
+
+    TEST_ASSERT_EQUAL( 5, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+    TEST_ASSERT_EQUAL( 3, packet[ 1 ] );
+    TEST_ASSERT_EQUAL( 1, packet[ 2 ] );
+    TEST_ASSERT_EQUAL( 1, packet[ 3 ] );
+    TEST_ASSERT_EQUAL( 3, packet[ 4 ] );
+}
+
+/**
+ * @brief Test 3: A window is due once its length has passed since its first
+ * sample, across wraps of the 32-bit clock; windows of length 0 never are.
+ */
+void test_aggregate_window_due( void )
+{
+    uint32_t now = 0xFFFF0000u;
+    int i;
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_init( &agg, 2, SELECTOR, slots, 5, 7200000u ) );
+
+    for( i = 0; i < 120; i++ )
+    {
+        TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 1.0f, now ) );
+        now += 60000000u;
+    }
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_DUE, nce_aggregate_add( &agg, 1, 1.0f, now ) );
+
+    /* The next window opens at its first sample. */
+    TEST_ASSERT_TRUE( nce_aggregate_emit( &agg, packet, sizeof( packet ) ) > 0 );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 1.0f, now + 3600000000u ) );
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_init( &agg, 2, SELECTOR, slots, 5, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 1.0f, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 1.0f, 4000000000u ) );
+}
+
+/**
+ * @brief Test 4: Emitting starts a new window; an empty window is not
+ * emitted and fields without sample report 0.
+ */
+void test_aggregate_emit_resets( void )
+{
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_EMPTY, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 1, 60.0f, 0 ) );
+    TEST_ASSERT_EQUAL( 12, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+    TEST_ASSERT_EQUAL( 0, record_int( 1, 2 ) );
+    TEST_ASSERT_EQUAL( 0, record_int( 9, 2 ) );
+    TEST_ASSERT_EQUAL( 60, packet[ 11 ] );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_EMPTY, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 2.0f, 0 ) );
+    TEST_ASSERT_EQUAL( 12, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+    TEST_ASSERT_EQUAL( 20, record_int( 1, 2 ) );
+    TEST_ASSERT_EQUAL( 1, record_int( 9, 2 ) );
+    TEST_ASSERT_EQUAL( 0, packet[ 11 ] );
+}
+
+/**
+ * @brief Test 5: A statistic beyond its template, or a record beyond its
+ * buffer, is not emitted and the window is kept.
+ */
+void test_aggregate_conversion_errors( void )
+{
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 4000.0f, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_CONVERSION_ERROR, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+
+    nce_aggregate_reset( &agg );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_add( &agg, 0, 20.0f, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_CONVERSION_ERROR, nce_aggregate_emit( &agg, packet, 11 ) );
+    TEST_ASSERT_EQUAL( 12, nce_aggregate_emit( &agg, packet, 12 ) );
+    TEST_ASSERT_EQUAL( 200, record_int( 1, 2 ) );
+}
+
+/**
+ * @brief Test 6: Layouts naming unknown fields, statistics or types are
+ * refused, as are samples of unknown fields.
+ */
+void test_aggregate_arguments( void )
+{
+    nce_aggregate_slot_t slot = { 2, NCE_AGGREGATE_MIN, E_INTEGER, 1, 0.0f };
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_ARGUMENT_ERROR, nce_aggregate_init( &agg, 2, SELECTOR, &slot, 1, 0 ) );
+    slot.field = 0;
+    slot.stat = NCE_AGGREGATE_BUCKET + NCE_SDK_AGGREGATE_BUCKETS;
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_ARGUMENT_ERROR, nce_aggregate_init( &agg, 2, SELECTOR, &slot, 1, 0 ) );
+    slot.stat = NCE_AGGREGATE_LAST;
+    slot.type = E_STRING;
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_ARGUMENT_ERROR, nce_aggregate_init( &agg, 2, SELECTOR, &slot, 1, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_ARGUMENT_ERROR,
+                       nce_aggregate_init( &agg, NCE_SDK_AGGREGATE_FIELDS + 1, SELECTOR, slots, 1, 0 ) );
+
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_SUCCESS, nce_aggregate_init( &agg, 2, SELECTOR, slots, 5, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_ARGUMENT_ERROR, nce_aggregate_add( &agg, 2, 1.0f, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_AGGREGATE_EMPTY, nce_aggregate_emit( &agg, packet, sizeof( packet ) ) );
+}
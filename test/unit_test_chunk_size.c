@@ -0,0 +1,199 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_chunk_size.h"
+#include "nce_netsim.h"
+
+/* Bounds and initial value of the payload limit */
+#define CHUNK_MIN        64u
+#define CHUNK_MAX        1024u
+#define CHUNK_INITIAL    256u
+
+/* Header bytes of a chunk datagram in the simulated upload */
+#define CHUNK_OVERHEAD   96u
+
+static const OSEndPoint_t proxy = { "coap.proxy.os.1nce.com", 5684 };
+static const OSEndPoint_t other = { "coap.proxy.os.1nce.com", 5683 };
+static nce_chunk_size_t cache;
+
+/**
+ * @brief Report n full-size chunks at the current limit.
+ */
+static void report_full( const OSEndPoint_t * endpoint,
+                         int n,
+                         int delivered )
+{
+    while( n-- > 0 )
+    {
+        nce_chunk_size_report( &cache, endpoint, nce_chunk_size_get( &cache, endpoint ), delivered );
+    }
+}
+
+/**
+ * @brief Upload a blob over a simulated link with the adaptive limit, each
+ * chunk acknowledged by the remote. Returns the bytes acknowledged.
+ */
+static size_t upload( const nce_netsim_config_t * config,
+                      size_t blob )
+{
+    static uint8_t datagram[ NCE_NETSIM_MAX_DATAGRAM ];
+    uint8_t response[ 16 ];
+    nce_netsim_t sim;
+    os_network_ops_t ops;
+    size_t offset = 0;
+    size_t payload;
+    int failures = 0;
+    int acked;
+
+    memset( datagram, 0, sizeof( datagram ) );
+    nce_netsim_init( &sim, config, nce_netsim_ack_responder, NULL, &ops );
+    ops.nce_os_udp_connect( ops.os_socket, proxy );
+
+    while( ( offset < blob ) && ( failures < 4 ) )
+    {
+        payload = nce_chunk_size_get( &cache, &proxy );
+        payload = ( payload < blob - offset ) ? payload : blob - offset;
+        acked = ( ops.nce_os_udp_send( ops.os_socket, datagram, CHUNK_OVERHEAD + payload ) > 0 ) &&
+                ( ops.nce_os_udp_recv( ops.os_socket, response, sizeof( response ) ) > 0 );
+        nce_chunk_size_report( &cache, &proxy, payload, acked );
+        offset += acked ? payload : 0u;
+        failures = acked ? 0 : failures + 1;
+    }
+
+    ops.nce_os_udp_disconnect( ops.os_socket );
+
+    return offset;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_chunk_size_init( &cache, CHUNK_MIN, CHUNK_MAX, CHUNK_INITIAL );
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: The limit starts at the initial size, grows by one step
+ * after a run of delivered full-size chunks, not after short ones, and stops
+ * at the upper bound.
+ */
+void test_chunk_size_grows_on_success( void )
+{
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL, nce_chunk_size_get( &cache, &proxy ) );
+
+    report_full( &proxy, NCE_SDK_CHUNK_GROW_AFTER - 1, 1 );
+    nce_chunk_size_report( &cache, &proxy, 10, 1 );
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL, nce_chunk_size_get( &cache, &proxy ) );
+
+    report_full( &proxy, 1, 1 );
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL + NCE_SDK_CHUNK_STEP, nce_chunk_size_get( &cache, &proxy ) );
+
+    report_full( &proxy, 100 * NCE_SDK_CHUNK_GROW_AFTER, 1 );
+    TEST_ASSERT_EQUAL( CHUNK_MAX, nce_chunk_size_get( &cache, &proxy ) );
+    TEST_ASSERT_EQUAL( ( CHUNK_MAX - CHUNK_INITIAL ) / NCE_SDK_CHUNK_STEP, cache.paths[ 0 ].grows );
+}
+
+/**
+ * @brief Test 2: One loss is tolerated, repeated losses fall back to the
+ * last confirmed size, the failed size is approached by halves and probed
+ * again only after many deliveries; a confirmed size that fails too is
+ * halved.
+ */
+void test_chunk_size_shrinks_on_repeated_loss( void )
+{
+    size_t size;
+
+    report_full( &proxy, 2 * NCE_SDK_CHUNK_GROW_AFTER, 1 );
+    TEST_ASSERT_EQUAL( 384, nce_chunk_size_get( &cache, &proxy ) );
+
+    report_full( &proxy, 1, 0 );
+    TEST_ASSERT_EQUAL( 384, nce_chunk_size_get( &cache, &proxy ) );
+    report_full( &proxy, NCE_SDK_CHUNK_LOSS_LIMIT, 0 );
+    TEST_ASSERT_EQUAL( 320, nce_chunk_size_get( &cache, &proxy ) );
+    TEST_ASSERT_EQUAL( 384, cache.paths[ 0 ].ceiling );
+
+    /* Next probe goes halfway to the size that failed. */
+    report_full( &proxy, NCE_SDK_CHUNK_GROW_AFTER, 1 );
+    TEST_ASSERT_EQUAL( 352, nce_chunk_size_get( &cache, &proxy ) );
+
+    /* After the reset the failed size is probed again. */
+    report_full( &proxy, NCE_SDK_CHUNK_CEILING_RESET, 1 );
+    size = nce_chunk_size_get( &cache, &proxy );
+    TEST_ASSERT_EQUAL( 0, cache.paths[ 0 ].ceiling );
+    TEST_ASSERT_GREATER_THAN( 384, size );
+
+    /* The path shrank below everything confirmed: halve. */
+    report_full( &proxy, NCE_SDK_CHUNK_LOSS_LIMIT, 0 );
+    report_full( &proxy, NCE_SDK_CHUNK_LOSS_LIMIT, 0 );
+    TEST_ASSERT_EQUAL( ( size - NCE_SDK_CHUNK_STEP ) / 2u, nce_chunk_size_get( &cache, &proxy ) );
+
+    report_full( &proxy, 20 * NCE_SDK_CHUNK_LOSS_LIMIT, 0 );
+    TEST_ASSERT_EQUAL( CHUNK_MIN, nce_chunk_size_get( &cache, &proxy ) );
+}
+
+/**
+ * @brief Test 3: Endpoints are tracked separately, the least recently used
+ * one is replaced when the cache is full, and the MTU helper subtracts the
+ * headers.
+ */
+void test_chunk_size_per_endpoint( void )
+{
+    OSEndPoint_t endpoints[ NCE_SDK_CHUNK_ENDPOINTS ];
+    int i;
+
+    report_full( &proxy, NCE_SDK_CHUNK_GROW_AFTER, 1 );
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL + NCE_SDK_CHUNK_STEP, nce_chunk_size_get( &cache, &proxy ) );
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL, nce_chunk_size_get( &cache, &other ) );
+
+    memset( endpoints, 0, sizeof( endpoints ) );
+
+    for( i = 0; i < NCE_SDK_CHUNK_ENDPOINTS - 1; i++ )
+    {
+        endpoints[ i ].port = ( uint16_t ) ( 6000 + i );
+        ( void ) nce_chunk_size_get( &cache, &endpoints[ i ] );
+    }
+
+    /* proxy is now the least recently used entry. */
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL, nce_chunk_size_get( &cache, &other ) );
+    TEST_ASSERT_EQUAL( CHUNK_INITIAL, nce_chunk_size_get( &cache, &proxy ) );
+
+    TEST_ASSERT_EQUAL( 1184, nce_chunk_size_for_mtu( 1280, CHUNK_OVERHEAD ) );
+    TEST_ASSERT_EQUAL( 0, nce_chunk_size_for_mtu( 64, CHUNK_OVERHEAD ) );
+}
+
+/**
+ * @brief Test 4: On a link dropping IP fragments, a fixed 512 byte chunk
+ * never arrives while the adaptive limit settles on the largest chunk that
+ * fits the MTU and delivers the whole blob; on a clean link with a large MTU
+ * it grows to the upper bound.
+ */
+void test_chunk_size_settles_below_path_mtu( void )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 5;
+    config.latencyUs = 300000u;
+    config.recvTimeoutUs = 2000000u;
+    config.mtu = 480u;
+    config.fragmentLossPercent = 100u;
+
+    nce_chunk_size_init( &cache, 512u, 512u, 512u );
+    TEST_ASSERT_EQUAL( 0, upload( &config, 16384u ) );
+
+    nce_chunk_size_init( &cache, CHUNK_MIN, CHUNK_MAX, CHUNK_INITIAL );
+    TEST_ASSERT_EQUAL( 16384u, upload( &config, 16384u ) );
+    TEST_ASSERT_EQUAL( 0, upload( &config, 0u ) );
+    TEST_ASSERT_EQUAL( config.mtu - CHUNK_OVERHEAD, nce_chunk_size_get( &cache, &proxy ) );
+
+    config.mtu = 1472u;
+    nce_chunk_size_init( &cache, CHUNK_MIN, CHUNK_MAX, CHUNK_INITIAL );
+    TEST_ASSERT_EQUAL( 65536u, upload( &config, 65536u ) );
+    TEST_ASSERT_EQUAL( CHUNK_MAX, nce_chunk_size_get( &cache, &proxy ) );
+}
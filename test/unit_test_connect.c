@@ -0,0 +1,349 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "nce_iot_c_sdk.h"
+#include "network_interface_linux.h"
+
+/* Loopback addresses of the tests; 127.0.0.2 and 127.0.0.3 silently drop */
+#define LIVE_V4         0
+#define LIVE_V6         1
+#define SILENT_A        2
+#define SILENT_B        3
+#define ADDRESSES       4
+
+static const char * const addresses[ ADDRESSES ] = { "127.0.0.1", "::1", "127.0.0.2", "127.0.0.3" };
+static int sockets[ ADDRESSES ];
+static int port;
+static volatile int answering[ ADDRESSES ];
+static pthread_t thread;
+static volatile int running;
+static struct OSNetwork network;
+static OSEndPoint_t endpoint;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Answer every datagram on the answering sockets with its own bytes.
+ */
+static void * responder( void * arg )
+{
+    struct pollfd fds[ ADDRESSES ];
+    struct sockaddr_storage from;
+    socklen_t fromLength;
+    uint8_t buffer[ 256 ];
+    ssize_t length;
+    int i;
+
+    ( void ) arg;
+
+    while( running )
+    {
+        for( i = 0; i < ADDRESSES; i++ )
+        {
+            fds[ i ].fd = answering[ i ] ? sockets[ i ] : -1;
+            fds[ i ].events = POLLIN;
+            fds[ i ].revents = 0;
+        }
+
+        if( poll( fds, ADDRESSES, 20 ) <= 0 )
+        {
+            continue;
+        }
+
+        for( i = 0; i < ADDRESSES; i++ )
+        {
+            if( ( fds[ i ].revents & POLLIN ) && answering[ i ] )
+            {
+                fromLength = sizeof( from );
+                length = recvfrom( sockets[ i ], buffer, sizeof( buffer ), 0, ( struct sockaddr * ) &from, &fromLength );
+
+                if( length > 0 )
+                {
+                    ( void ) sendto( sockets[ i ], buffer, ( size_t ) length, 0, ( struct sockaddr * ) &from, fromLength );
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Bind a socket on address and the shared port.
+ */
+static int bind_on( const char * address )
+{
+    struct sockaddr_storage addr;
+    socklen_t length;
+    int fd;
+
+    memset( &addr, 0, sizeof( addr ) );
+
+    if( strchr( address, ':' ) != NULL )
+    {
+        ( ( struct sockaddr_in6 * ) &addr )->sin6_family = AF_INET6;
+        ( ( struct sockaddr_in6 * ) &addr )->sin6_port = htons( ( uint16_t ) port );
+        inet_pton( AF_INET6, address, &( ( struct sockaddr_in6 * ) &addr )->sin6_addr );
+        length = sizeof( struct sockaddr_in6 );
+    }
+    else
+    {
+        ( ( struct sockaddr_in * ) &addr )->sin_family = AF_INET;
+        ( ( struct sockaddr_in * ) &addr )->sin_port = htons( ( uint16_t ) port );
+        inet_pton( AF_INET, address, &( ( struct sockaddr_in * ) &addr )->sin_addr );
+        length = sizeof( struct sockaddr_in );
+    }
+
+    fd = socket( addr.ss_family, SOCK_DGRAM, 0 );
+    TEST_ASSERT_TRUE( fd >= 0 );
+    TEST_ASSERT_EQUAL_INT( 0, bind( fd, ( struct sockaddr * ) &addr, length ) );
+
+    if( port == 0 )
+    {
+        TEST_ASSERT_EQUAL_INT( 0, getsockname( fd, ( struct sockaddr * ) &addr, &length ) );
+        port = ntohs( ( ( struct sockaddr_in * ) &addr )->sin_port );
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Listen on the addresses marked bound, answering on those marked
+ * answering. Unbound addresses refuse datagrams.
+ */
+static void start( const int * bound )
+{
+    int i;
+
+    port = 0;
+
+    for( i = 0; i < ADDRESSES; i++ )
+    {
+        sockets[ i ] = bound[ i ] ? bind_on( addresses[ i ] ) : -1;
+    }
+
+    endpoint.port = port;
+    running = 1;
+    TEST_ASSERT_EQUAL_INT( 0, pthread_create( &thread, NULL, responder, NULL ) );
+}
+
+static void set_host( const char * host )
+{
+    strncpy( ( char * ) endpoint.host, host, sizeof( endpoint.host ) - 1 );
+}
+
+static long elapsed_ms( const struct timespec * since )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( long ) ( now.tv_sec - since->tv_sec ) * 1000 + ( now.tv_nsec - since->tv_nsec ) / 1000000;
+}
+
+/**
+ * @brief Connect, returning the time it took and the family connected to.
+ */
+static long timed_connect( int * family )
+{
+    struct sockaddr_storage peer;
+    socklen_t length = sizeof( peer );
+    struct timespec begin;
+    long ms;
+
+    clock_gettime( CLOCK_MONOTONIC, &begin );
+    TEST_ASSERT_EQUAL_INT( 0, nce_os_connect_v2( &network, &endpoint ) );
+    ms = elapsed_ms( &begin );
+    TEST_ASSERT_EQUAL_INT( 0, getpeername( network.os_socket, ( struct sockaddr * ) &peer, &length ) );
+    *family = peer.ss_family;
+
+    return ms;
+}
+
+/**
+ * @brief Datagrams waiting on a silent address.
+ */
+static int pending( int index )
+{
+    uint8_t buffer[ 256 ];
+    int count = 0;
+
+    while( recv( sockets[ index ], buffer, sizeof( buffer ), MSG_DONTWAIT ) > 0 )
+    {
+        count++;
+    }
+
+    return count;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    int i;
+
+    for( i = 0; i < ADDRESSES; i++ )
+    {
+        answering[ i ] = 0;
+    }
+
+    memset( &endpoint, 0, sizeof( endpoint ) );
+    network.os_socket = -1;
+}
+
+void tearDown( void )
+{
+    int i;
+
+    running = 0;
+    pthread_join( thread, NULL );
+
+    if( network.os_socket >= 0 )
+    {
+        nce_os_disconnect( &network );
+    }
+
+    for( i = 0; i < ADDRESSES; i++ )
+    {
+        if( sockets[ i ] >= 0 )
+        {
+            close( sockets[ i ] );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: An IPv6-only endpoint connects and exchanges datagrams.
+ */
+void test_connect_ipv6_only( void )
+{
+    const int bound[ ADDRESSES ] = { 0, 1, 0, 0 };
+    uint8_t reply[ 4 ];
+    int family;
+
+    answering[ LIVE_V6 ] = 1;
+    start( bound );
+    set_host( "::1" );
+
+    ( void ) timed_connect( &family );
+    TEST_ASSERT_EQUAL_INT( AF_INET6, family );
+    TEST_ASSERT_EQUAL_INT( 4, nce_os_send( &network, "ping", 4 ) );
+    TEST_ASSERT_EQUAL_INT( 4, nce_os_recv( &network, reply, sizeof( reply ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( "ping", reply, 4 );
+}
+
+/**
+ * @brief Test 2: A refused address does not hold up the connect, the next
+ * one is tried at once.
+ */
+void test_connect_refused_address_skipped( void )
+{
+    const int bound[ ADDRESSES ] = { 1, 0, 0, 0 };
+    int family;
+
+    answering[ LIVE_V4 ] = 1;
+    start( bound );
+    set_host( "::1,127.0.0.1" );
+
+    TEST_ASSERT_TRUE( timed_connect( &family ) < NCE_SDK_CONNECT_ATTEMPT_DELAY_MS );
+    TEST_ASSERT_EQUAL_INT( AF_INET, family );
+}
+
+/**
+ * @brief Test 3: Silent addresses cost one attempt delay each, the families
+ * alternate, and the address that answered is tried alone next time.
+ */
+void test_connect_staggered_and_remembered( void )
+{
+    const int bound[ ADDRESSES ] = { 0, 1, 1, 1 };
+    long ms;
+    int family;
+
+    answering[ LIVE_V6 ] = 1;
+    start( bound );
+    set_host( "127.0.0.2,127.0.0.3,::1" );
+
+    /* Tried as 127.0.0.2, ::1, 127.0.0.3: one delay, not two. */
+    ms = timed_connect( &family );
+    TEST_ASSERT_TRUE( ms >= NCE_SDK_CONNECT_ATTEMPT_DELAY_MS );
+    TEST_ASSERT_TRUE( ms < 2 * NCE_SDK_CONNECT_ATTEMPT_DELAY_MS );
+    TEST_ASSERT_EQUAL_INT( AF_INET6, family );
+    TEST_ASSERT_EQUAL_INT( 1, pending( SILENT_A ) );
+    TEST_ASSERT_EQUAL_INT( 0, pending( SILENT_B ) );
+    nce_os_disconnect( &network );
+
+    ms = timed_connect( &family );
+    TEST_ASSERT_TRUE( ms < NCE_SDK_CONNECT_ATTEMPT_DELAY_MS );
+    TEST_ASSERT_EQUAL_INT( AF_INET6, family );
+    TEST_ASSERT_EQUAL_INT( 0, pending( SILENT_A ) );
+}
+
+/**
+ * @brief Test 4: A remembered address that stops answering is forgotten, the
+ * next connect races the addresses again.
+ */
+void test_connect_forgets_silent_address( void )
+{
+    const int bound[ ADDRESSES ] = { 1, 1, 0, 0 };
+    uint8_t reply[ 4 ];
+    int family;
+
+    answering[ LIVE_V6 ] = 1;
+    start( bound );
+    set_host( "::1,127.0.0.1" );
+
+    ( void ) timed_connect( &family );
+    TEST_ASSERT_EQUAL_INT( AF_INET6, family );
+    nce_os_disconnect( &network );
+
+    /* IPv6 goes quiet, IPv4 takes over. */
+    answering[ LIVE_V6 ] = 0;
+    answering[ LIVE_V4 ] = 1;
+    ( void ) timed_connect( &family );
+    TEST_ASSERT_EQUAL_INT( AF_INET6, family );
+    TEST_ASSERT_EQUAL_INT( 4, nce_os_send( &network, "ping", 4 ) );
+    TEST_ASSERT_EQUAL_INT( 0, nce_os_recv( &network, reply, sizeof( reply ) ) );
+    nce_os_disconnect( &network );
+
+    ( void ) timed_connect( &family );
+    TEST_ASSERT_EQUAL_INT( AF_INET, family );
+}
+
+/**
+ * @brief Test 5: Without an answer the first attempt is kept, and the answer
+ * to its ping arriving after the connect does not reach the caller.
+ */
+void test_connect_drops_late_probe_answer( void )
+{
+    const int bound[ ADDRESSES ] = { 0, 0, 1, 1 };
+    struct sockaddr_storage from;
+    socklen_t fromLength = sizeof( from );
+    uint8_t ping[ 4 ];
+    uint8_t reply[ 8 ];
+    int family;
+
+    start( bound );
+    set_host( "127.0.0.2,127.0.0.3" );
+
+    TEST_ASSERT_TRUE( timed_connect( &family ) >= NCE_SDK_CONNECT_TIMEOUT_MS );
+    TEST_ASSERT_EQUAL_INT( 4, recvfrom( sockets[ SILENT_A ], ping, sizeof( ping ), MSG_DONTWAIT,
+                                        ( struct sockaddr * ) &from, &fromLength ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x40, ping[ 0 ] );
+
+    /* The ping is answered with a Reset, then the request with data. */
+    ping[ 0 ] = 0x70;
+    TEST_ASSERT_EQUAL_INT( 4, sendto( sockets[ SILENT_A ], ping, 4, 0, ( struct sockaddr * ) &from, fromLength ) );
+    TEST_ASSERT_EQUAL_INT( 4, sendto( sockets[ SILENT_A ], "data", 4, 0, ( struct sockaddr * ) &from, fromLength ) );
+
+    TEST_ASSERT_EQUAL_INT( 4, nce_os_recv( &network, reply, sizeof( reply ) ) );
+    TEST_ASSERT_EQUAL_MEMORY( "data", reply, 4 );
+}
@@ -0,0 +1,318 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_deadline.h"
+#include "nce_memfault.h"
+#include "nce_netsim.h"
+
+/* One-way latency of the simulated link */
+#define DEADLINE_LATENCY_US    100000u
+
+/* Fixed receive timeout of the ports */
+#define PORT_TIMEOUT_US        10000000u
+
+/* Bytes of the Memfault message of the tests */
+#define BLOB_SIZE              2048u
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_context_t ctx;
+static nce_dtls_key_t key;
+static nce_progress_t progress;
+static uint8_t workspace[ NCE_SDK_AUTH_WORKSPACE_SIZE ];
+static int ( * simConnect )( OSNetwork_t, OSEndPoint_t );
+
+/* Remote: requests ignored, or answered 5.03 with Max-Age, before onboarding */
+static int ignored;
+static int unavailable;
+static uint32_t connectUs;
+static int waits;
+
+/* Chunk source: the blob as one message */
+static nce_memfault_uploader_t uploader;
+static const OSEndPoint_t proxy = { "proxy.example", 5683 };
+static uint8_t blob[ BLOB_SIZE ];
+static size_t sourceOffset;
+static int aborts;
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+static size_t scripted_responder( void * arg,
+                                  const uint8_t * request,
+                                  size_t requestLength,
+                                  uint8_t * response,
+                                  size_t responseSize )
+{
+    if( ignored > 0 )
+    {
+        ignored--;
+        return 0;
+    }
+
+    if( unavailable > 0 )
+    {
+        unavailable--;
+        response[ 0 ] = 0x50;
+        response[ 1 ] = 0xA3;
+        response[ 2 ] = request[ 2 ];
+        response[ 3 ] = request[ 3 ];
+        /* Max-Age (14) = 60 s. */
+        response[ 4 ] = 0xD1;
+        response[ 5 ] = 14 - 13;
+        response[ 6 ] = 60;
+
+        return 7;
+    }
+
+    return nce_netsim_onboard_responder( arg, request, requestLength, response, responseSize );
+}
+
+/**
+ * @brief Connect taking connectUs, like a name resolution on a slow link.
+ * Fails while the remote ignores requests.
+ */
+static int slow_connect( OSNetwork_t osnetwork,
+                         OSEndPoint_t endpoint )
+{
+    sim.nowUs += connectUs;
+
+    return ( connectUs > 0u ) && ( ignored > 0 ) ? -1 : simConnect( osnetwork, endpoint );
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+    waits++;
+}
+
+static bool blob_get_chunk( void * arg,
+                            uint8_t * buffer,
+                            size_t * length )
+{
+    ( void ) arg;
+
+    if( sourceOffset >= sizeof( blob ) )
+    {
+        return false;
+    }
+
+    *length = ( *length < sizeof( blob ) - sourceOffset ) ? *length : sizeof( blob ) - sourceOffset;
+    memcpy( buffer, &blob[ sourceOffset ], *length );
+    sourceOffset += *length;
+
+    return true;
+}
+
+static void blob_abort( void * arg )
+{
+    ( void ) arg;
+    sourceOffset = 0;
+    aborts++;
+}
+
+static const nce_memfault_source_t source = { blob_get_chunk, blob_abort, NULL };
+
+/**
+ * @brief Onboard within a budget, returning the virtual time it took.
+ */
+static uint32_t timed_auth( uint32_t budgetMs,
+                            int expected )
+{
+    uint64_t start = sim.nowUs;
+
+    TEST_ASSERT_EQUAL( expected, os_auth_deadline( &ctx, &key, workspace, sizeof( workspace ), budgetMs, &progress ) );
+
+    return ( uint32_t ) ( ( sim.nowUs - start ) / 1000u );
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1;
+    config.latencyUs = DEADLINE_LATENCY_US;
+    config.recvTimeoutUs = PORT_TIMEOUT_US;
+    nce_netsim_init( &sim, &config, scripted_responder, NULL, &ops );
+    simConnect = ops.nce_os_udp_connect;
+    ops.nce_os_udp_connect = slow_connect;
+    os_context_init( &ctx, &ops );
+    ctx.delayMs = virtual_delay;
+    ctx.setRecvTimeout = nce_netsim_set_recv_timeout;
+    ignored = 0;
+    unavailable = 0;
+    connectUs = 0;
+    waits = 0;
+    sourceOffset = 0;
+    aborts = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: The budget is spent with the clock, steps need
+ * NCE_SDK_DEADLINE_MIN_MS plus their wait, and long budgets are shortened.
+ */
+void test_deadline_budget( void )
+{
+    nce_deadline_t deadline;
+
+    nce_deadline_start( &deadline, 5000u, 0xFFFFF000u );
+    TEST_ASSERT_EQUAL_UINT32( 5000u, nce_deadline_remaining_ms( &deadline, 0xFFFFF000u ) );
+    /* Across the wrap of the clock. */
+    TEST_ASSERT_EQUAL_UINT32( 3000u, nce_deadline_remaining_ms( &deadline, 0xFFFFF000u + 2000000u ) );
+    TEST_ASSERT_EQUAL_UINT32( 2000u, nce_deadline_elapsed_ms( &deadline, 0xFFFFF000u + 2000000u ) );
+    TEST_ASSERT_EQUAL_UINT32( 0u, nce_deadline_remaining_ms( &deadline, 0xFFFFF000u + 6000000u ) );
+
+    TEST_ASSERT_TRUE( nce_deadline_allows( &deadline, 5000u - NCE_SDK_DEADLINE_MIN_MS, 0xFFFFF000u ) );
+    TEST_ASSERT_FALSE( nce_deadline_allows( &deadline, 5001u - NCE_SDK_DEADLINE_MIN_MS, 0xFFFFF000u ) );
+    TEST_ASSERT_FALSE( nce_deadline_allows( &deadline, 0u, 0xFFFFF000u + ( 5001u - NCE_SDK_DEADLINE_MIN_MS ) * 1000u ) );
+
+    nce_deadline_start( &deadline, 0xFFFFFFFFu, 0u );
+    TEST_ASSERT_EQUAL_UINT32( NCE_DEADLINE_MAX_MS, nce_deadline_remaining_ms( &deadline, 0u ) );
+}
+
+/**
+ * @brief Test 2: The receive timeout is an equal share of what is left,
+ * not below NCE_SDK_DEADLINE_MIN_RECV_MS, nor above the timeout of the
+ * attempt or what is left.
+ */
+void test_deadline_share( void )
+{
+    nce_deadline_t deadline;
+
+    nce_deadline_start( &deadline, 12000u, 0u );
+    TEST_ASSERT_EQUAL_UINT32( 3000u, nce_deadline_share_ms( &deadline, NCE_DEADLINE_NO_TIMEOUT, 4, 0u ) );
+    TEST_ASSERT_EQUAL_UINT32( 2000u, nce_deadline_share_ms( &deadline, 2000u, 4, 0u ) );
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_DEADLINE_MIN_RECV_MS, nce_deadline_share_ms( &deadline, NCE_DEADLINE_NO_TIMEOUT, 100, 0u ) );
+    TEST_ASSERT_EQUAL_UINT32( 500u, nce_deadline_share_ms( &deadline, NCE_DEADLINE_NO_TIMEOUT, 4, 11500000u ) );
+    TEST_ASSERT_EQUAL_UINT32( 0u, nce_deadline_share_ms( &deadline, NCE_DEADLINE_NO_TIMEOUT, 4, 13000000u ) );
+}
+
+/**
+ * @brief Test 3: Onboarding within its budget reports a single attempt on
+ * an open connection.
+ */
+void test_deadline_auth_in_time( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( 2u * DEADLINE_LATENCY_US / 1000u, timed_auth( 5000u, NCE_SDK_SUCCESS ) );
+    TEST_ASSERT_EQUAL_MEMORY( NCE_NETSIM_PSK, key.psk, key.pskLength );
+    TEST_ASSERT_TRUE( progress.connected );
+    TEST_ASSERT_EQUAL( 1, progress.attempts );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, progress.lastStatus );
+    TEST_ASSERT_EQUAL_UINT32( 2u * DEADLINE_LATENCY_US / 1000u, progress.elapsedMs );
+    TEST_ASSERT_NULL( ctx.deadline );
+}
+
+/**
+ * @brief Test 4: A silent remote costs the budget instead of four port
+ * timeouts and the backoff: the receives share it and the socket is closed.
+ */
+void test_deadline_auth_silent_remote( void )
+{
+    uint32_t elapsed;
+
+    ignored = 100;
+    elapsed = timed_auth( 8000u, NCE_SDK_DEADLINE_EXCEEDED );
+
+    TEST_ASSERT_TRUE( elapsed <= 8000u );
+    TEST_ASSERT_TRUE( elapsed >= 8000u - NCE_SDK_DEADLINE_MIN_MS - NCE_SDK_RETRY_BASE_MS * 4u );
+    TEST_ASSERT_TRUE( sim.config.recvTimeoutUs <= 2000000u );
+    TEST_ASSERT_TRUE( progress.connected );
+    TEST_ASSERT_TRUE( progress.attempts >= 2u );
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, progress.lastStatus );
+    TEST_ASSERT_EQUAL( elapsed, progress.elapsedMs );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+
+    /* The same remote without a budget. */
+    ignored = 100;
+    os_context_init( &ctx, &ops );
+    ctx.delayMs = virtual_delay;
+    sim.config.recvTimeoutUs = PORT_TIMEOUT_US;
+    elapsed = ( uint32_t ) sim.nowUs;
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, os_auth_v2( &ctx, &key, workspace, sizeof( workspace ) ) );
+    TEST_ASSERT_TRUE( ( ( uint32_t ) sim.nowUs - elapsed ) / 1000u > 4u * PORT_TIMEOUT_US / 1000u );
+}
+
+/**
+ * @brief Test 5: Slow connects, e.g. name resolution, stop the onboarding
+ * before any request once the budget is spent.
+ */
+void test_deadline_auth_slow_connect( void )
+{
+    connectUs = 3000000u;
+    ignored = 100;
+
+    TEST_ASSERT_EQUAL_UINT32( 6000u, timed_auth( 5000u, NCE_SDK_DEADLINE_EXCEEDED ) );
+    TEST_ASSERT_EQUAL( 0, sim.stats.datagramsSent );
+    TEST_ASSERT_FALSE( progress.connected );
+    TEST_ASSERT_EQUAL( 0, progress.attempts );
+    TEST_ASSERT_EQUAL( NCE_SDK_CONNECT_ERROR, progress.lastStatus );
+}
+
+/**
+ * @brief Test 6: A 5.03 asking for a wait past the budget ends the
+ * onboarding at once, reporting the 5.03.
+ */
+void test_deadline_auth_wait_past_budget( void )
+{
+    unavailable = 1;
+
+    TEST_ASSERT_EQUAL_UINT32( 2u * DEADLINE_LATENCY_US / 1000u, timed_auth( 30000u, NCE_SDK_DEADLINE_EXCEEDED ) );
+    TEST_ASSERT_EQUAL( 0, waits );
+    TEST_ASSERT_EQUAL( 1, progress.attempts );
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVICE_UNAVAILABLE, progress.lastStatus );
+
+    /* A budget covering the wait onboards after it. */
+    unavailable = 1;
+    ( void ) timed_auth( 65000u, NCE_SDK_SUCCESS );
+    TEST_ASSERT_EQUAL( 1, waits );
+    TEST_ASSERT_EQUAL( 2, progress.attempts );
+}
+
+/**
+ * @brief Test 7: A Memfault upload out of time stops between two chunks
+ * without aborting the message, the next upload carries on.
+ */
+void test_deadline_memfault_resumes( void )
+{
+    nce_netsim_config_t config = sim.config;
+    nce_progress_t next;
+
+    nce_netsim_init( &sim, &config, nce_netsim_ack_responder, NULL, &ops );
+    nce_memfault_init( &uploader, &ops, &proxy, &source );
+    uploader.delayMs = virtual_delay;
+    uploader.setRecvTimeout = nce_netsim_set_recv_timeout;
+
+    /* Three round trips fit. */
+    TEST_ASSERT_EQUAL( NCE_SDK_DEADLINE_EXCEEDED, nce_memfault_upload_deadline( &uploader, 600u + NCE_SDK_DEADLINE_MIN_MS - 1u, &progress ) );
+    TEST_ASSERT_EQUAL( 3, progress.chunks );
+    TEST_ASSERT_EQUAL( sourceOffset, progress.bytes );
+    TEST_ASSERT_TRUE( progress.connected );
+    TEST_ASSERT_EQUAL( 1, progress.attempts );
+    TEST_ASSERT_EQUAL( 0, aborts );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload_deadline( &uploader, 60000u, &next ) );
+    TEST_ASSERT_EQUAL( BLOB_SIZE, progress.bytes + next.bytes );
+    TEST_ASSERT_EQUAL( uploader.chunks, progress.chunks + next.chunks );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, next.lastStatus );
+    TEST_ASSERT_EQUAL( 0, aborts );
+
+    /* Nothing left: no connection. */
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload_deadline( &uploader, 60000u, &next ) );
+    TEST_ASSERT_EQUAL( 0, next.attempts );
+    TEST_ASSERT_FALSE( next.connected );
+}
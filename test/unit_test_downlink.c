@@ -0,0 +1,454 @@
+#include "unity.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_downlink.h"
+#include "nce_netsim.h"
+
+/* Datagrams sent by the device that are kept for inspection */
+#define CAPTURED    16
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_downlink_t downlink;
+static uint8_t captured[ CAPTURED ][ NCE_SDK_DOWNLINK_BUFFER_SIZE ];
+static size_t capturedLength[ CAPTURED ];
+static int capturedCount;
+static char lastPayload[ 32 ];
+static int calls;
+static int temperature;
+static uint8_t temperatureCode;
+
+static const uint8_t token[ 2 ] = { 0xAB, 0xCD };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Virtual clock of the link, read by the dispatcher.
+ */
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+/**
+ * @brief Server side: keep what the device sends, answer nothing.
+ */
+static size_t capture_responder( void * arg,
+                                 const uint8_t * request,
+                                 size_t requestLength,
+                                 uint8_t * response,
+                                 size_t responseSize )
+{
+    ( void ) arg;
+    ( void ) response;
+    ( void ) responseSize;
+
+    if( capturedCount < CAPTURED )
+    {
+        memcpy( captured[ capturedCount ], request, requestLength );
+        capturedLength[ capturedCount ] = requestLength;
+    }
+
+    capturedCount++;
+
+    return 0;
+}
+
+/**
+ * @brief config/interval: stores a POSTed value, returns it on GET.
+ */
+static void config_handler( void * arg,
+                            const nce_downlink_request_t * request,
+                            nce_downlink_response_t * response )
+{
+    ( void ) arg;
+    calls++;
+
+    if( request->method == NCE_COAP_GET )
+    {
+        response->contentFormat = 0;
+        response->payloadLength = 2;
+        memcpy( response->payload, "60", 2 );
+    }
+    else
+    {
+        memset( lastPayload, 0, sizeof( lastPayload ) );
+        memcpy( lastPayload, request->payload, request->payloadLength );
+    }
+}
+
+/**
+ * @brief sensors/temp: observable reading.
+ */
+static void temperature_handler( void * arg,
+                                 const nce_downlink_request_t * request,
+                                 nce_downlink_response_t * response )
+{
+    ( void ) arg;
+    ( void ) request;
+    calls++;
+    response->code = temperatureCode;
+    response->contentFormat = 0;
+    response->payloadLength = ( size_t ) sprintf( ( char * ) response->payload, "%d", temperature );
+}
+
+static const nce_downlink_resource_t resources[] =
+{
+    { "config/interval", config_handler,      NULL, false },
+    { "sensors/temp",    temperature_handler, NULL, true  }
+};
+
+/**
+ * @brief Send a request from the server: 2-byte token, then Observe if not
+ * negative, an extra empty option if not 0 (between 6 and 11), the Uri-Path
+ * split on '/' and the payload if not NULL.
+ */
+static void push_request( uint8_t type,
+                          uint8_t code,
+                          uint16_t messageId,
+                          long observe,
+                          unsigned int extraOption,
+                          const char * path,
+                          const char * payload )
+{
+    uint8_t message[ 128 ];
+    size_t length = 6;
+    unsigned int number = 0;
+    const char * segment = path;
+    const char * end;
+
+    message[ 0 ] = ( uint8_t ) ( 0x40u | ( type << 4 ) | sizeof( token ) );
+    message[ 1 ] = code;
+    message[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    message[ 3 ] = ( uint8_t ) messageId;
+    memcpy( &message[ 4 ], token, sizeof( token ) );
+
+    if( observe >= 0 )
+    {
+        message[ length++ ] = ( uint8_t ) ( ( 6u << 4 ) | ( ( observe > 0 ) ? 1u : 0u ) );
+
+        if( observe > 0 )
+        {
+            message[ length++ ] = ( uint8_t ) observe;
+        }
+
+        number = 6;
+    }
+
+    if( extraOption != 0u )
+    {
+        message[ length++ ] = ( uint8_t ) ( ( extraOption - number ) << 4 );
+        number = extraOption;
+    }
+
+    while( ( segment != NULL ) && ( *segment != '\0' ) )
+    {
+        end = strchr( segment, '/' );
+        end = ( end != NULL ) ? end : segment + strlen( segment );
+        message[ length++ ] = ( uint8_t ) ( ( ( 11u - number ) << 4 ) | ( size_t ) ( end - segment ) );
+        memcpy( &message[ length ], segment, ( size_t ) ( end - segment ) );
+        length += ( size_t ) ( end - segment );
+        number = 11;
+        segment = ( *end == '/' ) ? end + 1 : end;
+    }
+
+    if( payload != NULL )
+    {
+        message[ length++ ] = 0xFF;
+        memcpy( &message[ length ], payload, strlen( payload ) );
+        length += strlen( payload );
+    }
+
+    nce_netsim_push( &sim, message, length );
+}
+
+/**
+ * @brief Send an empty message (ping, acknowledgement or reset) from the server.
+ */
+static void push_empty( uint8_t type,
+                        uint16_t messageId )
+{
+    uint8_t message[ 4 ];
+
+    message[ 0 ] = ( uint8_t ) ( 0x40u | ( type << 4 ) );
+    message[ 1 ] = 0;
+    message[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    message[ 3 ] = ( uint8_t ) messageId;
+    nce_netsim_push( &sim, message, sizeof( message ) );
+}
+
+static uint16_t message_id( int index )
+{
+    return ( uint16_t ) ( ( captured[ index ][ 2 ] << 8 ) | captured[ index ][ 3 ] );
+}
+
+static void init_link( unsigned int lossPercent )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1u;
+    config.lossPercent = lossPercent;
+    config.latencyUs = 100000u;
+    config.recvTimeoutUs = 1000000u;
+    nce_netsim_init( &sim, &config, capture_responder, NULL, &ops );
+    TEST_ASSERT_EQUAL_INT( 0, ops.nce_os_udp_connect( ops.os_socket, NceOnboard ) );
+    nce_downlink_init( &downlink, &ops, resources, sizeof( resources ) / sizeof( resources[ 0 ] ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    capturedCount = 0;
+    calls = 0;
+    temperature = 21;
+    temperatureCode = NCE_COAP_CONTENT;
+    memset( lastPayload, 0, sizeof( lastPayload ) );
+    init_link( 0 );
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: A confirmable POST reaches its handler and is answered
+ * with a piggybacked 2.04 echoing message ID and token; the poll returns
+ * once a receive times out.
+ */
+void test_downlink_con_request_acknowledged( void )
+{
+    push_request( 0, NCE_COAP_POST, 0x1234, -1, 0, "config/interval", "30" );
+
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_STRING( "30", lastPayload );
+    TEST_ASSERT_EQUAL_INT( 1, calls );
+    TEST_ASSERT_EQUAL_UINT32( 1, sim.stats.timeouts );
+    TEST_ASSERT_EQUAL_INT( 1, capturedCount );
+    TEST_ASSERT_EQUAL_UINT32( 6, capturedLength[ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0x62, captured[ 0 ][ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( NCE_COAP_CHANGED, captured[ 0 ][ 1 ] );
+    TEST_ASSERT_EQUAL_UINT16( 0x1234, message_id( 0 ) );
+    TEST_ASSERT_EQUAL_MEMORY( token, &captured[ 0 ][ 4 ], sizeof( token ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.requests );
+}
+
+/**
+ * @brief Test 2: A ping gets a reset, an unknown path 4.04, an unknown
+ * critical option 4.02; an empty non-confirmable message is dropped.
+ */
+void test_downlink_ping_unknown_path_bad_option( void )
+{
+    push_empty( 0, 0x0101 );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    push_request( 0, NCE_COAP_GET, 0x0102, -1, 0, "nope", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    push_request( 0, NCE_COAP_GET, 0x0103, -1, 9, "config/interval", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    push_empty( 1, 0x0104 );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+
+    TEST_ASSERT_EQUAL_INT( 3, capturedCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x70, captured[ 0 ][ 0 ] );
+    TEST_ASSERT_EQUAL_UINT32( 4, capturedLength[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT16( 0x0101, message_id( 0 ) );
+    TEST_ASSERT_EQUAL_HEX8( NCE_COAP_NOT_FOUND, captured[ 1 ][ 1 ] );
+    TEST_ASSERT_EQUAL_HEX8( NCE_COAP_BAD_OPTION, captured[ 2 ][ 1 ] );
+    TEST_ASSERT_EQUAL_INT( 0, calls );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.pings );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.notFound );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.rejected );
+}
+
+/**
+ * @brief Test 3: A retransmitted request is answered again from the cache
+ * without calling the handler, until EXCHANGE_LIFETIME has passed.
+ */
+void test_downlink_duplicate_answered_from_cache( void )
+{
+    push_request( 0, NCE_COAP_POST, 0x2000, -1, 0, "config/interval", "45" );
+    push_request( 0, NCE_COAP_POST, 0x2000, -1, 0, "config/interval", "45" );
+
+    TEST_ASSERT_EQUAL_INT( 2, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 1, calls );
+    TEST_ASSERT_EQUAL_INT( 2, capturedCount );
+    TEST_ASSERT_EQUAL_UINT32( capturedLength[ 0 ], capturedLength[ 1 ] );
+    TEST_ASSERT_EQUAL_MEMORY( captured[ 0 ], captured[ 1 ], capturedLength[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.duplicates );
+
+    sim.nowUs += ( uint64_t ) NCE_SDK_DOWNLINK_EXCHANGE_LIFETIME_S * 1000000u;
+    push_request( 0, NCE_COAP_POST, 0x2000, -1, 0, "config/interval", "45" );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 2, calls );
+}
+
+/**
+ * @brief Test 4: A non-confirmable GET gets a non-confirmable response with
+ * a message ID of the device, Content-Format and payload; its duplicate is
+ * dropped.
+ */
+void test_downlink_non_request( void )
+{
+    static const uint8_t options[] = { 0xC0, 0xFF, '6', '0' };
+
+    push_request( 1, NCE_COAP_GET, 0x3000, -1, 0, "config/interval", NULL );
+    push_request( 1, NCE_COAP_GET, 0x3000, -1, 0, "config/interval", NULL );
+
+    TEST_ASSERT_EQUAL_INT( 2, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 1, capturedCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x52, captured[ 0 ][ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( NCE_COAP_CONTENT, captured[ 0 ][ 1 ] );
+    TEST_ASSERT_TRUE( message_id( 0 ) != 0x3000 );
+    TEST_ASSERT_EQUAL_UINT32( 6 + sizeof( options ), capturedLength[ 0 ] );
+    TEST_ASSERT_EQUAL_MEMORY( options, &captured[ 0 ][ 6 ], sizeof( options ) );
+}
+
+/**
+ * @brief Test 5: A GET with Observe registers an observer, notifications
+ * carry its token and increasing Observe values, a reset cancels it.
+ */
+void test_downlink_observe_notify_reset( void )
+{
+    push_request( 0, NCE_COAP_GET, 0x4000, 0, 0, "sensors/temp", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x62, captured[ 0 ][ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0x61, captured[ 0 ][ 6 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0x01, captured[ 0 ][ 7 ] );
+
+    temperature = 25;
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", false ) );
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_notify( &downlink, "config/interval", false ) );
+    TEST_ASSERT_EQUAL_INT( 2, capturedCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x52, captured[ 1 ][ 0 ] );
+    TEST_ASSERT_EQUAL_MEMORY( token, &captured[ 1 ][ 4 ], sizeof( token ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x61, captured[ 1 ][ 6 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0x02, captured[ 1 ][ 7 ] );
+    TEST_ASSERT_EQUAL_MEMORY( "25", &captured[ 1 ][ capturedLength[ 1 ] - 2 ], 2 );
+
+    push_empty( 3, message_id( 1 ) );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_notify( &downlink, "sensors/temp", false ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.resets );
+}
+
+/**
+ * @brief Test 6: A confirmable notification left unacknowledged through all
+ * its retransmissions ends the observation, as do a deregistration and an
+ * error notification.
+ */
+void test_downlink_observation_ends( void )
+{
+    unsigned int i;
+
+    push_request( 0, NCE_COAP_GET, 0x5000, 0, 0, "sensors/temp", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", true ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x42, captured[ 1 ][ 0 ] );
+    push_empty( 2, message_id( 1 ) );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", true ) );
+
+    for( i = 0; i < NCE_SDK_DOWNLINK_MAX_RETRANSMIT; i++ )
+    {
+        sim.nowUs += ( uint64_t ) NCE_SDK_DOWNLINK_ACK_TIMEOUT_MS * 1000u << i;
+        TEST_ASSERT_EQUAL_INT( 1, nce_downlink_tick( &downlink ) );
+    }
+
+    sim.nowUs += ( uint64_t ) NCE_SDK_DOWNLINK_ACK_TIMEOUT_MS * 1000u << i;
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_tick( &downlink ) );
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_notify( &downlink, "sensors/temp", true ) );
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_DOWNLINK_MAX_RETRANSMIT, downlink.stats.retransmissions );
+
+    /* Deregistration: answered without Observe. */
+    push_request( 0, NCE_COAP_GET, 0x5001, 0, 0, "sensors/temp", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    push_request( 0, NCE_COAP_GET, 0x5002, 1, 0, "sensors/temp", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_HEX8( 0xC0, captured[ capturedCount - 1 ][ 6 ] );
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_notify( &downlink, "sensors/temp", false ) );
+
+    /* Error notification: sent once, without Observe. */
+    push_request( 0, NCE_COAP_GET, 0x5003, 0, 0, "sensors/temp", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    temperatureCode = NCE_COAP_INTERNAL_ERROR;
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", false ) );
+    TEST_ASSERT_EQUAL_HEX8( NCE_COAP_INTERNAL_ERROR, captured[ capturedCount - 1 ][ 1 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0xC0, captured[ capturedCount - 1 ][ 6 ] );
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_notify( &downlink, "sensors/temp", false ) );
+}
+
+/**
+ * @brief Test 7: On a lossy link, requests retransmitted by the server until
+ * acknowledged each reach their handler exactly once.
+ */
+void test_downlink_lossy_link_exactly_once( void )
+{
+    char payload[ 8 ];
+    int acknowledged;
+    int request;
+    int attempt;
+
+    init_link( 30 );
+
+    for( request = 0; request < 20; request++ )
+    {
+        sprintf( payload, "%d", request );
+        acknowledged = capturedCount;
+
+        for( attempt = 0; ( attempt < 8 ) && ( capturedCount == acknowledged ); attempt++ )
+        {
+            push_request( 0, NCE_COAP_PUT, ( uint16_t ) ( 0x6000 + request ), -1, 0, "config/interval", payload );
+            TEST_ASSERT_TRUE( nce_downlink_poll( &downlink, 8 ) >= 0 );
+        }
+
+        TEST_ASSERT_TRUE( capturedCount > acknowledged );
+        TEST_ASSERT_EQUAL_STRING( payload, lastPayload );
+    }
+
+    TEST_ASSERT_EQUAL_INT( 20, calls );
+    TEST_ASSERT_TRUE( downlink.stats.duplicates > 0u );
+}
+
+/**
+ * @brief Test 8: A confirmable notification whose acknowledgement is lost
+ * is retransmitted by the poll with its message ID once ACK_TIMEOUT has
+ * passed; acknowledging the retransmission keeps the observer, and a
+ * notification replacing an unacknowledged one stays confirmable.
+ */
+void test_downlink_notification_retransmitted( void )
+{
+    push_request( 0, NCE_COAP_GET, 0x7000, 0, 0, "sensors/temp", NULL );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+
+    /* The acknowledgement of the notification never arrives. */
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", true ) );
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 2, capturedCount );
+
+    sim.nowUs += NCE_SDK_DOWNLINK_ACK_TIMEOUT_MS * 1000u;
+    TEST_ASSERT_EQUAL_INT( 0, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 3, capturedCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x42, captured[ 2 ][ 0 ] );
+    TEST_ASSERT_EQUAL_UINT16( message_id( 1 ), message_id( 2 ) );
+    TEST_ASSERT_EQUAL_MEMORY( token, &captured[ 2 ][ 4 ], sizeof( token ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.retransmissions );
+
+    push_empty( 2, message_id( 2 ) );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_poll( &downlink, 8 ) );
+    TEST_ASSERT_EQUAL_INT( 3, capturedCount );
+
+    /* Still observing: the next notification goes out, and when it is not
+     * acknowledged either the one after replaces it as confirmable. */
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", true ) );
+    TEST_ASSERT_EQUAL_INT( 1, nce_downlink_notify( &downlink, "sensors/temp", false ) );
+    TEST_ASSERT_EQUAL_INT( 5, capturedCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x42, captured[ 4 ][ 0 ] );
+    TEST_ASSERT_TRUE( message_id( 4 ) != message_id( 3 ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, downlink.stats.retransmissions );
+}
@@ -0,0 +1,147 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+
+/* Keep errors and warnings only, to check the compile-time filter. */
+#define NCE_LOG_MODULE_LEVEL    NCE_LOG_LEVEL_WARN
+#include "log_interface.h"
+#include "nce_log_tokenized.h"
+
+static uint8_t drained[ 2 * NCE_SDK_LOG_BUFFER_SIZE ];
+static size_t drainedLength;
+static const uint8_t * cursor;
+
+/**
+ * @brief Read an unsigned LEB128 value of the drained records.
+ */
+static uintptr_t read_varint( void )
+{
+    uintptr_t value = 0;
+    unsigned int shift = 0;
+
+    while( *cursor & 0x80 )
+    {
+        value |= ( uintptr_t ) ( *cursor++ & 0x7f ) << shift;
+        shift += 7;
+    }
+
+    return value | ( ( uintptr_t ) *cursor++ << shift );
+}
+
+/**
+ * @brief Read a zigzag integer.
+ */
+static long read_zigzag( void )
+{
+    uintptr_t zigzag = read_varint();
+
+    return ( long ) ( zigzag >> 1 ) ^ -( long ) ( zigzag & 1 );
+}
+
+/**
+ * @brief Drain everything and point the cursor at the first record.
+ */
+static void drain( void )
+{
+    drainedLength = nce_log_drain( drained, sizeof( drained ) );
+    cursor = drained;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    drain();
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: A record carries its length, level, the address of the
+ * format string as token and the arguments in binary.
+ */
+void test_log_tokenized_record_layout( void )
+{
+    const uint8_t * record;
+    const char * format;
+    double value;
+
+    NceOSLogWarn( "attempt %d of %u to %s (%p, %.1f)\n", -3, 7u, "coap.os.1nce.com", ( void * ) drained, 2.5 );
+    drain();
+
+    record = cursor;
+    TEST_ASSERT_EQUAL( drainedLength, *cursor++ );
+    TEST_ASSERT_EQUAL( NCE_LOG_LEVEL_WARN, *cursor++ );
+    format = ( const char * ) read_varint();
+    TEST_ASSERT_EQUAL_STRING( "attempt %d of %u to %s (%p, %.1f)\n", format );
+    TEST_ASSERT_EQUAL( NCE_LOG_ARG_INT, *cursor++ );
+    TEST_ASSERT_EQUAL( -3, read_zigzag() );
+    TEST_ASSERT_EQUAL( NCE_LOG_ARG_INT, *cursor++ );
+    TEST_ASSERT_EQUAL( 7, read_zigzag() );
+    TEST_ASSERT_EQUAL( NCE_LOG_ARG_STRING, *cursor++ );
+    TEST_ASSERT_EQUAL( 16, *cursor++ );
+    TEST_ASSERT_EQUAL( 0, memcmp( cursor, "coap.os.1nce.com", 16 ) );
+    cursor += 16;
+    TEST_ASSERT_EQUAL( NCE_LOG_ARG_POINTER, *cursor++ );
+    TEST_ASSERT_EQUAL( ( uintptr_t ) drained, read_varint() );
+    TEST_ASSERT_EQUAL( NCE_LOG_ARG_DOUBLE, *cursor++ );
+    memcpy( &value, cursor, sizeof( value ) );
+    cursor += sizeof( value );
+    TEST_ASSERT_EQUAL( 1, value == 2.5 );
+    TEST_ASSERT_EQUAL( drainedLength, ( size_t ) ( cursor - record ) );
+}
+
+/**
+ * @brief Test 2: Levels above the module level compile to nothing.
+ */
+void test_log_tokenized_module_level_filter( void )
+{
+    NceOSLogDebug( "debug %d\n", 1 );
+    NceOSLogInfo( "info %d\n", 2 );
+    NceOSLogError( "error\n" );
+    drain();
+
+    TEST_ASSERT_EQUAL( NCE_LOG_LEVEL_ERROR, drained[ 1 ] );
+    TEST_ASSERT_EQUAL( drained[ 0 ], drainedLength );
+}
+
+/**
+ * @brief Test 3: Arguments that do not fit are cut and the record flagged.
+ */
+void test_log_tokenized_truncated_record( void )
+{
+    const char * longText = "0123456789012345678901234567890123456789";
+
+    NceOSLogError( "%s %s %d\n", longText, longText, 1 );
+    drain();
+
+    TEST_ASSERT_EQUAL( NCE_LOG_LEVEL_ERROR | NCE_LOG_TRUNCATED, drained[ 1 ] );
+    TEST_ASSERT_LESS_OR_EQUAL( NCE_LOG_MAX_RECORD, drainedLength );
+}
+
+/**
+ * @brief Test 4: A full ring drops new records and counts them, records
+ * are delivered again once drained.
+ */
+void test_log_tokenized_overflow_drops( void )
+{
+    uint32_t dropped = nce_log_dropped();
+    int i;
+
+    for( i = 0; i < NCE_SDK_LOG_BUFFER_SIZE; i++ )
+    {
+        NceOSLogError( "fill %d\n", i );
+    }
+
+    drain();
+    TEST_ASSERT_GREATER_THAN( 0, nce_log_dropped() - dropped );
+    TEST_ASSERT_LESS_OR_EQUAL( NCE_SDK_LOG_BUFFER_SIZE, drainedLength );
+
+    NceOSLogError( "after %d\n", i );
+    drain();
+    TEST_ASSERT_EQUAL( drained[ 0 ], drainedLength );
+}
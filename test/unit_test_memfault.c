@@ -0,0 +1,299 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_memfault.h"
+#include "nce_netsim.h"
+
+/* Bytes of the Memfault message of the tests */
+#define BLOB_SIZE    1500u
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_memfault_uploader_t uploader;
+static uint8_t blob[ BLOB_SIZE ];
+static const OSEndPoint_t proxy = { NCE_MEMFAULT_PROXY_HOST, 5683 };
+
+/* Chunk source: the blob as one message */
+static size_t sourceOffset;
+static size_t sourceLength;
+static int aborts;
+
+/* Proxy: message reassembled from the chunks, and its answers */
+static uint8_t received[ BLOB_SIZE ];
+static size_t receivedLength;
+static unsigned long posts;
+static unsigned int lastMessageId;
+static unsigned long requests;
+static unsigned long ignoredRequest;
+static uint8_t errorCode;
+static int errors;
+static uint32_t waitedMs;
+static int waits;
+
+/*-----------------------------------------------------------*/
+
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+static bool blob_get_chunk( void * arg,
+                            uint8_t * buffer,
+                            size_t * length )
+{
+    ( void ) arg;
+
+    if( sourceOffset >= sourceLength )
+    {
+        return false;
+    }
+
+    *length = ( *length < sourceLength - sourceOffset ) ? *length : sourceLength - sourceOffset;
+    memcpy( buffer, &blob[ sourceOffset ], *length );
+    sourceOffset += *length;
+
+    return true;
+}
+
+/**
+ * @brief Start the message over, like the Memfault packetizer.
+ */
+static void blob_abort( void * arg )
+{
+    ( void ) arg;
+    sourceOffset = 0;
+    aborts++;
+}
+
+static const nce_memfault_source_t source = { blob_get_chunk, blob_abort, NULL };
+
+/**
+ * @brief CoAP proxy: checks the request, appends its payload to the message
+ * (started over by a chunk of its beginning) and acknowledges it, unless
+ * told to ignore it or to answer with an error.
+ */
+static size_t proxy_responder( void * arg,
+                               const uint8_t * request,
+                               size_t requestLength,
+                               uint8_t * response,
+                               size_t responseSize )
+{
+    static const uint8_t head[] = { 0xC1, 42, 0xDD, 0x0A, sizeof( NCE_SDK_MEMFAULT_PROXY_URI ) - 1 - 13 };
+    size_t payload = 4 + sizeof( head ) + sizeof( NCE_SDK_MEMFAULT_PROXY_URI ) - 1;
+    unsigned int messageId = ( ( unsigned int ) request[ 2 ] << 8 ) | request[ 3 ];
+    size_t length;
+
+    ( void ) arg;
+    TEST_ASSERT_TRUE( requestLength > payload + 1 );
+    TEST_ASSERT_EQUAL_HEX8( 0x40, request[ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( 0x02, request[ 1 ] );
+    TEST_ASSERT_EQUAL_MEMORY( head, &request[ 4 ], sizeof( head ) );
+    TEST_ASSERT_EQUAL_MEMORY( NCE_SDK_MEMFAULT_PROXY_URI, &request[ 4 + sizeof( head ) ], sizeof( NCE_SDK_MEMFAULT_PROXY_URI ) - 1 );
+    TEST_ASSERT_EQUAL_HEX8( 0xFF, request[ payload ] );
+    payload++;
+    length = requestLength - payload;
+
+    if( ++requests == ignoredRequest )
+    {
+        return 0;
+    }
+
+    response[ 0 ] = 0x60;
+    response[ 1 ] = 0x44;
+    response[ 2 ] = request[ 2 ];
+    response[ 3 ] = request[ 3 ];
+
+    if( errors > 0 )
+    {
+        errors--;
+        response[ 1 ] = errorCode;
+        /* Max-Age of 30 s */
+        response[ 4 ] = 0xD1;
+        response[ 5 ] = 0x01;
+        response[ 6 ] = 30;
+
+        return ( responseSize >= 7 ) ? 7 : 0;
+    }
+
+    /* A retransmitted request is acknowledged again, not stored twice. */
+    if( ( posts == 0u ) || ( messageId != lastMessageId ) )
+    {
+        if( memcmp( &request[ payload ], blob, length ) == 0 )
+        {
+            receivedLength = 0;
+        }
+
+        TEST_ASSERT_TRUE( receivedLength + length <= sizeof( received ) );
+        memcpy( &received[ receivedLength ], &request[ payload ], length );
+        receivedLength += length;
+        posts++;
+        lastMessageId = messageId;
+    }
+
+    return 4;
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+    waitedMs += ms;
+    waits++;
+}
+
+static void init_link( unsigned int dupPercent )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1;
+    config.latencyUs = 100000u;
+    config.recvTimeoutUs = 2000000u;
+    config.dupPercent = dupPercent;
+    nce_netsim_init( &sim, &config, proxy_responder, NULL, &ops );
+    nce_memfault_init( &uploader, &ops, &proxy, &source );
+    uploader.delayMs = virtual_delay;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    uint32_t rng = 12345u;
+    size_t i;
+
+    /* No chunk of the blob repeats its beginning. */
+    for( i = 0; i < sizeof( blob ); i++ )
+    {
+        rng = rng * 1103515245u + 12345u;
+        blob[ i ] = ( uint8_t ) ( rng >> 16 );
+    }
+
+    sourceOffset = 0;
+    sourceLength = sizeof( blob );
+    aborts = 0;
+    receivedLength = 0;
+    posts = 0;
+    requests = 0;
+    ignoredRequest = 0;
+    errors = 0;
+    waitedMs = 0;
+    waits = 0;
+    init_link( 0 );
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: The message is posted in chunks of the initial size on one
+ * connection, each a CON POST carrying the Memfault Proxy-Uri.
+ */
+void test_memfault_upload_chunks( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload( &uploader ) );
+
+    TEST_ASSERT_EQUAL( sizeof( blob ), receivedLength );
+    TEST_ASSERT_EQUAL_MEMORY( blob, received, sizeof( blob ) );
+    TEST_ASSERT_EQUAL( 1, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+    TEST_ASSERT_EQUAL( ( BLOB_SIZE + NCE_SDK_MEMFAULT_CHUNK_INITIAL - 1 ) / NCE_SDK_MEMFAULT_CHUNK_INITIAL, uploader.chunks );
+    TEST_ASSERT_EQUAL( BLOB_SIZE, uploader.bytes );
+    TEST_ASSERT_EQUAL( 0, aborts );
+    TEST_ASSERT_EQUAL( 0, waits );
+}
+
+/**
+ * @brief Test 2: Nothing is sent, and no connection opened, without data.
+ */
+void test_memfault_nothing_to_send( void )
+{
+    sourceLength = 0;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload( &uploader ) );
+    TEST_ASSERT_EQUAL( 0, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 0, sim.stats.datagramsSent );
+}
+
+/**
+ * @brief Test 3: A chunk left unanswered aborts the message, the next
+ * attempt after the delay sends it again from its start.
+ */
+void test_memfault_timeout_restarts_message( void )
+{
+    ignoredRequest = 3;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload( &uploader ) );
+    TEST_ASSERT_EQUAL( 1, aborts );
+    TEST_ASSERT_EQUAL( 1, waits );
+    TEST_ASSERT_TRUE( waitedMs >= NCE_SDK_MEMFAULT_ATTEMPT_DELAY_MS );
+    TEST_ASSERT_EQUAL( 2, sim.stats.connects );
+    TEST_ASSERT_EQUAL( sizeof( blob ), receivedLength );
+    TEST_ASSERT_EQUAL_MEMORY( blob, received, sizeof( blob ) );
+}
+
+/**
+ * @brief Test 4: A 4.xx response ends the upload at once.
+ */
+void test_memfault_client_error_not_retried( void )
+{
+    errors = 1;
+    errorCode = 0x80;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_CLIENT_ERROR, nce_memfault_upload( &uploader ) );
+    TEST_ASSERT_EQUAL( NCE_RETRY_FAIL, uploader.retry.action );
+    TEST_ASSERT_EQUAL( 1, aborts );
+    TEST_ASSERT_EQUAL( 1, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 1, sim.stats.datagramsSent );
+    TEST_ASSERT_EQUAL( 0, waits );
+}
+
+/**
+ * @brief Test 5: A 5.03 delays the next attempt by its Max-Age.
+ */
+void test_memfault_service_unavailable_waits( void )
+{
+    errors = 1;
+    errorCode = 0xA3;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload( &uploader ) );
+    TEST_ASSERT_EQUAL( 1, waits );
+    TEST_ASSERT_EQUAL_UINT32( 30000u, waitedMs );
+    TEST_ASSERT_EQUAL_MEMORY( blob, received, sizeof( blob ) );
+}
+
+/**
+ * @brief Test 6: Duplicated datagrams do not confuse the uploader: late
+ * answers to earlier chunks are skipped.
+ */
+void test_memfault_duplicates_skipped( void )
+{
+    init_link( 100 );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload( &uploader ) );
+    TEST_ASSERT_TRUE( sim.stats.duplicated > 0u );
+    TEST_ASSERT_EQUAL( 0, aborts );
+    TEST_ASSERT_EQUAL( uploader.chunks, posts );
+    TEST_ASSERT_EQUAL( sizeof( blob ), receivedLength );
+    TEST_ASSERT_EQUAL_MEMORY( blob, received, sizeof( blob ) );
+}
+
+/**
+ * @brief Test 7: A Proxy-Uri leaving no room for a chunk is refused before
+ * any traffic, and not retried.
+ */
+void test_memfault_proxy_uri_too_long( void )
+{
+    static char uri[ NCE_SDK_MEMFAULT_BUFFER_SIZE + NCE_SDK_MEMFAULT_REQUEST_OVERHEAD ];
+
+    memset( uri, 'u', sizeof( uri ) - 1 );
+    uploader.proxyUri = uri;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SEND_ERROR, nce_memfault_upload( &uploader ) );
+    TEST_ASSERT_EQUAL( 0, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 0, waits );
+    TEST_ASSERT_EQUAL( 0, sourceOffset );
+}
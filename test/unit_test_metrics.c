@@ -0,0 +1,276 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_metrics.h"
+#include "nce_memfault.h"
+#include "nce_netsim.h"
+
+/* One-way latency of the simulated link */
+#define METRICS_LATENCY_US    300000u
+
+/* Receive timeout of the simulated link */
+#define METRICS_TIMEOUT_US    1000000u
+
+static nce_metrics_t metrics;
+static nce_metrics_t snapshot;
+static nce_netsim_t sim;
+static uint32_t fakeNowUs;
+static int clockFromSim;
+static nce_netsim_responder_t responder;
+static uint8_t errorCode;
+
+/**
+ * @brief Clock of the metrics: the fake time, or the virtual time of the
+ * simulated link.
+ */
+uint32_t nce_os_clock_us( void )
+{
+    return clockFromSim ? ( uint32_t ) sim.nowUs : fakeNowUs;
+}
+
+/**
+ * @brief Device Authenticator answering with errorCode, a 5.03 with a Max-Age
+ * of 600 s, longer than the SDK waits.
+ */
+static size_t error_responder( void * arg,
+                               const uint8_t * request,
+                               size_t requestLength,
+                               uint8_t * response,
+                               size_t responseSize )
+{
+    ( void ) arg;
+    ( void ) requestLength;
+    ( void ) responseSize;
+
+    response[ 0 ] = 0x60;
+    response[ 1 ] = errorCode;
+    response[ 2 ] = request[ 2 ];
+    response[ 3 ] = request[ 3 ];
+
+    if( errorCode != 0xA3u )
+    {
+        return 4;
+    }
+
+    /* Max-Age (14), 2 bytes */
+    response[ 4 ] = 0xD2;
+    response[ 5 ] = 0x01;
+    response[ 6 ] = 0x02;
+    response[ 7 ] = 0x58;
+
+    return 8;
+}
+
+/**
+ * @brief Memfault source of one short chunk.
+ */
+static bool one_chunk( void * arg,
+                       uint8_t * buffer,
+                       size_t * length )
+{
+    int * taken = arg;
+
+    if( *taken )
+    {
+        return false;
+    }
+
+    *taken = 1;
+    memset( buffer, 0xA5, 16 );
+    *length = 16;
+
+    return true;
+}
+
+/**
+ * @brief Onboard one device over a simulated link recording into metrics.
+ */
+static int onboard( unsigned int lossPercent )
+{
+    nce_netsim_config_t config;
+    os_network_ops_t ops;
+    nce_context_t ctx;
+    DtlsKey_t key;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 3;
+    config.lossPercent = lossPercent;
+    config.latencyUs = METRICS_LATENCY_US;
+    config.recvTimeoutUs = METRICS_TIMEOUT_US;
+    nce_netsim_init( &sim, &config, responder, NULL, &ops );
+    os_context_init( &ctx, &ops );
+    ctx.metrics = &metrics;
+    clockFromSim = 1;
+
+    return os_auth_ctx( &ctx, &key );
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    memset( &metrics, 0, sizeof( metrics ) );
+    nce_metrics_reset( NULL );
+    fakeNowUs = 0;
+    clockFromSim = 0;
+    responder = nce_netsim_onboard_responder;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Outcomes go to successes or to the failure of their code.
+ */
+void test_metrics_counts_outcomes_by_error_code( void )
+{
+    nce_metrics_begin( &metrics, NCE_METRIC_NET_SEND );
+    nce_metrics_end( &metrics, NCE_METRIC_NET_SEND, 12 );
+    nce_metrics_begin( &metrics, NCE_METRIC_NET_SEND );
+    nce_metrics_end( &metrics, NCE_METRIC_NET_SEND, NCE_SDK_SEND_ERROR );
+    nce_metrics_begin( &metrics, NCE_METRIC_NET_SEND );
+    nce_metrics_end( &metrics, NCE_METRIC_NET_SEND, -1000 );
+    nce_metrics_begin( &metrics, NCE_METRIC_NET_SEND );
+
+    TEST_ASSERT_EQUAL( 4, metrics.op[ NCE_METRIC_NET_SEND ].attempts );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_SEND ].successes );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_SEND ].failures[ -NCE_SDK_SEND_ERROR ] );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_SEND ].failures[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, metrics.op[ NCE_METRIC_NET_RECV ].attempts );
+}
+
+/**
+ * @brief Test 2: Durations land in log2 buckets, the last one is open ended.
+ */
+void test_metrics_latency_buckets( void )
+{
+    nce_metrics_begin( &metrics, NCE_METRIC_ONBOARD );
+    fakeNowUs += NCE_METRICS_FIRST_BUCKET_US - 1;
+    nce_metrics_end( &metrics, NCE_METRIC_ONBOARD, 0 );
+
+    nce_metrics_begin( &metrics, NCE_METRIC_ONBOARD );
+    fakeNowUs += NCE_METRICS_BUCKET_LIMIT_US( 3 );
+    nce_metrics_end( &metrics, NCE_METRIC_ONBOARD, 0 );
+
+    nce_metrics_begin( &metrics, NCE_METRIC_ONBOARD );
+    fakeNowUs += 0x80000000u;
+    nce_metrics_end( &metrics, NCE_METRIC_ONBOARD, 0 );
+
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].latency[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].latency[ 4 ] );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].latency[ NCE_METRICS_BUCKETS - 1 ] );
+    TEST_ASSERT_EQUAL( 0x80000000u, metrics.op[ NCE_METRIC_ONBOARD ].maxLatencyUs );
+}
+
+/**
+ * @brief Test 3: A snapshot with reset hands over the counters once.
+ */
+void test_metrics_snapshot_and_reset( void )
+{
+    nce_metrics_begin( NULL, NCE_METRIC_MEMFAULT_UPLOAD );
+    nce_metrics_bytes( NULL, NCE_METRIC_MEMFAULT_UPLOAD, 512, 10 );
+    nce_metrics_end( NULL, NCE_METRIC_MEMFAULT_UPLOAD, 0 );
+
+    nce_metrics_snapshot( NULL, &snapshot, 1 );
+    TEST_ASSERT_EQUAL( 1, snapshot.op[ NCE_METRIC_MEMFAULT_UPLOAD ].successes );
+    TEST_ASSERT_EQUAL( 512, snapshot.op[ NCE_METRIC_MEMFAULT_UPLOAD ].bytesSent );
+    TEST_ASSERT_EQUAL( 10, snapshot.op[ NCE_METRIC_MEMFAULT_UPLOAD ].bytesReceived );
+
+    nce_metrics_snapshot( NULL, &snapshot, 0 );
+    TEST_ASSERT_EQUAL( 0, snapshot.op[ NCE_METRIC_MEMFAULT_UPLOAD ].attempts );
+    TEST_ASSERT_EQUAL( 0, snapshot.op[ NCE_METRIC_MEMFAULT_UPLOAD ].bytesSent );
+}
+
+/**
+ * @brief Test 4: Onboarding records the operation and every network call,
+ * with the traffic and duration seen on the link.
+ */
+void test_metrics_onboarding_over_clean_link( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( 0 ) );
+
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].successes );
+    TEST_ASSERT_EQUAL( 2 * METRICS_LATENCY_US, metrics.op[ NCE_METRIC_ONBOARD ].maxLatencyUs );
+    TEST_ASSERT_EQUAL( sim.stats.bytesSent, metrics.op[ NCE_METRIC_ONBOARD ].bytesSent );
+    TEST_ASSERT_EQUAL( sim.stats.bytesReceived, metrics.op[ NCE_METRIC_ONBOARD ].bytesReceived );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_CONNECT ].successes );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_SEND ].successes );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_RECV ].successes );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_DISCONNECT ].successes );
+
+    /* The context has its own instance, the default one stays untouched. */
+    nce_metrics_snapshot( NULL, &snapshot, 0 );
+    TEST_ASSERT_EQUAL( 0, snapshot.op[ NCE_METRIC_ONBOARD ].attempts );
+}
+
+/**
+ * @brief Test 5: Timeouts of a dead link show up as receive errors.
+ */
+void test_metrics_onboarding_over_dead_link( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, onboard( 100 ) );
+
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].failures[ -NCE_SDK_RECEIVE_ERROR ] );
+    TEST_ASSERT_EQUAL( NCE_SDK_ATTEMPTS - 1, metrics.op[ NCE_METRIC_NET_SEND ].successes );
+    TEST_ASSERT_EQUAL( NCE_SDK_ATTEMPTS - 1, metrics.op[ NCE_METRIC_NET_RECV ].failures[ -NCE_SDK_RECEIVE_ERROR ] );
+    TEST_ASSERT_EQUAL( ( NCE_SDK_ATTEMPTS - 1 ) * METRICS_TIMEOUT_US, metrics.op[ NCE_METRIC_ONBOARD ].maxLatencyUs );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_NET_DISCONNECT ].attempts );
+}
+
+/**
+ * @brief Test 6: A rejected request and an overloaded server are counted
+ * under their own error codes, up to the lowest one.
+ */
+void test_metrics_error_responses_by_code( void )
+{
+    responder = error_responder;
+    errorCode = 0x80;
+    TEST_ASSERT_EQUAL( NCE_SDK_CLIENT_ERROR, onboard( 0 ) );
+    errorCode = 0xA3;
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVICE_UNAVAILABLE, onboard( 0 ) );
+
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].failures[ -NCE_SDK_CLIENT_ERROR ] );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].failures[ -NCE_SDK_SERVICE_UNAVAILABLE ] );
+    TEST_ASSERT_EQUAL( 0, metrics.op[ NCE_METRIC_ONBOARD ].failures[ 0 ] );
+
+    nce_metrics_begin( &metrics, NCE_METRIC_ONBOARD );
+    nce_metrics_end( &metrics, NCE_METRIC_ONBOARD, NCE_SDK_DEADLINE_EXCEEDED );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_ONBOARD ].failures[ -NCE_SDK_DEADLINE_EXCEEDED ] );
+    TEST_ASSERT_EQUAL( 0, metrics.op[ NCE_METRIC_ONBOARD ].failures[ 0 ] );
+}
+
+/**
+ * @brief Test 7: A Memfault uploader records into its own instance, not the
+ * shared default one.
+ */
+void test_metrics_memfault_uploader_instance( void )
+{
+    static const OSEndPoint_t proxy = { NCE_MEMFAULT_PROXY_HOST, 5683 };
+    static nce_memfault_uploader_t uploader;
+    nce_memfault_source_t source = { one_chunk, NULL, NULL };
+    nce_netsim_config_t config;
+    os_network_ops_t ops;
+    int taken = 0;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 3;
+    config.latencyUs = METRICS_LATENCY_US;
+    config.recvTimeoutUs = METRICS_TIMEOUT_US;
+    nce_netsim_init( &sim, &config, nce_netsim_ack_responder, NULL, &ops );
+    clockFromSim = 1;
+    source.arg = &taken;
+    nce_memfault_init( &uploader, &ops, &proxy, &source );
+    uploader.metrics = &metrics;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_memfault_upload_attempt( &uploader, 1 ) );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_MEMFAULT_UPLOAD ].attempts );
+    TEST_ASSERT_EQUAL( 1, metrics.op[ NCE_METRIC_MEMFAULT_UPLOAD ].successes );
+    TEST_ASSERT_TRUE( metrics.op[ NCE_METRIC_MEMFAULT_UPLOAD ].bytesSent > 16u );
+
+    nce_metrics_snapshot( NULL, &snapshot, 0 );
+    TEST_ASSERT_EQUAL( 0, snapshot.op[ NCE_METRIC_MEMFAULT_UPLOAD ].attempts );
+}
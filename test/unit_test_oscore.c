@@ -0,0 +1,351 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_oscore.h"
+#include "nce_netsim.h"
+#include "nce_oscore_server.h"
+
+/* RFC 8613 appendix C.1.1, client side */
+static const uint8_t masterSecret[] =
+{
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10
+};
+static const uint8_t masterSalt[] = { 0x9e, 0x7c, 0xa9, 0x22, 0x23, 0x78, 0x63, 0x40 };
+static const uint8_t recipientId[] = { 0x01 };
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_oscore_server_t server;
+static nce_oscore_context_t ctx;
+static nce_oscore_request_t request;
+static uint32_t persisted;
+static int persistWrites;
+static int persistFails;
+
+static const OSEndPoint_t endpoint = { "coap.os.1nce.com", 5683 };
+
+/* CON POST /t with a 2-byte token and a payload */
+static const uint8_t uplink[] =
+{
+    0x42, 0x02, 0x12, 0x34, 0xab, 0xcd, 0xb1, 't', 0xFF, 't', 'e', 'm', 'p', '=', '2', '1'
+};
+
+/*-----------------------------------------------------------*/
+
+static int persist( void * arg,
+                    uint32_t next )
+{
+    ( void ) arg;
+
+    if( persistFails )
+    {
+        return -1;
+    }
+
+    persisted = next;
+    persistWrites++;
+
+    return 0;
+}
+
+/**
+ * @brief Derive the client context of RFC 8613 appendix C.1.1.
+ */
+static void init_rfc_context( uint32_t sequence )
+{
+    nce_oscore_params_t params;
+
+    memset( &params, 0, sizeof( params ) );
+    params.masterSecret = masterSecret;
+    params.masterSecretLength = sizeof( masterSecret );
+    params.masterSalt = masterSalt;
+    params.masterSaltLength = sizeof( masterSalt );
+    params.recipientId = recipientId;
+    params.recipientIdLength = sizeof( recipientId );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_SUCCESS, nce_oscore_init( &ctx, &params, sequence, NULL, NULL ) );
+}
+
+/**
+ * @brief Derive the context of the netsim credentials, as after onboarding.
+ */
+static void init_device_context( void )
+{
+    nce_dtls_key_t key;
+
+    memset( &key, 0, sizeof( key ) );
+    key.pskLength = ( uint8_t ) strlen( NCE_NETSIM_PSK );
+    memcpy( key.psk, NCE_NETSIM_PSK, key.pskLength );
+    key.identityLength = ( uint8_t ) strlen( NCE_NETSIM_IDENTITY );
+    memcpy( key.identity, NCE_NETSIM_IDENTITY, key.identityLength );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_SUCCESS, nce_oscore_init_from_key( &ctx, &key, persisted, persist, NULL ) );
+}
+
+/**
+ * @brief Protect the uplink with a Message ID and send it.
+ */
+static int send_uplink( uint16_t messageId,
+                        uint8_t * datagram,
+                        size_t size )
+{
+    uint8_t message[ sizeof( uplink ) ];
+    int length;
+
+    memcpy( message, uplink, sizeof( uplink ) );
+    message[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    message[ 3 ] = ( uint8_t ) messageId;
+    length = nce_oscore_protect_request( &ctx, message, sizeof( message ), datagram, size, &request );
+    TEST_ASSERT_TRUE( length > 0 );
+    TEST_ASSERT_EQUAL( length, ops.nce_os_udp_send( ops.os_socket, datagram, ( size_t ) length ) );
+
+    return length;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1;
+    config.latencyUs = 100000u;
+    config.recvTimeoutUs = 2000000u;
+    nce_netsim_init( &sim, &config, nce_oscore_server_responder, &server, &ops );
+    nce_oscore_server_init( &server, ( const uint8_t * ) NCE_NETSIM_PSK, strlen( NCE_NETSIM_PSK ),
+                            ( const uint8_t * ) NCE_NETSIM_IDENTITY, strlen( NCE_NETSIM_IDENTITY ) );
+    ops.nce_os_udp_connect( ops.os_socket, endpoint );
+    persisted = 0;
+    persistWrites = 0;
+    persistFails = 0;
+}
+
+void tearDown( void )
+{
+    ops.nce_os_udp_disconnect( ops.os_socket );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Keys and Common IV match RFC 8613 appendix C.1.1.
+ */
+void test_oscore_key_derivation_vectors( void )
+{
+    static const uint8_t senderKey[] =
+    {
+        0xf0, 0x91, 0x0e, 0xd7, 0x29, 0x5e, 0x6a, 0xd4, 0xb5, 0x4f, 0xc7, 0x93, 0x15, 0x43, 0x02, 0xff
+    };
+    static const uint8_t recipientKey[] =
+    {
+        0xff, 0xb1, 0x4e, 0x09, 0x3c, 0x94, 0xc9, 0xca, 0xc9, 0x47, 0x16, 0x48, 0xb4, 0xf9, 0x87, 0x10
+    };
+    static const uint8_t commonIv[] =
+    {
+        0x46, 0x22, 0xd4, 0xdd, 0x6d, 0x94, 0x41, 0x68, 0xee, 0xfb, 0x54, 0x98, 0x7c
+    };
+
+    init_rfc_context( 0 );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( senderKey, ctx.senderKey, sizeof( senderKey ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( recipientKey, ctx.recipientKey, sizeof( recipientKey ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( commonIv, ctx.commonIv, sizeof( commonIv ) );
+}
+
+/**
+ * @brief Test 2: A request is protected as in RFC 8613 appendix C.4, Uri-Host
+ * outside and Uri-Path encrypted.
+ */
+void test_oscore_protect_request_vector( void )
+{
+    static const uint8_t plain[] =
+    {
+        0x44, 0x01, 0x5d, 0x1f, 0x00, 0x00, 0x39, 0x74, 0x39, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x68, 0x6f,
+        0x73, 0x74, 0x83, 0x74, 0x76, 0x31
+    };
+    static const uint8_t expected[] =
+    {
+        0x44, 0x02, 0x5d, 0x1f, 0x00, 0x00, 0x39, 0x74, 0x39, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x68, 0x6f,
+        0x73, 0x74, 0x62, 0x09, 0x14, 0xff, 0x61, 0x2f, 0x10, 0x92, 0xf1, 0x77, 0x6f, 0x1c, 0x16, 0x68,
+        0xb3, 0x82, 0x5e
+    };
+    uint8_t protectedMessage[ sizeof( plain ) + NCE_OSCORE_OVERHEAD_MAX ];
+
+    init_rfc_context( 20 );
+    TEST_ASSERT_EQUAL( sizeof( expected ), nce_oscore_protect_request( &ctx, plain, sizeof( plain ), protectedMessage,
+                                                                       sizeof( protectedMessage ), &request ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( expected, protectedMessage, sizeof( expected ) );
+    TEST_ASSERT_EQUAL( 1, request.pivLength );
+    TEST_ASSERT_EQUAL_UINT32( 21u, ctx.sequence );
+
+    /* Too small an output buffer, the number is consumed all the same. */
+    TEST_ASSERT_EQUAL( NCE_OSCORE_BUFFER_ERROR, nce_oscore_protect_request( &ctx, plain, sizeof( plain ), protectedMessage,
+                                                                            sizeof( expected ) - 1u, &request ) );
+    TEST_ASSERT_EQUAL_UINT32( 22u, ctx.sequence );
+}
+
+/**
+ * @brief Test 3: The response of RFC 8613 appendix C.7 verifies and decrypts,
+ * a modified one does not.
+ */
+void test_oscore_unprotect_response_vector( void )
+{
+    static const uint8_t protectedResponse[] =
+    {
+        0x64, 0x44, 0x5d, 0x1f, 0x00, 0x00, 0x39, 0x74, 0x90, 0xff, 0xdb, 0xaa, 0xd1, 0xe9, 0xa7, 0xe7,
+        0xb2, 0xa8, 0x13, 0xd3, 0xc3, 0x15, 0x24, 0x37, 0x83, 0x03, 0xcd, 0xaf, 0xae, 0x11, 0x91, 0x06
+    };
+    static const uint8_t expected[] =
+    {
+        0x64, 0x45, 0x5d, 0x1f, 0x00, 0x00, 0x39, 0x74, 0xff, 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x57,
+        0x6f, 0x72, 0x6c, 0x64, 0x21
+    };
+    uint8_t tampered[ sizeof( protectedResponse ) ];
+    uint8_t response[ sizeof( protectedResponse ) ];
+
+    init_rfc_context( 0 );
+    request.piv[ 0 ] = 0x14;
+    request.pivLength = 1;
+    TEST_ASSERT_EQUAL( sizeof( expected ), nce_oscore_unprotect_response( &ctx, &request, protectedResponse,
+                                                                          sizeof( protectedResponse ), response,
+                                                                          sizeof( response ) ) );
+    TEST_ASSERT_EQUAL_UINT8_ARRAY( expected, response, sizeof( expected ) );
+
+    memcpy( tampered, protectedResponse, sizeof( tampered ) );
+    tampered[ sizeof( tampered ) - 1u ] ^= 0x01u;
+    TEST_ASSERT_EQUAL( NCE_OSCORE_VERIFY_ERROR, nce_oscore_unprotect_response( &ctx, &request, tampered,
+                                                                               sizeof( tampered ), response,
+                                                                               sizeof( response ) ) );
+
+    /* The same response does not verify for another request. */
+    request.piv[ 0 ] = 0x15;
+    TEST_ASSERT_EQUAL( NCE_OSCORE_VERIFY_ERROR, nce_oscore_unprotect_response( &ctx, &request, protectedResponse,
+                                                                               sizeof( protectedResponse ), response,
+                                                                               sizeof( response ) ) );
+}
+
+/**
+ * @brief Test 4: Proxy-Uri, Observe and already protected requests are
+ * refused without consuming a Sequence Number.
+ */
+void test_oscore_unsupported_requests( void )
+{
+    static const uint8_t proxyUri[] = { 0x40, 0x01, 0x00, 0x01, 0xd1, 0x16, 'x' };
+    static const uint8_t observe[] = { 0x40, 0x01, 0x00, 0x01, 0x60 };
+    static const uint8_t protectedAlready[] = { 0x40, 0x02, 0x00, 0x01, 0x91, 0x00 };
+    static const uint8_t response[] = { 0x60, 0x44, 0x00, 0x01 };
+    uint8_t out[ 64 ];
+
+    init_rfc_context( 5 );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_UNSUPPORTED_ERROR,
+                       nce_oscore_protect_request( &ctx, proxyUri, sizeof( proxyUri ), out, sizeof( out ), &request ) );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_UNSUPPORTED_ERROR,
+                       nce_oscore_protect_request( &ctx, observe, sizeof( observe ), out, sizeof( out ), &request ) );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_FORMAT_ERROR,
+                       nce_oscore_protect_request( &ctx, protectedAlready, sizeof( protectedAlready ), out,
+                                                   sizeof( out ), &request ) );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_FORMAT_ERROR,
+                       nce_oscore_protect_request( &ctx, response, sizeof( response ), out, sizeof( out ), &request ) );
+    TEST_ASSERT_EQUAL_UINT32( 5u, ctx.sequence );
+}
+
+/**
+ * @brief Test 5: Sequence Numbers are persisted once per window, a context
+ * restored from the stored value never repeats one, and a failed write stops
+ * the request.
+ */
+void test_oscore_sequence_persisted_per_window( void )
+{
+    static const uint8_t message[] = { 0x50, 0x02, 0x00, 0x01, 0xFF, 'x' };
+    uint8_t out[ sizeof( message ) + NCE_OSCORE_OVERHEAD_MAX ];
+    uint32_t i;
+
+    init_device_context();
+
+    for( i = 0; i < NCE_SDK_OSCORE_SEQUENCE_WINDOW + 1u; i++ )
+    {
+        TEST_ASSERT_TRUE( nce_oscore_protect_request( &ctx, message, sizeof( message ), out, sizeof( out ), &request ) > 0 );
+    }
+
+    TEST_ASSERT_EQUAL( 2, persistWrites );
+    TEST_ASSERT_EQUAL_UINT32( 2u * NCE_SDK_OSCORE_SEQUENCE_WINDOW, persisted );
+
+    /* Reset: numbers up to the stored value are skipped. */
+    init_device_context();
+    TEST_ASSERT_TRUE( nce_oscore_protect_request( &ctx, message, sizeof( message ), out, sizeof( out ), &request ) > 0 );
+    TEST_ASSERT_EQUAL_UINT32( 2u * NCE_SDK_OSCORE_SEQUENCE_WINDOW + 1u, ctx.sequence );
+    TEST_ASSERT_EQUAL( 3, persistWrites );
+
+    init_device_context();
+    persistFails = 1;
+    TEST_ASSERT_EQUAL( NCE_OSCORE_SEQUENCE_ERROR,
+                       nce_oscore_protect_request( &ctx, message, sizeof( message ), out, sizeof( out ), &request ) );
+}
+
+/**
+ * @brief Test 6: A confirmable uplink protected with the onboarding
+ * credentials is verified by the server stand-in and its 2.04 verified by the
+ * device, in one round trip without handshake.
+ */
+void test_oscore_uplink_round_trip( void )
+{
+    uint8_t datagram[ sizeof( uplink ) + NCE_OSCORE_OVERHEAD_MAX ];
+    uint8_t answer[ 64 ];
+    uint8_t response[ 64 ];
+    int length;
+    uint64_t start = sim.nowUs;
+
+    init_device_context();
+    ( void ) send_uplink( 0x1234, datagram, sizeof( datagram ) );
+    length = ops.nce_os_udp_recv( ops.os_socket, answer, sizeof( answer ) );
+    TEST_ASSERT_TRUE( length > 0 );
+    TEST_ASSERT_EQUAL_UINT32( 200000u, ( uint32_t ) ( sim.nowUs - start ) );
+
+    TEST_ASSERT_EQUAL( 1, server.accepted );
+    /* The server sees the inner code, Uri-Path and payload. */
+    TEST_ASSERT_EQUAL( sizeof( uplink ) - 5u, server.lastPlaintextLength );
+    TEST_ASSERT_EQUAL_UINT8( 0x02, server.lastPlaintext[ 0 ] );
+    TEST_ASSERT_EQUAL_MEMORY( &uplink[ 6 ], &server.lastPlaintext[ 1 ], sizeof( uplink ) - 6u );
+
+    length = nce_oscore_unprotect_response( &ctx, &request, answer, ( size_t ) length, response, sizeof( response ) );
+    TEST_ASSERT_EQUAL( 6, length );
+    TEST_ASSERT_EQUAL_UINT8( 0x62, response[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT8( 0x44, response[ 1 ] );
+    TEST_ASSERT_EQUAL_MEMORY( &uplink[ 2 ], &response[ 2 ], 4 );
+}
+
+/**
+ * @brief Test 7: The server answers a retransmission from its cache, drops a
+ * replayed older request, and rejects a request of another device.
+ */
+void test_oscore_server_replay_and_unknown_device( void )
+{
+    uint8_t first[ sizeof( uplink ) + NCE_OSCORE_OVERHEAD_MAX ];
+    uint8_t second[ sizeof( uplink ) + NCE_OSCORE_OVERHEAD_MAX ];
+    uint8_t answer[ 64 ];
+    nce_dtls_key_t other;
+    int firstLength;
+
+    init_device_context();
+    firstLength = send_uplink( 1, first, sizeof( first ) );
+    TEST_ASSERT_TRUE( ops.nce_os_udp_recv( ops.os_socket, answer, sizeof( answer ) ) > 0 );
+    TEST_ASSERT_EQUAL( firstLength, ops.nce_os_udp_send( ops.os_socket, first, ( size_t ) firstLength ) );
+    TEST_ASSERT_TRUE( ops.nce_os_udp_recv( ops.os_socket, answer, sizeof( answer ) ) > 0 );
+    TEST_ASSERT_EQUAL( 1, server.duplicates );
+
+    ( void ) send_uplink( 2, second, sizeof( second ) );
+    TEST_ASSERT_TRUE( ops.nce_os_udp_recv( ops.os_socket, answer, sizeof( answer ) ) > 0 );
+    TEST_ASSERT_EQUAL( firstLength, ops.nce_os_udp_send( ops.os_socket, first, ( size_t ) firstLength ) );
+    TEST_ASSERT_EQUAL( 0, ops.nce_os_udp_recv( ops.os_socket, answer, sizeof( answer ) ) );
+    TEST_ASSERT_EQUAL( 1, server.replays );
+    TEST_ASSERT_EQUAL( 2, server.accepted );
+
+    memset( &other, 0, sizeof( other ) );
+    other.pskLength = 5;
+    memcpy( other.psk, "other", 5 );
+    other.identityLength = 5;
+    memcpy( other.identity, "other", 5 );
+    TEST_ASSERT_EQUAL( NCE_OSCORE_SUCCESS, nce_oscore_init_from_key( &ctx, &other, 0, NULL, NULL ) );
+    ( void ) send_uplink( 3, second, sizeof( second ) );
+    TEST_ASSERT_EQUAL( 0, ops.nce_os_udp_recv( ops.os_socket, answer, sizeof( answer ) ) );
+    TEST_ASSERT_EQUAL( 1, server.rejected );
+}
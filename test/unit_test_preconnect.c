@@ -0,0 +1,177 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "nce_iot_c_sdk.h"
+#include "network_interface_linux.h"
+#include "preconnect_linux.h"
+#include "nce_standin.h"
+
+/* Time the slow connect takes, standing for DNS and the DTLS handshake */
+#define HANDSHAKE_MS    100
+
+static nce_standin_t standin;
+static OSEndPoint_t standinEndpoint = { "127.0.0.1", 0 };
+static struct OSNetwork network;
+static os_network_ops_t realOps;
+static os_network_ops_t sdkOps;
+static nce_context_t ctx;
+static DtlsKey_t key;
+static nce_os_preconnect_stats_t before;
+static int realConnects;
+
+/*-----------------------------------------------------------*/
+
+static void sleep_ms( long ms )
+{
+    struct timespec ts = { ms / 1000, ( ms % 1000 ) * 1000000L };
+
+    nanosleep( &ts, NULL );
+}
+
+/**
+ * @brief Real connect of the tests: the Linux port after a handshake delay.
+ */
+static int slow_connect( OSNetwork_t osnetwork,
+                         OSEndPoint_t endpoint )
+{
+    __atomic_add_fetch( &realConnects, 1, __ATOMIC_RELAXED );
+    sleep_ms( HANDSHAKE_MS );
+
+    return nce_os_connect( osnetwork, endpoint );
+}
+
+/**
+ * @brief Counters changed since setUp().
+ */
+static nce_os_preconnect_stats_t stats_delta( void )
+{
+    nce_os_preconnect_stats_t now;
+
+    nce_os_preconnect_get_stats( &now );
+    now.prepared -= before.prepared;
+    now.failed -= before.failed;
+    now.adopted -= before.adopted;
+    now.waited -= before.waited;
+    now.expired -= before.expired;
+    now.discarded -= before.discarded;
+
+    return now;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    TEST_ASSERT_EQUAL_INT( 0, nce_standin_start( &standin ) );
+    standinEndpoint.port = standin.port;
+
+    realOps.os_socket = &network;
+    realOps.nce_os_udp_connect = slow_connect;
+    realOps.nce_os_udp_send = nce_os_send;
+    realOps.nce_os_udp_recv = nce_os_recv;
+    realOps.nce_os_udp_disconnect = nce_os_disconnect;
+    sdkOps = realOps;
+    sdkOps.nce_os_udp_connect = nce_os_preconnect_connect;
+
+    os_context_init( &ctx, &sdkOps );
+    ctx.onboardEndpoint = &standinEndpoint;
+    memset( &key, 0, sizeof( key ) );
+    nce_os_preconnect_get_stats( &before );
+    realConnects = 0;
+}
+
+void tearDown( void )
+{
+    nce_os_preconnect_cancel();
+    nce_standin_stop( &standin );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Onboarding after the background connect finished uses the
+ * prepared session, without connecting again.
+ */
+void test_preconnect_session_adopted( void )
+{
+    TEST_ASSERT_EQUAL( NCE_PRECONNECT_SUCCESS, nce_os_preconnect_start( &realOps, standinEndpoint, 5000 ) );
+    sleep_ms( 3 * HANDSHAKE_MS );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_ctx( &ctx, &key ) );
+    TEST_ASSERT_EQUAL( 1, realConnects );
+    TEST_ASSERT_EQUAL( 1, stats_delta().prepared );
+    TEST_ASSERT_EQUAL( 1, stats_delta().adopted );
+    TEST_ASSERT_EQUAL( 0, stats_delta().waited );
+
+    /* Later connects have nothing prepared and connect normally. */
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_ctx( &ctx, &key ) );
+    TEST_ASSERT_EQUAL( 2, realConnects );
+}
+
+/**
+ * @brief Test 2: A connect during the background handshake waits for it
+ * instead of running a second one.
+ */
+void test_preconnect_waits_for_handshake( void )
+{
+    TEST_ASSERT_EQUAL( NCE_PRECONNECT_SUCCESS, nce_os_preconnect_start( &realOps, standinEndpoint, 5000 ) );
+    TEST_ASSERT_EQUAL( NCE_PRECONNECT_BUSY, nce_os_preconnect_start( &realOps, standinEndpoint, 5000 ) );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_ctx( &ctx, &key ) );
+    TEST_ASSERT_EQUAL( 1, realConnects );
+    TEST_ASSERT_EQUAL( 1, stats_delta().adopted );
+    TEST_ASSERT_EQUAL( 1, stats_delta().waited );
+}
+
+/**
+ * @brief Test 3: A session nobody adopts is closed after the idle timeout,
+ * and one prepared for another endpoint is not handed out.
+ */
+void test_preconnect_idle_and_mismatch( void )
+{
+    OSEndPoint_t other = { "127.0.0.1", 0 };
+
+    TEST_ASSERT_EQUAL( NCE_PRECONNECT_SUCCESS, nce_os_preconnect_start( &realOps, standinEndpoint, 50 ) );
+    sleep_ms( HANDSHAKE_MS + 400 );
+    TEST_ASSERT_EQUAL( 1, stats_delta().expired );
+
+    other.port = standin.port + 1;
+    TEST_ASSERT_EQUAL( NCE_PRECONNECT_SUCCESS, nce_os_preconnect_start( &realOps, other, 5000 ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_ctx( &ctx, &key ) );
+    TEST_ASSERT_EQUAL( 1, stats_delta().discarded );
+    TEST_ASSERT_EQUAL( 0, stats_delta().adopted );
+    TEST_ASSERT_EQUAL( 3, realConnects );
+}
+
+/**
+ * @brief Test 4: A prepare started while a session is open on the network
+ * object neither replaces nor closes its socket.
+ */
+void test_preconnect_leaves_open_session( void )
+{
+    struct sockaddr_in local;
+    struct sockaddr_in after;
+    socklen_t length = sizeof( local );
+    int fd;
+
+    TEST_ASSERT_EQUAL_INT( 0, nce_os_connect( &network, standinEndpoint ) );
+    fd = network.os_socket;
+    TEST_ASSERT_EQUAL_INT( 0, getsockname( fd, ( struct sockaddr * ) &local, &length ) );
+
+    TEST_ASSERT_EQUAL( NCE_PRECONNECT_SUCCESS, nce_os_preconnect_start( &realOps, standinEndpoint, 50 ) );
+    sleep_ms( HANDSHAKE_MS + 400 );
+    TEST_ASSERT_EQUAL( 1, stats_delta().prepared );
+    TEST_ASSERT_EQUAL( 1, stats_delta().expired );
+
+    TEST_ASSERT_EQUAL_INT( fd, network.os_socket );
+    TEST_ASSERT_TRUE( fcntl( fd, F_GETFD ) != -1 );
+    length = sizeof( after );
+    TEST_ASSERT_EQUAL_INT( 0, getsockname( fd, ( struct sockaddr * ) &after, &length ) );
+    TEST_ASSERT_EQUAL_INT( local.sin_port, after.sin_port );
+
+    nce_os_disconnect( &network );
+}
@@ -0,0 +1,257 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_retry.h"
+#include "nce_netsim.h"
+
+/* One-way latency of the simulated link */
+#define RETRY_LATENCY_US    100000u
+
+/* Receive timeout of the simulated socket */
+#define RETRY_TIMEOUT_US    2000000u
+
+/* CoAP codes answered by the scripted responder */
+#define CODE_FORBIDDEN      0x83u /* 4.03 */
+#define CODE_INTERNAL       0xA0u /* 5.00 */
+#define CODE_UNAVAILABLE    0xA3u /* 5.03 */
+
+/**
+ * @brief Remote answering an error code for the first requests, then
+ * onboarding the device.
+ */
+typedef struct scripted_remote
+{
+    uint8_t code;      /**< Error code answered. */
+    uint32_t maxAgeS;  /**< Max-Age option of the error, 0 for none. */
+    int errors;        /**< Requests answered with the error before succeeding. */
+    int requests;      /**< Requests seen. */
+} scripted_remote_t;
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_context_t ctx;
+static DtlsKey_t key;
+static scripted_remote_t remote;
+static uint32_t waitedMs;
+static int waits;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Responder playing the scripted remote.
+ */
+static size_t scripted_responder( void * arg,
+                                  const uint8_t * request,
+                                  size_t requestLength,
+                                  uint8_t * response,
+                                  size_t responseSize )
+{
+    scripted_remote_t * script = ( scripted_remote_t * ) arg;
+    size_t length = 4;
+
+    if( script->requests++ >= script->errors )
+    {
+        return nce_netsim_onboard_responder( NULL, request, requestLength, response, responseSize );
+    }
+
+    response[ 0 ] = 0x50;
+    response[ 1 ] = script->code;
+    response[ 2 ] = request[ 2 ];
+    response[ 3 ] = request[ 3 ];
+
+    if( script->maxAgeS > 0u )
+    {
+        /* Max-Age (14): extended delta, 2-byte value. */
+        response[ length++ ] = 0xD2;
+        response[ length++ ] = 14 - 13;
+        response[ length++ ] = ( uint8_t ) ( script->maxAgeS >> 8 );
+        response[ length++ ] = ( uint8_t ) script->maxAgeS;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Context delay: advances the virtual clock of the link.
+ */
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+    waitedMs += ms;
+    waits++;
+}
+
+/**
+ * @brief Onboard against the scripted remote.
+ */
+static int onboard( uint8_t code,
+                    uint32_t maxAgeS,
+                    int errors )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1;
+    config.latencyUs = RETRY_LATENCY_US;
+    config.recvTimeoutUs = RETRY_TIMEOUT_US;
+    remote.code = code;
+    remote.maxAgeS = maxAgeS;
+    remote.errors = errors;
+    remote.requests = 0;
+
+    nce_netsim_init( &sim, &config, scripted_responder, &remote, &ops );
+    os_context_init( &ctx, &ops );
+    ctx.delayMs = virtual_delay;
+    memset( &key, 0, sizeof( key ) );
+
+    return os_auth_ctx( &ctx, &key );
+}
+
+/**
+ * @brief Classify a bare CoAP response with the given code.
+ */
+static nce_retry_decision_t classify_code( uint8_t code,
+                                           unsigned int attempt )
+{
+    uint8_t message[ 4 ] = { 0x60, 0, 0x12, 0x34 };
+    nce_retry_decision_t decision;
+
+    message[ 1 ] = code;
+    ( void ) nce_retry_classify( message, sizeof( message ), attempt, &decision );
+
+    return decision;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    waitedMs = 0;
+    waits = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Each class of response gets its action and typed error.
+ */
+void test_retry_classify_codes( void )
+{
+    const char credentials[] = "***89*****,ID,PSK";
+    nce_retry_decision_t decision;
+
+    decision = classify_code( 0x84, 1 );
+    TEST_ASSERT_EQUAL( NCE_RETRY_FAIL, decision.action );
+    TEST_ASSERT_EQUAL( NCE_SDK_CLIENT_ERROR, decision.status );
+    TEST_ASSERT_EQUAL_HEX8( 0x84, decision.code );
+
+    decision = classify_code( 0xA1, 1 );
+    TEST_ASSERT_EQUAL( NCE_RETRY_FAIL, decision.action );
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVER_RESPONSE_ERROR, decision.status );
+
+    decision = classify_code( 0xA4, 2 );
+    TEST_ASSERT_EQUAL( NCE_RETRY_WAIT, decision.action );
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVER_RESPONSE_ERROR, decision.status );
+    TEST_ASSERT_EQUAL_UINT32( 2 * NCE_SDK_RETRY_BASE_MS, decision.waitMs );
+
+    decision = classify_code( CODE_UNAVAILABLE, 1 );
+    TEST_ASSERT_EQUAL( NCE_RETRY_WAIT, decision.action );
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVICE_UNAVAILABLE, decision.status );
+    TEST_ASSERT_EQUAL_UINT32( NCE_COAP_DEFAULT_MAX_AGE_S * 1000u, decision.waitMs );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, nce_retry_classify( NULL, -1, 3, &decision ) );
+    TEST_ASSERT_EQUAL( NCE_RETRY_WAIT, decision.action );
+    TEST_ASSERT_EQUAL_UINT32( 4 * NCE_SDK_RETRY_BASE_MS, decision.waitMs );
+
+    decision = classify_code( 0x45, 1 );
+    TEST_ASSERT_EQUAL( NCE_RETRY_DONE, decision.action );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_retry_classify( credentials, sizeof( credentials ) - 1, 1, &decision ) );
+    TEST_ASSERT_EQUAL( NCE_RETRY_DONE, decision.action );
+}
+
+/**
+ * @brief Test 2: Max-Age is found behind other options in their extended
+ * forms, defaults to 60 s and malformed options are reported.
+ */
+void test_retry_max_age_option( void )
+{
+    /* Token 0x01 0x02, Uri-Path (11) of 20 bytes, Max-Age (14) = 0x012C, payload. */
+    uint8_t message[ 4 + 2 + 2 + 20 + 3 + 2 ] = { 0x62, CODE_UNAVAILABLE, 0, 1, 0x01, 0x02, 0xBD, 20 - 13 };
+    uint8_t truncated[] = { 0x60, CODE_UNAVAILABLE, 0, 1, 0xBD };
+    uint8_t bare[] = { 0x60, CODE_UNAVAILABLE, 0, 1, 0xFF, 'x' };
+    uint32_t maxAgeS;
+
+    memset( &message[ 8 ], 'p', 20 );
+    message[ 28 ] = 0x32;
+    message[ 29 ] = 0x01;
+    message[ 30 ] = 0x2C;
+    message[ 31 ] = 0xFF;
+    message[ 32 ] = 'x';
+
+    TEST_ASSERT_EQUAL( 0, nce_coap_max_age( message, sizeof( message ), &maxAgeS ) );
+    TEST_ASSERT_EQUAL_UINT32( 300, maxAgeS );
+    TEST_ASSERT_EQUAL( 0, nce_coap_max_age( bare, sizeof( bare ), &maxAgeS ) );
+    TEST_ASSERT_EQUAL_UINT32( NCE_COAP_DEFAULT_MAX_AGE_S, maxAgeS );
+    TEST_ASSERT_EQUAL( -1, nce_coap_max_age( truncated, sizeof( truncated ), &maxAgeS ) );
+}
+
+/**
+ * @brief Test 3: The backoff doubles from the base and stops at the cap.
+ */
+void test_retry_backoff( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RETRY_BASE_MS, nce_retry_backoff_ms( 1 ) );
+    TEST_ASSERT_EQUAL_UINT32( 2 * NCE_SDK_RETRY_BASE_MS, nce_retry_backoff_ms( 2 ) );
+    TEST_ASSERT_EQUAL_UINT32( 8 * NCE_SDK_RETRY_BASE_MS, nce_retry_backoff_ms( 4 ) );
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RETRY_MAX_MS, nce_retry_backoff_ms( 40 ) );
+}
+
+/**
+ * @brief Test 4: A 4.03 ends onboarding after one request, without waiting.
+ */
+void test_retry_client_error_fails_fast( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_CLIENT_ERROR, onboard( CODE_FORBIDDEN, 0, 1 ) );
+    TEST_ASSERT_EQUAL( 1, remote.requests );
+    TEST_ASSERT_EQUAL( 0, waits );
+}
+
+/**
+ * @brief Test 5: After a 5.03 the device waits Max-Age before the next
+ * request, which succeeds.
+ */
+void test_retry_unavailable_waits_max_age( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( CODE_UNAVAILABLE, 30, 1 ) );
+    TEST_ASSERT_EQUAL( 2, remote.requests );
+    TEST_ASSERT_EQUAL( 1, waits );
+    TEST_ASSERT_EQUAL_UINT32( 30000, waitedMs );
+    TEST_ASSERT_EQUAL_STRING( NCE_NETSIM_PSK, key.Psk );
+}
+
+/**
+ * @brief Test 6: A 5.03 asking for more than the limit is reported at once.
+ */
+void test_retry_unavailable_beyond_limit( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVICE_UNAVAILABLE, onboard( CODE_UNAVAILABLE, NCE_SDK_RETRY_MAX_AGE_LIMIT_S + 1u, 1 ) );
+    TEST_ASSERT_EQUAL( 1, remote.requests );
+    TEST_ASSERT_EQUAL( 0, waits );
+}
+
+/**
+ * @brief Test 7: Repeated 5.00 responses are retried with a doubling wait,
+ * then reported.
+ */
+void test_retry_server_error_backoff( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_SERVER_RESPONSE_ERROR, onboard( CODE_INTERNAL, 0, 100 ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_ATTEMPTS - 1, remote.requests );
+    TEST_ASSERT_EQUAL( NCE_SDK_ATTEMPTS - 2, waits );
+    TEST_ASSERT_EQUAL_UINT32( 7 * NCE_SDK_RETRY_BASE_MS, waitedMs );
+}
@@ -0,0 +1,342 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_rto.h"
+#include "nce_netsim.h"
+
+/* One-way latency of the simulated link */
+#define RTO_LATENCY_US    50000u
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_context_t ctx;
+static DtlsKey_t key;
+static nce_rto_t rto;
+static int ignored;
+static int waits;
+static int failedSends;
+static int ( * simSend )( OSNetwork_t, void *, size_t );
+static int ( * simRecv )( OSNetwork_t, void *, size_t );
+
+static const OSEndPoint_t endpoint = { "rto.example", 5683 };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Virtual clock of the link, read by the SDK core.
+ */
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+/**
+ * @brief Remote ignoring the next requests, then onboarding the device.
+ */
+static size_t ignoring_responder( void * arg,
+                                  const uint8_t * request,
+                                  size_t requestLength,
+                                  uint8_t * response,
+                                  size_t responseSize )
+{
+    if( ignored > 0 )
+    {
+        ignored--;
+        return 0;
+    }
+
+    return nce_netsim_onboard_responder( arg, request, requestLength, response, responseSize );
+}
+
+/**
+ * @brief Send of the link failing the next sends locally.
+ */
+static int failing_send( OSNetwork_t osnetwork,
+                         void * buffer,
+                         size_t length )
+{
+    if( failedSends > 0 )
+    {
+        failedSends--;
+        return -1;
+    }
+
+    return simSend( osnetwork, buffer, length );
+}
+
+/**
+ * @brief Receive of the link reporting a timeout as an error, like a port
+ * returning the raw recv() result.
+ */
+static int erroring_recv( OSNetwork_t osnetwork,
+                          void * buffer,
+                          size_t length )
+{
+    int received = simRecv( osnetwork, buffer, length );
+
+    return ( received == 0 ) ? -1 : received;
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+    waits++;
+}
+
+/**
+ * @brief Onboard, returning the virtual time it took.
+ */
+static uint64_t timed_onboard( void )
+{
+    uint64_t start = sim.nowUs;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_ctx( &ctx, &key ) );
+
+    return sim.nowUs - start;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1;
+    config.latencyUs = RTO_LATENCY_US;
+    config.recvTimeoutUs = 10000000u;
+    nce_netsim_init( &sim, &config, ignoring_responder, NULL, &ops );
+    os_context_init( &ctx, &ops );
+    ctx.delayMs = virtual_delay;
+    ctx.rto = &rto;
+    ctx.setRecvTimeout = nce_netsim_set_recv_timeout;
+    nce_rto_init( &rto );
+    ignored = 0;
+    waits = 0;
+    failedSends = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: An unknown endpoint waits the initial timeout, doubled on
+ * each retransmission and capped.
+ */
+void test_rto_initial_backoff( void )
+{
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RTO_INITIAL_MS, nce_rto_timeout_ms( &rto, &endpoint, 1, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32( 2u * NCE_SDK_RTO_INITIAL_MS, nce_rto_timeout_ms( &rto, &endpoint, 2, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32( 4u * NCE_SDK_RTO_INITIAL_MS, nce_rto_timeout_ms( &rto, &endpoint, 3, 0 ) );
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RTO_MAX_MS, nce_rto_timeout_ms( &rto, &endpoint, 20, 0 ) );
+}
+
+/**
+ * @brief Test 2: Strong samples of a fast link bring the timeout below one
+ * second, where retransmissions back off by 3.
+ */
+void test_rto_strong_samples_converge( void )
+{
+    uint32_t timeout;
+    int i;
+
+    for( i = 0; i < 8; i++ )
+    {
+        nce_rto_report( &rto, &endpoint, 100000u, 1, 0 );
+    }
+
+    timeout = nce_rto_timeout_ms( &rto, &endpoint, 1, 0 );
+    TEST_ASSERT_TRUE( timeout < 1000u );
+    TEST_ASSERT_TRUE( timeout >= NCE_SDK_RTO_MIN_MS );
+    /* Rounded up to milliseconds before and after the backoff. */
+    TEST_ASSERT_UINT32_WITHIN( 3u, 3u * timeout, nce_rto_timeout_ms( &rto, &endpoint, 2, 0 ) );
+}
+
+/**
+ * @brief Test 3: A weak sample moves the timeout less than a strong one, and
+ * exchanges with too many transmissions are ignored.
+ */
+void test_rto_weak_samples( void )
+{
+    nce_rto_t strong;
+    uint32_t initial = nce_rto_timeout_ms( &rto, &endpoint, 1, 0 );
+
+    nce_rto_init( &strong );
+    nce_rto_report( &strong, &endpoint, 8000000u, 1, 0 );
+    nce_rto_report( &rto, &endpoint, 8000000u, NCE_SDK_RTO_WEAK_LIMIT + 1u, 0 );
+    TEST_ASSERT_EQUAL_UINT32( initial, nce_rto_timeout_ms( &rto, &endpoint, 1, 0 ) );
+
+    nce_rto_report( &rto, &endpoint, 8000000u, 2, 0 );
+    TEST_ASSERT_TRUE( nce_rto_timeout_ms( &rto, &endpoint, 1, 0 ) > initial );
+    TEST_ASSERT_TRUE( nce_rto_timeout_ms( &rto, &endpoint, 1, 0 ) < nce_rto_timeout_ms( &strong, &endpoint, 1, 0 ) );
+}
+
+/**
+ * @brief Test 4: Timeouts not updated for a while drift back: short ones
+ * double, long ones move halfway to the initial timeout.
+ */
+void test_rto_aging( void )
+{
+    uint32_t shortMs;
+    uint32_t longMs;
+    int i;
+
+    for( i = 0; i < 8; i++ )
+    {
+        nce_rto_report( &rto, &endpoint, 100000u, 1, 0 );
+    }
+
+    shortMs = nce_rto_timeout_ms( &rto, &endpoint, 1, 0 );
+    TEST_ASSERT_EQUAL_UINT32( shortMs, nce_rto_timeout_ms( &rto, &endpoint, 1, 15u * shortMs * 1000u ) );
+    TEST_ASSERT_UINT32_WITHIN( 2u, 2u * shortMs, nce_rto_timeout_ms( &rto, &endpoint, 1, 17u * shortMs * 1000u ) );
+
+    nce_rto_init( &rto );
+
+    for( i = 0; i < 8; i++ )
+    {
+        nce_rto_report( &rto, &endpoint, 10000000u, 1, 0 );
+    }
+
+    longMs = nce_rto_timeout_ms( &rto, &endpoint, 1, 0 );
+    TEST_ASSERT_TRUE( longMs > 3000u );
+    TEST_ASSERT_UINT32_WITHIN( 1u, ( NCE_SDK_RTO_INITIAL_MS + longMs ) / 2u,
+                              nce_rto_timeout_ms( &rto, &endpoint, 1, 5u * longMs * 1000u ) );
+}
+
+/**
+ * @brief Test 5: Endpoints are estimated separately, the least recently
+ * used one is replaced.
+ */
+void test_rto_endpoints_separate( void )
+{
+    OSEndPoint_t other = { "other.example", 5683 };
+    int i;
+
+    nce_rto_report( &rto, &endpoint, 100000u, 1, 0 );
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RTO_INITIAL_MS, nce_rto_timeout_ms( &rto, &other, 1, 0 ) );
+
+    for( i = 0; i < NCE_SDK_RTO_ENDPOINTS; i++ )
+    {
+        other.port = 6000 + i;
+        nce_rto_report( &rto, &other, 100000u, 1, 0 );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RTO_INITIAL_MS, nce_rto_timeout_ms( &rto, &endpoint, 1, 0 ) );
+}
+
+/**
+ * @brief Test 6: Onboarding learns the round trip of the link, applies the
+ * estimate to the socket and recovers from a lost request without the
+ * backoff wait.
+ */
+void test_rto_onboarding_recovers_fast( void )
+{
+    uint64_t lossless;
+    uint64_t recovered;
+    int i;
+
+    for( i = 0; i < 6; i++ )
+    {
+        lossless = timed_onboard();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 2u * RTO_LATENCY_US, ( uint32_t ) lossless );
+    TEST_ASSERT_TRUE( sim.config.recvTimeoutUs < 1000000u );
+
+    ignored = 1;
+    recovered = timed_onboard();
+    TEST_ASSERT_EQUAL( 0, waits );
+    TEST_ASSERT_TRUE( recovered < lossless + 1000000u );
+}
+
+/**
+ * @brief Test 7: On a link slower than the initial timeout, a response to
+ * the first request arriving after a retransmission is a weak sample and the
+ * timeout grows towards the round trip.
+ */
+void test_rto_onboarding_slow_link( void )
+{
+    int i;
+
+    sim.config.latencyUs = 2500000u;
+
+    for( i = 0; i < 6; i++ )
+    {
+        ( void ) timed_onboard();
+    }
+
+    TEST_ASSERT_TRUE( nce_rto_timeout_ms( &rto, ctx.onboardEndpoint, 1, ( uint32_t ) sim.nowUs ) > 4000u );
+    TEST_ASSERT_EQUAL_UINT32( 5000000u, ( uint32_t ) timed_onboard() );
+}
+
+/**
+ * @brief Test 8: A send error did not wait for a timeout, so the retry after
+ * it still waits the backoff.
+ */
+void test_rto_send_error_backs_off( void )
+{
+    simSend = ops.nce_os_udp_send;
+    ops.nce_os_udp_send = failing_send;
+    failedSends = 1;
+
+    ( void ) timed_onboard();
+    TEST_ASSERT_EQUAL( 1, waits );
+    TEST_ASSERT_EQUAL( 0, failedSends );
+}
+
+/**
+ * @brief Test 9: An endpoint idle for half the clock period or more, which
+ * the 32-bit clock cannot tell apart from a wrap, restarts from the initial
+ * timeout.
+ */
+void test_rto_idle_past_clock_horizon( void )
+{
+    uint32_t shortMs;
+    int i;
+
+    for( i = 0; i < 8; i++ )
+    {
+        nce_rto_report( &rto, &endpoint, 100000u, 1, 0xFFF00000u );
+    }
+
+    shortMs = nce_rto_timeout_ms( &rto, &endpoint, 1, 0xFFF00000u );
+    TEST_ASSERT_TRUE( shortMs < 1000u );
+
+    /* 2 s later, across the wrap, the timeout is still the learned one. */
+    TEST_ASSERT_EQUAL_UINT32( shortMs, nce_rto_timeout_ms( &rto, &endpoint, 1, 0xFFF00000u + 2000000u ) );
+
+    TEST_ASSERT_EQUAL_UINT32( NCE_SDK_RTO_INITIAL_MS, nce_rto_timeout_ms( &rto, &endpoint, 1, 0x7FF00000u ) );
+}
+
+/**
+ * @brief Test 10: A port reporting the timeout as an error has waited the
+ * timeout all the same, so the retry does not add the backoff wait.
+ */
+void test_rto_timeout_reported_as_error( void )
+{
+    simRecv = ops.nce_os_udp_recv;
+    ops.nce_os_udp_recv = erroring_recv;
+    ignored = 1;
+
+    ( void ) timed_onboard();
+    TEST_ASSERT_EQUAL( 0, waits );
+    TEST_ASSERT_EQUAL_UINT32( 1, sim.stats.timeouts );
+}
+
+/**
+ * @brief Test 11: A context without an estimator of its own keeps the fixed
+ * timeout of the port and backs off after a timeout.
+ */
+void test_rto_context_without_estimator( void )
+{
+    ctx.rto = NULL;
+    ignored = 1;
+
+    ( void ) timed_onboard();
+    TEST_ASSERT_EQUAL_UINT32( 10000000u, sim.config.recvTimeoutUs );
+    TEST_ASSERT_EQUAL( 1, waits );
+}
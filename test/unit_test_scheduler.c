@@ -0,0 +1,208 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_scheduler.h"
+#include "nce_modemsim.h"
+
+/* RRC inactivity timer of the simulated network */
+#define SCHED_INACTIVITY_US    10000000u
+
+/* Connection setup time of the simulated modem */
+#define SCHED_WAKE_US          2000000u
+
+/* Time on air of one operation */
+#define SCHED_TX_US            500000u
+
+/* One second of virtual time */
+#define SCHED_SECOND_US        1000000u
+
+/**
+ * @brief A queued test operation.
+ */
+typedef struct sched_op
+{
+    int id;
+    int followUp;
+} sched_op_t;
+
+static nce_modemsim_t modem;
+static nce_scheduler_t scheduler;
+static int ran[ 2 * NCE_SDK_SCHED_JOBS ];
+static size_t ranCount;
+
+/**
+ * @brief Clock of the scheduler: the virtual time of the modem.
+ */
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) modem.nowUs;
+}
+
+/**
+ * @brief Operation transmitting over the modem and logging its ID, it may
+ * queue a follow-up operation while the window is open.
+ */
+static int transmit_op( void * arg )
+{
+    static sched_op_t followUp = { 99, 0 };
+    sched_op_t * op = ( sched_op_t * ) arg;
+
+    ran[ ranCount++ ] = op->id;
+
+    if( op->followUp )
+    {
+        ( void ) nce_sched_submit( &scheduler, transmit_op, &followUp, NCE_SCHED_PRIORITY_LOW, 3600u * SCHED_SECOND_US );
+    }
+
+    return nce_modemsim_transmit( &modem, SCHED_TX_US );
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_sched_radio_t radio = { nce_modemsim_radio_state, &modem };
+
+    nce_modemsim_init( &modem, SCHED_INACTIVITY_US, SCHED_WAKE_US );
+    nce_sched_init( &scheduler, &radio );
+    memset( ran, 0, sizeof( ran ) );
+    ranCount = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Operations wait for the earliest deadline and then all run
+ * in one window, waking the modem once.
+ */
+void test_scheduler_coalesces_until_deadline( void )
+{
+    sched_op_t ops[ 3 ] = { { 1, 0 }, { 2, 0 }, { 3, 0 } };
+    nce_sched_stats_t stats;
+
+    TEST_ASSERT_EQUAL( NCE_SCHED_NO_WINDOW, nce_sched_time_to_window( &scheduler ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 0 ], NCE_SCHED_PRIORITY_NORMAL, 60u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 1 ], NCE_SCHED_PRIORITY_NORMAL, 10u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 2 ], NCE_SCHED_PRIORITY_LOW, 300u * SCHED_SECOND_US ) );
+
+    nce_modemsim_advance( &modem, 4u * SCHED_SECOND_US );
+    TEST_ASSERT_EQUAL( 0, nce_sched_poll( &scheduler ) );
+    TEST_ASSERT_EQUAL( 6u * SCHED_SECOND_US, nce_sched_time_to_window( &scheduler ) );
+
+    nce_modemsim_advance( &modem, 6u * SCHED_SECOND_US );
+    TEST_ASSERT_EQUAL( 0, nce_sched_time_to_window( &scheduler ) );
+    TEST_ASSERT_EQUAL( 3, nce_sched_poll( &scheduler ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_NO_WINDOW, nce_sched_time_to_window( &scheduler ) );
+
+    /* Earliest deadline first within a priority, low priority last. */
+    TEST_ASSERT_EQUAL( 2, ran[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, ran[ 1 ] );
+    TEST_ASSERT_EQUAL( 3, ran[ 2 ] );
+
+    TEST_ASSERT_EQUAL( 1, modem.wakeups );
+    TEST_ASSERT_EQUAL( 3, modem.transmissions );
+    nce_sched_get_stats( &scheduler, &stats );
+    TEST_ASSERT_EQUAL( 1, stats.windows );
+    TEST_ASSERT_EQUAL( 1, stats.wakeups );
+    TEST_ASSERT_EQUAL( 3, stats.jobsRun );
+    TEST_ASSERT_EQUAL( 2, stats.wakeupsAvoided );
+    TEST_ASSERT_EQUAL( 0, stats.deadlineMisses );
+}
+
+/**
+ * @brief Test 2: An urgent operation opens a window at once and takes the
+ * queued ones along, in priority then submission order.
+ */
+void test_scheduler_urgent_and_priorities( void )
+{
+    sched_op_t ops[ 4 ] = { { 1, 0 }, { 2, 0 }, { 3, 0 }, { 4, 0 } };
+
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 0 ], NCE_SCHED_PRIORITY_LOW, 600u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 1 ], NCE_SCHED_PRIORITY_HIGH, 600u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 2 ], NCE_SCHED_PRIORITY_HIGH, 600u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( 0, nce_sched_poll( &scheduler ) );
+
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 3 ], NCE_SCHED_PRIORITY_URGENT, 600u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( 0, nce_sched_time_to_window( &scheduler ) );
+    TEST_ASSERT_EQUAL( 4, nce_sched_poll( &scheduler ) );
+
+    TEST_ASSERT_EQUAL( 4, ran[ 0 ] );
+    TEST_ASSERT_EQUAL( 2, ran[ 1 ] );
+    TEST_ASSERT_EQUAL( 3, ran[ 2 ] );
+    TEST_ASSERT_EQUAL( 1, ran[ 3 ] );
+    TEST_ASSERT_EQUAL( 1, modem.wakeups );
+}
+
+/**
+ * @brief Test 3: While the modem is still connected from other traffic,
+ * queued operations ride along before their deadline without a wake-up.
+ */
+void test_scheduler_piggybacks_on_connected_radio( void )
+{
+    sched_op_t ops[ 2 ] = { { 1, 0 }, { 2, 0 } };
+    nce_sched_stats_t stats;
+
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 0 ], NCE_SCHED_PRIORITY_NORMAL, 900u * SCHED_SECOND_US ) );
+    TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ 1 ], NCE_SCHED_PRIORITY_LOW, 900u * SCHED_SECOND_US ) );
+
+    /* The application talks to its own server. */
+    TEST_ASSERT_EQUAL( 0, nce_modemsim_transmit( &modem, SCHED_TX_US ) );
+    nce_modemsim_advance( &modem, SCHED_SECOND_US );
+    TEST_ASSERT_EQUAL( 2, nce_sched_poll( &scheduler ) );
+
+    /* Once released, an empty window does not wake the modem again. */
+    nce_modemsim_advance( &modem, 2u * SCHED_INACTIVITY_US );
+    TEST_ASSERT_EQUAL( 0, nce_sched_poll( &scheduler ) );
+
+    TEST_ASSERT_EQUAL( 1, modem.wakeups );
+    nce_sched_get_stats( &scheduler, &stats );
+    TEST_ASSERT_EQUAL( 1, stats.piggybacked );
+    TEST_ASSERT_EQUAL( 0, stats.wakeups );
+    TEST_ASSERT_EQUAL( 2, stats.wakeupsAvoided );
+}
+
+/**
+ * @brief Test 4: Without coverage no window opens, late operations run when
+ * coverage returns and are counted as missed; a full queue refuses operations,
+ * and an operation queued from a window that already ran a full queue waits
+ * for the next window.
+ */
+void test_scheduler_offline_full_and_follow_up( void )
+{
+    sched_op_t ops[ NCE_SDK_SCHED_JOBS + 1 ];
+    nce_sched_stats_t stats;
+    int i;
+
+    for( i = 0; i <= NCE_SDK_SCHED_JOBS; i++ )
+    {
+        ops[ i ].id = i + 1;
+        ops[ i ].followUp = ( i == 0 );
+    }
+
+    for( i = 0; i < NCE_SDK_SCHED_JOBS; i++ )
+    {
+        TEST_ASSERT_EQUAL( NCE_SCHED_SUCCESS, nce_sched_submit( &scheduler, transmit_op, &ops[ i ], NCE_SCHED_PRIORITY_NORMAL, 30u * SCHED_SECOND_US ) );
+    }
+
+    TEST_ASSERT_EQUAL( NCE_SCHED_FULL, nce_sched_submit( &scheduler, transmit_op, &ops[ i ], NCE_SCHED_PRIORITY_NORMAL, 30u * SCHED_SECOND_US ) );
+
+    modem.coverage = 0;
+    nce_modemsim_advance( &modem, 60u * SCHED_SECOND_US );
+    TEST_ASSERT_EQUAL( 0, nce_sched_poll( &scheduler ) );
+
+    modem.coverage = 1;
+    TEST_ASSERT_EQUAL( NCE_SDK_SCHED_JOBS, nce_sched_poll( &scheduler ) );
+    TEST_ASSERT_EQUAL( 1, nce_sched_poll( &scheduler ) );
+    TEST_ASSERT_EQUAL( 99, ran[ NCE_SDK_SCHED_JOBS ] );
+
+    nce_sched_get_stats( &scheduler, &stats );
+    TEST_ASSERT_EQUAL( NCE_SDK_SCHED_JOBS + 1, stats.submitted );
+    TEST_ASSERT_EQUAL( 1, stats.rejected );
+    TEST_ASSERT_EQUAL( NCE_SDK_SCHED_JOBS, stats.deadlineMisses );
+    TEST_ASSERT_EQUAL( 0, stats.jobsFailed );
+    TEST_ASSERT_EQUAL( 1, modem.wakeups );
+}
@@ -48,6 +48,22 @@ int udp_send_mock( OSNetwork_t osnetwork,
     return bytesToSend;
 }
 
+/**
+ * @brief Message ID of the last request seen by udp_send_mock_capture.
+ */
+uint16_t lastMessageId = 0;
+
+/**
+ * @brief Mocked udp send recording the CoAP message ID of the request.
+ */
+int udp_send_mock_capture( OSNetwork_t osnetwork,
+                           void * pBuffer,
+                           size_t bytesToSend )
+{
+    memcpy( &lastMessageId, ( char * ) pBuffer + 2, sizeof( lastMessageId ) );
+    return bytesToSend;
+}
+
 /**
  * @brief Mocked udp recv returning SUCCESS response from the server.
  */
@@ -60,6 +76,11 @@ int udp_recv_mock_success( OSNetwork_t osnetwork,
     return bytesToRecv;
 }
 
+/**
+ * @brief Responses returned by udp_recv_mock_failure.
+ */
+int failureResponses = 0;
+
 /**
  * @brief Mocked udp recv returning FAILURE response from the server.
  */
@@ -67,8 +88,11 @@ int udp_recv_mock_failure( OSNetwork_t osnetwork,
                            void * pBuffer,
                            size_t bytesToRecv )
 {
-    bytesToRecv = strlen( SAMPLE_RESPONSE_FAILURE );
-    memcpy( pBuffer, SAMPLE_RESPONSE_FAILURE, strlen( SAMPLE_RESPONSE_FAILURE ) );
+    failureResponses++;
+
+    /* Binary response without terminator, strlen would read past it. */
+    bytesToRecv = sizeof( SAMPLE_RESPONSE_FAILURE );
+    memcpy( pBuffer, SAMPLE_RESPONSE_FAILURE, sizeof( SAMPLE_RESPONSE_FAILURE ) );
     return bytesToRecv;
 }
 
@@ -83,6 +107,7 @@ int udp_disconnect_mock( OSNetwork_t osnetwork )
 
 void setUp( void )
 {
+    failureResponses = 0;
 }
 
 
@@ -126,7 +151,8 @@ void test_os_auth_connect_failure( void )
 }
 
 /**
- * @brief Test 3 ( failed authentication due to missing security credentials ).
+ * @brief Test 3 ( failed authentication, the server answers 4.04 Not Found:
+ * not retried ).
  */
 void test_os_auth_failure_response( void )
 {
@@ -139,7 +165,8 @@ void test_os_auth_failure_response( void )
         .nce_os_udp_disconnect = udp_disconnect_mock
     };
 
-    TEST_ASSERT_EQUAL_INT( os_auth( &osNetwork, &nceKey ), NCE_SDK_PARSING_ERROR );
+    TEST_ASSERT_EQUAL_INT( os_auth( &osNetwork, &nceKey ), NCE_SDK_CLIENT_ERROR );
+    TEST_ASSERT_EQUAL_INT( 1, failureResponses );
 }
 
 
@@ -175,3 +202,48 @@ void test_os_energy_save_failure( void )
     TEST_ASSERT_EQUAL_INT( os_energy_save( pcTransmittedString, selector, 2, software_version ), NCE_SDK_BINARY_PAYLOAD_ERROR );
 }
 
+/**
+ * @brief Test 6 ( each context keeps its own message ID sequence ).
+ */
+void test_os_auth_ctx_independent_message_ids( void )
+{
+    os_network_ops_t osNetwork =
+    {
+        .os_socket             = &xOSNetwork,
+        .nce_os_udp_connect    = udp_connect_mock_success,
+        .nce_os_udp_send       = udp_send_mock_capture,
+        .nce_os_udp_recv       = udp_recv_mock_success,
+        .nce_os_udp_disconnect = udp_disconnect_mock
+    };
+    nce_context_t deviceA;
+    nce_context_t deviceB;
+
+    os_context_init( &deviceA, &osNetwork );
+    os_context_init( &deviceB, &osNetwork );
+
+    TEST_ASSERT_EQUAL_INT( os_auth_ctx( &deviceA, &nceKey ), NCE_SDK_SUCCESS );
+    TEST_ASSERT_EQUAL_UINT16( NCE_SDK_INITIAL_MESSAGE_ID + 1, lastMessageId );
+    TEST_ASSERT_EQUAL_INT( os_auth_ctx( &deviceA, &nceKey ), NCE_SDK_SUCCESS );
+    TEST_ASSERT_EQUAL_UINT16( NCE_SDK_INITIAL_MESSAGE_ID + 2, lastMessageId );
+    TEST_ASSERT_EQUAL_INT( os_auth_ctx( &deviceB, &nceKey ), NCE_SDK_SUCCESS );
+    TEST_ASSERT_EQUAL_UINT16( NCE_SDK_INITIAL_MESSAGE_ID + 1, lastMessageId );
+}
+
+/**
+ * @brief Test 7 ( the v1 binary conversion keeps its one-byte integer check, whatever the template length ).
+ */
+void test_os_energy_save_one_byte_check( void )
+{
+    Element2byte_gen_t level = { .type = E_INTEGER, .value.i = 100, .template_length = 1 };
+    uint8_t selector = 1;
+    char pcTransmittedString[ 50 ];
+
+    TEST_ASSERT_EQUAL_INT( os_energy_save( pcTransmittedString, selector, 1, level ), 2 );
+
+    level.template_length = 2;
+    TEST_ASSERT_EQUAL_INT( os_energy_save( pcTransmittedString, selector, 1, level ), 3 );
+
+    /* Fits two bytes, but not one. */
+    level.value.i = 300;
+    TEST_ASSERT_EQUAL_INT( os_energy_save( pcTransmittedString, selector, 1, level ), NCE_SDK_BINARY_PAYLOAD_ERROR );
+}
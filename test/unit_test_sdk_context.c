@@ -0,0 +1,135 @@
+#include "unity.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "nce_iot_c_sdk.h"
+#include "network_interface_linux.h"
+#include "nce_standin.h"
+
+/* Number of simulated devices onboarded by the stress test */
+#define STRESS_DEVICES    1000
+
+/* Number of worker threads sharing the devices */
+#define STRESS_THREADS    16
+
+/**
+ * @brief One simulated device, owning all of its SDK state.
+ */
+typedef struct device
+{
+    struct OSNetwork network;
+    os_network_ops_t ops;
+    nce_context_t ctx;
+    DtlsKey_t key;
+    int status;
+} device_t;
+
+static device_t devices[ STRESS_DEVICES ];
+static char * identities[ STRESS_DEVICES ];
+static nce_standin_t standin;
+static OSEndPoint_t standinEndpoint = { "127.0.0.1", 0 };
+static pthread_mutex_t nextDeviceLock = PTHREAD_MUTEX_INITIALIZER;
+static int nextDevice = 0;
+
+/**
+ * @brief Take the index of the next device to onboard, -1 when all are done.
+ */
+static int take_next_device( void )
+{
+    int index;
+
+    pthread_mutex_lock( &nextDeviceLock );
+    index = ( nextDevice < STRESS_DEVICES ) ? nextDevice++ : -1;
+    pthread_mutex_unlock( &nextDeviceLock );
+
+    return index;
+}
+
+/**
+ * @brief Thread pool worker onboarding devices until none are left.
+ */
+static void * onboard_worker( void * arg )
+{
+    int index;
+
+    ( void ) arg;
+
+    while( ( index = take_next_device() ) >= 0 )
+    {
+        device_t * device = &devices[ index ];
+
+        device->ops.os_socket = &device->network;
+        device->ops.nce_os_udp_connect = nce_os_connect;
+        device->ops.nce_os_udp_send = nce_os_send;
+        device->ops.nce_os_udp_recv = nce_os_recv;
+        device->ops.nce_os_udp_disconnect = nce_os_disconnect;
+        os_context_init( &device->ctx, &device->ops );
+        device->ctx.onboardEndpoint = &standinEndpoint;
+        device->status = os_auth_ctx( &device->ctx, &device->key );
+    }
+
+    return NULL;
+}
+
+static int compare_strings( const void * a,
+                            const void * b )
+{
+    return strcmp( *( char * const * ) a, *( char * const * ) b );
+}
+
+void setUp( void )
+{
+    memset( devices, 0, sizeof( devices ) );
+    nextDevice = 0;
+    TEST_ASSERT_EQUAL_INT( 0, nce_standin_start( &standin ) );
+    standinEndpoint.port = standin.port;
+}
+
+void tearDown( void )
+{
+    nce_standin_stop( &standin );
+}
+
+/**
+ * @brief Onboard 1,000 devices concurrently, each with its own context.
+ */
+void test_os_auth_ctx_concurrent_devices( void )
+{
+    pthread_t workers[ STRESS_THREADS ];
+    int i;
+
+    for( i = 0; i < STRESS_THREADS; i++ )
+    {
+        TEST_ASSERT_EQUAL_INT( 0, pthread_create( &workers[ i ], NULL, onboard_worker, NULL ) );
+    }
+
+    for( i = 0; i < STRESS_THREADS; i++ )
+    {
+        pthread_join( workers[ i ], NULL );
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( STRESS_DEVICES, standin.onboarded );
+
+    for( i = 0; i < STRESS_DEVICES; i++ )
+    {
+        unsigned long identityNumber = 0;
+        unsigned long pskNumber = 0;
+
+        TEST_ASSERT_EQUAL_INT( NCE_SDK_SUCCESS, devices[ i ].status );
+
+        /* A device must receive the identity and PSK of the same exchange. */
+        TEST_ASSERT_EQUAL_INT( 1, sscanf( devices[ i ].key.PskIdentity, "8988%lu", &identityNumber ) );
+        TEST_ASSERT_EQUAL_INT( 1, sscanf( devices[ i ].key.Psk, "psk%lu", &pskNumber ) );
+        TEST_ASSERT_EQUAL_UINT32( identityNumber, pskNumber );
+        identities[ i ] = devices[ i ].key.PskIdentity;
+    }
+
+    /* No two devices may end up with the same credentials. */
+    qsort( identities, STRESS_DEVICES, sizeof( identities[ 0 ] ), compare_strings );
+
+    for( i = 1; i < STRESS_DEVICES; i++ )
+    {
+        TEST_ASSERT_TRUE( strcmp( identities[ i - 1 ], identities[ i ] ) != 0 );
+    }
+}
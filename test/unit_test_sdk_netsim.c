@@ -0,0 +1,183 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_netsim.h"
+
+/* Devices onboarded by the statistical tests */
+#define NETSIM_DEVICES       200
+
+/* One-way latency of the simulated link (NB-IoT like) */
+#define NETSIM_LATENCY_US    400000u
+
+/* Receive timeout of the simulated socket */
+#define NETSIM_TIMEOUT_US    2000000u
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_context_t ctx;
+static DtlsKey_t key;
+
+/**
+ * @brief Default link: no impairment besides latency.
+ */
+static nce_netsim_config_t link_config( uint32_t seed,
+                                        unsigned int lossPercent )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = seed;
+    config.lossPercent = lossPercent;
+    config.latencyUs = NETSIM_LATENCY_US;
+    config.recvTimeoutUs = NETSIM_TIMEOUT_US;
+
+    return config;
+}
+
+/**
+ * @brief Onboard one device over a fresh simulated link.
+ */
+static int onboard( const nce_netsim_config_t * config )
+{
+    nce_netsim_init( &sim, config, nce_netsim_onboard_responder, NULL, &ops );
+    os_context_init( &ctx, &ops );
+    memset( &key, 0, sizeof( key ) );
+
+    return os_auth_ctx( &ctx, &key );
+}
+
+/**
+ * @brief Onboard NETSIM_DEVICES devices and return the number of successes.
+ */
+static int onboard_fleet( unsigned int lossPercent,
+                          unsigned long * datagramsSent,
+                          uint64_t * totalUs )
+{
+    nce_netsim_config_t config;
+    int successes = 0;
+    uint32_t i;
+
+    *datagramsSent = 0;
+    *totalUs = 0;
+
+    for( i = 1; i <= NETSIM_DEVICES; i++ )
+    {
+        config = link_config( i, lossPercent );
+        successes += ( onboard( &config ) == NCE_SDK_SUCCESS ) ? 1 : 0;
+        *datagramsSent += sim.stats.datagramsSent;
+        *totalUs += sim.nowUs;
+    }
+
+    return successes;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: A clean link onboards with one request and one round trip.
+ */
+void test_netsim_clean_link_single_round_trip( void )
+{
+    nce_netsim_config_t config = link_config( 1, 0 );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( &config ) );
+    TEST_ASSERT_EQUAL_STRING( NCE_NETSIM_IDENTITY, key.PskIdentity );
+    TEST_ASSERT_EQUAL_STRING( NCE_NETSIM_PSK, key.Psk );
+    TEST_ASSERT_EQUAL( 1, sim.stats.datagramsSent );
+    TEST_ASSERT_EQUAL( 0, sim.stats.timeouts );
+    TEST_ASSERT_EQUAL( 2 * NETSIM_LATENCY_US, sim.nowUs );
+}
+
+/**
+ * @brief Test 2: A dead link fails after NCE_SDK_ATTEMPTS - 1 timed out
+ * requests instead of reporting success with empty credentials.
+ */
+void test_netsim_dead_link_fails_after_retries( void )
+{
+    nce_netsim_config_t config = link_config( 1, 100 );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, onboard( &config ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_ATTEMPTS - 1, sim.stats.datagramsSent );
+    TEST_ASSERT_EQUAL( NCE_SDK_ATTEMPTS - 1, sim.stats.timeouts );
+    TEST_ASSERT_EQUAL( ( NCE_SDK_ATTEMPTS - 1 ) * NETSIM_TIMEOUT_US, sim.nowUs );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+}
+
+/**
+ * @brief Test 3: The same seed replays the same run.
+ */
+void test_netsim_same_seed_same_run( void )
+{
+    nce_netsim_config_t config = link_config( 42, 40 );
+    nce_netsim_stats_t first;
+    uint64_t firstUs;
+
+    config.dupPercent = 10;
+    config.reorderPercent = 10;
+    config.jitterUs = 100000u;
+    onboard( &config );
+    first = sim.stats;
+    firstUs = sim.nowUs;
+    onboard( &config );
+
+    TEST_ASSERT_EQUAL_MEMORY( &first, &sim.stats, sizeof( first ) );
+    TEST_ASSERT_EQUAL( firstUs, sim.nowUs );
+}
+
+/**
+ * @brief Test 4: Duplicated and reordered responses still onboard.
+ */
+void test_netsim_duplication_and_reordering( void )
+{
+    nce_netsim_config_t config = link_config( 7, 0 );
+
+    config.dupPercent = 100;
+    config.reorderPercent = 50;
+    config.jitterUs = 200000u;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( &config ) );
+    TEST_ASSERT_EQUAL_STRING( NCE_NETSIM_IDENTITY, key.PskIdentity );
+    TEST_ASSERT_GREATER_THAN( 0, sim.stats.duplicated );
+}
+
+/**
+ * @brief Test 5: Bandwidth adds the serialization delay of both datagrams.
+ */
+void test_netsim_bandwidth_delay( void )
+{
+    nce_netsim_config_t config = link_config( 1, 0 );
+
+    config.bytesPerSecond = 100;
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( &config ) );
+    TEST_ASSERT_EQUAL( 2 * NETSIM_LATENCY_US +
+                       ( uint64_t ) ( sim.stats.bytesSent + sim.stats.bytesReceived ) * 10000u,
+                       sim.nowUs );
+}
+
+/**
+ * @brief Test 6: Retry budget at 20% loss per direction. A request
+ * succeeds with probability 0.64, so four attempts onboard ~98% of the
+ * devices with ~1.5 requests each. The bounds catch regressions in the
+ * retry loop (fewer attempts, extra requests or longer waits).
+ */
+void test_netsim_retry_budget_at_20_percent_loss( void )
+{
+    unsigned long datagramsSent;
+    uint64_t totalUs;
+    int successes = onboard_fleet( 20, &datagramsSent, &totalUs );
+
+    TEST_ASSERT_GREATER_OR_EQUAL( NETSIM_DEVICES * 95 / 100, successes );
+    TEST_ASSERT_LESS_OR_EQUAL( NETSIM_DEVICES * 17 / 10, datagramsSent );
+    TEST_ASSERT_LESS_OR_EQUAL( ( uint64_t ) NETSIM_DEVICES * 2500000u, totalUs );
+}
@@ -0,0 +1,210 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_netsim.h"
+
+/* PSK longer than the default NCE_SDK_PSK_MAX_LENGTH */
+#define LONG_PSK_LENGTH    ( NCE_SDK_PSK_MAX_LENGTH + 6 )
+
+static nce_netsim_t sim;
+static os_network_ops_v2_t ops;
+static nce_context_t ctx;
+static nce_dtls_key_t key;
+static uint8_t workspace[ NCE_SDK_AUTH_WORKSPACE_SIZE ];
+static int ( * simConnect )( OSNetwork_t, OSEndPoint_t );
+static const OSEndPoint_t * connectedEndpoint;
+static size_t identityLength;
+static size_t pskLength;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief v2 connect: records the endpoint pointer it was given.
+ */
+static int connect_v2( OSNetwork_t osnetwork,
+                       const OSEndPoint_t * endpoint )
+{
+    connectedEndpoint = endpoint;
+
+    return simConnect( osnetwork, *endpoint );
+}
+
+/**
+ * @brief Device Authenticator answering with an identity of identityLength
+ * bytes, the netsim one padded with '0', and a PSK of pskLength bytes.
+ */
+static size_t sized_responder( void * arg,
+                               const uint8_t * request,
+                               size_t requestLength,
+                               uint8_t * response,
+                               size_t responseSize )
+{
+    size_t length = 5 + identityLength + 1 + pskLength;
+
+    ( void ) arg;
+
+    if( ( requestLength < 4 ) || ( responseSize < length ) )
+    {
+        return 0;
+    }
+
+    response[ 0 ] = 0x50;
+    response[ 1 ] = 0x45;
+    response[ 2 ] = request[ 2 ];
+    response[ 3 ] = request[ 3 ];
+    response[ 4 ] = 0xFF;
+    memset( &response[ 5 ], '0', identityLength );
+    memcpy( &response[ 5 ], NCE_NETSIM_IDENTITY,
+            ( identityLength < strlen( NCE_NETSIM_IDENTITY ) ) ? identityLength : strlen( NCE_NETSIM_IDENTITY ) );
+    response[ 5 + identityLength ] = ',';
+    memset( &response[ 6 + identityLength ], 'k', pskLength );
+
+    return length;
+}
+
+/**
+ * @brief Fresh link and v2 context, the v1 connect left unset.
+ */
+static void init_link( nce_netsim_responder_t responder )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1u;
+    config.latencyUs = 100000u;
+    config.recvTimeoutUs = 2000000u;
+    nce_netsim_init( &sim, &config, responder, NULL, &ops.base );
+    simConnect = ops.base.nce_os_udp_connect;
+    ops.base.nce_os_udp_connect = NULL;
+    ops.nce_os_udp_connect_v2 = connect_v2;
+    os_context_init_v2( &ctx, &ops );
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    memset( &key, 0xA5, sizeof( key ) );
+    connectedEndpoint = NULL;
+    identityLength = strlen( NCE_NETSIM_IDENTITY );
+    pskLength = LONG_PSK_LENGTH;
+    init_link( nce_netsim_onboard_responder );
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Onboarding through the v2 API stores length-prefixed
+ * credentials and hands the endpoint to the port by pointer.
+ */
+void test_auth_v2_length_prefixed_credentials( void )
+{
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_v2( &ctx, &key, workspace, sizeof( workspace ) ) );
+
+    TEST_ASSERT_EQUAL( strlen( NCE_NETSIM_IDENTITY ), key.identityLength );
+    TEST_ASSERT_EQUAL_MEMORY( NCE_NETSIM_IDENTITY, key.identity, key.identityLength );
+    TEST_ASSERT_EQUAL( strlen( NCE_NETSIM_PSK ), key.pskLength );
+    TEST_ASSERT_EQUAL_MEMORY( NCE_NETSIM_PSK, key.psk, key.pskLength );
+    TEST_ASSERT_EQUAL_PTR( ctx.onboardEndpoint, connectedEndpoint );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+}
+
+/**
+ * @brief Test 2: A missing or too small workspace is rejected before any
+ * traffic, the smallest one holds credentials of the maximum lengths.
+ */
+void test_auth_v2_workspace_checked( void )
+{
+    uint8_t expected[ NCE_SDK_PSK_MAX_LENGTH ];
+
+    TEST_ASSERT_EQUAL( NCE_SDK_WORKSPACE_ERROR, os_auth_v2( &ctx, &key, NULL, sizeof( workspace ) ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_WORKSPACE_ERROR, os_auth_v2( &ctx, &key, workspace, NCE_SDK_AUTH_WORKSPACE_MIN - 1 ) );
+    TEST_ASSERT_EQUAL( 0, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 0, sim.stats.datagramsSent );
+
+    identityLength = NCE_SDK_PSK_IDENTITY_MAX_LENGTH;
+    pskLength = NCE_SDK_PSK_MAX_LENGTH;
+    init_link( sized_responder );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_v2( &ctx, &key, workspace, NCE_SDK_AUTH_WORKSPACE_MIN ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_PSK_IDENTITY_MAX_LENGTH, key.identityLength );
+    TEST_ASSERT_EQUAL( NCE_SDK_PSK_MAX_LENGTH, key.pskLength );
+    memset( expected, 'k', sizeof( expected ) );
+    TEST_ASSERT_EQUAL_MEMORY( expected, key.psk, NCE_SDK_PSK_MAX_LENGTH );
+}
+
+/**
+ * @brief Test 3: A PSK longer than NCE_SDK_PSK_MAX_LENGTH is a parsing error,
+ * while the v1 API, with its fixed 100-byte strings, still accepts it.
+ */
+void test_auth_v2_psk_exceeding_maximum( void )
+{
+    DtlsKey_t legacyKey;
+
+    init_link( sized_responder );
+    TEST_ASSERT_EQUAL( NCE_SDK_PARSING_ERROR, os_auth_v2( &ctx, &key, workspace, sizeof( workspace ) ) );
+
+    init_link( sized_responder );
+    ops.base.nce_os_udp_connect = simConnect;
+    os_context_init( &ctx, &ops.base );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, os_auth_ctx( &ctx, &legacyKey ) );
+    TEST_ASSERT_EQUAL( LONG_PSK_LENGTH, strlen( legacyKey.Psk ) );
+    TEST_ASSERT_EQUAL_STRING( NCE_NETSIM_IDENTITY, legacyKey.PskIdentity );
+}
+
+/**
+ * @brief Test 4: The v2 Energy Saver builds the same packet as the v1 one,
+ * refuses a packet buffer too small and integers beyond their template length.
+ */
+void test_energy_save_v2_matches_v1( void )
+{
+    Element2byte_gen_t elements[ 2 ] = { { E_INTEGER, { 0 }, 1 }, { E_CHAR, { 0 }, 1 } };
+    char legacy[ 16 ];
+    uint8_t packet[ 16 ];
+    int length;
+
+    elements[ 0 ].value.i = 87;
+    elements[ 1 ].value.c = 'A';
+    length = os_energy_save( legacy, 3, 2, elements[ 0 ], elements[ 1 ] );
+
+    TEST_ASSERT_EQUAL( 3, length );
+    TEST_ASSERT_EQUAL( length, os_energy_save_v2( packet, sizeof( packet ), 3, elements, 2 ) );
+    TEST_ASSERT_EQUAL_MEMORY( legacy, packet, length );
+    TEST_ASSERT_EQUAL( NCE_SDK_BINARY_PAYLOAD_ERROR, os_energy_save_v2( packet, 2, 3, elements, 2 ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_BINARY_PAYLOAD_ERROR, os_energy_save_v2( packet, sizeof( packet ), 3, elements, 0 ) );
+
+    /* 300 does not fit a one-byte template. */
+    elements[ 0 ].value.i = 300;
+    TEST_ASSERT_EQUAL( NCE_SDK_BINARY_PAYLOAD_ERROR, os_energy_save_v2( packet, sizeof( packet ), 3, elements, 2 ) );
+
+    /* It fits two bytes, 40000 does not. */
+    elements[ 0 ].template_length = 2;
+    TEST_ASSERT_EQUAL( 4, os_energy_save_v2( packet, sizeof( packet ), 3, elements, 2 ) );
+    TEST_ASSERT_EQUAL_MEMORY( &elements[ 0 ].value.i, &packet[ 1 ], 2 );
+    elements[ 0 ].value.i = 40000;
+    TEST_ASSERT_EQUAL( NCE_SDK_BINARY_PAYLOAD_ERROR, os_energy_save_v2( packet, sizeof( packet ), 3, elements, 2 ) );
+}
+
+/**
+ * @brief Test 5: A response filling the buffer may have been cut, so it is
+ * a parsing error after one request instead of a truncated PSK.
+ */
+void test_auth_response_filling_buffer( void )
+{
+    DtlsKey_t legacyKey;
+
+    /* 149 bytes fill the 150-byte buffer of the v1 call, less its
+     * terminator, while both fields fit its strings. */
+    identityLength = 50;
+    pskLength = 149 - 6 - identityLength;
+    init_link( sized_responder );
+    ops.base.nce_os_udp_connect = simConnect;
+    os_context_init( &ctx, &ops.base );
+    TEST_ASSERT_EQUAL( NCE_SDK_PARSING_ERROR, os_auth_ctx( &ctx, &legacyKey ) );
+    TEST_ASSERT_EQUAL( 1, sim.stats.datagramsSent );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+}
@@ -0,0 +1,231 @@
+#include "unity.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_spsc_queue.h"
+
+/* Records pushed by the stress test producer */
+#define STRESS_RECORDS    2000000u
+
+/* Most records the stress test consumer drains at once */
+#define STRESS_BATCH      5u
+
+/**
+ * @brief What the consumer has seen.
+ */
+typedef struct drained_records
+{
+    size_t count;
+    uint32_t lastSeq;
+    uint32_t skipped;
+    int corrupted;
+    uint8_t last[ NCE_SDK_SPSC_RECORD_SIZE ];
+    size_t lastLength;
+} drained_records_t;
+
+static nce_spsc_queue_t queue;
+static drained_records_t drained;
+static volatile int producerDone;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Record number seq: the number followed by a pattern, 4 to 35 bytes.
+ */
+static size_t make_record( uint32_t seq,
+                           uint8_t * record )
+{
+    size_t length = 4u + seq % 32u;
+    size_t i;
+
+    memcpy( record, &seq, sizeof( seq ) );
+
+    for( i = sizeof( seq ); i < length; i++ )
+    {
+        record[ i ] = ( uint8_t ) ( seq + i );
+    }
+
+    return length;
+}
+
+/**
+ * @brief Consumer handler checking the records and their order.
+ */
+static void check_record( void * arg,
+                          const uint8_t * record,
+                          size_t length )
+{
+    drained_records_t * seen = ( drained_records_t * ) arg;
+    uint8_t expected[ NCE_SDK_SPSC_RECORD_SIZE ];
+    uint32_t seq;
+
+    memcpy( &seq, record, sizeof( seq ) );
+
+    if( ( seq <= seen->lastSeq ) || ( make_record( seq, expected ) != length ) ||
+        ( memcmp( expected, record, length ) != 0 ) )
+    {
+        seen->corrupted++;
+    }
+
+    /* Records rejected as overflows leave gaps in the sequence. */
+    seen->skipped += seq - seen->lastSeq - 1u;
+    seen->lastSeq = seq;
+    seen->count++;
+}
+
+/**
+ * @brief Consumer handler keeping a copy of the last record.
+ */
+static void copy_record( void * arg,
+                         const uint8_t * record,
+                         size_t length )
+{
+    drained_records_t * seen = ( drained_records_t * ) arg;
+
+    memcpy( seen->last, record, length );
+    seen->lastLength = length;
+    seen->count++;
+}
+
+/**
+ * @brief Stress test producer: pushes without ever waiting, like an ISR.
+ */
+static void * producer( void * arg )
+{
+    uint8_t record[ NCE_SDK_SPSC_RECORD_SIZE ];
+    uint32_t seq;
+
+    ( void ) arg;
+
+    for( seq = 1; seq <= STRESS_RECORDS; seq++ )
+    {
+        ( void ) nce_spsc_queue_push( &queue, record, make_record( seq, record ) );
+    }
+
+    __atomic_store_n( &producerDone, 1, __ATOMIC_RELEASE );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_spsc_queue_init( &queue );
+    memset( &drained, 0, sizeof( drained ) );
+    producerDone = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Records come out in order and intact across many wraps of
+ * the indices, in batches of at most maxRecords.
+ */
+void test_spsc_queue_order_and_batches( void )
+{
+    uint8_t record[ NCE_SDK_SPSC_RECORD_SIZE ];
+    uint32_t seq = 1;
+    int round;
+    int i;
+
+    for( round = 0; round < 100; round++ )
+    {
+        for( i = 0; i < 11; i++, seq++ )
+        {
+            TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_SUCCESS, nce_spsc_queue_push( &queue, record, make_record( seq, record ) ) );
+        }
+
+        TEST_ASSERT_EQUAL( 4, nce_spsc_queue_drain( &queue, check_record, &drained, 4 ) );
+        TEST_ASSERT_EQUAL( 7, nce_spsc_queue_drain( &queue, check_record, &drained, 0 ) );
+        TEST_ASSERT_EQUAL( 0, nce_spsc_queue_drain( &queue, check_record, &drained, 0 ) );
+    }
+
+    TEST_ASSERT_EQUAL( 1100, drained.count );
+    TEST_ASSERT_EQUAL( 1100, drained.lastSeq );
+    TEST_ASSERT_EQUAL( 0, drained.skipped );
+    TEST_ASSERT_EQUAL( 0, drained.corrupted );
+}
+
+/**
+ * @brief Test 2: A full queue rejects records and counts them, too large
+ * records are refused without being counted.
+ */
+void test_spsc_queue_overflow( void )
+{
+    uint8_t record[ NCE_SDK_SPSC_RECORD_SIZE + 1 ];
+    uint32_t seq;
+
+    for( seq = 1; seq <= NCE_SDK_SPSC_SLOTS; seq++ )
+    {
+        TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_SUCCESS, nce_spsc_queue_push( &queue, record, make_record( seq, record ) ) );
+    }
+
+    TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_FULL, nce_spsc_queue_push( &queue, record, make_record( seq, record ) ) );
+    TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_FULL, nce_spsc_queue_push( &queue, record, make_record( seq, record ) ) );
+    TEST_ASSERT_EQUAL( 2, nce_spsc_queue_overflows( &queue ) );
+    TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_RECORD_SIZE_ERROR, nce_spsc_queue_push( &queue, record, sizeof( record ) ) );
+    TEST_ASSERT_EQUAL( 2, nce_spsc_queue_overflows( &queue ) );
+
+    TEST_ASSERT_EQUAL( 1, nce_spsc_queue_drain( &queue, check_record, &drained, 1 ) );
+    TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_SUCCESS, nce_spsc_queue_push( &queue, record, make_record( seq, record ) ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_SPSC_SLOTS, nce_spsc_queue_drain( &queue, check_record, &drained, 0 ) );
+    TEST_ASSERT_EQUAL( 0, drained.corrupted );
+}
+
+/**
+ * @brief Test 3: An Energy Saver packet pushed by the sampling context is
+ * handed over unchanged.
+ */
+void test_spsc_queue_energy_saver_record( void )
+{
+    Element2byte_gen_t battery = { E_INTEGER, { 0 }, 1 };
+    Element2byte_gen_t temperature = { E_FLOAT, { 0 }, 4 };
+    char packet[ NCE_SDK_MAX_STRING_SIZE ];
+    int length;
+
+    battery.value.i = 99;
+    temperature.value.f = 21.5f;
+    length = os_energy_save( packet, 1, 2, battery, temperature );
+    TEST_ASSERT_GREATER_THAN( 0, length );
+
+    TEST_ASSERT_EQUAL( NCE_SPSC_QUEUE_SUCCESS, nce_spsc_queue_push( &queue, packet, ( size_t ) length ) );
+    TEST_ASSERT_EQUAL( 1, nce_spsc_queue_drain( &queue, copy_record, &drained, 0 ) );
+    TEST_ASSERT_EQUAL( length, drained.lastLength );
+    TEST_ASSERT_EQUAL_MEMORY( packet, drained.last, ( size_t ) length );
+}
+
+/**
+ * @brief Test 4: With a producer thread pushing as fast as it can and the
+ * consumer draining small batches, every record arrives intact and in order
+ * or is counted as an overflow.
+ */
+void test_spsc_queue_threaded_stress( void )
+{
+    pthread_t thread;
+    int done = 0;
+
+    TEST_ASSERT_EQUAL( 0, pthread_create( &thread, NULL, producer, NULL ) );
+
+    while( !done )
+    {
+        /* Read the flag first: records pushed before it are drained below. */
+        done = __atomic_load_n( &producerDone, __ATOMIC_ACQUIRE );
+
+        while( nce_spsc_queue_drain( &queue, check_record, &drained, STRESS_BATCH ) > 0u )
+        {
+        }
+    }
+
+    pthread_join( thread, NULL );
+
+    TEST_ASSERT_EQUAL( 0, drained.corrupted );
+    TEST_ASSERT_GREATER_THAN( 0, drained.count );
+    TEST_ASSERT_EQUAL( STRESS_RECORDS, drained.count + nce_spsc_queue_overflows( &queue ) );
+    TEST_ASSERT_EQUAL( nce_spsc_queue_overflows( &queue ), drained.skipped + ( STRESS_RECORDS - drained.lastSeq ) );
+}
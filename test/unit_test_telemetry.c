@@ -0,0 +1,339 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_telemetry.h"
+#include "nce_netsim.h"
+
+/* Requests recorded by the responder */
+#define RECORDED_REQUESTS    8
+
+static nce_netsim_t sim;
+static os_network_ops_t ops;
+static nce_telemetry_t telemetry;
+static nce_telemetry_message_t message;
+static uint8_t requests[ RECORDED_REQUESTS ][ NCE_SDK_TELEMETRY_BUFFER_SIZE ];
+static size_t requestLengths[ RECORDED_REQUESTS ];
+static int requestCount;
+static int ignored;
+static uint8_t codes[ 2 ];
+static int waits;
+static uint32_t waitedMs;
+
+static const OSEndPoint_t endpoint = { "coap.os.1nce.com", 5683 };
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Virtual clock of the link, read by the SDK core.
+ */
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+/**
+ * @brief Remote recording the requests, ignoring the next ones, answering a
+ * confirmable request with codes[ 0 ] (a 5.03 with a Max-Age of 3 s), then
+ * codes[ 1 ]. Non-confirmable requests get no response.
+ */
+static size_t recording_responder( void * arg,
+                                   const uint8_t * request,
+                                   size_t requestLength,
+                                   uint8_t * response,
+                                   size_t responseSize )
+{
+    ( void ) arg;
+    ( void ) responseSize;
+
+    if( requestCount < RECORDED_REQUESTS )
+    {
+        memcpy( requests[ requestCount ], request, requestLength );
+        requestLengths[ requestCount ] = requestLength;
+    }
+
+    requestCount++;
+
+    if( ignored > 0 )
+    {
+        ignored--;
+        return 0;
+    }
+
+    if( request[ 0 ] != 0x40u )
+    {
+        return 0;
+    }
+
+    response[ 0 ] = 0x60;
+    response[ 1 ] = codes[ 0 ];
+    response[ 2 ] = request[ 2 ];
+    response[ 3 ] = request[ 3 ];
+
+    if( codes[ 1 ] != 0u )
+    {
+        codes[ 0 ] = codes[ 1 ];
+        codes[ 1 ] = 0;
+    }
+
+    if( response[ 1 ] == 0xA3u )
+    {
+        /* Max-Age (14) of 3 s */
+        response[ 4 ] = 0xD1;
+        response[ 5 ] = 0x01;
+        response[ 6 ] = 0x03;
+        return 7;
+    }
+
+    return 4;
+}
+
+static void virtual_delay( uint32_t ms )
+{
+    sim.nowUs += ( uint64_t ) ms * 1000u;
+    waits++;
+    waitedMs += ms;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    nce_netsim_config_t config;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 1;
+    config.latencyUs = 100000u;
+    config.recvTimeoutUs = 2000000u;
+    nce_netsim_init( &sim, &config, recording_responder, NULL, &ops );
+    nce_telemetry_init( &telemetry, &ops, &endpoint );
+    telemetry.delayMs = virtual_delay;
+
+    memset( &message, 0, sizeof( message ) );
+    message.confirmable = true;
+    message.path = "v1/data";
+    message.contentFormat = NCE_TELEMETRY_NO_FORMAT;
+    message.payload = "21.5";
+    message.payloadLength = 4;
+
+    requestCount = 0;
+    ignored = 0;
+    codes[ 0 ] = 0x44;
+    codes[ 1 ] = 0;
+    waits = 0;
+    waitedMs = 0;
+}
+
+void tearDown( void )
+{
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: A non-confirmable message is one datagram with its options
+ * in order, sent without waiting for a response.
+ */
+void test_telemetry_non_one_datagram( void )
+{
+    static const uint8_t options[] =
+    {
+        0xB2, 'v', '1', 0x04, 'd', 'a', 't', 'a', 0x10,
+        0x39, 't', '=', 's', 'e', 'n', 's', 'o', 'r', 's',
+        0xFF, '2', '1', '.', '5'
+    };
+
+    message.confirmable = false;
+    message.path = "/v1/data";
+    message.query = "t=sensors";
+    message.contentFormat = 0;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_TRUE( sim.nowUs == 0u );
+    TEST_ASSERT_EQUAL( 0, sim.stats.timeouts );
+    TEST_ASSERT_EQUAL( 1, requestCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x50, requests[ 0 ][ 0 ] );
+    TEST_ASSERT_EQUAL_HEX8( NCE_TELEMETRY_POST, requests[ 0 ][ 1 ] );
+    TEST_ASSERT_EQUAL( 4 + sizeof( options ), requestLengths[ 0 ] );
+    TEST_ASSERT_EQUAL_MEMORY( options, &requests[ 0 ][ 4 ], sizeof( options ) );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.nonConfirmable );
+    TEST_ASSERT_EQUAL( requestLengths[ 0 ], telemetry.stats.bytesSent );
+}
+
+/**
+ * @brief Test 2: Confirmable and non-confirmable messages share one
+ * connection, each with a new message ID and its own method.
+ */
+void test_telemetry_session_reused( void )
+{
+    int i;
+
+    for( i = 0; i < 3; i++ )
+    {
+        message.confirmable = ( i != 1 );
+        message.method = ( i == 2 ) ? NCE_TELEMETRY_PUT : 0u;
+        TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    }
+
+    TEST_ASSERT_EQUAL( 1, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 3, requestCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x44, telemetry.code );
+    TEST_ASSERT_EQUAL_HEX8( NCE_TELEMETRY_PUT, requests[ 2 ][ 1 ] );
+    TEST_ASSERT_FALSE( requests[ 0 ][ 3 ] == requests[ 1 ][ 3 ] );
+    TEST_ASSERT_FALSE( requests[ 1 ][ 3 ] == requests[ 2 ][ 3 ] );
+    TEST_ASSERT_EQUAL( 2, telemetry.stats.confirmable );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.nonConfirmable );
+
+    nce_telemetry_close( &telemetry );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+}
+
+/**
+ * @brief Test 3: A lost confirmable message is sent again with the same
+ * message ID.
+ */
+void test_telemetry_lost_con_retransmitted( void )
+{
+    ignored = 1;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 2, requestCount );
+    TEST_ASSERT_EQUAL( requestLengths[ 0 ], requestLengths[ 1 ] );
+    TEST_ASSERT_EQUAL_MEMORY( requests[ 0 ], requests[ 1 ], requestLengths[ 0 ] );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.retransmissions );
+    TEST_ASSERT_EQUAL( 1, waits );
+}
+
+/**
+ * @brief Test 4: A 4.xx response ends the message without a retry.
+ */
+void test_telemetry_client_error_not_retried( void )
+{
+    codes[ 0 ] = 0x80;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_CLIENT_ERROR, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 1, requestCount );
+    TEST_ASSERT_EQUAL_HEX8( 0x80, telemetry.code );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.failed );
+    TEST_ASSERT_EQUAL( 1, sim.connected );
+}
+
+/**
+ * @brief Test 5: After a 5.03, the message is sent again as a new request
+ * once the Max-Age has passed.
+ */
+void test_telemetry_unavailable_waits_max_age( void )
+{
+    codes[ 0 ] = 0xA3;
+    codes[ 1 ] = 0x44;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 2, requestCount );
+    TEST_ASSERT_EQUAL_UINT32( 3000u, waitedMs );
+    TEST_ASSERT_FALSE( ( requests[ 0 ][ 2 ] == requests[ 1 ][ 2 ] ) && ( requests[ 0 ][ 3 ] == requests[ 1 ][ 3 ] ) );
+    TEST_ASSERT_EQUAL_MEMORY( &requests[ 0 ][ 4 ], &requests[ 1 ][ 4 ], requestLengths[ 0 ] - 4u );
+}
+
+/**
+ * @brief Test 6: A confirmable message without any response closes the
+ * connection, the next message opens a new one.
+ */
+void test_telemetry_silent_endpoint_reconnects( void )
+{
+    ignored = NCE_SDK_TELEMETRY_ATTEMPTS;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( NCE_SDK_TELEMETRY_ATTEMPTS, requestCount );
+    TEST_ASSERT_EQUAL( 0, sim.connected );
+    TEST_ASSERT_FALSE( telemetry.connected );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 2, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 2, telemetry.stats.connects );
+}
+
+/**
+ * @brief Test 7: A message larger than the request buffer is refused before
+ * any traffic.
+ */
+void test_telemetry_oversized_refused( void )
+{
+    static const uint8_t payload[ NCE_SDK_TELEMETRY_BUFFER_SIZE ] = { 0 };
+
+    message.payload = payload;
+    message.payloadLength = sizeof( payload );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SEND_ERROR, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 0, sim.stats.connects );
+    TEST_ASSERT_EQUAL( 0, sim.stats.datagramsSent );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.failed );
+}
+
+/**
+ * @brief Test 8: The No-Response option follows the other options, with the
+ * suppressed classes as value.
+ */
+void test_telemetry_no_response_option( void )
+{
+    static const uint8_t options[] = { 0xB2, 'v', '1', 0x04, 'd', 'a', 't', 'a', 0xD1, 234, 0x1A, 0xFF };
+
+    message.confirmable = false;
+    message.noResponse = NCE_TELEMETRY_NO_RESPONSE_ALL;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 4 + sizeof( options ) + 4, requestLengths[ 0 ] );
+    TEST_ASSERT_EQUAL_MEMORY( options, &requests[ 0 ][ 4 ], sizeof( options ) );
+
+    /* 2.xx and 5.xx: 0x12 */
+    message.noResponse = NCE_TELEMETRY_NO_RESPONSE_2XX | NCE_TELEMETRY_NO_RESPONSE_5XX;
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x12, requests[ 1 ][ 4 + sizeof( options ) - 2 ] );
+}
+
+/**
+ * @brief Test 9: In the hybrid mode, every Nth non-confirmable message is
+ * sent confirmable, without No-Response.
+ */
+void test_telemetry_hybrid_acknowledges_every_nth( void )
+{
+    int i;
+
+    telemetry.ackInterval = 4;
+    message.confirmable = false;
+    message.noResponse = NCE_TELEMETRY_NO_RESPONSE_ALL;
+
+    for( i = 0; i < 8; i++ )
+    {
+        TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+        TEST_ASSERT_EQUAL_HEX8( ( ( i % 4 ) == 3 ) ? 0x40 : 0x50, requests[ i ][ 0 ] );
+    }
+
+    TEST_ASSERT_EQUAL( requestLengths[ 0 ] - 3u, requestLengths[ 3 ] );
+    TEST_ASSERT_EQUAL( 2, telemetry.stats.probes );
+    TEST_ASSERT_EQUAL( 0, telemetry.stats.probesFailed );
+    TEST_ASSERT_EQUAL( 2, telemetry.stats.confirmable );
+    TEST_ASSERT_EQUAL( 6, telemetry.stats.nonConfirmable );
+    TEST_ASSERT_EQUAL( 0, telemetry.unacknowledged );
+    TEST_ASSERT_EQUAL( 2, sim.stats.datagramsReceived );
+}
+
+/**
+ * @brief Test 10: A hybrid probe without response is reported, and the next
+ * message probes again.
+ */
+void test_telemetry_hybrid_failed_probe_repeated( void )
+{
+    telemetry.ackInterval = 2;
+    message.confirmable = false;
+    message.noResponse = NCE_TELEMETRY_NO_RESPONSE_ALL;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    ignored = NCE_SDK_TELEMETRY_ATTEMPTS;
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.probesFailed );
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, nce_telemetry_send( &telemetry, &message ) );
+    TEST_ASSERT_EQUAL_HEX8( 0x40, requests[ 1 + NCE_SDK_TELEMETRY_ATTEMPTS ][ 0 ] );
+    TEST_ASSERT_EQUAL( 2, telemetry.stats.probes );
+    TEST_ASSERT_EQUAL( 1, telemetry.stats.probesFailed );
+}
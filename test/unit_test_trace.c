@@ -0,0 +1,163 @@
+#include "unity.h"
+#include <stdint.h>
+#include <string.h>
+#include "nce_iot_c_sdk.h"
+#include "nce_trace.h"
+#include "nce_netsim.h"
+
+/* One-way latency of the simulated link */
+#define TRACE_LATENCY_US    250000u
+
+/* Most events recorded by a test */
+#define TRACE_MAX_EVENTS    64
+
+static nce_trace_event_t events[ TRACE_MAX_EVENTS ];
+static int eventCount;
+static nce_netsim_t sim;
+
+/**
+ * @brief Clock of the spans: the virtual time of the simulated link.
+ */
+uint32_t nce_os_clock_us( void )
+{
+    return ( uint32_t ) sim.nowUs;
+}
+
+/**
+ * @brief Sink recording the events.
+ */
+static void record_event( void * arg,
+                          const nce_trace_event_t * event )
+{
+    ( void ) arg;
+
+    if( eventCount < TRACE_MAX_EVENTS )
+    {
+        events[ eventCount++ ] = *event;
+    }
+}
+
+/**
+ * @brief Onboard one device over a simulated link.
+ */
+static int onboard( unsigned int lossPercent )
+{
+    nce_netsim_config_t config;
+    os_network_ops_t ops;
+    nce_context_t ctx;
+    DtlsKey_t key;
+
+    memset( &config, 0, sizeof( config ) );
+    config.seed = 5;
+    config.lossPercent = lossPercent;
+    config.latencyUs = TRACE_LATENCY_US;
+    config.recvTimeoutUs = 1000000u;
+    nce_netsim_init( &sim, &config, nce_netsim_onboard_responder, NULL, &ops );
+    os_context_init( &ctx, &ops );
+
+    return os_auth_ctx( &ctx, &key );
+}
+
+/**
+ * @brief Index of the n-th event with a name and phase, -1 if missing.
+ */
+static int find_event( const char * name,
+                       char phase,
+                       int n )
+{
+    int i;
+
+    for( i = 0; i < eventCount; i++ )
+    {
+        if( ( strcmp( events[ i ].name, name ) == 0 ) && ( events[ i ].phase == phase ) && ( n-- == 0 ) )
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    eventCount = 0;
+    nce_trace_set_sink( record_event, NULL );
+}
+
+void tearDown( void )
+{
+    nce_trace_set_sink( NULL, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Onboarding opens one operation with nested, balanced spans
+ * for each phase, all carrying the operation ID.
+ */
+void test_trace_onboarding_phases( void )
+{
+    static const char * const expected[] =
+    {
+        NCE_TRACE_ONBOARD, NCE_TRACE_CONNECT, NCE_TRACE_CONNECT, NCE_TRACE_SEND, NCE_TRACE_SEND,
+        NCE_TRACE_WAIT_RESPONSE, NCE_TRACE_WAIT_RESPONSE, NCE_TRACE_PARSE, NCE_TRACE_PARSE,
+        NCE_TRACE_DISCONNECT, NCE_TRACE_DISCONNECT, NCE_TRACE_ONBOARD
+    };
+    static const char phases[] = "BBEBEBEBEBEE";
+    int i;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( 0 ) );
+    TEST_ASSERT_EQUAL( sizeof( expected ) / sizeof( expected[ 0 ] ), eventCount );
+
+    for( i = 0; i < eventCount; i++ )
+    {
+        TEST_ASSERT_EQUAL_STRING( expected[ i ], events[ i ].name );
+        TEST_ASSERT_EQUAL( phases[ i ], events[ i ].phase );
+        TEST_ASSERT_EQUAL( events[ 0 ].opId, events[ i ].opId );
+    }
+
+    TEST_ASSERT_NOT_EQUAL( 0, events[ 0 ].opId );
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, events[ eventCount - 1 ].status );
+}
+
+/**
+ * @brief Test 2: Span time stamps show where the time went, here the round
+ * trip of the request.
+ */
+void test_trace_timestamps( void )
+{
+    int begin;
+    int end;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( 0 ) );
+
+    begin = find_event( NCE_TRACE_WAIT_RESPONSE, NCE_TRACE_PHASE_BEGIN, 0 );
+    end = find_event( NCE_TRACE_WAIT_RESPONSE, NCE_TRACE_PHASE_END, 0 );
+    TEST_ASSERT_EQUAL( 2 * TRACE_LATENCY_US, events[ end ].timestampUs - events[ begin ].timestampUs );
+
+    begin = find_event( NCE_TRACE_PARSE, NCE_TRACE_PHASE_BEGIN, 0 );
+    end = find_event( NCE_TRACE_PARSE, NCE_TRACE_PHASE_END, 0 );
+    TEST_ASSERT_EQUAL( 0, events[ end ].timestampUs - events[ begin ].timestampUs );
+}
+
+/**
+ * @brief Test 3: Every operation gets a new ID, retries stay in the same
+ * operation and failed phases report their status.
+ */
+void test_trace_operation_ids_and_failures( void )
+{
+    uint32_t firstOp;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_SUCCESS, onboard( 0 ) );
+    firstOp = events[ 0 ].opId;
+    eventCount = 0;
+
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, onboard( 100 ) );
+    TEST_ASSERT_EQUAL( firstOp + 1, events[ 0 ].opId );
+    TEST_ASSERT_EQUAL( firstOp + 1, events[ eventCount - 1 ].opId );
+    TEST_ASSERT_NOT_EQUAL( -1, find_event( NCE_TRACE_WAIT_RESPONSE, NCE_TRACE_PHASE_END, NCE_SDK_ATTEMPTS - 2 ) );
+    TEST_ASSERT_EQUAL( 0, events[ find_event( NCE_TRACE_WAIT_RESPONSE, NCE_TRACE_PHASE_END, 0 ) ].status );
+    TEST_ASSERT_EQUAL( NCE_SDK_RECEIVE_ERROR, events[ eventCount - 1 ].status );
+}
@@ -0,0 +1,471 @@
+#include "unity.h"
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "nce_uplink_queue.h"
+#include "storage_linux.h"
+
+/* Geometry of the storage file */
+#define QUEUE_SECTOR_SIZE     512
+#define QUEUE_SECTORS         4
+
+/* Most frames recorded by the stub network */
+#define QUEUE_MAX_SENT        1024
+
+/* Write or erase the crash test kills the writer at, the range covers
+ * sector changes, drops, flushes and reclaims */
+#define CRASH_FIRST_OP        1
+#define CRASH_LAST_OP         400
+
+/* Runs of the writer killed at a random time */
+#define CRASH_RANDOM_RUNS     25
+
+/**
+ * @brief Frames seen by the stub network.
+ */
+typedef struct sent_frames
+{
+    int connects;
+    int disconnects;
+    int failAfter;
+    int count;
+    uint32_t seq[ QUEUE_MAX_SENT ];
+} sent_frames_t;
+
+/**
+ * @brief Progress of the writer process, shared with the test.
+ */
+typedef struct crash_progress
+{
+    uint32_t nextSeq;       /* Frame being pushed. */
+    uint32_t lastCommitted; /* Last frame whose push returned. */
+    uint32_t lastSent;      /* Last frame the writer flushed. */
+} crash_progress_t;
+
+static char path[ 64 ];
+static struct OSStorage file;
+static os_storage_ops_t storage;
+static os_storage_ops_t crashStorage;
+static long crashAt;
+static long storageOps;
+static sent_frames_t sent;
+static os_network_ops_t network;
+static const OSEndPoint_t endpoint = { "127.0.0.1", 5683 };
+
+/*-----------------------------------------------------------*/
+
+static int stub_connect( OSNetwork_t osnetwork,
+                         OSEndPoint_t nce_oboarding )
+{
+    sent.connects++;
+    return 0;
+}
+
+static int stub_send( OSNetwork_t osnetwork,
+                      void * pBuffer,
+                      size_t bytesToSend )
+{
+    uint32_t seq;
+
+    if( ( sent.failAfter >= 0 ) && ( sent.count >= sent.failAfter ) )
+    {
+        return -1;
+    }
+
+    memcpy( &seq, pBuffer, sizeof( seq ) );
+
+    if( sent.count < QUEUE_MAX_SENT )
+    {
+        sent.seq[ sent.count ] = seq;
+    }
+
+    sent.count++;
+
+    return ( int ) bytesToSend;
+}
+
+static int stub_disconnect( OSNetwork_t osnetwork )
+{
+    sent.disconnects++;
+    return 0;
+}
+
+/**
+ * @brief Frame number seq: the number followed by a pattern, 5 to 44 bytes.
+ */
+static size_t make_frame( uint32_t seq,
+                          uint8_t * frame )
+{
+    size_t length = 5u + seq % 40u;
+    size_t i;
+
+    memcpy( frame, &seq, sizeof( seq ) );
+
+    for( i = sizeof( seq ); i < length; i++ )
+    {
+        frame[ i ] = ( uint8_t ) ( seq * 31u + i );
+    }
+
+    return length;
+}
+
+static void open_storage( void )
+{
+    TEST_ASSERT_EQUAL( 0, nce_storage_linux_open( &file, path, QUEUE_SECTOR_SIZE * QUEUE_SECTORS,
+                                                  QUEUE_SECTOR_SIZE, &storage ) );
+}
+
+static void reopen_storage( void )
+{
+    nce_storage_linux_close( &storage );
+    open_storage();
+}
+
+static void push_frames( nce_uplink_queue_t * queue,
+                         uint32_t first,
+                         uint32_t count )
+{
+    uint8_t frame[ 64 ];
+    uint32_t seq;
+
+    for( seq = first; seq < first + count; seq++ )
+    {
+        TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_push( queue, frame, make_frame( seq, frame ) ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Storage write of the crash test writer: killed part way through
+ * its crashAt-th write or erase.
+ */
+static int crash_write( OSStorage_t osstorage,
+                        size_t offset,
+                        const void * pBuffer,
+                        size_t length )
+{
+    const uint8_t * bytes = ( const uint8_t * ) pBuffer;
+    size_t i;
+
+    if( ++storageOps == crashAt )
+    {
+        for( i = 0; i < ( length + 1u ) / 2u; i++ )
+        {
+            osstorage->base[ offset + i ] &= bytes[ i ];
+        }
+
+        raise( SIGKILL );
+    }
+
+    return storage.nce_os_storage_write( osstorage, offset, pBuffer, length );
+}
+
+static int crash_erase( OSStorage_t osstorage,
+                        size_t offset )
+{
+    if( ++storageOps == crashAt )
+    {
+        memset( osstorage->base + offset, 0xFF, QUEUE_SECTOR_SIZE / 2 );
+        raise( SIGKILL );
+    }
+
+    return storage.nce_os_storage_erase( osstorage, offset );
+}
+
+/**
+ * @brief Writer process: push frames forever, flushing a few of them now
+ * and then, until killed.
+ */
+static void crash_writer( crash_progress_t * progress )
+{
+    nce_uplink_queue_t queue;
+    uint8_t frame[ 64 ];
+    size_t flushed;
+    int i;
+
+    crashStorage = storage;
+    crashStorage.nce_os_storage_write = crash_write;
+    crashStorage.nce_os_storage_erase = crash_erase;
+    storageOps = 0;
+
+    if( nce_uplink_queue_init( &queue, &crashStorage ) != NCE_UPLINK_QUEUE_SUCCESS )
+    {
+        _exit( 2 );
+    }
+
+    for( i = 1; ; i++ )
+    {
+        if( nce_uplink_queue_push( &queue, frame, make_frame( progress->nextSeq, frame ) ) != NCE_UPLINK_QUEUE_SUCCESS )
+        {
+            _exit( 3 );
+        }
+
+        progress->lastCommitted = progress->nextSeq++;
+
+        if( ( i % 7 ) == 0 )
+        {
+            sent.count = 0;
+            ( void ) nce_uplink_queue_flush( &queue, &network, endpoint, 3, &flushed );
+            progress->lastSent = ( sent.count > 0 ) ? sent.seq[ sent.count - 1 ] : progress->lastSent;
+        }
+    }
+}
+
+/**
+ * @brief Recover the storage left by a killed writer and check that the
+ * pending frames are intact, in order, contiguous and never seen before.
+ */
+static void check_recovery( crash_progress_t * progress,
+                            uint32_t * lastSeen )
+{
+    nce_uplink_queue_t queue;
+    uint32_t newest;
+    int i;
+
+    reopen_storage();
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    TEST_ASSERT_EQUAL( queue.stats.recovered, queue.stats.pendingFrames );
+
+    memset( &sent, 0, sizeof( sent ) );
+    sent.failAfter = -1;
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 0, NULL ) );
+    TEST_ASSERT_EQUAL( queue.stats.recovered, sent.count );
+    TEST_ASSERT_EQUAL( 0, queue.stats.pendingFrames );
+
+    for( i = 0; i < sent.count; i++ )
+    {
+        TEST_ASSERT_GREATER_THAN( *lastSeen, sent.seq[ i ] );
+        TEST_ASSERT( ( i == 0 ) || ( sent.seq[ i ] == sent.seq[ i - 1 ] + 1u ) );
+    }
+
+    /* A push that returned is never lost, one in progress may survive. */
+    newest = ( sent.count > 0 ) ? sent.seq[ sent.count - 1 ] : 0u;
+    TEST_ASSERT( ( newest >= progress->lastCommitted ) || ( progress->lastSent >= progress->lastCommitted ) );
+    TEST_ASSERT( newest <= progress->nextSeq );
+
+    *lastSeen = ( newest > *lastSeen ) ? newest : *lastSeen;
+    progress->nextSeq = ( progress->nextSeq > *lastSeen ) ? progress->nextSeq : *lastSeen + 1u;
+    progress->lastCommitted = progress->nextSeq - 1u;
+    progress->lastSent = progress->lastCommitted;
+
+    /* The recovered queue keeps working. */
+    push_frames( &queue, progress->nextSeq, 1 );
+    memset( &sent, 0, sizeof( sent ) );
+    sent.failAfter = -1;
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 0, NULL ) );
+    TEST_ASSERT_EQUAL( 1, sent.count );
+    TEST_ASSERT_EQUAL( progress->nextSeq, sent.seq[ 0 ] );
+    *lastSeen = progress->nextSeq;
+    progress->lastCommitted = progress->nextSeq++;
+    progress->lastSent = progress->lastCommitted;
+}
+
+/**
+ * @brief Run the writer in a child process until it is killed.
+ *
+ * @param[in] atOp: Storage operation to crash at, 0 to kill after delayUs.
+ * @param[in] delayUs: Run time of the writer when atOp is 0.
+ */
+static void run_writer( crash_progress_t * progress,
+                        long atOp,
+                        unsigned int delayUs )
+{
+    int childStatus;
+    pid_t child;
+
+    fflush( stdout );
+    child = fork();
+    TEST_ASSERT( child >= 0 );
+
+    if( child == 0 )
+    {
+        crashAt = atOp;
+        crash_writer( progress );
+    }
+
+    if( atOp == 0 )
+    {
+        usleep( delayUs );
+        kill( child, SIGKILL );
+    }
+
+    TEST_ASSERT_EQUAL( child, waitpid( child, &childStatus, 0 ) );
+    TEST_ASSERT( WIFSIGNALED( childStatus ) && ( WTERMSIG( childStatus ) == SIGKILL ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void setUp( void )
+{
+    snprintf( path, sizeof( path ), "/tmp/nce_uplink_queue_%ld.bin", ( long ) getpid() );
+    unlink( path );
+    open_storage();
+
+    memset( &sent, 0, sizeof( sent ) );
+    sent.failAfter = -1;
+    network.os_socket = NULL;
+    network.nce_os_udp_connect = stub_connect;
+    network.nce_os_udp_send = stub_send;
+    network.nce_os_udp_recv = NULL;
+    network.nce_os_udp_disconnect = stub_disconnect;
+}
+
+void tearDown( void )
+{
+    nce_storage_linux_close( &storage );
+    unlink( path );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test 1: Frames survive a restart and are sent in order over a
+ * single session, nothing is connected when the queue is empty.
+ */
+void test_uplink_queue_persists_and_flushes_in_order( void )
+{
+    nce_uplink_queue_t queue;
+    nce_uplink_queue_stats_t stats;
+    size_t flushed = 99;
+    int i;
+
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 0, &flushed ) );
+    TEST_ASSERT_EQUAL( 0, flushed );
+    TEST_ASSERT_EQUAL( 0, sent.connects );
+
+    push_frames( &queue, 1, 20 );
+    reopen_storage();
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    nce_uplink_queue_get_stats( &queue, &stats );
+    TEST_ASSERT_EQUAL( 20, stats.recovered );
+    TEST_ASSERT_EQUAL( 20, stats.pendingFrames );
+    TEST_ASSERT_EQUAL( 0, stats.torn );
+
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 0, &flushed ) );
+    TEST_ASSERT_EQUAL( 20, flushed );
+    TEST_ASSERT_EQUAL( 1, sent.connects );
+    TEST_ASSERT_EQUAL( 1, sent.disconnects );
+
+    for( i = 0; i < 20; i++ )
+    {
+        TEST_ASSERT_EQUAL( i + 1, sent.seq[ i ] );
+    }
+
+    nce_uplink_queue_get_stats( &queue, &stats );
+    TEST_ASSERT_EQUAL( 20, stats.sent );
+    TEST_ASSERT_EQUAL( 0, stats.pendingFrames );
+    TEST_ASSERT_EQUAL( 0, stats.pendingBytes );
+
+    /* Sent frames are not sent again after a restart. */
+    reopen_storage();
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    TEST_ASSERT_EQUAL( 0, queue.stats.pendingFrames );
+}
+
+/**
+ * @brief Test 2: Batches are limited by maxFrames, a failed send ends the
+ * flush and keeps the frame queued.
+ */
+void test_uplink_queue_batches_and_send_failures( void )
+{
+    nce_uplink_queue_t queue;
+    size_t flushed;
+
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    push_frames( &queue, 1, 10 );
+
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 4, &flushed ) );
+    TEST_ASSERT_EQUAL( 4, flushed );
+    TEST_ASSERT_EQUAL( 6, queue.stats.pendingFrames );
+
+    sent.failAfter = 6;
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SEND_ERROR, nce_uplink_queue_flush( &queue, &network, endpoint, 0, &flushed ) );
+    TEST_ASSERT_EQUAL( 2, flushed );
+    TEST_ASSERT_EQUAL( 1, queue.stats.sendFailures );
+    TEST_ASSERT_EQUAL( 4, queue.stats.pendingFrames );
+    TEST_ASSERT_EQUAL( 2, sent.disconnects );
+
+    sent.failAfter = -1;
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 0, &flushed ) );
+    TEST_ASSERT_EQUAL( 4, flushed );
+    TEST_ASSERT_EQUAL( 7, sent.seq[ 6 ] );
+    TEST_ASSERT_EQUAL( 10, sent.seq[ 9 ] );
+    TEST_ASSERT_EQUAL( 10, queue.stats.sent );
+}
+
+/**
+ * @brief Test 3: A full ring drops its oldest frames, keeps the newest in
+ * order and reuses sectors freed by flushing.
+ */
+void test_uplink_queue_drops_oldest_when_full( void )
+{
+    nce_uplink_queue_t queue;
+    uint8_t frame[ NCE_SDK_UPLINK_MAX_FRAME + 1 ];
+    uint32_t first;
+    int i;
+
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_FRAME_SIZE_ERROR, nce_uplink_queue_push( &queue, frame, 0 ) );
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_FRAME_SIZE_ERROR, nce_uplink_queue_push( &queue, frame, sizeof( frame ) ) );
+
+    push_frames( &queue, 1, 200 );
+    TEST_ASSERT_GREATER_THAN( 0, queue.stats.dropped );
+    TEST_ASSERT_EQUAL( 200, queue.stats.enqueued );
+    TEST_ASSERT_EQUAL( 200, queue.stats.dropped + queue.stats.pendingFrames );
+
+    reopen_storage();
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_init( &queue, &storage ) );
+    TEST_ASSERT_EQUAL( NCE_UPLINK_QUEUE_SUCCESS, nce_uplink_queue_flush( &queue, &network, endpoint, 0, NULL ) );
+    first = 201u - ( uint32_t ) sent.count;
+
+    for( i = 0; i < sent.count; i++ )
+    {
+        TEST_ASSERT_EQUAL( first + ( uint32_t ) i, sent.seq[ i ] );
+    }
+
+    /* Flushed sectors are erased and filled again without drops. */
+    push_frames( &queue, 201, 20 );
+    TEST_ASSERT_EQUAL( 0, queue.stats.dropped );
+    TEST_ASSERT_EQUAL( 20, queue.stats.pendingFrames );
+}
+
+/**
+ * @brief Test 4: Killing the writer in the middle of a write, an erase or
+ * at a random time never loses a committed frame, duplicates one or
+ * delivers a corrupted one.
+ */
+void test_uplink_queue_crash_consistency( void )
+{
+    crash_progress_t * progress = mmap( NULL, sizeof( *progress ), PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    uint32_t lastSeen = 0;
+    long atOp;
+    int run;
+
+    TEST_ASSERT( progress != MAP_FAILED );
+    progress->nextSeq = 1;
+    progress->lastCommitted = 0;
+    progress->lastSent = 0;
+    srand( 34 );
+
+    for( atOp = CRASH_FIRST_OP; atOp <= CRASH_LAST_OP; atOp++ )
+    {
+        run_writer( progress, atOp, 0 );
+        check_recovery( progress, &lastSeen );
+    }
+
+    for( run = 0; run < CRASH_RANDOM_RUNS; run++ )
+    {
+        run_writer( progress, 0, 1000u + ( unsigned int ) ( rand() % 20000 ) );
+        check_recovery( progress, &lastSeen );
+    }
+
+    munmap( progress, sizeof( *progress ) );
+}
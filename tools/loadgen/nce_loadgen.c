@@ -0,0 +1,856 @@
+/**
+ * @file nce_loadgen.c
+ * @brief Load generator simulating a fleet of devices built on the SDK.
+ *
+ * Every virtual device owns an SDK context and a socket. It onboards with
+ * os_auth_ctx(), then periodically sends Energy Saver uplinks (payloads built
+ * with os_energy_save()) and bursts of Memfault-style chunks through the CoAP
+ * proxy. Requests are confirmable and retransmitted with exponential backoff.
+ *
+ * By default the devices talk to an in-process loopback stand-in of the 1NCE
+ * endpoints. The thundering-herd mode silences the stand-in for a while and
+ * then reboots every device at the same instant, as after a network outage.
+ *
+ * The report lists throughput, latency histograms, retries and bytes on the
+ * wire per operation.
+ */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "nce_iot_c_sdk.h"
+#include "network_interface_linux.h"
+#include "nce_standin.h"
+
+#ifdef NCE_SDK_TRACE
+    #include "trace_chrome_linux.h"
+#endif
+
+/* Log2 latency buckets in microseconds, the last one collects everything above. */
+#define LG_BUCKETS                  28
+
+#define LG_COAP_VERSION_CON         0x40
+#define LG_COAP_TOKEN_LENGTH        2
+#define LG_COAP_POST                0x02
+#define LG_COAP_TYPE_ACK            2
+#define LG_COAP_OPTION_URI_QUERY    15
+#define LG_COAP_OPTION_PROXY_URI    35
+#define LG_COAP_PAYLOAD_MARKER      0xFF
+#define LG_MAX_DATAGRAM             1280
+#define LG_MAX_ATTEMPTS             4
+#define LG_MEMFAULT_PROXY_URI       "https://chunks.memfault.com/api/v0/chunks/:iccid:"
+
+/**
+ * @brief Operations measured by the load generator.
+ */
+typedef enum lg_op
+{
+    LG_OP_ONBOARD,
+    LG_OP_ENERGY_SAVER,
+    LG_OP_MEMFAULT,
+    LG_OP_HERD_ONBOARD,
+    LG_OP_COUNT
+} lg_op_t;
+
+static const char * const lgOpNames[ LG_OP_COUNT ] =
+{
+    "onboard", "energy_saver", "memfault_chunk", "herd_onboard"
+};
+
+/**
+ * @brief Counters of one operation.
+ */
+typedef struct lg_stats
+{
+    unsigned long count;
+    unsigned long success;
+    unsigned long failed;
+    unsigned long retries;
+    unsigned long long bytesSent;
+    unsigned long long bytesReceived;
+    unsigned long datagramsSent;
+    unsigned long datagramsReceived;
+    unsigned long histogram[ LG_BUCKETS ];
+    uint64_t maxUs;
+} lg_stats_t;
+
+/**
+ * @brief Command line configuration.
+ */
+typedef struct lg_config
+{
+    int devices;
+    int threads;
+    int durationMs;
+    int rampMs;
+    int uplinkIntervalMs;
+    int memfaultIntervalMs;
+    int chunksPerUpload;
+    int chunkSize;
+    int timeoutMs;
+    int outageMs;
+    unsigned int seed;
+    OSEndPoint_t server;
+    const char * tracePath;
+} lg_config_t;
+
+struct lg_worker;
+
+/**
+ * @brief One virtual device. network must stay the first member, the
+ * counting network operations cast the OSNetwork_t back to the device.
+ */
+typedef struct lg_device
+{
+    struct OSNetwork network;
+    os_network_ops_t ops;
+    nce_context_t ctx;
+    DtlsKey_t key;
+    int onboarded;
+    int connected;
+    int rebooting;
+    uint64_t nextOnboardUs;
+    uint64_t nextUplinkUs;
+    uint64_t nextMemfaultUs;
+    unsigned long opSends;
+    unsigned long opReceives;
+    unsigned long long opBytesSent;
+    unsigned long long opBytesReceived;
+} lg_device_t;
+
+/**
+ * @brief Thread simulating a slice of the fleet.
+ */
+typedef struct lg_worker
+{
+    pthread_t thread;
+    lg_device_t * devices;
+    int deviceCount;
+    unsigned int rng;
+    int herdGeneration;
+    lg_stats_t stats[ LG_OP_COUNT ];
+} lg_worker_t;
+
+static lg_config_t config;
+static uint64_t startUs;
+static pthread_mutex_t herdLock = PTHREAD_MUTEX_INITIALIZER;
+static int herdGeneration = 0;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t lg_now_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000u + ( uint64_t ) ts.tv_nsec / 1000u;
+}
+
+static unsigned int lg_random( unsigned int * state )
+{
+    /* xorshift32, deterministic per worker for a given seed */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void lg_set_timeout( lg_device_t * device,
+                            int timeoutMs )
+{
+    struct timeval timeo;
+
+    timeo.tv_sec = timeoutMs / 1000;
+    timeo.tv_usec = ( timeoutMs % 1000 ) * 1000;
+    setsockopt( device->network.os_socket, SOL_SOCKET, SO_RCVTIMEO, &timeo, sizeof( timeo ) );
+}
+
+static int lg_current_herd( void )
+{
+    int generation;
+
+    pthread_mutex_lock( &herdLock );
+    generation = herdGeneration;
+    pthread_mutex_unlock( &herdLock );
+
+    return generation;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Network operations counting the traffic of the current operation. */
+
+static int lg_connect( OSNetwork_t osnetwork,
+                       OSEndPoint_t endpoint )
+{
+    int ret = nce_os_connect( osnetwork, endpoint );
+
+    if( ret == 0 )
+    {
+        lg_set_timeout( ( lg_device_t * ) osnetwork, config.timeoutMs );
+    }
+
+    return ret;
+}
+
+static int lg_send( OSNetwork_t osnetwork,
+                    void * pBuffer,
+                    size_t bytesToSend )
+{
+    lg_device_t * device = ( lg_device_t * ) osnetwork;
+    int ret = nce_os_send( osnetwork, pBuffer, bytesToSend );
+
+    device->opSends++;
+    device->opBytesSent += ( ret > 0 ) ? ( unsigned long long ) ret : 0u;
+
+    return ret;
+}
+
+static int lg_recv( OSNetwork_t osnetwork,
+                    void * pBuffer,
+                    size_t bytesToRecv )
+{
+    lg_device_t * device = ( lg_device_t * ) osnetwork;
+    int ret = nce_os_recv( osnetwork, pBuffer, bytesToRecv );
+
+    if( ret > 0 )
+    {
+        device->opReceives++;
+        device->opBytesReceived += ( unsigned long long ) ret;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void lg_record( lg_worker_t * worker,
+                       lg_device_t * device,
+                       lg_op_t op,
+                       int success,
+                       uint64_t latencyUs )
+{
+    lg_stats_t * stats = &worker->stats[ op ];
+    int bucket = 0;
+
+    while( ( bucket < LG_BUCKETS - 1 ) && ( latencyUs >= ( ( uint64_t ) 1 << ( bucket + 1 ) ) ) )
+    {
+        bucket++;
+    }
+
+    stats->count++;
+    stats->success += success ? 1u : 0u;
+    stats->failed += success ? 0u : 1u;
+    stats->retries += ( device->opSends > 1 ) ? device->opSends - 1 : 0u;
+    stats->bytesSent += device->opBytesSent;
+    stats->bytesReceived += device->opBytesReceived;
+    stats->datagramsSent += device->opSends;
+    stats->datagramsReceived += device->opReceives;
+    stats->histogram[ bucket ]++;
+    stats->maxUs = ( latencyUs > stats->maxUs ) ? latencyUs : stats->maxUs;
+
+    device->opSends = 0;
+    device->opReceives = 0;
+    device->opBytesSent = 0;
+    device->opBytesReceived = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t lg_coap_option( uint8_t * out,
+                              unsigned int delta,
+                              const void * value,
+                              size_t length )
+{
+    size_t offset = 1;
+    unsigned int deltaNibble = ( delta < 13 ) ? delta : 13;
+    unsigned int lengthNibble = ( length < 13 ) ? ( unsigned int ) length : 13;
+
+    out[ 0 ] = ( uint8_t ) ( ( deltaNibble << 4 ) | lengthNibble );
+
+    if( deltaNibble == 13 )
+    {
+        out[ offset++ ] = ( uint8_t ) ( delta - 13 );
+    }
+
+    if( lengthNibble == 13 )
+    {
+        out[ offset++ ] = ( uint8_t ) ( length - 13 );
+    }
+
+    memcpy( &out[ offset ], value, length );
+
+    return offset + length;
+}
+
+/* Confirmable POST with a 2-byte token, one option and a payload. */
+static size_t lg_coap_post( uint8_t * out,
+                            uint16_t messageId,
+                            unsigned int option,
+                            const char * optionValue,
+                            const void * payload,
+                            size_t payloadLength )
+{
+    size_t length = 4 + LG_COAP_TOKEN_LENGTH;
+
+    out[ 0 ] = LG_COAP_VERSION_CON | LG_COAP_TOKEN_LENGTH;
+    out[ 1 ] = LG_COAP_POST;
+    out[ 2 ] = ( uint8_t ) ( messageId >> 8 );
+    out[ 3 ] = ( uint8_t ) messageId;
+    out[ 4 ] = out[ 2 ];
+    out[ 5 ] = out[ 3 ];
+    length += lg_coap_option( &out[ length ], option, optionValue, strlen( optionValue ) );
+    out[ length++ ] = LG_COAP_PAYLOAD_MARKER;
+    memcpy( &out[ length ], payload, payloadLength );
+
+    return length + payloadLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Send a confirmable request and wait for its ACK, retransmitting with backoff. */
+static int lg_exchange( lg_device_t * device,
+                        uint8_t * request,
+                        size_t length )
+{
+    uint8_t response[ LG_MAX_DATAGRAM ];
+    int attempt;
+
+    for( attempt = 0; attempt < LG_MAX_ATTEMPTS; attempt++ )
+    {
+        int received;
+
+        lg_set_timeout( device, config.timeoutMs << attempt );
+
+        if( device->ops.nce_os_udp_send( device->ops.os_socket, request, length ) < 0 )
+        {
+            continue;
+        }
+
+        do
+        {
+            received = device->ops.nce_os_udp_recv( device->ops.os_socket, response, sizeof( response ) );
+
+            if( ( received >= 4 ) && ( ( ( response[ 0 ] >> 4 ) & 0x03 ) == LG_COAP_TYPE_ACK ) &&
+                ( response[ 2 ] == request[ 2 ] ) && ( response[ 3 ] == request[ 3 ] ) )
+            {
+                return ( ( response[ 1 ] >> 5 ) == 2 ) ? 1 : 0;
+            }
+
+            /* Anything else is a late duplicate of an older exchange. */
+        } while( received > 0 );
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void lg_onboard( lg_worker_t * worker,
+                        lg_device_t * device )
+{
+    lg_op_t op = device->rebooting ? LG_OP_HERD_ONBOARD : LG_OP_ONBOARD;
+    uint64_t start = lg_now_us();
+    int success = ( os_auth_ctx( &device->ctx, &device->key ) == NCE_SDK_SUCCESS );
+
+    lg_record( worker, device, op, success, lg_now_us() - start );
+
+    if( !success )
+    {
+        /* Try again after a randomized pause, like a device would. */
+        device->nextOnboardUs = lg_now_us() + ( uint64_t ) ( lg_random( &worker->rng ) % 1000u ) * 1000u;
+        return;
+    }
+
+    device->onboarded = 1;
+    device->rebooting = 0;
+    device->connected = ( device->ops.nce_os_udp_connect( device->ops.os_socket, config.server ) == 0 );
+    device->nextUplinkUs = lg_now_us() + ( uint64_t ) ( lg_random( &worker->rng ) % ( unsigned int ) config.uplinkIntervalMs ) * 1000u;
+    device->nextMemfaultUs = lg_now_us() + ( uint64_t ) ( lg_random( &worker->rng ) % ( unsigned int ) config.memfaultIntervalMs ) * 1000u;
+}
+
+static void lg_energy_saver_uplink( lg_worker_t * worker,
+                                    lg_device_t * device )
+{
+    Element2byte_gen_t battery = { E_INTEGER, { 0 }, 1 };
+    Element2byte_gen_t signal = { E_INTEGER, { 0 }, 1 };
+    Element2byte_gen_t version = { E_STRING, { 0 }, 5 };
+    char payload[ NCE_SDK_MAX_STRING_SIZE ];
+    uint8_t request[ LG_MAX_DATAGRAM ];
+    uint64_t start = lg_now_us();
+    int payloadLength;
+    int success = 0;
+
+    battery.value.i = ( int ) ( lg_random( &worker->rng ) % 100u );
+    signal.value.i = ( int ) ( lg_random( &worker->rng ) % 100u );
+    memcpy( version.value.s, "2.2.1", 6 );
+    payloadLength = os_energy_save( payload, 1, 3, battery, signal, version );
+
+    if( payloadLength > 0 )
+    {
+        size_t length = lg_coap_post( request, ++device->ctx.messageId, LG_COAP_OPTION_URI_QUERY, "t=energy",
+                                      payload, ( size_t ) payloadLength );
+        success = lg_exchange( device, request, length );
+    }
+
+    lg_record( worker, device, LG_OP_ENERGY_SAVER, success, lg_now_us() - start );
+    device->nextUplinkUs += ( uint64_t ) config.uplinkIntervalMs * 1000u;
+}
+
+static void lg_memfault_upload( lg_worker_t * worker,
+                                lg_device_t * device )
+{
+    uint8_t chunk[ LG_MAX_DATAGRAM ];
+    uint8_t request[ LG_MAX_DATAGRAM ];
+    int i;
+
+    memset( chunk, 0xA5, ( size_t ) config.chunkSize );
+
+    /* Like the Memfault loop: stop the upload at the first failed chunk. */
+    for( i = 0; i < config.chunksPerUpload; i++ )
+    {
+        uint64_t start = lg_now_us();
+        size_t length = lg_coap_post( request, ++device->ctx.messageId, LG_COAP_OPTION_PROXY_URI,
+                                      LG_MEMFAULT_PROXY_URI, chunk, ( size_t ) config.chunkSize );
+        int success = lg_exchange( device, request, length );
+
+        lg_record( worker, device, LG_OP_MEMFAULT, success, lg_now_us() - start );
+
+        if( !success )
+        {
+            break;
+        }
+    }
+
+    device->nextMemfaultUs += ( uint64_t ) config.memfaultIntervalMs * 1000u;
+}
+
+/*-----------------------------------------------------------*/
+
+/* All devices of the worker reboot at once and onboard again. */
+static void lg_reboot_all( lg_worker_t * worker,
+                           uint64_t now )
+{
+    int i;
+
+    for( i = 0; i < worker->deviceCount; i++ )
+    {
+        lg_device_t * device = &worker->devices[ i ];
+
+        if( device->connected )
+        {
+            device->ops.nce_os_udp_disconnect( device->ops.os_socket );
+        }
+
+        device->connected = 0;
+        device->onboarded = 0;
+        device->rebooting = 1;
+        device->nextOnboardUs = now;
+    }
+}
+
+static uint64_t lg_next_due( const lg_device_t * device )
+{
+    uint64_t due;
+
+    if( !device->onboarded )
+    {
+        return device->nextOnboardUs;
+    }
+
+    due = ( device->nextUplinkUs < device->nextMemfaultUs ) ? device->nextUplinkUs : device->nextMemfaultUs;
+
+    return due;
+}
+
+static void * lg_worker_thread( void * arg )
+{
+    lg_worker_t * worker = ( lg_worker_t * ) arg;
+    uint64_t endUs = startUs + ( uint64_t ) config.durationMs * 1000u;
+    uint64_t now;
+
+    while( ( now = lg_now_us() ) < endUs )
+    {
+        lg_device_t * next = NULL;
+        uint64_t due = UINT64_MAX;
+        int generation = lg_current_herd();
+        int i;
+
+        if( generation != worker->herdGeneration )
+        {
+            worker->herdGeneration = generation;
+            lg_reboot_all( worker, now );
+        }
+
+        for( i = 0; i < worker->deviceCount; i++ )
+        {
+            uint64_t deviceDue = lg_next_due( &worker->devices[ i ] );
+
+            if( deviceDue < due )
+            {
+                due = deviceDue;
+                next = &worker->devices[ i ];
+            }
+        }
+
+        if( ( next == NULL ) || ( due > now ) )
+        {
+            uint64_t pause = ( next == NULL ) ? 10000u : due - now;
+            usleep( ( useconds_t ) ( ( pause < 10000u ) ? pause : 10000u ) );
+        }
+        else if( !next->onboarded )
+        {
+            lg_onboard( worker, next );
+        }
+        else if( !next->connected )
+        {
+            next->connected = ( next->ops.nce_os_udp_connect( next->ops.os_socket, config.server ) == 0 );
+            next->nextUplinkUs = now + 1000000u;
+        }
+        else if( next->nextUplinkUs <= next->nextMemfaultUs )
+        {
+            lg_energy_saver_uplink( worker, next );
+        }
+        else
+        {
+            lg_memfault_upload( worker, next );
+        }
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t lg_percentile( const lg_stats_t * stats,
+                               double fraction )
+{
+    unsigned long target = ( unsigned long ) ( fraction * ( double ) stats->count );
+    unsigned long seen = 0;
+    int bucket;
+
+    for( bucket = 0; bucket < LG_BUCKETS; bucket++ )
+    {
+        seen += stats->histogram[ bucket ];
+
+        if( seen > target )
+        {
+            /* Upper bound of the bucket, never above the observed maximum. */
+            uint64_t bound = ( uint64_t ) 1 << ( bucket + 1 );
+            return ( bound < stats->maxUs ) ? bound : stats->maxUs;
+        }
+    }
+
+    return stats->maxUs;
+}
+
+static void lg_report( const lg_stats_t * stats,
+                       double elapsed )
+{
+    unsigned long long bytes = 0;
+    unsigned long datagrams = 0;
+    unsigned long operations = 0;
+    int op;
+    int bucket;
+
+    printf( "\n%-15s %8s %8s %7s %8s %11s %11s %9s %9s %9s %9s\n", "operation", "count", "ok", "failed",
+            "retries", "bytes_tx", "bytes_rx", "p50_ms", "p90_ms", "p99_ms", "max_ms" );
+
+    for( op = 0; op < LG_OP_COUNT; op++ )
+    {
+        const lg_stats_t * s = &stats[ op ];
+
+        printf( "%-15s %8lu %8lu %7lu %8lu %11llu %11llu %9.2f %9.2f %9.2f %9.2f\n", lgOpNames[ op ],
+                s->count, s->success, s->failed, s->retries, s->bytesSent, s->bytesReceived,
+                lg_percentile( s, 0.5 ) / 1e3, lg_percentile( s, 0.9 ) / 1e3,
+                lg_percentile( s, 0.99 ) / 1e3, s->maxUs / 1e3 );
+        bytes += s->bytesSent + s->bytesReceived;
+        datagrams += s->datagramsSent + s->datagramsReceived;
+        operations += s->count;
+    }
+
+    printf( "\nthroughput: %.0f ops/s, %.0f datagrams/s, %.1f kB/s on the wire (payload + CoAP headers)\n",
+            operations / elapsed, datagrams / elapsed, bytes / elapsed / 1e3 );
+
+    for( op = 0; op < LG_OP_COUNT; op++ )
+    {
+        if( stats[ op ].count == 0 )
+        {
+            continue;
+        }
+
+        printf( "\n%s latency histogram\n", lgOpNames[ op ] );
+
+        for( bucket = 0; bucket < LG_BUCKETS; bucket++ )
+        {
+            if( stats[ op ].histogram[ bucket ] != 0 )
+            {
+                printf( "  < %10.3f ms %8lu\n", ( double ) ( ( uint64_t ) 1 << ( bucket + 1 ) ) / 1e3,
+                        stats[ op ].histogram[ bucket ] );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void lg_usage( const char * name )
+{
+    fprintf( stderr,
+             "usage: %s [options]\n"
+             "  -n devices             virtual devices (1000)\n"
+             "  -t threads             worker threads (64)\n"
+             "  -d duration_ms         run time (10000)\n"
+             "  -R ramp_ms             spread of the initial onboarding (1000)\n"
+             "  -u uplink_ms           Energy Saver uplink interval per device (1000)\n"
+             "  -m memfault_ms         Memfault upload interval per device (5000)\n"
+             "  -c chunks              chunks per Memfault upload (2)\n"
+             "  -z chunk_size          Memfault chunk size in bytes (512)\n"
+             "  -T timeout_ms          initial retransmission timeout (500)\n"
+             "  -H outage_ms           thundering herd: outage length, devices reboot when it ends (0: off)\n"
+             "  -s host:port           external server instead of the loopback stand-in\n"
+             "  -S seed                random seed (1)\n"
+             "  -x trace.json          write SDK spans as Chrome trace events (NCE_SDK_TRACE builds)\n", name );
+}
+
+static int lg_parse( int argc,
+                     char ** argv )
+{
+    int opt;
+
+    config.devices = 1000;
+    config.threads = 64;
+    config.durationMs = 10000;
+    config.rampMs = 1000;
+    config.uplinkIntervalMs = 1000;
+    config.memfaultIntervalMs = 5000;
+    config.chunksPerUpload = 2;
+    config.chunkSize = 512;
+    config.timeoutMs = 500;
+    config.seed = 1;
+
+    while( ( opt = getopt( argc, argv, "n:t:d:R:u:m:c:z:T:H:s:S:x:" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'n': config.devices = atoi( optarg ); break;
+            case 't': config.threads = atoi( optarg ); break;
+            case 'd': config.durationMs = atoi( optarg ); break;
+            case 'R': config.rampMs = atoi( optarg ); break;
+            case 'u': config.uplinkIntervalMs = atoi( optarg ); break;
+            case 'm': config.memfaultIntervalMs = atoi( optarg ); break;
+            case 'c': config.chunksPerUpload = atoi( optarg ); break;
+            case 'z': config.chunkSize = atoi( optarg ); break;
+            case 'T': config.timeoutMs = atoi( optarg ); break;
+            case 'H': config.outageMs = atoi( optarg ); break;
+            case 'S': config.seed = ( unsigned int ) strtoul( optarg, NULL, 10 ); break;
+            case 'x': config.tracePath = optarg; break;
+            case 's':
+               {
+                   char * colon = strrchr( optarg, ':' );
+
+                   if( ( colon == NULL ) || ( ( size_t ) ( colon - optarg ) >= sizeof( config.server.host ) ) )
+                   {
+                       return -1;
+                   }
+
+                   memcpy( ( char * ) config.server.host, optarg, ( size_t ) ( colon - optarg ) );
+                   config.server.port = atoi( colon + 1 );
+                   break;
+               }
+            default: return -1;
+        }
+    }
+
+    if( ( config.devices <= 0 ) || ( config.threads <= 0 ) || ( config.uplinkIntervalMs <= 0 ) ||
+        ( config.memfaultIntervalMs <= 0 ) || ( config.chunkSize <= 0 ) || ( config.chunkSize > 1024 ) ||
+        ( config.timeoutMs <= 0 ) || ( config.rampMs <= 0 ) )
+    {
+        return -1;
+    }
+
+    config.threads = ( config.threads > config.devices ) ? config.devices : config.threads;
+    config.seed = ( config.seed == 0 ) ? 1 : config.seed;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    static lg_stats_t totals[ LG_OP_COUNT ];
+    nce_standin_t standin;
+    int useStandin;
+    lg_device_t * devices;
+    lg_worker_t * workers;
+    int perWorker;
+    int i;
+    int op;
+    int bucket;
+
+    if( lg_parse( argc, argv ) != 0 )
+    {
+        lg_usage( argv[ 0 ] );
+        return 1;
+    }
+
+    if( config.tracePath != NULL )
+    {
+        #ifdef NCE_SDK_TRACE
+            if( nce_trace_chrome_open( config.tracePath ) != 0 )
+            {
+                perror( config.tracePath );
+                return 1;
+            }
+        #else
+            fprintf( stderr, "-x needs a build with NCE_SDK_TRACE\n" );
+            return 1;
+        #endif
+    }
+
+    useStandin = ( config.server.port == 0 );
+
+    if( useStandin )
+    {
+        if( nce_standin_start( &standin ) != 0 )
+        {
+            perror( "stand-in" );
+            return 1;
+        }
+
+        memcpy( ( char * ) config.server.host, "127.0.0.1", sizeof( "127.0.0.1" ) );
+        config.server.port = standin.port;
+    }
+
+    devices = calloc( ( size_t ) config.devices, sizeof( *devices ) );
+    workers = calloc( ( size_t ) config.threads, sizeof( *workers ) );
+
+    if( ( devices == NULL ) || ( workers == NULL ) )
+    {
+        return 1;
+    }
+
+    perWorker = ( config.devices + config.threads - 1 ) / config.threads;
+    startUs = lg_now_us();
+
+    for( i = 0; i < config.devices; i++ )
+    {
+        lg_device_t * device = &devices[ i ];
+        unsigned int jitter = config.seed * 2654435761u + ( unsigned int ) i * 40503u;
+
+        device->ops.os_socket = &device->network;
+        device->ops.nce_os_udp_connect = lg_connect;
+        device->ops.nce_os_udp_send = lg_send;
+        device->ops.nce_os_udp_recv = lg_recv;
+        device->ops.nce_os_udp_disconnect = nce_os_disconnect;
+        os_context_init( &device->ctx, &device->ops );
+        device->ctx.onboardEndpoint = &config.server;
+        device->nextOnboardUs = startUs + ( uint64_t ) ( jitter % ( unsigned int ) config.rampMs ) * 1000u;
+    }
+
+    printf( "%d devices on %d threads for %d ms against %s:%d%s\n", config.devices, config.threads,
+            config.durationMs, config.server.host, config.server.port, useStandin ? " (loopback stand-in)" : "" );
+
+    for( i = 0; i < config.threads; i++ )
+    {
+        int first = i * perWorker;
+
+        workers[ i ].devices = &devices[ first ];
+        workers[ i ].deviceCount = ( first + perWorker <= config.devices ) ? perWorker : config.devices - first;
+        workers[ i ].deviceCount = ( workers[ i ].deviceCount < 0 ) ? 0 : workers[ i ].deviceCount;
+        workers[ i ].rng = config.seed + ( unsigned int ) i * 7919u;
+        pthread_create( &workers[ i ].thread, NULL, lg_worker_thread, &workers[ i ] );
+    }
+
+    if( config.outageMs > 0 )
+    {
+        /* Outage in the middle of the run, then every device reboots at once. */
+        usleep( ( useconds_t ) config.durationMs * 400u );
+        printf( "outage for %d ms\n", config.outageMs );
+
+        if( useStandin )
+        {
+            nce_standin_set_outage( &standin, 1 );
+        }
+
+        usleep( ( useconds_t ) config.outageMs * 1000u );
+
+        if( useStandin )
+        {
+            nce_standin_set_outage( &standin, 0 );
+        }
+
+        printf( "network back, rebooting all devices\n" );
+        pthread_mutex_lock( &herdLock );
+        herdGeneration++;
+        pthread_mutex_unlock( &herdLock );
+    }
+
+    for( i = 0; i < config.threads; i++ )
+    {
+        pthread_join( workers[ i ].thread, NULL );
+
+        for( op = 0; op < LG_OP_COUNT; op++ )
+        {
+            lg_stats_t * total = &totals[ op ];
+            const lg_stats_t * s = &workers[ i ].stats[ op ];
+
+            total->count += s->count;
+            total->success += s->success;
+            total->failed += s->failed;
+            total->retries += s->retries;
+            total->bytesSent += s->bytesSent;
+            total->bytesReceived += s->bytesReceived;
+            total->datagramsSent += s->datagramsSent;
+            total->datagramsReceived += s->datagramsReceived;
+            total->maxUs = ( s->maxUs > total->maxUs ) ? s->maxUs : total->maxUs;
+
+            for( bucket = 0; bucket < LG_BUCKETS; bucket++ )
+            {
+                total->histogram[ bucket ] += s->histogram[ bucket ];
+            }
+        }
+    }
+
+    lg_report( totals, ( double ) ( lg_now_us() - startUs ) / 1e6 );
+
+    for( i = 0; i < config.devices; i++ )
+    {
+        if( devices[ i ].connected )
+        {
+            nce_os_disconnect( &devices[ i ].network );
+        }
+    }
+
+    if( useStandin )
+    {
+        nce_standin_stop( &standin );
+        printf( "\nstand-in: %lu requests answered, %lu dropped, %lu credentials issued\n",
+                standin.requests, standin.dropped, standin.onboarded );
+    }
+
+    #ifdef NCE_SDK_TRACE
+        if( config.tracePath != NULL )
+        {
+            printf( "trace: %ld events written to %s\n", nce_trace_chrome_close(), config.tracePath );
+        }
+    #endif
+
+    free( workers );
+    free( devices );
+
+    return 0;
+}
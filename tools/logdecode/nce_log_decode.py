@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2022 1NCE
+#
+# Decoder of the tokenized logs of the SDK (NCE_SDK_LOG_TOKENIZED).
+#
+# Usage: nce_log_decode.py <elf file of the build> <dump of nce_log_drain()>
+#
+# The token of a record is the address of its format string in the
+# nce_log_fmt section of the ELF file; see source/include/nce_log_tokenized.h
+# for the record layout.
+
+import re
+import struct
+import sys
+
+SECTION = "nce_log_fmt"
+LEVELS = {1: "ERR", 2: "WRN", 3: "INF", 4: "DBG"}
+TRUNCATED = 0x80
+ARG_INT, ARG_DOUBLE, ARG_STRING, ARG_POINTER = 1, 2, 3, 4
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcspfFeEgG%])")
+
+
+def load_section(path):
+    """Return (address, bytes) of the format string section."""
+    with open(path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF":
+        raise ValueError("%s is not an ELF file" % path)
+
+    wide = elf[4] == 2
+    order = "<" if elf[5] == 1 else ">"
+
+    if wide:
+        shoff, = struct.unpack_from(order + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", elf, 0x3A)
+        header = order + "IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from(order + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", elf, 0x2E)
+        header = order + "IIIIIIIIII"
+
+    sections = [struct.unpack_from(header, elf, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx][4]
+
+    for name, _, _, addr, offset, size, _, _, _, _ in sections:
+        end = elf.index(b"\0", names + name)
+
+        if elf[names + name:end].decode() == SECTION:
+            return addr, elf[offset:offset + size]
+
+    raise ValueError("%s has no %s section" % (path, SECTION))
+
+
+def read_varint(data, pos):
+    value, shift = 0, 0
+
+    while data[pos] & 0x80:
+        value |= (data[pos] & 0x7F) << shift
+        shift += 7
+        pos += 1
+
+    return value | (data[pos] << shift), pos + 1
+
+
+def read_args(data, pos, end):
+    args = []
+
+    while pos < end:
+        tag = data[pos]
+        pos += 1
+
+        if tag == ARG_INT:
+            zigzag, pos = read_varint(data, pos)
+            args.append((zigzag >> 1) ^ -(zigzag & 1))
+        elif tag == ARG_DOUBLE:
+            args.append(struct.unpack_from("<d", data, pos)[0])
+            pos += 8
+        elif tag == ARG_STRING:
+            args.append(data[pos + 1:pos + 1 + data[pos]].decode(errors="replace"))
+            pos += 1 + data[pos]
+        elif tag == ARG_POINTER:
+            value, pos = read_varint(data, pos)
+            args.append(value)
+        else:
+            raise ValueError("unknown argument tag %d" % tag)
+
+    return args
+
+
+def render(fmt, args):
+    """Apply a C format string, dropping the length modifiers."""
+    pending = list(args)
+
+    def convert(match):
+        flags, size, kind = match.group(1), match.group(2), match.group(3)
+
+        if kind == "%":
+            return "%"
+        if not pending:
+            return "<?>"
+
+        value = pending.pop(0)
+
+        if kind == "p":
+            return "0x%x" % value
+        if kind in "ouxX" and isinstance(value, int) and value < 0:
+            value &= (1 << (64 if size in ("l", "ll", "z", "j", "t") else 32)) - 1
+        if kind == "u":
+            kind = "d"
+
+        return ("%" + flags + kind) % value
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(elf_path, dump_path):
+    base, strings = load_section(elf_path)
+
+    with open(dump_path, "rb") as f:
+        data = f.read()
+
+    pos = 0
+
+    while pos < len(data) and data[pos] != 0:
+        end = pos + data[pos]
+        level = data[pos + 1]
+        token, args_pos = read_varint(data, pos + 2)
+        offset = token - base
+
+        if 0 <= offset < len(strings):
+            fmt = strings[offset:strings.index(b"\0", offset)].decode(errors="replace")
+            text = render(fmt, read_args(data, args_pos, end)).rstrip("\n")
+        else:
+            text = "<unknown token 0x%x>" % token
+
+        if level & TRUNCATED:
+            text += " <truncated>"
+
+        print("%s %s" % (LEVELS.get(level & ~TRUNCATED, "???"), text))
+        pos = end
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: %s <elf file> <log dump>" % sys.argv[0])
+
+    decode(sys.argv[1], sys.argv[2])